@@ -0,0 +1,232 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2022 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "bench_hd.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* The number of header blocks in one round. */
+#define NUM_BLOCKS 100
+
+static const nghttp2_nv nva1[] = {
+    MAKE_NV(":method", "GET"),
+    MAKE_NV(":scheme", "https"),
+    MAKE_NV(":authority", "www.example.org"),
+    MAKE_NV(":path", "/"),
+    MAKE_NV("user-agent",
+            "Mozilla/5.0 (X11; Linux x86_64; rv:105.0) Gecko/20100101 "
+            "Firefox/105.0"),
+    MAKE_NV("accept", "text/html,application/xhtml+xml,application/xml;q=0.9,"
+                      "image/avif,image/webp,*/*;q=0.8"),
+    MAKE_NV("accept-language", "en-US,en;q=0.5"),
+    MAKE_NV("accept-encoding", "gzip, deflate, br"),
+    MAKE_NV("cookie", "session=4f6e2a9d1c3b8e7f0a5d; theme=dark"),
+};
+
+static const nghttp2_nv nva2[] = {
+    MAKE_NV(":method", "GET"),
+    MAKE_NV(":scheme", "https"),
+    MAKE_NV(":authority", "www.example.org"),
+    MAKE_NV(":path", "/static/css/main.3f9a1c.css"),
+    MAKE_NV("user-agent",
+            "Mozilla/5.0 (X11; Linux x86_64; rv:105.0) Gecko/20100101 "
+            "Firefox/105.0"),
+    MAKE_NV("accept", "text/css,*/*;q=0.1"),
+    MAKE_NV("accept-language", "en-US,en;q=0.5"),
+    MAKE_NV("accept-encoding", "gzip, deflate, br"),
+    MAKE_NV("referer", "https://www.example.org/"),
+    MAKE_NV("cookie", "session=4f6e2a9d1c3b8e7f0a5d; theme=dark"),
+};
+
+static const nghttp2_nv nva3[] = {
+    MAKE_NV(":status", "200"),
+    MAKE_NV("server", "nghttpx"),
+    MAKE_NV("date", "Sun, 16 Oct 2022 12:00:00 GMT"),
+    MAKE_NV("content-type", "text/html; charset=utf-8"),
+    MAKE_NV("content-length", "12345"),
+    MAKE_NV("cache-control", "private, max-age=0"),
+    MAKE_NV("strict-transport-security", "max-age=31536000"),
+    MAKE_NV("via", "2 nghttpx"),
+    MAKE_NV("x-request-id", "9b2c4e6a-1f3d-4c5b-8a7e-0d9f2b1c3a4e"),
+};
+
+typedef struct {
+  const nghttp2_nv *nva;
+  size_t nvlen;
+} header_block;
+
+static const header_block blocks[] = {
+    {nva1, ARRLEN(nva1)},
+    {nva2, ARRLEN(nva2)},
+    {nva3, ARRLEN(nva3)},
+};
+
+static size_t nva_len(const nghttp2_nv *nva, size_t nvlen) {
+  size_t i, n = 0;
+
+  for (i = 0; i < nvlen; ++i) {
+    n += nva[i].namelen + nva[i].valuelen;
+  }
+
+  return n;
+}
+
+int bench_hd_deflate(bench_result *res, const bench_config *config) {
+  nghttp2_hd_deflater *deflater;
+  uint8_t buf[4096];
+  const header_block *blk;
+  size_t i, j;
+  uint64_t start;
+  ssize_t n;
+  int rv;
+
+  rv = nghttp2_hd_deflate_new(&deflater, 4096);
+  if (rv != 0) {
+    return rv;
+  }
+
+  start = bench_now();
+
+  for (i = 0; i < config->rounds; ++i) {
+    for (j = 0; j < NUM_BLOCKS; ++j) {
+      blk = &blocks[j % ARRLEN(blocks)];
+
+      n = nghttp2_hd_deflate_hd(deflater, buf, sizeof(buf), blk->nva,
+                                blk->nvlen);
+      if (n < 0) {
+        rv = (int)n;
+        goto fin;
+      }
+
+      ++res->ops;
+      res->bytes += nva_len(blk->nva, blk->nvlen);
+    }
+  }
+
+  res->elapsed_ns = bench_now() - start;
+
+fin:
+  nghttp2_hd_deflate_del(deflater);
+
+  return rv;
+}
+
+int bench_hd_inflate(bench_result *res, const bench_config *config) {
+  nghttp2_hd_deflater *deflater;
+  nghttp2_hd_inflater *inflater = NULL;
+  uint8_t *buf, *p;
+  size_t buflen = NUM_BLOCKS * 4096;
+  size_t blklens[NUM_BLOCKS];
+  const header_block *blk;
+  nghttp2_nv nv;
+  int inflate_flags;
+  size_t i, j, uncomplen = 0;
+  uint64_t start;
+  ssize_t n;
+  int rv;
+
+  buf = malloc(buflen);
+  if (buf == NULL) {
+    return NGHTTP2_ERR_NOMEM;
+  }
+
+  rv = nghttp2_hd_deflate_new(&deflater, 4096);
+  if (rv != 0) {
+    free(buf);
+    return rv;
+  }
+
+  /* Header blocks are encoded once, and replayed in the same order
+     against a fresh inflater in each round so that the dynamic table
+     state stays consistent. */
+  for (p = buf, j = 0; j < NUM_BLOCKS; ++j) {
+    blk = &blocks[j % ARRLEN(blocks)];
+
+    n = nghttp2_hd_deflate_hd(deflater, p, (size_t)(buf + buflen - p),
+                              blk->nva, blk->nvlen);
+    if (n < 0) {
+      rv = (int)n;
+      goto fin;
+    }
+
+    blklens[j] = (size_t)n;
+    p += n;
+    uncomplen += nva_len(blk->nva, blk->nvlen);
+  }
+
+  start = bench_now();
+
+  for (i = 0; i < config->rounds; ++i) {
+    rv = nghttp2_hd_inflate_new(&inflater);
+    if (rv != 0) {
+      goto fin;
+    }
+
+    for (p = buf, j = 0; j < NUM_BLOCKS; p += blklens[j++]) {
+      const uint8_t *in = p;
+      size_t inlen = blklens[j];
+
+      for (;;) {
+        inflate_flags = 0;
+
+        n = nghttp2_hd_inflate_hd2(inflater, &nv, &inflate_flags, in, inlen,
+                                   1);
+        if (n < 0) {
+          rv = (int)n;
+          goto fin;
+        }
+
+        in += n;
+        inlen -= (size_t)n;
+
+        if (inflate_flags & NGHTTP2_HD_INFLATE_FINAL) {
+          nghttp2_hd_inflate_end_headers(inflater);
+          break;
+        }
+
+        if (!(inflate_flags & NGHTTP2_HD_INFLATE_EMIT) && inlen == 0) {
+          break;
+        }
+      }
+    }
+
+    nghttp2_hd_inflate_del(inflater);
+    inflater = NULL;
+
+    res->ops += NUM_BLOCKS;
+    res->bytes += uncomplen;
+  }
+
+  res->elapsed_ns = bench_now() - start;
+
+fin:
+  if (inflater) {
+    nghttp2_hd_inflate_del(inflater);
+  }
+  nghttp2_hd_deflate_del(deflater);
+  free(buf);
+
+  return rv;
+}
@@ -0,0 +1,391 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2022 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "bench_helper.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+/* Source of DATA payload.  Its length is the default maximum frame
+   size, which is the largest chunk the library ever asks for. */
+static uint8_t data_payload[16384];
+
+typedef struct {
+  size_t remaining;
+} bench_stream;
+
+static const nghttp2_nv request_nva[] = {
+    MAKE_NV(":method", "GET"),
+    MAKE_NV(":scheme", "https"),
+    MAKE_NV(":authority", "example.org"),
+    MAKE_NV(":path", "/static/js/app.js"),
+    MAKE_NV("user-agent", "nghttp2-bench/" NGHTTP2_VERSION),
+    MAKE_NV("accept", "*/*"),
+    MAKE_NV("accept-encoding", "gzip, deflate, br"),
+};
+
+static const nghttp2_nv response_nva[] = {
+    MAKE_NV(":status", "200"),
+    MAKE_NV("server", "nghttpx"),
+    MAKE_NV("content-type", "application/javascript"),
+    MAKE_NV("cache-control", "public, max-age=3600"),
+    MAKE_NV("via", "2 nghttpx"),
+};
+
+uint64_t bench_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static ssize_t send_callback(nghttp2_session *session, const uint8_t *data,
+                             size_t len, int flags, void *user_data) {
+  bench_pair *pair = user_data;
+  nghttp2_session *peer;
+  ssize_t rv;
+  (void)flags;
+
+  peer = session == pair->client ? pair->server : pair->client;
+
+  rv = nghttp2_session_mem_recv(peer, data, len);
+  if (rv < 0) {
+    return NGHTTP2_ERR_CALLBACK_FAILURE;
+  }
+
+  return (ssize_t)len;
+}
+
+static int send_data_callback(nghttp2_session *session, nghttp2_frame *frame,
+                              const uint8_t *framehd, size_t length,
+                              nghttp2_data_source *source, void *user_data) {
+  bench_pair *pair = user_data;
+  (void)session;
+  (void)frame;
+  (void)source;
+
+  if (nghttp2_session_mem_recv(pair->client, framehd, 9) < 0 ||
+      nghttp2_session_mem_recv(pair->client, data_payload, length) < 0) {
+    return NGHTTP2_ERR_CALLBACK_FAILURE;
+  }
+
+  return 0;
+}
+
+static int send_data_batch_callback(nghttp2_session *session,
+                                    const nghttp2_send_data_entry *entries,
+                                    size_t nentries, void *user_data) {
+  bench_pair *pair = user_data;
+  size_t i;
+  (void)session;
+
+  for (i = 0; i < nentries; ++i) {
+    if (nghttp2_session_mem_recv(pair->client, entries[i].framehd, 9) < 0 ||
+        nghttp2_session_mem_recv(pair->client, data_payload,
+                                 entries[i].length) < 0) {
+      return NGHTTP2_ERR_CALLBACK_FAILURE;
+    }
+  }
+
+  return 0;
+}
+
+static ssize_t data_source_read_callback(nghttp2_session *session,
+                                         int32_t stream_id, uint8_t *buf,
+                                         size_t length, uint32_t *data_flags,
+                                         nghttp2_data_source *source,
+                                         void *user_data) {
+  bench_pair *pair = user_data;
+  bench_stream *strm = source->ptr;
+  size_t n;
+  (void)session;
+  (void)stream_id;
+
+  n = strm->remaining < length ? strm->remaining : length;
+  if (n > sizeof(data_payload)) {
+    n = sizeof(data_payload);
+  }
+
+  if (pair->data_mode != BENCH_DATA_COPY) {
+    *data_flags |= NGHTTP2_DATA_FLAG_NO_COPY;
+  } else {
+    memcpy(buf, data_payload, n);
+  }
+
+  strm->remaining -= n;
+  if (strm->remaining == 0) {
+    *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+  }
+
+  return (ssize_t)n;
+}
+
+static int server_on_frame_recv_callback(nghttp2_session *session,
+                                         const nghttp2_frame *frame,
+                                         void *user_data) {
+  bench_pair *pair = user_data;
+  bench_stream *strm;
+  nghttp2_data_provider data_prd;
+  int rv;
+
+  ++pair->frame_recv;
+
+  if (frame->hd.type != NGHTTP2_HEADERS ||
+      frame->headers.cat != NGHTTP2_HCAT_REQUEST ||
+      !(frame->hd.flags & NGHTTP2_FLAG_END_STREAM)) {
+    return 0;
+  }
+
+  if (pair->response_body_len == 0) {
+    rv = nghttp2_submit_response(session, frame->hd.stream_id, response_nva,
+                                 ARRLEN(response_nva), NULL);
+    return rv == 0 ? 0 : NGHTTP2_ERR_CALLBACK_FAILURE;
+  }
+
+  strm = malloc(sizeof(bench_stream));
+  if (strm == NULL) {
+    return NGHTTP2_ERR_CALLBACK_FAILURE;
+  }
+
+  strm->remaining = pair->response_body_len;
+
+  data_prd.source.ptr = strm;
+  data_prd.read_callback = data_source_read_callback;
+
+  rv = nghttp2_submit_response(session, frame->hd.stream_id, response_nva,
+                               ARRLEN(response_nva), &data_prd);
+  if (rv != 0) {
+    free(strm);
+    return NGHTTP2_ERR_CALLBACK_FAILURE;
+  }
+
+  nghttp2_session_set_stream_user_data(session, frame->hd.stream_id, strm);
+
+  return 0;
+}
+
+static int server_on_stream_close_callback(nghttp2_session *session,
+                                           int32_t stream_id,
+                                           uint32_t error_code,
+                                           void *user_data) {
+  (void)error_code;
+  (void)user_data;
+
+  free(nghttp2_session_get_stream_user_data(session, stream_id));
+
+  return 0;
+}
+
+static int client_on_frame_recv_callback(nghttp2_session *session,
+                                         const nghttp2_frame *frame,
+                                         void *user_data) {
+  bench_pair *pair = user_data;
+  (void)session;
+  (void)frame;
+
+  ++pair->frame_recv;
+
+  return 0;
+}
+
+static int client_on_data_chunk_recv_callback(nghttp2_session *session,
+                                              uint8_t flags, int32_t stream_id,
+                                              const uint8_t *data, size_t len,
+                                              void *user_data) {
+  bench_pair *pair = user_data;
+  (void)session;
+  (void)flags;
+  (void)stream_id;
+  (void)data;
+
+  pair->client_data_recv += len;
+
+  return 0;
+}
+
+static int client_on_stream_close_callback(nghttp2_session *session,
+                                           int32_t stream_id,
+                                           uint32_t error_code,
+                                           void *user_data) {
+  bench_pair *pair = user_data;
+  (void)session;
+  (void)stream_id;
+  (void)error_code;
+
+  ++pair->client_stream_close;
+
+  return 0;
+}
+
+int bench_pair_init(bench_pair *pair, size_t response_body_len,
+                    bench_data_mode data_mode) {
+  nghttp2_session_callbacks *callbacks;
+  nghttp2_settings_entry iv[] = {
+      {NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, NGHTTP2_MAX_WINDOW_SIZE},
+  };
+  int rv;
+
+  memset(pair, 0, sizeof(*pair));
+
+  pair->response_body_len = response_body_len;
+  pair->data_mode = data_mode;
+
+  rv = nghttp2_session_callbacks_new(&callbacks);
+  if (rv != 0) {
+    return rv;
+  }
+
+  nghttp2_session_callbacks_set_send_callback(callbacks, send_callback);
+  nghttp2_session_callbacks_set_on_frame_recv_callback(
+      callbacks, client_on_frame_recv_callback);
+  nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+      callbacks, client_on_data_chunk_recv_callback);
+  nghttp2_session_callbacks_set_on_stream_close_callback(
+      callbacks, client_on_stream_close_callback);
+
+  rv = nghttp2_session_client_new(&pair->client, callbacks, pair);
+  if (rv != 0) {
+    goto fail;
+  }
+
+  nghttp2_session_callbacks_set_on_frame_recv_callback(
+      callbacks, server_on_frame_recv_callback);
+  nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, NULL);
+  nghttp2_session_callbacks_set_on_stream_close_callback(
+      callbacks, server_on_stream_close_callback);
+  if (data_mode == BENCH_DATA_NO_COPY_BATCH) {
+    nghttp2_session_callbacks_set_send_data_batch_callback(
+        callbacks, send_data_batch_callback);
+  } else {
+    nghttp2_session_callbacks_set_send_data_callback(callbacks,
+                                                     send_data_callback);
+  }
+
+  rv = nghttp2_session_server_new(&pair->server, callbacks, pair);
+  if (rv != 0) {
+    goto fail;
+  }
+
+  nghttp2_session_callbacks_del(callbacks);
+  callbacks = NULL;
+
+  rv = nghttp2_submit_settings(pair->client, NGHTTP2_FLAG_NONE, iv,
+                               ARRLEN(iv));
+  if (rv != 0) {
+    goto fail;
+  }
+
+  rv = nghttp2_session_set_local_window_size(pair->client, NGHTTP2_FLAG_NONE,
+                                             0, NGHTTP2_MAX_WINDOW_SIZE);
+  if (rv != 0) {
+    goto fail;
+  }
+
+  rv = nghttp2_submit_settings(pair->server, NGHTTP2_FLAG_NONE, NULL, 0);
+  if (rv != 0) {
+    goto fail;
+  }
+
+  rv = bench_pair_pump(pair);
+  if (rv != 0) {
+    goto fail;
+  }
+
+  pair->frame_recv = 0;
+
+  return 0;
+
+fail:
+  nghttp2_session_callbacks_del(callbacks);
+  bench_pair_free(pair);
+
+  return rv;
+}
+
+void bench_pair_free(bench_pair *pair) {
+  nghttp2_session_del(pair->server);
+  nghttp2_session_del(pair->client);
+
+  pair->server = NULL;
+  pair->client = NULL;
+}
+
+int bench_pair_pump(bench_pair *pair) {
+  int rv;
+
+  while (nghttp2_session_want_write(pair->client) ||
+         nghttp2_session_want_write(pair->server)) {
+    rv = nghttp2_session_send(pair->client);
+    if (rv != 0) {
+      return rv;
+    }
+
+    rv = nghttp2_session_send(pair->server);
+    if (rv != 0) {
+      return rv;
+    }
+  }
+
+  return 0;
+}
+
+int32_t bench_pair_submit_request(bench_pair *pair) {
+  return nghttp2_submit_request(pair->client, NULL, request_nva,
+                                ARRLEN(request_nva), NULL, NULL);
+}
+
+void bench_write_json(FILE *out, const bench_result *results,
+                      size_t nresults) {
+  size_t i;
+  const bench_result *res;
+  double secs;
+
+  fprintf(out, "{\n  \"version\": \"%s\",\n  \"benchmarks\": [",
+          nghttp2_version(0)->version_str);
+
+  for (i = 0; i < nresults; ++i) {
+    res = &results[i];
+    secs = (double)res->elapsed_ns / 1e9;
+    if (secs <= 0) {
+      secs = 1e-9;
+    }
+
+    fprintf(out,
+            "%s\n    {\n"
+            "      \"name\": \"%s\",\n"
+            "      \"elapsed_ns\": %" PRIu64 ",\n"
+            "      \"ops\": %" PRIu64 ",\n"
+            "      \"ops_per_sec\": %.2f,\n"
+            "      \"bytes\": %" PRIu64 ",\n"
+            "      \"bytes_per_sec\": %.2f\n"
+            "    }",
+            i == 0 ? "" : ",", res->name, res->elapsed_ns, res->ops,
+            (double)res->ops / secs, res->bytes, (double)res->bytes / secs);
+  }
+
+  fprintf(out, "\n  ]\n}\n");
+}
@@ -0,0 +1,128 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2022 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BENCH_HELPER_H
+#define BENCH_HELPER_H
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <nghttp2/nghttp2.h>
+
+#define MAKE_NV(NAME, VALUE)                                                   \
+  {                                                                            \
+    (uint8_t *)(NAME), (uint8_t *)(VALUE), sizeof((NAME)) - 1,                 \
+        sizeof((VALUE)) - 1, NGHTTP2_NV_FLAG_NONE                              \
+  }
+#define ARRLEN(ARR) (sizeof(ARR) / sizeof(ARR[0]))
+
+typedef struct {
+  /* The number of times each benchmark repeats its measured loop. */
+  size_t rounds;
+} bench_config;
+
+typedef struct {
+  /* The name of benchmark, which is used as a key in JSON output. */
+  char name[64];
+  /* The number of operations (requests, frames, header blocks)
+     performed. */
+  uint64_t ops;
+  /* The number of payload bytes processed.  0 if the benchmark does
+     not measure throughput. */
+  uint64_t bytes;
+  /* The time spent in the measured loop, in nanoseconds. */
+  uint64_t elapsed_ns;
+} bench_result;
+
+/* Returns monotonic clock in nanoseconds. */
+uint64_t bench_now(void);
+
+/* How server sends response body */
+typedef enum {
+  /* Copy data in nghttp2_data_source_read_callback. */
+  BENCH_DATA_COPY,
+  /* Use NGHTTP2_DATA_FLAG_NO_COPY with nghttp2_send_data_callback. */
+  BENCH_DATA_NO_COPY,
+  /* Use NGHTTP2_DATA_FLAG_NO_COPY with
+     nghttp2_send_data_batch_callback. */
+  BENCH_DATA_NO_COPY_BATCH
+} bench_data_mode;
+
+/*
+ * bench_pair connects client and server sessions in memory.  The
+ * bytes one session sends are fed to the other session's
+ * nghttp2_session_mem_recv() straight from the send callbacks, so
+ * that nothing but libnghttp2 itself is measured.
+ */
+typedef struct {
+  nghttp2_session *client;
+  nghttp2_session *server;
+  /* The number of streams closed on client side. */
+  size_t client_stream_close;
+  /* The number of DATA payload bytes received by client. */
+  uint64_t client_data_recv;
+  /* The number of frames received by either side. */
+  uint64_t frame_recv;
+  /* The response body length server sends for each request.  If
+     this is 0, server responds with HEADERS only. */
+  size_t response_body_len;
+  /* How server sends response body */
+  bench_data_mode data_mode;
+} bench_pair;
+
+/*
+ * Initializes |pair|, exchanges connection prefaces and SETTINGS.
+ * Flow control windows on both sides are opened to their maximum so
+ * that throughput is not limited by WINDOW_UPDATE round trips.
+ * Returns 0 if it succeeds, or negative error code.
+ */
+int bench_pair_init(bench_pair *pair, size_t response_body_len,
+                    bench_data_mode data_mode);
+
+void bench_pair_free(bench_pair *pair);
+
+/*
+ * Makes both sessions send everything they have until neither of
+ * them wants to write.  Returns 0 if it succeeds, or negative error
+ * code.
+ */
+int bench_pair_pump(bench_pair *pair);
+
+/*
+ * Submits a request from client side.  Returns stream ID, or
+ * negative error code.
+ */
+int32_t bench_pair_submit_request(bench_pair *pair);
+
+/*
+ * Writes |results| of length |nresults| to |out| in JSON.
+ */
+void bench_write_json(FILE *out, const bench_result *results,
+                      size_t nresults);
+
+#endif /* BENCH_HELPER_H */
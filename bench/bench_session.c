@@ -0,0 +1,191 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2022 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "bench_session.h"
+
+#include <stdio.h>
+
+/* The number of requests submitted at once in each round. */
+#define BATCH_SIZE 100
+
+/* The response body length for DATA throughput benchmarks. */
+#define DATA_BODY_LEN (1024 * 1024)
+
+/* The number of streams which share DATA_BODY_LEN in multi stream
+   DATA throughput benchmarks. */
+#define MULTI_STREAMS 16
+
+/* The response body length for each stream in scheduler
+   benchmark. */
+#define SCHEDULER_BODY_LEN (64 * 1024)
+
+static int run_requests(bench_pair *pair, bench_result *res,
+                        const bench_config *config, size_t nreqs) {
+  size_t i, j;
+  uint64_t start;
+  int32_t stream_id;
+  int rv;
+
+  start = bench_now();
+
+  for (i = 0; i < config->rounds; ++i) {
+    for (j = 0; j < nreqs; ++j) {
+      stream_id = bench_pair_submit_request(pair);
+      if (stream_id < 0) {
+        return stream_id;
+      }
+    }
+
+    rv = bench_pair_pump(pair);
+    if (rv != 0) {
+      return rv;
+    }
+  }
+
+  res->elapsed_ns = bench_now() - start;
+
+  return 0;
+}
+
+int bench_session_requests(bench_result *res, const bench_config *config) {
+  bench_pair pair;
+  int rv;
+
+  rv = bench_pair_init(&pair, 0, BENCH_DATA_COPY);
+  if (rv != 0) {
+    return rv;
+  }
+
+  rv = run_requests(&pair, res, config, BATCH_SIZE);
+
+  res->ops = pair.client_stream_close;
+
+  bench_pair_free(&pair);
+
+  return rv;
+}
+
+int bench_session_ping(bench_result *res, const bench_config *config) {
+  bench_pair pair;
+  size_t i, j;
+  uint64_t start;
+  int rv;
+
+  rv = bench_pair_init(&pair, 0, BENCH_DATA_COPY);
+  if (rv != 0) {
+    return rv;
+  }
+
+  start = bench_now();
+
+  for (i = 0; i < config->rounds; ++i) {
+    for (j = 0; j < BATCH_SIZE; ++j) {
+      rv = nghttp2_submit_ping(pair.client, NGHTTP2_FLAG_NONE, NULL);
+      if (rv != 0) {
+        goto fin;
+      }
+    }
+
+    rv = bench_pair_pump(&pair);
+    if (rv != 0) {
+      goto fin;
+    }
+  }
+
+  res->elapsed_ns = bench_now() - start;
+  res->ops = pair.frame_recv;
+
+fin:
+  bench_pair_free(&pair);
+
+  return rv;
+}
+
+static int run_data(bench_result *res, const bench_config *config,
+                    bench_data_mode data_mode, size_t nstreams) {
+  bench_pair pair;
+  int rv;
+
+  rv = bench_pair_init(&pair, DATA_BODY_LEN / nstreams, data_mode);
+  if (rv != 0) {
+    return rv;
+  }
+
+  rv = run_requests(&pair, res, config, nstreams);
+
+  res->ops = pair.frame_recv;
+  res->bytes = pair.client_data_recv;
+
+  bench_pair_free(&pair);
+
+  return rv;
+}
+
+int bench_session_data_copy(bench_result *res, const bench_config *config) {
+  return run_data(res, config, BENCH_DATA_COPY, 1);
+}
+
+int bench_session_data_no_copy(bench_result *res, const bench_config *config) {
+  return run_data(res, config, BENCH_DATA_NO_COPY, 1);
+}
+
+int bench_session_data_no_copy_multi(bench_result *res,
+                                     const bench_config *config) {
+  return run_data(res, config, BENCH_DATA_NO_COPY, MULTI_STREAMS);
+}
+
+int bench_session_data_no_copy_batch(bench_result *res,
+                                     const bench_config *config) {
+  return run_data(res, config, BENCH_DATA_NO_COPY_BATCH, MULTI_STREAMS);
+}
+
+int bench_session_scheduler(bench_result *res, const bench_config *config,
+                            size_t nstreams) {
+  bench_pair pair;
+  bench_config cfg = *config;
+  int rv;
+
+  snprintf(res->name, sizeof(res->name), "scheduler_streams_%zu", nstreams);
+
+  rv = bench_pair_init(&pair, SCHEDULER_BODY_LEN, BENCH_DATA_NO_COPY);
+  if (rv != 0) {
+    return rv;
+  }
+
+  /* Keep the amount of DATA roughly constant regardless of
+     |nstreams|. */
+  cfg.rounds = config->rounds * BATCH_SIZE / nstreams;
+  if (cfg.rounds == 0) {
+    cfg.rounds = 1;
+  }
+
+  rv = run_requests(&pair, res, &cfg, nstreams);
+
+  res->ops = pair.frame_recv;
+  res->bytes = pair.client_data_recv;
+
+  bench_pair_free(&pair);
+
+  return rv;
+}
@@ -0,0 +1,63 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2022 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BENCH_SESSION_H
+#define BENCH_SESSION_H
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include "bench_helper.h"
+
+/* Measures HEADERS only request/response exchanges per second. */
+int bench_session_requests(bench_result *res, const bench_config *config);
+
+/* Measures PING and PING ACK frames per second. */
+int bench_session_ping(bench_result *res, const bench_config *config);
+
+/* Measures DATA throughput of a response body copied by
+   nghttp2_data_source_read_callback. */
+int bench_session_data_copy(bench_result *res, const bench_config *config);
+
+/* Measures DATA throughput of a response body sent with
+   NGHTTP2_DATA_FLAG_NO_COPY. */
+int bench_session_data_no_copy(bench_result *res, const bench_config *config);
+
+/* Like bench_session_data_no_copy(), but the response body is split
+   across concurrent streams. */
+int bench_session_data_no_copy_multi(bench_result *res,
+                                     const bench_config *config);
+
+/* Like bench_session_data_no_copy_multi(), but DATA frames are sent
+   with nghttp2_send_data_batch_callback. */
+int bench_session_data_no_copy_batch(bench_result *res,
+                                     const bench_config *config);
+
+/* Measures frames per second when |nstreams| streams compete for
+   the connection at the same time. */
+int bench_session_scheduler(bench_result *res, const bench_config *config,
+                            size_t nstreams);
+
+#endif /* BENCH_SESSION_H */
@@ -0,0 +1,179 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2022 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "bench_helper.h"
+#include "bench_session.h"
+#include "bench_hd.h"
+
+typedef struct {
+  const char *name;
+  int (*func)(bench_result *res, const bench_config *config);
+} bench_entry;
+
+static const bench_entry benchmarks[] = {
+    {"session_requests", bench_session_requests},
+    {"session_ping", bench_session_ping},
+    {"session_data_copy", bench_session_data_copy},
+    {"session_data_no_copy", bench_session_data_no_copy},
+    {"session_data_no_copy_multi", bench_session_data_no_copy_multi},
+    {"session_data_no_copy_batch", bench_session_data_no_copy_batch},
+    {"hd_deflate", bench_hd_deflate},
+    {"hd_inflate", bench_hd_inflate},
+};
+
+static const size_t scheduler_nstreams[] = {1, 10, 100, 1000};
+
+static void print_usage(FILE *out) {
+  fprintf(out, "Usage: nghttp2-bench [-n ROUNDS] [-o FILE] [FILTER...]\n"
+               "\n"
+               "Runs libnghttp2 microbenchmarks and writes the results in "
+               "JSON.\n"
+               "If FILTER is given, only benchmarks whose name contains any\n"
+               "of FILTER are run.\n"
+               "\n"
+               "Options:\n"
+               "  -n ROUNDS  The number of rounds each benchmark repeats.\n"
+               "             Default: 1000\n"
+               "  -o FILE    Write results to FILE instead of stdout.\n"
+               "  -h         Display this help and exit.\n");
+}
+
+static int selected(const char *name, char **filters, size_t nfilters) {
+  size_t i;
+
+  if (nfilters == 0) {
+    return 1;
+  }
+
+  for (i = 0; i < nfilters; ++i) {
+    if (strstr(name, filters[i])) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  bench_config config;
+  bench_result results[ARRLEN(benchmarks) + ARRLEN(scheduler_nstreams)];
+  bench_result *res;
+  size_t nresults = 0;
+  size_t i;
+  const char *outfile = NULL;
+  FILE *out = stdout;
+  char name[64];
+  int c, rv;
+
+  config.rounds = 1000;
+
+  while ((c = getopt(argc, argv, "hn:o:")) != -1) {
+    switch (c) {
+    case 'n':
+      config.rounds = strtoul(optarg, NULL, 10);
+      if (config.rounds == 0) {
+        fprintf(stderr, "-n: ROUNDS must be positive\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'o':
+      outfile = optarg;
+      break;
+    case 'h':
+      print_usage(stdout);
+      return EXIT_SUCCESS;
+    default:
+      print_usage(stderr);
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (i = 0; i < ARRLEN(benchmarks); ++i) {
+    if (!selected(benchmarks[i].name, argv + optind,
+                  (size_t)(argc - optind))) {
+      continue;
+    }
+
+    res = &results[nresults];
+    memset(res, 0, sizeof(*res));
+    snprintf(res->name, sizeof(res->name), "%s", benchmarks[i].name);
+
+    fprintf(stderr, "Running %s\n", res->name);
+
+    rv = benchmarks[i].func(res, &config);
+    if (rv != 0) {
+      fprintf(stderr, "%s failed: %s\n", res->name, nghttp2_strerror(rv));
+      return EXIT_FAILURE;
+    }
+
+    ++nresults;
+  }
+
+  for (i = 0; i < ARRLEN(scheduler_nstreams); ++i) {
+    snprintf(name, sizeof(name), "scheduler_streams_%zu",
+             scheduler_nstreams[i]);
+
+    if (!selected(name, argv + optind, (size_t)(argc - optind))) {
+      continue;
+    }
+
+    res = &results[nresults];
+    memset(res, 0, sizeof(*res));
+
+    fprintf(stderr, "Running %s\n", name);
+
+    rv = bench_session_scheduler(res, &config, scheduler_nstreams[i]);
+    if (rv != 0) {
+      fprintf(stderr, "%s failed: %s\n", name, nghttp2_strerror(rv));
+      return EXIT_FAILURE;
+    }
+
+    ++nresults;
+  }
+
+  if (outfile) {
+    out = fopen(outfile, "w");
+    if (out == NULL) {
+      perror(outfile);
+      return EXIT_FAILURE;
+    }
+  }
+
+  bench_write_json(out, results, nresults);
+
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -200,6 +200,24 @@ OPTIONS = [
     "frontend-quic-initial-rtt",
     "require-http-scheme",
     "tls-ktls",
+    "worker-dispatch",
+    "worker-cpu-affinity",
+    "response-cache-size",
+    "response-cache-max-entry-size",
+    "collapsed-forwarding-timeout",
+    "response-compression",
+    "response-compression-level",
+    "response-compression-min-size",
+    "response-compression-mime-types",
+    "log-async",
+    "log-async-buffer-size",
+    "accesslog-binary",
+    "backend-http2-io-threads",
+    "http1-splice",
+    "frontend-zerocopy-threshold",
+    "io-engine",
+    "buffer-pool-high-watermark",
+    "buffer-pool-low-watermark",
 ]
 
 LOGVARS = [
@@ -1349,3 +1349,79 @@ func TestH1H1ChunkedEndsPrematurely(t *testing.T) {
 		t.Fatal("st.http1() should fail")
 	}
 }
+
+// TestH1H1Splice tests that response bodies forwarded with splice(2)
+// are received intact, and the backend connection is reused for the
+// next request.
+func TestH1H1Splice(t *testing.T) {
+	body := bytes.Repeat([]byte("0123456789abcdef"), 64*1024)
+	addrs := make(chan string, 2)
+	opts := options{
+		args: []string{"--http1-splice"},
+		handler: func(w http.ResponseWriter, r *http.Request) {
+			addrs <- r.RemoteAddr
+			w.Header().Set("Content-Length", fmt.Sprint(len(body)))
+			w.Write(body)
+		},
+	}
+	st := newServerTester(t, opts)
+	defer st.Close()
+
+	for i := 0; i < 2; i++ {
+		res, err := st.http1(requestParam{
+			name: "TestH1H1Splice",
+		})
+		if err != nil {
+			t.Fatalf("Error st.http1() = %v", err)
+		}
+
+		if got, want := res.status, 200; got != want {
+			t.Errorf("status = %v; want %v", got, want)
+		}
+		if !bytes.Equal(res.body, body) {
+			t.Errorf("len(res.body) = %v; want %v", len(res.body), len(body))
+		}
+	}
+
+	if got, want := <-addrs, <-addrs; got != want {
+		t.Errorf("backend address = %v; want %v", got, want)
+	}
+}
+
+// TestH1H1SpliceEndsPrematurely tests that an HTTP/1.1 request fails
+// if the backend response body forwarded with splice(2) ends
+// prematurely.
+func TestH1H1SpliceEndsPrematurely(t *testing.T) {
+	opts := options{
+		args: []string{"--http1-splice"},
+		handler: func(w http.ResponseWriter, r *http.Request) {
+			hj, ok := w.(http.Hijacker)
+			if !ok {
+				http.Error(w, "Could not hijack the connection", http.StatusInternalServerError)
+				return
+			}
+			conn, bufrw, err := hj.Hijack()
+			if err != nil {
+				http.Error(w, err.Error(), http.StatusInternalServerError)
+				return
+			}
+			defer conn.Close()
+			bufrw.WriteString("HTTP/1.1 200\r\nContent-Length: 1048576\r\n\r\n")
+			bufrw.Flush()
+			// Send the rest of the body separately so that it is
+			// read with splice(2).
+			time.Sleep(100 * time.Millisecond)
+			bufrw.Write(make([]byte, 65536))
+			bufrw.Flush()
+		},
+	}
+	st := newServerTester(t, opts)
+	defer st.Close()
+
+	_, err := st.http1(requestParam{
+		name: "TestH1H1SpliceEndsPrematurely",
+	})
+	if err == nil {
+		t.Fatal("st.http1() should fail")
+	}
+}
@@ -473,6 +473,11 @@ typedef struct nghttp2_rcbuf nghttp2_rcbuf;
  * @function
  *
  * Increments the reference count of |rcbuf| by 1.
+ *
+ * The reference count is not updated atomically.  This function
+ * must be called in the thread which uses the :type:`nghttp2_session`
+ * which gave |rcbuf| to application, typically inside the callback
+ * which receives |rcbuf|.
  */
 NGHTTP2_EXTERN void nghttp2_rcbuf_incref(nghttp2_rcbuf *rcbuf);
 
@@ -482,6 +487,14 @@ NGHTTP2_EXTERN void nghttp2_rcbuf_incref(nghttp2_rcbuf *rcbuf);
  * Decrements the reference count of |rcbuf| by 1.  If the reference
  * count becomes zero, the object pointed by |rcbuf| will be freed.
  * In this case, application must not use |rcbuf| again.
+ *
+ * `nghttp2_rcbuf_incref()` detaches |rcbuf| from the internal pool
+ * of :type:`nghttp2_session`, so that the object retained by
+ * application is freed by the memory allocator, not returned to the
+ * pool.  The reference count is not updated atomically.  If
+ * application releases |rcbuf| in another thread, it must not race
+ * with the library or other threads which update the reference
+ * count of the same |rcbuf|.
  */
 NGHTTP2_EXTERN void nghttp2_rcbuf_decref(nghttp2_rcbuf *rcbuf);
 
@@ -867,7 +880,8 @@ typedef enum {
   NGHTTP2_DATA_FLAG_NO_END_STREAM = 0x02,
   /**
    * Indicates that application will send complete DATA frame in
-   * :type:`nghttp2_send_data_callback`.
+   * :type:`nghttp2_send_data_callback` or
+   * :type:`nghttp2_send_data_batch_callback`.
    */
   NGHTTP2_DATA_FLAG_NO_COPY = 0x04
 } nghttp2_data_flag;
@@ -1387,6 +1401,86 @@ typedef int (*nghttp2_send_data_callback)(nghttp2_session *session,
                                           nghttp2_data_source *source,
                                           void *user_data);
 
+/**
+ * @macro
+ *
+ * The maximum number of DATA frames passed to
+ * :type:`nghttp2_send_data_batch_callback` at once.
+ */
+#define NGHTTP2_MAX_SEND_DATA_BATCH 16
+
+/**
+ * @struct
+ *
+ * The DATA frame passed to :type:`nghttp2_send_data_batch_callback`.
+ * The fields correspond to the parameters of
+ * :type:`nghttp2_send_data_callback`.
+ */
+typedef struct {
+  /**
+   * The DATA frame to send.
+   */
+  nghttp2_data frame;
+  /**
+   * The serialized frame header.
+   */
+  uint8_t framehd[9];
+  /**
+   * The length of application data to send.  This does not include
+   * padding.
+   */
+  size_t length;
+  /**
+   * The copy of the data source passed to
+   * :type:`nghttp2_data_source_read_callback`.
+   */
+  nghttp2_data_source source;
+} nghttp2_send_data_entry;
+
+/**
+ * @functypedef
+ *
+ * Callback function invoked to send DATA frames of one or more
+ * streams, for which :enum:`nghttp2_data_flag.NGHTTP2_DATA_FLAG_NO_COPY`
+ * is used in :type:`nghttp2_data_source_read_callback`.  If this
+ * callback is set, it is used instead of
+ * :type:`nghttp2_send_data_callback`.
+ *
+ * The |entries| of length |nentries| are DATA frames in the order
+ * they must be sent.  For each of them, the application must send
+ * complete DATA frame in the same way described in
+ * :type:`nghttp2_send_data_callback`.  |nentries| is at most
+ * :macro:`NGHTTP2_MAX_SEND_DATA_BATCH`.
+ *
+ * The library collects consecutive DATA frames of distinct streams
+ * produced in one scheduling round, and invokes this callback before
+ * it serializes any other frame, before it asks the data source of a
+ * stream which already has a DATA frame in the batch for more data,
+ * before it closes a stream by sending a DATA frame with END_STREAM
+ * flag, and before `nghttp2_session_mem_send()` or
+ * `nghttp2_session_send()` returns.  Therefore, the stream and the
+ * data source of each entry are still valid in this callback, and
+ * :type:`nghttp2_data_source_read_callback` observes the data source
+ * in the same state as it does with
+ * :type:`nghttp2_send_data_callback`.  Note that
+ * :type:`nghttp2_on_frame_send_callback` for a DATA frame without
+ * END_STREAM flag may be called before the frame is passed to this
+ * callback.
+ *
+ * The library has already committed to send these frames when this
+ * callback is invoked, so this callback cannot reject a part of them.
+ * If all frames were written successfully, return 0.  When data is
+ * fully processed, but application wants to make
+ * `nghttp2_session_mem_send()` or `nghttp2_session_send()` return
+ * immediately without processing next frames, return
+ * :enum:`nghttp2_error.NGHTTP2_ERR_PAUSE`.  Returning any other value
+ * is treated as :enum:`nghttp2_error.NGHTTP2_ERR_CALLBACK_FAILURE`,
+ * which will result in connection closure.
+ */
+typedef int (*nghttp2_send_data_batch_callback)(
+    nghttp2_session *session, const nghttp2_send_data_entry *entries,
+    size_t nentries, void *user_data);
+
 /**
  * @functypedef
  *
@@ -2338,6 +2432,18 @@ NGHTTP2_EXTERN void nghttp2_session_callbacks_set_send_data_callback(
     nghttp2_session_callbacks *cbs,
     nghttp2_send_data_callback send_data_callback);
 
+/**
+ * @function
+ *
+ * Sets callback function invoked to send DATA frames of multiple
+ * streams at once when
+ * :enum:`nghttp2_data_flag.NGHTTP2_DATA_FLAG_NO_COPY` is used in
+ * :type:`nghttp2_data_source_read_callback`.
+ */
+NGHTTP2_EXTERN void nghttp2_session_callbacks_set_send_data_batch_callback(
+    nghttp2_session_callbacks *cbs,
+    nghttp2_send_data_batch_callback send_data_batch_callback);
+
 /**
  * @function
  *
@@ -2762,6 +2868,19 @@ NGHTTP2_EXTERN void
 nghttp2_option_set_no_rfc9113_leading_and_trailing_ws_validation(
     nghttp2_option *option, int val);
 
+/**
+ * @function
+ *
+ * This option sets the maximum number of released short header field
+ * name and value buffers which each of HPACK deflater and inflater of
+ * a session keeps for reuse.  The default value is 128.  The memory
+ * kept per session is roughly twice this value times 100 bytes, so
+ * an application which holds a lot of mostly idle sessions may want
+ * to lower it.  Setting 0 disables reuse.
+ */
+NGHTTP2_EXTERN void
+nghttp2_option_set_max_rcbuf_freelist(nghttp2_option *option, size_t val);
+
 /**
  * @function
  *
@@ -3134,6 +3253,253 @@ NGHTTP2_EXTERN ssize_t nghttp2_session_mem_recv(nghttp2_session *session,
                                                 const uint8_t *in,
                                                 size_t inlen);
 
+/**
+ * @macro
+ *
+ * The minimum number of elements of the array passed to
+ * `nghttp2_session_mem_recv_events()`.
+ */
+#define NGHTTP2_MIN_RECV_EVENTS 8
+
+/**
+ * @enum
+ *
+ * The type of event recorded by `nghttp2_session_mem_recv_events()`.
+ * Each type corresponds to the callback which would be invoked by
+ * `nghttp2_session_mem_recv()`.
+ */
+typedef enum {
+  /**
+   * Corresponds to :type:`nghttp2_on_begin_frame_callback`.
+   */
+  NGHTTP2_EVENT_BEGIN_FRAME = 1,
+  /**
+   * Corresponds to :type:`nghttp2_on_begin_headers_callback`.
+   */
+  NGHTTP2_EVENT_BEGIN_HEADERS,
+  /**
+   * Corresponds to :type:`nghttp2_on_header_callback2`.
+   */
+  NGHTTP2_EVENT_HEADER,
+  /**
+   * Corresponds to :type:`nghttp2_on_data_chunk_recv_callback`.
+   */
+  NGHTTP2_EVENT_DATA_CHUNK_RECV,
+  /**
+   * Corresponds to :type:`nghttp2_on_frame_recv_callback`.
+   */
+  NGHTTP2_EVENT_FRAME_RECV,
+  /**
+   * Corresponds to :type:`nghttp2_on_stream_close_callback`.
+   */
+  NGHTTP2_EVENT_STREAM_CLOSE
+} nghttp2_event_type;
+
+/**
+ * @struct
+ *
+ * The header field event.
+ */
+typedef struct {
+  /**
+   * The header name.  The library holds a reference to it until the
+   * next call of `nghttp2_session_mem_recv_events()`.  Call
+   * `nghttp2_rcbuf_incref()` to keep it longer.
+   */
+  nghttp2_rcbuf *name;
+  /**
+   * The header value.  Same lifetime rule as |name| applies.
+   */
+  nghttp2_rcbuf *value;
+  /**
+   * The stream ID which the header field belongs to.  For
+   * PUSH_PROMISE, this is the promised stream ID.
+   */
+  int32_t promised_stream_id;
+  /**
+   * The category of header block if the frame is HEADERS.
+   */
+  nghttp2_headers_category cat;
+  /**
+   * The type of frame which carries the header field; either
+   * :enum:`nghttp2_frame_type.NGHTTP2_HEADERS` or
+   * :enum:`nghttp2_frame_type.NGHTTP2_PUSH_PROMISE`.
+   */
+  uint8_t frame_type;
+  /**
+   * The bitwise OR of zero or more of :type:`nghttp2_nv_flag`.
+   */
+  uint8_t flags;
+} nghttp2_header_event;
+
+/**
+ * @struct
+ *
+ * The DATA chunk event.
+ */
+typedef struct {
+  /**
+   * Points to the chunk of DATA payload inside the buffer passed to
+   * `nghttp2_session_mem_recv_events()`.
+   */
+  const uint8_t *data;
+  /**
+   * The length of |data|.
+   */
+  size_t len;
+  /**
+   * The flags of DATA frame.
+   */
+  uint8_t flags;
+} nghttp2_data_chunk_event;
+
+/**
+ * @struct
+ *
+ * The stream closure event.
+ */
+typedef struct {
+  /**
+   * The stream user data associated to the stream at the time of
+   * closure.
+   */
+  void *stream_user_data;
+  /**
+   * The reason of closure.
+   */
+  uint32_t error_code;
+} nghttp2_stream_close_event;
+
+/**
+ * @union
+ *
+ * The event specific data.  Which member is valid depends on
+ * :member:`nghttp2_event.type`.
+ */
+typedef union {
+  /**
+   * The frame header for
+   * :enum:`nghttp2_event_type.NGHTTP2_EVENT_BEGIN_FRAME`.
+   */
+  nghttp2_frame_hd hd;
+  /**
+   * The frame for
+   * :enum:`nghttp2_event_type.NGHTTP2_EVENT_BEGIN_HEADERS` and
+   * :enum:`nghttp2_event_type.NGHTTP2_EVENT_FRAME_RECV`.  The pointer
+   * members which refer to the memory owned by the library, that is
+   * ``settings.iv``, ``goaway.opaque_data`` and ``ext.payload`` of
+   * ALTSVC, ORIGIN and PRIORITY_UPDATE frames, are set to ``NULL``.
+   */
+  nghttp2_frame frame;
+  /**
+   * The data for :enum:`nghttp2_event_type.NGHTTP2_EVENT_HEADER`.
+   */
+  nghttp2_header_event header;
+  /**
+   * The data for
+   * :enum:`nghttp2_event_type.NGHTTP2_EVENT_DATA_CHUNK_RECV`.
+   */
+  nghttp2_data_chunk_event data_chunk;
+  /**
+   * The data for
+   * :enum:`nghttp2_event_type.NGHTTP2_EVENT_STREAM_CLOSE`.
+   */
+  nghttp2_stream_close_event stream_close;
+} nghttp2_event_data;
+
+/**
+ * @struct
+ *
+ * The event recorded by `nghttp2_session_mem_recv_events()`.
+ */
+typedef struct {
+  /**
+   * The type of this event.
+   */
+  nghttp2_event_type type;
+  /**
+   * The stream ID this event is about.  0 for connection.
+   */
+  int32_t stream_id;
+  /**
+   * The event specific data.
+   */
+  nghttp2_event_data data;
+} nghttp2_event;
+
+/**
+ * @function
+ *
+ * Processes data |in| as an input from the remote endpoint like
+ * `nghttp2_session_mem_recv()` does, but instead of invoking
+ * :type:`nghttp2_on_begin_frame_callback`,
+ * :type:`nghttp2_on_begin_headers_callback`,
+ * :type:`nghttp2_on_header_callback`,
+ * :type:`nghttp2_on_data_chunk_recv_callback`,
+ * :type:`nghttp2_on_frame_recv_callback` and
+ * :type:`nghttp2_on_stream_close_callback` one by one, it appends
+ * lightweight event records to the array |events| in the order in
+ * which these callbacks would have been called.  The application
+ * then processes them in one loop after this function returns.  The
+ * other callbacks, such as :type:`nghttp2_on_invalid_frame_recv_callback`
+ * and :type:`nghttp2_error_callback2`, are still invoked
+ * synchronously.
+ *
+ * The caller must set the number of elements of |events| to
+ * |*pnevents|, which must be at least :macro:`NGHTTP2_MIN_RECV_EVENTS`.
+ * On successful return, the number of recorded events is assigned to
+ * |*pnevents|.  If |events| gets full, this function stops processing
+ * input at the next frame boundary and returns the number of bytes
+ * processed so far, which may be less than |inlen|.  The application
+ * must process the events, and call this function again with the
+ * rest of input.
+ *
+ * If the reception of a single frame produces more events than
+ * |events| can hold (e.g., GOAWAY closing many streams), the
+ * overflowing events are queued in |session|, and delivered first by
+ * the next call, before any input is processed.  No callback is
+ * invoked for them.  Therefore, if |*pnevents| equals to the number
+ * of elements of |events| on return, the application must call this
+ * function again, possibly with empty input, until it returns fewer
+ * events.
+ *
+ * The library does not access |events| after this function returns.
+ * The memory pointed by the events, such as
+ * :member:`nghttp2_header_event.name`, is valid until the next call
+ * of this function, or `nghttp2_session_del()`, so |events| can be
+ * reused, or freed, once the application copies what it needs.  The
+ * data pointed by :member:`nghttp2_data_chunk_event.data` is inside
+ * |in|, and the application must keep it until it processes the
+ * event.
+ *
+ * Because the events are processed after the frame has been fully
+ * handled by the library, returning
+ * :enum:`nghttp2_error.NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE` to
+ * reject a stream is not available; use `nghttp2_submit_rst_stream()`
+ * instead.
+ *
+ * This function returns the number of processed bytes, or one of the
+ * following negative error codes:
+ *
+ * :enum:`nghttp2_error.NGHTTP2_ERR_INVALID_ARGUMENT`
+ *     |*pnevents| is less than :macro:`NGHTTP2_MIN_RECV_EVENTS`.
+ * :enum:`nghttp2_error.NGHTTP2_ERR_NOMEM`
+ *     Out of memory.
+ * :enum:`nghttp2_error.NGHTTP2_ERR_CALLBACK_FAILURE`
+ *     The callback function failed.
+ * :enum:`nghttp2_error.NGHTTP2_ERR_BAD_CLIENT_MAGIC`
+ *     Invalid client magic was detected.  This error only returns
+ *     when |session| was configured as server and
+ *     `nghttp2_option_set_no_recv_client_magic()` is not used with
+ *     nonzero value.
+ * :enum:`nghttp2_error.NGHTTP2_ERR_FLOODED`
+ *     Flooding was detected in this HTTP/2 session, and it must be
+ *     closed.  This is most likely caused by misbehaviour of peer.
+ */
+NGHTTP2_EXTERN ssize_t nghttp2_session_mem_recv_events(
+    nghttp2_session *session, const uint8_t *in, size_t inlen,
+    nghttp2_event *events, size_t *pnevents);
+
 /**
  * @function
  *
@@ -3400,6 +3766,26 @@ nghttp2_session_get_hd_inflate_dynamic_table_size(nghttp2_session *session);
 NGHTTP2_EXTERN size_t
 nghttp2_session_get_hd_deflate_dynamic_table_size(nghttp2_session *session);
 
+/**
+ * @function
+ *
+ * Registers header fields |nva| of length |nvlen| as precompiled
+ * header fields of HPACK deflater of |session|.  See
+ * `nghttp2_hd_deflate_add_precompiled()` for details.
+ *
+ * This function returns 0 if it succeeds, or one of the following
+ * negative error codes:
+ *
+ * :enum:`nghttp2_error.NGHTTP2_ERR_NOMEM`
+ *     Out of memory.
+ * :enum:`nghttp2_error.NGHTTP2_ERR_INVALID_ARGUMENT`
+ *     Registering |nva| would exceed the limit of the number of
+ *     precompiled header fields.
+ */
+NGHTTP2_EXTERN int
+nghttp2_session_add_precompiled_headers(nghttp2_session *session,
+                                        const nghttp2_nv *nva, size_t nvlen);
+
 /**
  * @function
  *
@@ -5315,6 +5701,47 @@ NGHTTP2_EXTERN
 size_t
 nghttp2_hd_deflate_get_max_dynamic_table_size(nghttp2_hd_deflater *deflater);
 
+/**
+ * @function
+ *
+ * Registers header fields |nva| of length |nvlen| as precompiled
+ * header fields of |deflater|.  This is intended for the header
+ * fields which appear with the same value in most header blocks, such
+ * as server or alt-svc response header fields.
+ *
+ * The literal representations of each header field are encoded once
+ * by this function for all indexing modes, including Huffman coding.
+ * When the same name/value pair is given to `nghttp2_hd_deflate_hd()`
+ * and its variants later, the deflater searches header table as
+ * usual, and emits the cached byte sequence instead of encoding the
+ * literal representation again.  The output is identical to the one
+ * produced without registering the header field.
+ *
+ * The indexing mode is decided on each use, in the same way as
+ * ordinary header fields, taking into account the current dynamic
+ * table size and :member:`nghttp2_nv.flags` of the header field
+ * passed at that time.  Thus, the caller can still give
+ * :enum:`nghttp2_nv_flag.NGHTTP2_NV_FLAG_NO_INDEX` to a particular
+ * occurrence of a registered header field to get it never indexed.
+ *
+ * The name and value are copied, and header field name must be in
+ * lower case.  The header fields are compared byte by byte, and
+ * :member:`nghttp2_nv.flags` of |nva| is ignored.  At most 16 header
+ * fields can be registered per deflater.
+ *
+ * This function returns 0 if it succeeds, or one of the following
+ * negative error codes:
+ *
+ * :enum:`nghttp2_error.NGHTTP2_ERR_NOMEM`
+ *     Out of memory.
+ * :enum:`nghttp2_error.NGHTTP2_ERR_INVALID_ARGUMENT`
+ *     Registering |nva| would exceed the limit of the number of
+ *     precompiled header fields.
+ */
+NGHTTP2_EXTERN int
+nghttp2_hd_deflate_add_precompiled(nghttp2_hd_deflater *deflater,
+                                   const nghttp2_nv *nva, size_t nvlen);
+
 struct nghttp2_hd_inflater;
 
 /**
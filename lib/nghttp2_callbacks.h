@@ -120,6 +120,7 @@ struct nghttp2_session_callbacks {
   nghttp2_on_extension_chunk_recv_callback on_extension_chunk_recv_callback;
   nghttp2_error_callback error_callback;
   nghttp2_error_callback2 error_callback2;
+  nghttp2_send_data_batch_callback send_data_batch_callback;
 };
 
 #endif /* NGHTTP2_CALLBACKS_H */
@@ -35,8 +35,8 @@
 /* Make scalar initialization form of nghttp2_hd_entry */
 #define MAKE_STATIC_ENT(N, V, T, H)                                            \
   {                                                                            \
-    {NULL, NULL, (uint8_t *)(N), sizeof((N)) - 1, -1},                         \
-        {NULL, NULL, (uint8_t *)(V), sizeof((V)) - 1, -1},                     \
+    {NULL, NULL, (uint8_t *)(N), sizeof((N)) - 1, -1, NULL, NULL},             \
+        {NULL, NULL, (uint8_t *)(V), sizeof((V)) - 1, -1, NULL, NULL},         \
         {(uint8_t *)(N), (uint8_t *)(V), sizeof((N)) - 1, sizeof((V)) - 1, 0}, \
         T, H                                                                   \
   }
@@ -494,8 +494,8 @@ void nghttp2_hd_entry_init(nghttp2_hd_entry *ent, nghttp2_hd_nv *nv) {
   ent->next = NULL;
   ent->hash = 0;
 
-  nghttp2_rcbuf_incref(ent->nv.name);
-  nghttp2_rcbuf_incref(ent->nv.value);
+  nghttp2_rcbuf_incref_internal(ent->nv.name);
+  nghttp2_rcbuf_incref_internal(ent->nv.value);
 }
 
 void nghttp2_hd_entry_free(nghttp2_hd_entry *ent) {
@@ -683,6 +683,12 @@ static int hd_context_init(nghttp2_hd_context *context, nghttp2_mem *mem) {
     return rv;
   }
 
+  rv = nghttp2_rcbuf_pool_new(&context->rcbuf_pool, mem);
+  if (rv != 0) {
+    hd_ringbuf_free(&context->hd_table, mem);
+    return rv;
+  }
+
   context->hd_table_bufsize = 0;
   context->next_seq = 0;
 
@@ -691,6 +697,7 @@ static int hd_context_init(nghttp2_hd_context *context, nghttp2_mem *mem) {
 
 static void hd_context_free(nghttp2_hd_context *context) {
   hd_ringbuf_free(&context->hd_table, context->mem);
+  nghttp2_rcbuf_pool_del(context->rcbuf_pool);
 }
 
 int nghttp2_hd_deflate_init(nghttp2_hd_deflater *deflater, nghttp2_mem *mem) {
@@ -709,6 +716,9 @@ int nghttp2_hd_deflate_init2(nghttp2_hd_deflater *deflater,
 
   hd_map_init(&deflater->map);
 
+  deflater->precompiled = NULL;
+  deflater->precompiledlen = 0;
+
   if (max_deflate_dynamic_table_size < NGHTTP2_HD_DEFAULT_MAX_BUFFER_SIZE) {
     deflater->notify_table_size_change = 1;
     deflater->ctx.hd_table_bufsize_max = max_deflate_dynamic_table_size;
@@ -767,6 +777,22 @@ static void hd_inflate_keep_free(nghttp2_hd_inflater *inflater) {
 }
 
 void nghttp2_hd_deflate_free(nghttp2_hd_deflater *deflater) {
+  nghttp2_mem *mem;
+  nghttp2_hd_precompiled *pc;
+  size_t i;
+
+  mem = deflater->ctx.mem;
+
+  for (i = 0; i < deflater->precompiledlen; ++i) {
+    pc = &deflater->precompiled[i];
+
+    nghttp2_mem_free(mem, pc->encoded[0]);
+    nghttp2_rcbuf_decref(pc->nv.value);
+    nghttp2_rcbuf_decref(pc->nv.name);
+  }
+
+  nghttp2_mem_free(mem, deflater->precompiled);
+
   hd_context_free(&deflater->ctx);
 }
 
@@ -1339,6 +1365,100 @@ static int hd_deflate_decide_indexing(nghttp2_hd_deflater *deflater,
   return NGHTTP2_HD_WITH_INDEXING;
 }
 
+static int hd_deflate_indexing_mode(nghttp2_hd_deflater *deflater,
+                                    const nghttp2_nv *nv, int32_t token) {
+  /* Don't index authorization header field since it may contain low
+     entropy secret data (e.g., id/password).  Also cookie header
+     field with less than 20 bytes value is also never indexed.  This
+     is the same criteria used in Firefox codebase. */
+  if (token == NGHTTP2_TOKEN_AUTHORIZATION ||
+      (token == NGHTTP2_TOKEN_COOKIE && nv->valuelen < 20) ||
+      (nv->flags & NGHTTP2_NV_FLAG_NO_INDEX)) {
+    return NGHTTP2_HD_NEVER_INDEXING;
+  }
+
+  return hd_deflate_decide_indexing(deflater, nv, token);
+}
+
+static uint32_t hd_deflate_hash(const nghttp2_nv *nv, int32_t token) {
+  if (token == -1) {
+    return name_hash(nv);
+  }
+
+  if (token <= NGHTTP2_TOKEN_WWW_AUTHENTICATE) {
+    return static_table[token].hash;
+  }
+
+  return 0;
+}
+
+static nghttp2_hd_precompiled *
+hd_deflate_find_precompiled(nghttp2_hd_deflater *deflater,
+                            const nghttp2_nv *nv) {
+  nghttp2_hd_precompiled *pc;
+  size_t i;
+
+  for (i = 0; i < deflater->precompiledlen; ++i) {
+    pc = &deflater->precompiled[i];
+
+    if (pc->nv.value->len == nv->valuelen &&
+        pc->nv.name->len == nv->namelen &&
+        memcmp(pc->nv.value->base, nv->value, nv->valuelen) == 0 &&
+        memcmp(pc->nv.name->base, nv->name, nv->namelen) == 0) {
+      return pc;
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Emits precompiled header field |pc| which matches |nv|.  The
+ * indexing mode is decided, and header table is searched in the same
+ * way as ordinary header fields, so that the output is identical to
+ * the one deflate_nv() produces.  The cached literal representation
+ * is emitted unless header field is found in header table, or its
+ * name is found only in dynamic table.
+ */
+static int deflate_precompiled(nghttp2_hd_deflater *deflater,
+                               nghttp2_bufs *bufs, nghttp2_hd_precompiled *pc,
+                               const nghttp2_nv *nv) {
+  nghttp2_hd_context *ctx = &deflater->ctx;
+  search_result res;
+  int indexing_mode;
+  int rv;
+
+  indexing_mode = hd_deflate_indexing_mode(deflater, nv, pc->nv.token);
+
+  res = search_hd_table(ctx, nv, pc->nv.token, indexing_mode, &deflater->map,
+                        pc->hash);
+
+  if (res.name_value_match) {
+    DEBUGF("deflatehd: precompiled name/value match index=%zd\n", res.index);
+
+    return emit_indexed_block(bufs, (size_t)res.index);
+  }
+
+  if (indexing_mode == NGHTTP2_HD_WITH_INDEXING) {
+    rv = add_hd_table_incremental(ctx, &pc->nv, &deflater->map, pc->hash);
+    if (rv != 0) {
+      return NGHTTP2_ERR_HEADER_COMP;
+    }
+  }
+
+  if (res.index >= (ssize_t)NGHTTP2_STATIC_TABLE_LENGTH) {
+    DEBUGF("deflatehd: precompiled name match index=%zd\n", res.index);
+
+    return emit_indname_block(bufs, (size_t)res.index, nv, indexing_mode);
+  }
+
+  DEBUGF("deflatehd: emit precompiled %zu bytes\n",
+         pc->encodedlen[indexing_mode]);
+
+  return nghttp2_bufs_add(bufs, pc->encoded[indexing_mode],
+                          pc->encodedlen[indexing_mode]);
+}
+
 static int deflate_nv(nghttp2_hd_deflater *deflater, nghttp2_bufs *bufs,
                       const nghttp2_nv *nv) {
   int rv;
@@ -1347,30 +1467,25 @@ static int deflate_nv(nghttp2_hd_deflater *deflater, nghttp2_bufs *bufs,
   int indexing_mode;
   int32_t token;
   nghttp2_mem *mem;
-  uint32_t hash = 0;
+  uint32_t hash;
+  nghttp2_hd_precompiled *pc;
 
   DEBUGF("deflatehd: deflating %.*s: %.*s\n", (int)nv->namelen, nv->name,
          (int)nv->valuelen, nv->value);
 
+  if (deflater->precompiledlen) {
+    pc = hd_deflate_find_precompiled(deflater, nv);
+    if (pc) {
+      return deflate_precompiled(deflater, bufs, pc, nv);
+    }
+  }
+
   mem = deflater->ctx.mem;
 
   token = lookup_token(nv->name, nv->namelen);
-  if (token == -1) {
-    hash = name_hash(nv);
-  } else if (token <= NGHTTP2_TOKEN_WWW_AUTHENTICATE) {
-    hash = static_table[token].hash;
-  }
+  hash = hd_deflate_hash(nv, token);
 
-  /* Don't index authorization header field since it may contain low
-     entropy secret data (e.g., id/password).  Also cookie header
-     field with less than 20 bytes value is also never indexed.  This
-     is the same criteria used in Firefox codebase. */
-  indexing_mode =
-      token == NGHTTP2_TOKEN_AUTHORIZATION ||
-              (token == NGHTTP2_TOKEN_COOKIE && nv->valuelen < 20) ||
-              (nv->flags & NGHTTP2_NV_FLAG_NO_INDEX)
-          ? NGHTTP2_HD_NEVER_INDEXING
-          : hd_deflate_decide_indexing(deflater, nv, token);
+  indexing_mode = hd_deflate_indexing_mode(deflater, nv, token);
 
   res = search_hd_table(&deflater->ctx, nv, token, indexing_mode,
                         &deflater->map, hash);
@@ -1398,15 +1513,17 @@ static int deflate_nv(nghttp2_hd_deflater *deflater, nghttp2_bufs *bufs,
 
     if (idx != -1) {
       hd_nv.name = nghttp2_hd_table_get(&deflater->ctx, (size_t)idx).name;
-      nghttp2_rcbuf_incref(hd_nv.name);
+      nghttp2_rcbuf_incref_internal(hd_nv.name);
     } else {
-      rv = nghttp2_rcbuf_new2(&hd_nv.name, nv->name, nv->namelen, mem);
+      rv = nghttp2_rcbuf_pool_get2(deflater->ctx.rcbuf_pool, &hd_nv.name,
+                                   nv->name, nv->namelen, mem);
       if (rv != 0) {
         return rv;
       }
     }
 
-    rv = nghttp2_rcbuf_new2(&hd_nv.value, nv->value, nv->valuelen, mem);
+    rv = nghttp2_rcbuf_pool_get2(deflater->ctx.rcbuf_pool, &hd_nv.value,
+                                 nv->value, nv->valuelen, mem);
 
     if (rv != 0) {
       nghttp2_rcbuf_decref(hd_nv.name);
@@ -1437,6 +1554,123 @@ static int deflate_nv(nghttp2_hd_deflater *deflater, nghttp2_bufs *bufs,
   return 0;
 }
 
+static int hd_deflate_precompile(nghttp2_hd_deflater *deflater,
+                                 nghttp2_hd_precompiled *pc,
+                                 const nghttp2_nv *nv) {
+  int rv;
+  int32_t token;
+  nghttp2_bufs bufs;
+  uint8_t *buf;
+  size_t buflen, pos;
+  nghttp2_mem *mem;
+  int i;
+
+  mem = deflater->ctx.mem;
+
+  token = lookup_token(nv->name, nv->namelen);
+
+  pc->hash = hd_deflate_hash(nv, token);
+
+  /* Each integer representation emitted below takes at most 16
+     bytes, and string literal never gets longer by Huffman
+     coding. */
+  buflen = (16 * 3 + nv->namelen + nv->valuelen) * 3;
+  buf = nghttp2_mem_malloc(mem, buflen);
+  if (buf == NULL) {
+    return NGHTTP2_ERR_NOMEM;
+  }
+
+  rv = nghttp2_bufs_wrap_init(&bufs, buf, buflen, mem);
+  if (rv != 0) {
+    nghttp2_mem_free(mem, buf);
+    return rv;
+  }
+
+  for (i = NGHTTP2_HD_WITH_INDEXING; i <= NGHTTP2_HD_NEVER_INDEXING; ++i) {
+    pos = nghttp2_bufs_len(&bufs);
+
+    /* search_static_table() refers to the name by token when the
+       value does not match. */
+    if (token >= 0 && token <= NGHTTP2_TOKEN_WWW_AUTHENTICATE) {
+      rv = emit_indname_block(&bufs, (size_t)token, nv, i);
+    } else {
+      rv = emit_newname_block(&bufs, nv, i);
+    }
+
+    if (rv != 0) {
+      goto fail;
+    }
+
+    pc->encoded[i] = buf + pos;
+    pc->encodedlen[i] = nghttp2_bufs_len(&bufs) - pos;
+  }
+
+  nghttp2_bufs_wrap_free(&bufs);
+
+  rv = nghttp2_rcbuf_new2(&pc->nv.name, nv->name, nv->namelen, mem);
+  if (rv != 0) {
+    nghttp2_mem_free(mem, buf);
+    return rv;
+  }
+
+  rv = nghttp2_rcbuf_new2(&pc->nv.value, nv->value, nv->valuelen, mem);
+  if (rv != 0) {
+    nghttp2_rcbuf_decref(pc->nv.name);
+    nghttp2_mem_free(mem, buf);
+    return rv;
+  }
+
+  pc->nv.token = token;
+  pc->nv.flags = NGHTTP2_NV_FLAG_NONE;
+
+  return 0;
+
+fail:
+  nghttp2_bufs_wrap_free(&bufs);
+  nghttp2_mem_free(mem, buf);
+
+  return rv;
+}
+
+int nghttp2_hd_deflate_add_precompiled(nghttp2_hd_deflater *deflater,
+                                       const nghttp2_nv *nva, size_t nvlen) {
+  int rv;
+  size_t i;
+  nghttp2_hd_precompiled *precompiled;
+  nghttp2_mem *mem;
+
+  if (nvlen > NGHTTP2_HD_MAX_PRECOMPILED - deflater->precompiledlen) {
+    return NGHTTP2_ERR_INVALID_ARGUMENT;
+  }
+
+  if (nvlen == 0) {
+    return 0;
+  }
+
+  mem = deflater->ctx.mem;
+
+  precompiled = nghttp2_mem_realloc(
+      mem, deflater->precompiled,
+      sizeof(nghttp2_hd_precompiled) * (deflater->precompiledlen + nvlen));
+  if (precompiled == NULL) {
+    return NGHTTP2_ERR_NOMEM;
+  }
+
+  deflater->precompiled = precompiled;
+
+  for (i = 0; i < nvlen; ++i) {
+    rv = hd_deflate_precompile(
+        deflater, &deflater->precompiled[deflater->precompiledlen], &nva[i]);
+    if (rv != 0) {
+      return rv;
+    }
+
+    ++deflater->precompiledlen;
+  }
+
+  return 0;
+}
+
 int nghttp2_hd_deflate_hd_bufs(nghttp2_hd_deflater *deflater,
                                nghttp2_bufs *bufs, const nghttp2_nv *nv,
                                size_t nvlen) {
@@ -1811,7 +2045,7 @@ static int hd_inflate_commit_indname(nghttp2_hd_inflater *inflater,
     nv.flags = NGHTTP2_NV_FLAG_NONE;
   }
 
-  nghttp2_rcbuf_incref(nv.name);
+  nghttp2_rcbuf_incref_internal(nv.name);
 
   nv.value = inflater->valuercbuf;
 
@@ -2027,11 +2261,14 @@ ssize_t nghttp2_hd_inflate_hd_nv(nghttp2_hd_inflater *inflater,
 
         inflater->state = NGHTTP2_HD_STATE_NEWNAME_READ_NAMEHUFF;
 
-        rv = nghttp2_rcbuf_new(&inflater->namercbuf, inflater->left * 2 + 1,
-                               mem);
+        rv = nghttp2_rcbuf_pool_get(inflater->ctx.rcbuf_pool,
+                                    &inflater->namercbuf,
+                                    inflater->left * 2 + 1, mem);
       } else {
         inflater->state = NGHTTP2_HD_STATE_NEWNAME_READ_NAME;
-        rv = nghttp2_rcbuf_new(&inflater->namercbuf, inflater->left + 1, mem);
+        rv = nghttp2_rcbuf_pool_get(inflater->ctx.rcbuf_pool,
+                                    &inflater->namercbuf, inflater->left + 1,
+                                    mem);
       }
 
       if (rv != 0) {
@@ -2112,12 +2349,15 @@ ssize_t nghttp2_hd_inflate_hd_nv(nghttp2_hd_inflater *inflater,
 
         inflater->state = NGHTTP2_HD_STATE_READ_VALUEHUFF;
 
-        rv = nghttp2_rcbuf_new(&inflater->valuercbuf, inflater->left * 2 + 1,
-                               mem);
+        rv = nghttp2_rcbuf_pool_get(inflater->ctx.rcbuf_pool,
+                                    &inflater->valuercbuf,
+                                    inflater->left * 2 + 1, mem);
       } else {
         inflater->state = NGHTTP2_HD_STATE_READ_VALUE;
 
-        rv = nghttp2_rcbuf_new(&inflater->valuercbuf, inflater->left + 1, mem);
+        rv = nghttp2_rcbuf_pool_get(inflater->ctx.rcbuf_pool,
+                                    &inflater->valuercbuf, inflater->left + 1,
+                                    mem);
       }
 
       if (rv != 0) {
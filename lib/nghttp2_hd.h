@@ -197,6 +197,9 @@ typedef struct {
   nghttp2_hd_ringbuf hd_table;
   /* Memory allocator */
   nghttp2_mem *mem;
+  /* Freelist of small nghttp2_rcbuf for header field names and
+     values */
+  nghttp2_rcbuf_pool *rcbuf_pool;
   /* Abstract buffer size of hd_table as described in the spec. This
      is the sum of length of name/value in hd_table +
      NGHTTP2_HD_ENTRY_OVERHEAD bytes overhead per each entry. */
@@ -217,9 +220,39 @@ typedef struct {
   nghttp2_hd_entry *table[HD_MAP_SIZE];
 } nghttp2_hd_map;
 
+/* The maximum number of precompiled header fields a deflater can
+   hold.  They are scanned linearly on every header field, so keep
+   this small. */
+#define NGHTTP2_HD_MAX_PRECOMPILED 16
+
+/*
+ * Header field registered by nghttp2_hd_deflate_add_precompiled().
+ * Its literal representations are encoded once, and emitted by copy
+ * afterwards.
+ */
+typedef struct {
+  /* The header field name/value pair.  token is filled as well. */
+  nghttp2_hd_nv nv;
+  /* The literal header field representations of this header field,
+     indexed by nghttp2_hd_indexing_mode.  The indexing mode is
+     decided on each use, in the same way as ordinary header fields.
+     encoded[0] points to the beginning of the buffer which holds all
+     of them.  Their name is indexed by static table if it is there,
+     or literal otherwise.  They never refer to dynamic table, and
+     stay valid for the lifetime of deflater. */
+  uint8_t *encoded[3];
+  size_t encodedlen[3];
+  /* The hash of name used by nghttp2_hd_map. */
+  uint32_t hash;
+} nghttp2_hd_precompiled;
+
 struct nghttp2_hd_deflater {
   nghttp2_hd_context ctx;
   nghttp2_hd_map map;
+  /* Header fields registered by
+     nghttp2_hd_deflate_add_precompiled(). */
+  nghttp2_hd_precompiled *precompiled;
+  size_t precompiledlen;
   /* The upper limit of the header table size the deflater accepts. */
   size_t deflate_hd_table_bufsize_max;
   /* Minimum header table size notified in the next context update */
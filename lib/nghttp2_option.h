@@ -70,6 +70,7 @@ typedef enum {
   NGHTTP2_OPT_MAX_SETTINGS = 1 << 12,
   NGHTTP2_OPT_SERVER_FALLBACK_RFC7540_PRIORITIES = 1 << 13,
   NGHTTP2_OPT_NO_RFC9113_LEADING_AND_TRAILING_WS_VALIDATION = 1 << 14,
+  NGHTTP2_OPT_MAX_RCBUF_FREELIST = 1 << 15,
 } nghttp2_option_flag;
 
 /**
@@ -92,6 +93,10 @@ struct nghttp2_option {
    * NGHTTP2_OPT_MAX_SETTINGS
    */
   size_t max_settings;
+  /**
+   * NGHTTP2_OPT_MAX_RCBUF_FREELIST
+   */
+  size_t max_rcbuf_freelist;
   /**
    * Bitwise OR of nghttp2_option_flag to determine that which fields
    * are specified.
@@ -45,6 +45,8 @@ int nghttp2_rcbuf_new(nghttp2_rcbuf **rcbuf_ptr, size_t size,
   (*rcbuf_ptr)->free = mem->free;
   (*rcbuf_ptr)->base = p + sizeof(nghttp2_rcbuf);
   (*rcbuf_ptr)->len = size;
+  (*rcbuf_ptr)->pool = NULL;
+  (*rcbuf_ptr)->next = NULL;
   (*rcbuf_ptr)->ref = 1;
 
   return 0;
@@ -69,7 +71,163 @@ int nghttp2_rcbuf_new2(nghttp2_rcbuf **rcbuf_ptr, const uint8_t *src,
  * Frees |rcbuf| itself, regardless of its reference cout.
  */
 void nghttp2_rcbuf_del(nghttp2_rcbuf *rcbuf) {
+  nghttp2_rcbuf_pool *pool = rcbuf->pool;
+
+  if (pool == NULL) {
+    nghttp2_mem_free2(rcbuf->free, rcbuf, rcbuf->mem_user_data);
+    return;
+  }
+
+  assert(pool->ref > 0);
+
+  --pool->ref;
+
+  if (!pool->closed && pool->len < pool->max_free) {
+    rcbuf->next = pool->head;
+    pool->head = rcbuf;
+    ++pool->len;
+
+    return;
+  }
+
   nghttp2_mem_free2(rcbuf->free, rcbuf, rcbuf->mem_user_data);
+
+  if (pool->ref == 0) {
+    nghttp2_mem_free2(pool->free, pool, pool->mem_user_data);
+  }
+}
+
+int nghttp2_rcbuf_pool_new(nghttp2_rcbuf_pool **pool_ptr, nghttp2_mem *mem) {
+  nghttp2_rcbuf_pool *pool;
+
+  pool = nghttp2_mem_malloc(mem, sizeof(nghttp2_rcbuf_pool));
+  if (pool == NULL) {
+    return NGHTTP2_ERR_NOMEM;
+  }
+
+  pool->mem_user_data = mem->mem_user_data;
+  pool->free = mem->free;
+  pool->head = NULL;
+  pool->len = 0;
+  pool->max_free = NGHTTP2_RCBUF_POOL_MAX_FREE;
+  pool->ref = 1;
+  pool->closed = 0;
+
+  *pool_ptr = pool;
+
+  return 0;
+}
+
+void nghttp2_rcbuf_pool_set_max_free(nghttp2_rcbuf_pool *pool,
+                                     size_t max_free) {
+  nghttp2_rcbuf *rcbuf;
+
+  pool->max_free = max_free;
+
+  for (; pool->len > max_free; --pool->len) {
+    rcbuf = pool->head;
+    pool->head = rcbuf->next;
+
+    nghttp2_mem_free2(rcbuf->free, rcbuf, rcbuf->mem_user_data);
+  }
+}
+
+void nghttp2_rcbuf_pool_del(nghttp2_rcbuf_pool *pool) {
+  nghttp2_rcbuf *rcbuf, *next;
+
+  if (pool == NULL) {
+    return;
+  }
+
+  for (rcbuf = pool->head; rcbuf;) {
+    next = rcbuf->next;
+    nghttp2_mem_free2(rcbuf->free, rcbuf, rcbuf->mem_user_data);
+    rcbuf = next;
+  }
+
+  pool->head = NULL;
+  pool->len = 0;
+  pool->closed = 1;
+
+  assert(pool->ref > 0);
+
+  if (--pool->ref == 0) {
+    nghttp2_mem_free2(pool->free, pool, pool->mem_user_data);
+  }
+}
+
+int nghttp2_rcbuf_pool_get(nghttp2_rcbuf_pool *pool, nghttp2_rcbuf **rcbuf_ptr,
+                           size_t size, nghttp2_mem *mem) {
+  nghttp2_rcbuf *rcbuf;
+  int rv;
+
+  if (pool == NULL || size > NGHTTP2_RCBUF_POOL_BUFLEN) {
+    return nghttp2_rcbuf_new(rcbuf_ptr, size, mem);
+  }
+
+  if (pool->head) {
+    rcbuf = pool->head;
+    pool->head = rcbuf->next;
+    --pool->len;
+
+    rcbuf->next = NULL;
+    rcbuf->ref = 1;
+  } else {
+    rv = nghttp2_rcbuf_new(&rcbuf, NGHTTP2_RCBUF_POOL_BUFLEN, mem);
+    if (rv != 0) {
+      return rv;
+    }
+
+    rcbuf->pool = pool;
+  }
+
+  rcbuf->len = size;
+
+  ++pool->ref;
+
+  *rcbuf_ptr = rcbuf;
+
+  return 0;
+}
+
+int nghttp2_rcbuf_pool_get2(nghttp2_rcbuf_pool *pool,
+                            nghttp2_rcbuf **rcbuf_ptr, const uint8_t *src,
+                            size_t srclen, nghttp2_mem *mem) {
+  int rv;
+
+  rv = nghttp2_rcbuf_pool_get(pool, rcbuf_ptr, srclen + 1, mem);
+  if (rv != 0) {
+    return rv;
+  }
+
+  (*rcbuf_ptr)->len = srclen;
+  *nghttp2_cpymem((*rcbuf_ptr)->base, src, srclen) = '\0';
+
+  return 0;
+}
+
+void nghttp2_rcbuf_incref_internal(nghttp2_rcbuf *rcbuf) {
+  if (rcbuf->ref == -1) {
+    return;
+  }
+
+  ++rcbuf->ref;
+}
+
+/*
+ * Detaches |rcbuf| from its pool, so that it is freed by memory
+ * allocator rather than returned to the freelist.
+ */
+static void rcbuf_detach(nghttp2_rcbuf *rcbuf) {
+  nghttp2_rcbuf_pool *pool = rcbuf->pool;
+
+  rcbuf->pool = NULL;
+
+  assert(pool->ref > 0);
+
+  if (--pool->ref == 0) {
+    nghttp2_mem_free2(pool->free, pool, pool->mem_user_data);
+  }
 }
 
 void nghttp2_rcbuf_incref(nghttp2_rcbuf *rcbuf) {
@@ -77,6 +235,12 @@ void nghttp2_rcbuf_incref(nghttp2_rcbuf *rcbuf) {
     return;
   }
 
+  /* Application may release the retained rcbuf in another thread.
+     The freelist of pool is not thread-safe. */
+  if (rcbuf->pool) {
+    rcbuf_detach(rcbuf);
+  }
+
   ++rcbuf->ref;
 }
 
@@ -31,6 +31,16 @@
 
 #include <nghttp2/nghttp2.h>
 
+/* The buffer size of nghttp2_rcbuf allocated from
+   nghttp2_rcbuf_pool.  Most header field names and values fit in
+   it. */
+#define NGHTTP2_RCBUF_POOL_BUFLEN 64
+/* The default maximum number of nghttp2_rcbuf objects
+   nghttp2_rcbuf_pool keeps in its freelist. */
+#define NGHTTP2_RCBUF_POOL_MAX_FREE 128
+
+typedef struct nghttp2_rcbuf_pool nghttp2_rcbuf_pool;
+
 struct nghttp2_rcbuf {
   /* custom memory allocator belongs to the mem parameter when
      creating this object. */
@@ -42,6 +52,40 @@ struct nghttp2_rcbuf {
   size_t len;
   /* Reference count */
   int32_t ref;
+  /* The pool this object was allocated from.  NULL if it was
+     allocated directly from memory allocator. */
+  nghttp2_rcbuf_pool *pool;
+  /* The next object in freelist of pool. */
+  nghttp2_rcbuf *next;
+};
+
+/*
+ * nghttp2_rcbuf_pool keeps released small nghttp2_rcbuf objects, and
+ * reuses them for subsequent allocations, so that short header field
+ * names and values do not hit memory allocator every time.  Objects
+ * handed out from the pool may outlive its owner, because the
+ * library keeps some of them until it finishes with them.  The pool
+ * is freed when both owner and all outstanding objects have released
+ * it.  The objects which application retains with
+ * nghttp2_rcbuf_incref() are detached from the pool.
+ */
+struct nghttp2_rcbuf_pool {
+  /* custom memory allocator belongs to the mem parameter when
+     creating this object. */
+  void *mem_user_data;
+  nghttp2_free free;
+  /* The head of freelist */
+  nghttp2_rcbuf *head;
+  /* The number of objects in freelist */
+  size_t len;
+  /* The maximum number of objects kept in freelist */
+  size_t max_free;
+  /* The number of objects allocated from this pool and not returned
+     to freelist yet, plus 1 if owner is alive. */
+  size_t ref;
+  /* Nonzero if owner has released this pool by
+     nghttp2_rcbuf_pool_del(). */
+  int closed;
 };
 
 /*
@@ -77,4 +121,67 @@ int nghttp2_rcbuf_new2(nghttp2_rcbuf **rcbuf_ptr, const uint8_t *src,
  */
 void nghttp2_rcbuf_del(nghttp2_rcbuf *rcbuf);
 
+/*
+ * Increments the reference count of |rcbuf| by 1.  Unlike
+ * nghttp2_rcbuf_incref(), which application calls, |rcbuf| stays in
+ * its pool.  The library uses this function to refer to |rcbuf| in
+ * the thread which owns the pool.
+ */
+void nghttp2_rcbuf_incref_internal(nghttp2_rcbuf *rcbuf);
+
+/*
+ * Allocates nghttp2_rcbuf_pool object.
+ *
+ * This function returns 0 if it succeeds, or one of the following
+ * negative error codes:
+ *
+ * NGHTTP2_ERR_NOMEM:
+ *     Out of memory.
+ */
+int nghttp2_rcbuf_pool_new(nghttp2_rcbuf_pool **pool_ptr, nghttp2_mem *mem);
+
+/*
+ * Sets the maximum number of objects |pool| keeps in its freelist to
+ * |max_free|.  The objects exceeding the new limit are freed.  If
+ * |max_free| is 0, released objects are always freed.
+ */
+void nghttp2_rcbuf_pool_set_max_free(nghttp2_rcbuf_pool *pool,
+                                     size_t max_free);
+
+/*
+ * Releases owner's reference to |pool|, and frees objects in its
+ * freelist.  |pool| itself is freed when the last outstanding
+ * nghttp2_rcbuf allocated from it is freed.  |pool| may be NULL.
+ */
+void nghttp2_rcbuf_pool_del(nghttp2_rcbuf_pool *pool);
+
+/*
+ * Like nghttp2_rcbuf_new(), but allocates nghttp2_rcbuf from |pool|
+ * if |size| is less than or equal to NGHTTP2_RCBUF_POOL_BUFLEN.
+ * Otherwise, or if |pool| is NULL, this function is equivalent to
+ * nghttp2_rcbuf_new().
+ *
+ * This function returns 0 if it succeeds, or one of the following
+ * negative error codes:
+ *
+ * NGHTTP2_ERR_NOMEM:
+ *     Out of memory.
+ */
+int nghttp2_rcbuf_pool_get(nghttp2_rcbuf_pool *pool, nghttp2_rcbuf **rcbuf_ptr,
+                           size_t size, nghttp2_mem *mem);
+
+/*
+ * Like nghttp2_rcbuf_new2(), but allocates nghttp2_rcbuf in the same
+ * way as nghttp2_rcbuf_pool_get().
+ *
+ * This function returns 0 if it succeeds, or one of the following
+ * negative error codes:
+ *
+ * NGHTTP2_ERR_NOMEM:
+ *     Out of memory.
+ */
+int nghttp2_rcbuf_pool_get2(nghttp2_rcbuf_pool *pool,
+                            nghttp2_rcbuf **rcbuf_ptr, const uint8_t *src,
+                            size_t srclen, nghttp2_mem *mem);
+
 #endif /* NGHTTP2_RCBUF_H */
@@ -584,6 +584,13 @@ static int session_new(nghttp2_session **session_ptr,
   if (rv != 0) {
     goto fail_hd_inflater;
   }
+
+  if (option && (option->opt_set_mask & NGHTTP2_OPT_MAX_RCBUF_FREELIST)) {
+    nghttp2_rcbuf_pool_set_max_free((*session_ptr)->hd_deflater.ctx.rcbuf_pool,
+                                    option->max_rcbuf_freelist);
+    nghttp2_rcbuf_pool_set_max_free((*session_ptr)->hd_inflater.ctx.rcbuf_pool,
+                                    option->max_rcbuf_freelist);
+  }
   rv = nghttp2_map_init(&(*session_ptr)->streams, mem);
   if (rv != 0) {
     goto fail_map;
@@ -782,6 +789,142 @@ static void inflight_settings_del(nghttp2_inflight_settings *settings,
   nghttp2_mem_free(mem, settings);
 }
 
+/*
+ * Releases the references to rcbuf held for the events delivered by
+ * the last call of nghttp2_session_mem_recv_events().  The array
+ * passed by application is not accessed.
+ */
+static void session_recv_events_release(nghttp2_session *session) {
+  nghttp2_recv_events *recv_events = &session->recv_events;
+  size_t i;
+
+  for (i = 0; i < recv_events->refslen; ++i) {
+    nghttp2_rcbuf_decref(recv_events->refs[i]);
+  }
+
+  recv_events->refslen = 0;
+}
+
+/*
+ * Releases all resources held by |session|->recv_events, including
+ * the events queued but not delivered yet.
+ */
+static void session_recv_events_free(nghttp2_session *session) {
+  nghttp2_recv_events *recv_events = &session->recv_events;
+  nghttp2_mem *mem = &session->mem;
+  nghttp2_event *ev;
+  size_t i;
+
+  session_recv_events_release(session);
+
+  for (i = recv_events->pendingoff; i < recv_events->pendinglen; ++i) {
+    ev = &recv_events->pending[i];
+
+    if (ev->type != NGHTTP2_EVENT_HEADER) {
+      continue;
+    }
+
+    nghttp2_rcbuf_decref(ev->data.header.name);
+    nghttp2_rcbuf_decref(ev->data.header.value);
+  }
+
+  nghttp2_mem_free(mem, recv_events->refs);
+  nghttp2_mem_free(mem, recv_events->pending);
+}
+
+/*
+ * Returns nonzero if nghttp2_session_mem_recv_events() is running,
+ * and the number of free event slots is less than |n|.
+ */
+static int session_recv_events_short(nghttp2_session *session, size_t n) {
+  nghttp2_recv_events *recv_events = &session->recv_events;
+
+  return recv_events->active && recv_events->cap - recv_events->len < n;
+}
+
+/*
+ * Appends new event of type |type| for |stream_id|, and assigns it
+ * to |*pev|.  If events are not being recorded, |*pev| is set to
+ * NULL, and the caller has to invoke the callback instead.  If there
+ * is no room left in the array passed by application, the event is
+ * queued in session, and delivered by the next call.
+ *
+ * This function returns 0 if it succeeds, or one of the following
+ * negative error codes:
+ *
+ * NGHTTP2_ERR_NOMEM
+ *     Out of memory.
+ */
+static int session_recv_events_add(nghttp2_session *session,
+                                   nghttp2_event **pev,
+                                   nghttp2_event_type type,
+                                   int32_t stream_id) {
+  nghttp2_recv_events *recv_events = &session->recv_events;
+  nghttp2_mem *mem = &session->mem;
+  nghttp2_event *ev, *pending;
+  size_t pendingcap;
+
+  if (!recv_events->active) {
+    *pev = NULL;
+    return 0;
+  }
+
+  if (recv_events->len < recv_events->cap) {
+    ev = &recv_events->events[recv_events->len++];
+  } else {
+    /* DATA chunk points to the input buffer which is not valid after
+       the call returns.  The reserve check before reading DATA
+       payload makes sure that it never overflows. */
+    assert(type != NGHTTP2_EVENT_DATA_CHUNK_RECV);
+
+    if (recv_events->pendinglen == recv_events->pendingcap) {
+      pendingcap = nghttp2_max(8, recv_events->pendingcap * 2);
+      pending = nghttp2_mem_realloc(mem, recv_events->pending,
+                                    sizeof(nghttp2_event) * pendingcap);
+      if (pending == NULL) {
+        return NGHTTP2_ERR_NOMEM;
+      }
+
+      recv_events->pending = pending;
+      recv_events->pendingcap = pendingcap;
+    }
+
+    ev = &recv_events->pending[recv_events->pendinglen++];
+  }
+
+  ev->type = type;
+  ev->stream_id = stream_id;
+
+  *pev = ev;
+
+  return 0;
+}
+
+/*
+ * Copies |frame| to |dest|.  The pointers to the memory which is
+ * freed after |frame| is processed are set to NULL.
+ */
+static void session_recv_events_copy_frame(nghttp2_session *session,
+                                           nghttp2_frame *dest,
+                                           const nghttp2_frame *frame) {
+  *dest = *frame;
+
+  switch (frame->hd.type) {
+  case NGHTTP2_SETTINGS:
+    dest->settings.iv = NULL;
+    break;
+  case NGHTTP2_GOAWAY:
+    dest->goaway.opaque_data = NULL;
+    break;
+  default:
+    if (frame->hd.type > NGHTTP2_CONTINUATION &&
+        frame->ext.payload == &session->iframe.ext_frame_payload) {
+      dest->ext.payload = NULL;
+    }
+    break;
+  }
+}
+
 void nghttp2_session_del(nghttp2_session *session) {
   nghttp2_mem *mem;
   nghttp2_inflight_settings *settings;
@@ -793,6 +936,8 @@ void nghttp2_session_del(nghttp2_session *session) {
 
   mem = &session->mem;
 
+  session_recv_events_free(session);
+
   for (settings = session->inflight_settings_head; settings;) {
     nghttp2_inflight_settings *next = settings->next;
     inflight_settings_del(settings, mem);
@@ -1465,6 +1610,7 @@ int nghttp2_session_close_stream(nghttp2_session *session, int32_t stream_id,
   nghttp2_stream *stream;
   nghttp2_mem *mem;
   int is_my_stream_id;
+  nghttp2_event *ev;
 
   mem = &session->mem;
   stream = nghttp2_session_get_stream(session, stream_id);
@@ -1503,7 +1649,16 @@ int nghttp2_session_close_stream(nghttp2_session *session, int32_t stream_id,
      hang the stream in a local endpoint.
   */
 
-  if (session->callbacks.on_stream_close_callback) {
+  rv = session_recv_events_add(session, &ev, NGHTTP2_EVENT_STREAM_CLOSE,
+                               stream_id);
+  if (rv != 0) {
+    return rv;
+  }
+
+  if (ev) {
+    ev->data.stream_close.error_code = error_code;
+    ev->data.stream_close.stream_user_data = stream->stream_user_data;
+  } else if (session->callbacks.on_stream_close_callback) {
     if (session->callbacks.on_stream_close_callback(
             session, stream_id, error_code, session->user_data) != 0) {
 
@@ -3259,6 +3414,75 @@ static int session_call_send_data(nghttp2_session *session,
   }
 }
 
+static void session_add_send_data_batch(nghttp2_session *session,
+                                        nghttp2_outbound_item *item,
+                                        nghttp2_bufs *framebufs) {
+  nghttp2_send_data_batch *batch = &session->send_data_batch;
+  nghttp2_send_data_entry *entry;
+  nghttp2_frame *frame;
+
+  assert(batch->len < NGHTTP2_MAX_SEND_DATA_BATCH);
+
+  frame = &item->frame;
+  entry = &batch->entries[batch->len++];
+
+  entry->frame = frame->data;
+  memcpy(entry->framehd, framebufs->cur->buf.pos, NGHTTP2_FRAME_HDLEN);
+  entry->length = frame->hd.length - frame->data.padlen;
+  /* item is freed when the stream reaches EOF, so take a copy. */
+  entry->source = item->aux_data.data.data_prd.source;
+}
+
+static int session_send_data_batch_has_stream(nghttp2_session *session,
+                                              int32_t stream_id) {
+  nghttp2_send_data_batch *batch = &session->send_data_batch;
+  size_t i;
+
+  for (i = 0; i < batch->len; ++i) {
+    if (batch->entries[i].frame.hd.stream_id == stream_id) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Passes DATA frames collected so far to send_data_batch_callback.
+ * This function returns 0 if it succeeds, or one of the following
+ * negative error codes:
+ *
+ * NGHTTP2_ERR_PAUSE
+ *     Application asked to return from nghttp2_session_mem_send().
+ * NGHTTP2_ERR_CALLBACK_FAILURE
+ *     The callback function failed.
+ */
+static int session_flush_send_data_batch(nghttp2_session *session) {
+  nghttp2_send_data_batch *batch = &session->send_data_batch;
+  size_t len;
+  int rv;
+
+  if (batch->len == 0) {
+    return 0;
+  }
+
+  DEBUGF("send: flush %zu no copy DATA\n", batch->len);
+
+  len = batch->len;
+  batch->len = 0;
+
+  rv = session->callbacks.send_data_batch_callback(session, batch->entries, len,
+                                                   session->user_data);
+
+  switch (rv) {
+  case 0:
+  case NGHTTP2_ERR_PAUSE:
+    return rv;
+  default:
+    return NGHTTP2_ERR_CALLBACK_FAILURE;
+  }
+}
+
 static ssize_t nghttp2_session_mem_send_internal(nghttp2_session *session,
                                                  const uint8_t **data_ptr,
                                                  int fast_cb) {
@@ -3284,13 +3508,44 @@ static ssize_t nghttp2_session_mem_send_internal(nghttp2_session *session,
     case NGHTTP2_OB_POP_ITEM: {
       nghttp2_outbound_item *item;
 
+      if (session->send_data_batch.len) {
+        /* Batched DATA frames must go out before the other frames,
+           which may close their streams.  We also flush them before
+           asking the data source of the same stream for more data,
+           so that application sees its buffer as it was in
+           nghttp2_send_data_callback. */
+        item = nghttp2_session_get_next_ob_item(session);
+        if (item == NULL || item->frame.hd.type != NGHTTP2_DATA ||
+            session_send_data_batch_has_stream(session,
+                                               item->frame.hd.stream_id)) {
+          rv = session_flush_send_data_batch(session);
+          if (nghttp2_is_fatal(rv)) {
+            return rv;
+          }
+
+          if (rv == NGHTTP2_ERR_PAUSE) {
+            return 0;
+          }
+        }
+      }
+
       item = nghttp2_session_pop_next_ob_item(session);
       if (item == NULL) {
+        rv = session_flush_send_data_batch(session);
+        if (nghttp2_is_fatal(rv)) {
+          return rv;
+        }
+
         return 0;
       }
 
       rv = session_prep_frame(session, item);
       if (rv == NGHTTP2_ERR_PAUSE) {
+        rv = session_flush_send_data_batch(session);
+        if (nghttp2_is_fatal(rv)) {
+          return rv;
+        }
+
         return 0;
       }
       if (rv == NGHTTP2_ERR_DEFERRED) {
@@ -3451,6 +3706,17 @@ static ssize_t nghttp2_session_mem_send_internal(nghttp2_session *session,
       size_t datalen;
       nghttp2_buf *buf;
 
+      if (session->send_data_batch.len) {
+        rv = session_flush_send_data_batch(session);
+        if (nghttp2_is_fatal(rv)) {
+          return rv;
+        }
+
+        if (rv == NGHTTP2_ERR_PAUSE) {
+          return 0;
+        }
+      }
+
       buf = &framebufs->cur->buf;
 
       if (buf->pos == buf->last) {
@@ -3504,9 +3770,25 @@ static ssize_t nghttp2_session_mem_send_internal(nghttp2_session *session,
         break;
       }
 
-      rv = session_call_send_data(session, aob->item, framebufs);
-      if (nghttp2_is_fatal(rv)) {
-        return rv;
+      if (session->callbacks.send_data_batch_callback) {
+        session_add_send_data_batch(session, aob->item, framebufs);
+
+        rv = 0;
+
+        /* Stream is closed in session_after_frame_sent1() if
+           END_STREAM is set. */
+        if ((frame->hd.flags & NGHTTP2_FLAG_END_STREAM) ||
+            session->send_data_batch.len == NGHTTP2_MAX_SEND_DATA_BATCH) {
+          rv = session_flush_send_data_batch(session);
+          if (nghttp2_is_fatal(rv)) {
+            return rv;
+          }
+        }
+      } else {
+        rv = session_call_send_data(session, aob->item, framebufs);
+        if (nghttp2_is_fatal(rv)) {
+          return rv;
+        }
       }
 
       if (rv == NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE) {
@@ -3649,6 +3931,18 @@ static ssize_t session_recv(nghttp2_session *session, uint8_t *buf,
 static int session_call_on_begin_frame(nghttp2_session *session,
                                        const nghttp2_frame_hd *hd) {
   int rv;
+  nghttp2_event *ev;
+
+  rv = session_recv_events_add(session, &ev, NGHTTP2_EVENT_BEGIN_FRAME,
+                               hd->stream_id);
+  if (rv != 0) {
+    return rv;
+  }
+
+  if (ev) {
+    ev->data.hd = *hd;
+    return 0;
+  }
 
   if (session->callbacks.on_begin_frame_callback) {
 
@@ -3666,6 +3960,19 @@ static int session_call_on_begin_frame(nghttp2_session *session,
 static int session_call_on_frame_received(nghttp2_session *session,
                                           nghttp2_frame *frame) {
   int rv;
+  nghttp2_event *ev;
+
+  rv = session_recv_events_add(session, &ev, NGHTTP2_EVENT_FRAME_RECV,
+                               frame->hd.stream_id);
+  if (rv != 0) {
+    return rv;
+  }
+
+  if (ev) {
+    session_recv_events_copy_frame(session, &ev->data.frame, frame);
+    return 0;
+  }
+
   if (session->callbacks.on_frame_recv_callback) {
     rv = session->callbacks.on_frame_recv_callback(session, frame,
                                                    session->user_data);
@@ -3679,8 +3986,21 @@ static int session_call_on_frame_received(nghttp2_session *session,
 static int session_call_on_begin_headers(nghttp2_session *session,
                                          nghttp2_frame *frame) {
   int rv;
+  nghttp2_event *ev;
   DEBUGF("recv: call on_begin_headers callback stream_id=%d\n",
          frame->hd.stream_id);
+
+  rv = session_recv_events_add(session, &ev, NGHTTP2_EVENT_BEGIN_HEADERS,
+                               frame->hd.stream_id);
+  if (rv != 0) {
+    return rv;
+  }
+
+  if (ev) {
+    session_recv_events_copy_frame(session, &ev->data.frame, frame);
+    return 0;
+  }
+
   if (session->callbacks.on_begin_headers_callback) {
     rv = session->callbacks.on_begin_headers_callback(session, frame,
                                                       session->user_data);
@@ -3698,6 +4018,43 @@ static int session_call_on_header(nghttp2_session *session,
                                   const nghttp2_frame *frame,
                                   const nghttp2_hd_nv *nv) {
   int rv = 0;
+  nghttp2_event *ev;
+
+  rv = session_recv_events_add(session, &ev, NGHTTP2_EVENT_HEADER,
+                               frame->hd.stream_id);
+  if (rv != 0) {
+    return rv;
+  }
+
+  if (ev) {
+    nghttp2_header_event *hev = &ev->data.header;
+
+    hev->name = nv->name;
+    hev->value = nv->value;
+    hev->frame_type = frame->hd.type;
+    hev->flags = nv->flags;
+
+    if (frame->hd.type == NGHTTP2_PUSH_PROMISE) {
+      hev->promised_stream_id = frame->push_promise.promised_stream_id;
+      hev->cat = NGHTTP2_HCAT_REQUEST;
+    } else {
+      hev->promised_stream_id = 0;
+      hev->cat = frame->headers.cat;
+    }
+
+    nghttp2_rcbuf_incref_internal(nv->name);
+    nghttp2_rcbuf_incref_internal(nv->value);
+
+    /* Keep room for FRAME_RECV and STREAM_CLOSE which might follow
+       the end of header block. */
+    if (session_recv_events_short(session,
+                                  NGHTTP2_RECV_EVENTS_CHUNK_RESERVE)) {
+      return NGHTTP2_ERR_PAUSE;
+    }
+
+    return 0;
+  }
+
   if (session->callbacks.on_header_callback2) {
     rv = session->callbacks.on_header_callback2(
         session, frame, nv->name, nv->value, nv->flags, session->user_data);
@@ -4056,6 +4413,13 @@ static int inflate_header_block(nghttp2_session *session, nghttp2_frame *frame,
         }
         if (rv == 0) {
           rv = session_call_on_header(session, frame, &nv);
+          if (rv == NGHTTP2_ERR_PAUSE && inlen == 0 &&
+              session->recv_events.active) {
+            /* No more header field can be emitted from this chunk.
+               Keep going so that the end of header block is
+               processed in this call. */
+            rv = 0;
+          }
           /* This handles NGHTTP2_ERR_PAUSE and
              NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE as well */
           if (rv != 0) {
@@ -5878,6 +6242,7 @@ ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *in,
   nghttp2_stream *stream;
   size_t pri_fieldlen;
   nghttp2_mem *mem;
+  nghttp2_event *ev;
 
   if (in == NULL) {
     assert(inlen == 0);
@@ -5964,6 +6329,12 @@ ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *in,
 
       DEBUGF("recv: [IB_READ_HEAD]\n");
 
+      if (nghttp2_buf_len(&iframe->sbuf) == 0 &&
+          session_recv_events_short(session,
+                                    NGHTTP2_RECV_EVENTS_FRAME_RESERVE)) {
+        return in - first;
+      }
+
       readlen = inbound_frame_buf_read(iframe, in, last);
       in += readlen;
 
@@ -6959,6 +7330,12 @@ ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *in,
       }
 #endif /* DEBUGBUILD */
 
+      if (nghttp2_buf_len(&iframe->sbuf) == 0 &&
+          session_recv_events_short(session,
+                                    NGHTTP2_RECV_EVENTS_FRAME_RESERVE)) {
+        return in - first;
+      }
+
       readlen = inbound_frame_buf_read(iframe, in, last);
       in += readlen;
 
@@ -7075,6 +7452,11 @@ ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *in,
 
       break;
     case NGHTTP2_IB_READ_DATA:
+      if (session_recv_events_short(session,
+                                    NGHTTP2_RECV_EVENTS_CHUNK_RESERVE)) {
+        return in - first;
+      }
+
       stream = nghttp2_session_get_stream(session, iframe->frame.hd.stream_id);
 
       if (!stream) {
@@ -7166,7 +7548,18 @@ ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *in,
               break;
             }
           }
-          if (session->callbacks.on_data_chunk_recv_callback) {
+          rv = session_recv_events_add(session, &ev,
+                                       NGHTTP2_EVENT_DATA_CHUNK_RECV,
+                                       iframe->frame.hd.stream_id);
+          if (rv != 0) {
+            return rv;
+          }
+
+          if (ev) {
+            ev->data.data_chunk.data = in - readlen;
+            ev->data.data_chunk.len = (size_t)data_readlen;
+            ev->data.data_chunk.flags = iframe->frame.hd.flags;
+          } else if (session->callbacks.on_data_chunk_recv_callback) {
             rv = session->callbacks.on_data_chunk_recv_callback(
                 session, iframe->frame.hd.flags, iframe->frame.hd.stream_id,
                 in - readlen, (size_t)data_readlen, session->user_data);
@@ -7354,6 +7747,109 @@ ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *in,
   return in - first;
 }
 
+/*
+ * Moves the events queued by the previous calls to the array passed
+ * by application as many as it can hold.
+ */
+static void session_recv_events_deliver_pending(nghttp2_session *session) {
+  nghttp2_recv_events *recv_events = &session->recv_events;
+  size_t n;
+
+  n = nghttp2_min(recv_events->cap,
+                  recv_events->pendinglen - recv_events->pendingoff);
+
+  memcpy(recv_events->events, recv_events->pending + recv_events->pendingoff,
+         sizeof(nghttp2_event) * n);
+
+  recv_events->len = n;
+  recv_events->pendingoff += n;
+
+  if (recv_events->pendingoff == recv_events->pendinglen) {
+    recv_events->pendingoff = 0;
+    recv_events->pendinglen = 0;
+  }
+}
+
+/*
+ * Takes the references to rcbuf carried by HEADER events delivered
+ * to application, so that they can be released without accessing
+ * the array passed by application.
+ */
+static void session_recv_events_hold(nghttp2_session *session) {
+  nghttp2_recv_events *recv_events = &session->recv_events;
+  nghttp2_event *ev;
+  size_t i;
+
+  for (i = 0; i < recv_events->len; ++i) {
+    ev = &recv_events->events[i];
+
+    if (ev->type != NGHTTP2_EVENT_HEADER) {
+      continue;
+    }
+
+    assert(recv_events->refslen + 2 <= recv_events->refscap);
+
+    recv_events->refs[recv_events->refslen++] = ev->data.header.name;
+    recv_events->refs[recv_events->refslen++] = ev->data.header.value;
+  }
+}
+
+ssize_t nghttp2_session_mem_recv_events(nghttp2_session *session,
+                                        const uint8_t *in, size_t inlen,
+                                        nghttp2_event *events,
+                                        size_t *pnevents) {
+  nghttp2_recv_events *recv_events = &session->recv_events;
+  nghttp2_mem *mem = &session->mem;
+  nghttp2_rcbuf **refs;
+  ssize_t rv;
+
+  if (*pnevents < NGHTTP2_MIN_RECV_EVENTS) {
+    return NGHTTP2_ERR_INVALID_ARGUMENT;
+  }
+
+  session_recv_events_release(session);
+
+  /* Each HEADER event carries 2 references. */
+  if (recv_events->refscap < *pnevents * 2) {
+    refs = nghttp2_mem_realloc(mem, recv_events->refs,
+                               sizeof(nghttp2_rcbuf *) * *pnevents * 2);
+    if (refs == NULL) {
+      return NGHTTP2_ERR_NOMEM;
+    }
+
+    recv_events->refs = refs;
+    recv_events->refscap = *pnevents * 2;
+  }
+
+  recv_events->events = events;
+  recv_events->len = 0;
+  recv_events->cap = *pnevents;
+
+  session_recv_events_deliver_pending(session);
+
+  if (recv_events->pendinglen) {
+    /* Still more events to deliver.  Do not process input until all
+       of them are delivered in order. */
+    rv = 0;
+  } else {
+    recv_events->active = 1;
+
+    rv = nghttp2_session_mem_recv(session, in, inlen);
+
+    recv_events->active = 0;
+  }
+
+  session_recv_events_hold(session);
+
+  *pnevents = recv_events->len;
+
+  recv_events->events = NULL;
+  recv_events->len = 0;
+  recv_events->cap = 0;
+
+  return rv;
+}
+
 int nghttp2_session_recv(nghttp2_session *session) {
   uint8_t buf[NGHTTP2_INBOUND_BUFFER_LENGTH];
   while (1) {
@@ -7788,7 +8284,8 @@ int nghttp2_session_pack_data(nghttp2_session *session, nghttp2_bufs *bufs,
   }
 
   if (data_flags & NGHTTP2_DATA_FLAG_NO_COPY) {
-    if (session->callbacks.send_data_callback == NULL) {
+    if (session->callbacks.send_data_callback == NULL &&
+        session->callbacks.send_data_batch_callback == NULL) {
       DEBUGF("NGHTTP2_DATA_FLAG_NO_COPY requires send_data_callback set\n");
 
       return NGHTTP2_ERR_CALLBACK_FAILURE;
@@ -8388,6 +8885,12 @@ nghttp2_session_get_hd_deflate_dynamic_table_size(nghttp2_session *session) {
   return nghttp2_hd_deflate_get_dynamic_table_size(&session->hd_deflater);
 }
 
+int nghttp2_session_add_precompiled_headers(nghttp2_session *session,
+                                            const nghttp2_nv *nva,
+                                            size_t nvlen) {
+  return nghttp2_hd_deflate_add_precompiled(&session->hd_deflater, nva, nvlen);
+}
+
 void nghttp2_session_set_user_data(nghttp2_session *session, void *user_data) {
   session->user_data = user_data;
 }
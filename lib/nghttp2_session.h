@@ -105,6 +105,56 @@ typedef struct {
 /* The default value of maximum number of concurrent streams. */
 #define NGHTTP2_DEFAULT_MAX_CONCURRENT_STREAMS 0xffffffffu
 
+/* The number of free event slots required to start processing a new
+   frame in nghttp2_session_mem_recv_events().  A frame records at
+   most BEGIN_FRAME, BEGIN_HEADERS, one HEADER or DATA_CHUNK_RECV,
+   FRAME_RECV and STREAM_CLOSE before it can be paused. */
+#define NGHTTP2_RECV_EVENTS_FRAME_RESERVE 5
+
+/* The number of free event slots required to record another HEADER
+   or DATA_CHUNK_RECV event.  The last 2 slots are kept for FRAME_RECV
+   and STREAM_CLOSE. */
+#define NGHTTP2_RECV_EVENTS_CHUNK_RESERVE 3
+
+/* Storage of events recorded by nghttp2_session_mem_recv_events() */
+typedef struct {
+  /* The array passed by application.  It is only valid while
+     |active| is nonzero. */
+  nghttp2_event *events;
+  /* The number of events recorded in |events|. */
+  size_t len;
+  /* The number of elements |events| can hold. */
+  size_t cap;
+  /* The references to rcbuf carried by HEADER events which were
+     delivered to application by the last call.  They are released
+     on the next call, or when session is deleted. */
+  nghttp2_rcbuf **refs;
+  /* The number of references in |refs|. */
+  size_t refslen;
+  /* The number of elements |refs| can hold. */
+  size_t refscap;
+  /* The events which did not fit in |events|.  They are delivered in
+     order before any new event on the next call.  HEADER events in
+     this queue own their references to rcbuf. */
+  nghttp2_event *pending;
+  /* The index of the first undelivered event in |pending|. */
+  size_t pendingoff;
+  /* The number of events in |pending|, including delivered ones. */
+  size_t pendinglen;
+  /* The number of elements |pending| can hold. */
+  size_t pendingcap;
+  /* Nonzero while nghttp2_session_mem_recv_events() is running.
+     Events are only recorded while this is nonzero. */
+  uint8_t active;
+} nghttp2_recv_events;
+
+/* DATA frames collected for nghttp2_send_data_batch_callback */
+typedef struct {
+  nghttp2_send_data_entry entries[NGHTTP2_MAX_SEND_DATA_BATCH];
+  /* The number of entries collected so far */
+  size_t len;
+} nghttp2_send_data_batch;
+
 /* Internal state when receiving incoming frame */
 typedef enum {
   /* Receiving frame header */
@@ -215,6 +265,8 @@ struct nghttp2_session {
   nghttp2_hd_deflater hd_deflater;
   nghttp2_hd_inflater hd_inflater;
   nghttp2_session_callbacks callbacks;
+  nghttp2_recv_events recv_events;
+  nghttp2_send_data_batch send_data_batch;
   /* Memory allocator */
   nghttp2_mem mem;
   void *user_data;
@@ -40,9 +40,11 @@ struct iovec {
 
 #include <cassert>
 #include <cstring>
+#include <new>
 #include <memory>
 #include <array>
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <utility>
 
@@ -58,17 +60,21 @@ namespace nghttp2 {
 #  define MAX_WR_IOVCNT DEFAULT_WR_IOVCNT
 #endif // !defined(IOV_MAX) || IOV_MAX >= DEFAULT_WR_IOVCNT
 
+template <typename T> struct Pool;
+
 template <size_t N> struct Memchunk {
   Memchunk(Memchunk *next_chunk)
       : pos(std::begin(buf)), last(pos), knext(next_chunk), next(nullptr) {}
   size_t len() const { return last - pos; }
   size_t left() const { return std::end(buf) - last; }
   void reset() { pos = last = std::begin(buf); }
+  uint8_t *begin() { return std::begin(buf); }
   std::array<uint8_t, N> buf;
   uint8_t *pos, *last;
   Memchunk *knext;
   Memchunk *next;
   static const size_t size = N;
+  using pool_type = Pool<Memchunk>;
 };
 
 template <typename T> struct Pool {
@@ -80,46 +86,276 @@ template <typename T> struct Pool {
       freelist = freelist->next;
       m->next = nullptr;
       m->reset();
-      freelistsize -= T::size;
+      freelistsize.store(freelistsize.load(std::memory_order_relaxed) -
+                             T::size,
+                         std::memory_order_relaxed);
       return m;
     }
 
     pool = new T{pool};
-    poolsize += T::size;
+    poolsize.store(poolsize.load(std::memory_order_relaxed) + T::size,
+                   std::memory_order_relaxed);
     return pool;
   }
+  // Pool has only one chunk size, and |size_hint| is ignored.
+  T *get(size_t size_hint) { return get(); }
   void recycle(T *m) {
     m->next = freelist;
     freelist = m;
-    freelistsize += T::size;
+    freelistsize.store(freelistsize.load(std::memory_order_relaxed) + T::size,
+                       std::memory_order_relaxed);
   }
   void clear() {
     freelist = nullptr;
-    freelistsize = 0;
+    freelistsize.store(0, std::memory_order_relaxed);
     for (auto p = pool; p;) {
       auto knext = p->knext;
       delete p;
       p = knext;
     }
     pool = nullptr;
-    poolsize = 0;
+    poolsize.store(0, std::memory_order_relaxed);
   }
   using value_type = T;
   T *pool;
   T *freelist;
-  size_t poolsize;
-  size_t freelistsize;
+  // Only the thread which owns this object modifies poolsize and
+  // freelistsize.  They are atomic so that the other threads can
+  // read them for statistics.
+  std::atomic<size_t> poolsize;
+  std::atomic<size_t> freelistsize;
+};
+
+// The buffer sizes of SizedMemchunk in ascending order.  Memchunks
+// picks one of them for each chunk from the amount of data it has
+// buffered recently.
+constexpr std::array<size_t, 4> MEMCHUNK_SIZE_CLASSES{1_k, 4_k, 16_k, 64_k};
+
+// The size class used when the size of data is not known in advance.
+constexpr size_t MEMCHUNK_DEFAULT_SIZE_CLASS = 2;
+
+// Returns the index of the smallest size class which can hold |size|
+// bytes.  If |size| exceeds the largest size class, the largest one
+// is returned.
+inline size_t memchunk_size_class(size_t size) {
+  for (size_t i = 0; i < MEMCHUNK_SIZE_CLASSES.size() - 1; ++i) {
+    if (size <= MEMCHUNK_SIZE_CLASSES[i]) {
+      return i;
+    }
+  }
+  return MEMCHUNK_SIZE_CLASSES.size() - 1;
+}
+
+struct SizedMemchunkPool;
+
+// SizedMemchunk is a Memchunk whose buffer size is one of
+// MEMCHUNK_SIZE_CLASSES.  The buffer immediately follows this object
+// in the same allocation.  Use create() and destroy() to allocate
+// and free it.  Unlike Memchunk, the list of allocated chunks is
+// doubly linked so that SizedMemchunkPool can free any chunk.
+struct SizedMemchunk {
+  SizedMemchunk(SizedMemchunk *next_chunk, size_t size_class)
+      : pos(begin()),
+        last(pos),
+        knext(next_chunk),
+        kprev(nullptr),
+        next(nullptr),
+        size(MEMCHUNK_SIZE_CLASSES[size_class]),
+        size_class(size_class) {}
+  static SizedMemchunk *create(SizedMemchunk *next_chunk, size_t size_class) {
+    auto p = ::operator new(sizeof(SizedMemchunk) +
+                            MEMCHUNK_SIZE_CLASSES[size_class]);
+    return new (p) SizedMemchunk(next_chunk, size_class);
+  }
+  static void destroy(SizedMemchunk *m) {
+    m->~SizedMemchunk();
+    ::operator delete(m);
+  }
+  size_t len() const { return last - pos; }
+  size_t left() const { return end() - last; }
+  void reset() { pos = last = begin(); }
+  uint8_t *begin() { return reinterpret_cast<uint8_t *>(this + 1); }
+  const uint8_t *begin() const {
+    return reinterpret_cast<const uint8_t *>(this + 1);
+  }
+  const uint8_t *end() const { return begin() + size; }
+  uint8_t *pos, *last;
+  SizedMemchunk *knext, *kprev;
+  SizedMemchunk *next;
+  size_t size;
+  size_t size_class;
+  using pool_type = SizedMemchunkPool;
+};
+
+// The interval in seconds at which the owner of SizedMemchunkPool
+// calls trim().
+constexpr auto MCPOOL_TRIM_INTERVAL = 10_s;
+
+// SizedMemchunkPool is a Pool of SizedMemchunk.  It keeps a freelist
+// per size class.  The unused chunks are bounded by watermarks: a
+// chunk recycled while freelistsize is at high_watermark is freed
+// immediately, and trim() frees the unused chunks above
+// low_watermark.
+struct SizedMemchunkPool {
+  SizedMemchunkPool()
+      : pool(nullptr),
+        freelist{},
+        high_watermark(0),
+        low_watermark(0),
+        freelist_min(0),
+        poolsize(0),
+        freelistsize(0),
+        chunks{},
+        free_chunks{},
+        trimmed(0) {}
+  ~SizedMemchunkPool() { clear(); }
+  // Returns a chunk of the default size class.
+  SizedMemchunk *get() {
+    return get(MEMCHUNK_SIZE_CLASSES[MEMCHUNK_DEFAULT_SIZE_CLASS]);
+  }
+  // Returns a chunk of the smallest size class which can hold
+  // |size_hint| bytes.
+  SizedMemchunk *get(size_t size_hint) {
+    auto cls = memchunk_size_class(size_hint);
+    auto size = MEMCHUNK_SIZE_CLASSES[cls];
+    auto &fl = freelist[cls];
+
+    if (fl) {
+      auto m = fl;
+      fl = fl->next;
+      m->next = nullptr;
+      m->reset();
+      sub(freelistsize, size);
+      sub(free_chunks[cls], 1);
+      freelist_min =
+          std::min(freelist_min, freelistsize.load(std::memory_order_relaxed));
+      return m;
+    }
+
+    auto m = SizedMemchunk::create(pool, cls);
+    if (pool) {
+      pool->kprev = m;
+    }
+    pool = m;
+    add(poolsize, size);
+    add(chunks[cls], 1);
+    return m;
+  }
+  void recycle(SizedMemchunk *m) {
+    if (high_watermark &&
+        freelistsize.load(std::memory_order_relaxed) + m->size >
+            high_watermark) {
+      add(trimmed, m->size);
+      destroy(m);
+      return;
+    }
+    auto &fl = freelist[m->size_class];
+    m->next = fl;
+    fl = m;
+    add(freelistsize, m->size);
+    add(free_chunks[m->size_class], 1);
+  }
+  // Frees the unused chunks which have not been used since the last
+  // call of this function, leaving at least low_watermark bytes of
+  // unused chunks.  The larger chunks are freed first.  This function is
+  // intended to be called periodically.  It returns the number of
+  // bytes freed.
+  size_t trim() {
+    auto fsize = freelistsize.load(std::memory_order_relaxed);
+    auto idle = std::min(freelist_min, fsize);
+    size_t nfreed = 0;
+
+    if (idle > low_watermark) {
+      auto excess = idle - low_watermark;
+      for (size_t i = MEMCHUNK_SIZE_CLASSES.size(); i > 0 && nfreed < excess;
+           --i) {
+        auto &fl = freelist[i - 1];
+        for (; fl && nfreed + fl->size <= excess;) {
+          auto m = fl;
+          fl = fl->next;
+          nfreed += m->size;
+          sub(freelistsize, m->size);
+          sub(free_chunks[i - 1], 1);
+          destroy(m);
+        }
+      }
+      add(trimmed, nfreed);
+    }
+
+    freelist_min = freelistsize.load(std::memory_order_relaxed);
+
+    return nfreed;
+  }
+  void clear() {
+    freelist.fill(nullptr);
+    for (auto p = pool; p;) {
+      auto knext = p->knext;
+      SizedMemchunk::destroy(p);
+      p = knext;
+    }
+    pool = nullptr;
+    freelist_min = 0;
+    poolsize.store(0, std::memory_order_relaxed);
+    freelistsize.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < MEMCHUNK_SIZE_CLASSES.size(); ++i) {
+      chunks[i].store(0, std::memory_order_relaxed);
+      free_chunks[i].store(0, std::memory_order_relaxed);
+    }
+  }
+  // Removes |m| from the list of allocated chunks, and frees it.  |m|
+  // must not be in freelist.
+  void destroy(SizedMemchunk *m) {
+    if (m->kprev) {
+      m->kprev->knext = m->knext;
+    } else {
+      pool = m->knext;
+    }
+    if (m->knext) {
+      m->knext->kprev = m->kprev;
+    }
+    sub(poolsize, m->size);
+    sub(chunks[m->size_class], 1);
+    SizedMemchunk::destroy(m);
+  }
+  template <typename T> static void add(std::atomic<T> &c, size_t n) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+  template <typename T> static void sub(std::atomic<T> &c, size_t n) {
+    c.store(c.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+  }
+  using value_type = SizedMemchunk;
+  SizedMemchunk *pool;
+  std::array<SizedMemchunk *, MEMCHUNK_SIZE_CLASSES.size()> freelist;
+  // The maximum number of bytes of unused chunks.  0 means no limit.
+  size_t high_watermark;
+  // The number of bytes of unused chunks which trim() leaves.
+  size_t low_watermark;
+  // The smallest freelistsize since the last trim().
+  size_t freelist_min;
+  // The counters below follow the same rule as Pool::poolsize and
+  // Pool::freelistsize.  poolsize and freelistsize are in bytes.
+  std::atomic<size_t> poolsize;
+  std::atomic<size_t> freelistsize;
+  // The number of chunks allocated, and the number of them in
+  // freelist, per size class.
+  std::array<std::atomic<size_t>, MEMCHUNK_SIZE_CLASSES.size()> chunks;
+  std::array<std::atomic<size_t>, MEMCHUNK_SIZE_CLASSES.size()> free_chunks;
+  // The number of bytes of unused chunks freed because of the
+  // watermarks.
+  std::atomic<uint64_t> trimmed;
 };
 
 template <typename Memchunk> struct Memchunks {
-  Memchunks(Pool<Memchunk> *pool)
+  Memchunks(typename Memchunk::pool_type *pool)
       : pool(pool),
         head(nullptr),
         tail(nullptr),
         len(0),
         mark(nullptr),
         mark_pos(nullptr),
-        mark_offset(0) {}
+        mark_offset(0),
+        chunk_hint(0),
+        peak(0) {}
   Memchunks(const Memchunks &) = delete;
   Memchunks(Memchunks &&other) noexcept
       : pool{other.pool}, // keep other.pool
@@ -128,7 +364,9 @@ template <typename Memchunk> struct Memchunks {
         len{std::exchange(other.len, 0)},
         mark{std::exchange(other.mark, nullptr)},
         mark_pos{std::exchange(other.mark_pos, nullptr)},
-        mark_offset{std::exchange(other.mark_offset, 0)} {}
+        mark_offset{std::exchange(other.mark_offset, 0)},
+        chunk_hint{other.chunk_hint},
+        peak{std::exchange(other.peak, 0)} {}
   Memchunks &operator=(const Memchunks &) = delete;
   Memchunks &operator=(Memchunks &&other) noexcept {
     if (this == &other) {
@@ -144,6 +382,8 @@ template <typename Memchunk> struct Memchunks {
     mark = std::exchange(other.mark, nullptr);
     mark_pos = std::exchange(other.mark_pos, nullptr);
     mark_offset = std::exchange(other.mark_offset, 0);
+    chunk_hint = other.chunk_hint;
+    peak = std::exchange(other.peak, 0);
 
     return *this;
   }
@@ -157,15 +397,41 @@ template <typename Memchunk> struct Memchunks {
       m = next;
     }
   }
+  // Returns a new chunk to append |count| bytes.  Its size is chosen
+  // from |count| and chunk_hint.  If the chain is not empty, the size
+  // grows geometrically so that a large body is stored in fewer
+  // chunks.
+  Memchunk *get_chunk(size_t count) {
+    auto size_hint = std::max(count, chunk_hint);
+    if (tail) {
+      size_hint = std::max(size_hint, tail->size * 2);
+    }
+    return pool->get(size_hint);
+  }
+  // Records the amount of data buffered so far.  This must be called
+  // when len increases.
+  void update_peak() { peak = std::max(peak, len); }
+  // Updates chunk_hint from the amount of data buffered since this
+  // object was empty last time.  This must be called when the chain
+  // becomes empty.
+  void update_chunk_hint() {
+    if (peak == 0) {
+      return;
+    }
+    chunk_hint =
+        (chunk_hint + std::min(peak, MEMCHUNK_SIZE_CLASSES.back())) / 2;
+    peak = 0;
+  }
   size_t append(char c) {
     if (!tail) {
-      head = tail = pool->get();
+      head = tail = get_chunk(1);
     } else if (tail->left() == 0) {
-      tail->next = pool->get();
+      tail->next = get_chunk(1);
       tail = tail->next;
     }
     *tail->last++ = c;
     ++len;
+    update_peak();
     return 1;
   }
   size_t append(const void *src, size_t count) {
@@ -177,7 +443,7 @@ template <typename Memchunk> struct Memchunks {
     auto last = first + count;
 
     if (!tail) {
-      head = tail = pool->get();
+      head = tail = get_chunk(count);
     }
 
     for (;;) {
@@ -189,10 +455,12 @@ template <typename Memchunk> struct Memchunks {
         break;
       }
 
-      tail->next = pool->get();
+      tail->next = get_chunk(last - first);
       tail = tail->next;
     }
 
+    update_peak();
+
     return count;
   }
   template <size_t N> size_t append(const char (&s)[N]) {
@@ -240,6 +508,7 @@ template <typename Memchunk> struct Memchunks {
     head = m;
     if (head == nullptr) {
       tail = nullptr;
+      update_chunk_hint();
     }
 
     return first - static_cast<uint8_t *>(dest);
@@ -272,6 +541,7 @@ template <typename Memchunk> struct Memchunks {
     head = m;
     if (head == nullptr) {
       tail = nullptr;
+      update_chunk_hint();
     }
 
     return count - left;
@@ -294,9 +564,11 @@ template <typename Memchunk> struct Memchunks {
 
     dest.tail = tail;
     dest.len += len;
+    dest.update_peak();
 
     head = tail = nullptr;
     len = 0;
+    update_chunk_hint();
 
     return n;
   }
@@ -321,6 +593,48 @@ template <typename Memchunk> struct Memchunks {
     head = m;
     if (head == nullptr) {
       tail = nullptr;
+      update_chunk_hint();
+    }
+    return ndata - count;
+  }
+  // Drains |count| bytes like drain(), but moves the chunks which
+  // are completely drained to |dest| instead of recycling them.  The
+  // chunks moved to |dest| have no data.  This is useful when the
+  // drained memory must be kept intact for a while, e.g., until the
+  // kernel finishes sending it with MSG_ZEROCOPY.  The head chunk
+  // which is partially drained stays in this object.  If this object
+  // is destroyed before the memory can be reused, drain the rest of
+  // data with this function so that all chunks are moved to |dest|.
+  size_t drain_pin(size_t count, Memchunks &dest) {
+    assert(pool == dest.pool);
+    assert(mark == nullptr);
+
+    auto ndata = count;
+    auto m = head;
+    while (m) {
+      auto next = m->next;
+      auto n = std::min(count, m->len());
+      m->pos += n;
+      count -= n;
+      len -= n;
+      if (m->len() > 0) {
+        break;
+      }
+
+      m->next = nullptr;
+      if (dest.tail) {
+        dest.tail->next = m;
+      } else {
+        dest.head = m;
+      }
+      dest.tail = m;
+
+      m = next;
+    }
+    head = m;
+    if (head == nullptr) {
+      tail = nullptr;
+      update_chunk_hint();
     }
     return ndata - count;
   }
@@ -353,6 +667,7 @@ template <typename Memchunk> struct Memchunks {
     head = m;
     if (head == nullptr) {
       tail = nullptr;
+      update_chunk_hint();
     }
     return ndata - count;
   }
@@ -413,19 +728,25 @@ template <typename Memchunk> struct Memchunks {
     head = tail = mark = nullptr;
     mark_pos = nullptr;
     mark_offset = 0;
+    update_chunk_hint();
   }
 
-  Pool<Memchunk> *pool;
+  typename Memchunk::pool_type *pool;
   Memchunk *head, *tail;
   size_t len;
   Memchunk *mark;
   uint8_t *mark_pos;
   size_t mark_offset;
+  // The size of chunk which Memchunks requests to pool when it has no
+  // chunk.  It is a moving average of peak.
+  size_t chunk_hint;
+  // The largest len since this object was empty last time.
+  size_t peak;
 };
 
 // Wrapper around Memchunks to offer "peeking" functionality.
 template <typename Memchunk> struct PeekMemchunks {
-  PeekMemchunks(Pool<Memchunk> *pool)
+  PeekMemchunks(typename Memchunk::pool_type *pool)
       : memchunks(pool),
         cur(nullptr),
         cur_pos(nullptr),
@@ -544,9 +865,9 @@ template <typename Memchunk> struct PeekMemchunks {
 };
 
 using Memchunk16K = Memchunk<16_k>;
-using MemchunkPool = Pool<Memchunk16K>;
-using DefaultMemchunks = Memchunks<Memchunk16K>;
-using DefaultPeekMemchunks = PeekMemchunks<Memchunk16K>;
+using MemchunkPool = SizedMemchunkPool;
+using DefaultMemchunks = Memchunks<SizedMemchunk>;
+using DefaultPeekMemchunks = PeekMemchunks<SizedMemchunk>;
 
 inline int limit_iovec(struct iovec *iov, int iovcnt, size_t max) {
   if (max == 0) {
@@ -566,7 +887,8 @@ inline int limit_iovec(struct iovec *iov, int iovcnt, size_t max) {
 // MemchunkBuffer is similar to Buffer, but it uses pooled Memchunk
 // for its underlying buffer.
 template <typename Memchunk> struct MemchunkBuffer {
-  MemchunkBuffer(Pool<Memchunk> *pool) : pool(pool), chunk(nullptr) {}
+  MemchunkBuffer(typename Memchunk::pool_type *pool)
+      : pool(pool), chunk(nullptr) {}
   MemchunkBuffer(const MemchunkBuffer &) = delete;
   MemchunkBuffer(MemchunkBuffer &&other) noexcept
       : pool(other.pool), chunk(other.chunk) {
@@ -643,21 +965,21 @@ template <typename Memchunk> struct MemchunkBuffer {
   }
   size_t drain_reset(size_t count) {
     count = std::min(count, rleft());
-    std::copy(chunk->pos + count, chunk->last, std::begin(chunk->buf));
-    chunk->last = std::begin(chunk->buf) + (chunk->last - (chunk->pos + count));
-    chunk->pos = std::begin(chunk->buf);
+    std::copy(chunk->pos + count, chunk->last, chunk->begin());
+    chunk->last = chunk->begin() + (chunk->last - (chunk->pos + count));
+    chunk->pos = chunk->begin();
     return count;
   }
   void reset() { chunk->reset(); }
-  uint8_t *begin() { return std::begin(chunk->buf); }
-  uint8_t &operator[](size_t n) { return chunk->buf[n]; }
-  const uint8_t &operator[](size_t n) const { return chunk->buf[n]; }
+  uint8_t *begin() { return chunk->begin(); }
+  uint8_t &operator[](size_t n) { return chunk->begin()[n]; }
+  const uint8_t &operator[](size_t n) const { return chunk->begin()[n]; }
 
-  Pool<Memchunk> *pool;
+  typename Memchunk::pool_type *pool;
   Memchunk *chunk;
 };
 
-using DefaultMemchunkBuffer = MemchunkBuffer<Memchunk16K>;
+using DefaultMemchunkBuffer = MemchunkBuffer<SizedMemchunk>;
 
 } // namespace nghttp2
 
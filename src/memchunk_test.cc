@@ -34,7 +34,7 @@
 namespace nghttp2 {
 
 void test_pool_recycle(void) {
-  MemchunkPool pool;
+  Pool<Memchunk16K> pool;
 
   CU_ASSERT(!pool.pool);
   CU_ASSERT(0 == pool.poolsize);
@@ -43,13 +43,13 @@ void test_pool_recycle(void) {
   auto m1 = pool.get();
 
   CU_ASSERT(m1 == pool.pool);
-  CU_ASSERT(MemchunkPool::value_type::size == pool.poolsize);
+  CU_ASSERT(Memchunk16K::size == pool.poolsize);
   CU_ASSERT(nullptr == pool.freelist);
 
   auto m2 = pool.get();
 
   CU_ASSERT(m2 == pool.pool);
-  CU_ASSERT(2 * MemchunkPool::value_type::size == pool.poolsize);
+  CU_ASSERT(2 * Memchunk16K::size == pool.poolsize);
   CU_ASSERT(nullptr == pool.freelist);
   CU_ASSERT(m1 == m2->knext);
   CU_ASSERT(nullptr == m1->knext);
@@ -57,20 +57,20 @@ void test_pool_recycle(void) {
   auto m3 = pool.get();
 
   CU_ASSERT(m3 == pool.pool);
-  CU_ASSERT(3 * MemchunkPool::value_type::size == pool.poolsize);
+  CU_ASSERT(3 * Memchunk16K::size == pool.poolsize);
   CU_ASSERT(nullptr == pool.freelist);
 
   pool.recycle(m3);
 
   CU_ASSERT(m3 == pool.pool);
-  CU_ASSERT(3 * MemchunkPool::value_type::size == pool.poolsize);
+  CU_ASSERT(3 * Memchunk16K::size == pool.poolsize);
   CU_ASSERT(m3 == pool.freelist);
 
   auto m4 = pool.get();
 
   CU_ASSERT(m3 == m4);
   CU_ASSERT(m4 == pool.pool);
-  CU_ASSERT(3 * MemchunkPool::value_type::size == pool.poolsize);
+  CU_ASSERT(3 * Memchunk16K::size == pool.poolsize);
   CU_ASSERT(nullptr == pool.freelist);
 
   pool.recycle(m2);
@@ -81,6 +81,165 @@ void test_pool_recycle(void) {
   CU_ASSERT(nullptr == m2->next);
 }
 
+void test_sized_memchunk_pool(void) {
+  MemchunkPool pool;
+
+  CU_ASSERT(0 == memchunk_size_class(0));
+  CU_ASSERT(0 == memchunk_size_class(1_k));
+  CU_ASSERT(1 == memchunk_size_class(1_k + 1));
+  CU_ASSERT(3 == memchunk_size_class(64_k));
+  CU_ASSERT(3 == memchunk_size_class(1024_k));
+
+  auto m1 = pool.get(300);
+
+  CU_ASSERT(1_k == m1->size);
+  CU_ASSERT(1_k == m1->left());
+  CU_ASSERT(1_k == pool.poolsize);
+  CU_ASSERT(1 == pool.chunks[0]);
+
+  auto m2 = pool.get();
+
+  CU_ASSERT(16_k == m2->size);
+  CU_ASSERT(17_k == pool.poolsize);
+  CU_ASSERT(1 == pool.chunks[2]);
+
+  pool.recycle(m1);
+
+  CU_ASSERT(1_k == pool.freelistsize);
+  CU_ASSERT(1 == pool.free_chunks[0]);
+  CU_ASSERT(m1 == pool.freelist[0]);
+
+  // A chunk is not reused for the other size class.
+  auto m3 = pool.get(4_k);
+
+  CU_ASSERT(m1 != m3);
+  CU_ASSERT(4_k == m3->size);
+  CU_ASSERT(21_k == pool.poolsize);
+
+  auto m4 = pool.get(1);
+
+  CU_ASSERT(m1 == m4);
+  CU_ASSERT(0 == pool.freelistsize);
+  CU_ASSERT(0 == pool.free_chunks[0]);
+
+  pool.recycle(m2);
+  pool.recycle(m3);
+  pool.recycle(m4);
+
+  CU_ASSERT(pool.poolsize == pool.freelistsize);
+
+  pool.clear();
+
+  CU_ASSERT(0 == pool.poolsize);
+  CU_ASSERT(0 == pool.chunks[2]);
+  CU_ASSERT(nullptr == pool.freelist[0]);
+}
+
+void test_sized_memchunk_pool_trim(void) {
+  MemchunkPool pool;
+  pool.high_watermark = 64_k;
+  pool.low_watermark = 4_k;
+
+  std::array<SizedMemchunk *, 4> m;
+  for (auto &p : m) {
+    p = pool.get(16_k);
+  }
+  auto m64 = pool.get(64_k);
+
+  CU_ASSERT(128_k == pool.poolsize);
+
+  for (auto p : m) {
+    pool.recycle(p);
+  }
+
+  CU_ASSERT(64_k == pool.freelistsize);
+  CU_ASSERT(4 == pool.free_chunks[2]);
+
+  // The chunk above high watermark is freed immediately.
+  pool.recycle(m64);
+
+  CU_ASSERT(64_k == pool.poolsize);
+  CU_ASSERT(64_k == pool.freelistsize);
+  CU_ASSERT(64_k == pool.trimmed);
+  CU_ASSERT(0 == pool.chunks[3]);
+
+  // The first trim only records the unused chunks.
+  CU_ASSERT(0 == pool.trim());
+
+  // Chunks used since the last trim are kept.
+  pool.recycle(pool.get(16_k));
+  pool.recycle(pool.get(16_k));
+
+  CU_ASSERT(32_k == pool.trim());
+  CU_ASSERT(32_k == pool.poolsize);
+  CU_ASSERT(32_k == pool.freelistsize);
+  CU_ASSERT(2 == pool.chunks[2]);
+  CU_ASSERT(96_k == pool.trimmed);
+
+  CU_ASSERT(16_k == pool.trim());
+  CU_ASSERT(16_k == pool.poolsize);
+
+  // A chunk is not freed if it makes the unused chunks less than low
+  // watermark.
+  CU_ASSERT(0 == pool.trim());
+  CU_ASSERT(16_k == pool.freelistsize);
+
+  pool.low_watermark = 0;
+
+  CU_ASSERT(16_k == pool.trim());
+  CU_ASSERT(0 == pool.poolsize);
+  CU_ASSERT(nullptr == pool.pool);
+  CU_ASSERT(nullptr == pool.freelist[2]);
+}
+
+void test_memchunks_size_class(void) {
+  MemchunkPool pool;
+  DefaultMemchunks chunks(&pool);
+  std::array<uint8_t, 100_k> buf{};
+
+  // The first chunk fits the first data.
+  chunks.append("hello");
+
+  CU_ASSERT(1_k == chunks.head->size);
+
+  // The chunk size grows while data is appended.
+  chunks.append(buf.data(), 1_k);
+
+  CU_ASSERT(4_k == chunks.tail->size);
+
+  chunks.append(buf.data(), 8_k);
+
+  CU_ASSERT(16_k == chunks.tail->size);
+
+  chunks.reset();
+
+  // A large data goes into the largest chunks.
+  chunks.append(buf.data(), buf.size());
+
+  CU_ASSERT(64_k == chunks.head->size);
+  CU_ASSERT(64_k == chunks.tail->size);
+
+  chunks.drain(chunks.rleft());
+
+  // The next chunk is chosen from the amount of data buffered
+  // before.
+  chunks.append("hello");
+
+  CU_ASSERT(64_k == chunks.head->size);
+
+  chunks.reset();
+
+  // Small transfers make chunk smaller.
+  for (size_t i = 0; i < 8; ++i) {
+    chunks.append("hello");
+    chunks.drain(chunks.rleft());
+  }
+
+  chunks.append("hello");
+
+  CU_ASSERT(1_k == chunks.head->size);
+}
+
 using Memchunk16 = Memchunk<16>;
 using MemchunkPool16 = Pool<Memchunk16>;
 using Memchunks16 = Memchunks<Memchunk16>;
@@ -147,11 +306,51 @@ void test_memchunks_drain(void) {
   CU_ASSERT(0 == memcmp("3456789", buf, nread));
 }
 
+void test_memchunks_drain_pin(void) {
+  MemchunkPool16 pool;
+  Memchunks16 chunks(&pool);
+  Memchunks16 pinned(&pool);
+
+  char buf[2 * 16 + 8]{};
+
+  chunks.append(buf, sizeof(buf));
+
+  CU_ASSERT(3 * 16 == pool.poolsize);
+
+  auto m = chunks.head;
+
+  auto nread = chunks.drain_pin(20, pinned);
+
+  CU_ASSERT(20 == nread);
+  CU_ASSERT(20 == chunks.rleft());
+  CU_ASSERT(m == pinned.head);
+  CU_ASSERT(m == pinned.tail);
+  CU_ASSERT(nullptr == m->next);
+  CU_ASSERT(0 == pinned.rleft());
+  // Pinned chunk is not recycled.
+  CU_ASSERT(0 == pool.freelistsize);
+
+  nread = chunks.drain_pin(100, pinned);
+
+  CU_ASSERT(20 == nread);
+  CU_ASSERT(0 == chunks.rleft());
+  CU_ASSERT(nullptr == chunks.head);
+  CU_ASSERT(nullptr == chunks.tail);
+  CU_ASSERT(m == pinned.head);
+  CU_ASSERT(m != pinned.tail);
+  CU_ASSERT(pinned.tail == m->next->next);
+  CU_ASSERT(0 == pool.freelistsize);
+
+  pinned.reset();
+
+  CU_ASSERT(3 * 16 == pool.freelistsize);
+}
+
 void test_memchunks_riovec(void) {
   MemchunkPool16 pool;
   Memchunks16 chunks(&pool);
 
-  char buf[3 * 16];
+  char buf[3 * 16]{};
 
   chunks.append(buf, sizeof(buf));
 
@@ -184,7 +383,7 @@ void test_memchunks_recycle(void) {
   MemchunkPool16 pool;
   {
     Memchunks16 chunks(&pool);
-    char buf[32];
+    char buf[32]{};
     chunks.append(buf, sizeof(buf));
   }
   CU_ASSERT(32 == pool.poolsize);
@@ -32,8 +32,12 @@
 namespace nghttp2 {
 
 void test_pool_recycle(void);
+void test_sized_memchunk_pool(void);
+void test_sized_memchunk_pool_trim(void);
+void test_memchunks_size_class(void);
 void test_memchunks_append(void);
 void test_memchunks_drain(void);
+void test_memchunks_drain_pin(void);
 void test_memchunks_riovec(void);
 void test_memchunks_recycle(void);
 void test_memchunks_reset(void);
@@ -34,6 +34,18 @@
 #include "shrpx_downstream_test.h"
 #include "shrpx_config_test.h"
 #include "shrpx_worker_test.h"
+#include "shrpx_response_cache_test.h"
+#include "shrpx_collapsed_request_test.h"
+#include "shrpx_compressor_test.h"
+#include "shrpx_log_writer_test.h"
+#include "shrpx_binlog_test.h"
+#include "shrpx_metrics_test.h"
+#include "shrpx_backend_load_test.h"
+#include "shrpx_maglev_test.h"
+#include "shrpx_splice_pipe_test.h"
+#include "shrpx_zerocopy_test.h"
+#include "shrpx_io_uring_test.h"
+#include "shrpx_http2_backend_io_test.h"
 #include "http2_test.h"
 #include "util_test.h"
 #include "nghttp2_gzip_test.h"
@@ -119,16 +131,94 @@ int main(int argc, char *argv[]) {
                    shrpx::test_downstream_supports_non_final_response) ||
       !CU_add_test(pSuite, "downstream_find_affinity_cookie",
                    shrpx::test_downstream_find_affinity_cookie) ||
+      !CU_add_test(pSuite, "downstream_drain_compressed_response_body",
+                   shrpx::test_downstream_drain_compressed_response_body) ||
       !CU_add_test(pSuite, "config_parse_header",
                    shrpx::test_shrpx_config_parse_header) ||
       !CU_add_test(pSuite, "config_parse_log_format",
                    shrpx::test_shrpx_config_parse_log_format) ||
+      !CU_add_test(pSuite, "config_parse_cpu_list",
+                   shrpx::test_shrpx_config_parse_cpu_list) ||
       !CU_add_test(pSuite, "config_read_tls_ticket_key_file",
                    shrpx::test_shrpx_config_read_tls_ticket_key_file) ||
       !CU_add_test(pSuite, "config_read_tls_ticket_key_file_aes_256",
                    shrpx::test_shrpx_config_read_tls_ticket_key_file_aes_256) ||
       !CU_add_test(pSuite, "worker_match_downstream_addr_group",
                    shrpx::test_shrpx_worker_match_downstream_addr_group) ||
+      !CU_add_test(pSuite, "worker_compute_worker_load",
+                   shrpx::test_shrpx_worker_compute_worker_load) ||
+      !CU_add_test(pSuite, "worker_same_backend_addr",
+                   shrpx::test_shrpx_worker_same_backend_addr) ||
+      !CU_add_test(pSuite, "worker_replace_downstream_config",
+                   shrpx::test_shrpx_worker_replace_downstream_config) ||
+      !CU_add_test(
+          pSuite, "worker_maintain_idle_backend_connections",
+          shrpx::test_shrpx_worker_maintain_idle_backend_connections) ||
+      !CU_add_test(pSuite, "response_cache_freshness_lifetime",
+                   shrpx::test_shrpx_response_cache_freshness_lifetime) ||
+      !CU_add_test(pSuite, "response_cache_lookup",
+                   shrpx::test_shrpx_response_cache_lookup) ||
+      !CU_add_test(pSuite, "collapsed_request",
+                   shrpx::test_shrpx_collapsed_request) ||
+      !CU_add_test(pSuite, "collapsed_request_followers",
+                   shrpx::test_shrpx_collapsed_request_followers) ||
+      !CU_add_test(pSuite, "compressor_accept_gzip",
+                   shrpx::test_shrpx_compressor_accept_gzip) ||
+      !CU_add_test(pSuite, "compressor_mime_type_match",
+                   shrpx::test_shrpx_compressor_mime_type_match) ||
+      !CU_add_test(pSuite, "compressor_eligible",
+                   shrpx::test_shrpx_compressor_eligible) ||
+      !CU_add_test(pSuite, "compressor_compress",
+                   shrpx::test_shrpx_compressor_compress) ||
+      !CU_add_test(pSuite, "log_writer_ring",
+                   shrpx::test_shrpx_log_writer_ring) ||
+      !CU_add_test(pSuite, "log_writer", shrpx::test_shrpx_log_writer) ||
+      !CU_add_test(pSuite, "binlog_format_text",
+                   shrpx::test_shrpx_binlog_format_text) ||
+      !CU_add_test(pSuite, "binlog_format_json",
+                   shrpx::test_shrpx_binlog_format_json) ||
+      !CU_add_test(pSuite, "binlog_decode_record",
+                   shrpx::test_shrpx_binlog_decode_record) ||
+      !CU_add_test(pSuite, "binlog_file_header",
+                   shrpx::test_shrpx_binlog_file_header) ||
+      !CU_add_test(pSuite, "metrics_latency_histogram",
+                   shrpx::test_shrpx_metrics_latency_histogram) ||
+      !CU_add_test(pSuite, "metrics_copy_backend_stat",
+                   shrpx::test_shrpx_metrics_copy_backend_stat) ||
+      !CU_add_test(pSuite, "metrics_format",
+                   shrpx::test_shrpx_metrics_format) ||
+      !CU_add_test(pSuite, "backend_load_ewma",
+                   shrpx::test_shrpx_backend_load_ewma) ||
+      !CU_add_test(pSuite, "backend_load_select_p2c",
+                   shrpx::test_shrpx_backend_load_select_p2c) ||
+      !CU_add_test(pSuite, "maglev_table_size",
+                   shrpx::test_shrpx_maglev_table_size) ||
+      !CU_add_test(pSuite, "maglev_compute_table",
+                   shrpx::test_shrpx_maglev_compute_table) ||
+      !CU_add_test(pSuite, "splice_pipe_pool",
+                   shrpx::test_shrpx_splice_pipe_pool) ||
+      !CU_add_test(pSuite, "zerocopy_tracker",
+                   shrpx::test_shrpx_zerocopy_tracker) ||
+      !CU_add_test(pSuite, "io_uring_buffer_ring",
+                   shrpx::test_shrpx_io_uring_buffer_ring) ||
+      !CU_add_test(pSuite, "io_uring_socket_read",
+                   shrpx::test_shrpx_io_uring_socket_read) ||
+      !CU_add_test(pSuite, "io_uring_socket_write",
+                   shrpx::test_shrpx_io_uring_socket_write) ||
+      !CU_add_test(pSuite, "io_uring_socket_linger",
+                   shrpx::test_shrpx_io_uring_socket_linger) ||
+      !CU_add_test(pSuite, "io_uring_accept_cancel",
+                   shrpx::test_shrpx_io_uring_accept_cancel) ||
+      !CU_add_test(pSuite, "http2_backend_io_buffer",
+                   shrpx::test_shrpx_http2_backend_io_buffer) ||
+      !CU_add_test(pSuite, "http2_backend_io_trim",
+                   shrpx::test_shrpx_http2_backend_io_trim) ||
+      !CU_add_test(pSuite, "http2_backend_io_commands",
+                   shrpx::test_shrpx_http2_backend_io_commands) ||
+      !CU_add_test(pSuite, "http2_backend_io_peer",
+                   shrpx::test_shrpx_http2_backend_io_peer) ||
+      !CU_add_test(pSuite, "http2_backend_io_keep_idle",
+                   shrpx::test_shrpx_http2_backend_io_keep_idle) ||
       !CU_add_test(pSuite, "http_create_forwarded",
                    shrpx::test_shrpx_http_create_forwarded) ||
       !CU_add_test(pSuite, "http_create_via_header_value",
@@ -144,6 +234,10 @@ int main(int argc, char *argv[]) {
                    shrpx::test_shrpx_router_match_wildcard) ||
       !CU_add_test(pSuite, "router_match_prefix",
                    shrpx::test_shrpx_router_match_prefix) ||
+      !CU_add_test(pSuite, "router_compile",
+                   shrpx::test_shrpx_router_compile) ||
+      !CU_add_test(pSuite, "router_match_many_routes",
+                   shrpx::test_shrpx_router_match_many_routes) ||
       !CU_add_test(pSuite, "util_streq", shrpx::test_util_streq) ||
       !CU_add_test(pSuite, "util_strieq", shrpx::test_util_strieq) ||
       !CU_add_test(pSuite, "util_inp_strlower",
@@ -206,8 +300,16 @@ int main(int argc, char *argv[]) {
       !CU_add_test(pSuite, "gzip_inflate", test_nghttp2_gzip_inflate) ||
       !CU_add_test(pSuite, "buffer_write", nghttp2::test_buffer_write) ||
       !CU_add_test(pSuite, "pool_recycle", nghttp2::test_pool_recycle) ||
+      !CU_add_test(pSuite, "sized_memchunk_pool",
+                   nghttp2::test_sized_memchunk_pool) ||
+      !CU_add_test(pSuite, "sized_memchunk_pool_trim",
+                   nghttp2::test_sized_memchunk_pool_trim) ||
+      !CU_add_test(pSuite, "memchunk_size_class",
+                   nghttp2::test_memchunks_size_class) ||
       !CU_add_test(pSuite, "memchunk_append", nghttp2::test_memchunks_append) ||
       !CU_add_test(pSuite, "memchunk_drain", nghttp2::test_memchunks_drain) ||
+      !CU_add_test(pSuite, "memchunk_drain_pin",
+                   nghttp2::test_memchunks_drain_pin) ||
       !CU_add_test(pSuite, "memchunk_riovec", nghttp2::test_memchunks_riovec) ||
       !CU_add_test(pSuite, "memchunk_recycle",
                    nghttp2::test_memchunks_recycle) ||
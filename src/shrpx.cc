@@ -850,172 +850,6 @@ int create_unix_domain_server_socket(UpstreamAddr &faddr,
 }
 } // namespace
 
-namespace {
-int create_tcp_server_socket(UpstreamAddr &faddr,
-                             std::vector<InheritedAddr> &iaddrs) {
-  std::array<char, STRERROR_BUFSIZE> errbuf;
-  int fd = -1;
-  int rv;
-
-  auto &listenerconf = get_config()->conn.listener;
-
-  auto service = util::utos(faddr.port);
-  addrinfo hints{};
-  hints.ai_family = faddr.family;
-  hints.ai_socktype = SOCK_STREAM;
-  hints.ai_flags = AI_PASSIVE;
-#ifdef AI_ADDRCONFIG
-  hints.ai_flags |= AI_ADDRCONFIG;
-#endif // AI_ADDRCONFIG
-
-  auto node =
-      faddr.host == StringRef::from_lit("*") ? nullptr : faddr.host.c_str();
-
-  addrinfo *res, *rp;
-  rv = getaddrinfo(node, service.c_str(), &hints, &res);
-#ifdef AI_ADDRCONFIG
-  if (rv != 0) {
-    // Retry without AI_ADDRCONFIG
-    hints.ai_flags &= ~AI_ADDRCONFIG;
-    rv = getaddrinfo(node, service.c_str(), &hints, &res);
-  }
-#endif // AI_ADDRCONFIG
-  if (rv != 0) {
-    LOG(FATAL) << "Unable to get IPv" << (faddr.family == AF_INET ? "4" : "6")
-               << " address for " << faddr.host << ", port " << faddr.port
-               << ": " << gai_strerror(rv);
-    return -1;
-  }
-
-  auto res_d = defer(freeaddrinfo, res);
-
-  std::array<char, NI_MAXHOST> host;
-
-  for (rp = res; rp; rp = rp->ai_next) {
-
-    rv = getnameinfo(rp->ai_addr, rp->ai_addrlen, host.data(), host.size(),
-                     nullptr, 0, NI_NUMERICHOST);
-
-    if (rv != 0) {
-      LOG(WARN) << "getnameinfo() failed: " << gai_strerror(rv);
-      continue;
-    }
-
-    auto found = std::find_if(std::begin(iaddrs), std::end(iaddrs),
-                              [&host, &faddr](const InheritedAddr &ia) {
-                                return !ia.used && !ia.host_unix &&
-                                       ia.host == host.data() &&
-                                       ia.port == faddr.port;
-                              });
-
-    if (found != std::end(iaddrs)) {
-      (*found).used = true;
-      fd = (*found).fd;
-      break;
-    }
-
-#ifdef SOCK_NONBLOCK
-    fd =
-        socket(rp->ai_family, rp->ai_socktype | SOCK_NONBLOCK, rp->ai_protocol);
-    if (fd == -1) {
-      auto error = errno;
-      LOG(WARN) << "socket() syscall failed: "
-                << xsi_strerror(error, errbuf.data(), errbuf.size());
-      continue;
-    }
-#else  // !SOCK_NONBLOCK
-    fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-    if (fd == -1) {
-      auto error = errno;
-      LOG(WARN) << "socket() syscall failed: "
-                << xsi_strerror(error, errbuf.data(), errbuf.size());
-      continue;
-    }
-    util::make_socket_nonblocking(fd);
-#endif // !SOCK_NONBLOCK
-    int val = 1;
-    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val,
-                   static_cast<socklen_t>(sizeof(val))) == -1) {
-      auto error = errno;
-      LOG(WARN) << "Failed to set SO_REUSEADDR option to listener socket: "
-                << xsi_strerror(error, errbuf.data(), errbuf.size());
-      close(fd);
-      continue;
-    }
-
-#ifdef IPV6_V6ONLY
-    if (faddr.family == AF_INET6) {
-      if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &val,
-                     static_cast<socklen_t>(sizeof(val))) == -1) {
-        auto error = errno;
-        LOG(WARN) << "Failed to set IPV6_V6ONLY option to listener socket: "
-                  << xsi_strerror(error, errbuf.data(), errbuf.size());
-        close(fd);
-        continue;
-      }
-    }
-#endif // IPV6_V6ONLY
-
-#ifdef TCP_DEFER_ACCEPT
-    val = 3;
-    if (setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &val,
-                   static_cast<socklen_t>(sizeof(val))) == -1) {
-      auto error = errno;
-      LOG(WARN) << "Failed to set TCP_DEFER_ACCEPT option to listener socket: "
-                << xsi_strerror(error, errbuf.data(), errbuf.size());
-    }
-#endif // TCP_DEFER_ACCEPT
-
-    // When we are executing new binary, and the old binary did not
-    // bind privileged port (< 1024) for some reason, binding to those
-    // ports will fail with permission denied error.
-    if (bind(fd, rp->ai_addr, rp->ai_addrlen) == -1) {
-      auto error = errno;
-      LOG(WARN) << "bind() syscall failed: "
-                << xsi_strerror(error, errbuf.data(), errbuf.size());
-      close(fd);
-      continue;
-    }
-
-    if (listenerconf.fastopen > 0) {
-      val = listenerconf.fastopen;
-      if (setsockopt(fd, SOL_TCP, TCP_FASTOPEN, &val,
-                     static_cast<socklen_t>(sizeof(val))) == -1) {
-        auto error = errno;
-        LOG(WARN) << "Failed to set TCP_FASTOPEN option to listener socket: "
-                  << xsi_strerror(error, errbuf.data(), errbuf.size());
-      }
-    }
-
-    if (listen(fd, listenerconf.backlog) == -1) {
-      auto error = errno;
-      LOG(WARN) << "listen() syscall failed: "
-                << xsi_strerror(error, errbuf.data(), errbuf.size());
-      close(fd);
-      continue;
-    }
-
-    break;
-  }
-
-  if (!rp) {
-    LOG(FATAL) << "Listening " << (faddr.family == AF_INET ? "IPv4" : "IPv6")
-               << " socket failed";
-
-    return -1;
-  }
-
-  faddr.fd = fd;
-  faddr.hostport = util::make_http_hostport(mod_config()->balloc,
-                                            StringRef{host.data()}, faddr.port);
-
-  LOG(NOTICE) << "Listening on " << faddr.hostport
-              << (faddr.tls ? ", tls" : "");
-
-  return 0;
-}
-} // namespace
-
 namespace {
 // Returns array of InheritedAddr constructed from |config|.  This
 // function is intended to be used when reloading configuration, and
@@ -1359,7 +1193,22 @@ int create_acceptor_socket(Config *config, std::vector<InheritedAddr> &iaddrs) {
       continue;
     }
 
-    if (create_tcp_server_socket(addr, iaddrs) != 0) {
+    auto find_inherited = [&iaddrs](const char *host, uint16_t port) {
+      auto found = std::find_if(std::begin(iaddrs), std::end(iaddrs),
+                                [host, port](const InheritedAddr &ia) {
+                                  return !ia.used && !ia.host_unix &&
+                                         ia.host == host && ia.port == port;
+                                });
+      if (found == std::end(iaddrs)) {
+        return -1;
+      }
+
+      (*found).used = true;
+
+      return (*found).fd;
+    };
+
+    if (create_tcp_server_socket(addr, false, -1, find_inherited) != 0) {
       return -1;
     }
   }
@@ -1790,6 +1639,12 @@ constexpr auto DEFAULT_NPN_LIST =
     StringRef::from_lit("h2,h2-16,h2-14,http/1.1");
 } // namespace
 
+namespace {
+constexpr auto DEFAULT_RESPONSE_COMPRESSION_MIME_TYPES =
+    StringRef::from_lit("text/*,application/javascript,application/json,"
+                        "application/xml,image/svg+xml");
+} // namespace
+
 namespace {
 constexpr auto DEFAULT_TLS_MIN_PROTO_VERSION = StringRef::from_lit("TLSv1.2");
 #ifdef TLS1_3_VERSION
@@ -1799,13 +1654,6 @@ constexpr auto DEFAULT_TLS_MAX_PROTO_VERSION = StringRef::from_lit("TLSv1.2");
 #endif // !TLS1_3_VERSION
 } // namespace
 
-namespace {
-constexpr auto DEFAULT_ACCESSLOG_FORMAT =
-    StringRef::from_lit(R"($remote_addr - - [$time_local] )"
-                        R"("$request" $status $body_bytes_sent )"
-                        R"("$http_referer" "$http_user_agent")");
-} // namespace
-
 namespace {
 void fill_default_config(Config *config) {
   config->num_worker = 1;
@@ -1880,6 +1728,11 @@ void fill_default_config(Config *config) {
   httpconf.max_request_header_fields = 100;
   httpconf.response_header_field_buffer = 64_k;
   httpconf.max_response_header_fields = 500;
+  httpconf.response_cache.max_size = 64_m;
+  httpconf.response_cache.max_entry_size = 1_m;
+  httpconf.collapsed_forwarding.timeout = 5_s;
+  httpconf.response_compression.min_size = 1_k;
+  httpconf.response_compression.level = 6;
   httpconf.redirect_https_port = StringRef::from_lit("443");
   httpconf.max_requests = std::numeric_limits<size_t>::max();
   httpconf.xfp.add = true;
@@ -1995,6 +1848,7 @@ void fill_default_config(Config *config) {
   }
 
   loggingconf.syslog_facility = LOG_DAEMON;
+  loggingconf.async.buffer_size = 1_m;
   loggingconf.severity = NOTICE;
 
   auto &connconf = config->conn;
@@ -2004,6 +1858,7 @@ void fill_default_config(Config *config) {
       // Default accept() backlog
       listenerconf.backlog = 65536;
       listenerconf.timeout.sleep = 30_s;
+      listenerconf.worker_dispatch = WorkerDispatch::ROUND_ROBIN;
     }
   }
 
@@ -2058,6 +1913,10 @@ void fill_default_config(Config *config) {
     timeoutconf.lookup = 5_s;
   }
   dnsconf.max_try = 2;
+
+  auto &bufpoolconf = config->buffer_pool;
+  bufpoolconf.high_watermark = 64_m;
+  bufpoolconf.low_watermark = 4_m;
 }
 
 } // namespace
@@ -2183,8 +2042,11 @@ Connections:
               "affinity=<METHOD>",    "dns",    "redirect-if-not-tls",
               "upgrade-scheme",                        "mruby=<PATH>",
               "read-timeout=<DURATION>",   "write-timeout=<DURATION>",
-              "group=<GROUP>",  "group-weight=<N>", "weight=<N>",  and
-              "dnf".    The  parameter   consists   of  keyword,   and
+              "group=<GROUP>",    "group-weight=<N>",    "weight=<N>",
+              "dnf",    "cache",    "collapse",    "balance=<METHOD>",
+              "affinity-key-name=<NAME>",      "affinity-hash=<HASH>",
+              "affinity-bounded-load=<PERCENT>",  "min-idle=<N>",  and
+              "prewarm".  The  parameter  consists  of  keyword,   and
               optionally followed by "="  and value.  For example, the
               parameter "proto=h2" consists of the keyword "proto" and
               value "h2".  The parameter "tls" consists of the keyword
@@ -2224,20 +2086,21 @@ Connections:
               backend  is permanently  offline, once  it goes  in that
               state, and this is the default behaviour.
 
-              The     session     affinity    is     enabled     using
-              "affinity=<METHOD>"  parameter.   If  "ip" is  given  in
-              <METHOD>, client  IP based session affinity  is enabled.
-              If "cookie"  is given in <METHOD>,  cookie based session
-              affinity is  enabled.  If  "none" is given  in <METHOD>,
-              session affinity  is disabled, and this  is the default.
-              The session  affinity is  enabled per <PATTERN>.   If at
-              least  one backend  has  "affinity"  parameter, and  its
-              <METHOD> is not "none",  session affinity is enabled for
-              all backend  servers sharing the same  <PATTERN>.  It is
-              advised  to  set  "affinity" parameter  to  all  backend
-              explicitly if session affinity  is desired.  The session
-              affinity  may   break  if   one  of  the   backend  gets
-              unreachable,  or   backend  settings  are   reloaded  or
+              The     session     affinity     is     enabled    using
+              "affinity=<METHOD>"  parameter.   If  "ip"  is  given in
+              <METHOD>,  client  IP based session affinity is enabled.
+              If  "cookie"  is given in <METHOD>, cookie based session
+              affinity  is  enabled.   If "none" is given in <METHOD>,
+              session  affinity  is disabled, and this is the default.
+              "header",  "path", and "query" are described below.  The
+              session  affinity is enabled per <PATTERN>.  If at least
+              one  backend  has "affinity" parameter, and its <METHOD>
+              is  not  "none",  session  affinity  is  enabled for all
+              backend  servers  sharing  the  same  <PATTERN>.   It is
+              advised  to  set  "affinity"  parameter  to  all backend
+              explicitly  if session affinity is desired.  The session
+              affinity   may   break   if  one  of  the  backend  gets
+              unreachable,   or   backend  settings  are  reloaded  or
               replaced by API.
 
               If   "affinity=cookie"    is   used,    the   additional
@@ -2265,6 +2128,32 @@ Connections:
               have  an  affinity  cookie.   <STICKINESS>  defaults  to
               "loose".
 
+              If  "affinity=header"  is  used,  the  value  of request
+              header  field  named  by  "affinity-key-name=<NAME>"  is
+              hashed to choose a backend.  If "affinity=path" is used,
+              the   request   path   without   query  is  hashed.   If
+              "affinity=query"  is  used, the value of query parameter
+              named  by  "affinity-key-name=<NAME>"  is  hashed.  If a
+              request does not have the key, client IP address is used
+              instead.
+
+              "affinity-hash=<HASH>" specifies how a hash is mapped to
+              a  backend.   If  "ring"  is given in <HASH>, consistent
+              hash ring is used, and this is the default.  If "maglev"
+              is  given,  Maglev lookup table is used.  It distributes
+              keys  more  evenly,  and  when  a  backend  is  added or
+              removed,  mostly  the  keys  of that backend move.  With
+              "maglev", backends get keys in proportion to "weight".
+
+              "affinity-bounded-load=<PERCENT>"  limits  the number of
+              outstanding   requests  of  each  backend  to  <PERCENT>
+              percent  of  the  average  in  the  group,  rounded  up.
+              <PERCENT>  must  be at least 100.  If the backend chosen
+              by  hash exceeds the limit, the next backend in the ring
+              or  the  table  is  tried.  This prevents a hot key from
+              overloading  a  single  backend at the cost of affinity.
+              It is disabled by default.
+
               By default, name resolution of backend host name is done
               at  start  up,  or reloading  configuration.   If  "dns"
               parameter   is  given,   name  resolution   takes  place
@@ -2324,12 +2213,13 @@ Connections:
 
               "weight=<N>"  parameter  specifies  the  weight  of  the
               backend  address  inside  a  group  which  this  address
-              belongs  to.  The  higher  weight  gets more  frequently
-              selected by  the load balancing algorithm.   <N> must be
-              [1,  256] inclusive.   The  weight 8  has  4 times  more
-              weight  than weight  2.  If  this parameter  is omitted,
+              belongs  to.   The  higher  weight  gets more frequently
+              selected  by  the load balancing algorithm.  <N> must be
+              [1,  256]  inclusive.   The  weight  8  has 4 times more
+              weight  than  weight  2.   If this parameter is omitted,
               weight  becomes  1.   "weight"  is  ignored  if  session
-              affinity is enabled.
+              affinity  is  enabled  unless  "affinity-hash=maglev" is
+              used.
 
               If "dnf" parameter is  specified, an incoming request is
               not forwarded to a backend  and just consumed along with
@@ -2338,6 +2228,70 @@ Connections:
               generated by mruby  script (see "mruby=<PATH>" parameter
               above).  "dnf" is an abbreviation of "do not forward".
 
+              If  "cache"  parameter  is specified, the responses from
+              the  backends  in  the  pattern  are  stored in response
+              cache,  and the subsequent identical requests are served
+              from  it  without  contacting  backend until they become
+              stale.   Only  GET requests without authorization header
+              field  are  served from the cache.  A response is stored
+              only  if  its  freshness lifetime is explicitly given by
+              s-maxage  or  max-age  directive  of  cache-control,  or
+              expires  header  field,  and  its cache-control does not
+              contain no-store, no-cache, or private.  A response with
+              set-cookie  header  field  is never stored.  Vary header
+              field   is   honored.   See  also  --response-cache-size
+              option.
+
+              If   "collapse"   parameter   is   specified,  identical
+              concurrent  requests  to the backends in the pattern are
+              collapsed  into  a  single  backend  request.   While  a
+              request  is  waiting  for  response  header  fields from
+              backend,  the  subsequent requests with the same scheme,
+              authority,  and  path  wait for it instead of contacting
+              backend,  and  receive a copy of its response.  Only the
+              requests  which  are  eligible  for  response  cache are
+              collapsed.   The  response is shared only if it could be
+              stored  in response cache, and the request header fields
+              nominated by its vary header field match.  Otherwise, or
+              if  the  waiting  request  times out, it is forwarded to
+              backend.   "collapse" can be used together with "cache".
+              See also --collapsed-forwarding-timeout option.
+
+              "balance=<METHOD>"    parameter   specifies   the   load
+              balancing  algorithm used inside a group.  If "weighted"
+              is given in <METHOD>, addresses are selected by weighted
+              round  robin,  and  this  is  the  default.  If "p2c" is
+              given, nghttpx picks 2 addresses in the group at random,
+              and  forwards a request to the one with lower cost.  The
+              cost is the exponentially weighted moving average (EWMA)
+              of   response   latency  multiplied  by  the  number  of
+              outstanding  requests,  divided  by "weight".  A backend
+              which  gets  slow  is  avoided  immediately, and it gets
+              requests  again  after  it  recovers.   The  latency  is
+              measured  per  worker  thread  from  the  selection of a
+              backend  to  the  arrival  of  response  header  fields.
+              Groups  are  still  selected  by  "group-weight".  If at
+              least  one  backend has "balance=p2c", it is enabled for
+              all   backend   servers   sharing  the  same  <PATTERN>.
+              "balance" is ignored if session affinity is enabled.
+
+              "min-idle=<N>" parameter makes each worker keep <N> idle
+              connections  to  this  backend  ready, so that a request
+              does  not  wait  for  a  new  connection.   For HTTP/1.1
+              backend,  they  are  idle  connections in the connection
+              pool.   For  HTTP/2  backend,  they  are HTTP/2 sessions
+              which  still  accept  new streams, and idle sessions are
+              kept  alive by PING.  A connection is replaced before it
+              is  closed  by  --backend-keep-alive-timeout.   The idle
+              connections are established after a request is forwarded
+              to  this backend.  If "prewarm" parameter is given, they
+              are  established  when  the configuration is loaded, and
+              when  this backend gets online again.  "prewarm" implies
+              "min-idle=1" if "min-idle" is not given.  They cannot be
+              used  with  "dns" parameter.  If backend I/O threads are
+              enabled  by  --backend-http2-io-threads,  they  keep <N>
+              HTTP/2 sessions which all workers share.
+
               Since ";" and ":" are  used as delimiter, <PATTERN> must
               not contain  these characters.  In order  to include ":"
               in  <PATTERN>,  one  has  to  specify  "%3A"  (which  is
@@ -2389,6 +2343,21 @@ Connections:
               "healthmon"  parameters  cannot   be  used  with  "quic"
               parameter.
 
+              To  let each worker thread accept connections on its own
+              listening  socket, specify "reuseport" parameter.  A TCP
+              socket  with SO_REUSEPORT is created per worker, and the
+              kernel  distributes  incoming  connections  among  them.
+              This  removes  the  single acceptor and the cross-thread
+              handoff  from  the  connection  path.  Listening sockets
+              with  this parameter are not inherited across hot binary
+              upgrade  or configuration reload.  The new process binds
+              its  own  sockets  while the old one is still listening.
+              Before  closing its sockets, the old process accepts the
+              connections  queued  in  them,  but  a  connection which
+              arrives  in  between  may be reset.  UNIX domain socket,
+              "api",   and  "quic"  parameters  cannot  be  used  with
+              "reuseport" parameter.
+
               Default: *,3000
   --backlog=<N>
               Set listen backlog size.
@@ -2425,6 +2394,32 @@ Performance:
               experience,  or  for  the platforms  which  lack  thread
               support.   If  threading  is disabled,  this  option  is
               always enabled.
+  --worker-dispatch=(round-robin|least-loaded)
+              Specify  how the connections accepted by the main thread
+              are given to worker threads.  If "round-robin" is given,
+              workers  get new connections in turn.  If "least-loaded"
+              is  given,  2  workers  are  picked at random, and a new
+              connection  goes  to the less loaded one.  The load of a
+              worker  is  computed from the number of its connections,
+              the  number  of requests in flight, the number of events
+              queued  to  it,  and  the  lag  of its event loop.  This
+              option  has  no  effect on the frontend with "reuseport"
+              parameter, and on single thread mode.
+              Default: round-robin
+  --worker-cpu-affinity=<CPUS>
+              Pin worker threads to CPUs.  <CPUS> is a comma separated
+              list  of  CPU  numbers  or  ranges of CPU numbers (e.g.,
+              "0-3,8-11").   The  N-th  worker thread is pinned to the
+              N-th  CPU in the list.  If there are more worker threads
+              than  CPUs,  the list is reused from the beginning.  The
+              dedicated  worker thread for API requests is not pinned.
+              Because  the  kernel allocates memory from the NUMA node
+              of the CPU which first touches it, the buffers and pools
+              of  a  pinned  worker  stay  on  its  local  node.  Each
+              listening   socket   of   a  frontend  with  "reuseport"
+              parameter  is  also  given  SO_INCOMING_CPU, so that the
+              kernel  prefers  the  worker  running  on  the CPU which
+              processed the incoming connection.
   --read-rate=<SIZE>
               Set maximum  average read  rate on  frontend connection.
               Setting 0 to this option means read rate is unlimited.
@@ -2511,6 +2506,24 @@ Performance:
               Set buffer size used to store backend response.
               Default: )"
       << util::utos_unit(config->conn.downstream->response_buffer_size) << R"(
+  --buffer-pool-high-watermark=<SIZE>
+              Specify  the  maximum  size of unused buffers which each
+              buffer  pool  keeps  for  later  use.  Each worker has a
+              pool,  and  each  backend  I/O thread has two.  A buffer
+              released while the pool already keeps this much is freed
+              immediately.  0 means no limit.
+              Default: )"
+      << util::utos_unit(config->buffer_pool.high_watermark) << R"(
+  --buffer-pool-low-watermark=<SIZE>
+              Specify  the  size  of  unused buffers which each buffer
+              pool  keeps  after  trimming.   Every  10  seconds, each
+              worker  and  backend I/O thread frees the unused buffers
+              which  have  not  been used since the previous trimming,
+              but  keeps at least this size of them in each pool.  The
+              freed  memory  is  returned  to  the operating system if
+              possible.
+              Default: )"
+      << util::utos_unit(config->buffer_pool.low_watermark) << R"(
   --fastopen=<N>
               Enables  "TCP Fast  Open" for  the listening  socket and
               limits the  maximum length for the  queue of connections
@@ -2518,6 +2531,42 @@ Performance:
               value is 0 then fast open is disabled.
               Default: )"
       << config->conn.listener.fastopen << R"(
+  --http1-splice
+              Forward  response  body  from  HTTP/1  backend to HTTP/1
+              frontend  with  splice(2)  without  copying  it  to user
+              space.   This  is  used  only  when  response  body  has
+              content-length  and  is  not  altered  by nghttpx (e.g.,
+              response   compression,  or  response  cache).   Backend
+              connection  must be cleartext.  Frontend connection must
+              be  cleartext,  or  TLS  with  --tls-ktls enabled.  This
+              option  is ignored on the platforms which do not support
+              splice(2).
+  --frontend-zerocopy-threshold=<SIZE>
+              Send  response to cleartext TCP frontend connection with
+              MSG_ZEROCOPY  if  the  data to write at once is at least
+              <SIZE> bytes.  The kernel sends the data without copying
+              it,  and  nghttpx  keeps  the  buffers  until the kernel
+              notifies  the completion.  If the kernel copies the data
+              anyway,  e.g.,  because  the  network interface does not
+              support  it,  nghttpx  stops  using MSG_ZEROCOPY for the
+              connection.   0  disables  MSG_ZEROCOPY.  This option is
+              ignored   on   the   platforms   which  do  not  support
+              MSG_ZEROCOPY.
+              Default: )"
+      << util::utos_unit(config->conn.upstream.zerocopy_threshold) << R"(
+  --io-engine=(libev|io_uring)
+              Specify   I/O  engine  for  accepting  connections,  and
+              cleartext  frontend  connections.   If "libev" is given,
+              nghttpx  waits  for readiness of sockets with libev, and
+              reads  and writes them with system calls.  If "io_uring"
+              is   given,  connections  are  accepted  with  multishot
+              accept,  data  is  received into the buffers provided to
+              io_uring, and writes of all connections are submitted in
+              a  batch  per  event loop iteration.  If the kernel does
+              not support the features required, nghttpx falls back to
+              "libev".  TLS frontend connections and the frontend with
+              PROXY protocol are always read and written with libev.
+              Default: libev
   --no-kqueue Don't use  kqueue.  This  option is only  applicable for
               the platforms  which have kqueue.  For  other platforms,
               this option will be simply ignored.
@@ -2961,6 +3010,22 @@ HTTP/2:
               connection.
               Default: )"
       << config->http2.downstream.connection_window_size << R"(
+  --backend-http2-io-threads=<N>
+              Run backend HTTP/2 sessions on <N> dedicated backend I/O
+              threads   instead  of  on  each  worker.   Workers  hand
+              requests   to  the  backend  I/O  threads,  and  receive
+              responses  back  from  them,  so  that requests from all
+              workers  are  multiplexed  onto a small number of HTTP/2
+              connections  per  backend.  A backend is always assigned
+              to  the  same  backend I/O thread.  These connections do
+              not  accept  server  push.   Requests  to a backend with
+              "dns"   parameter,   CONNECT   requests,  requests  with
+              :protocol,  and all requests if --backend-http-proxy-uri
+              is given are still handled by per-worker sessions.  This
+              option  is ignored if --single-thread is given.  Specify
+              0 to disable this feature.
+              Default: )"
+      << config->http2.downstream.io_threads << R"(
   --http2-no-cookie-crumbling
               Don't crumble cookie header field.
   --padding=<N>
@@ -3109,6 +3174,16 @@ Logging:
               Write  access  log  when   response  header  fields  are
               received   from  backend   rather   than  when   request
               transaction finishes.
+  --accesslog-binary
+              Write  access  log  in  compact binary format.  The file
+              starts   with  a  header  which  identifies  the  format
+              version,    and   each   record   is   a   sequence   of
+              length-prefixed  fields in the order of the variables in
+              --accesslog-format.    Literal  text  is  not  recorded,
+              timestamps  are  written  as  integers,  and strings are
+              written without escaping.  Use nghttpx-logdec to convert
+              it  back  to  the  text  format or JSON.  This option is
+              ignored if --accesslog-syslog is used.
   --errorlog-file=<PATH>
               Set path to write error  log.  To reopen file, send USR1
               signal  to nghttpx.   stderr will  be redirected  to the
@@ -3122,6 +3197,20 @@ Logging:
               Set syslog facility to <FACILITY>.
               Default: )"
       << str_syslog_facility(config->logging.syslog_facility) << R"(
+  --log-async
+              Write  access log and error log from a dedicated thread.
+              Each  thread  appends log records to its own ring buffer
+              without  blocking, and the log writer thread writes them
+              in  batches,  so  that  slow disk or pipe does not stall
+              event  loop.   If  a  ring  buffer  is full, records are
+              dropped,  and  the number of dropped records is counted.
+              A  record of FATAL severity is written before the thread
+              continues.
+  --log-async-buffer-size=<SIZE>
+              Set  the  size  of  the  ring  buffer per thread used by
+              --log-async.
+              Default: )"
+      << util::utos_unit(config->logging.async.buffer_size) << R"(
 
 HTTP:
   --add-x-forwarded-for
@@ -3263,6 +3352,60 @@ HTTP:
               used.   This   option  is   recommended  for   a  server
               deployment which directly faces clients and the services
               it provides only require http or https scheme.
+  --response-cache-size=<SIZE>
+              Set the memory capacity of response cache.  The capacity
+              is  divided evenly among worker threads, and each worker
+              keeps its own cache.  When the capacity is exceeded, the
+              least  recently  used  responses  are evicted.  Response
+              cache  is  used  only by the backends which have "cache"
+              parameter in --backend option.
+              Default: )"
+      << util::utos_unit(config->http.response_cache.max_size) << R"(
+  --response-cache-max-entry-size=<SIZE>
+              Set  the  maximum length of response body which response
+              cache  stores.   A  larger  response  is  forwarded to a
+              client, but it is not stored.
+              Default: )"
+      << util::utos_unit(config->http.response_cache.max_entry_size) << R"(
+  --collapsed-forwarding-timeout=<DURATION>
+              Set  the  maximum  time that a request collapsed into an
+              identical  request  waits  for  response  header fields.
+              When  it expires, the request is forwarded to backend on
+              its own.  See "collapse" parameter in --backend option.
+              Default: )"
+      << util::duration_str(config->http.collapsed_forwarding.timeout) << R"(
+  --response-compression
+              Compress response body in gzip if a client accepts it in
+              accept-encoding   header  field,  and  backend  has  not
+              encoded the response.  Body is compressed as it streams,
+              so  that  a  client  does not have to wait for the whole
+              response.  Only the responses whose content-type matches
+              --response-compression-mime-types,       and       whose
+              content-length     is     unknown     or     at    least
+              --response-compression-min-size   are   compressed.    A
+              response  to HEAD request, a response with content-range
+              header field, or cache-control no-transform directive is
+              never   compressed.    Compressed  response  has  "Vary:
+              accept-encoding", and its strong etag is made weak.
+  --response-compression-level=<N>
+              Set      the      compression      level     used     by
+              --response-compression.   1  is the fastest, and 9 gives
+              the best compression.
+              Default: )"
+      << config->http.response_compression.level << R"(
+  --response-compression-min-size=<SIZE>
+              Set  the minimum content-length of a response compressed
+              by    --response-compression.     A   response   without
+              content-length is compressed regardless of this option.
+              Default: )"
+      << util::utos_unit(config->http.response_compression.min_size) << R"(
+  --response-compression-mime-types=<LIST>
+              Set  the  list of media types of responses compressed by
+              --response-compression,  separated  by  comma.   A  type
+              ending  with  "/*"  matches  any subtype.  Parameters in
+              content-type are ignored.
+              Default: )"
+      << DEFAULT_RESPONSE_COMPRESSION_MIME_TYPES << R"(
 
 API:
   --api-max-request-body=<SIZE>
@@ -3547,6 +3690,11 @@ int process_options(Config *config,
 
   auto &loggingconf = config->logging;
 
+  if (loggingconf.access.syslog && loggingconf.access.binary) {
+    LOG(WARN) << "accesslog-binary: ignored because accesslog-syslog is used";
+    loggingconf.access.binary = false;
+  }
+
   if (loggingconf.access.syslog || loggingconf.error.syslog) {
     openlog("nghttpx", LOG_NDELAY | LOG_NOWAIT | LOG_PID,
             loggingconf.syslog_facility);
@@ -3634,6 +3782,13 @@ int process_options(Config *config,
     tlsconf.npn_list = util::split_str(DEFAULT_NPN_LIST, ',');
   }
 
+  auto &compconf = config->http.response_compression;
+
+  if (compconf.mime_types.empty()) {
+    compconf.mime_types =
+        util::split_str(DEFAULT_RESPONSE_COMPRESSION_MIME_TYPES, ',');
+  }
+
   if (!tlsconf.tls_proto_list.empty()) {
     tlsconf.tls_proto_mask = tls::create_tls_proto_mask(tlsconf.tls_proto_list);
   }
@@ -3655,7 +3810,8 @@ int process_options(Config *config,
   auto &listenerconf = config->conn.listener;
   auto &upstreamconf = config->conn.upstream;
 
-  if (listenerconf.addrs.empty()) {
+  if (listenerconf.addrs.empty() &&
+      config->conn.reuseport_listener.addrs.empty()) {
     UpstreamAddr addr{};
     addr.host = StringRef::from_lit("*");
     addr.port = 3000;
@@ -4270,6 +4426,36 @@ int main(int argc, char **argv) {
          190},
         {SHRPX_OPT_REQUIRE_HTTP_SCHEME.c_str(), no_argument, &flag, 191},
         {SHRPX_OPT_TLS_KTLS.c_str(), no_argument, &flag, 192},
+        {SHRPX_OPT_WORKER_DISPATCH.c_str(), required_argument, &flag, 193},
+        {SHRPX_OPT_WORKER_CPU_AFFINITY.c_str(), required_argument, &flag,
+         194},
+        {SHRPX_OPT_RESPONSE_CACHE_SIZE.c_str(), required_argument, &flag,
+         195},
+        {SHRPX_OPT_RESPONSE_CACHE_MAX_ENTRY_SIZE.c_str(), required_argument,
+         &flag, 196},
+        {SHRPX_OPT_COLLAPSED_FORWARDING_TIMEOUT.c_str(), required_argument,
+         &flag, 197},
+        {SHRPX_OPT_RESPONSE_COMPRESSION.c_str(), no_argument, &flag, 198},
+        {SHRPX_OPT_RESPONSE_COMPRESSION_LEVEL.c_str(), required_argument,
+         &flag, 199},
+        {SHRPX_OPT_RESPONSE_COMPRESSION_MIN_SIZE.c_str(), required_argument,
+         &flag, 200},
+        {SHRPX_OPT_RESPONSE_COMPRESSION_MIME_TYPES.c_str(), required_argument,
+         &flag, 201},
+        {SHRPX_OPT_LOG_ASYNC.c_str(), no_argument, &flag, 202},
+        {SHRPX_OPT_LOG_ASYNC_BUFFER_SIZE.c_str(), required_argument, &flag,
+         203},
+        {SHRPX_OPT_ACCESSLOG_BINARY.c_str(), no_argument, &flag, 204},
+        {SHRPX_OPT_BACKEND_HTTP2_IO_THREADS.c_str(), required_argument, &flag,
+         205},
+        {SHRPX_OPT_HTTP1_SPLICE.c_str(), no_argument, &flag, 206},
+        {SHRPX_OPT_FRONTEND_ZEROCOPY_THRESHOLD.c_str(), required_argument,
+         &flag, 207},
+        {SHRPX_OPT_IO_ENGINE.c_str(), required_argument, &flag, 208},
+        {SHRPX_OPT_BUFFER_POOL_HIGH_WATERMARK.c_str(), required_argument,
+         &flag, 209},
+        {SHRPX_OPT_BUFFER_POOL_LOW_WATERMARK.c_str(), required_argument, &flag,
+         210},
         {nullptr, 0, nullptr, 0}};
 
     int option_index = 0;
@@ -5183,6 +5369,91 @@ int main(int argc, char **argv) {
         // --tls-ktls
         cmdcfgs.emplace_back(SHRPX_OPT_TLS_KTLS, StringRef::from_lit("yes"));
         break;
+      case 193:
+        // --worker-dispatch
+        cmdcfgs.emplace_back(SHRPX_OPT_WORKER_DISPATCH, StringRef{optarg});
+        break;
+      case 194:
+        // --worker-cpu-affinity
+        cmdcfgs.emplace_back(SHRPX_OPT_WORKER_CPU_AFFINITY, StringRef{optarg});
+        break;
+      case 195:
+        // --response-cache-size
+        cmdcfgs.emplace_back(SHRPX_OPT_RESPONSE_CACHE_SIZE, StringRef{optarg});
+        break;
+      case 196:
+        // --response-cache-max-entry-size
+        cmdcfgs.emplace_back(SHRPX_OPT_RESPONSE_CACHE_MAX_ENTRY_SIZE,
+                             StringRef{optarg});
+        break;
+      case 197:
+        // --collapsed-forwarding-timeout
+        cmdcfgs.emplace_back(SHRPX_OPT_COLLAPSED_FORWARDING_TIMEOUT,
+                             StringRef{optarg});
+        break;
+      case 198:
+        // --response-compression
+        cmdcfgs.emplace_back(SHRPX_OPT_RESPONSE_COMPRESSION,
+                             StringRef::from_lit("yes"));
+        break;
+      case 199:
+        // --response-compression-level
+        cmdcfgs.emplace_back(SHRPX_OPT_RESPONSE_COMPRESSION_LEVEL,
+                             StringRef{optarg});
+        break;
+      case 200:
+        // --response-compression-min-size
+        cmdcfgs.emplace_back(SHRPX_OPT_RESPONSE_COMPRESSION_MIN_SIZE,
+                             StringRef{optarg});
+        break;
+      case 201:
+        // --response-compression-mime-types
+        cmdcfgs.emplace_back(SHRPX_OPT_RESPONSE_COMPRESSION_MIME_TYPES,
+                             StringRef{optarg});
+        break;
+      case 202:
+        // --log-async
+        cmdcfgs.emplace_back(SHRPX_OPT_LOG_ASYNC, StringRef::from_lit("yes"));
+        break;
+      case 203:
+        // --log-async-buffer-size
+        cmdcfgs.emplace_back(SHRPX_OPT_LOG_ASYNC_BUFFER_SIZE,
+                             StringRef{optarg});
+        break;
+      case 204:
+        // --accesslog-binary
+        cmdcfgs.emplace_back(SHRPX_OPT_ACCESSLOG_BINARY,
+                             StringRef::from_lit("yes"));
+        break;
+      case 205:
+        // --backend-http2-io-threads
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_HTTP2_IO_THREADS,
+                             StringRef{optarg});
+        break;
+      case 206:
+        // --http1-splice
+        cmdcfgs.emplace_back(SHRPX_OPT_HTTP1_SPLICE,
+                             StringRef::from_lit("yes"));
+        break;
+      case 207:
+        // --frontend-zerocopy-threshold
+        cmdcfgs.emplace_back(SHRPX_OPT_FRONTEND_ZEROCOPY_THRESHOLD,
+                             StringRef{optarg});
+        break;
+      case 208:
+        // --io-engine
+        cmdcfgs.emplace_back(SHRPX_OPT_IO_ENGINE, StringRef{optarg});
+        break;
+      case 209:
+        // --buffer-pool-high-watermark
+        cmdcfgs.emplace_back(SHRPX_OPT_BUFFER_POOL_HIGH_WATERMARK,
+                             StringRef{optarg});
+        break;
+      case 210:
+        // --buffer-pool-low-watermark
+        cmdcfgs.emplace_back(SHRPX_OPT_BUFFER_POOL_LOW_WATERMARK,
+                             StringRef{optarg});
+        break;
       default:
         break;
       }
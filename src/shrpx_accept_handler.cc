@@ -31,6 +31,8 @@
 #include <cerrno>
 
 #include "shrpx_connection_handler.h"
+#include "shrpx_worker.h"
+#include "shrpx_io_uring.h"
 #include "shrpx_config.h"
 #include "shrpx_log.h"
 #include "util.h"
@@ -46,15 +48,69 @@ void acceptcb(struct ev_loop *loop, ev_io *w, int revent) {
 }
 } // namespace
 
+namespace {
+void uring_acceptcb(IOUringOp *op, int32_t res, uint32_t flags) {
+  auto h = static_cast<AcceptHandler *>(op->data);
+  if (!h) {
+    // AcceptHandler has been disabled or deleted, and the request is
+    // being canceled.
+    if (res >= 0) {
+      close(res);
+    }
+    if (!IOUring::more(flags)) {
+      delete op;
+    }
+    return;
+  }
+
+  h->uring_accept_connection(res, IOUring::more(flags));
+}
+} // namespace
+
+namespace {
+void sleepcb(struct ev_loop *loop, ev_timer *w, int revent) {
+  auto h = static_cast<AcceptHandler *>(w->data);
+  h->enable();
+}
+} // namespace
+
 AcceptHandler::AcceptHandler(const UpstreamAddr *faddr, ConnectionHandler *h)
-    : conn_hnr_(h), faddr_(faddr) {
+    : loop_(h->get_loop()),
+      conn_hnr_(h),
+      worker_(nullptr),
+      faddr_(faddr),
+      io_uring_(h->get_io_uring()),
+      accept_op_(nullptr),
+      enabled_(false) {
   ev_io_init(&wev_, acceptcb, faddr_->fd, EV_READ);
   wev_.data = this;
-  ev_io_start(conn_hnr_->get_loop(), &wev_);
+
+  ev_timer_init(&sleep_timer_, sleepcb, 0., 0.);
+  sleep_timer_.data = this;
+
+  enable();
+}
+
+AcceptHandler::AcceptHandler(const UpstreamAddr *faddr, Worker *worker)
+    : loop_(worker->get_loop()),
+      conn_hnr_(worker->get_connection_handler()),
+      worker_(worker),
+      faddr_(faddr),
+      io_uring_(worker->get_io_uring()),
+      accept_op_(nullptr),
+      enabled_(false) {
+  ev_io_init(&wev_, acceptcb, faddr_->fd, EV_READ);
+  wev_.data = this;
+
+  ev_timer_init(&sleep_timer_, sleepcb, 0., 0.);
+  sleep_timer_.data = this;
+
+  enable();
 }
 
 AcceptHandler::~AcceptHandler() {
-  ev_io_stop(conn_hnr_->get_loop(), &wev_);
+  ev_timer_stop(loop_, &sleep_timer_);
+  disable();
   close(faddr_->fd);
 }
 
@@ -70,41 +126,133 @@ void AcceptHandler::accept_connection() {
 #endif // !HAVE_ACCEPT4
 
   if (cfd == -1) {
-    switch (errno) {
-    case EINTR:
-    case ENETDOWN:
-    case EPROTO:
-    case ENOPROTOOPT:
-    case EHOSTDOWN:
+    handle_accept_error(errno);
+    return;
+  }
+
+#ifndef HAVE_ACCEPT4
+  util::make_socket_nonblocking(cfd);
+  util::make_socket_closeonexec(cfd);
+#endif // !HAVE_ACCEPT4
+
+  handle_accepted(cfd, &sockaddr.sa, addrlen);
+}
+
+void AcceptHandler::uring_accept_connection(int32_t res, bool more) {
+  if (!more) {
+    // The request has ended, e.g., due to an error.  It is requested
+    // again below unless this acceptor is disabled meanwhile.
+    delete accept_op_;
+    accept_op_ = nullptr;
+  }
+
+  if (res < 0) {
+    handle_accept_error(-res);
+  } else {
+    sockaddr_union sockaddr;
+    socklen_t addrlen = sizeof(sockaddr);
+
+    // Multishot accept shares one address buffer among completions,
+    // so the peer address is queried here.
+    if (getpeername(res, &sockaddr.sa, &addrlen) == -1) {
+      close(res);
+    } else {
+      handle_accepted(res, &sockaddr.sa, addrlen);
+    }
+  }
+
+  if (!accept_op_ && enabled_) {
+    enabled_ = false;
+    enable();
+  }
+}
+
+void AcceptHandler::handle_accept_error(int error) {
+  switch (error) {
+  case EINTR:
+  case ENETDOWN:
+  case EPROTO:
+  case ENOPROTOOPT:
+  case EHOSTDOWN:
 #ifdef ENONET
-    case ENONET:
+  case ENONET:
 #endif // ENONET
-    case EHOSTUNREACH:
-    case EOPNOTSUPP:
-    case ENETUNREACH:
-      return;
-    case EMFILE:
-    case ENFILE:
-      LOG(WARN) << "acceptor: running out file descriptor; disable acceptor "
-                   "temporarily";
+  case EHOSTUNREACH:
+  case EOPNOTSUPP:
+  case ENETUNREACH:
+    return;
+  case EMFILE:
+  case ENFILE:
+    LOG(WARN) << "acceptor: running out file descriptor; disable acceptor "
+                 "temporarily";
+    if (worker_) {
+      // Other workers have their own listening sockets, and they
+      // may still have file descriptors left.
+      sleep(get_config()->conn.listener.timeout.sleep);
+    } else {
       conn_hnr_->sleep_acceptor(get_config()->conn.listener.timeout.sleep);
-      return;
-    default:
+    }
+    return;
+  default:
+    return;
+  }
+}
+
+void AcceptHandler::handle_accepted(int cfd, sockaddr *addr,
+                                    socklen_t addrlen) {
+  if (worker_) {
+    worker_->handle_connection(cfd, addr, addrlen, faddr_);
+    return;
+  }
+
+  conn_hnr_->handle_connection(cfd, addr, addrlen, faddr_);
+}
+
+void AcceptHandler::enable() {
+  if (enabled_) {
+    return;
+  }
+
+  enabled_ = true;
+
+  if (io_uring_) {
+    accept_op_ = new IOUringOp{uring_acceptcb, this};
+
+    if (io_uring_->accept_multishot(faddr_->fd, accept_op_) == 0) {
       return;
     }
+
+    delete accept_op_;
+    accept_op_ = nullptr;
   }
 
-#ifndef HAVE_ACCEPT4
-  util::make_socket_nonblocking(cfd);
-  util::make_socket_closeonexec(cfd);
-#endif // !HAVE_ACCEPT4
+  ev_io_start(loop_, &wev_);
+}
+
+void AcceptHandler::disable() {
+  enabled_ = false;
+
+  ev_io_stop(loop_, &wev_);
 
-  conn_hnr_->handle_connection(cfd, &sockaddr.sa, addrlen, faddr_);
+  if (accept_op_) {
+    // The completions until the cancellation takes effect are
+    // handled by uring_acceptcb.
+    accept_op_->data = nullptr;
+    io_uring_->cancel(accept_op_);
+    accept_op_ = nullptr;
+  }
 }
 
-void AcceptHandler::enable() { ev_io_start(conn_hnr_->get_loop(), &wev_); }
+void AcceptHandler::sleep(ev_tstamp t) {
+  if (t == 0. || ev_is_active(&sleep_timer_)) {
+    return;
+  }
+
+  disable();
 
-void AcceptHandler::disable() { ev_io_stop(conn_hnr_->get_loop(), &wev_); }
+  ev_timer_set(&sleep_timer_, t, 0.);
+  ev_timer_start(loop_, &sleep_timer_);
+}
 
 int AcceptHandler::get_fd() const { return faddr_->fd; }
 
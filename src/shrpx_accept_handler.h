@@ -32,21 +32,48 @@
 namespace shrpx {
 
 class ConnectionHandler;
+class Worker;
+class IOUring;
+struct IOUringOp;
 struct UpstreamAddr;
 
 class AcceptHandler {
 public:
   AcceptHandler(const UpstreamAddr *faddr, ConnectionHandler *h);
+  // Creates AcceptHandler for the listening socket owned by |worker|.
+  // Accepted connections are handed to |worker| on its own event
+  // loop.
+  AcceptHandler(const UpstreamAddr *faddr, Worker *worker);
   ~AcceptHandler();
   void accept_connection();
+  // Handles the completion of multishot accept.  |res| is the
+  // accepted socket or negative error code.  |more| is false if the
+  // request has ended.
+  void uring_accept_connection(int32_t res, bool more);
   void enable();
   void disable();
+  // Disables this acceptor, and enables it again after |t| seconds.
+  void sleep(ev_tstamp t);
   int get_fd() const;
 
 private:
+  void handle_accept_error(int error);
+  void handle_accepted(int cfd, sockaddr *addr, socklen_t addrlen);
+
   ev_io wev_;
+  ev_timer sleep_timer_;
+  struct ev_loop *loop_;
   ConnectionHandler *conn_hnr_;
+  // Worker which owns the listening socket.  nullptr if the listening
+  // socket is shared by all workers and accepted on the main loop.
+  Worker *worker_;
   const UpstreamAddr *faddr_;
+  // If not nullptr, connections are accepted with multishot accept
+  // of this io_uring.
+  IOUring *io_uring_;
+  // Multishot accept request in flight.
+  IOUringOp *accept_op_;
+  bool enabled_;
 };
 
 } // namespace shrpx
@@ -35,13 +35,14 @@
 #include "shrpx_worker.h"
 #include "shrpx_connection_handler.h"
 #include "shrpx_log.h"
+#include "shrpx_metrics.h"
 
 namespace shrpx {
 
 namespace {
 // List of API endpoints
-const std::array<APIEndpoint, 2> &apis() {
-  static const auto apis = new std::array<APIEndpoint, 2>{
+const std::array<APIEndpoint, 3> &apis() {
+  static const auto apis = new std::array<APIEndpoint, 3>{
       APIEndpoint{
           StringRef::from_lit("/api/v1beta1/backendconfig"),
           true,
@@ -54,6 +55,12 @@ const std::array<APIEndpoint, 2> &apis() {
           (1 << API_METHOD_GET),
           &APIDownstreamConnection::handle_configrevision,
       },
+      APIEndpoint{
+          StringRef::from_lit("/metrics"),
+          false,
+          (1 << API_METHOD_GET),
+          &APIDownstreamConnection::handle_metrics,
+      },
   };
 
   return *apis;
@@ -167,6 +174,15 @@ int APIDownstreamConnection::send_reply(unsigned int http_status,
 namespace {
 const APIEndpoint *lookup_api(const StringRef &path) {
   switch (path.size()) {
+  case 8:
+    switch (path[7]) {
+    case 's':
+      if (util::streq_l("/metric", std::begin(path), 7)) {
+        return &apis()[2];
+      }
+      break;
+    }
+    break;
   case 26:
     switch (path[25]) {
     case 'g':
@@ -451,6 +467,60 @@ int APIDownstreamConnection::handle_configrevision() {
   return 0;
 }
 
+int APIDownstreamConnection::handle_metrics() {
+  auto conn_handler = worker_->get_connection_handler();
+
+  Metrics m{};
+
+  auto add = [&m](Worker *worker) {
+    auto mcpool = worker->get_mcpool();
+    auto stat_set = worker->get_backend_stat_set();
+
+    add_worker_metrics(m, *worker->get_worker_stat(), *mcpool,
+                       stat_set.get());
+  };
+
+  auto single_worker = conn_handler->get_single_worker();
+  if (single_worker) {
+    add(single_worker);
+  } else {
+    for (auto &worker : conn_handler->get_workers()) {
+      add(worker.get());
+    }
+  }
+
+  auto logstat = get_log_writer_stat();
+  m.log_written = logstat.written;
+  m.log_dropped = logstat.dropped;
+
+  std::string body;
+  format_metrics(body, m);
+
+  shutdown_read_ = true;
+
+  auto upstream = downstream_->get_upstream();
+  auto &resp = downstream_->response();
+  auto &balloc = downstream_->get_block_allocator();
+
+  resp.http_status = 200;
+
+  resp.fs.add_header_token(
+      StringRef::from_lit("content-type"),
+      StringRef::from_lit("text/plain; version=0.0.4; charset=utf-8"), false,
+      http2::HD_CONTENT_TYPE);
+  resp.fs.add_header_token(StringRef::from_lit("content-length"),
+                           util::make_string_ref_uint(balloc, body.size()),
+                           false, http2::HD_CONTENT_LENGTH);
+
+  if (upstream->send_reply(
+          downstream_, reinterpret_cast<const uint8_t *>(body.c_str()),
+          body.size()) != 0) {
+    return -1;
+  }
+
+  return 0;
+}
+
 void APIDownstreamConnection::pause_read(IOCtrlReason reason) {}
 
 int APIDownstreamConnection::resume_read(IOCtrlReason reason, size_t consumed) {
@@ -53,7 +53,8 @@ enum class APIStatusCode {
 class APIDownstreamConnection;
 
 struct APIEndpoint {
-  // Endpoint path.  It must start with "/api/".
+  // Endpoint path.  It must start with "/api/", except for
+  // "/metrics".
   StringRef path;
   // true if we evaluate request body.
   bool require_body;
@@ -98,6 +99,9 @@ public:
   int handle_backendconfig();
   // Handles configrevision API request.
   int handle_configrevision();
+  // Handles metrics request.  This returns the counters of all
+  // workers in Prometheus text exposition format.
+  int handle_metrics();
 
 private:
   Worker *worker_;
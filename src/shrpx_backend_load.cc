@@ -0,0 +1,126 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_backend_load.h"
+
+#include <cmath>
+
+#include "shrpx_connect_blocker.h"
+#include "shrpx_log.h"
+#include "shrpx_worker.h"
+
+namespace shrpx {
+
+namespace {
+// Returns the weight of ewma which is |elapsed| old.
+double decay_weight(std::chrono::steady_clock::duration elapsed) {
+  if (elapsed.count() <= 0) {
+    return 1.;
+  }
+
+  return std::exp(-std::chrono::duration<double>(elapsed).count() /
+                  std::chrono::duration<double>(BACKEND_LOAD_DECAY).count());
+}
+} // namespace
+
+void BackendLoad::observe(double rtt,
+                          std::chrono::steady_clock::time_point now) {
+  auto w = decay_weight(now - last_update);
+
+  if (rtt > ewma) {
+    ewma = rtt;
+  } else {
+    ewma = ewma * w + rtt * (1. - w);
+  }
+
+  last_update = now;
+}
+
+double BackendLoad::cost(std::chrono::steady_clock::time_point now) const {
+  // ewma decays toward 0 while no response is observed so that a
+  // backend which was slow once is tried again eventually.  1 is
+  // added so that the number of outstanding requests still matters
+  // when nothing is known about latency.
+  return (ewma * decay_weight(now - last_update) + 1.) * (outstanding + 1);
+}
+
+namespace {
+double weighted_cost(const DownstreamAddr *addr,
+                     std::chrono::steady_clock::time_point now) {
+  return addr->load.cost(now) / addr->weight;
+}
+} // namespace
+
+DownstreamAddr *select_p2c(const std::vector<DownstreamAddr *> &addrs,
+                           std::mt19937 &gen,
+                           std::chrono::steady_clock::time_point now) {
+  if (addrs.empty()) {
+    return nullptr;
+  }
+
+  if (addrs.size() > 1) {
+    auto i = std::uniform_int_distribution<size_t>(0, addrs.size() - 1)(gen);
+    auto j = std::uniform_int_distribution<size_t>(0, addrs.size() - 2)(gen);
+    if (j >= i) {
+      ++j;
+    }
+
+    auto a = addrs[i];
+    auto b = addrs[j];
+
+    auto a_blocked = a->connect_blocker->blocked();
+    auto b_blocked = b->connect_blocker->blocked();
+
+    if (!a_blocked && !b_blocked) {
+      return weighted_cost(a, now) <= weighted_cost(b, now) ? a : b;
+    }
+
+    if (!a_blocked) {
+      return a;
+    }
+
+    if (!b_blocked) {
+      return b;
+    }
+  }
+
+  DownstreamAddr *best = nullptr;
+  double best_cost = 0.;
+
+  for (auto addr : addrs) {
+    if (addr->connect_blocker->blocked()) {
+      continue;
+    }
+
+    auto c = weighted_cost(addr, now);
+    if (!best || c < best_cost) {
+      best = addr;
+      best_cost = c;
+    }
+  }
+
+  return best;
+}
+
+} // namespace shrpx
@@ -0,0 +1,74 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_BACKEND_LOAD_H
+#define SHRPX_BACKEND_LOAD_H
+
+#include "shrpx.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace shrpx {
+
+struct DownstreamAddr;
+
+// The time constant of the decay of BackendLoad::ewma.  A latency
+// sample loses 1/e of its weight after this period.
+constexpr auto BACKEND_LOAD_DECAY = std::chrono::seconds(10);
+
+// BackendLoad tracks how a backend address is performing in a worker.
+// It is used by p2c load balancing.
+struct BackendLoad {
+  // Adds a response latency sample |rtt| in microseconds which is
+  // observed at |now|.
+  void observe(double rtt, std::chrono::steady_clock::time_point now);
+  // Returns the cost of sending a new request to this address at
+  // |now|.  Lower is better.
+  double cost(std::chrono::steady_clock::time_point now) const;
+
+  // Peak EWMA of response latency in microseconds.  A sample larger
+  // than the current value replaces it immediately so that a slow
+  // backend is avoided at once, and it decays slowly afterwards.
+  double ewma;
+  // The time when ewma was last updated.
+  std::chrono::steady_clock::time_point last_update;
+  // The number of requests sent to this address which have not
+  // finished yet.
+  size_t outstanding;
+};
+
+// Chooses 2 distinct addresses from |addrs| at random using |gen|,
+// and returns the one with lower cost divided by its weight.  Blocked
+// addresses are skipped.  If both candidates are blocked, this
+// function returns the cheapest one among all addresses which are not
+// blocked, or nullptr if there is no such address.
+DownstreamAddr *select_p2c(const std::vector<DownstreamAddr *> &addrs,
+                           std::mt19937 &gen,
+                           std::chrono::steady_clock::time_point now);
+
+} // namespace shrpx
+
+#endif // SHRPX_BACKEND_LOAD_H
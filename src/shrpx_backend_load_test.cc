@@ -0,0 +1,136 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_backend_load_test.h"
+
+#include <cmath>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_backend_load.h"
+#include "shrpx_connect_blocker.h"
+#include "shrpx_log.h"
+#include "shrpx_worker.h"
+
+namespace shrpx {
+
+void test_shrpx_backend_load_ewma(void) {
+  BackendLoad load{};
+  auto now = std::chrono::steady_clock::now();
+
+  CU_ASSERT(1. == load.cost(now));
+
+  load.outstanding = 2;
+
+  CU_ASSERT(3. == load.cost(now));
+
+  // A larger sample replaces ewma immediately.
+  load.observe(1000., now);
+
+  CU_ASSERT(1000. == load.ewma);
+  CU_ASSERT(1001. * 3 == load.cost(now));
+
+  // A smaller sample observed at the same time has no weight.
+  load.observe(10., now);
+
+  CU_ASSERT(1000. == load.ewma);
+
+  // After BACKEND_LOAD_DECAY, the old value keeps 1/e of its weight.
+  now += BACKEND_LOAD_DECAY;
+  load.observe(0., now);
+
+  CU_ASSERT(std::fabs(1000. / std::exp(1.) - load.ewma) < 1e-6);
+
+  // ewma decays while no sample is observed.
+  load.outstanding = 0;
+  now += BACKEND_LOAD_DECAY;
+
+  CU_ASSERT(std::fabs(1000. / std::exp(2.) + 1. - load.cost(now)) < 1e-6);
+}
+
+void test_shrpx_backend_load_select_p2c(void) {
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  std::mt19937 gen(0);
+  auto now = std::chrono::steady_clock::now();
+
+  std::array<DownstreamAddr, 3> addrs{};
+  for (auto &addr : addrs) {
+    addr.connect_blocker =
+        std::make_unique<ConnectBlocker>(gen, loop, []() {}, []() {});
+    addr.weight = 1;
+  }
+
+  auto &a = addrs[0];
+  auto &b = addrs[1];
+  auto &c = addrs[2];
+
+  std::vector<DownstreamAddr *> cands{&a, &b};
+
+  CU_ASSERT(nullptr == select_p2c({}, gen, now));
+
+  // The slower address is avoided.
+  a.load.observe(50000., now);
+  b.load.observe(1000., now);
+
+  for (size_t i = 0; i < 10; ++i) {
+    CU_ASSERT(&b == select_p2c(cands, gen, now));
+  }
+
+  // Outstanding requests increase cost.
+  b.load.outstanding = 100;
+
+  CU_ASSERT(&a == select_p2c(cands, gen, now));
+
+  // Weight decreases cost.
+  a.load = BackendLoad{};
+  b.load = BackendLoad{};
+  a.weight = 4;
+  a.load.outstanding = 2;
+
+  CU_ASSERT(&a == select_p2c(cands, gen, now));
+
+  // Blocked addresses are skipped.
+  a.connect_blocker->offline();
+
+  CU_ASSERT(&b == select_p2c(cands, gen, now));
+
+  b.connect_blocker->offline();
+
+  CU_ASSERT(nullptr == select_p2c(cands, gen, now));
+
+  // If both candidates are blocked, the remaining one is found.
+  cands.push_back(&c);
+
+  for (size_t i = 0; i < 10; ++i) {
+    CU_ASSERT(&c == select_p2c(cands, gen, now));
+  }
+
+  for (auto &addr : addrs) {
+    addr.connect_blocker.reset();
+  }
+
+  ev_loop_destroy(loop);
+}
+
+} // namespace shrpx
@@ -0,0 +1,621 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_binlog.h"
+
+#include <cassert>
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "util.h"
+
+namespace shrpx {
+
+BinaryLogEncoder::BinaryLogEncoder(uint8_t *buf, size_t buflen)
+    : buf_(buf), pos_(buf + BINLOG_RECORD_HEADER_LENGTH), end_(buf + buflen) {
+  assert(buflen >= BINLOG_RECORD_HEADER_LENGTH);
+}
+
+uint8_t *BinaryLogEncoder::start_field(LogFragmentType type, size_t &len) {
+  if (static_cast<size_t>(end_ - pos_) < BINLOG_FIELD_HEADER_LENGTH) {
+    end_ = pos_;
+    return nullptr;
+  }
+
+  auto avail = std::min(
+      static_cast<size_t>(end_ - pos_) - BINLOG_FIELD_HEADER_LENGTH,
+      static_cast<size_t>(std::numeric_limits<uint16_t>::max()));
+  if (len > avail) {
+    len = avail;
+    // Nothing is written after the truncated field.
+    end_ = pos_ + BINLOG_FIELD_HEADER_LENGTH + len;
+  }
+
+  *pos_++ = static_cast<uint8_t>(type);
+  *pos_++ = len >> 8;
+  *pos_++ = len & 0xff;
+
+  auto payload = pos_;
+  pos_ += len;
+
+  return payload;
+}
+
+void BinaryLogEncoder::put_string(LogFragmentType type, const StringRef &s) {
+  put_bytes(type, s.byte(), s.size());
+}
+
+void BinaryLogEncoder::put_bytes(LogFragmentType type, const uint8_t *data,
+                                 size_t len) {
+  auto p = start_field(type, len);
+  if (!p) {
+    return;
+  }
+
+  std::copy_n(data, len, p);
+}
+
+void BinaryLogEncoder::put_uint(LogFragmentType type, uint64_t n) {
+  std::array<uint8_t, 8> b;
+  auto last = std::end(b);
+  auto first = last;
+
+  do {
+    *--first = n & 0xff;
+    n >>= 8;
+  } while (n);
+
+  size_t len = last - first;
+
+  if (static_cast<size_t>(end_ - pos_) < BINLOG_FIELD_HEADER_LENGTH + len) {
+    end_ = pos_;
+    return;
+  }
+
+  auto p = start_field(type, len);
+  std::copy(first, last, p);
+}
+
+void BinaryLogEncoder::put_time(
+    LogFragmentType type, const std::chrono::system_clock::time_point &tp) {
+  put_uint(type, std::chrono::duration_cast<std::chrono::milliseconds>(
+                     tp.time_since_epoch())
+                     .count());
+}
+
+void BinaryLogEncoder::put_time(LogFragmentType type, const Timestamp &ts) {
+  put_time(type, ts.tp);
+}
+
+void BinaryLogEncoder::put_absent(LogFragmentType type) {
+  size_t len = 0;
+  auto p = start_field(type, len);
+  if (!p) {
+    return;
+  }
+
+  *(p - BINLOG_FIELD_HEADER_LENGTH) |= BINLOG_ABSENT;
+}
+
+void BinaryLogEncoder::put_version(LogFragmentType type, int major,
+                                   int minor) {
+  std::array<uint8_t, 2> v{static_cast<uint8_t>(major),
+                           static_cast<uint8_t>(minor)};
+
+  if (static_cast<size_t>(end_ - pos_) <
+      BINLOG_FIELD_HEADER_LENGTH + v.size()) {
+    end_ = pos_;
+    return;
+  }
+
+  put_bytes(type, v.data(), v.size());
+}
+
+void BinaryLogEncoder::put_request(const StringRef &method,
+                                   const StringRef &path, int major,
+                                   int minor) {
+  auto methodlen = std::min(method.size(), static_cast<size_t>(255));
+  size_t len = 3 + methodlen + path.size();
+
+  if (static_cast<size_t>(end_ - pos_) <
+      BINLOG_FIELD_HEADER_LENGTH + 3 + methodlen) {
+    end_ = pos_;
+    return;
+  }
+
+  auto p = start_field(LogFragmentType::REQUEST, len);
+
+  *p++ = major;
+  *p++ = minor;
+  *p++ = methodlen;
+  p = std::copy_n(method.byte(), methodlen, p);
+  std::copy_n(path.byte(), len - 3 - methodlen, p);
+}
+
+size_t BinaryLogEncoder::finish() {
+  auto bodylen = pos_ - buf_ - BINLOG_RECORD_HEADER_LENGTH;
+
+  buf_[0] = bodylen >> 24;
+  buf_[1] = (bodylen >> 16) & 0xff;
+  buf_[2] = (bodylen >> 8) & 0xff;
+  buf_[3] = bodylen & 0xff;
+
+  return pos_ - buf_;
+}
+
+size_t binlog_write_file_header(uint8_t *buf) {
+  auto p = std::copy(std::begin(BINLOG_MAGIC), std::end(BINLOG_MAGIC), buf);
+  *p++ = BINLOG_VERSION;
+
+  return p - buf;
+}
+
+ssize_t binlog_decode_file_header(const uint8_t *data, size_t len) {
+  auto n = std::min(len, sizeof(BINLOG_MAGIC));
+
+  if (!std::equal(data, data + n, std::begin(BINLOG_MAGIC))) {
+    return -1;
+  }
+
+  if (len < BINLOG_FILE_HEADER_LENGTH) {
+    return 0;
+  }
+
+  if (data[sizeof(BINLOG_MAGIC)] != BINLOG_VERSION) {
+    return -2;
+  }
+
+  return BINLOG_FILE_HEADER_LENGTH;
+}
+
+ssize_t binlog_decode_record(std::vector<BinaryLogField> &fields,
+                             const uint8_t *data, size_t len) {
+  fields.clear();
+
+  if (len < BINLOG_RECORD_HEADER_LENGTH) {
+    return 0;
+  }
+
+  size_t bodylen = (static_cast<uint32_t>(data[0]) << 24) |
+                   (static_cast<uint32_t>(data[1]) << 16) |
+                   (static_cast<uint32_t>(data[2]) << 8) | data[3];
+
+  if (len - BINLOG_RECORD_HEADER_LENGTH < bodylen) {
+    return 0;
+  }
+
+  auto p = data + BINLOG_RECORD_HEADER_LENGTH;
+  auto end = p + bodylen;
+
+  for (; p != end;) {
+    if (static_cast<size_t>(end - p) < BINLOG_FIELD_HEADER_LENGTH) {
+      return -1;
+    }
+
+    auto type = *p & ~BINLOG_ABSENT;
+    auto absent = (*p & BINLOG_ABSENT) != 0;
+    size_t flen = (p[1] << 8) | p[2];
+
+    p += BINLOG_FIELD_HEADER_LENGTH;
+
+    if (static_cast<size_t>(end - p) < flen || (absent && flen)) {
+      return -1;
+    }
+
+    fields.push_back(BinaryLogField{static_cast<LogFragmentType>(type), absent,
+                                    StringRef{p, flen}});
+
+    p += flen;
+  }
+
+  return end - data;
+}
+
+namespace {
+// Decodes unsigned integer encoded in |s|.  This function returns
+// -1 if |s| is not a valid encoding.
+int decode_uint(uint64_t &n, const StringRef &s) {
+  if (s.empty() || s.size() > 8) {
+    return -1;
+  }
+
+  n = 0;
+  for (auto c : s) {
+    n = (n << 8) | static_cast<uint8_t>(c);
+  }
+
+  return 0;
+}
+} // namespace
+
+namespace {
+// Appends |s| to |out|, escaping the characters which text access
+// log escapes.
+void append_escape(std::string &out, const StringRef &s) {
+  for (auto c : s) {
+    auto b = static_cast<uint8_t>(c);
+    if (b < 0x20 || b >= 0x7f || b == '"' || b == '\\') {
+      out += "\\x";
+      out += util::LOWER_XDIGITS[b >> 4];
+      out += util::LOWER_XDIGITS[b & 0xf];
+      continue;
+    }
+    out += c;
+  }
+}
+} // namespace
+
+namespace {
+void append_version(std::string &out, uint8_t major, uint8_t minor) {
+  out += util::utos(major);
+  if (major < 2) {
+    out += '.';
+    out += util::utos(minor);
+  }
+}
+} // namespace
+
+namespace {
+// Appends the value of |f| to |out|.  If |escape| is true, strings
+// are escaped in the same way as text access log does.
+int append_value(std::string &out, const BinaryLogField &f, bool escape) {
+  auto &s = f.value;
+
+  switch (f.type) {
+  case LogFragmentType::REMOTE_ADDR:
+  case LogFragmentType::AUTHORITY:
+  case LogFragmentType::REMOTE_PORT:
+  case LogFragmentType::TLS_CIPHER:
+  case LogFragmentType::TLS_PROTOCOL:
+  case LogFragmentType::TLS_CLIENT_ISSUER_NAME:
+  case LogFragmentType::TLS_CLIENT_SERIAL:
+  case LogFragmentType::TLS_CLIENT_SUBJECT_NAME:
+  case LogFragmentType::BACKEND_HOST:
+  case LogFragmentType::METHOD:
+    out.append(std::begin(s), std::end(s));
+    return 0;
+  case LogFragmentType::HTTP:
+  case LogFragmentType::PATH:
+  case LogFragmentType::PATH_WITHOUT_QUERY:
+  case LogFragmentType::ALPN:
+  case LogFragmentType::TLS_SNI:
+    if (escape) {
+      append_escape(out, s);
+    } else {
+      out.append(std::begin(s), std::end(s));
+    }
+    return 0;
+  case LogFragmentType::TLS_SESSION_ID:
+  case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA1:
+  case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA256:
+    out += util::format_hex(s.byte(), s.size());
+    return 0;
+  case LogFragmentType::REQUEST: {
+    if (s.size() < 3 || s.size() - 3 < s.byte()[2]) {
+      return -1;
+    }
+    auto method = StringRef{s.byte() + 3, static_cast<size_t>(s.byte()[2])};
+    auto path = StringRef{method.byte() + method.size(), s.byte() + s.size()};
+    out.append(std::begin(method), std::end(method));
+    out += ' ';
+    if (escape) {
+      append_escape(out, path);
+    } else {
+      out.append(std::begin(path), std::end(path));
+    }
+    out += " HTTP/";
+    append_version(out, s.byte()[0], s.byte()[1]);
+    return 0;
+  }
+  case LogFragmentType::PROTOCOL_VERSION:
+    if (s.size() != 2) {
+      return -1;
+    }
+    out += "HTTP/";
+    append_version(out, s.byte()[0], s.byte()[1]);
+    return 0;
+  default:
+    break;
+  }
+
+  uint64_t n;
+  if (decode_uint(n, s) != 0) {
+    return -1;
+  }
+
+  switch (f.type) {
+  case LogFragmentType::TIME_LOCAL: {
+    std::array<char, sizeof("03/Jul/2014:00:19:38 +0900")> buf;
+    auto t = util::format_common_log(
+        buf.data(),
+        std::chrono::system_clock::time_point(std::chrono::milliseconds(n)));
+    out.append(std::begin(t), std::end(t));
+    return 0;
+  }
+  case LogFragmentType::TIME_ISO8601: {
+    std::array<char, sizeof("2014-11-15T12:58:24.741+09:00")> buf;
+    auto t = util::format_iso8601(
+        buf.data(),
+        std::chrono::system_clock::time_point(std::chrono::milliseconds(n)));
+    out.append(std::begin(t), std::end(t));
+    return 0;
+  }
+  case LogFragmentType::STATUS:
+  case LogFragmentType::BODY_BYTES_SENT:
+  case LogFragmentType::SERVER_PORT:
+  case LogFragmentType::PID:
+  case LogFragmentType::BACKEND_PORT:
+    out += util::utos(n);
+    return 0;
+  case LogFragmentType::REQUEST_TIME: {
+    out += util::utos(n / 1000);
+    out += '.';
+    auto frac = util::utos(n % 1000);
+    out.append(3 - frac.size(), '0');
+    out += frac;
+    return 0;
+  }
+  case LogFragmentType::TLS_SESSION_REUSED:
+    out += n ? 'r' : '.';
+    return 0;
+  default:
+    return -1;
+  }
+}
+} // namespace
+
+namespace {
+// Returns the field which corresponds to |lf|, or nullptr if the
+// record was truncated before it.  This function returns -1 if the
+// field type does not match.
+int next_field(const BinaryLogField *&f, const LogFragment &lf,
+               const std::vector<BinaryLogField> &fields, size_t &i) {
+  if (i == fields.size()) {
+    f = nullptr;
+    return 0;
+  }
+
+  f = &fields[i++];
+
+  if (f->type != lf.type) {
+    return -1;
+  }
+
+  return 0;
+}
+} // namespace
+
+int binlog_format_text(std::string &out, const std::vector<LogFragment> &lfv,
+                       const std::vector<BinaryLogField> &fields) {
+  size_t i = 0;
+
+  for (auto &lf : lfv) {
+    switch (lf.type) {
+    case LogFragmentType::NONE:
+      continue;
+    case LogFragmentType::LITERAL:
+      out.append(std::begin(lf.value), std::end(lf.value));
+      continue;
+    default:
+      break;
+    }
+
+    const BinaryLogField *f;
+    if (next_field(f, lf, fields, i) != 0) {
+      return -1;
+    }
+
+    if (!f || f->absent) {
+      out += '-';
+      continue;
+    }
+
+    if (append_value(out, *f, true) != 0) {
+      return -1;
+    }
+  }
+
+  if (i != fields.size()) {
+    return -1;
+  }
+
+  return 0;
+}
+
+namespace {
+// Returns the name of log variable |lf|.
+std::string log_var_name(const LogFragment &lf) {
+  switch (lf.type) {
+  case LogFragmentType::REMOTE_ADDR:
+    return "remote_addr";
+  case LogFragmentType::TIME_LOCAL:
+    return "time_local";
+  case LogFragmentType::TIME_ISO8601:
+    return "time_iso8601";
+  case LogFragmentType::REQUEST:
+    return "request";
+  case LogFragmentType::STATUS:
+    return "status";
+  case LogFragmentType::BODY_BYTES_SENT:
+    return "body_bytes_sent";
+  case LogFragmentType::HTTP: {
+    auto name = std::string{"http_"};
+    for (auto c : lf.value) {
+      name += c == '-' ? '_' : c;
+    }
+    return name;
+  }
+  case LogFragmentType::AUTHORITY:
+    return "http_host";
+  case LogFragmentType::REMOTE_PORT:
+    return "remote_port";
+  case LogFragmentType::SERVER_PORT:
+    return "server_port";
+  case LogFragmentType::REQUEST_TIME:
+    return "request_time";
+  case LogFragmentType::PID:
+    return "pid";
+  case LogFragmentType::ALPN:
+    return "alpn";
+  case LogFragmentType::TLS_CIPHER:
+    return "tls_cipher";
+  case LogFragmentType::TLS_PROTOCOL:
+    return "tls_protocol";
+  case LogFragmentType::TLS_SESSION_ID:
+    return "tls_session_id";
+  case LogFragmentType::TLS_SESSION_REUSED:
+    return "tls_session_reused";
+  case LogFragmentType::TLS_SNI:
+    return "tls_sni";
+  case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA1:
+    return "tls_client_fingerprint_sha1";
+  case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA256:
+    return "tls_client_fingerprint_sha256";
+  case LogFragmentType::TLS_CLIENT_ISSUER_NAME:
+    return "tls_client_issuer_name";
+  case LogFragmentType::TLS_CLIENT_SERIAL:
+    return "tls_client_serial";
+  case LogFragmentType::TLS_CLIENT_SUBJECT_NAME:
+    return "tls_client_subject_name";
+  case LogFragmentType::BACKEND_HOST:
+    return "backend_host";
+  case LogFragmentType::BACKEND_PORT:
+    return "backend_port";
+  case LogFragmentType::METHOD:
+    return "method";
+  case LogFragmentType::PATH:
+    return "path";
+  case LogFragmentType::PATH_WITHOUT_QUERY:
+    return "path_without_query";
+  case LogFragmentType::PROTOCOL_VERSION:
+    return "protocol_version";
+  default:
+    return "";
+  }
+}
+} // namespace
+
+namespace {
+void append_json_string(std::string &out, const StringRef &s) {
+  out += '"';
+  for (auto c : s) {
+    auto b = static_cast<uint8_t>(c);
+    switch (b) {
+    case '"':
+      out += "\\\"";
+      continue;
+    case '\\':
+      out += "\\\\";
+      continue;
+    }
+    if (b < 0x20 || b == 0x7f) {
+      out += "\\u00";
+      out += util::LOWER_XDIGITS[b >> 4];
+      out += util::LOWER_XDIGITS[b & 0xf];
+      continue;
+    }
+    out += c;
+  }
+  out += '"';
+}
+} // namespace
+
+int binlog_format_json(std::string &out, const std::vector<LogFragment> &lfv,
+                       const std::vector<BinaryLogField> &fields) {
+  size_t i = 0;
+  auto first = true;
+  std::string v;
+
+  out += '{';
+
+  for (auto &lf : lfv) {
+    switch (lf.type) {
+    case LogFragmentType::NONE:
+    case LogFragmentType::LITERAL:
+      continue;
+    default:
+      break;
+    }
+
+    const BinaryLogField *f;
+    if (next_field(f, lf, fields, i) != 0) {
+      return -1;
+    }
+
+    if (first) {
+      first = false;
+    } else {
+      out += ',';
+    }
+
+    append_json_string(out, StringRef{log_var_name(lf)});
+    out += ':';
+
+    if (!f || f->absent) {
+      out += "null";
+      continue;
+    }
+
+    switch (f->type) {
+    case LogFragmentType::STATUS:
+    case LogFragmentType::BODY_BYTES_SENT:
+    case LogFragmentType::SERVER_PORT:
+    case LogFragmentType::PID:
+    case LogFragmentType::BACKEND_PORT:
+    case LogFragmentType::REQUEST_TIME:
+      if (append_value(out, *f, false) != 0) {
+        return -1;
+      }
+      continue;
+    case LogFragmentType::TLS_SESSION_REUSED: {
+      uint64_t n;
+      if (decode_uint(n, f->value) != 0) {
+        return -1;
+      }
+      out += n ? "true" : "false";
+      continue;
+    }
+    default:
+      break;
+    }
+
+    v.clear();
+    if (append_value(v, *f, false) != 0) {
+      return -1;
+    }
+
+    append_json_string(out, StringRef{v});
+  }
+
+  if (i < fields.size()) {
+    return -1;
+  }
+
+  out += '}';
+
+  return 0;
+}
+
+} // namespace shrpx
@@ -0,0 +1,153 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_BINLOG_H
+#define SHRPX_BINLOG_H
+
+#include "shrpx.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "shrpx_log.h"
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+// Binary access log file starts with the file header:
+//
+//   +-----------------------+------------------+
+//   | magic (7 bytes)       | version (8 bits) |
+//   +-----------------------+------------------+
+//
+// magic is BINLOG_MAGIC, and version is BINLOG_VERSION.  The first
+// byte of magic never starts a valid record, so that a file header
+// can appear again between records, e.g., if files are concatenated.
+// The file header is followed by records.
+//
+// Binary access log record is laid out as follows:
+//
+//   +------------------------+
+//   | body length (32 bits)  |
+//   +------------------------+
+//   | field ...              |
+//   +------------------------+
+//
+// Each field is:
+//
+//   +---------------+------------------+---------------+
+//   | type (8 bits) | length (16 bits) | payload ...   |
+//   +---------------+------------------+---------------+
+//
+// All integers are in network byte order.  type is the value of
+// LogFragmentType.  If BINLOG_ABSENT bit is set in type, the value
+// is not available, and it is written as "-" in text log.  LITERAL
+// fragments are not recorded; they are taken from the log format
+// when a record is decoded.  Timestamps are milliseconds since the
+// epoch, and strings are recorded without escaping.
+constexpr uint8_t BINLOG_ABSENT = 0x80;
+
+constexpr uint8_t BINLOG_MAGIC[] = {0xff, 'N', 'G', 'H', 'X', 'L', 'G'};
+constexpr uint8_t BINLOG_VERSION = 1;
+
+constexpr size_t BINLOG_FILE_HEADER_LENGTH = sizeof(BINLOG_MAGIC) + 1;
+
+constexpr size_t BINLOG_RECORD_HEADER_LENGTH = 4;
+constexpr size_t BINLOG_FIELD_HEADER_LENGTH = 3;
+
+// BinaryLogEncoder writes fields into the given buffer.  If a field
+// does not fit into the buffer, it is truncated, and the subsequent
+// fields are dropped.
+class BinaryLogEncoder {
+public:
+  BinaryLogEncoder(uint8_t *buf, size_t buflen);
+
+  // Literal text is not recorded.
+  void put_literal(const StringRef &s) {}
+  void put_string(LogFragmentType type, const StringRef &s);
+  void put_bytes(LogFragmentType type, const uint8_t *data, size_t len);
+  void put_uint(LogFragmentType type, uint64_t n);
+  void put_time(LogFragmentType type,
+                const std::chrono::system_clock::time_point &tp);
+  void put_time(LogFragmentType type, const Timestamp &ts);
+  void put_absent(LogFragmentType type);
+  void put_version(LogFragmentType type, int major, int minor);
+  void put_request(const StringRef &method, const StringRef &path, int major,
+                   int minor);
+  // Fills record header, and returns the length of the record.
+  size_t finish();
+
+private:
+  // Writes field header, and returns the pointer to the payload.
+  // The payload is capped to fit in the buffer.  This function
+  // returns nullptr if even the field header does not fit.
+  uint8_t *start_field(LogFragmentType type, size_t &len);
+
+  uint8_t *buf_, *pos_, *end_;
+};
+
+struct BinaryLogField {
+  LogFragmentType type;
+  bool absent;
+  StringRef value;
+};
+
+// Writes the file header to |buf| which must have at least
+// BINLOG_FILE_HEADER_LENGTH bytes.  This function returns the
+// number of bytes written.
+size_t binlog_write_file_header(uint8_t *buf);
+
+// Decodes the file header in |data| of length |len|.  This function
+// returns the number of bytes consumed, 0 if |data| does not contain
+// a complete header, -1 if |data| does not start with the file
+// header, or -2 if the version is not supported.
+ssize_t binlog_decode_file_header(const uint8_t *data, size_t len);
+
+// Decodes a binary log record in |data| of length |len|, and stores
+// its fields in |fields|.  The values in |fields| point to |data|.
+// This function returns the number of bytes consumed, 0 if |data|
+// does not contain a complete record, or -1 if the record is
+// malformed.
+ssize_t binlog_decode_record(std::vector<BinaryLogField> &fields,
+                             const uint8_t *data, size_t len);
+
+// Appends the text representation of |fields| formatted by |lfv| to
+// |out|, which is the same line that text access log produces.  This
+// function returns 0 if it succeeds, or -1 if |fields| is not
+// produced by |lfv|.
+int binlog_format_text(std::string &out, const std::vector<LogFragment> &lfv,
+                       const std::vector<BinaryLogField> &fields);
+
+// Appends a JSON object of |fields| to |out|.  Variable names in
+// |lfv| are used as keys.  This function returns 0 if it succeeds,
+// or -1 if |fields| is not produced by |lfv|.
+int binlog_format_json(std::string &out, const std::vector<LogFragment> &lfv,
+                       const std::vector<BinaryLogField> &fields);
+
+} // namespace shrpx
+
+#endif // SHRPX_BINLOG_H
@@ -0,0 +1,201 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_binlog_test.h"
+
+#include <array>
+#include <string>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_binlog.h"
+#include "shrpx_config.h"
+#include "util.h"
+
+namespace shrpx {
+
+namespace {
+constexpr auto TEST_FORMAT = StringRef::from_lit(
+    R"($remote_addr [$time_iso8601] "$request" $status $body_bytes_sent )"
+    R"("$http_user_agent" $request_time $tls_session_reused $tls_session_id )"
+    R"($http_x_forwarded_for $backend_port)");
+} // namespace
+
+namespace {
+const auto TEST_TIME = std::chrono::system_clock::time_point(
+    std::chrono::milliseconds(1700000000123));
+} // namespace
+
+namespace {
+// Encodes a record for TEST_FORMAT into |buf|, and returns its
+// length.
+size_t encode_record(uint8_t *buf, size_t buflen) {
+  BinaryLogEncoder enc(buf, buflen);
+  const uint8_t sid[] = {0xde, 0xad, 0xbe, 0xef};
+
+  enc.put_string(LogFragmentType::REMOTE_ADDR,
+                 StringRef::from_lit("127.0.0.1"));
+  enc.put_time(LogFragmentType::TIME_ISO8601, TEST_TIME);
+  enc.put_request(StringRef::from_lit("GET"),
+                  StringRef::from_lit("/a\"b?c=\x01"), 1, 1);
+  enc.put_uint(LogFragmentType::STATUS, 200);
+  enc.put_uint(LogFragmentType::BODY_BYTES_SENT, 1234567890123);
+  enc.put_string(LogFragmentType::HTTP, StringRef::from_lit("curl/8.0"));
+  enc.put_uint(LogFragmentType::REQUEST_TIME, 1005);
+  enc.put_uint(LogFragmentType::TLS_SESSION_REUSED, 1);
+  enc.put_bytes(LogFragmentType::TLS_SESSION_ID, sid, sizeof(sid));
+  enc.put_absent(LogFragmentType::HTTP);
+  enc.put_uint(LogFragmentType::BACKEND_PORT, 8080);
+
+  return enc.finish();
+}
+} // namespace
+
+void test_shrpx_binlog_format_text(void) {
+  BlockAllocator balloc(1024, 1024);
+  auto lfv = parse_log_format(balloc, TEST_FORMAT);
+  std::array<uint8_t, 4096> buf;
+  std::vector<BinaryLogField> fields;
+  std::array<char, sizeof("2014-11-15T12:58:24.741+09:00")> tbuf;
+
+  auto len = encode_record(buf.data(), buf.size());
+
+  CU_ASSERT(static_cast<ssize_t>(len) ==
+            binlog_decode_record(fields, buf.data(), len));
+  CU_ASSERT(11 == fields.size());
+
+  std::string out;
+
+  CU_ASSERT(0 == binlog_format_text(out, lfv, fields));
+  CU_ASSERT(
+      "127.0.0.1 [" + util::format_iso8601(tbuf.data(), TEST_TIME).str() +
+          R"(] "GET /a\x22b?c=\x01 HTTP/1.1" 200 1234567890123 "curl/8.0" )"
+          "1.005 r deadbeef - 8080" ==
+      out);
+
+  // Fields are missing after the buffer is exhausted.
+  len = encode_record(buf.data(), 40);
+
+  CU_ASSERT(40 == len);
+  CU_ASSERT(static_cast<ssize_t>(len) ==
+            binlog_decode_record(fields, buf.data(), len));
+  CU_ASSERT(3 == fields.size());
+
+  out.clear();
+
+  CU_ASSERT(0 == binlog_format_text(out, lfv, fields));
+  CU_ASSERT(
+      util::starts_with(StringRef{out}, StringRef::from_lit("127.0.0.1 [")));
+  CU_ASSERT(util::ends_with(
+      StringRef{out},
+      StringRef::from_lit(R"( "GET /a\x22b?c HTTP/1.1" - - "-" - - - - -)")));
+
+  // Format does not match.
+  lfv = parse_log_format(balloc, StringRef::from_lit("$remote_addr $status"));
+  out.clear();
+
+  CU_ASSERT(-1 == binlog_format_text(out, lfv, fields));
+}
+
+void test_shrpx_binlog_format_json(void) {
+  BlockAllocator balloc(1024, 1024);
+  auto lfv = parse_log_format(balloc, TEST_FORMAT);
+  std::array<uint8_t, 4096> buf;
+  std::vector<BinaryLogField> fields;
+  std::array<char, sizeof("2014-11-15T12:58:24.741+09:00")> tbuf;
+
+  auto len = encode_record(buf.data(), buf.size());
+
+  CU_ASSERT(static_cast<ssize_t>(len) ==
+            binlog_decode_record(fields, buf.data(), len));
+
+  std::string out;
+
+  CU_ASSERT(0 == binlog_format_json(out, lfv, fields));
+  CU_ASSERT(R"({"remote_addr":"127.0.0.1","time_iso8601":")" +
+                util::format_iso8601(tbuf.data(), TEST_TIME).str() +
+                R"(","request":"GET /a\"b?c=\u0001 HTTP/1.1","status":200,)"
+                R"("body_bytes_sent":1234567890123,)"
+                R"("http_user_agent":"curl/8.0","request_time":1.005,)"
+                R"("tls_session_reused":true,"tls_session_id":"deadbeef",)"
+                R"("http_x_forwarded_for":null,"backend_port":8080})" == out);
+}
+
+void test_shrpx_binlog_decode_record(void) {
+  std::array<uint8_t, 4096> buf;
+  std::vector<BinaryLogField> fields;
+
+  auto len = encode_record(buf.data(), buf.size());
+
+  // Incomplete record
+  CU_ASSERT(0 == binlog_decode_record(fields, buf.data(), 3));
+  CU_ASSERT(0 == binlog_decode_record(fields, buf.data(), len - 1));
+
+  // Field overruns the record.
+  buf[BINLOG_RECORD_HEADER_LENGTH + 1] = 0xff;
+
+  CU_ASSERT(-1 == binlog_decode_record(fields, buf.data(), len));
+
+  // Absent field with payload
+  len = encode_record(buf.data(), buf.size());
+  buf[BINLOG_RECORD_HEADER_LENGTH] |= BINLOG_ABSENT;
+
+  CU_ASSERT(-1 == binlog_decode_record(fields, buf.data(), len));
+
+  // Two records in a row
+  len = encode_record(buf.data(), buf.size());
+  std::copy_n(std::begin(buf), len, std::begin(buf) + len);
+
+  CU_ASSERT(static_cast<ssize_t>(len) ==
+            binlog_decode_record(fields, buf.data(), len * 2));
+  CU_ASSERT(static_cast<ssize_t>(len) ==
+            binlog_decode_record(fields, buf.data() + len, len));
+}
+
+void test_shrpx_binlog_file_header(void) {
+  std::array<uint8_t, 4096> buf;
+
+  auto len = binlog_write_file_header(buf.data());
+
+  CU_ASSERT(BINLOG_FILE_HEADER_LENGTH == len);
+  CU_ASSERT(static_cast<ssize_t>(len) ==
+            binlog_decode_file_header(buf.data(), len));
+
+  // Incomplete header
+  CU_ASSERT(0 == binlog_decode_file_header(buf.data(), 0));
+  CU_ASSERT(0 == binlog_decode_file_header(buf.data(), len - 1));
+
+  // Unsupported version
+  buf[len - 1] = BINLOG_VERSION + 1;
+
+  CU_ASSERT(-2 == binlog_decode_file_header(buf.data(), len));
+
+  // A record is not a file header.
+  len = encode_record(buf.data(), buf.size());
+
+  CU_ASSERT(-1 == binlog_decode_file_header(buf.data(), len));
+  CU_ASSERT(BINLOG_MAGIC[0] != buf[0]);
+}
+
+} // namespace shrpx
@@ -0,0 +1,185 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_cache_downstream_connection.h"
+#include "shrpx_client_handler.h"
+#include "shrpx_upstream.h"
+#include "shrpx_downstream.h"
+#include "shrpx_response_cache.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+CacheDownstreamConnection::CacheDownstreamConnection(
+    const std::shared_ptr<DownstreamAddrGroup> &group,
+    std::shared_ptr<const ResponseCacheEntry> ent)
+    : group_(group),
+      ent_(std::move(ent)),
+      body_chunk_(nullptr),
+      sending_body_(false) {}
+
+CacheDownstreamConnection::~CacheDownstreamConnection() {}
+
+int CacheDownstreamConnection::attach_downstream(Downstream *downstream) {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Attaching to DOWNSTREAM:" << downstream;
+  }
+
+  downstream_ = downstream;
+
+  return 0;
+}
+
+void CacheDownstreamConnection::detach_downstream(Downstream *downstream) {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Detaching from DOWNSTREAM:" << downstream;
+  }
+  downstream_ = nullptr;
+}
+
+int CacheDownstreamConnection::push_request_headers() {
+  downstream_->set_request_header_sent(true);
+  auto src = downstream_->get_blocked_request_buf();
+  auto dest = downstream_->get_request_buf();
+  src->remove(*dest);
+
+  return 0;
+}
+
+int CacheDownstreamConnection::push_upload_data_chunk(const uint8_t *data,
+                                                      size_t datalen) {
+  return 0;
+}
+
+int CacheDownstreamConnection::end_upload_data() {
+  auto upstream = downstream_->get_upstream();
+  auto handler = upstream->get_client_handler();
+  auto &resp = downstream_->response();
+  auto &balloc = downstream_->get_block_allocator();
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Serving response from cache: " << ent_->key;
+  }
+
+  resp.http_status = ent_->http_status;
+
+  for (auto &kv : ent_->headers) {
+    auto name = make_string_ref(balloc, StringRef{kv.first});
+    auto value = make_string_ref(balloc, StringRef{kv.second});
+    resp.fs.add_header_token(name, value, false, http2::lookup_token(name));
+  }
+
+  auto age = static_cast<uint64_t>(
+      std::max(ev_now(handler->get_loop()) - ent_->date, 0.));
+
+  resp.fs.add_header_token(StringRef::from_lit("age"),
+                           util::make_string_ref_uint(balloc, age), false, -1);
+
+  auto bodylen = ent_->body.rleft();
+
+  // 204 and 304 responses must not have content-length which
+  // describes the body they do not have.
+  if (ent_->http_status != 204 && ent_->http_status != 304) {
+    resp.fs.add_header_token(StringRef::from_lit("content-length"),
+                             util::make_string_ref_uint(balloc, bodylen),
+                             false, http2::HD_CONTENT_LENGTH);
+    resp.fs.content_length = bodylen;
+  }
+
+  downstream_->set_response_state(DownstreamState::HEADER_COMPLETE);
+
+  if (upstream->on_downstream_header_complete(downstream_) != 0) {
+    return -1;
+  }
+
+  body_chunk_ = ent_->body.head;
+  sending_body_ = true;
+
+  return send_body();
+}
+
+int CacheDownstreamConnection::send_body() {
+  auto upstream = downstream_->get_upstream();
+  auto handler = upstream->get_client_handler();
+  auto &resp = downstream_->response();
+
+  for (; body_chunk_; body_chunk_ = body_chunk_->next) {
+    if (downstream_->response_buf_full()) {
+      handler->signal_write();
+
+      return 0;
+    }
+
+    auto m = body_chunk_;
+
+    resp.recv_body_length += m->len();
+
+    if (upstream->on_downstream_body(downstream_, m->pos, m->len(), true) !=
+        0) {
+      return -1;
+    }
+  }
+
+  sending_body_ = false;
+
+  downstream_->set_response_state(DownstreamState::MSG_COMPLETE);
+
+  if (upstream->on_downstream_body_complete(downstream_) != 0) {
+    return -1;
+  }
+
+  handler->signal_write();
+
+  return 0;
+}
+
+void CacheDownstreamConnection::pause_read(IOCtrlReason reason) {}
+
+int CacheDownstreamConnection::resume_read(IOCtrlReason reason,
+                                           size_t consumed) {
+  if (!downstream_ || !sending_body_) {
+    return 0;
+  }
+
+  return send_body();
+}
+
+void CacheDownstreamConnection::force_resume_read() {}
+
+int CacheDownstreamConnection::on_read() { return 0; }
+
+int CacheDownstreamConnection::on_write() { return 0; }
+
+void CacheDownstreamConnection::on_upstream_change(Upstream *upstream) {}
+
+bool CacheDownstreamConnection::poolable() const { return false; }
+
+const std::shared_ptr<DownstreamAddrGroup> &
+CacheDownstreamConnection::get_downstream_addr_group() const {
+  return group_;
+}
+
+DownstreamAddr *CacheDownstreamConnection::get_addr() const { return nullptr; }
+
+} // namespace shrpx
@@ -0,0 +1,83 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_CACHE_DOWNSTREAM_CONNECTION_H
+#define SHRPX_CACHE_DOWNSTREAM_CONNECTION_H
+
+#include "shrpx_downstream_connection.h"
+#include "memchunk.h"
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+struct ResponseCacheEntry;
+
+// CacheDownstreamConnection serves a response stored in
+// ResponseCache without contacting backend.
+class CacheDownstreamConnection : public DownstreamConnection {
+public:
+  CacheDownstreamConnection(const std::shared_ptr<DownstreamAddrGroup> &group,
+                            std::shared_ptr<const ResponseCacheEntry> ent);
+  virtual ~CacheDownstreamConnection();
+  virtual int attach_downstream(Downstream *downstream);
+  virtual void detach_downstream(Downstream *downstream);
+
+  virtual int push_request_headers();
+  virtual int push_upload_data_chunk(const uint8_t *data, size_t datalen);
+  virtual int end_upload_data();
+
+  virtual void pause_read(IOCtrlReason reason);
+  virtual int resume_read(IOCtrlReason reason, size_t consumed);
+  virtual void force_resume_read();
+
+  virtual int on_read();
+  virtual int on_write();
+
+  virtual void on_upstream_change(Upstream *upstream);
+
+  // true if this object is poolable.
+  virtual bool poolable() const;
+
+  virtual const std::shared_ptr<DownstreamAddrGroup> &
+  get_downstream_addr_group() const;
+  virtual DownstreamAddr *get_addr() const;
+
+private:
+  // Feeds the cached body to upstream until the response buffer
+  // gets full.  The rest is sent when upstream calls resume_read().
+  int send_body();
+
+  std::shared_ptr<DownstreamAddrGroup> group_;
+  std::shared_ptr<const ResponseCacheEntry> ent_;
+  // The next chunk of the cached body to send.
+  const SizedMemchunk *body_chunk_;
+  // true while the body is being sent.
+  bool sending_body_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_CACHE_DOWNSTREAM_CONNECTION_H
@@ -42,6 +42,7 @@
 #include "shrpx_config.h"
 #include "shrpx_http_downstream_connection.h"
 #include "shrpx_http2_downstream_connection.h"
+#include "shrpx_http2_backend_io_downstream_connection.h"
 #include "shrpx_tls.h"
 #include "shrpx_worker.h"
 #include "shrpx_downstream_connection_pool.h"
@@ -51,6 +52,13 @@
 #include "shrpx_api_downstream_connection.h"
 #include "shrpx_health_monitor_downstream_connection.h"
 #include "shrpx_null_downstream_connection.h"
+#include "shrpx_cache_downstream_connection.h"
+#include "shrpx_response_cache.h"
+#include "shrpx_collapsed_request.h"
+#include "shrpx_collapsed_downstream_connection.h"
+#include "shrpx_splice_pipe.h"
+#include "shrpx_zerocopy.h"
+#include "shrpx_io_uring.h"
 #ifdef ENABLE_HTTP3
 #  include "shrpx_http3_upstream.h"
 #endif // ENABLE_HTTP3
@@ -129,6 +137,10 @@ int ClientHandler::read_clear() {
     }
 
     if (!ev_is_active(&conn_.rev) || should_break) {
+      if (rb_.rleft() == 0) {
+        // Do not keep the buffer while the connection is idle.
+        rb_.release_chunk();
+      }
       return 0;
     }
 
@@ -160,10 +172,44 @@ int ClientHandler::write_clear() {
 
     auto iovcnt = upstream_->response_riovec(iov.data(), iov.size());
     if (iovcnt == 0) {
-      break;
+      auto pipe = upstream_->response_pipe();
+      if (!pipe) {
+        break;
+      }
+
+      auto nwrite = conn_.splice_write(*pipe);
+      if (nwrite < 0) {
+        return -1;
+      }
+
+      if (nwrite == 0) {
+        return 0;
+      }
+
+      upstream_->response_pipe_drain(nwrite);
+
+      continue;
+    }
+
+    ssize_t nwrite;
+
+    if (zerocopy_ &&
+        zerocopy_->eligible(iov[0].iov_len +
+                            (iovcnt == 2 ? iov[1].iov_len : 0))) {
+      bool zerocopy;
+
+      nwrite = conn_.writev_zerocopy(iov.data(), iovcnt, &zerocopy);
+      if (nwrite > 0) {
+        if (zerocopy) {
+          zerocopy_->on_send();
+        } else {
+          zerocopy_->on_copy_fallback();
+        }
+      }
+    } else {
+      nwrite = conn_.writev_clear(iov.data(), iovcnt);
     }
 
-    auto nwrite = conn_.writev_clear(iov.data(), iovcnt);
     if (nwrite < 0) {
       return -1;
     }
@@ -172,7 +218,24 @@ int ClientHandler::write_clear() {
       return 0;
     }
 
-    upstream_->response_drain(nwrite);
+    if (conn_.uring) {
+      // conn_.uring sends the memory we have just drained later.
+      DefaultMemchunks pinned(worker_->get_mcpool());
+
+      upstream_->response_drain(nwrite, pinned);
+
+      conn_.uring->pin(std::move(pinned));
+    } else if (zerocopy_ && zerocopy_->pending()) {
+      // The kernel may still read the memory we have just drained.
+      DefaultMemchunks pinned(worker_->get_mcpool());
+
+      upstream_->response_drain(nwrite, pinned);
+
+      zerocopy_->pin(std::move(pinned));
+      zerocopy_->read_completions();
+    } else {
+      upstream_->response_drain(nwrite);
+    }
   }
 
   conn_.wlimit.stopw();
@@ -229,6 +292,13 @@ int ClientHandler::tls_handshake() {
     CLOG(INFO, this) << "SSL/TLS handshake completed";
   }
 
+  auto worker_stat = worker_->get_worker_stat();
+
+  stat_add(worker_stat->tls_handshakes);
+  if (SSL_session_reused(conn_.tls.ssl)) {
+    stat_add(worker_stat->tls_resumed_handshakes);
+  }
+
   if (validate_next_proto() != 0) {
     return -1;
   }
@@ -259,6 +329,10 @@ int ClientHandler::read_tls() {
     }
 
     if (!ev_is_active(&conn_.rev) || should_break) {
+      if (rb_.rleft() == 0) {
+        // Do not keep the buffer while the connection is idle.
+        rb_.release_chunk();
+      }
       return 0;
     }
 
@@ -291,6 +365,19 @@ int ClientHandler::write_tls() {
 
   auto iovcnt = upstream_->response_riovec(&iov, 1);
   if (iovcnt == 0) {
+    auto pipe = upstream_->response_pipe();
+    if (pipe) {
+      // Response body is written to kernel TLS socket directly.
+      auto nwrite = conn_.splice_write(*pipe);
+      if (nwrite < 0) {
+        return -1;
+      }
+
+      upstream_->response_pipe_drain(nwrite);
+
+      return 0;
+    }
+
     conn_.start_tls_write_idle();
 
     conn_.wlimit.stopw();
@@ -459,18 +546,41 @@ ClientHandler::ClientHandler(Worker *worker, int fd, SSL *ssl,
       should_close_after_write_(false),
       affinity_hash_computed_(false) {
 
-  ++worker_->get_worker_stat()->num_connections;
+  auto worker_stat = worker_->get_worker_stat();
+
+  stat_add(worker_stat->num_connections);
+  stat_add(worker_stat->connections_total);
 
   ev_timer_init(&reneg_shutdown_timer_, shutdowncb, 0., 0.);
 
   reneg_shutdown_timer_.data = this;
 
+  auto config = get_config();
+
+  if (!ssl && !faddr->quic && !faddr_->accept_proxy_protocol &&
+      !config->conn.upstream.accept_proxy_protocol &&
+      worker_->get_io_uring()) {
+    conn_.uring = new IOUringSocket(worker_->get_io_uring(), &conn_,
+                                    worker_->get_mcpool());
+    // conn_.uring feeds events to these watchers.
+    ev_io_set(&conn_.rev, fd, 0);
+    ev_io_set(&conn_.wev, fd, 0);
+    conn_.wlimit.set_feed_write(true);
+    conn_.uring->start();
+  }
+
   if (!faddr->quic) {
     conn_.rlimit.startw();
   }
   ev_timer_again(conn_.loop, &conn_.rt);
 
-  auto config = get_config();
+  if (!ssl && !faddr->quic && !conn_.uring &&
+      (family == AF_INET || family == AF_INET6) &&
+      config->conn.upstream.zerocopy_threshold &&
+      conn_.enable_zerocopy() == 0) {
+    zerocopy_ = std::make_unique<ZerocopyTracker>(
+        worker_, fd, config->conn.upstream.zerocopy_threshold);
+  }
 
   if (!faddr->quic) {
     if (faddr_->accept_proxy_protocol ||
@@ -561,11 +671,31 @@ ClientHandler::~ClientHandler() {
   }
 
   if (upstream_) {
+    if ((zerocopy_ && zerocopy_->pending()) ||
+        (conn_.uring && conn_.uring->write_pending())) {
+      // The kernel may still read the head chunk of response buffer
+      // which was partially sent.  Move the whole buffer to
+      // zerocopy_ or conn_.uring so that it is not recycled until the
+      // sends complete.
+      DefaultMemchunks pinned(worker_->get_mcpool());
+      iovec iov;
+
+      while (upstream_->response_riovec(&iov, 1)) {
+        upstream_->response_drain(iov.iov_len, pinned);
+      }
+
+      if (conn_.uring) {
+        conn_.uring->pin(std::move(pinned));
+      } else {
+        zerocopy_->pin(std::move(pinned));
+      }
+    }
+
     upstream_->on_handler_delete();
   }
 
   auto worker_stat = worker_->get_worker_stat();
-  --worker_stat->num_connections;
+  stat_sub(worker_stat->num_connections);
 
   if (worker_stat->num_connections == 0) {
     worker_->schedule_clear_mcpool();
@@ -850,6 +980,172 @@ void reschedule_wg(
 }
 } // namespace
 
+namespace {
+// Finds the key of session affinity in |req| as configured in
+// |affinity|, and assigns it to |key|.  This function returns true if
+// it is found.
+bool find_affinity_key(StringRef &key, const Request &req,
+                       const AffinityConfig &affinity) {
+  switch (affinity.type) {
+  case SessionAffinity::HEADER: {
+    auto kv = req.fs.header(affinity.key_name);
+    if (!kv) {
+      return false;
+    }
+
+    key = kv->value;
+
+    return true;
+  }
+  case SessionAffinity::PATH:
+    if (req.path.empty()) {
+      return false;
+    }
+
+    key = StringRef{std::begin(req.path),
+                    std::find(std::begin(req.path), std::end(req.path), '?')};
+
+    return true;
+  case SessionAffinity::QUERY: {
+    auto first = std::find(std::begin(req.path), std::end(req.path), '?');
+    if (first == std::end(req.path)) {
+      return false;
+    }
+
+    ++first;
+
+    for (;;) {
+      auto last = std::find(first, std::end(req.path), '&');
+      auto eq = std::find(first, last, '=');
+
+      if (util::streq(affinity.key_name, StringRef{first, eq})) {
+        key = eq == last ? StringRef{} : StringRef{eq + 1, last};
+        return true;
+      }
+
+      if (last == std::end(req.path)) {
+        return false;
+      }
+
+      first = last + 1;
+    }
+  }
+  default:
+    return false;
+  }
+}
+} // namespace
+
+namespace {
+// Returns true if |addr| is not blocked, and its outstanding requests
+// are within the bound.  The bound is from "Consistent Hashing with
+// Bounded Loads" (Mirrokni et al.): an address takes at most
+// ceil(c * (m + 1) * w / W) requests, where c is bounded_load / 100, m
+// is the number of outstanding requests of the group, w is the weight
+// of the address, and W is the sum of weights.
+bool affinity_addr_available(const SharedDownstreamAddr &shared_addr,
+                             const DownstreamAddr *addr) {
+  if (addr->connect_blocker->blocked()) {
+    return false;
+  }
+
+  auto bounded_load = shared_addr.affinity.bounded_load;
+  if (bounded_load == 0) {
+    return true;
+  }
+
+  uint64_t weight =
+      shared_addr.affinity.hash == SessionAffinityHash::MAGLEV ? addr->weight
+                                                               : 1;
+  auto d = 100 * static_cast<uint64_t>(shared_addr.affinity_total_weight);
+  auto limit =
+      (bounded_load * (shared_addr.outstanding + 1) * weight + d - 1) / d;
+
+  return addr->load.outstanding < limit;
+}
+} // namespace
+
+namespace {
+// Returns the first address which is available in the order of
+// |idxs|, which are indices into shared_addr.addrs, starting at
+// |first|.  If every address which is not blocked exceeds the bound,
+// the first one not blocked is returned.  If all addresses are
+// blocked, returns nullptr.
+template <typename T, typename F>
+DownstreamAddr *find_affinity_addr(SharedDownstreamAddr &shared_addr,
+                                   const std::vector<T> &idxs, size_t first,
+                                   F get_idx) {
+  DownstreamAddr *fallback = nullptr;
+
+  for (size_t i = 0; i < idxs.size(); ++i) {
+    auto addr =
+        &shared_addr.addrs[get_idx(idxs[(first + i) % idxs.size()])];
+
+    if (affinity_addr_available(shared_addr, addr)) {
+      return addr;
+    }
+
+    if (!fallback && !addr->connect_blocker->blocked()) {
+      fallback = addr;
+    }
+  }
+
+  return fallback;
+}
+} // namespace
+
+namespace {
+DownstreamAddr *find_affinity_addr_ring(SharedDownstreamAddr &shared_addr,
+                                        uint32_t hash) {
+  const auto &affinity_hash = shared_addr.affinity_hash;
+
+  auto it = std::lower_bound(
+      std::begin(affinity_hash), std::end(affinity_hash), hash,
+      [](const AffinityHash &lhs, uint32_t rhs) { return lhs.hash < rhs; });
+
+  if (it == std::end(affinity_hash)) {
+    it = std::begin(affinity_hash);
+  }
+
+  return find_affinity_addr(
+      shared_addr, affinity_hash,
+      static_cast<size_t>(std::distance(std::begin(affinity_hash), it)),
+      [](const AffinityHash &ah) { return ah.idx; });
+}
+} // namespace
+
+namespace {
+DownstreamAddr *find_affinity_addr_maglev(SharedDownstreamAddr &shared_addr,
+                                          uint32_t hash) {
+  const auto &table = shared_addr.affinity_maglev;
+
+  return find_affinity_addr(shared_addr, table, hash % table.size(),
+                            [](uint32_t idx) { return idx; });
+}
+} // namespace
+
+namespace {
+// Selects an address from |wg| by p2c load balancing.  If all
+// addresses in |wg| are blocked, this function returns nullptr, and
+// |wg| is left dequeued until one of them is unblocked.
+DownstreamAddr *select_p2c_addr(WeightGroup *wg, std::mt19937 &gen) {
+  auto addr = select_p2c(wg->addrs, gen, std::chrono::steady_clock::now());
+  if (addr) {
+    return addr;
+  }
+
+  // The unblock function of ConnectBlocker enqueues an address and
+  // its weight group if the address is not queued.  wg->pq is not
+  // used by p2c.
+  wg->pq = {};
+  for (auto a : wg->addrs) {
+    a->queued = false;
+  }
+
+  return nullptr;
+}
+} // namespace
+
 DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
                                                    DownstreamAddrGroup *group,
                                                    Downstream *downstream) {
@@ -868,6 +1164,18 @@ DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
   if (shared_addr->affinity.type != SessionAffinity::NONE) {
     uint32_t hash;
     switch (shared_addr->affinity.type) {
+    case SessionAffinity::HEADER:
+    case SessionAffinity::PATH:
+    case SessionAffinity::QUERY: {
+      StringRef key;
+      if (find_affinity_key(key, downstream->request(),
+                            shared_addr->affinity)) {
+        hash = util::hash32(key);
+        break;
+      }
+      // Use client IP address if the request has no key.
+    }
+      // fall through
     case SessionAffinity::IP:
       if (!affinity_hash_computed_) {
         affinity_hash_ = compute_affinity_from_ip(ipaddr_);
@@ -888,37 +1196,17 @@ DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
       assert(0);
     }
 
-    const auto &affinity_hash = shared_addr->affinity_hash;
-
-    auto it = std::lower_bound(
-        std::begin(affinity_hash), std::end(affinity_hash), hash,
-        [](const AffinityHash &lhs, uint32_t rhs) { return lhs.hash < rhs; });
+    DownstreamAddr *addr;
 
-    if (it == std::end(affinity_hash)) {
-      it = std::begin(affinity_hash);
+    if (shared_addr->affinity.hash == SessionAffinityHash::MAGLEV) {
+      addr = find_affinity_addr_maglev(*shared_addr, hash);
+    } else {
+      addr = find_affinity_addr_ring(*shared_addr, hash);
     }
 
-    auto aff_idx =
-        static_cast<size_t>(std::distance(std::begin(affinity_hash), it));
-    auto idx = (*it).idx;
-    auto addr = &shared_addr->addrs[idx];
-
-    if (addr->connect_blocker->blocked()) {
-      size_t i;
-      for (i = aff_idx + 1; i != aff_idx; ++i) {
-        if (i == shared_addr->affinity_hash.size()) {
-          i = 0;
-        }
-        addr = &shared_addr->addrs[shared_addr->affinity_hash[i].idx];
-        if (addr->connect_blocker->blocked()) {
-          continue;
-        }
-        break;
-      }
-      if (i == aff_idx) {
-        err = -1;
-        return nullptr;
-      }
+    if (addr == nullptr) {
+      err = -1;
+      return nullptr;
     }
 
     return addr;
@@ -937,6 +1225,17 @@ DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
     wgpq.pop();
     wg->queued = false;
 
+    if (shared_addr->balance == LoadBalancing::P2C) {
+      auto addr = select_p2c_addr(wg, worker_->get_randgen());
+      if (addr == nullptr) {
+        continue;
+      }
+
+      reschedule_wg(wgpq, wg);
+
+      return addr;
+    }
+
     for (;;) {
       if (wg->pq.empty()) {
         break;
@@ -1113,11 +1412,74 @@ ClientHandler::get_downstream_connection(int &err, Downstream *downstream) {
     return dconn;
   }
 
+  auto &shared_addr = group->shared_addr;
+  auto worker_stat = worker_->get_worker_stat();
+
+  StringRef cache_key;
+
+  if ((shared_addr->cache || shared_addr->collapse) &&
+      response_cache_request_cacheable(req)) {
+    cache_key =
+        concat_string_ref(balloc, req.scheme, StringRef::from_lit("://"),
+                          req.orig_authority, req.orig_path);
+  }
+
+  if (shared_addr->cache && !cache_key.empty()) {
+    auto cache = worker_->get_response_cache();
+    if (cache) {
+      auto ent = cache->lookup(cache_key, req, ev_now(conn_.loop));
+
+      if (ent) {
+        stat_add(worker_stat->response_cache_hits);
+
+        auto dconn =
+            std::make_unique<CacheDownstreamConnection>(group, std::move(ent));
+        dconn->set_client_handler(this);
+        return dconn;
+      }
+
+      stat_add(worker_stat->response_cache_misses);
+
+      downstream->set_response_cache(cache, cache_key);
+    }
+  }
+
+  if (shared_addr->collapse && !cache_key.empty() &&
+      downstream->get_collapsible() && !downstream->get_collapsed_request()) {
+    auto it = shared_addr->collapsed_requests.find(cache_key);
+    if (it != std::end(shared_addr->collapsed_requests)) {
+      if (LOG_ENABLED(INFO)) {
+        CLOG(INFO, this) << "Collapsing request into the identical one: "
+                         << cache_key;
+      }
+
+      stat_add(worker_stat->collapsed_requests);
+
+      auto dconn = std::make_unique<CollapsedDownstreamConnection>(
+          group, (*it).second->shared_from_this(), conn_.loop);
+      dconn->set_client_handler(this);
+      return dconn;
+    }
+
+    downstream->set_collapsed_request(std::make_shared<CollapsedRequest>(
+        conn_.loop, worker_->get_mcpool(), shared_addr, cache_key));
+  }
+
   auto addr = get_downstream_addr(err, group.get(), downstream);
   if (addr == nullptr) {
     return nullptr;
   }
 
+  // Start keeping idle connections if min-idle is set.
+  addr->keep_idle = true;
+
+  if ((shared_addr->balance == LoadBalancing::P2C &&
+       shared_addr->affinity.type == SessionAffinity::NONE) ||
+      (shared_addr->affinity.bounded_load &&
+       shared_addr->affinity.type != SessionAffinity::NONE)) {
+    downstream->add_backend_load(group, addr);
+  }
+
   if (addr->proto == Proto::HTTP1) {
     auto dconn = addr->dconn_pool->pop_downstream_connection();
     if (dconn) {
@@ -1149,6 +1511,20 @@ ClientHandler::get_downstream_connection(int &err, Downstream *downstream) {
                      << " Create new one";
   }
 
+  // Backend I/O threads do not support dynamic DNS, backend proxy,
+  // and tunneling.
+  if (!addr->dns && !req.regular_connect_method() &&
+      req.connect_proto == ConnectProto::NONE &&
+      get_config()->downstream_http_proxy.host.empty()) {
+    auto io = worker_->get_http2_backend_io(addr);
+    if (io) {
+      auto dconn = std::make_unique<Http2BackendIODownstreamConnection>(
+          group, addr, io, worker_);
+      dconn->set_client_handler(this);
+      return dconn;
+    }
+  }
+
   auto http2session = get_http2_session(group, addr);
   auto dconn = std::make_unique<Http2DownstreamConnection>(http2session);
   dconn->set_client_handler(this);
@@ -49,6 +49,7 @@ class HttpsUpstream;
 class ConnectBlocker;
 class DownstreamConnectionPool;
 class Worker;
+class ZerocopyTracker;
 class Downstream;
 struct WorkerStat;
 struct DownstreamAddrGroup;
@@ -206,6 +207,10 @@ private:
   Connection conn_;
   ev_timer reneg_shutdown_timer_;
   std::unique_ptr<Upstream> upstream_;
+  // Not nullptr if response is sent with MSG_ZEROCOPY.  This is
+  // declared after upstream_ and conn_ so that it is destroyed before
+  // the response buffers are freed and the socket is closed.
+  std::unique_ptr<ZerocopyTracker> zerocopy_;
   // IP address of client.  If UNIX domain socket is used, this is
   // "localhost".
   StringRef ipaddr_;
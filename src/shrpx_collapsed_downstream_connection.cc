@@ -0,0 +1,317 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_collapsed_downstream_connection.h"
+#include "shrpx_client_handler.h"
+#include "shrpx_upstream.h"
+#include "shrpx_downstream.h"
+#include "shrpx_collapsed_request.h"
+#include "shrpx_response_cache.h"
+#include "shrpx_config.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+void waittimeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto dconn = static_cast<CollapsedDownstreamConnection *>(w->data);
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, dconn) << "Timed out waiting for the response to the "
+                          "collapsed request";
+  }
+
+  dconn->release(false);
+}
+} // namespace
+
+namespace {
+void notifycb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto dconn = static_cast<CollapsedDownstreamConnection *>(w->data);
+  auto downstream = dconn->get_downstream();
+  auto upstream = downstream->get_upstream();
+
+  if (upstream->downstream_read(dconn) != 0) {
+    delete upstream->get_client_handler();
+  }
+}
+} // namespace
+
+CollapsedDownstreamConnection::CollapsedDownstreamConnection(
+    const std::shared_ptr<DownstreamAddrGroup> &group,
+    std::shared_ptr<CollapsedRequest> creq, struct ev_loop *loop)
+    : dlnext(nullptr),
+      dlprev(nullptr),
+      group_(group),
+      creq_(std::move(creq)),
+      loop_(loop),
+      response_header_received_(false) {
+  auto &httpconf = get_config()->http;
+
+  ev_timer_init(&wait_timer_, waittimeoutcb, 0.,
+                httpconf.collapsed_forwarding.timeout);
+  wait_timer_.data = this;
+
+  ev_timer_init(&notify_timer_, notifycb, 0., 0.);
+  notify_timer_.data = this;
+}
+
+CollapsedDownstreamConnection::~CollapsedDownstreamConnection() {
+  ev_timer_stop(loop_, &notify_timer_);
+  ev_timer_stop(loop_, &wait_timer_);
+
+  leave();
+}
+
+int CollapsedDownstreamConnection::attach_downstream(Downstream *downstream) {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Attaching to DOWNSTREAM:" << downstream;
+  }
+
+  downstream_ = downstream;
+
+  creq_->add_follower(this);
+
+  ev_timer_again(loop_, &wait_timer_);
+
+  return 0;
+}
+
+void CollapsedDownstreamConnection::detach_downstream(Downstream *downstream) {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Detaching from DOWNSTREAM:" << downstream;
+  }
+
+  ev_timer_stop(loop_, &notify_timer_);
+  ev_timer_stop(loop_, &wait_timer_);
+
+  leave();
+
+  downstream_ = nullptr;
+}
+
+int CollapsedDownstreamConnection::push_request_headers() {
+  // request_header_sent is left false so that this request can still
+  // be forwarded to a backend if it is released.
+  auto src = downstream_->get_blocked_request_buf();
+  auto dest = downstream_->get_request_buf();
+  src->remove(*dest);
+
+  return 0;
+}
+
+int CollapsedDownstreamConnection::push_upload_data_chunk(const uint8_t *data,
+                                                          size_t datalen) {
+  return 0;
+}
+
+int CollapsedDownstreamConnection::end_upload_data() { return 0; }
+
+void CollapsedDownstreamConnection::pause_read(IOCtrlReason reason) {}
+
+int CollapsedDownstreamConnection::resume_read(IOCtrlReason reason,
+                                               size_t consumed) {
+  return 0;
+}
+
+void CollapsedDownstreamConnection::force_resume_read() {}
+
+int CollapsedDownstreamConnection::on_read() { return 0; }
+
+int CollapsedDownstreamConnection::on_write() { return 0; }
+
+void CollapsedDownstreamConnection::on_upstream_change(Upstream *upstream) {}
+
+bool CollapsedDownstreamConnection::poolable() const { return false; }
+
+const std::shared_ptr<DownstreamAddrGroup> &
+CollapsedDownstreamConnection::get_downstream_addr_group() const {
+  return group_;
+}
+
+DownstreamAddr *CollapsedDownstreamConnection::get_addr() const {
+  return nullptr;
+}
+
+void CollapsedDownstreamConnection::on_response_header(
+    const ResponseCacheEntry &ent, int64_t content_length) {
+  response_header_received_ = true;
+
+  ev_timer_stop(loop_, &wait_timer_);
+
+  auto upstream = downstream_->get_upstream();
+  const auto &req = downstream_->request();
+  auto &resp = downstream_->response();
+  auto &balloc = downstream_->get_block_allocator();
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Receiving the response to the collapsed request: "
+                      << ent.key;
+  }
+
+  resp.http_status = ent.http_status;
+
+  for (auto &kv : ent.headers) {
+    auto name = make_string_ref(balloc, StringRef{kv.first});
+    auto value = make_string_ref(balloc, StringRef{kv.second});
+    resp.fs.add_header_token(name, value, false, http2::lookup_token(name));
+  }
+
+  auto age = static_cast<uint64_t>(std::max(ev_now(loop_) - ent.date, 0.));
+
+  resp.fs.add_header_token(StringRef::from_lit("age"),
+                           util::make_string_ref_uint(balloc, age), false, -1);
+
+  if (content_length != -1) {
+    resp.fs.add_header_token(
+        StringRef::from_lit("content-length"),
+        util::make_string_ref_uint(balloc, content_length), false,
+        http2::HD_CONTENT_LENGTH);
+    resp.fs.content_length = content_length;
+  } else if (downstream_->expect_response_body()) {
+    if (req.http_major <= 0 || (req.http_major == 1 && req.http_minor == 0)) {
+      resp.connection_close = true;
+    } else {
+      resp.fs.add_header_token(StringRef::from_lit("transfer-encoding"),
+                               StringRef::from_lit("chunked"), false,
+                               http2::HD_TRANSFER_ENCODING);
+      downstream_->set_chunked_response(true);
+    }
+  }
+
+  downstream_->set_response_state(DownstreamState::HEADER_COMPLETE);
+
+  if (upstream->on_downstream_header_complete(downstream_) != 0) {
+    leave();
+
+    // The response might have been replaced by mruby script.
+    if (downstream_->get_response_state() != DownstreamState::MSG_COMPLETE) {
+      downstream_->set_response_state(DownstreamState::MSG_RESET);
+    }
+  }
+
+  signal_upstream();
+}
+
+void CollapsedDownstreamConnection::on_response_body(const uint8_t *data,
+                                                     size_t len) {
+  auto upstream = downstream_->get_upstream();
+  auto &resp = downstream_->response();
+  auto &httpconf = get_config()->http;
+
+  resp.recv_body_length += len;
+
+  if (upstream->on_downstream_body(downstream_, data, len, true) != 0) {
+    leave();
+
+    downstream_->set_response_state(DownstreamState::MSG_RESET);
+  } else if (downstream_->get_response_buf()->rleft() >
+             httpconf.response_cache.max_entry_size) {
+    // Leader does not wait for followers.  Give up this follower
+    // rather than buffering the response without limit.
+    if (LOG_ENABLED(INFO)) {
+      DCLOG(INFO, this) << "Too much response body is buffered for the "
+                           "collapsed request";
+    }
+
+    leave();
+
+    downstream_->set_response_state(DownstreamState::MSG_RESET);
+  }
+
+  signal_upstream();
+}
+
+void CollapsedDownstreamConnection::on_response_complete() {
+  auto upstream = downstream_->get_upstream();
+
+  leave();
+
+  downstream_->set_response_state(DownstreamState::MSG_COMPLETE);
+
+  if (upstream->on_downstream_body_complete(downstream_) != 0) {
+    downstream_->set_response_state(DownstreamState::MSG_RESET);
+  }
+
+  signal_upstream();
+}
+
+void CollapsedDownstreamConnection::release(bool collapsible) {
+  auto downstream = downstream_;
+  auto upstream = downstream->get_upstream();
+  auto handler = upstream->get_client_handler();
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Forwarding the collapsed request to backend";
+  }
+
+  leave();
+
+  downstream->set_collapsible(collapsible);
+  // The request has not been forwarded to a backend yet.  Do not
+  // spend its retry budget.
+  downstream->skip_next_retry();
+
+  // This object is deleted.
+  if (upstream->on_downstream_reset(downstream, false) != 0) {
+    delete handler;
+  }
+}
+
+void CollapsedDownstreamConnection::fail() {
+  auto downstream = downstream_;
+  auto upstream = downstream->get_upstream();
+  auto handler = upstream->get_client_handler();
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "The response to the collapsed request failed";
+  }
+
+  leave();
+
+  downstream->set_response_state(DownstreamState::MSG_RESET);
+
+  if (upstream->downstream_read(this) != 0) {
+    delete handler;
+  }
+}
+
+void CollapsedDownstreamConnection::signal_upstream() {
+  ev_timer_start(loop_, &notify_timer_);
+}
+
+bool CollapsedDownstreamConnection::get_response_header_received() const {
+  return response_header_received_;
+}
+
+void CollapsedDownstreamConnection::leave() {
+  if (!creq_) {
+    return;
+  }
+
+  creq_->remove_follower(this);
+  creq_.reset();
+}
+
+} // namespace shrpx
@@ -0,0 +1,115 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_COLLAPSED_DOWNSTREAM_CONNECTION_H
+#define SHRPX_COLLAPSED_DOWNSTREAM_CONNECTION_H
+
+#include "shrpx_downstream_connection.h"
+
+#include <ev.h>
+
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+class CollapsedRequest;
+struct ResponseCacheEntry;
+
+// CollapsedDownstreamConnection is attached to a follower of
+// CollapsedRequest.  Instead of contacting backend, it receives a
+// copy of the response to the leader.
+class CollapsedDownstreamConnection : public DownstreamConnection {
+public:
+  CollapsedDownstreamConnection(
+      const std::shared_ptr<DownstreamAddrGroup> &group,
+      std::shared_ptr<CollapsedRequest> creq, struct ev_loop *loop);
+  virtual ~CollapsedDownstreamConnection();
+  virtual int attach_downstream(Downstream *downstream);
+  virtual void detach_downstream(Downstream *downstream);
+
+  virtual int push_request_headers();
+  virtual int push_upload_data_chunk(const uint8_t *data, size_t datalen);
+  virtual int end_upload_data();
+
+  virtual void pause_read(IOCtrlReason reason);
+  virtual int resume_read(IOCtrlReason reason, size_t consumed);
+  virtual void force_resume_read();
+
+  virtual int on_read();
+  virtual int on_write();
+
+  virtual void on_upstream_change(Upstream *upstream);
+
+  // true if this object is poolable.
+  virtual bool poolable() const;
+
+  virtual const std::shared_ptr<DownstreamAddrGroup> &
+  get_downstream_addr_group() const;
+  virtual DownstreamAddr *get_addr() const;
+
+  // CollapsedRequest calls these functions to pass the response to
+  // leader.  |content_length| is the content-length of the response,
+  // or -1 if it is unknown.  Upstream is notified asynchronously.
+  // If upstream buffers more response body than the maximum entry
+  // size of response cache, the response is reset.
+  void on_response_header(const ResponseCacheEntry &ent,
+                          int64_t content_length);
+  void on_response_body(const uint8_t *data, size_t len);
+  void on_response_complete();
+
+  // Stops waiting for the response to leader, and makes a backend
+  // request.  If |collapsible| is true, the request may be collapsed
+  // again.  It does not count as a retry.  This object is deleted.
+  void release(bool collapsible);
+  // Resets the response.  This function is used when the response
+  // to leader failed after its header fields were passed.  This
+  // object is deleted.
+  void fail();
+
+  // Notifies upstream of the progress of response.
+  void signal_upstream();
+
+  bool get_response_header_received() const;
+
+  CollapsedDownstreamConnection *dlnext, *dlprev;
+
+private:
+  // Removes this object from creq_.
+  void leave();
+
+  std::shared_ptr<DownstreamAddrGroup> group_;
+  std::shared_ptr<CollapsedRequest> creq_;
+  // Fires if response header fields are not received in time.
+  ev_timer wait_timer_;
+  // Lets upstream process the response received so far.
+  ev_timer notify_timer_;
+  struct ev_loop *loop_;
+  bool response_header_received_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_COLLAPSED_DOWNSTREAM_CONNECTION_H
@@ -0,0 +1,219 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_collapsed_request.h"
+
+#include <cassert>
+
+#include "shrpx_collapsed_downstream_connection.h"
+#include "shrpx_downstream.h"
+#include "shrpx_response_cache.h"
+#include "shrpx_worker.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+void dispatchcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto creq = static_cast<CollapsedRequest *>(w->data);
+
+  creq->dispatch();
+}
+} // namespace
+
+CollapsedRequest::CollapsedRequest(
+    struct ev_loop *loop, MemchunkPool *mcpool,
+    std::shared_ptr<SharedDownstreamAddr> shared_addr, const StringRef &key)
+    : key_{std::begin(key), std::end(key)},
+      shared_addr_(std::move(shared_addr)),
+      loop_(loop),
+      mcpool_(mcpool),
+      content_length_(-1),
+      state_(CollapsedRequestState::WAITING),
+      registered_(true) {
+  ev_timer_init(&dispatch_timer_, dispatchcb, 0., 0.);
+  dispatch_timer_.data = this;
+
+  shared_addr_->collapsed_requests.emplace(StringRef{key_}, this);
+}
+
+CollapsedRequest::~CollapsedRequest() {
+  assert(!waiting_.head);
+  assert(!streaming_.head);
+
+  ev_timer_stop(loop_, &dispatch_timer_);
+
+  unregister();
+}
+
+void CollapsedRequest::add_follower(CollapsedDownstreamConnection *dconn) {
+  assert(state_ == CollapsedRequestState::WAITING);
+
+  waiting_.append(dconn);
+}
+
+void CollapsedRequest::remove_follower(CollapsedDownstreamConnection *dconn) {
+  if (dconn->get_response_header_received()) {
+    streaming_.remove(dconn);
+  } else {
+    waiting_.remove(dconn);
+  }
+}
+
+void CollapsedRequest::on_response_header(const Downstream &leader) {
+  if (state_ != CollapsedRequestState::WAITING) {
+    return;
+  }
+
+  unregister();
+
+  resp_ = response_cache_make_entry(mcpool_, StringRef{key_}, leader.request(),
+                                    leader.response(), ev_now(loop_));
+  if (!resp_) {
+    if (LOG_ENABLED(INFO)) {
+      LOG(INFO) << "Response to collapsed request is not shareable: " << key_;
+    }
+
+    state_ = CollapsedRequestState::RELEASED;
+    schedule_dispatch();
+
+    return;
+  }
+
+  content_length_ = leader.response().fs.content_length;
+  state_ = CollapsedRequestState::STREAMING;
+
+  // Followers never delete each other here because they notify their
+  // upstreams asynchronously.
+  for (auto dconn = waiting_.head; dconn;) {
+    auto next = dconn->dlnext;
+
+    if (response_cache_vary_match(*resp_, dconn->get_downstream()->request())) {
+      waiting_.remove(dconn);
+      streaming_.append(dconn);
+
+      dconn->on_response_header(*resp_, content_length_);
+    }
+
+    dconn = next;
+  }
+
+  if (waiting_.head) {
+    schedule_dispatch();
+  }
+}
+
+void CollapsedRequest::on_response_body(const uint8_t *data, size_t len) {
+  if (state_ != CollapsedRequestState::STREAMING) {
+    return;
+  }
+
+  for (auto dconn = streaming_.head; dconn;) {
+    auto next = dconn->dlnext;
+
+    dconn->on_response_body(data, len);
+
+    dconn = next;
+  }
+}
+
+void CollapsedRequest::on_response_complete() {
+  if (state_ != CollapsedRequestState::STREAMING) {
+    return;
+  }
+
+  state_ = CollapsedRequestState::COMPLETE;
+
+  for (auto dconn = streaming_.head; dconn;) {
+    auto next = dconn->dlnext;
+
+    dconn->on_response_complete();
+
+    dconn = next;
+  }
+}
+
+void CollapsedRequest::on_leader_gone() {
+  switch (state_) {
+  case CollapsedRequestState::WAITING:
+    state_ = CollapsedRequestState::ORPHANED;
+    break;
+  case CollapsedRequestState::STREAMING:
+    state_ = CollapsedRequestState::FAILED;
+    break;
+  default:
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "Leader of collapsed request has gone: " << key_;
+  }
+
+  unregister();
+  schedule_dispatch();
+}
+
+void CollapsedRequest::dispatch() {
+  // Followers may drop the last reference to this object.
+  auto self = shared_from_this();
+
+  // Releasing or failing a follower removes it from the list, and it
+  // might delete other followers which share the same frontend
+  // connection.  Always pick the head.
+  while (waiting_.head) {
+    waiting_.head->release(state_ == CollapsedRequestState::ORPHANED);
+  }
+
+  if (state_ != CollapsedRequestState::FAILED) {
+    return;
+  }
+
+  while (streaming_.head) {
+    streaming_.head->fail();
+  }
+}
+
+CollapsedRequestState CollapsedRequest::get_state() const { return state_; }
+
+StringRef CollapsedRequest::get_key() const { return StringRef{key_}; }
+
+size_t CollapsedRequest::get_num_followers() const {
+  return waiting_.len + streaming_.len;
+}
+
+void CollapsedRequest::unregister() {
+  if (!registered_) {
+    return;
+  }
+
+  registered_ = false;
+
+  shared_addr_->collapsed_requests.erase(StringRef{key_});
+}
+
+void CollapsedRequest::schedule_dispatch() {
+  ev_timer_start(loop_, &dispatch_timer_);
+}
+
+} // namespace shrpx
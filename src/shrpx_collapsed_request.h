@@ -0,0 +1,132 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_COLLAPSED_REQUEST_H
+#define SHRPX_COLLAPSED_REQUEST_H
+
+#include "shrpx.h"
+
+#include <string>
+#include <memory>
+
+#include <ev.h>
+
+#include "memchunk.h"
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+class Downstream;
+class CollapsedDownstreamConnection;
+struct SharedDownstreamAddr;
+struct ResponseCacheEntry;
+
+enum class CollapsedRequestState {
+  // Waiting for response header fields from backend.
+  WAITING,
+  // Followers are receiving the response.
+  STREAMING,
+  // The response has completed.
+  COMPLETE,
+  // The response cannot be shared.  Followers must make their own
+  // backend request.
+  RELEASED,
+  // Leader has gone before receiving response header fields.
+  // Followers make another collapsed request.
+  ORPHANED,
+  // The response to leader failed after its header fields were
+  // passed to followers.
+  FAILED,
+};
+
+// CollapsedRequest collapses identical concurrent requests into a
+// single backend request.  The first request (leader) is forwarded
+// to a backend, and the other requests (followers) wait for its
+// response, which is copied to each of them as it arrives.  New
+// followers can join until response header fields are received.  If
+// the response is not cacheable, or its vary header field does not
+// match a follower's request, the follower is released to make its
+// own backend request.
+class CollapsedRequest
+    : public std::enable_shared_from_this<CollapsedRequest> {
+public:
+  // Creates CollapsedRequest keyed by |key|, and registers it to
+  // |shared_addr| so that identical requests can find it.
+  CollapsedRequest(struct ev_loop *loop, MemchunkPool *mcpool,
+                   std::shared_ptr<SharedDownstreamAddr> shared_addr,
+                   const StringRef &key);
+  ~CollapsedRequest();
+
+  void add_follower(CollapsedDownstreamConnection *dconn);
+  void remove_follower(CollapsedDownstreamConnection *dconn);
+
+  // Leader calls these functions when the final response header
+  // fields, a chunk of response body, and the end of response are
+  // received from backend respectively.
+  void on_response_header(const Downstream &leader);
+  void on_response_body(const uint8_t *data, size_t len);
+  void on_response_complete();
+  // Leader calls this function when it has gone without completing
+  // the response.
+  void on_leader_gone();
+
+  // Releases followers which are still waiting for response header
+  // fields, and fails the others if the response failed.  If this
+  // object is orphaned, the first released follower becomes the
+  // leader of a new collapsed request, and the rest of them join it.
+  void dispatch();
+
+  CollapsedRequestState get_state() const;
+  StringRef get_key() const;
+  // Returns the number of followers.
+  size_t get_num_followers() const;
+
+private:
+  // Makes this object invisible to new requests.
+  void unregister();
+  void schedule_dispatch();
+
+  std::string key_;
+  // Followers which have not received response header fields.
+  DList<CollapsedDownstreamConnection> waiting_;
+  // Followers which are receiving response.
+  DList<CollapsedDownstreamConnection> streaming_;
+  std::shared_ptr<SharedDownstreamAddr> shared_addr_;
+  // Response header fields of leader.  Body is not stored.
+  std::unique_ptr<ResponseCacheEntry> resp_;
+  ev_timer dispatch_timer_;
+  struct ev_loop *loop_;
+  MemchunkPool *mcpool_;
+  // The content-length of response, or -1 if it is unknown.
+  int64_t content_length_;
+  CollapsedRequestState state_;
+  // true if this object is registered to shared_addr_.
+  bool registered_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_COLLAPSED_REQUEST_H
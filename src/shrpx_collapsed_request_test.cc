@@ -0,0 +1,448 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_collapsed_request_test.h"
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_collapsed_request.h"
+#include "shrpx_collapsed_downstream_connection.h"
+#include "shrpx_upstream.h"
+#include "shrpx_downstream.h"
+#include "shrpx_worker.h"
+#include "shrpx_config.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+// MockUpstream records the calls from CollapsedDownstreamConnection.
+// When a follower is released, it collapses the request again in
+// the way ClientHandler does.
+class MockUpstream : public Upstream {
+public:
+  MockUpstream(struct ev_loop *loop, MemchunkPool *mcpool,
+               std::shared_ptr<SharedDownstreamAddr> shared_addr,
+               const StringRef &key)
+      : loop(loop),
+        mcpool(mcpool),
+        shared_addr(std::move(shared_addr)),
+        key(key),
+        num_header(0),
+        num_complete(0),
+        num_read(0),
+        num_reset(0) {}
+
+  virtual ~MockUpstream() {
+    for (auto &d : downstreams) {
+      d->reset_upstream(nullptr);
+    }
+  }
+
+  // Creates a request collapsed into |creq|.
+  Downstream *add_follower(const std::shared_ptr<CollapsedRequest> &creq) {
+    auto d = create_downstream();
+
+    d->attach_downstream_connection(
+        std::make_unique<CollapsedDownstreamConnection>(nullptr, creq, loop));
+
+    return d;
+  }
+
+  Downstream *create_downstream() {
+    downstreams.emplace_back(std::make_unique<Downstream>(nullptr, mcpool, 0));
+
+    auto d = downstreams.back().get();
+    d->reset_upstream(this);
+    d->request().method = HTTP_GET;
+
+    return d;
+  }
+
+  virtual int on_read() { return 0; }
+  virtual int on_write() { return 0; }
+  virtual int on_downstream_abort_request(Downstream *downstream,
+                                          unsigned int status_code) {
+    return 0;
+  }
+  virtual int
+  on_downstream_abort_request_with_https_redirect(Downstream *downstream) {
+    return 0;
+  }
+  virtual int downstream_read(DownstreamConnection *dconn) {
+    ++num_read;
+    return 0;
+  }
+  virtual int downstream_write(DownstreamConnection *dconn) { return 0; }
+  virtual int downstream_eof(DownstreamConnection *dconn) { return 0; }
+  virtual int downstream_error(DownstreamConnection *dconn, int events) {
+    return 0;
+  }
+  virtual ClientHandler *get_client_handler() const { return nullptr; }
+  virtual int on_downstream_header_complete(Downstream *downstream) {
+    ++num_header;
+    return 0;
+  }
+  virtual int on_downstream_body(Downstream *downstream, const uint8_t *data,
+                                 size_t len, bool flush) {
+    downstream->get_response_buf()->append(data, len);
+    return 0;
+  }
+  virtual int on_downstream_body_complete(Downstream *downstream) {
+    ++num_complete;
+    return 0;
+  }
+  virtual void on_handler_delete() {}
+  virtual int on_downstream_reset(Downstream *downstream, bool no_retry) {
+    ++num_reset;
+
+    auto dconn = downstream->pop_downstream_connection();
+
+    downstream->add_retry();
+
+    if (!downstream->get_collapsible()) {
+      return 0;
+    }
+
+    auto it = shared_addr->collapsed_requests.find(key);
+    if (it != std::end(shared_addr->collapsed_requests)) {
+      downstream->attach_downstream_connection(
+          std::make_unique<CollapsedDownstreamConnection>(
+              nullptr, (*it).second->shared_from_this(), loop));
+      return 0;
+    }
+
+    downstream->set_collapsed_request(
+        std::make_shared<CollapsedRequest>(loop, mcpool, shared_addr, key));
+
+    return 0;
+  }
+  virtual void pause_read(IOCtrlReason reason) {}
+  virtual int resume_read(IOCtrlReason reason, Downstream *downstream,
+                          size_t consumed) {
+    return 0;
+  }
+  virtual int send_reply(Downstream *downstream, const uint8_t *body,
+                         size_t bodylen) {
+    return 0;
+  }
+  virtual int initiate_push(Downstream *downstream, const StringRef &uri) {
+    return 0;
+  }
+  virtual int response_riovec(struct iovec *iov, int iovcnt) const {
+    return 0;
+  }
+  virtual void response_drain(size_t n) {}
+  virtual void response_drain(size_t n, DefaultMemchunks &pinned) {}
+  virtual bool response_empty() const { return true; }
+  virtual Downstream *on_downstream_push_promise(Downstream *downstream,
+                                                 int32_t promised_stream_id) {
+    return nullptr;
+  }
+  virtual int
+  on_downstream_push_promise_complete(Downstream *downstream,
+                                      Downstream *promised_downstream) {
+    return 0;
+  }
+  virtual bool push_enabled() const { return false; }
+  virtual void cancel_premature_downstream(Downstream *promised_downstream) {}
+
+  std::vector<std::unique_ptr<Downstream>> downstreams;
+  struct ev_loop *loop;
+  MemchunkPool *mcpool;
+  std::shared_ptr<SharedDownstreamAddr> shared_addr;
+  StringRef key;
+  size_t num_header;
+  size_t num_complete;
+  size_t num_read;
+  size_t num_reset;
+};
+} // namespace
+
+namespace {
+void set_cacheable_response(Downstream &leader, int64_t content_length) {
+  auto &resp = leader.response();
+  resp.http_status = 200;
+  resp.fs.add_header_token(StringRef::from_lit("cache-control"),
+                           StringRef::from_lit("max-age=60"), false,
+                           http2::HD_CACHE_CONTROL);
+  resp.fs.content_length = content_length;
+}
+} // namespace
+
+namespace {
+void add_accept_encoding(Downstream &downstream) {
+  downstream.request().fs.add_header_token(
+      StringRef::from_lit("accept-encoding"), StringRef::from_lit("gzip"),
+      false, http2::HD_ACCEPT_ENCODING);
+}
+} // namespace
+
+void test_shrpx_collapsed_request(void) {
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  MemchunkPool mcpool;
+  auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+  auto key = StringRef::from_lit("https://example.com/a");
+
+  {
+    // Cacheable response is shared.
+    auto creq =
+        std::make_shared<CollapsedRequest>(loop, &mcpool, shared_addr, key);
+
+    CU_ASSERT(1 == shared_addr->collapsed_requests.size());
+    CU_ASSERT(creq.get() == shared_addr->collapsed_requests[key]);
+    CU_ASSERT(CollapsedRequestState::WAITING == creq->get_state());
+
+    Downstream d(nullptr, nullptr, 0);
+    auto &req = d.request();
+    req.method = HTTP_GET;
+    auto &resp = d.response();
+    resp.http_status = 200;
+    resp.fs.add_header_token(StringRef::from_lit("cache-control"),
+                             StringRef::from_lit("max-age=60"), false,
+                             http2::HD_CACHE_CONTROL);
+
+    creq->on_response_header(d);
+
+    CU_ASSERT(shared_addr->collapsed_requests.empty());
+    CU_ASSERT(CollapsedRequestState::STREAMING == creq->get_state());
+
+    creq->on_response_complete();
+
+    CU_ASSERT(CollapsedRequestState::COMPLETE == creq->get_state());
+
+    // Nothing happens after the response completed.
+    creq->on_leader_gone();
+
+    CU_ASSERT(CollapsedRequestState::COMPLETE == creq->get_state());
+  }
+
+  CU_ASSERT(shared_addr->collapsed_requests.empty());
+
+  {
+    // Response which is not cacheable is not shared.
+    auto creq =
+        std::make_shared<CollapsedRequest>(loop, &mcpool, shared_addr, key);
+
+    Downstream d(nullptr, nullptr, 0);
+    auto &req = d.request();
+    req.method = HTTP_GET;
+    auto &resp = d.response();
+    resp.http_status = 200;
+
+    creq->on_response_header(d);
+
+    CU_ASSERT(shared_addr->collapsed_requests.empty());
+    CU_ASSERT(CollapsedRequestState::RELEASED == creq->get_state());
+  }
+
+  {
+    // Leader has gone before receiving response.
+    auto creq =
+        std::make_shared<CollapsedRequest>(loop, &mcpool, shared_addr, key);
+
+    creq->on_leader_gone();
+
+    CU_ASSERT(shared_addr->collapsed_requests.empty());
+    CU_ASSERT(CollapsedRequestState::ORPHANED == creq->get_state());
+    CU_ASSERT(0 == creq->get_num_followers());
+
+    // The leader of a new request can be registered.
+    auto creq2 =
+        std::make_shared<CollapsedRequest>(loop, &mcpool, shared_addr, key);
+
+    CU_ASSERT(creq2.get() == shared_addr->collapsed_requests[key]);
+  }
+
+  CU_ASSERT(shared_addr->collapsed_requests.empty());
+
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_collapsed_request_followers(void) {
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  MemchunkPool mcpool;
+  auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+  auto key = StringRef::from_lit("https://example.com/a");
+  auto &httpconf = mod_config()->http;
+  auto timeout = httpconf.collapsed_forwarding.timeout;
+  auto max_entry_size = httpconf.response_cache.max_entry_size;
+
+  httpconf.response_cache.max_entry_size = 8;
+
+  {
+    // The response to leader is passed to all followers.
+    MockUpstream upstream(loop, &mcpool, shared_addr, key);
+    auto creq =
+        std::make_shared<CollapsedRequest>(loop, &mcpool, shared_addr, key);
+    auto f1 = upstream.add_follower(creq);
+    auto f2 = upstream.add_follower(creq);
+
+    CU_ASSERT(2 == creq->get_num_followers());
+
+    Downstream leader(nullptr, nullptr, 0);
+    leader.request().method = HTTP_GET;
+    set_cacheable_response(leader, 10);
+
+    creq->on_response_header(leader);
+
+    CU_ASSERT(2 == upstream.num_header);
+    CU_ASSERT(DownstreamState::HEADER_COMPLETE == f1->get_response_state());
+    CU_ASSERT(10 == f1->response().fs.content_length);
+    CU_ASSERT(10 == f2->response().fs.content_length);
+
+    creq->on_response_body(reinterpret_cast<const uint8_t *>("hello"), 5);
+
+    CU_ASSERT(5 == f1->get_response_buf()->rleft());
+    CU_ASSERT(5 == f2->get_response_buf()->rleft());
+
+    // f1 consumes the response body, but f2 does not.  f2 is reset
+    // when it buffers more than the maximum entry size.
+    f1->get_response_buf()->reset();
+
+    creq->on_response_body(reinterpret_cast<const uint8_t *>("world"), 5);
+
+    CU_ASSERT(DownstreamState::MSG_RESET == f2->get_response_state());
+    CU_ASSERT(1 == creq->get_num_followers());
+
+    creq->on_response_complete();
+
+    CU_ASSERT(1 == upstream.num_complete);
+    CU_ASSERT(DownstreamState::MSG_COMPLETE == f1->get_response_state());
+    CU_ASSERT(10 == f1->response().recv_body_length);
+    CU_ASSERT(0 == creq->get_num_followers());
+
+    ev_run(loop, EVRUN_NOWAIT);
+
+    CU_ASSERT(2 == upstream.num_read);
+    CU_ASSERT(0 == upstream.num_reset);
+  }
+
+  {
+    // A follower whose request does not match vary header field is
+    // released without spending its retry budget.
+    MockUpstream upstream(loop, &mcpool, shared_addr, key);
+    auto creq =
+        std::make_shared<CollapsedRequest>(loop, &mcpool, shared_addr, key);
+    auto f1 = upstream.add_follower(creq);
+    auto f2 = upstream.add_follower(creq);
+
+    add_accept_encoding(*f1);
+
+    for (size_t i = 0; i < 50; ++i) {
+      f2->add_retry();
+    }
+
+    Downstream leader(nullptr, nullptr, 0);
+    leader.request().method = HTTP_GET;
+    add_accept_encoding(leader);
+    set_cacheable_response(leader, 5);
+    leader.response().fs.add_header_token(
+        StringRef::from_lit("vary"), StringRef::from_lit("accept-encoding"),
+        false, -1);
+
+    creq->on_response_header(leader);
+
+    CU_ASSERT(1 == upstream.num_header);
+    CU_ASSERT(2 == creq->get_num_followers());
+
+    ev_run(loop, EVRUN_NOWAIT);
+
+    CU_ASSERT(1 == upstream.num_reset);
+    CU_ASSERT(1 == creq->get_num_followers());
+    CU_ASSERT(nullptr == f2->get_downstream_connection());
+    CU_ASSERT(!f2->get_collapsible());
+    CU_ASSERT(!f2->no_more_retry());
+
+    f2->add_retry();
+
+    CU_ASSERT(f2->no_more_retry());
+  }
+
+  CU_ASSERT(shared_addr->collapsed_requests.empty());
+
+  {
+    // A follower is released if response header fields do not arrive
+    // in time.
+    httpconf.collapsed_forwarding.timeout = 0.01;
+
+    MockUpstream upstream(loop, &mcpool, shared_addr, key);
+    auto creq =
+        std::make_shared<CollapsedRequest>(loop, &mcpool, shared_addr, key);
+    auto f1 = upstream.add_follower(creq);
+
+    ev_run(loop, 0);
+
+    CU_ASSERT(1 == upstream.num_reset);
+    CU_ASSERT(0 == creq->get_num_followers());
+    CU_ASSERT(nullptr == f1->get_downstream_connection());
+    CU_ASSERT(!f1->get_collapsible());
+    // The request itself is still collapsed, but not to this one.
+    CU_ASSERT(creq.get() == shared_addr->collapsed_requests[key]);
+
+    creq->on_leader_gone();
+
+    httpconf.collapsed_forwarding.timeout = timeout;
+  }
+
+  CU_ASSERT(shared_addr->collapsed_requests.empty());
+
+  {
+    // If leader has gone, the first follower becomes the leader of a
+    // new collapsed request, and the rest of them follow it.
+    MockUpstream upstream(loop, &mcpool, shared_addr, key);
+    auto creq =
+        std::make_shared<CollapsedRequest>(loop, &mcpool, shared_addr, key);
+    auto f1 = upstream.add_follower(creq);
+    auto f2 = upstream.add_follower(creq);
+    auto f3 = upstream.add_follower(creq);
+
+    creq->on_leader_gone();
+
+    CU_ASSERT(shared_addr->collapsed_requests.empty());
+
+    ev_run(loop, EVRUN_NOWAIT);
+
+    CU_ASSERT(3 == upstream.num_reset);
+    CU_ASSERT(0 == creq->get_num_followers());
+    CU_ASSERT(f1->get_collapsible());
+    CU_ASSERT(nullptr == f1->get_downstream_connection());
+
+    auto &creq2 = f1->get_collapsed_request();
+
+    CU_ASSERT(nullptr != creq2);
+    CU_ASSERT(creq2.get() == shared_addr->collapsed_requests[key]);
+    CU_ASSERT(2 == creq2->get_num_followers());
+    CU_ASSERT(nullptr != f2->get_downstream_connection());
+    CU_ASSERT(nullptr != f3->get_downstream_connection());
+  }
+
+  CU_ASSERT(shared_addr->collapsed_requests.empty());
+
+  httpconf.response_cache.max_entry_size = max_entry_size;
+
+  ev_loop_destroy(loop);
+}
+
+} // namespace shrpx
@@ -0,0 +1,337 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_compressor.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+#include "shrpx_config.h"
+#include "shrpx_downstream.h"
+#include "shrpx_worker.h"
+#include "shrpx_log.h"
+#include "util.h"
+
+namespace shrpx {
+
+namespace {
+// The maximum number of idle Compressors a pool keeps.  deflate
+// state takes roughly 256KiB, so keeping too many of them wastes
+// memory.
+constexpr size_t MAX_POOLED_COMPRESSORS = 16;
+} // namespace
+
+Compressor::Compressor()
+    : strm_{}, stat_(nullptr), level_(0), initialized_(false) {}
+
+Compressor::~Compressor() {
+  if (initialized_) {
+    deflateEnd(&strm_);
+  }
+}
+
+int Compressor::init(int level) {
+  // windowBits = 15 + 16 produces gzip header and trailer.
+  if (deflateInit2(&strm_, level, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    return -1;
+  }
+
+  level_ = level;
+  initialized_ = true;
+
+  return 0;
+}
+
+ssize_t Compressor::compress(DefaultMemchunks &dest, const uint8_t *data,
+                             size_t len, bool finish) {
+  if (len == 0 && !finish) {
+    return 0;
+  }
+
+  std::array<uint8_t, 4_k> buf;
+  size_t nwrite = 0;
+
+  auto t = std::chrono::steady_clock::now();
+
+  strm_.next_in = const_cast<uint8_t *>(data);
+  strm_.avail_in = len;
+
+  auto flush = finish ? Z_FINISH : Z_SYNC_FLUSH;
+
+  for (;;) {
+    strm_.next_out = buf.data();
+    strm_.avail_out = buf.size();
+
+    auto rv = deflate(&strm_, flush);
+    if (rv != Z_OK && rv != Z_STREAM_END && rv != Z_BUF_ERROR) {
+      return -1;
+    }
+
+    auto n = buf.size() - strm_.avail_out;
+    dest.append(buf.data(), n);
+    nwrite += n;
+
+    if (rv == Z_STREAM_END || (strm_.avail_out != 0 && !finish)) {
+      break;
+    }
+  }
+
+  if (stat_) {
+    stat_add(stat_->compression_time,
+             std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now() - t)
+                 .count());
+    stat_add(stat_->compression_in_bytes, len);
+    stat_add(stat_->compression_out_bytes, nwrite);
+  }
+
+  return nwrite;
+}
+
+void Compressor::reset() { deflateReset(&strm_); }
+
+void Compressor::set_worker_stat(WorkerStat *stat) { stat_ = stat; }
+
+int Compressor::get_level() const { return level_; }
+
+CompressorPool::CompressorPool(WorkerStat *stat) : stat_(stat) {}
+
+std::unique_ptr<Compressor> CompressorPool::get(int level) {
+  for (auto it = std::rbegin(pool_); it != std::rend(pool_); ++it) {
+    if ((*it)->get_level() != level) {
+      continue;
+    }
+
+    auto compressor = std::move(*it);
+    pool_.erase(std::next(it).base());
+
+    return compressor;
+  }
+
+  auto compressor = std::make_unique<Compressor>();
+  if (compressor->init(level) != 0) {
+    return nullptr;
+  }
+
+  compressor->set_worker_stat(stat_);
+
+  return compressor;
+}
+
+void CompressorPool::release(std::unique_ptr<Compressor> compressor) {
+  if (pool_.size() >= MAX_POOLED_COMPRESSORS) {
+    return;
+  }
+
+  compressor->reset();
+  pool_.push_back(std::move(compressor));
+}
+
+size_t CompressorPool::size() const { return pool_.size(); }
+
+namespace {
+StringRef trim_ows(const StringRef &s) {
+  auto first = std::begin(s);
+  auto last = std::end(s);
+
+  for (; first != last && (*first == ' ' || *first == '\t'); ++first)
+    ;
+  for (; first != last && (*(last - 1) == ' ' || *(last - 1) == '\t'); --last)
+    ;
+
+  return StringRef{first, last};
+}
+} // namespace
+
+namespace {
+// Returns true if the parameters |params| of an element in
+// accept-encoding include q=0.
+bool qvalue_zero(const StringRef &params) {
+  auto first = std::begin(params);
+  auto last = std::end(params);
+
+  for (; first != last;) {
+    auto end = std::find(first + 1, last, ';');
+    auto p = trim_ows(StringRef{first + 1, end});
+    first = end;
+
+    if (!util::istarts_with_l(p, "q=")) {
+      continue;
+    }
+
+    auto q = StringRef{std::begin(p) + str_size("q="), std::end(p)};
+
+    return !q.empty() && q[0] == '0' &&
+           std::all_of(std::begin(q) + 1, std::end(q),
+                       [](char c) { return c == '.' || c == '0'; });
+  }
+
+  return false;
+}
+} // namespace
+
+bool accept_gzip(const StringRef &value) {
+  auto first = std::begin(value);
+  auto last = std::end(value);
+
+  // -1: not mentioned, 0: rejected, 1: accepted
+  int gzip = -1;
+  int any = -1;
+
+  for (;;) {
+    auto end = std::find(first, last, ',');
+    auto elem = StringRef{first, end};
+    auto params_first = std::find(std::begin(elem), std::end(elem), ';');
+    auto coding = trim_ows(StringRef{std::begin(elem), params_first});
+    auto accepted =
+        !qvalue_zero(StringRef{params_first, std::end(elem)}) ? 1 : 0;
+
+    if (util::strieq_l("gzip", coding) || util::strieq_l("x-gzip", coding)) {
+      gzip = accepted;
+    } else if (util::streq_l("*", coding)) {
+      any = accepted;
+    }
+
+    if (end == last) {
+      break;
+    }
+
+    first = end + 1;
+  }
+
+  if (gzip != -1) {
+    return gzip == 1;
+  }
+
+  return any == 1;
+}
+
+bool mime_type_match(const std::vector<StringRef> &mime_types,
+                     const StringRef &value) {
+  auto type = trim_ows(
+      StringRef{std::begin(value), std::find(std::begin(value),
+                                             std::end(value), ';')});
+  if (type.empty()) {
+    return false;
+  }
+
+  for (auto &t : mime_types) {
+    if (util::ends_with_l(t, "/*")) {
+      if (util::streq_l("*/*", t) ||
+          util::istarts_with(type, StringRef{std::begin(t), std::end(t) - 1})) {
+        return true;
+      }
+      continue;
+    }
+
+    if (util::strieq(type, t)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+namespace {
+// Returns true if cache-control header field |value| has
+// no-transform directive.
+bool no_transform(const StringRef &value) {
+  auto first = std::begin(value);
+  auto last = std::end(value);
+
+  for (;;) {
+    auto end = std::find(first, last, ',');
+
+    if (util::strieq_l("no-transform", trim_ows(StringRef{first, end}))) {
+      return true;
+    }
+
+    if (end == last) {
+      return false;
+    }
+
+    first = end + 1;
+  }
+}
+} // namespace
+
+bool response_compression_eligible(const ResponseCompressionConfig &compconf,
+                                   const Request &req, const Response &resp) {
+  if (!compconf.enabled) {
+    return false;
+  }
+
+  if (req.method == HTTP_HEAD || req.method == HTTP_CONNECT ||
+      req.connect_proto != ConnectProto::NONE) {
+    return false;
+  }
+
+  switch (resp.http_status) {
+  case 204:
+  case 206:
+  case 304:
+    return false;
+  default:
+    if (resp.http_status < 200) {
+      return false;
+    }
+  }
+
+  if (resp.fs.content_length == 0 ||
+      (resp.fs.content_length != -1 &&
+       static_cast<size_t>(resp.fs.content_length) < compconf.min_size)) {
+    return false;
+  }
+
+  auto ae = req.fs.header(http2::HD_ACCEPT_ENCODING);
+  if (!ae || !accept_gzip(ae->value)) {
+    return false;
+  }
+
+  auto ct = resp.fs.header(http2::HD_CONTENT_TYPE);
+  if (!ct || !mime_type_match(compconf.mime_types, ct->value)) {
+    return false;
+  }
+
+  auto ce = resp.fs.header(StringRef::from_lit("content-encoding"));
+  if (ce && !util::strieq_l("identity", trim_ows(ce->value))) {
+    return false;
+  }
+
+  if (resp.fs.header(StringRef::from_lit("content-range"))) {
+    return false;
+  }
+
+  for (auto &kv : resp.fs.headers()) {
+    if (kv.token == http2::HD_CACHE_CONTROL && no_transform(kv.value)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace shrpx
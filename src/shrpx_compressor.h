@@ -0,0 +1,126 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_COMPRESSOR_H
+#define SHRPX_COMPRESSOR_H
+
+#include "shrpx.h"
+
+#include <memory>
+#include <vector>
+
+#include <zlib.h>
+
+#include "memchunk.h"
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+struct Request;
+struct Response;
+struct WorkerStat;
+struct ResponseCompressionConfig;
+
+// Compressor compresses response body in gzip format as it streams.
+// It is reused for several responses with reset() in order to avoid
+// the cost of allocating deflate state for each response.
+class Compressor {
+public:
+  Compressor();
+  ~Compressor();
+
+  Compressor(const Compressor &) = delete;
+  Compressor &operator=(const Compressor &) = delete;
+
+  // Initializes deflate state with compression |level|.  Returns 0
+  // if it succeeds, or -1.
+  int init(int level);
+  // Compresses |data| of length |len|, and appends the output to
+  // |dest|.  If |finish| is true, this is the last call for the
+  // current response.  Otherwise, all pending output is flushed to
+  // |dest| so that a client can process the response while it
+  // streams.  This function returns the number of bytes appended, or
+  // -1.
+  ssize_t compress(DefaultMemchunks &dest, const uint8_t *data, size_t len,
+                   bool finish);
+  // Makes this object ready for the next response.
+  void reset();
+
+  // The time spent in deflate, the number of bytes fed to it, and the
+  // number of bytes it produced are added to |stat|.
+  void set_worker_stat(WorkerStat *stat);
+
+  // Returns the compression level given to init().
+  int get_level() const;
+
+private:
+  z_stream strm_;
+  WorkerStat *stat_;
+  int level_;
+  bool initialized_;
+};
+
+// CompressorPool keeps idle Compressors for a worker.
+class CompressorPool {
+public:
+  CompressorPool(WorkerStat *stat);
+
+  // Returns Compressor which is ready to use with compression
+  // |level|, or nullptr if deflate state cannot be initialized.  A
+  // pooled Compressor is reused only if it was initialized with
+  // |level|.
+  std::unique_ptr<Compressor> get(int level);
+  // Returns |compressor| to this pool.  If the pool is full, it is
+  // deleted.
+  void release(std::unique_ptr<Compressor> compressor);
+
+  size_t size() const;
+
+private:
+  std::vector<std::unique_ptr<Compressor>> pool_;
+  WorkerStat *stat_;
+};
+
+// Returns true if the response |resp| to the request |req| should be
+// compressed in gzip under |compconf|.  It is compressed if the
+// client accepts gzip, the response is not encoded yet, and its
+// content-type and size meet |compconf|.
+bool response_compression_eligible(const ResponseCompressionConfig &compconf,
+                                   const Request &req, const Response &resp);
+
+// Returns true if accept-encoding header field value |value|
+// accepts gzip.
+bool accept_gzip(const StringRef &value);
+
+// Returns true if media type of content-type header field value
+// |value| matches one of |mime_types|.  A type ending with "/*"
+// matches any subtype.
+bool mime_type_match(const std::vector<StringRef> &mime_types,
+                     const StringRef &value);
+
+} // namespace shrpx
+
+#endif // SHRPX_COMPRESSOR_H
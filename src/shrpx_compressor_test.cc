@@ -0,0 +1,301 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_compressor_test.h"
+
+#include <array>
+#include <string>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_compressor.h"
+#include "shrpx_config.h"
+#include "shrpx_downstream.h"
+#include "shrpx_worker.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+void add_header(FieldStore &fs, const StringRef &name, const StringRef &value) {
+  fs.add_header_token(name, value, false, http2::lookup_token(name));
+}
+} // namespace
+
+void test_shrpx_compressor_accept_gzip(void) {
+  CU_ASSERT(accept_gzip(StringRef::from_lit("gzip")));
+  CU_ASSERT(accept_gzip(StringRef::from_lit("deflate, GZIP;q=0.5, br")));
+  CU_ASSERT(accept_gzip(StringRef::from_lit("x-gzip")));
+  CU_ASSERT(accept_gzip(StringRef::from_lit("*")));
+  CU_ASSERT(!accept_gzip(StringRef::from_lit("")));
+  CU_ASSERT(!accept_gzip(StringRef::from_lit("deflate, br")));
+  CU_ASSERT(!accept_gzip(StringRef::from_lit("gzip;q=0")));
+  CU_ASSERT(!accept_gzip(StringRef::from_lit("gzip; q=0.000")));
+  CU_ASSERT(accept_gzip(StringRef::from_lit("gzip;q=0.001")));
+  // Explicit gzip takes precedence over "*".
+  CU_ASSERT(!accept_gzip(StringRef::from_lit("*, gzip;q=0")));
+  CU_ASSERT(!accept_gzip(StringRef::from_lit("*;q=0")));
+  CU_ASSERT(!accept_gzip(StringRef::from_lit("gzipx")));
+}
+
+void test_shrpx_compressor_mime_type_match(void) {
+  auto mime_types = std::vector<StringRef>{
+      StringRef::from_lit("text/*"),
+      StringRef::from_lit("application/json"),
+  };
+
+  CU_ASSERT(mime_type_match(mime_types, StringRef::from_lit("text/html")));
+  CU_ASSERT(mime_type_match(mime_types,
+                            StringRef::from_lit("Text/Plain; charset=utf-8")));
+  CU_ASSERT(mime_type_match(mime_types,
+                            StringRef::from_lit("application/json")));
+  CU_ASSERT(!mime_type_match(mime_types,
+                             StringRef::from_lit("application/json-seq")));
+  CU_ASSERT(!mime_type_match(mime_types, StringRef::from_lit("image/png")));
+  CU_ASSERT(!mime_type_match(mime_types, StringRef::from_lit("text")));
+  CU_ASSERT(!mime_type_match(mime_types, StringRef::from_lit("")));
+
+  mime_types = std::vector<StringRef>{StringRef::from_lit("*/*")};
+
+  CU_ASSERT(mime_type_match(mime_types, StringRef::from_lit("image/png")));
+}
+
+void test_shrpx_compressor_eligible(void) {
+  ResponseCompressionConfig compconf{};
+  compconf.mime_types.push_back(StringRef::from_lit("text/*"));
+  compconf.min_size = 100;
+  compconf.level = 6;
+  compconf.enabled = true;
+
+  BlockAllocator balloc(4096, 4096);
+  Request req(balloc);
+  Response resp(balloc);
+
+  req.method = HTTP_GET;
+  add_header(req.fs, StringRef::from_lit("accept-encoding"),
+             StringRef::from_lit("gzip, deflate"));
+
+  resp.http_status = 200;
+  resp.fs.content_length = 1000;
+  add_header(resp.fs, StringRef::from_lit("content-type"),
+             StringRef::from_lit("text/html"));
+
+  CU_ASSERT(response_compression_eligible(compconf, req, resp));
+
+  compconf.enabled = false;
+
+  CU_ASSERT(!response_compression_eligible(compconf, req, resp));
+
+  compconf.enabled = true;
+
+  // Unknown length
+  resp.fs.content_length = -1;
+
+  CU_ASSERT(response_compression_eligible(compconf, req, resp));
+
+  // Too small
+  resp.fs.content_length = 99;
+
+  CU_ASSERT(!response_compression_eligible(compconf, req, resp));
+
+  resp.fs.content_length = 1000;
+
+  req.method = HTTP_HEAD;
+
+  CU_ASSERT(!response_compression_eligible(compconf, req, resp));
+
+  req.method = HTTP_GET;
+
+  for (auto status : {101, 204, 206, 304}) {
+    resp.http_status = status;
+
+    CU_ASSERT(!response_compression_eligible(compconf, req, resp));
+  }
+
+  resp.http_status = 404;
+
+  CU_ASSERT(response_compression_eligible(compconf, req, resp));
+
+  {
+    Response resp(balloc);
+    resp.http_status = 200;
+    add_header(resp.fs, StringRef::from_lit("content-type"),
+               StringRef::from_lit("image/png"));
+
+    CU_ASSERT(!response_compression_eligible(compconf, req, resp));
+  }
+  {
+    Response resp(balloc);
+    resp.http_status = 200;
+    add_header(resp.fs, StringRef::from_lit("content-type"),
+               StringRef::from_lit("text/css"));
+    add_header(resp.fs, StringRef::from_lit("content-encoding"),
+               StringRef::from_lit("br"));
+
+    CU_ASSERT(!response_compression_eligible(compconf, req, resp));
+  }
+  {
+    Response resp(balloc);
+    resp.http_status = 200;
+    add_header(resp.fs, StringRef::from_lit("content-type"),
+               StringRef::from_lit("text/css"));
+    add_header(resp.fs, StringRef::from_lit("content-encoding"),
+               StringRef::from_lit("identity"));
+
+    CU_ASSERT(response_compression_eligible(compconf, req, resp));
+  }
+  {
+    Response resp(balloc);
+    resp.http_status = 200;
+    add_header(resp.fs, StringRef::from_lit("content-type"),
+               StringRef::from_lit("text/css"));
+    add_header(resp.fs, StringRef::from_lit("cache-control"),
+               StringRef::from_lit("public, No-Transform"));
+
+    CU_ASSERT(!response_compression_eligible(compconf, req, resp));
+  }
+  {
+    Request req(balloc);
+    req.method = HTTP_GET;
+    add_header(req.fs, StringRef::from_lit("accept-encoding"),
+               StringRef::from_lit("br"));
+
+    CU_ASSERT(!response_compression_eligible(compconf, req, resp));
+  }
+}
+
+namespace {
+std::string to_string(const DefaultMemchunks &buf) {
+  std::string s;
+  for (auto m = buf.head; m; m = m->next) {
+    s.append(m->pos, m->last);
+  }
+  return s;
+}
+} // namespace
+
+namespace {
+std::string inflate_all(const std::string &in) {
+  z_stream strm{};
+  std::string out;
+  std::array<uint8_t, 4096> buf;
+
+  if (inflateInit2(&strm, 31) != Z_OK) {
+    return out;
+  }
+
+  strm.next_in = reinterpret_cast<uint8_t *>(const_cast<char *>(in.data()));
+  strm.avail_in = in.size();
+
+  for (;;) {
+    strm.next_out = buf.data();
+    strm.avail_out = buf.size();
+
+    auto rv = inflate(&strm, Z_NO_FLUSH);
+
+    out.append(reinterpret_cast<char *>(buf.data()),
+               buf.size() - strm.avail_out);
+
+    if (rv != Z_OK) {
+      break;
+    }
+  }
+
+  inflateEnd(&strm);
+
+  return out;
+}
+} // namespace
+
+void test_shrpx_compressor_compress(void) {
+  MemchunkPool mcpool;
+  WorkerStat stat{};
+  CompressorPool pool(&stat);
+
+  std::string data;
+  for (size_t i = 0; i < 10000; ++i) {
+    data += "nghttpx compresses this line.\n";
+  }
+
+  for (size_t i = 0; i < 2; ++i) {
+    auto compressor = pool.get(6);
+
+    CU_ASSERT(nullptr != compressor);
+    CU_ASSERT(0 == pool.size());
+
+    DefaultMemchunks buf(&mcpool);
+
+    CU_ASSERT(0 == compressor->compress(buf, nullptr, 0, false));
+
+    auto half = data.size() / 2;
+    auto p = reinterpret_cast<const uint8_t *>(data.data());
+
+    // Output of each call must be decodable by itself so that client
+    // can process the response while it streams.
+    CU_ASSERT(compressor->compress(buf, p, half, false) > 0);
+
+    auto partial = inflate_all(to_string(buf));
+
+    CU_ASSERT(data.substr(0, half) == partial);
+
+    CU_ASSERT(compressor->compress(buf, p + half, data.size() - half, false) >
+              0);
+    CU_ASSERT(compressor->compress(buf, nullptr, 0, true) > 0);
+
+    auto compressed = to_string(buf);
+
+    CU_ASSERT(compressed.size() < data.size() / 10);
+    CU_ASSERT(data == inflate_all(compressed));
+
+    pool.release(std::move(compressor));
+
+    CU_ASSERT(1 == pool.size());
+  }
+
+  CU_ASSERT(data.size() * 2 == stat.compression_in_bytes);
+  CU_ASSERT(stat.compression_out_bytes > 0);
+
+  // A Compressor of the other level is not reused.
+  auto compressor = pool.get(1);
+
+  CU_ASSERT(nullptr != compressor);
+  CU_ASSERT(1 == compressor->get_level());
+  CU_ASSERT(1 == pool.size());
+
+  pool.release(std::move(compressor));
+
+  CU_ASSERT(2 == pool.size());
+
+  compressor = pool.get(6);
+
+  CU_ASSERT(6 == compressor->get_level());
+  CU_ASSERT(1 == pool.size());
+
+  compressor = pool.get(1);
+
+  CU_ASSERT(1 == compressor->get_level());
+  CU_ASSERT(0 == pool.size());
+}
+
+} // namespace shrpx
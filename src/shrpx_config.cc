@@ -56,6 +56,7 @@
 #include "shrpx_log.h"
 #include "shrpx_tls.h"
 #include "shrpx_http.h"
+#include "shrpx_maglev.h"
 #ifdef HAVE_MRUBY
 #  include "shrpx_mruby.h"
 #endif // HAVE_MRUBY
@@ -816,6 +817,82 @@ int parse_address_family(int *dest, const StringRef &opt,
 }
 } // namespace
 
+namespace {
+// The largest CPU number accepted by parse_cpu_list.
+constexpr int MAX_CPU = 65535;
+} // namespace
+
+int parse_cpu_list(std::vector<int> &cpus, const StringRef &src) {
+  if (src.empty()) {
+    return -1;
+  }
+
+  auto last = std::end(src);
+  for (auto first = std::begin(src);;) {
+    auto end = std::find(first, last, ',');
+    auto dash = std::find(first, end, '-');
+
+    auto lo = util::parse_uint(StringRef{first, dash});
+    if (lo == -1 || lo > MAX_CPU) {
+      return -1;
+    }
+
+    auto hi = lo;
+    if (dash != end) {
+      hi = util::parse_uint(StringRef{dash + 1, end});
+      if (hi == -1 || hi > MAX_CPU || hi < lo) {
+        return -1;
+      }
+    }
+
+    for (auto cpu = lo; cpu <= hi; ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+
+    if (end == last) {
+      break;
+    }
+
+    first = end + 1;
+  }
+
+  return 0;
+}
+
+namespace {
+int parse_worker_dispatch(WorkerDispatch *dest, const StringRef &opt,
+                          const StringRef &optarg) {
+  if (util::strieq_l("round-robin", optarg)) {
+    *dest = WorkerDispatch::ROUND_ROBIN;
+    return 0;
+  }
+  if (util::strieq_l("least-loaded", optarg)) {
+    *dest = WorkerDispatch::LEAST_LOADED;
+    return 0;
+  }
+
+  LOG(ERROR) << opt << ": bad value: '" << optarg << "'";
+  return -1;
+}
+} // namespace
+
+namespace {
+int parse_io_engine(IOEngine *dest, const StringRef &opt,
+                    const StringRef &optarg) {
+  if (util::strieq_l("libev", optarg)) {
+    *dest = IOEngine::LIBEV;
+    return 0;
+  }
+  if (util::strieq_l("io_uring", optarg)) {
+    *dest = IOEngine::IO_URING;
+    return 0;
+  }
+
+  LOG(ERROR) << opt << ": bad value: '" << optarg << "'";
+  return -1;
+}
+} // namespace
+
 namespace {
 int parse_duration(ev_tstamp *dest, const StringRef &opt,
                    const StringRef &optarg) {
@@ -888,6 +965,7 @@ struct UpstreamParams {
   bool sni_fwd;
   bool proxyproto;
   bool quic;
+  bool reuseport;
 };
 
 namespace {
@@ -929,6 +1007,13 @@ int parse_upstream_params(UpstreamParams &out, const StringRef &src_params) {
       LOG(ERROR) << "quic: QUIC is disabled at compile time";
       return -1;
 #endif // !ENABLE_HTTP3
+    } else if (util::strieq_l("reuseport", param)) {
+#ifdef SO_REUSEPORT
+      out.reuseport = true;
+#else  // !SO_REUSEPORT
+      LOG(ERROR) << "reuseport: SO_REUSEPORT is not supported on this platform";
+      return -1;
+#endif // !SO_REUSEPORT
     } else if (!param.empty()) {
       LOG(ERROR) << "frontend: " << param << ": unknown keyword";
       return -1;
@@ -945,15 +1030,41 @@ int parse_upstream_params(UpstreamParams &out, const StringRef &src_params) {
 }
 } // namespace
 
+namespace {
+// Returns a copy of the name of a header field or a query parameter
+// used as affinity key in |affinity|.  A header field name is
+// lowercased.
+StringRef make_affinity_key_name(BlockAllocator &balloc,
+                                 const AffinityConfig &affinity) {
+  switch (affinity.type) {
+  case SessionAffinity::HEADER: {
+    auto iov = make_byte_ref(balloc, affinity.key_name.size() + 1);
+    auto p = iov.base;
+    p = std::copy(std::begin(affinity.key_name), std::end(affinity.key_name),
+                  p);
+    util::inp_strlower(iov.base, p);
+    *p = '\0';
+    return StringRef{iov.base, p};
+  }
+  case SessionAffinity::QUERY:
+    return make_string_ref(balloc, affinity.key_name);
+  default:
+    return StringRef{};
+  }
+}
+} // namespace
+
 struct DownstreamParams {
   StringRef sni;
   StringRef mruby;
   StringRef group;
   AffinityConfig affinity;
+  LoadBalancing balance;
   ev_tstamp read_timeout;
   ev_tstamp write_timeout;
   size_t fall;
   size_t rise;
+  size_t min_idle;
   uint32_t weight;
   uint32_t group_weight;
   Proto proto;
@@ -962,6 +1073,9 @@ struct DownstreamParams {
   bool redirect_if_not_tls;
   bool upgrade_scheme;
   bool dnf;
+  bool cache;
+  bool collapse;
+  bool prewarm;
 };
 
 namespace {
@@ -1035,6 +1149,22 @@ int parse_downstream_params(DownstreamParams &out,
       }
 
       out.rise = n;
+    } else if (util::istarts_with_l(param, "min-idle=")) {
+      auto valstr = StringRef{first + str_size("min-idle="), end};
+      if (valstr.empty()) {
+        LOG(ERROR) << "backend: min-idle: non-negative integer is expected";
+        return -1;
+      }
+
+      auto n = util::parse_uint(valstr);
+      if (n == -1) {
+        LOG(ERROR) << "backend: min-idle: non-negative integer is expected";
+        return -1;
+      }
+
+      out.min_idle = n;
+    } else if (util::strieq_l("prewarm", param)) {
+      out.prewarm = true;
     } else if (util::strieq_l("tls", param)) {
       out.tls = true;
     } else if (util::strieq_l("no-tls", param)) {
@@ -1049,9 +1179,15 @@ int parse_downstream_params(DownstreamParams &out,
         out.affinity.type = SessionAffinity::IP;
       } else if (util::strieq_l("cookie", valstr)) {
         out.affinity.type = SessionAffinity::COOKIE;
+      } else if (util::strieq_l("header", valstr)) {
+        out.affinity.type = SessionAffinity::HEADER;
+      } else if (util::strieq_l("path", valstr)) {
+        out.affinity.type = SessionAffinity::PATH;
+      } else if (util::strieq_l("query", valstr)) {
+        out.affinity.type = SessionAffinity::QUERY;
       } else {
-        LOG(ERROR)
-            << "backend: affinity: value must be one of none, ip, and cookie";
+        LOG(ERROR) << "backend: affinity: value must be one of none, ip, "
+                      "cookie, header, path, and query";
         return -1;
       }
     } else if (util::istarts_with_l(param, "affinity-cookie-name=")) {
@@ -1091,6 +1227,35 @@ int parse_downstream_params(DownstreamParams &out,
                       "either loose or strict";
         return -1;
       }
+    } else if (util::istarts_with_l(param, "affinity-key-name=")) {
+      auto val = StringRef{first + str_size("affinity-key-name="), end};
+      if (val.empty()) {
+        LOG(ERROR)
+            << "backend: affinity-key-name: non empty string is expected";
+        return -1;
+      }
+      out.affinity.key_name = val;
+    } else if (util::istarts_with_l(param, "affinity-hash=")) {
+      auto valstr = StringRef{first + str_size("affinity-hash="), end};
+      if (util::strieq_l("ring", valstr)) {
+        out.affinity.hash = SessionAffinityHash::RING;
+      } else if (util::strieq_l("maglev", valstr)) {
+        out.affinity.hash = SessionAffinityHash::MAGLEV;
+      } else {
+        LOG(ERROR) << "backend: affinity-hash: value must be either ring or "
+                      "maglev";
+        return -1;
+      }
+    } else if (util::istarts_with_l(param, "affinity-bounded-load=")) {
+      auto valstr =
+          StringRef{first + str_size("affinity-bounded-load="), end};
+      auto n = util::parse_uint(valstr);
+      if (n < 100) {
+        LOG(ERROR) << "backend: affinity-bounded-load: integer equal to or "
+                      "larger than 100 is expected";
+        return -1;
+      }
+      out.affinity.bounded_load = n;
     } else if (util::strieq_l("dns", param)) {
       out.dns = true;
     } else if (util::strieq_l("redirect-if-not-tls", param)) {
@@ -1151,6 +1316,20 @@ int parse_downstream_params(DownstreamParams &out,
       out.group_weight = n;
     } else if (util::strieq_l("dnf", param)) {
       out.dnf = true;
+    } else if (util::strieq_l("cache", param)) {
+      out.cache = true;
+    } else if (util::strieq_l("collapse", param)) {
+      out.collapse = true;
+    } else if (util::istarts_with_l(param, "balance=")) {
+      auto valstr = StringRef{first + str_size("balance="), end};
+      if (util::strieq_l("weighted", valstr)) {
+        out.balance = LoadBalancing::WEIGHTED;
+      } else if (util::strieq_l("p2c", valstr)) {
+        out.balance = LoadBalancing::P2C;
+      } else {
+        LOG(ERROR) << "backend: balance: value must be either weighted or p2c";
+        return -1;
+      }
     } else if (!param.empty()) {
       LOG(ERROR) << "backend: " << param << ": unknown keyword";
       return -1;
@@ -1198,6 +1377,11 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
     return -1;
   }
 
+  if (params.dns && (params.min_idle || params.prewarm)) {
+    LOG(ERROR) << "backend: min-idle and prewarm: cannot be used with dns";
+    return -1;
+  }
+
   if (params.affinity.type == SessionAffinity::COOKIE &&
       params.affinity.cookie.name.empty()) {
     LOG(ERROR) << "backend: affinity-cookie-name is mandatory if "
@@ -1205,8 +1389,20 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
     return -1;
   }
 
+  if ((params.affinity.type == SessionAffinity::HEADER ||
+       params.affinity.type == SessionAffinity::QUERY) &&
+      params.affinity.key_name.empty()) {
+    LOG(ERROR) << "backend: affinity-key-name is mandatory if "
+                  "affinity=header or affinity=query is specified";
+    return -1;
+  }
+
   addr.fall = params.fall;
   addr.rise = params.rise;
+  addr.min_idle = params.min_idle;
+  if (params.prewarm && addr.min_idle == 0) {
+    addr.min_idle = 1;
+  }
   addr.weight = params.weight;
   addr.group = make_string_ref(downstreamconf.balloc, params.group);
   addr.group_weight = params.group_weight;
@@ -1216,6 +1412,7 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
   addr.dns = params.dns;
   addr.upgrade_scheme = params.upgrade_scheme;
   addr.dnf = params.dnf;
+  addr.prewarm = params.prewarm;
 
   auto &routerconf = downstreamconf.router;
   auto &router = routerconf.router;
@@ -1266,12 +1463,20 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
             }
             g.affinity.cookie.secure = params.affinity.cookie.secure;
           }
+          g.affinity.key_name =
+              make_affinity_key_name(downstreamconf.balloc, params.affinity);
+          g.affinity.hash = params.affinity.hash;
+          g.affinity.bounded_load = params.affinity.bounded_load;
         } else if (g.affinity.type != params.affinity.type ||
                    g.affinity.cookie.name != params.affinity.cookie.name ||
                    g.affinity.cookie.path != params.affinity.cookie.path ||
                    g.affinity.cookie.secure != params.affinity.cookie.secure ||
                    g.affinity.cookie.stickiness !=
-                       params.affinity.cookie.stickiness) {
+                       params.affinity.cookie.stickiness ||
+                   !util::strieq(g.affinity.key_name,
+                                 params.affinity.key_name) ||
+                   g.affinity.hash != params.affinity.hash ||
+                   g.affinity.bounded_load != params.affinity.bounded_load) {
           LOG(ERROR) << "backend: affinity: multiple different affinity "
                         "configurations found in a single group";
           return -1;
@@ -1326,6 +1531,18 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
       if (params.dnf) {
         g.dnf = true;
       }
+      // Like dnf, cache is enabled for the group if at least one
+      // backend in the group specifies it.
+      if (params.cache) {
+        g.cache = true;
+      }
+      if (params.collapse) {
+        g.collapse = true;
+      }
+      // The same goes for p2c load balancing.
+      if (params.balance == LoadBalancing::P2C) {
+        g.balance = LoadBalancing::P2C;
+      }
 
       g.addrs.push_back(addr);
       continue;
@@ -1347,11 +1564,18 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
       g.affinity.cookie.secure = params.affinity.cookie.secure;
       g.affinity.cookie.stickiness = params.affinity.cookie.stickiness;
     }
+    g.affinity.key_name =
+        make_affinity_key_name(downstreamconf.balloc, params.affinity);
+    g.affinity.hash = params.affinity.hash;
+    g.affinity.bounded_load = params.affinity.bounded_load;
     g.redirect_if_not_tls = params.redirect_if_not_tls;
     g.mruby_file = make_string_ref(downstreamconf.balloc, params.mruby);
     g.timeout.read = params.read_timeout;
     g.timeout.write = params.write_timeout;
     g.dnf = params.dnf;
+    g.cache = params.cache;
+    g.collapse = params.collapse;
+    g.balance = params.balance;
 
     if (pattern[0] == '*') {
       // wildcard pattern
@@ -1897,7 +2121,15 @@ int option_lookup_token(const char *name, size_t namelen) {
     break;
   case 9:
     switch (name[8]) {
+    case 'c':
+      if (util::strieq_l("log-asyn", name, 8)) {
+        return SHRPX_OPTID_LOG_ASYNC;
+      }
+      break;
     case 'e':
+      if (util::strieq_l("io-engin", name, 8)) {
+        return SHRPX_OPTID_IO_ENGINE;
+      }
       if (util::strieq_l("no-kqueu", name, 8)) {
         return SHRPX_OPTID_NO_KQUEUE;
       }
@@ -1996,6 +2228,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       if (util::strieq_l("host-rewrit", name, 11)) {
         return SHRPX_OPTID_HOST_REWRITE;
       }
+      if (util::strieq_l("http1-splic", name, 11)) {
+        return SHRPX_OPTID_HTTP1_SPLICE;
+      }
       if (util::strieq_l("http2-bridg", name, 11)) {
         return SHRPX_OPTID_HTTP2_BRIDGE;
       }
@@ -2110,6 +2345,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_ERRORLOG_SYSLOG;
       }
       break;
+    case 'h':
+      if (util::strieq_l("worker-dispatc", name, 14)) {
+        return SHRPX_OPTID_WORKER_DISPATCH;
+      }
+      break;
     case 's':
       if (util::strieq_l("frontend-no-tl", name, 14)) {
         return SHRPX_OPTID_FRONTEND_NO_TLS;
@@ -2148,6 +2388,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_ACCESSLOG_FORMAT;
       }
       break;
+    case 'y':
+      if (util::strieq_l("accesslog-binar", name, 15)) {
+        return SHRPX_OPTID_ACCESSLOG_BINARY;
+      }
+      break;
     }
     break;
   case 17:
@@ -2214,6 +2459,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       if (util::strieq_l("require-http-schem", name, 18)) {
         return SHRPX_OPTID_REQUIRE_HTTP_SCHEME;
       }
+      if (util::strieq_l("response-cache-siz", name, 18)) {
+        return SHRPX_OPTID_RESPONSE_CACHE_SIZE;
+      }
       if (util::strieq_l("tls-ticket-key-fil", name, 18)) {
         return SHRPX_OPTID_TLS_TICKET_KEY_FILE;
       }
@@ -2242,6 +2490,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_STREAM_READ_TIMEOUT;
       }
       break;
+    case 'y':
+      if (util::strieq_l("worker-cpu-affinit", name, 18)) {
+        return SHRPX_OPTID_WORKER_CPU_AFFINITY;
+      }
+      break;
     }
     break;
   case 20:
@@ -2256,6 +2509,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_OCSP_UPDATE_INTERVAL;
       }
       break;
+    case 'n':
+      if (util::strieq_l("response-compressio", name, 19)) {
+        return SHRPX_OPTID_RESPONSE_COMPRESSION;
+      }
+      break;
     case 's':
       if (util::strieq_l("max-worker-processe", name, 19)) {
         return SHRPX_OPTID_MAX_WORKER_PROCESSES;
@@ -2290,6 +2548,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       }
       break;
     case 'e':
+      if (util::strieq_l("log-async-buffer-siz", name, 20)) {
+        return SHRPX_OPTID_LOG_ASYNC_BUFFER_SIZE;
+      }
       if (util::strieq_l("quic-bpf-program-fil", name, 20)) {
         return SHRPX_OPTID_QUIC_BPF_PROGRAM_FILE;
       }
@@ -2411,6 +2672,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_NO_ADD_X_FORWARDED_PROTO;
       }
       break;
+    case 's':
+      if (util::strieq_l("backend-http2-io-thread", name, 23)) {
+        return SHRPX_OPTID_BACKEND_HTTP2_IO_THREADS;
+      }
+      break;
     case 't':
       if (util::strieq_l("listener-disable-timeou", name, 23)) {
         return SHRPX_OPTID_LISTENER_DISABLE_TIMEOUT;
@@ -2436,6 +2702,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_HTTP2_NO_COOKIE_CRUMBLING;
       }
       break;
+    case 'k':
+      if (util::strieq_l("buffer-pool-low-watermar", name, 24)) {
+        return SHRPX_OPTID_BUFFER_POOL_LOW_WATERMARK;
+      }
+      break;
     case 's':
       if (util::strieq_l("backend-http2-window-bit", name, 24)) {
         return SHRPX_OPTID_BACKEND_HTTP2_WINDOW_BITS;
@@ -2466,6 +2737,16 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_FRONTEND_HTTP3_WINDOW_SIZE;
       }
       break;
+    case 'k':
+      if (util::strieq_l("buffer-pool-high-watermar", name, 25)) {
+        return SHRPX_OPTID_BUFFER_POOL_HIGH_WATERMARK;
+      }
+      break;
+    case 'l':
+      if (util::strieq_l("response-compression-leve", name, 25)) {
+        return SHRPX_OPTID_RESPONSE_COMPRESSION_LEVEL;
+      }
+      break;
     case 's':
       if (util::strieq_l("frontend-http2-window-bit", name, 25)) {
         return SHRPX_OPTID_FRONTEND_HTTP2_WINDOW_BITS;
@@ -2493,6 +2774,9 @@ int option_lookup_token(const char *name, size_t namelen) {
   case 27:
     switch (name[26]) {
     case 'd':
+      if (util::strieq_l("frontend-zerocopy-threshol", name, 26)) {
+        return SHRPX_OPTID_FRONTEND_ZEROCOPY_THRESHOLD;
+      }
       if (util::strieq_l("tls-session-cache-memcache", name, 26)) {
         return SHRPX_OPTID_TLS_SESSION_CACHE_MEMCACHED;
       }
@@ -2554,6 +2838,21 @@ int option_lookup_token(const char *name, size_t namelen) {
       if (util::strieq_l("backend-connections-per-hos", name, 27)) {
         return SHRPX_OPTID_BACKEND_CONNECTIONS_PER_HOST;
       }
+      if (util::strieq_l("collapsed-forwarding-timeou", name, 27)) {
+        return SHRPX_OPTID_COLLAPSED_FORWARDING_TIMEOUT;
+      }
+      break;
+    }
+    break;
+  case 29:
+    switch (name[28]) {
+    case 'e':
+      if (util::strieq_l("response-cache-max-entry-siz", name, 28)) {
+        return SHRPX_OPTID_RESPONSE_CACHE_MAX_ENTRY_SIZE;
+      }
+      if (util::strieq_l("response-compression-min-siz", name, 28)) {
+        return SHRPX_OPTID_RESPONSE_COMPRESSION_MIN_SIZE;
+      }
       break;
     }
     break;
@@ -2587,6 +2886,9 @@ int option_lookup_token(const char *name, size_t namelen) {
   case 31:
     switch (name[30]) {
     case 's':
+      if (util::strieq_l("response-compression-mime-type", name, 30)) {
+        return SHRPX_OPTID_RESPONSE_COMPRESSION_MIME_TYPES;
+      }
       if (util::strieq_l("tls-session-cache-memcached-tl", name, 30)) {
         return SHRPX_OPTID_TLS_SESSION_CACHE_MEMCACHED_TLS;
       }
@@ -2886,6 +3188,18 @@ int parse_config(Config *config, int optid, const StringRef &opt,
       }
     }
 
+    if (params.reuseport) {
+      if (params.quic) {
+        LOG(ERROR) << "frontend: reuseport cannot be used with quic";
+        return -1;
+      }
+
+      if (params.alt_mode == UpstreamAltMode::API) {
+        LOG(ERROR) << "frontend: api cannot be used with reuseport";
+        return -1;
+      }
+    }
+
     UpstreamAddr addr{};
     addr.fd = -1;
     addr.tls = params.tls;
@@ -2899,10 +3213,12 @@ int parse_config(Config *config, int optid, const StringRef &opt,
     }
 
 #ifdef ENABLE_HTTP3
-    auto &addrs = params.quic ? config->conn.quic_listener.addrs
-                              : config->conn.listener.addrs;
+    auto &addrs = params.quic        ? config->conn.quic_listener.addrs
+                  : params.reuseport ? config->conn.reuseport_listener.addrs
+                                     : config->conn.listener.addrs;
 #else  // !ENABLE_HTTP3
-    auto &addrs = config->conn.listener.addrs;
+    auto &addrs = params.reuseport ? config->conn.reuseport_listener.addrs
+                                   : config->conn.listener.addrs;
 #endif // !ENABLE_HTTP3
 
     if (util::istarts_with(optarg, SHRPX_UNIX_PATH_PREFIX)) {
@@ -2911,6 +3227,12 @@ int parse_config(Config *config, int optid, const StringRef &opt,
         return -1;
       }
 
+      if (params.reuseport) {
+        LOG(ERROR)
+            << "frontend: reuseport cannot be used on UNIX domain socket";
+        return -1;
+      }
+
       auto path = std::begin(optarg) + SHRPX_UNIX_PATH_PREFIX.size();
       addr.host = make_string_ref(config->balloc, StringRef{path, addr_end});
       addr.host_unix = true;
@@ -4176,6 +4498,109 @@ int parse_config(Config *config, int optid, const StringRef &opt,
   case SHRPX_OPTID_TLS_KTLS:
     config->tls.ktls = util::strieq_l("yes", optarg);
     return 0;
+  case SHRPX_OPTID_WORKER_DISPATCH:
+    return parse_worker_dispatch(&config->conn.listener.worker_dispatch, opt,
+                                 optarg);
+  case SHRPX_OPTID_WORKER_CPU_AFFINITY: {
+#ifndef HAVE_SCHED_SETAFFINITY
+    LOG(WARN) << opt << ": CPU affinity is not supported on this platform";
+    return 0;
+#else  // HAVE_SCHED_SETAFFINITY
+    std::vector<int> cpus;
+    if (parse_cpu_list(cpus, optarg) != 0) {
+      LOG(ERROR) << opt << ": bad CPU list: '" << optarg << "'";
+      return -1;
+    }
+
+    config->worker_cpus = std::move(cpus);
+
+    return 0;
+#endif // HAVE_SCHED_SETAFFINITY
+  }
+  case SHRPX_OPTID_RESPONSE_CACHE_SIZE:
+    return parse_uint_with_unit(&config->http.response_cache.max_size, opt,
+                                optarg);
+  case SHRPX_OPTID_RESPONSE_CACHE_MAX_ENTRY_SIZE:
+    return parse_uint_with_unit(&config->http.response_cache.max_entry_size,
+                                opt, optarg);
+  case SHRPX_OPTID_COLLAPSED_FORWARDING_TIMEOUT:
+    return parse_duration(&config->http.collapsed_forwarding.timeout, opt,
+                          optarg);
+  case SHRPX_OPTID_RESPONSE_COMPRESSION:
+    config->http.response_compression.enabled = util::strieq_l("yes", optarg);
+
+    return 0;
+  case SHRPX_OPTID_RESPONSE_COMPRESSION_LEVEL: {
+    int n;
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n < 1 || n > 9) {
+      LOG(ERROR) << opt
+                 << ": specify the integer in the range [1, 9], inclusive";
+      return -1;
+    }
+
+    config->http.response_compression.level = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_RESPONSE_COMPRESSION_MIN_SIZE:
+    return parse_uint_with_unit(&config->http.response_compression.min_size,
+                                opt, optarg);
+  case SHRPX_OPTID_RESPONSE_COMPRESSION_MIME_TYPES: {
+    auto &mime_types = config->http.response_compression.mime_types;
+    auto list = util::split_str(optarg, ',');
+    mime_types.resize(list.size());
+    for (size_t i = 0; i < list.size(); ++i) {
+      mime_types[i] = make_string_ref(config->balloc, list[i]);
+    }
+
+    return 0;
+  }
+  case SHRPX_OPTID_LOG_ASYNC:
+#ifdef NOTHREADS
+    LOG(WARN) << opt
+              << ": Threading disabled at build time, log is written "
+                 "synchronously.";
+    return 0;
+#else  // !NOTHREADS
+    config->logging.async.enabled = util::strieq_l("yes", optarg);
+
+    return 0;
+#endif // !NOTHREADS
+  case SHRPX_OPTID_LOG_ASYNC_BUFFER_SIZE:
+    return parse_uint_with_unit(&config->logging.async.buffer_size, opt,
+                                optarg);
+  case SHRPX_OPTID_ACCESSLOG_BINARY:
+    config->logging.access.binary = util::strieq_l("yes", optarg);
+
+    return 0;
+  case SHRPX_OPTID_BACKEND_HTTP2_IO_THREADS:
+#ifdef NOTHREADS
+    LOG(WARN) << opt
+              << ": Threading disabled at build time, backend HTTP/2 "
+                 "sessions are run by each worker.";
+    return 0;
+#else  // !NOTHREADS
+    return parse_uint(&config->http2.downstream.io_threads, opt, optarg);
+#endif // !NOTHREADS
+  case SHRPX_OPTID_HTTP1_SPLICE:
+    config->http.splice = util::strieq_l("yes", optarg);
+
+    return 0;
+  case SHRPX_OPTID_FRONTEND_ZEROCOPY_THRESHOLD:
+    return parse_uint_with_unit(&config->conn.upstream.zerocopy_threshold,
+                                opt, optarg);
+  case SHRPX_OPTID_IO_ENGINE:
+    return parse_io_engine(&config->conn.upstream.io_engine, opt, optarg);
+  case SHRPX_OPTID_BUFFER_POOL_HIGH_WATERMARK:
+    return parse_uint_with_unit(&config->buffer_pool.high_watermark, opt,
+                                optarg);
+  case SHRPX_OPTID_BUFFER_POOL_LOW_WATERMARK:
+    return parse_uint_with_unit(&config->buffer_pool.low_watermark, opt,
+                                optarg);
   case SHRPX_OPTID_CONF:
     LOG(WARN) << "conf: ignored";
 
@@ -4414,7 +4839,8 @@ int compute_affinity_hash(std::vector<AffinityHash> &res, size_t idx,
 
 // Configures the following member in |config|:
 // conn.downstream_router, conn.downstream.addr_groups,
-// conn.downstream.addr_group_catch_all.
+// conn.downstream.addr_group_catch_all.  Routers in
+// conn.downstream_router are compiled.
 int configure_downstream_group(Config *config, bool http2_proxy,
                                bool numeric_addr_only,
                                const TLSConfig &tlsconf) {
@@ -4588,6 +5014,7 @@ int configure_downstream_group(Config *config, bool http2_proxy,
     }
 
     if (g.affinity.type != SessionAffinity::NONE) {
+      std::vector<MaglevBackend> maglev_backends;
       size_t idx = 0;
       for (auto &addr : g.addrs) {
         StringRef key;
@@ -4612,9 +5039,18 @@ int configure_downstream_group(Config *config, bool http2_proxy,
           g.affinity_hash_map.emplace(addr.affinity_hash, idx);
         }
 
+        if (g.affinity.hash == SessionAffinityHash::MAGLEV) {
+          maglev_backends.push_back(MaglevBackend{key, addr.weight});
+        }
+
         ++idx;
       }
 
+      if (g.affinity.hash == SessionAffinityHash::MAGLEV &&
+          compute_maglev_table(g.affinity_maglev, maglev_backends) != 0) {
+        return -1;
+      }
+
       std::sort(std::begin(g.affinity_hash), std::end(g.affinity_hash),
                 [](const AffinityHash &lhs, const AffinityHash &rhs) {
                   return lhs.hash < rhs.hash;
@@ -4630,6 +5066,14 @@ int configure_downstream_group(Config *config, bool http2_proxy,
     }
   }
 
+  // All patterns have been added.  Lay out routers in the form which
+  // is cheap to look up.
+  router.compile();
+  routerconf.rev_wildcard_router.compile();
+  for (auto &wc : routerconf.wildcard_patterns) {
+    wc.router.compile();
+  }
+
   return 0;
 }
 
@@ -405,12 +405,50 @@ constexpr auto SHRPX_OPT_FRONTEND_QUIC_INITIAL_RTT =
 constexpr auto SHRPX_OPT_REQUIRE_HTTP_SCHEME =
     StringRef::from_lit("require-http-scheme");
 constexpr auto SHRPX_OPT_TLS_KTLS = StringRef::from_lit("tls-ktls");
+constexpr auto SHRPX_OPT_WORKER_DISPATCH =
+    StringRef::from_lit("worker-dispatch");
+constexpr auto SHRPX_OPT_WORKER_CPU_AFFINITY =
+    StringRef::from_lit("worker-cpu-affinity");
+constexpr auto SHRPX_OPT_RESPONSE_CACHE_SIZE =
+    StringRef::from_lit("response-cache-size");
+constexpr auto SHRPX_OPT_RESPONSE_CACHE_MAX_ENTRY_SIZE =
+    StringRef::from_lit("response-cache-max-entry-size");
+constexpr auto SHRPX_OPT_COLLAPSED_FORWARDING_TIMEOUT =
+    StringRef::from_lit("collapsed-forwarding-timeout");
+constexpr auto SHRPX_OPT_RESPONSE_COMPRESSION =
+    StringRef::from_lit("response-compression");
+constexpr auto SHRPX_OPT_RESPONSE_COMPRESSION_LEVEL =
+    StringRef::from_lit("response-compression-level");
+constexpr auto SHRPX_OPT_RESPONSE_COMPRESSION_MIN_SIZE =
+    StringRef::from_lit("response-compression-min-size");
+constexpr auto SHRPX_OPT_RESPONSE_COMPRESSION_MIME_TYPES =
+    StringRef::from_lit("response-compression-mime-types");
+constexpr auto SHRPX_OPT_LOG_ASYNC = StringRef::from_lit("log-async");
+constexpr auto SHRPX_OPT_LOG_ASYNC_BUFFER_SIZE =
+    StringRef::from_lit("log-async-buffer-size");
+constexpr auto SHRPX_OPT_ACCESSLOG_BINARY =
+    StringRef::from_lit("accesslog-binary");
+constexpr auto SHRPX_OPT_BACKEND_HTTP2_IO_THREADS =
+    StringRef::from_lit("backend-http2-io-threads");
+constexpr auto SHRPX_OPT_HTTP1_SPLICE = StringRef::from_lit("http1-splice");
+constexpr auto SHRPX_OPT_FRONTEND_ZEROCOPY_THRESHOLD =
+    StringRef::from_lit("frontend-zerocopy-threshold");
+constexpr auto SHRPX_OPT_IO_ENGINE = StringRef::from_lit("io-engine");
+constexpr auto SHRPX_OPT_BUFFER_POOL_HIGH_WATERMARK =
+    StringRef::from_lit("buffer-pool-high-watermark");
+constexpr auto SHRPX_OPT_BUFFER_POOL_LOW_WATERMARK =
+    StringRef::from_lit("buffer-pool-low-watermark");
 
 constexpr size_t SHRPX_OBFUSCATED_NODE_LENGTH = 8;
 
 constexpr char DEFAULT_DOWNSTREAM_HOST[] = "127.0.0.1";
 constexpr int16_t DEFAULT_DOWNSTREAM_PORT = 80;
 
+constexpr auto DEFAULT_ACCESSLOG_FORMAT =
+    StringRef::from_lit(R"($remote_addr - - [$time_local] )"
+                        R"("$request" $status $body_bytes_sent )"
+                        R"("$http_referer" "$http_user_agent")");
+
 enum class Proto {
   NONE,
   HTTP1,
@@ -426,6 +464,19 @@ enum class SessionAffinity {
   IP,
   // Cookie based affinity
   COOKIE,
+  // Affinity based on the value of a request header field
+  HEADER,
+  // Affinity based on request path
+  PATH,
+  // Affinity based on the value of a query parameter
+  QUERY,
+};
+
+enum class SessionAffinityHash {
+  // Consistent hash ring
+  RING,
+  // Maglev lookup table
+  MAGLEV,
 };
 
 enum class SessionAffinityCookieSecure {
@@ -448,6 +499,16 @@ enum class SessionAffinityCookieStickiness {
   STRICT,
 };
 
+enum class LoadBalancing {
+  // Weighted round robin over weight groups and the addresses inside
+  // them.
+  WEIGHTED,
+  // Inside a weight group, choose 2 addresses at random, and pick the
+  // one with lower cost computed from EWMA of response latency and
+  // the number of outstanding requests.
+  P2C,
+};
+
 struct AffinityConfig {
   // Type of session affinity.
   SessionAffinity type;
@@ -461,6 +522,15 @@ struct AffinityConfig {
     // Affinity Stickiness
     SessionAffinityCookieStickiness stickiness;
   } cookie;
+  // Name of a header field or a query parameter whose value is
+  // hashed if type is SessionAffinity::HEADER or
+  // SessionAffinity::QUERY.  A header field name is lowercased.
+  StringRef key_name;
+  // The lookup table which maps hash to a backend address.
+  SessionAffinityHash hash;
+  // If nonzero, a backend address is skipped if its outstanding
+  // requests exceed this percentage of the average.
+  uint32_t bounded_load;
 };
 
 enum shrpx_forwarded_param {
@@ -491,6 +561,23 @@ enum class UpstreamAltMode {
   HEALTHMON,
 };
 
+// How frontend connections are accepted, read and written.
+enum class IOEngine {
+  // Readiness notification with libev.
+  LIBEV,
+  // io_uring.  It is only available on Linux.
+  IO_URING,
+};
+
+// How the main thread hands accepted connections to worker threads.
+enum class WorkerDispatch {
+  // Give connections to workers in turn.
+  ROUND_ROBIN,
+  // Pick 2 workers at random, and give a connection to the less
+  // loaded one.
+  LEAST_LOADED,
+};
+
 struct UpstreamAddr {
   // The unique index of this address.
   size_t index;
@@ -537,6 +624,9 @@ struct DownstreamAddrConfig {
   StringRef group;
   size_t fall;
   size_t rise;
+  // The number of idle connections to this address which each worker
+  // keeps ready.  0 if disabled.
+  size_t min_idle;
   // weight of this address inside a weight group.  Its range is [1,
   // 256], inclusive.
   uint32_t weight;
@@ -560,6 +650,9 @@ struct DownstreamAddrConfig {
   bool upgrade_scheme;
   // true if a request should not be forwarded to a backend.
   bool dnf;
+  // true if idle connections are established before the first
+  // request is forwarded to this address.
+  bool prewarm;
 };
 
 // Mapping hash to idx which is an index into
@@ -577,6 +670,9 @@ struct DownstreamAddrGroupConfig {
         affinity{SessionAffinity::NONE},
         redirect_if_not_tls(false),
         dnf{false},
+        cache{false},
+        collapse{false},
+        balance{LoadBalancing::WEIGHTED},
         timeout{} {}
 
   StringRef pattern;
@@ -588,6 +684,10 @@ struct DownstreamAddrGroupConfig {
   // Maps affinity hash of each DownstreamAddrConfig to its index in
   // addrs.  It is only assigned when strict stickiness is enabled.
   std::unordered_map<uint32_t, size_t> affinity_hash_map;
+  // Maglev lookup table which maps hash modulo its size to an index
+  // in addrs.  Only used if affinity.hash ==
+  // SessionAffinityHash::MAGLEV.
+  std::vector<uint32_t> affinity_maglev;
   // Cookie based session affinity configuration.
   AffinityConfig affinity;
   // true if this group requires that client connection must be TLS,
@@ -595,6 +695,13 @@ struct DownstreamAddrGroupConfig {
   bool redirect_if_not_tls;
   // true if a request should not be forwarded to a backend.
   bool dnf;
+  // true if responses from this group are stored in response cache.
+  bool cache;
+  // true if identical concurrent requests to this group are collapsed
+  // into a single backend request.
+  bool collapse;
+  // Load balancing algorithm used if session affinity is disabled.
+  LoadBalancing balance;
   // Timeouts for backend connection.
   struct {
     ev_tstamp read;
@@ -831,6 +938,18 @@ struct ErrorPage {
   unsigned int http_status;
 };
 
+struct ResponseCompressionConfig {
+  // Media types of response which is compressed.  A type ending with
+  // "/*" matches any subtype.
+  std::vector<StringRef> mime_types;
+  // The minimum content-length of response which is compressed.
+  size_t min_size;
+  // zlib compression level
+  int level;
+  // true if nghttpx compresses response body if client accepts it.
+  bool enabled;
+};
+
 struct HttpConfig {
   struct {
     // obfuscated value used in "by" parameter of Forwarded header
@@ -858,6 +977,20 @@ struct HttpConfig {
   struct {
     bool strip_incoming;
   } early_data;
+  struct {
+    // The memory capacity of response cache.  It is divided evenly
+    // among workers.
+    size_t max_size;
+    // The maximum length of response body which response cache
+    // stores.
+    size_t max_entry_size;
+  } response_cache;
+  struct {
+    // The maximum time that a collapsed request waits for response
+    // header fields to an identical request.
+    ev_tstamp timeout;
+  } collapsed_forwarding;
+  ResponseCompressionConfig response_compression;
   std::vector<AltSvc> altsvcs;
   // altsvcs serialized in a wire format.
   StringRef altsvc_header_value;
@@ -876,6 +1009,9 @@ struct HttpConfig {
   size_t response_header_field_buffer;
   size_t max_response_header_fields;
   size_t max_requests;
+  // true if response body from HTTP/1 backend is forwarded to
+  // HTTP/1 frontend with splice(2) when possible.
+  bool splice;
   bool no_via;
   bool no_location_rewrite;
   bool no_host_rewrite;
@@ -919,6 +1055,10 @@ struct Http2Config {
     int32_t window_size;
     int32_t connection_window_size;
     size_t max_concurrent_streams;
+    // The number of dedicated threads which run backend HTTP/2
+    // sessions on behalf of all workers.  0 means that each worker
+    // has its own backend HTTP/2 sessions.
+    size_t io_threads;
   } downstream;
   struct {
     ev_tstamp stream_read;
@@ -937,12 +1077,22 @@ struct LoggingConfig {
     // Write accesslog when response headers are received from
     // backend, rather than response body is received and sent.
     bool write_early;
+    // Write accesslog in binary format.  See shrpx_binlog.h.
+    bool binary;
   } access;
   struct {
     StringRef file;
     // Send errorlog to syslog, ignoring errorlog_file.
     bool syslog;
   } error;
+  struct {
+    // The size of ring buffer per thread which holds log records
+    // until the log writer thread writes them.
+    size_t buffer_size;
+    // true if access and error log are written by a dedicated
+    // thread.
+    bool enabled;
+  } async;
   int syslog_facility;
   int severity;
 };
@@ -1032,6 +1182,8 @@ struct ConnectionConfig {
     // TCP fastopen.  If this is positive, it is passed to
     // setsockopt() along with TCP_FASTOPEN.
     int fastopen;
+    // How accepted connections are distributed among workers.
+    WorkerDispatch worker_dispatch;
   } listener;
 
 #ifdef ENABLE_HTTP3
@@ -1040,6 +1192,12 @@ struct ConnectionConfig {
   } quic_listener;
 #endif // ENABLE_HTTP3
 
+  struct {
+    // address of frontend which each worker listens on with its own
+    // SO_REUSEPORT socket.
+    std::vector<UpstreamAddr> addrs;
+  } reuseport_listener;
+
   struct {
     struct {
       ev_tstamp http2_read;
@@ -1053,6 +1211,12 @@ struct ConnectionConfig {
       RateLimitConfig write;
     } ratelimit;
     size_t worker_connections;
+    // The minimum number of bytes of a write to cleartext client
+    // connection to send with MSG_ZEROCOPY.  0 disables MSG_ZEROCOPY.
+    size_t zerocopy_threshold;
+    // I/O engine for accepting connections, and cleartext frontend
+    // connections.
+    IOEngine io_engine;
     // Deprecated.  See UpstreamAddr.accept_proxy_protocol.
     bool accept_proxy_protocol;
   } upstream;
@@ -1091,6 +1255,7 @@ struct Config {
         conn{},
         api{},
         dns{},
+        buffer_pool{},
         config_revision{0},
         num_worker{0},
         padding{0},
@@ -1132,6 +1297,15 @@ struct Config {
   ConnectionConfig conn;
   APIConfig api;
   DNSConfig dns;
+  struct {
+    // The maximum number of bytes of unused buffers which each
+    // MemchunkPool of workers and backend I/O threads keeps.  0 means
+    // no limit.
+    size_t high_watermark;
+    // The number of bytes of unused buffers which each MemchunkPool
+    // keeps after it is trimmed periodically.
+    size_t low_watermark;
+  } buffer_pool;
   StringRef pid_file;
   StringRef conf_path;
   StringRef user;
@@ -1144,6 +1318,10 @@ struct Config {
   // completed or not.
   uint64_t config_revision;
   size_t num_worker;
+  // CPUs which worker threads are pinned to.  N-th worker is pinned
+  // to worker_cpus[N % worker_cpus.size()].  Empty if worker threads
+  // are not pinned.
+  std::vector<int> worker_cpus;
   size_t padding;
   size_t rlimit_nofile;
   size_t rlimit_memlock;
@@ -1175,6 +1353,7 @@ void create_config();
 // generated by gennghttpxfun.py
 enum {
   SHRPX_OPTID_ACCEPT_PROXY_PROTOCOL,
+  SHRPX_OPTID_ACCESSLOG_BINARY,
   SHRPX_OPTID_ACCESSLOG_FILE,
   SHRPX_OPTID_ACCESSLOG_FORMAT,
   SHRPX_OPTID_ACCESSLOG_SYSLOG,
@@ -1199,6 +1378,7 @@ enum {
   SHRPX_OPTID_BACKEND_HTTP2_CONNECTIONS_PER_WORKER,
   SHRPX_OPTID_BACKEND_HTTP2_DECODER_DYNAMIC_TABLE_SIZE,
   SHRPX_OPTID_BACKEND_HTTP2_ENCODER_DYNAMIC_TABLE_SIZE,
+  SHRPX_OPTID_BACKEND_HTTP2_IO_THREADS,
   SHRPX_OPTID_BACKEND_HTTP2_MAX_CONCURRENT_STREAMS,
   SHRPX_OPTID_BACKEND_HTTP2_SETTINGS_TIMEOUT,
   SHRPX_OPTID_BACKEND_HTTP2_WINDOW_BITS,
@@ -1215,6 +1395,8 @@ enum {
   SHRPX_OPTID_BACKEND_TLS_SNI_FIELD,
   SHRPX_OPTID_BACKEND_WRITE_TIMEOUT,
   SHRPX_OPTID_BACKLOG,
+  SHRPX_OPTID_BUFFER_POOL_HIGH_WATERMARK,
+  SHRPX_OPTID_BUFFER_POOL_LOW_WATERMARK,
   SHRPX_OPTID_CACERT,
   SHRPX_OPTID_CERTIFICATE_FILE,
   SHRPX_OPTID_CIPHERS,
@@ -1226,6 +1408,7 @@ enum {
   SHRPX_OPTID_CLIENT_PRIVATE_KEY_FILE,
   SHRPX_OPTID_CLIENT_PROXY,
   SHRPX_OPTID_CLIENT_PSK_SECRETS,
+  SHRPX_OPTID_COLLAPSED_FORWARDING_TIMEOUT,
   SHRPX_OPTID_CONF,
   SHRPX_OPTID_DAEMON,
   SHRPX_OPTID_DH_PARAM_FILE,
@@ -1274,8 +1457,10 @@ enum {
   SHRPX_OPTID_FRONTEND_QUIC_SECRET_FILE,
   SHRPX_OPTID_FRONTEND_READ_TIMEOUT,
   SHRPX_OPTID_FRONTEND_WRITE_TIMEOUT,
+  SHRPX_OPTID_FRONTEND_ZEROCOPY_THRESHOLD,
   SHRPX_OPTID_HEADER_FIELD_BUFFER,
   SHRPX_OPTID_HOST_REWRITE,
+  SHRPX_OPTID_HTTP1_SPLICE,
   SHRPX_OPTID_HTTP2_ALTSVC,
   SHRPX_OPTID_HTTP2_BRIDGE,
   SHRPX_OPTID_HTTP2_MAX_CONCURRENT_STREAMS,
@@ -1284,7 +1469,10 @@ enum {
   SHRPX_OPTID_IGNORE_PER_PATTERN_MRUBY_ERROR,
   SHRPX_OPTID_INCLUDE,
   SHRPX_OPTID_INSECURE,
+  SHRPX_OPTID_IO_ENGINE,
   SHRPX_OPTID_LISTENER_DISABLE_TIMEOUT,
+  SHRPX_OPTID_LOG_ASYNC,
+  SHRPX_OPTID_LOG_ASYNC_BUFFER_SIZE,
   SHRPX_OPTID_LOG_LEVEL,
   SHRPX_OPTID_MAX_HEADER_FIELDS,
   SHRPX_OPTID_MAX_REQUEST_HEADER_FIELDS,
@@ -1320,6 +1508,12 @@ enum {
   SHRPX_OPTID_REDIRECT_HTTPS_PORT,
   SHRPX_OPTID_REQUEST_HEADER_FIELD_BUFFER,
   SHRPX_OPTID_REQUIRE_HTTP_SCHEME,
+  SHRPX_OPTID_RESPONSE_CACHE_MAX_ENTRY_SIZE,
+  SHRPX_OPTID_RESPONSE_CACHE_SIZE,
+  SHRPX_OPTID_RESPONSE_COMPRESSION,
+  SHRPX_OPTID_RESPONSE_COMPRESSION_LEVEL,
+  SHRPX_OPTID_RESPONSE_COMPRESSION_MIME_TYPES,
+  SHRPX_OPTID_RESPONSE_COMPRESSION_MIN_SIZE,
   SHRPX_OPTID_RESPONSE_HEADER_FIELD_BUFFER,
   SHRPX_OPTID_RLIMIT_MEMLOCK,
   SHRPX_OPTID_RLIMIT_NOFILE,
@@ -1362,6 +1556,8 @@ enum {
   SHRPX_OPTID_VERIFY_CLIENT,
   SHRPX_OPTID_VERIFY_CLIENT_CACERT,
   SHRPX_OPTID_VERIFY_CLIENT_TOLERATE_EXPIRED,
+  SHRPX_OPTID_WORKER_CPU_AFFINITY,
+  SHRPX_OPTID_WORKER_DISPATCH,
   SHRPX_OPTID_WORKER_FRONTEND_CONNECTIONS,
   SHRPX_OPTID_WORKER_PROCESS_GRACE_SHUTDOWN_PERIOD,
   SHRPX_OPTID_WORKER_READ_BURST,
@@ -1412,6 +1608,12 @@ HeaderRefs::value_type parse_header(BlockAllocator &balloc,
 std::vector<LogFragment> parse_log_format(BlockAllocator &balloc,
                                           const StringRef &optarg);
 
+// Parses CPU list in |src|, which is a comma separated list of CPU
+// numbers or ranges of CPU numbers (e.g., "0-3,8").  Parsed CPU
+// numbers are appended to |cpus| in the given order.  This function
+// returns 0 if it succeeds, or -1.
+int parse_cpu_list(std::vector<int> &cpus, const StringRef &src);
+
 // Returns string for syslog |facility|.
 StringRef str_syslog_facility(int facility);
 
@@ -160,6 +160,31 @@ void test_shrpx_config_parse_log_format(void) {
   CU_ASSERT("" == res[1].value);
 }
 
+void test_shrpx_config_parse_cpu_list(void) {
+  std::vector<int> cpus;
+
+  CU_ASSERT(0 == parse_cpu_list(cpus, StringRef::from_lit("3")));
+  CU_ASSERT((std::vector<int>{3} == cpus));
+
+  cpus.clear();
+
+  CU_ASSERT(0 == parse_cpu_list(cpus, StringRef::from_lit("0-3,8,10-11")));
+  CU_ASSERT((std::vector<int>{0, 1, 2, 3, 8, 10, 11} == cpus));
+
+  cpus.clear();
+
+  CU_ASSERT(0 == parse_cpu_list(cpus, StringRef::from_lit("5-5,1")));
+  CU_ASSERT((std::vector<int>{5, 1} == cpus));
+
+  CU_ASSERT(-1 == parse_cpu_list(cpus, StringRef{}));
+  CU_ASSERT(-1 == parse_cpu_list(cpus, StringRef::from_lit("1,")));
+  CU_ASSERT(-1 == parse_cpu_list(cpus, StringRef::from_lit("-1")));
+  CU_ASSERT(-1 == parse_cpu_list(cpus, StringRef::from_lit("3-1")));
+  CU_ASSERT(-1 == parse_cpu_list(cpus, StringRef::from_lit("1-")));
+  CU_ASSERT(-1 == parse_cpu_list(cpus, StringRef::from_lit("a")));
+  CU_ASSERT(-1 == parse_cpu_list(cpus, StringRef::from_lit("65536")));
+}
+
 void test_shrpx_config_read_tls_ticket_key_file(void) {
   char file1[] = "/tmp/nghttpx-unittest.XXXXXX";
   auto fd1 = mkstemp(file1);
@@ -128,6 +128,25 @@ void ConnectBlocker::online() {
 
 bool ConnectBlocker::in_offline() const { return offline_; }
 
+void ConnectBlocker::inherit(ConnectBlocker &other) {
+  fail_count_ = other.fail_count_;
+
+  if (other.offline_) {
+    offline();
+    return;
+  }
+
+  if (!ev_is_active(&other.timer_)) {
+    return;
+  }
+
+  call_block_func();
+
+  ev_timer_stop(loop_, &timer_);
+  ev_timer_set(&timer_, ev_timer_remaining(other.loop_, &other.timer_), 0.);
+  ev_timer_start(loop_, &timer_);
+}
+
 void ConnectBlocker::call_block_func() {
   if (block_func_) {
     block_func_();
@@ -63,6 +63,12 @@ public:
   // Returns true if peer is considered offline.
   bool in_offline() const;
 
+  // Takes over the failure count and blocking state of |other|,
+  // which guards the same peer.  If |other| is blocked, this object
+  // is blocked for the remaining time of |other|.  If |other| is
+  // offline, this object becomes offline.
+  void inherit(ConnectBlocker &other);
+
   void call_block_func();
   void call_unblock_func();
 
@@ -28,6 +28,7 @@
 #  include <unistd.h>
 #endif // HAVE_UNISTD_H
 #include <netinet/tcp.h>
+#include <fcntl.h>
 
 #include <limits>
 
@@ -35,6 +36,8 @@
 
 #include "shrpx_tls.h"
 #include "shrpx_memcached_request.h"
+#include "shrpx_splice_pipe.h"
+#include "shrpx_io_uring.h"
 #include "shrpx_log.h"
 #include "memchunk.h"
 #include "util.h"
@@ -75,7 +78,8 @@ Connection::Connection(struct ev_loop *loop, int fd, SSL *ssl,
       tls_dyn_rec_idle_timeout(tls_dyn_rec_idle_timeout),
       proto(proto),
       last_read(0.),
-      read_timeout(read_timeout) {
+      read_timeout(read_timeout),
+      uring(nullptr) {
 
   ev_io_init(&wev, writecb, fd, EV_WRITE);
   ev_io_init(&rev, readcb, proto == Proto::HTTP3 ? 0 : fd, EV_READ);
@@ -135,6 +139,13 @@ void Connection::disconnect() {
     tls.early_data_finish = false;
   }
 
+  if (uring) {
+    // |uring| closes fd after it sends the buffered data.
+    uring->detach();
+    uring = nullptr;
+    fd = -1;
+  }
+
   if (proto != Proto::HTTP3 && fd != -1) {
     shutdown(fd, SHUT_WR);
     close(fd);
@@ -1078,6 +1089,11 @@ ssize_t Connection::read_tls(void *data, size_t len) {
 }
 
 ssize_t Connection::write_clear(const void *data, size_t len) {
+  if (uring) {
+    struct iovec iov = {const_cast<void *>(data), len};
+    return writev_clear(&iov, 1);
+  }
+
   len = std::min(len, wlimit.avail());
   if (len == 0) {
     return 0;
@@ -1110,6 +1126,14 @@ ssize_t Connection::writev_clear(struct iovec *iov, int iovcnt) {
     return 0;
   }
 
+  if (uring) {
+    auto nwrite = uring->writev(iov, iovcnt);
+    if (nwrite > 0) {
+      wlimit.drain(nwrite);
+    }
+    return nwrite;
+  }
+
   ssize_t nwrite;
   while ((nwrite = writev(fd, iov, iovcnt)) == -1 && errno == EINTR)
     ;
@@ -1137,6 +1161,14 @@ ssize_t Connection::read_clear(void *data, size_t len) {
     return 0;
   }
 
+  if (uring) {
+    auto nread = uring->read(data, len);
+    if (nread > 0) {
+      rlimit.drain(nread);
+    }
+    return nread;
+  }
+
   ssize_t nread;
   while ((nread = read(fd, data, len)) == -1 && errno == EINTR)
     ;
@@ -1192,6 +1224,157 @@ ssize_t Connection::peek_clear(void *data, size_t len) {
   return nread;
 }
 
+int Connection::enable_zerocopy() {
+#if defined(SO_ZEROCOPY) && defined(HAVE_LINUX_ERRQUEUE_H)
+  int val = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) == -1) {
+    return -1;
+  }
+
+  return 0;
+#else  // !defined(SO_ZEROCOPY) || !defined(HAVE_LINUX_ERRQUEUE_H)
+  return -1;
+#endif // !defined(SO_ZEROCOPY) || !defined(HAVE_LINUX_ERRQUEUE_H)
+}
+
+ssize_t Connection::writev_zerocopy(struct iovec *iov, int iovcnt,
+                                    bool *zerocopy) {
+  *zerocopy = false;
+
+#ifdef MSG_ZEROCOPY
+  iovcnt = limit_iovec(iov, iovcnt, wlimit.avail());
+  if (iovcnt == 0) {
+    return 0;
+  }
+
+  msghdr msg{};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+
+  ssize_t nwrite;
+  while ((nwrite = sendmsg(fd, &msg, MSG_ZEROCOPY)) == -1 && errno == EINTR)
+    ;
+  if (nwrite == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      wlimit.startw();
+      ev_timer_again(loop, &wt);
+      return 0;
+    }
+    if (errno == ENOBUFS) {
+      // The kernel cannot pin more memory for this socket.
+      return writev_clear(iov, iovcnt);
+    }
+    return SHRPX_ERR_NETWORK;
+  }
+
+  *zerocopy = true;
+
+  wlimit.drain(nwrite);
+
+  if (ev_is_active(&wt)) {
+    ev_timer_again(loop, &wt);
+  }
+
+  return nwrite;
+#else  // !MSG_ZEROCOPY
+  return writev_clear(iov, iovcnt);
+#endif // !MSG_ZEROCOPY
+}
+
+ssize_t Connection::splice_write(SplicePipe &pipe) {
+#ifdef HAVE_SPLICE
+  auto len = std::min(pipe.len, wlimit.avail());
+  if (len == 0) {
+    return 0;
+  }
+
+  ssize_t nwrite;
+  while ((nwrite = splice(pipe.rfd, nullptr, fd, nullptr, len,
+                          SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1 &&
+         errno == EINTR)
+    ;
+  if (nwrite == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      wlimit.startw();
+      ev_timer_again(loop, &wt);
+      return 0;
+    }
+    return SHRPX_ERR_NETWORK;
+  }
+
+  pipe.len -= nwrite;
+
+  wlimit.drain(nwrite);
+
+  if (ev_is_active(&wt)) {
+    ev_timer_again(loop, &wt);
+  }
+
+  return nwrite;
+#else  // !HAVE_SPLICE
+  return SHRPX_ERR_NETWORK;
+#endif // !HAVE_SPLICE
+}
+
+ssize_t Connection::splice_read(SplicePipe &pipe, size_t len) {
+#ifdef HAVE_SPLICE
+  len = std::min(std::min(len, pipe.capacity - pipe.len), rlimit.avail());
+  if (len == 0) {
+    return 0;
+  }
+
+  ssize_t nread;
+  while ((nread = splice(fd, nullptr, pipe.wfd, nullptr, len,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1 &&
+         errno == EINTR)
+    ;
+  if (nread == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    return SHRPX_ERR_NETWORK;
+  }
+
+  if (nread == 0) {
+    return SHRPX_ERR_EOF;
+  }
+
+  pipe.len += nread;
+
+  rlimit.drain(nread);
+
+  return nread;
+#else  // !HAVE_SPLICE
+  return SHRPX_ERR_NETWORK;
+#endif // !HAVE_SPLICE
+}
+
+bool Connection::splice_write_supported() const {
+#ifdef HAVE_SPLICE
+  if (!tls.ssl) {
+    // Data written through |uring| is buffered, and spliced data
+    // would overtake it.
+    return !uring;
+  }
+
+#  ifdef BIO_get_ktls_send
+  return BIO_get_ktls_send(SSL_get_wbio(tls.ssl));
+#  else  // !BIO_get_ktls_send
+  return false;
+#  endif // !BIO_get_ktls_send
+#else    // !HAVE_SPLICE
+  return false;
+#endif   // !HAVE_SPLICE
+}
+
+bool Connection::splice_read_supported() const {
+#ifdef HAVE_SPLICE
+  return !tls.ssl && !uring;
+#else  // !HAVE_SPLICE
+  return false;
+#endif // !HAVE_SPLICE
+}
+
 void Connection::handle_tls_pending_read() {
   if (!ev_is_active(&rev)) {
     return;
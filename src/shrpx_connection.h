@@ -44,6 +44,8 @@
 namespace shrpx {
 
 struct MemcachedRequest;
+struct SplicePipe;
+class IOUringSocket;
 
 namespace tls {
 struct TLSSessionCache;
@@ -145,6 +147,29 @@ struct Connection {
   ssize_t read_nolim_clear(void *data, size_t len);
   // Peek at most |len| bytes of data from socket without rate limit.
   ssize_t peek_clear(void *data, size_t len);
+  // Enables MSG_ZEROCOPY on the socket.  This function returns 0 if
+  // it succeeds, or -1.
+  int enable_zerocopy();
+  // Same as writev_clear, but data is sent with MSG_ZEROCOPY.  The
+  // memory pointed by |iov| must be kept intact until the kernel
+  // notifies the completion.  If the kernel cannot pin the memory,
+  // data is copied as writev_clear does, and |*zerocopy| is set to
+  // false.  Otherwise it is set to true.
+  ssize_t writev_zerocopy(struct iovec *iov, int iovcnt, bool *zerocopy);
+
+  // Moves data in |pipe| to socket with splice(2).  The return value
+  // is the same as write_clear.
+  ssize_t splice_write(SplicePipe &pipe);
+  // Moves at most |len| bytes of data from socket to |pipe| with
+  // splice(2).  The return value is the same as read_clear.
+  ssize_t splice_read(SplicePipe &pipe, size_t len);
+  // Returns true if data can be written to this connection with
+  // splice_write.  This is the case for cleartext connection, or TLS
+  // connection which offloads encryption to kernel TLS.
+  bool splice_write_supported() const;
+  // Returns true if data can be read from this connection with
+  // splice_read.  Only cleartext connection is supported.
+  bool splice_read_supported() const;
 
   void handle_tls_pending_read();
 
@@ -188,6 +213,12 @@ struct Connection {
   ev_tstamp last_read;
   // Timeout for read timer |rt|.
   ev_tstamp read_timeout;
+  // If not nullptr, reads and writes of cleartext data are done with
+  // io_uring through this object.  |rev| and |wev| do not poll |fd|
+  // in this case, and this object feeds events to them instead.  The
+  // memory passed to writev_clear() is sent later, and the caller
+  // must keep it with IOUringSocket::pin().
+  IOUringSocket *uring;
 };
 
 #ifdef ENABLE_HTTP3
@@ -42,6 +42,7 @@
 #include "shrpx_connect_blocker.h"
 #include "shrpx_downstream_connection.h"
 #include "shrpx_accept_handler.h"
+#include "shrpx_io_uring.h"
 #include "shrpx_memcached_dispatcher.h"
 #include "shrpx_signal.h"
 #include "shrpx_log.h"
@@ -98,6 +99,18 @@ void ocsp_chld_cb(struct ev_loop *loop, ev_child *w, int revent) {
 }
 } // namespace
 
+namespace {
+// The interval to return the memory freed by workers and backend I/O
+// threads to the operating system
+constexpr auto MALLOC_TRIM_INTERVAL = 10_s;
+} // namespace
+
+namespace {
+void malloc_trim_cb(struct ev_loop *loop, ev_timer *w, int revent) {
+  malloc_trim_if_requested();
+}
+} // namespace
+
 namespace {
 void thread_join_async_cb(struct ev_loop *loop, ev_async *w, int revent) {
   ev_break(loop);
@@ -134,6 +147,10 @@ ConnectionHandler::ConnectionHandler(struct ev_loop *loop, std::mt19937 &gen)
   ev_timer_init(&ocsp_timer_, ocsp_cb, 0., 0.);
   ocsp_timer_.data = this;
 
+  ev_timer_init(&malloc_trim_timer_, malloc_trim_cb, MALLOC_TRIM_INTERVAL,
+                MALLOC_TRIM_INTERVAL);
+  ev_timer_start(loop_, &malloc_trim_timer_);
+
   ev_io_init(&ocsp_.rev, ocsp_read_cb, -1, EV_READ);
   ocsp_.rev.data = this;
 
@@ -151,6 +168,14 @@ ConnectionHandler::ConnectionHandler(struct ev_loop *loop, std::mt19937 &gen)
   ocsp_.proc.rfd = -1;
 
   reset_ocsp();
+
+  if (get_config()->conn.upstream.io_engine == IOEngine::IO_URING) {
+    io_uring_ = std::make_unique<IOUring>(loop_);
+    if (io_uring_->init() != 0) {
+      LOG(WARN) << "io_uring is not available; fall back to libev";
+      io_uring_.reset();
+    }
+  }
 }
 
 ConnectionHandler::~ConnectionHandler() {
@@ -160,6 +185,13 @@ ConnectionHandler::~ConnectionHandler() {
   ev_io_stop(loop_, &ocsp_.rev);
   ev_timer_stop(loop_, &ocsp_timer_);
   ev_timer_stop(loop_, &disable_acceptor_timer_);
+  ev_timer_stop(loop_, &malloc_trim_timer_);
+
+  // Stop backend I/O threads so that they no longer send events to
+  // workers.
+  for (auto &io : http2_backend_ios_) {
+    io->stop();
+  }
 
 #ifdef ENABLE_HTTP3
   for (auto ssl_ctx : quic_all_ssl_ctx_) {
@@ -184,6 +216,10 @@ ConnectionHandler::~ConnectionHandler() {
   // Free workers before destroying ev_loop
   workers_.clear();
 
+  // Workers send commands to backend I/O threads until they are
+  // freed.
+  http2_backend_ios_.clear();
+
   for (auto loop : worker_loops_) {
     ev_loop_destroy(loop);
   }
@@ -303,6 +339,18 @@ int ConnectionHandler::create_single_worker() {
   }
 #endif // ENABLE_HTTP3
 
+  if (!config->worker_cpus.empty()) {
+    single_worker_->set_cpu(config->worker_cpus[0]);
+    // Everything runs in this thread.
+    if (single_worker_->pin_cpu() != 0) {
+      return -1;
+    }
+  }
+
+  if (single_worker_->setup_reuseport_server_socket() != 0) {
+    return -1;
+  }
+
   return 0;
 }
 
@@ -378,6 +426,15 @@ int ConnectionHandler::create_worker_thread(size_t num) {
   assert(cid_prefixes_.size() == num);
 #  endif // ENABLE_HTTP3
 
+  for (size_t i = 0; i < config->http2.downstream.io_threads; ++i) {
+    http2_backend_ios_.push_back(std::make_unique<Http2BackendIO>(cl_ssl_ctx));
+
+    LLOG(NOTICE, this) << "Created backend I/O thread #" << i;
+  }
+
+  // The number of workers which CPU is assigned to.
+  size_t ncpu_assigned = 0;
+
   for (size_t i = 0; i < num; ++i) {
     auto loop = ev_loop_new(config->ev_loop_flags);
 
@@ -408,12 +465,27 @@ int ConnectionHandler::create_worker_thread(size_t num) {
     }
 #  endif // ENABLE_HTTP3
 
+    if (!apiconf.enabled || i != 0) {
+      if (!config->worker_cpus.empty()) {
+        worker->set_cpu(config->worker_cpus[ncpu_assigned++ %
+                                            config->worker_cpus.size()]);
+      }
+
+      if (worker->setup_reuseport_server_socket() != 0) {
+        return -1;
+      }
+    }
+
     workers_.push_back(std::move(worker));
     worker_loops_.push_back(loop);
 
     LLOG(NOTICE, this) << "Created worker thread #" << workers_.size() - 1;
   }
 
+  for (auto &io : http2_backend_ios_) {
+    io->run_async();
+  }
+
   for (auto &worker : workers_) {
     worker->run_async();
   }
@@ -444,6 +516,8 @@ void ConnectionHandler::join_worker() {
 
 void ConnectionHandler::graceful_shutdown_worker() {
   if (single_worker_) {
+    single_worker_->shutdown_reuseport_acceptor();
+
     return;
   }
 
@@ -513,6 +587,9 @@ int ConnectionHandler::handle_connection(int fd, sockaddr *addr, int addrlen,
     if (LOG_ENABLED(INFO)) {
       LOG(INFO) << "Dispatch connection to API worker #0";
     }
+  } else if (config->conn.listener.worker_dispatch ==
+             WorkerDispatch::LEAST_LOADED) {
+    worker = select_least_loaded_worker();
   } else {
     worker = workers_[worker_round_robin_cnt_].get();
 
@@ -543,14 +620,60 @@ int ConnectionHandler::handle_connection(int fd, sockaddr *addr, int addrlen,
   return 0;
 }
 
+Worker *ConnectionHandler::select_least_loaded_worker() {
+  // Worker #0 is dedicated to API request processing if API is
+  // enabled.
+  size_t first = get_config()->api.enabled ? 1 : 0;
+  auto n = workers_.size() - first;
+
+  if (n == 1) {
+    return workers_[first].get();
+  }
+
+  // Power of two choices: compare the load of 2 distinct workers
+  // picked at random rather than scanning all of them.
+  auto i = std::uniform_int_distribution<size_t>(0, n - 1)(gen_);
+  auto j = std::uniform_int_distribution<size_t>(0, n - 2)(gen_);
+  if (j >= i) {
+    ++j;
+  }
+
+  i += first;
+  j += first;
+
+  auto load_i = workers_[i]->get_load();
+  auto load_j = workers_[j]->get_load();
+
+  auto idx = load_j < load_i ? j : i;
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "Dispatch connection to worker #" << idx << ", load: worker #"
+              << i << "=" << load_i << ", worker #" << j << "=" << load_j;
+  }
+
+  return workers_[idx].get();
+}
+
 struct ev_loop *ConnectionHandler::get_loop() const {
   return loop_;
 }
 
+IOUring *ConnectionHandler::get_io_uring() const { return io_uring_.get(); }
+
 Worker *ConnectionHandler::get_single_worker() const {
   return single_worker_.get();
 }
 
+const std::vector<std::unique_ptr<Worker>> &
+ConnectionHandler::get_workers() const {
+  return workers_;
+}
+
+const std::vector<std::unique_ptr<Http2BackendIO>> &
+ConnectionHandler::get_http2_backend_ios() const {
+  return http2_backend_ios_;
+}
+
 void ConnectionHandler::add_acceptor(std::unique_ptr<AcceptHandler> h) {
   acceptors_.push_back(std::move(h));
 }
@@ -62,6 +62,8 @@ class Http2Session;
 class ConnectBlocker;
 class AcceptHandler;
 class Worker;
+class Http2BackendIO;
+class IOUring;
 struct WorkerStat;
 struct TicketKeys;
 class MemcachedDispatcher;
@@ -138,6 +140,9 @@ public:
   ~ConnectionHandler();
   int handle_connection(int fd, sockaddr *addr, int addrlen,
                         const UpstreamAddr *faddr);
+  // Selects the less loaded one of 2 workers picked at random.  This
+  // function must be called only in multi threaded mode.
+  Worker *select_least_loaded_worker();
   // Creates Worker object for single threaded configuration.
   int create_single_worker();
   // Creates |num| Worker objects for multi threaded configuration.
@@ -149,7 +154,16 @@ public:
   void set_ticket_keys(std::shared_ptr<TicketKeys> ticket_keys);
   const std::shared_ptr<TicketKeys> &get_ticket_keys() const;
   struct ev_loop *get_loop() const;
+  // Returns io_uring which acceptors use.  This function returns
+  // nullptr if connections are accepted with libev.
+  IOUring *get_io_uring() const;
   Worker *get_single_worker() const;
+  // Returns workers created by create_worker_thread().
+  const std::vector<std::unique_ptr<Worker>> &get_workers() const;
+  // Returns backend I/O threads.  It is empty if backend I/O threads
+  // are not enabled.
+  const std::vector<std::unique_ptr<Http2BackendIO>> &
+  get_http2_backend_ios() const;
   void add_acceptor(std::unique_ptr<AcceptHandler> h);
   void delete_acceptor();
   void enable_acceptor();
@@ -280,6 +294,9 @@ private:
   // If at least one frontend enables API request, we allocate 1
   // additional worker dedicated to API request .
   std::vector<std::unique_ptr<Worker>> workers_;
+  // Backend I/O threads which run HTTP/2 backend connections shared
+  // by workers.  They are only used in multi threaded mode.
+  std::vector<std::unique_ptr<Http2BackendIO>> http2_backend_ios_;
   // mutex for serial event resive buffer handling
   std::mutex serial_event_mu_;
   // SerialEvent receive buffer
@@ -297,12 +314,15 @@ private:
   // Worker object.
   std::shared_ptr<TicketKeys> ticket_keys_;
   struct ev_loop *loop_;
+  // This must be destroyed after acceptors_.
+  std::unique_ptr<IOUring> io_uring_;
   std::vector<std::unique_ptr<AcceptHandler>> acceptors_;
 #ifdef HAVE_NEVERBLEED
   neverbleed_t *nb_;
 #endif // HAVE_NEVERBLEED
   ev_timer disable_acceptor_timer_;
   ev_timer ocsp_timer_;
+  ev_timer malloc_trim_timer_;
   ev_async thread_join_asyncev_;
   ev_async serial_event_asyncev_;
 #ifndef NOTHREADS
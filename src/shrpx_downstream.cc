@@ -37,6 +37,10 @@
 #include "shrpx_worker.h"
 #include "shrpx_http2_session.h"
 #include "shrpx_log.h"
+#include "shrpx_response_cache.h"
+#include "shrpx_collapsed_request.h"
+#include "shrpx_compressor.h"
+#include "shrpx_splice_pipe.h"
 #ifdef HAVE_MRUBY
 #  include "shrpx_mruby.h"
 #endif // HAVE_MRUBY
@@ -124,9 +128,12 @@ Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
       blocked_request_buf_(mcpool),
       request_buf_(mcpool),
       response_buf_(mcpool),
+      response_cache_(nullptr),
+      response_compressed_chunk_off_(0),
       upstream_(upstream),
       blocked_link_(nullptr),
       addr_(nullptr),
+      load_addr_(nullptr),
       num_retry_(0),
       stream_id_(stream_id),
       assoc_stream_id_(-1),
@@ -146,7 +153,9 @@ Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
       new_affinity_cookie_(false),
       blocked_request_data_eof_(false),
       expect_100_continue_(false),
-      stop_reading_(false) {
+      stop_reading_(false),
+      collapsible_(true),
+      skip_next_retry_(false) {
 
   auto &timeoutconf = get_config()->http2.timeout;
 
@@ -168,6 +177,42 @@ Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
 #ifdef ENABLE_HTTP3
   rcbufs3_.reserve(32);
 #endif // ENABLE_HTTP3
+
+  // upstream could be nullptr for unittests
+  if (upstream_) {
+    auto worker = upstream_->get_client_handler()->get_worker();
+    auto worker_stat = worker->get_worker_stat();
+
+    if (worker_stat->count_streams) {
+      stat_add(worker_stat->num_streams);
+    }
+    stat_add(worker_stat->requests_total);
+  }
+}
+
+void Downstream::update_stat(WorkerStat *worker_stat) {
+  auto status = resp_.http_status;
+  if (status < 100 || status > 599) {
+    return;
+  }
+
+  auto cls = status / 100 - 1;
+
+  stat_add(worker_stat->responses[cls]);
+  stat_add(worker_stat->request_body_bytes, req_.recv_body_length);
+  stat_add(worker_stat->response_body_bytes, response_sent_body_length);
+
+  if (!group_ || !group_->stat) {
+    return;
+  }
+
+  auto &stat = *group_->stat;
+
+  stat_add(stat.responses[cls]);
+  stat.latency.observe(std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::high_resolution_clock::now() -
+                           request_start_time_)
+                           .count());
 }
 
 Downstream::~Downstream() {
@@ -184,9 +229,27 @@ Downstream::~Downstream() {
     ev_timer_stop(loop, &downstream_rtimer_);
     ev_timer_stop(loop, &downstream_wtimer_);
 
-#ifdef HAVE_MRUBY
     auto handler = upstream_->get_client_handler();
     auto worker = handler->get_worker();
+    auto worker_stat = worker->get_worker_stat();
+
+    if (worker_stat->count_streams) {
+      stat_sub(worker_stat->num_streams);
+    }
+
+    update_stat(worker_stat);
+
+    remove_backend_load();
+
+    if (response_compressor_) {
+      worker->get_compressor_pool()->release(std::move(response_compressor_));
+    }
+
+    if (response_pipe_) {
+      worker->get_splice_pipe_pool()->release(std::move(response_pipe_));
+    }
+
+#ifdef HAVE_MRUBY
     auto mruby_ctx = worker->get_mruby_context();
 
     mruby_ctx->delete_downstream(this);
@@ -207,6 +270,10 @@ Downstream::~Downstream() {
   // explicitly.
   dconn_.reset();
 
+  if (collapsed_request_) {
+    collapsed_request_->on_leader_gone();
+  }
+
 #ifdef ENABLE_HTTP3
   for (auto rcbuf : rcbufs3_) {
     nghttp3_rcbuf_decref(rcbuf);
@@ -1072,7 +1139,16 @@ bool Downstream::accesslog_ready() const {
   return !accesslog_written_ && resp_.http_status > 0;
 }
 
-void Downstream::add_retry() { ++num_retry_; }
+void Downstream::add_retry() {
+  if (skip_next_retry_) {
+    skip_next_retry_ = false;
+    return;
+  }
+
+  ++num_retry_;
+}
+
+void Downstream::skip_next_retry() { skip_next_retry_ = true; }
 
 bool Downstream::no_more_retry() const { return num_retry_ > 50; }
 
@@ -1156,6 +1232,46 @@ void Downstream::set_addr(const DownstreamAddr *addr) { addr_ = addr; }
 
 const DownstreamAddr *Downstream::get_addr() const { return addr_; }
 
+void Downstream::add_backend_load(
+    const std::shared_ptr<DownstreamAddrGroup> &group, DownstreamAddr *addr) {
+  remove_backend_load();
+
+  load_group_ = group;
+  load_addr_ = addr;
+  load_start_time_ = std::chrono::steady_clock::now();
+
+  ++addr->load.outstanding;
+  ++group->shared_addr->outstanding;
+}
+
+void Downstream::observe_backend_latency() {
+  if (!load_addr_ ||
+      load_start_time_ == std::chrono::steady_clock::time_point{}) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+
+  load_addr_->load.observe(
+      std::chrono::duration<double, std::micro>(now - load_start_time_)
+          .count(),
+      now);
+
+  load_start_time_ = {};
+}
+
+void Downstream::remove_backend_load() {
+  if (!load_addr_) {
+    return;
+  }
+
+  --load_addr_->load.outstanding;
+  --load_group_->shared_addr->outstanding;
+
+  load_addr_ = nullptr;
+  load_group_.reset();
+}
+
 void Downstream::set_accesslog_written(bool f) { accesslog_written_ = f; }
 
 void Downstream::renew_affinity_cookie(uint32_t h) {
@@ -1192,4 +1308,210 @@ bool Downstream::get_stop_reading() const { return stop_reading_; }
 
 void Downstream::set_stop_reading(bool f) { stop_reading_ = f; }
 
+void Downstream::set_response_cache(ResponseCache *cache,
+                                    const StringRef &key) {
+  response_cache_ = cache;
+  response_cache_key_ = key;
+}
+
+void Downstream::set_collapsed_request(
+    std::shared_ptr<CollapsedRequest> creq) {
+  collapsed_request_ = std::move(creq);
+}
+
+const std::shared_ptr<CollapsedRequest> &
+Downstream::get_collapsed_request() const {
+  return collapsed_request_;
+}
+
+bool Downstream::get_collapsible() const { return collapsible_; }
+
+void Downstream::set_collapsible(bool f) { collapsible_ = f; }
+
+void Downstream::on_backend_response_header() {
+  if (collapsed_request_) {
+    collapsed_request_->on_response_header(*this);
+  }
+
+  if (!response_cache_) {
+    return;
+  }
+
+  // We may retry the request with another backend.
+  response_cache_entry_.reset();
+
+  if (upgraded_) {
+    return;
+  }
+
+  auto loop = upstream_->get_client_handler()->get_loop();
+
+  response_cache_entry_ = response_cache_->create_entry(
+      response_cache_key_, req_, resp_, ev_now(loop));
+}
+
+void Downstream::on_backend_response_body(const uint8_t *data, size_t len) {
+  if (collapsed_request_) {
+    collapsed_request_->on_response_body(data, len);
+  }
+
+  if (!response_cache_entry_) {
+    return;
+  }
+
+  auto &body = response_cache_entry_->body;
+
+  if (body.rleft() + len > response_cache_entry_->max_body_length) {
+    response_cache_entry_.reset();
+    return;
+  }
+
+  body.append(data, len);
+}
+
+void Downstream::on_backend_response_complete() {
+  auto valid = validate_response_recv_body_length();
+
+  if (collapsed_request_) {
+    if (valid) {
+      collapsed_request_->on_response_complete();
+    } else {
+      collapsed_request_->on_leader_gone();
+    }
+
+    collapsed_request_.reset();
+  }
+
+  if (!response_cache_entry_) {
+    return;
+  }
+
+  if (!valid || !resp_.fs.trailers().empty()) {
+    response_cache_entry_.reset();
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    DLOG(INFO, this) << "Storing response in cache: " << response_cache_key_;
+  }
+
+  response_cache_->store(std::move(response_cache_entry_));
+}
+
+void Downstream::start_response_compression() {
+  auto config = get_config();
+  auto &compconf = config->http.response_compression;
+
+  if (!response_compression_eligible(compconf, req_, resp_)) {
+    return;
+  }
+
+  auto worker = upstream_->get_client_handler()->get_worker();
+
+  response_compressor_ = worker->get_compressor_pool()->get(compconf.level);
+  if (!response_compressor_) {
+    return;
+  }
+
+  stat_add(worker->get_worker_stat()->compressed_responses);
+
+  // The length of compressed body is not known in advance.
+  // resp_.fs.content_length is left intact in order to validate the
+  // length of response body received from backend.
+  resp_.fs.erase_content_length_and_transfer_encoding();
+
+  for (auto &kv : resp_.fs.headers()) {
+    if (util::streq_l("content-encoding", kv.name)) {
+      // This is "identity".
+      kv.name = StringRef{};
+    } else if (util::streq_l("etag", kv.name) &&
+               !util::starts_with(kv.value, StringRef::from_lit("W/"))) {
+      // Compressed representation is not byte-for-byte identical to
+      // the original one.
+      kv.value = concat_string_ref(balloc_, StringRef::from_lit("W/"),
+                                   kv.value);
+    }
+  }
+
+  resp_.fs.add_header_token(StringRef::from_lit("content-encoding"),
+                            StringRef::from_lit("gzip"), false, -1);
+  resp_.fs.add_header_token(StringRef::from_lit("vary"),
+                            StringRef::from_lit("accept-encoding"), false, -1);
+
+  if (req_.http_major <= 0 || (req_.http_major == 1 && req_.http_minor == 0)) {
+    // We simply close connection for pre-HTTP/1.1 in this case.
+    resp_.connection_close = true;
+    chunked_response_ = false;
+  } else {
+    resp_.fs.add_header_token(StringRef::from_lit("transfer-encoding"),
+                              StringRef::from_lit("chunked"), false,
+                              http2::HD_TRANSFER_ENCODING);
+    chunked_response_ = true;
+  }
+}
+
+bool Downstream::get_response_compressed() const {
+  return response_compressor_ != nullptr;
+}
+
+SplicePipe *Downstream::start_response_splice() {
+  assert(!response_pipe_);
+
+  if (collapsed_request_ || response_cache_entry_ || response_compressor_ ||
+      chunked_response_ || upgraded_ ||
+      !upstream_->response_splice_enabled(this)) {
+    return nullptr;
+  }
+
+  auto worker = upstream_->get_client_handler()->get_worker();
+
+  response_pipe_ = worker->get_splice_pipe_pool()->get();
+
+  return response_pipe_.get();
+}
+
+SplicePipe *Downstream::get_response_pipe() const {
+  return response_pipe_.get();
+}
+
+ssize_t Downstream::compress_response_body(DefaultMemchunks &dest,
+                                           const uint8_t *data, size_t len,
+                                           bool finish) {
+  return response_compressor_->compress(dest, data, len, finish);
+}
+
+void Downstream::track_compressed_response_body(size_t compressed,
+                                                size_t raw) {
+  if (compressed == 0 && !response_compressed_chunks_.empty()) {
+    // No output yet.  The raw bytes are credited with the preceding
+    // output.
+    response_compressed_chunks_.back().second += raw;
+    return;
+  }
+
+  response_compressed_chunks_.emplace_back(compressed, raw);
+}
+
+size_t Downstream::drain_compressed_response_body(size_t n) {
+  size_t raw = 0;
+
+  while (!response_compressed_chunks_.empty()) {
+    auto &chunk = response_compressed_chunks_.front();
+    auto left = chunk.first - response_compressed_chunk_off_;
+
+    if (n < left) {
+      response_compressed_chunk_off_ += n;
+      break;
+    }
+
+    n -= left;
+    raw += chunk.second;
+
+    response_compressed_chunks_.pop_front();
+    response_compressed_chunk_off_ = 0;
+  }
+
+  return raw;
+}
+
 } // namespace shrpx
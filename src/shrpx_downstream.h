@@ -29,6 +29,7 @@
 
 #include <cinttypes>
 #include <vector>
+#include <deque>
 #include <string>
 #include <memory>
 #include <chrono>
@@ -59,6 +60,12 @@ class DownstreamConnection;
 struct BlockedLink;
 struct DownstreamAddrGroup;
 struct DownstreamAddr;
+class ResponseCache;
+struct ResponseCacheEntry;
+class CollapsedRequest;
+class Compressor;
+struct SplicePipe;
+struct WorkerStat;
 
 class FieldStore {
 public:
@@ -476,6 +483,10 @@ public:
 
   // Increment retry count
   void add_retry();
+  // Makes the next add_retry() call not count.  This is used when
+  // the request is handed back to upstream without being forwarded
+  // to a backend.
+  void skip_next_retry();
   // true if retry attempt should not be done.
   bool no_more_retry() const;
 
@@ -503,6 +514,19 @@ public:
 
   const DownstreamAddr *get_addr() const;
 
+  // Counts this request as outstanding in the BackendLoad of |addr|
+  // and in the SharedDownstreamAddr of |group| which |addr| belongs
+  // to.  If this request has been counted in
+  // another address, it is removed from there first.
+  void add_backend_load(const std::shared_ptr<DownstreamAddrGroup> &group,
+                        DownstreamAddr *addr);
+  // Adds the time elapsed since add_backend_load() to the latency
+  // EWMA of the address.  This should be called when response header
+  // fields are received.  Only the first call has effect.
+  void observe_backend_latency();
+  // Stops counting this request as outstanding.
+  void remove_backend_load();
+
   void set_accesslog_written(bool f);
 
   // Finds affinity cookie from request header fields.  The name of
@@ -524,6 +548,59 @@ public:
   bool get_stop_reading() const;
   void set_stop_reading(bool f);
 
+  // Makes the response to this request stored in |cache| under |key|
+  // if it is cacheable.
+  void set_response_cache(ResponseCache *cache, const StringRef &key);
+  // Makes this request the leader of |creq|, whose followers receive
+  // a copy of the response to this request.
+  void set_collapsed_request(std::shared_ptr<CollapsedRequest> creq);
+  const std::shared_ptr<CollapsedRequest> &get_collapsed_request() const;
+  // true if this request may be collapsed into an identical request
+  // in flight.
+  bool get_collapsible() const;
+  void set_collapsible(bool f);
+  // Call these methods when the final response header fields, a chunk
+  // of response body, and the end of response are received from
+  // backend respectively.  They pass the response to response cache
+  // and the followers of collapsed request.
+  void on_backend_response_header();
+  void on_backend_response_body(const uint8_t *data, size_t len);
+  void on_backend_response_complete();
+
+  // Starts compressing response body if the response is eligible
+  // for compression, and rewrites response header fields
+  // accordingly.  Call this after the final response header fields
+  // are ready, and before they are sent to client.
+  void start_response_compression();
+  // true if response body is compressed by nghttpx.
+  bool get_response_compressed() const;
+  // Compresses response body |data| of length |len|, and appends the
+  // output to |dest|.  If |finish| is true, the end of compressed
+  // stream is written.  This function returns the number of bytes
+  // appended, or -1.
+  ssize_t compress_response_body(DefaultMemchunks &dest, const uint8_t *data,
+                                 size_t len, bool finish);
+  // Records that |compressed| bytes of compressed response body were
+  // produced from |raw| bytes of response body received from
+  // backend.  Upstream which holds compressed response body in
+  // response buffer calls this function so that backend is credited
+  // with raw bytes when compressed bytes are sent.
+  void track_compressed_response_body(size_t compressed, size_t raw);
+  // Forgets the first |n| bytes of compressed response body recorded
+  // by track_compressed_response_body(), and returns the number of
+  // raw bytes which are fully sent with them.
+  size_t drain_compressed_response_body(size_t n);
+
+  // Takes a pipe from the worker's pool to forward the rest of
+  // response body with splice(2).  This function returns nullptr if
+  // response body must go through response buffer, e.g., it is
+  // compressed, cached, or chunked, or upstream cannot write it with
+  // splice(2).
+  SplicePipe *start_response_splice();
+  // Returns the pipe which holds response body, or nullptr if
+  // response body is not forwarded with splice(2).
+  SplicePipe *get_response_pipe() const;
+
   enum {
     EVENT_ERROR = 0x1,
     EVENT_TIMEOUT = 0x2,
@@ -535,6 +612,10 @@ public:
   int64_t response_sent_body_length;
 
 private:
+  // Counts the response of this object in |worker_stat| and the
+  // statistics of its backend group.
+  void update_stat(WorkerStat *worker_stat);
+
   BlockAllocator balloc_;
 
   std::vector<nghttp2_rcbuf *> rcbufs_;
@@ -562,6 +643,29 @@ private:
   // if frontend uses RFC 8441 WebSocket bootstrapping via HTTP/2.
   StringRef ws_key_;
 
+  // The key of response cache which the response is stored under.
+  StringRef response_cache_key_;
+  ResponseCache *response_cache_;
+  // The response being received from backend, which is stored in
+  // response_cache_ when it completes.
+  std::unique_ptr<ResponseCacheEntry> response_cache_entry_;
+  // The collapsed request which this request leads.
+  std::shared_ptr<CollapsedRequest> collapsed_request_;
+  // The compressor of response body.  It is taken from, and returned
+  // to the worker's pool.
+  std::unique_ptr<Compressor> response_compressor_;
+  // The pairs of the length of compressed response body and the
+  // length of raw response body it was produced from, in the order
+  // of the output.
+  std::deque<std::pair<size_t, size_t>> response_compressed_chunks_;
+  // The number of bytes already sent from the first element of
+  // response_compressed_chunks_.
+  size_t response_compressed_chunk_off_;
+  // The pipe which response body goes through if it is forwarded
+  // with splice(2).  It is taken from, and returned to the worker's
+  // pool.
+  std::unique_ptr<SplicePipe> response_pipe_;
+
   ev_timer upstream_rtimer_;
   ev_timer upstream_wtimer_;
 
@@ -577,6 +681,12 @@ private:
   // logging purpose.
   std::shared_ptr<DownstreamAddrGroup> group_;
   const DownstreamAddr *addr_;
+  // The backend address whose BackendLoad counts this request, and
+  // its group which keeps it alive.
+  std::shared_ptr<DownstreamAddrGroup> load_group_;
+  DownstreamAddr *load_addr_;
+  // The time when this request was counted in load_addr_.
+  std::chrono::steady_clock::time_point load_start_time_;
   // How many times we tried in backend connection
   size_t num_retry_;
   // The stream ID in frontend connection
@@ -621,6 +731,11 @@ private:
   // true if request contains "expect: 100-continue" header field.
   bool expect_100_continue_;
   bool stop_reading_;
+  // true if this request may be collapsed into an identical request
+  // in flight.
+  bool collapsible_;
+  // true if the next add_retry() call does not count.
+  bool skip_next_retry_;
 };
 
 } // namespace shrpx
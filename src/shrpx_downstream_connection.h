@@ -66,6 +66,12 @@ public:
   virtual const std::shared_ptr<DownstreamAddrGroup> &
   get_downstream_addr_group() const = 0;
   virtual DownstreamAddr *get_addr() const = 0;
+  // Moves this connection to |addr| in |group|, which has the same
+  // backend address as the current one.  This is called for pooled
+  // connections when backend configuration is replaced.  Only
+  // poolable connection has to implement this.
+  virtual void rebind(const std::shared_ptr<DownstreamAddrGroup> &group,
+                      DownstreamAddr *addr) {}
 
   void set_client_handler(ClientHandler *client_handler);
   ClientHandler *get_client_handler();
@@ -37,6 +37,18 @@ void DownstreamConnectionPool::remove_all() {
   }
 
   pool_.clear();
+
+  for (auto dconn : prewarming_) {
+    delete dconn;
+  }
+
+  prewarming_.clear();
+
+  for (auto dconn : retired_) {
+    delete dconn;
+  }
+
+  retired_.clear();
 }
 
 void DownstreamConnectionPool::add_downstream_connection(
@@ -46,13 +58,15 @@ void DownstreamConnectionPool::add_downstream_connection(
 
 std::unique_ptr<DownstreamConnection>
 DownstreamConnectionPool::pop_downstream_connection() {
-  if (pool_.empty()) {
+  auto &pool = pool_.empty() ? retired_ : pool_;
+
+  if (pool.empty()) {
     return nullptr;
   }
 
-  auto it = std::begin(pool_);
+  auto it = std::begin(pool);
   auto dconn = std::unique_ptr<DownstreamConnection>(*it);
-  pool_.erase(it);
+  pool.erase(it);
 
   return dconn;
 }
@@ -60,7 +74,32 @@ DownstreamConnectionPool::pop_downstream_connection() {
 void DownstreamConnectionPool::remove_downstream_connection(
     DownstreamConnection *dconn) {
   pool_.erase(dconn);
+  prewarming_.erase(dconn);
+  retired_.erase(dconn);
   delete dconn;
 }
 
+void DownstreamConnectionPool::add_prewarming_connection(
+    std::unique_ptr<DownstreamConnection> dconn) {
+  prewarming_.insert(dconn.release());
+}
+
+void DownstreamConnectionPool::prewarming_done(DownstreamConnection *dconn) {
+  prewarming_.erase(dconn);
+  pool_.insert(dconn);
+}
+
+void DownstreamConnectionPool::retire_downstream_connection(
+    DownstreamConnection *dconn) {
+  if (pool_.erase(dconn)) {
+    retired_.insert(dconn);
+  }
+}
+
+size_t DownstreamConnectionPool::size() const { return pool_.size(); }
+
+size_t DownstreamConnectionPool::num_prewarming_connections() const {
+  return prewarming_.size();
+}
+
 } // namespace shrpx
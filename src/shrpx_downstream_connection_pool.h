@@ -43,9 +43,27 @@ public:
   std::unique_ptr<DownstreamConnection> pop_downstream_connection();
   void remove_downstream_connection(DownstreamConnection *dconn);
   void remove_all();
+  // Adds |dconn| which is still establishing connection.  It is not
+  // returned by pop_downstream_connection() until it is passed to
+  // prewarming_done().
+  void add_prewarming_connection(std::unique_ptr<DownstreamConnection> dconn);
+  // Makes |dconn| added by add_prewarming_connection() available.
+  void prewarming_done(DownstreamConnection *dconn);
+  // Marks |dconn| in the pool as going to be closed soon.  It is
+  // only returned by pop_downstream_connection() if no other
+  // connection is available.
+  void retire_downstream_connection(DownstreamConnection *dconn);
+  // Returns the number of connections available, excluding the
+  // retired ones.
+  size_t size() const;
+  // Returns the number of connections which are still establishing
+  // connection.
+  size_t num_prewarming_connections() const;
 
 private:
   std::set<DownstreamConnection *> pool_;
+  std::set<DownstreamConnection *> prewarming_;
+  std::set<DownstreamConnection *> retired_;
 };
 
 } // namespace shrpx
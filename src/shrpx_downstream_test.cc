@@ -228,4 +228,24 @@ void test_downstream_find_affinity_cookie(void) {
   CU_ASSERT(0 == aff);
 }
 
+void test_downstream_drain_compressed_response_body(void) {
+  Downstream d(nullptr, nullptr, 0);
+
+  // 100 raw bytes are compressed into 10 bytes, and 200 raw bytes are
+  // compressed into 20 bytes.  The next 50 raw bytes produce no
+  // output yet, and the end of stream adds 5 bytes.
+  d.track_compressed_response_body(10, 100);
+  d.track_compressed_response_body(20, 200);
+  d.track_compressed_response_body(0, 50);
+  d.track_compressed_response_body(5, 0);
+
+  // Raw bytes are credited when their output is fully sent.
+  CU_ASSERT(0 == d.drain_compressed_response_body(9));
+  CU_ASSERT(100 == d.drain_compressed_response_body(1));
+  CU_ASSERT(0 == d.drain_compressed_response_body(15));
+  CU_ASSERT(250 == d.drain_compressed_response_body(10));
+  CU_ASSERT(0 == d.drain_compressed_response_body(0));
+  CU_ASSERT(0 == d.drain_compressed_response_body(5));
+}
+
 } // namespace shrpx
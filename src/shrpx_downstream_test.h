@@ -38,6 +38,7 @@ void test_downstream_assemble_request_cookie(void);
 void test_downstream_rewrite_location_response_header(void);
 void test_downstream_supports_non_final_response(void);
 void test_downstream_find_affinity_cookie(void);
+void test_downstream_drain_compressed_response_body(void);
 
 } // namespace shrpx
 
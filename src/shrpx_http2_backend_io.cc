@@ -0,0 +1,1491 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_http2_backend_io.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+
+#include <algorithm>
+
+#include "shrpx_worker.h"
+#include "shrpx_config.h"
+#include "shrpx_log.h"
+#include "shrpx_log_config.h"
+#include "shrpx_error.h"
+#include "http2.h"
+#include "tls.h"
+#include "util.h"
+
+namespace shrpx {
+
+namespace {
+constexpr size_t MAX_BUFFER_SIZE = 32_k;
+} // namespace
+
+namespace {
+// The number of streams which a session accepts before it receives
+// SETTINGS from the backend.  This is the same value which
+// nghttp2_option_set_peer_max_concurrent_streams sets.
+constexpr size_t INITIAL_MAX_CONCURRENT_STREAMS = 100;
+} // namespace
+
+Http2BackendIOBuffer::Http2BackendIOBuffer()
+    : io_(nullptr), buf_(nullptr) {}
+
+Http2BackendIOBuffer::Http2BackendIOBuffer(Http2BackendIO *io)
+    : io_(io), buf_(io->get_buffer_pool()) {}
+
+Http2BackendIOBuffer::Http2BackendIOBuffer(
+    Http2BackendIOBuffer &&other) noexcept
+    : io_(other.io_), buf_(std::move(other.buf_)) {}
+
+Http2BackendIOBuffer::~Http2BackendIOBuffer() { reset(); }
+
+Http2BackendIOBuffer &
+Http2BackendIOBuffer::operator=(Http2BackendIOBuffer &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  reset();
+
+  io_ = other.io_;
+  buf_ = std::move(other.buf_);
+
+  return *this;
+}
+
+void Http2BackendIOBuffer::append(const void *data, size_t len) {
+  std::lock_guard<std::mutex> g(io_->get_buffer_pool_mutex());
+
+  buf_.append(data, len);
+}
+
+void Http2BackendIOBuffer::append(Http2BackendIOBuffer &src) {
+  // A default constructed |src| has no pool.
+  if (src.buf_.rleft() == 0) {
+    return;
+  }
+
+  // Only the links of chunks are changed.  No need to lock the pool.
+  src.buf_.remove(buf_);
+}
+
+size_t Http2BackendIOBuffer::remove(void *dest, size_t len) {
+  if (buf_.rleft() == 0) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> g(io_->get_buffer_pool_mutex());
+
+  return buf_.remove(dest, len);
+}
+
+size_t Http2BackendIOBuffer::rleft() const { return buf_.rleft(); }
+
+const SizedMemchunk *Http2BackendIOBuffer::head() const { return buf_.head; }
+
+void Http2BackendIOBuffer::reset() {
+  if (buf_.head == nullptr) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> g(io_->get_buffer_pool_mutex());
+
+  buf_.reset();
+}
+
+Http2BackendIOStream::Http2BackendIOStream(
+    Worker *worker, Http2BackendIODownstreamConnection *dconn,
+    Http2BackendIO *io)
+    : worker(worker),
+      io(io),
+      dconn(dconn),
+      session(nullptr),
+      reqbuf(io),
+      resp_data(io),
+      unconsumed(0),
+      stream_id(-1),
+      expect_body(false),
+      req_eof(false),
+      detached(false),
+      closed(false) {}
+
+namespace {
+void readcb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto session = static_cast<Http2BackendIOSession *>(conn->data);
+  auto io = session->get_backend_io();
+
+  if (session->do_read() != 0) {
+    session->on_failure();
+    io->remove_session(session);
+    return;
+  }
+
+  if (session->finished()) {
+    io->remove_session(session);
+  }
+}
+} // namespace
+
+namespace {
+void writecb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto session = static_cast<Http2BackendIOSession *>(conn->data);
+  auto io = session->get_backend_io();
+
+  if (session->do_write() != 0) {
+    session->on_failure();
+    io->remove_session(session);
+    return;
+  }
+
+  if (session->finished()) {
+    io->remove_session(session);
+  }
+}
+} // namespace
+
+namespace {
+void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto session = static_cast<Http2BackendIOSession *>(conn->data);
+
+  if (w == &conn->rt && !conn->expired_rt()) {
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "Backend I/O session timed out";
+  }
+
+  session->on_failure();
+  session->get_backend_io()->remove_session(session);
+}
+} // namespace
+
+namespace {
+void settings_timeout_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto session = static_cast<Http2BackendIOSession *>(w->data);
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "SETTINGS timeout";
+  }
+
+  session->on_failure();
+  session->get_backend_io()->remove_session(session);
+}
+} // namespace
+
+Http2BackendIOSession::Http2BackendIOSession(Http2BackendIO *io,
+                                             Http2BackendIOPeer *peer)
+    : conn_(io->get_loop(), -1, nullptr, io->get_mcpool(),
+            io->get_write_timeout(), io->get_read_timeout(), {}, {}, writecb,
+            readcb, timeoutcb, this, get_config()->tls.dyn_rec.warmup_threshold,
+            get_config()->tls.dyn_rec.idle_timeout, Proto::HTTP2),
+      wb_(io->get_mcpool()),
+      read_(&Http2BackendIOSession::noop),
+      write_(&Http2BackendIOSession::noop),
+      io_(io),
+      peer_(peer),
+      session_(nullptr),
+      connected_(false),
+      draining_(false) {
+  ev_timer_init(&settings_timer_, settings_timeout_cb, 0., 0.);
+  settings_timer_.data = this;
+}
+
+Http2BackendIOSession::~Http2BackendIOSession() {
+  ev_timer_stop(conn_.loop, &settings_timer_);
+
+  conn_.rlimit.stopw();
+  conn_.wlimit.stopw();
+
+  conn_.disconnect();
+
+  nghttp2_session_del(session_);
+
+  for (auto &stream : pending_) {
+    stream->session = nullptr;
+  }
+
+  for (auto &kv : streams_) {
+    kv.second->session = nullptr;
+  }
+}
+
+int Http2BackendIOSession::initiate_connection() {
+  int rv;
+
+  if (peer_->tls) {
+    auto ssl = tls::create_ssl(io_->get_ssl_ctx());
+    if (!ssl) {
+      return -1;
+    }
+
+    tls::setup_downstream_http2_alpn(ssl);
+
+    conn_.set_ssl(ssl);
+    conn_.tls.client_session_cache = &peer_->tls_session_cache;
+  }
+
+  const auto &addr = peer_->addr;
+
+  conn_.fd = util::create_nonblock_socket(addr.su.storage.ss_family);
+
+  if (conn_.fd == -1) {
+    auto error = errno;
+    LOG(WARN) << "socket() failed; addr=" << util::to_numeric_addr(&addr)
+              << ", errno=" << error;
+    return -1;
+  }
+
+  rv = connect(conn_.fd, &addr.su.sa, addr.len);
+  if (rv != 0 && errno != EINPROGRESS) {
+    auto error = errno;
+    LOG(WARN) << "connect() failed; addr=" << util::to_numeric_addr(&addr)
+              << ", errno=" << error;
+
+    close(conn_.fd);
+    conn_.fd = -1;
+
+    return -1;
+  }
+
+  if (peer_->tls) {
+    auto sni_name =
+        peer_->sni.empty() ? StringRef{peer_->host} : StringRef{peer_->sni};
+    if (!util::numeric_host(sni_name.c_str())) {
+      SSL_set_tlsext_host_name(conn_.tls.ssl, sni_name.c_str());
+    }
+
+    auto session = tls::reuse_tls_session(peer_->tls_session_cache);
+    if (session) {
+      SSL_set_session(conn_.tls.ssl, session);
+      SSL_SESSION_free(session);
+    }
+
+    conn_.prepare_client_handshake();
+  }
+
+  write_ = &Http2BackendIOSession::connected;
+
+  ev_io_set(&conn_.wev, conn_.fd, EV_WRITE);
+  ev_io_set(&conn_.rev, conn_.fd, EV_READ);
+
+  conn_.wlimit.startw();
+
+  conn_.wt.repeat = io_->get_connect_timeout();
+  ev_timer_again(conn_.loop, &conn_.wt);
+
+  return 0;
+}
+
+int Http2BackendIOSession::connected() {
+  auto sock_error = util::get_socket_error(conn_.fd);
+  if (sock_error != 0) {
+    if (LOG_ENABLED(INFO)) {
+      LOG(INFO) << "Backend connect failed; addr="
+                << util::to_numeric_addr(&peer_->addr)
+                << ": errno=" << sock_error;
+    }
+
+    return -1;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "Backend I/O connection established; addr="
+              << util::to_numeric_addr(&peer_->addr);
+  }
+
+  // Reset timeout for write.  Previously, we set timeout for connect.
+  conn_.wt.repeat = io_->get_write_timeout();
+  ev_timer_again(conn_.loop, &conn_.wt);
+
+  conn_.rlimit.startw();
+  conn_.again_rt();
+
+  if (conn_.tls.ssl) {
+    read_ = &Http2BackendIOSession::tls_handshake;
+    write_ = &Http2BackendIOSession::tls_handshake;
+
+    return do_write();
+  }
+
+  read_ = &Http2BackendIOSession::read_clear;
+  write_ = &Http2BackendIOSession::write_clear;
+
+  return connection_made();
+}
+
+int Http2BackendIOSession::tls_handshake() {
+  conn_.last_read = ev_now(conn_.loop);
+
+  ERR_clear_error();
+
+  auto rv = conn_.tls_handshake();
+
+  if (rv == SHRPX_ERR_INPROGRESS) {
+    return 0;
+  }
+
+  if (rv < 0) {
+    return rv;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "SSL/TLS handshake completed";
+  }
+
+  if (!get_config()->tls.insecure) {
+    auto hostname =
+        peer_->sni.empty() ? StringRef{peer_->host} : StringRef{peer_->sni};
+    if (tls::check_cert(conn_.tls.ssl, &peer_->addr, hostname) != 0) {
+      return -1;
+    }
+  }
+
+  const unsigned char *next_proto = nullptr;
+  unsigned int next_proto_len = 0;
+
+#ifndef OPENSSL_NO_NEXTPROTONEG
+  SSL_get0_next_proto_negotiated(conn_.tls.ssl, &next_proto, &next_proto_len);
+#endif // !OPENSSL_NO_NEXTPROTONEG
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+  if (next_proto == nullptr) {
+    SSL_get0_alpn_selected(conn_.tls.ssl, &next_proto, &next_proto_len);
+  }
+#endif // OPENSSL_VERSION_NUMBER >= 0x10002000L
+
+  if (!util::check_h2_is_selected(StringRef{next_proto, next_proto_len})) {
+    return -1;
+  }
+
+  if (!nghttp2::tls::check_http2_requirement(conn_.tls.ssl)) {
+    if (LOG_ENABLED(INFO)) {
+      LOG(INFO) << "TLSv1.2 was not negotiated. HTTP/2 must not be negotiated.";
+    }
+
+    return -1;
+  }
+
+  read_ = &Http2BackendIOSession::read_tls;
+  write_ = &Http2BackendIOSession::write_tls;
+
+  return connection_made();
+}
+
+int Http2BackendIOSession::read_tls() {
+  conn_.last_read = ev_now(conn_.loop);
+
+  std::array<uint8_t, 16_k> buf;
+
+  ERR_clear_error();
+
+  for (;;) {
+    auto nread = conn_.read_tls(buf.data(), buf.size());
+
+    if (nread == 0) {
+      return 0;
+    }
+
+    if (nread < 0) {
+      return nread;
+    }
+
+    if (on_read(buf.data(), nread) != 0) {
+      return -1;
+    }
+  }
+}
+
+int Http2BackendIOSession::write_tls() {
+  conn_.last_read = ev_now(conn_.loop);
+
+  ERR_clear_error();
+
+  struct iovec iov;
+
+  for (;;) {
+    if (wb_.rleft() > 0) {
+      auto iovcnt = wb_.riovec(&iov, 1);
+      if (iovcnt != 1) {
+        assert(0);
+        return -1;
+      }
+      auto nwrite = conn_.write_tls(iov.iov_base, iov.iov_len);
+
+      if (nwrite == 0) {
+        return 0;
+      }
+
+      if (nwrite < 0) {
+        return nwrite;
+      }
+
+      wb_.drain(nwrite);
+
+      continue;
+    }
+
+    if (on_write() != 0) {
+      return -1;
+    }
+
+    if (wb_.rleft() == 0) {
+      conn_.start_tls_write_idle();
+      break;
+    }
+  }
+
+  conn_.wlimit.stopw();
+  ev_timer_stop(conn_.loop, &conn_.wt);
+
+  return 0;
+}
+
+int Http2BackendIOSession::read_clear() {
+  conn_.last_read = ev_now(conn_.loop);
+
+  std::array<uint8_t, 16_k> buf;
+
+  for (;;) {
+    auto nread = conn_.read_clear(buf.data(), buf.size());
+
+    if (nread == 0) {
+      return 0;
+    }
+
+    if (nread < 0) {
+      return nread;
+    }
+
+    if (on_read(buf.data(), nread) != 0) {
+      return -1;
+    }
+  }
+}
+
+int Http2BackendIOSession::write_clear() {
+  conn_.last_read = ev_now(conn_.loop);
+
+  std::array<struct iovec, MAX_WR_IOVCNT> iov;
+
+  for (;;) {
+    if (wb_.rleft() > 0) {
+      auto iovcnt = wb_.riovec(iov.data(), iov.size());
+      auto nwrite = conn_.writev_clear(iov.data(), iovcnt);
+
+      if (nwrite == 0) {
+        return 0;
+      }
+
+      if (nwrite < 0) {
+        return nwrite;
+      }
+
+      wb_.drain(nwrite);
+
+      continue;
+    }
+
+    if (on_write() != 0) {
+      return -1;
+    }
+
+    if (wb_.rleft() == 0) {
+      break;
+    }
+  }
+
+  conn_.wlimit.stopw();
+  ev_timer_stop(conn_.loop, &conn_.wt);
+
+  return 0;
+}
+
+int Http2BackendIOSession::noop() { return 0; }
+
+int Http2BackendIOSession::do_read() { return (this->*read_)(); }
+
+int Http2BackendIOSession::do_write() { return (this->*write_)(); }
+
+int Http2BackendIOSession::on_read(const uint8_t *data, size_t len) {
+  auto rv = nghttp2_session_mem_recv(session_, data, len);
+  if (rv < 0) {
+    LOG(ERROR) << "nghttp2_session_mem_recv() returned error: "
+               << nghttp2_strerror(rv);
+    return -1;
+  }
+
+  signal_write();
+
+  return 0;
+}
+
+int Http2BackendIOSession::on_write() {
+  for (;;) {
+    const uint8_t *data;
+    auto datalen = nghttp2_session_mem_send(session_, &data);
+
+    if (datalen < 0) {
+      LOG(ERROR) << "nghttp2_session_mem_send() returned error: "
+                 << nghttp2_strerror(datalen);
+      return -1;
+    }
+    if (datalen == 0) {
+      break;
+    }
+    wb_.append(data, datalen);
+
+    if (wb_.rleft() >= MAX_BUFFER_SIZE) {
+      break;
+    }
+  }
+
+  return 0;
+}
+
+void Http2BackendIOSession::signal_write() { conn_.wlimit.startw(); }
+
+bool Http2BackendIOSession::finished() const {
+  return session_ && streams_.empty() && pending_.empty() &&
+         nghttp2_session_want_read(session_) == 0 &&
+         nghttp2_session_want_write(session_) == 0 && wb_.rleft() == 0;
+}
+
+void Http2BackendIOSession::start_settings_timer() {
+  auto &downstreamconf = get_config()->http2.downstream;
+
+  ev_timer_set(&settings_timer_, downstreamconf.timeout.settings, 0.);
+  ev_timer_start(conn_.loop, &settings_timer_);
+}
+
+void Http2BackendIOSession::stop_settings_timer() {
+  ev_timer_stop(conn_.loop, &settings_timer_);
+}
+
+void Http2BackendIOSession::set_draining() { draining_ = true; }
+
+Http2BackendIO *Http2BackendIOSession::get_backend_io() const { return io_; }
+
+Http2BackendIOPeer *Http2BackendIOSession::get_peer() const { return peer_; }
+
+bool Http2BackendIOSession::can_add_stream() const {
+  if (draining_) {
+    return false;
+  }
+
+  if (!connected_) {
+    return pending_.size() < INITIAL_MAX_CONCURRENT_STREAMS;
+  }
+
+  return streams_.size() <
+         nghttp2_session_get_remote_settings(
+             session_, NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
+}
+
+void Http2BackendIOSession::add_stream(
+    const std::shared_ptr<Http2BackendIOStream> &stream) {
+  stream->session = this;
+
+  if (!connected_) {
+    pending_.push_back(stream);
+    return;
+  }
+
+  submit_request(stream);
+}
+
+void Http2BackendIOSession::remove_pending_stream(
+    Http2BackendIOStream *stream) {
+  auto it = std::find_if(
+      std::begin(pending_), std::end(pending_),
+      [stream](const std::shared_ptr<Http2BackendIOStream> &s) {
+        return s.get() == stream;
+      });
+  if (it == std::end(pending_)) {
+    return;
+  }
+
+  stream->session = nullptr;
+  stream->closed = true;
+
+  pending_.erase(it);
+}
+
+namespace {
+ssize_t data_read_callback(nghttp2_session *session, int32_t stream_id,
+                           uint8_t *buf, size_t length, uint32_t *data_flags,
+                           nghttp2_data_source *source, void *user_data) {
+  int rv;
+  auto io_session = static_cast<Http2BackendIOSession *>(user_data);
+  auto stream = static_cast<Http2BackendIOStream *>(
+      nghttp2_session_get_stream_user_data(session, stream_id));
+  if (!stream) {
+    return NGHTTP2_ERR_DEFERRED;
+  }
+
+  auto nread = stream->reqbuf.remove(buf, length);
+
+  if (stream->reqbuf.rleft() == 0 && stream->req_eof) {
+    *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+
+    if (!stream->trailers.empty()) {
+      std::vector<nghttp2_nv> nva;
+      nva.reserve(stream->trailers.size());
+      for (auto &hd : stream->trailers) {
+        nva.push_back(http2::make_nv(hd.name, hd.value, hd.no_index));
+      }
+
+      rv = nghttp2_submit_trailer(session, stream_id, nva.data(), nva.size());
+      if (rv != 0) {
+        if (nghttp2_is_fatal(rv)) {
+          return NGHTTP2_ERR_CALLBACK_FAILURE;
+        }
+      } else {
+        *data_flags |= NGHTTP2_DATA_FLAG_NO_END_STREAM;
+      }
+    }
+  }
+
+  if (nread == 0 && (*data_flags & NGHTTP2_DATA_FLAG_EOF) == 0) {
+    return NGHTTP2_ERR_DEFERRED;
+  }
+
+  if (nread > 0 && !stream->detached) {
+    Http2BackendIOEvent ev{};
+    ev.type = Http2BackendIOEventType::UPLOAD_SENT;
+    ev.stream = stream->shared_from_this();
+    ev.len = nread;
+
+    io_session->get_backend_io()->post_event(std::move(ev));
+  }
+
+  return nread;
+}
+} // namespace
+
+int Http2BackendIOSession::submit_request(
+    const std::shared_ptr<Http2BackendIOStream> &stream) {
+  std::vector<nghttp2_nv> nva;
+  nva.reserve(stream->headers.size());
+
+  for (auto &hd : stream->headers) {
+    nva.push_back(http2::make_nv(hd.name, hd.value, hd.no_index));
+  }
+
+  nghttp2_data_provider data_prd{{}, data_read_callback};
+
+  auto stream_id =
+      nghttp2_submit_request(session_, nullptr, nva.data(), nva.size(),
+                             stream->expect_body ? &data_prd : nullptr,
+                             stream.get());
+  if (stream_id < 0) {
+    LOG(ERROR) << "nghttp2_submit_request() failed: "
+               << nghttp2_strerror(stream_id);
+
+    close_stream(stream.get(), NGHTTP2_INTERNAL_ERROR, false);
+
+    return -1;
+  }
+
+  stream->stream_id = stream_id;
+  stream->headers.clear();
+
+  streams_.emplace(stream_id, stream);
+
+  signal_write();
+
+  return 0;
+}
+
+int Http2BackendIOSession::resume_data(Http2BackendIOStream *stream) {
+  if (!connected_ || stream->stream_id == -1) {
+    return 0;
+  }
+
+  auto rv = nghttp2_session_resume_data(session_, stream->stream_id);
+  switch (rv) {
+  case 0:
+  case NGHTTP2_ERR_INVALID_ARGUMENT:
+    break;
+  default:
+    LOG(ERROR) << "nghttp2_session_resume_data() failed: "
+               << nghttp2_strerror(rv);
+    return -1;
+  }
+
+  signal_write();
+
+  return 0;
+}
+
+void Http2BackendIOSession::consume(Http2BackendIOStream *stream,
+                                    size_t len) {
+  // The worker might ask to consume the bytes which have already been
+  // consumed when the stream was reset.
+  len = std::min(len, stream->unconsumed);
+  if (len == 0) {
+    return;
+  }
+
+  stream->unconsumed -= len;
+
+  nghttp2_session_consume(session_, stream->stream_id, len);
+
+  signal_write();
+}
+
+void Http2BackendIOSession::submit_rst_stream(Http2BackendIOStream *stream,
+                                              uint32_t error_code) {
+  if (stream->stream_id == -1) {
+    if (stream->detached) {
+      remove_pending_stream(stream);
+      return;
+    }
+
+    auto it = std::find_if(
+        std::begin(pending_), std::end(pending_),
+        [stream](const std::shared_ptr<Http2BackendIOStream> &s) {
+          return s.get() == stream;
+        });
+    if (it == std::end(pending_)) {
+      return;
+    }
+
+    auto s = std::move(*it);
+    pending_.erase(it);
+
+    close_stream(s.get(), error_code, false);
+
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "Backend I/O RST_STREAM stream_id=" << stream->stream_id
+              << " with error_code=" << error_code;
+  }
+
+  nghttp2_submit_rst_stream(session_, NGHTTP2_FLAG_NONE, stream->stream_id,
+                            error_code);
+
+  consume(stream, stream->unconsumed);
+
+  signal_write();
+}
+
+void Http2BackendIOSession::keep_alive_idle() {
+  if (!connected_ || !streams_.empty()) {
+    return;
+  }
+
+  // Every worker asks this periodically.  Only send PING when it is
+  // needed.
+  if (ev_now(conn_.loop) - conn_.last_read < io_->get_read_timeout() / 2) {
+    return;
+  }
+
+  if (nghttp2_submit_ping(session_, NGHTTP2_FLAG_NONE, nullptr) != 0) {
+    return;
+  }
+
+  signal_write();
+}
+
+void Http2BackendIOSession::close_stream(Http2BackendIOStream *stream,
+                                         uint32_t error_code,
+                                         bool session_failure) {
+  if (!session_failure && session_ && stream->unconsumed) {
+    // The stream is gone.  Give the bytes back to the connection
+    // window so that the other streams are not blocked.
+    nghttp2_session_consume_connection(session_, stream->unconsumed);
+  }
+
+  stream->unconsumed = 0;
+  stream->session = nullptr;
+  stream->closed = true;
+
+  if (stream->detached) {
+    return;
+  }
+
+  Http2BackendIOEvent ev{};
+  ev.type = Http2BackendIOEventType::CLOSE;
+  ev.stream = stream->shared_from_this();
+  ev.error_code = error_code;
+  ev.session_failure = session_failure;
+  ev.connect_failed = session_failure && !connected_;
+  ev.submitted = stream->stream_id != -1;
+
+  io_->post_event(std::move(ev));
+}
+
+void Http2BackendIOSession::on_stream_close(Http2BackendIOStream *stream,
+                                            uint32_t error_code) {
+  auto it = streams_.find(stream->stream_id);
+  if (it == std::end(streams_)) {
+    return;
+  }
+
+  // Keep stream alive until close_stream returns.
+  auto s = std::move((*it).second);
+  streams_.erase(it);
+
+  close_stream(s.get(), error_code, false);
+}
+
+void Http2BackendIOSession::on_failure() {
+  draining_ = true;
+
+  auto pending = std::move(pending_);
+  for (auto &stream : pending) {
+    close_stream(stream.get(), NGHTTP2_INTERNAL_ERROR, true);
+  }
+
+  auto streams = std::move(streams_);
+  for (auto &kv : streams) {
+    close_stream(kv.second.get(), NGHTTP2_INTERNAL_ERROR, true);
+  }
+}
+
+namespace {
+int on_header_callback2(nghttp2_session *session, const nghttp2_frame *frame,
+                        nghttp2_rcbuf *name, nghttp2_rcbuf *value,
+                        uint8_t flags, void *user_data) {
+  if (frame->hd.type != NGHTTP2_HEADERS) {
+    return 0;
+  }
+
+  auto stream = static_cast<Http2BackendIOStream *>(
+      nghttp2_session_get_stream_user_data(session, frame->hd.stream_id));
+  if (!stream || stream->detached) {
+    return 0;
+  }
+
+  auto namebuf = nghttp2_rcbuf_get_buf(name);
+  auto valuebuf = nghttp2_rcbuf_get_buf(value);
+
+  stream->resp_headers.push_back(
+      {std::string{namebuf.base, namebuf.base + namebuf.len},
+       std::string{valuebuf.base, valuebuf.base + valuebuf.len},
+       (flags & NGHTTP2_NV_FLAG_NO_INDEX) != 0});
+
+  return 0;
+}
+} // namespace
+
+namespace {
+int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame,
+                           void *user_data) {
+  auto io_session = static_cast<Http2BackendIOSession *>(user_data);
+
+  switch (frame->hd.type) {
+  case NGHTTP2_DATA: {
+    auto stream = static_cast<Http2BackendIOStream *>(
+        nghttp2_session_get_stream_user_data(session, frame->hd.stream_id));
+    if (!stream || stream->detached) {
+      return 0;
+    }
+
+    Http2BackendIOEvent ev{};
+    ev.type = Http2BackendIOEventType::DATA;
+    ev.stream = stream->shared_from_this();
+    // This leaves resp_data empty, and ready for the next DATA
+    // frame.
+    ev.data = std::move(stream->resp_data);
+    ev.end_stream = frame->hd.flags & NGHTTP2_FLAG_END_STREAM;
+
+    io_session->get_backend_io()->post_event(std::move(ev));
+
+    return 0;
+  }
+  case NGHTTP2_HEADERS: {
+    auto stream = static_cast<Http2BackendIOStream *>(
+        nghttp2_session_get_stream_user_data(session, frame->hd.stream_id));
+    if (!stream || stream->detached) {
+      return 0;
+    }
+
+    Http2BackendIOEvent ev{};
+    ev.type = Http2BackendIOEventType::HEADERS;
+    ev.stream = stream->shared_from_this();
+    ev.headers = std::move(stream->resp_headers);
+    ev.cat = frame->headers.cat;
+    ev.end_stream = frame->hd.flags & NGHTTP2_FLAG_END_STREAM;
+
+    stream->resp_headers.clear();
+
+    io_session->get_backend_io()->post_event(std::move(ev));
+
+    return 0;
+  }
+  case NGHTTP2_SETTINGS:
+    if (frame->hd.flags & NGHTTP2_FLAG_ACK) {
+      io_session->stop_settings_timer();
+    }
+
+    return 0;
+  case NGHTTP2_GOAWAY:
+    if (LOG_ENABLED(INFO)) {
+      LOG(INFO) << "Backend I/O GOAWAY received: last-stream-id="
+                << frame->goaway.last_stream_id
+                << ", error_code=" << frame->goaway.error_code;
+    }
+
+    io_session->set_draining();
+
+    return 0;
+  default:
+    return 0;
+  }
+}
+} // namespace
+
+namespace {
+int on_data_chunk_recv_callback(nghttp2_session *session, uint8_t flags,
+                                int32_t stream_id, const uint8_t *data,
+                                size_t len, void *user_data) {
+  auto stream = static_cast<Http2BackendIOStream *>(
+      nghttp2_session_get_stream_user_data(session, stream_id));
+  if (!stream || stream->detached) {
+    nghttp2_session_consume(session, stream_id, len);
+
+    return 0;
+  }
+
+  stream->resp_data.append(data, len);
+  stream->unconsumed += len;
+
+  return 0;
+}
+} // namespace
+
+namespace {
+int on_stream_close_callback(nghttp2_session *session, int32_t stream_id,
+                             uint32_t error_code, void *user_data) {
+  auto io_session = static_cast<Http2BackendIOSession *>(user_data);
+  auto stream = static_cast<Http2BackendIOStream *>(
+      nghttp2_session_get_stream_user_data(session, stream_id));
+  if (!stream) {
+    return 0;
+  }
+
+  io_session->on_stream_close(stream, error_code);
+
+  return 0;
+}
+} // namespace
+
+namespace {
+int on_frame_send_callback(nghttp2_session *session, const nghttp2_frame *frame,
+                           void *user_data) {
+  auto io_session = static_cast<Http2BackendIOSession *>(user_data);
+
+  if (frame->hd.type == NGHTTP2_SETTINGS &&
+      (frame->hd.flags & NGHTTP2_FLAG_ACK) == 0) {
+    io_session->start_settings_timer();
+  }
+
+  return 0;
+}
+} // namespace
+
+namespace {
+nghttp2_session_callbacks *create_backend_io_callbacks() {
+  nghttp2_session_callbacks *callbacks;
+
+  if (nghttp2_session_callbacks_new(&callbacks) != 0) {
+    return nullptr;
+  }
+
+  nghttp2_session_callbacks_set_on_stream_close_callback(
+      callbacks, on_stream_close_callback);
+
+  nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks,
+                                                       on_frame_recv_callback);
+
+  nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+      callbacks, on_data_chunk_recv_callback);
+
+  nghttp2_session_callbacks_set_on_frame_send_callback(callbacks,
+                                                       on_frame_send_callback);
+
+  nghttp2_session_callbacks_set_on_header_callback2(callbacks,
+                                                    on_header_callback2);
+
+  return callbacks;
+}
+} // namespace
+
+int Http2BackendIOSession::connection_made() {
+  int rv;
+
+  auto &http2conf = get_config()->http2;
+
+  rv = nghttp2_session_client_new2(&session_, io_->get_callbacks(), this,
+                                   http2conf.downstream.option);
+  if (rv != 0) {
+    return -1;
+  }
+
+  std::array<nghttp2_settings_entry, 5> entry;
+  size_t nentry = 4;
+  entry[0].settings_id = NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS;
+  entry[0].value = http2conf.downstream.max_concurrent_streams;
+
+  entry[1].settings_id = NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE;
+  entry[1].value = http2conf.downstream.window_size;
+
+  entry[2].settings_id = NGHTTP2_SETTINGS_NO_RFC7540_PRIORITIES;
+  entry[2].value = 1;
+
+  // Server push is not relayed by backend I/O threads.
+  entry[3].settings_id = NGHTTP2_SETTINGS_ENABLE_PUSH;
+  entry[3].value = 0;
+
+  if (http2conf.downstream.decoder_dynamic_table_size !=
+      NGHTTP2_DEFAULT_HEADER_TABLE_SIZE) {
+    entry[nentry].settings_id = NGHTTP2_SETTINGS_HEADER_TABLE_SIZE;
+    entry[nentry].value = http2conf.downstream.decoder_dynamic_table_size;
+    ++nentry;
+  }
+
+  rv = nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, entry.data(),
+                               nentry);
+  if (rv != 0) {
+    return -1;
+  }
+
+  rv = nghttp2_session_set_local_window_size(
+      session_, NGHTTP2_FLAG_NONE, 0,
+      http2conf.downstream.connection_window_size);
+  if (rv != 0) {
+    return -1;
+  }
+
+  connected_ = true;
+
+  auto pending = std::move(pending_);
+  for (auto &stream : pending) {
+    submit_request(stream);
+  }
+
+  signal_write();
+
+  return 0;
+}
+
+namespace {
+void eventcb(struct ev_loop *loop, ev_async *w, int revents) {
+  auto io = static_cast<Http2BackendIO *>(w->data);
+  io->process_commands();
+}
+} // namespace
+
+namespace {
+void prepare_cb(struct ev_loop *loop, ev_prepare *w, int revents) {
+  auto io = static_cast<Http2BackendIO *>(w->data);
+  io->flush_events();
+}
+} // namespace
+
+namespace {
+void mcpool_trim_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto io = static_cast<Http2BackendIO *>(w->data);
+  io->trim_mcpool();
+}
+} // namespace
+
+Http2BackendIO::Http2BackendIO(SSL_CTX *ssl_ctx)
+    : loop_(ev_loop_new(get_config()->ev_loop_flags)),
+      ssl_ctx_(ssl_ctx),
+      callbacks_(create_backend_io_callbacks()),
+      stop_(false) {
+  auto &timeoutconf = get_config()->conn.downstream->timeout;
+
+  connect_timeout_ = timeoutconf.connect;
+  read_timeout_ = timeoutconf.read;
+  write_timeout_ = timeoutconf.write;
+
+  auto &bufpoolconf = get_config()->buffer_pool;
+
+  mcpool_.high_watermark = bufpoolconf.high_watermark;
+  mcpool_.low_watermark = bufpoolconf.low_watermark;
+  bufpool_.high_watermark = bufpoolconf.high_watermark;
+  bufpool_.low_watermark = bufpoolconf.low_watermark;
+
+  ev_async_init(&w_, eventcb);
+  w_.data = this;
+  ev_async_start(loop_, &w_);
+
+  ev_prepare_init(&prep_, prepare_cb);
+  prep_.data = this;
+  ev_prepare_start(loop_, &prep_);
+
+  ev_timer_init(&mcpool_trim_timer_, mcpool_trim_cb, MCPOOL_TRIM_INTERVAL,
+                MCPOOL_TRIM_INTERVAL);
+  mcpool_trim_timer_.data = this;
+  ev_timer_start(loop_, &mcpool_trim_timer_);
+}
+
+Http2BackendIO::~Http2BackendIO() {
+  stop();
+
+  peers_.clear();
+
+  ev_timer_stop(loop_, &mcpool_trim_timer_);
+  ev_prepare_stop(loop_, &prep_);
+  ev_async_stop(loop_, &w_);
+
+  ev_loop_destroy(loop_);
+
+  nghttp2_session_callbacks_del(callbacks_);
+}
+
+void Http2BackendIO::trim_mcpool() {
+  auto nfreed = mcpool_.trim();
+
+  {
+    std::lock_guard<std::mutex> g(bufpool_m_);
+    nfreed += bufpool_.trim();
+  }
+
+  if (nfreed == 0) {
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "Backend I/O trimmed " << nfreed
+              << " bytes of unused buffers";
+  }
+
+  request_malloc_trim();
+}
+
+void Http2BackendIO::run_async() {
+#ifndef NOTHREADS
+  fut_ = std::async(std::launch::async, [this] {
+    (void)reopen_log_files(get_config()->logging);
+    ev_run(loop_);
+    delete_log_config();
+  });
+#endif // !NOTHREADS
+}
+
+void Http2BackendIO::stop() {
+  {
+    std::lock_guard<std::mutex> g(m_);
+    stop_ = true;
+  }
+
+  ev_async_send(loop_, &w_);
+
+#ifndef NOTHREADS
+  if (fut_.valid()) {
+    fut_.get();
+  }
+#endif // !NOTHREADS
+}
+
+void Http2BackendIO::send(Http2BackendIOCommand cmd) {
+  {
+    std::lock_guard<std::mutex> g(m_);
+
+    q_.push_back(std::move(cmd));
+  }
+
+  ev_async_send(loop_, &w_);
+}
+
+void Http2BackendIO::process_commands() {
+  std::vector<Http2BackendIOCommand> q;
+  {
+    std::lock_guard<std::mutex> g(m_);
+
+    if (stop_) {
+      ev_break(loop_);
+      return;
+    }
+
+    q.swap(q_);
+  }
+
+  for (auto &cmd : q) {
+    auto &stream = cmd.stream;
+
+    switch (cmd.type) {
+    case Http2BackendIOCommandType::SUBMIT:
+      handle_submit(cmd);
+      break;
+    case Http2BackendIOCommandType::DATA:
+      if (stream->closed) {
+        break;
+      }
+
+      stream->reqbuf.append(cmd.data);
+
+      if (cmd.eof) {
+        stream->req_eof = true;
+        stream->trailers = std::move(cmd.headers);
+      }
+
+      if (stream->session) {
+        auto session = stream->session;
+        if (session->resume_data(stream.get()) != 0) {
+          session->on_failure();
+          remove_session(session);
+        }
+      }
+
+      break;
+    case Http2BackendIOCommandType::CONSUME:
+      if (stream->session) {
+        stream->session->consume(stream.get(), cmd.len);
+      }
+
+      break;
+    case Http2BackendIOCommandType::RESET:
+      if (cmd.detach) {
+        stream->detached = true;
+      }
+
+      if (stream->session) {
+        stream->session->submit_rst_stream(stream.get(), cmd.error_code);
+      }
+
+      break;
+    case Http2BackendIOCommandType::RELEASE_PEER:
+      handle_release_peer(cmd.peer);
+
+      break;
+    case Http2BackendIOCommandType::KEEP_IDLE:
+      handle_keep_idle(cmd.peer, cmd.len);
+
+      break;
+    }
+  }
+}
+
+void Http2BackendIO::handle_submit(Http2BackendIOCommand &cmd) {
+  auto &stream = cmd.stream;
+  auto peer = cmd.peer;
+
+  stream->headers = std::move(cmd.headers);
+  stream->expect_body = !cmd.eof;
+
+  for (auto &session : peer->sessions) {
+    if (session->can_add_stream()) {
+      session->add_stream(stream);
+      return;
+    }
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "Create new backend I/O session; addr="
+              << util::to_numeric_addr(&peer->addr);
+  }
+
+  auto session = std::make_unique<Http2BackendIOSession>(this, peer);
+
+  session->add_stream(stream);
+
+  if (session->initiate_connection() != 0) {
+    session->on_failure();
+    return;
+  }
+
+  peer->sessions.push_back(std::move(session));
+}
+
+Http2BackendIOPeer *Http2BackendIO::get_peer(const DownstreamAddr *addr) {
+  auto key = util::to_numeric_addr(&addr->addr);
+  key += '\n';
+  key.append(std::begin(addr->host), std::end(addr->host));
+  key += '\n';
+  key.append(std::begin(addr->sni), std::end(addr->sni));
+  key += addr->tls ? "\ntls" : "\nclear";
+
+  std::lock_guard<std::mutex> g(peers_m_);
+
+  auto &peer = peers_[key];
+  if (!peer) {
+    peer = std::make_unique<Http2BackendIOPeer>();
+    peer->key = key;
+    peer->addr = addr->addr;
+    peer->host = std::string{std::begin(addr->host), std::end(addr->host)};
+    peer->sni = std::string{std::begin(addr->sni), std::end(addr->sni)};
+    peer->port = addr->port;
+    peer->tls = addr->tls;
+    peer->refcnt = 0;
+  }
+
+  ++peer->refcnt;
+
+  return peer.get();
+}
+
+void Http2BackendIO::release_peer(Http2BackendIOPeer *peer) {
+  // The peer is released by the backend I/O thread after it handles
+  // the commands which have been sent so far, some of which might
+  // refer to it.
+  Http2BackendIOCommand cmd{};
+  cmd.type = Http2BackendIOCommandType::RELEASE_PEER;
+  cmd.peer = peer;
+
+  send(std::move(cmd));
+}
+
+void Http2BackendIO::handle_release_peer(Http2BackendIOPeer *peer) {
+  std::lock_guard<std::mutex> g(peers_m_);
+
+  assert(peer->refcnt);
+
+  --peer->refcnt;
+
+  maybe_remove_peer(peer);
+}
+
+void Http2BackendIO::maybe_remove_peer(Http2BackendIOPeer *peer) {
+  if (peer->refcnt || !peer->sessions.empty()) {
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "Remove backend I/O peer; addr="
+              << util::to_numeric_addr(&peer->addr);
+  }
+
+  // peer->key is destroyed along with the element.
+  peers_.erase(peers_.find(peer->key));
+}
+
+void Http2BackendIO::keep_idle_sessions(Http2BackendIOPeer *peer, size_t n) {
+  Http2BackendIOCommand cmd{};
+  cmd.type = Http2BackendIOCommandType::KEEP_IDLE;
+  cmd.peer = peer;
+  cmd.len = n;
+
+  send(std::move(cmd));
+}
+
+void Http2BackendIO::handle_keep_idle(Http2BackendIOPeer *peer, size_t n) {
+  size_t navail = 0;
+
+  for (auto &session : peer->sessions) {
+    if (!session->can_add_stream()) {
+      continue;
+    }
+
+    session->keep_alive_idle();
+
+    ++navail;
+  }
+
+  for (; navail < n; ++navail) {
+    if (LOG_ENABLED(INFO)) {
+      LOG(INFO) << "Prewarm backend I/O session; addr="
+                << util::to_numeric_addr(&peer->addr);
+    }
+
+    auto session = std::make_unique<Http2BackendIOSession>(this, peer);
+
+    if (session->initiate_connection() != 0) {
+      return;
+    }
+
+    peer->sessions.push_back(std::move(session));
+  }
+}
+
+size_t Http2BackendIO::get_num_peers() {
+  std::lock_guard<std::mutex> g(peers_m_);
+
+  return peers_.size();
+}
+
+void Http2BackendIO::post_event(Http2BackendIOEvent ev) {
+  auto worker = ev.stream->worker;
+  outbox_[worker].push_back(std::move(ev));
+}
+
+void Http2BackendIO::flush_events() {
+  for (auto &kv : outbox_) {
+    if (kv.second.empty()) {
+      continue;
+    }
+
+    kv.first->send_http2_backend_io_events(std::move(kv.second));
+    kv.second.clear();
+  }
+}
+
+void Http2BackendIO::remove_session(Http2BackendIOSession *session) {
+  auto &sessions = session->get_peer()->sessions;
+  auto it = std::find_if(
+      std::begin(sessions), std::end(sessions),
+      [session](const std::unique_ptr<Http2BackendIOSession> &s) {
+        return s.get() == session;
+      });
+  if (it == std::end(sessions)) {
+    return;
+  }
+
+  auto peer = session->get_peer();
+
+  sessions.erase(it);
+
+  if (sessions.empty()) {
+    std::lock_guard<std::mutex> g(peers_m_);
+
+    maybe_remove_peer(peer);
+  }
+}
+
+struct ev_loop *Http2BackendIO::get_loop() const { return loop_; }
+
+SSL_CTX *Http2BackendIO::get_ssl_ctx() const { return ssl_ctx_; }
+
+nghttp2_session_callbacks *Http2BackendIO::get_callbacks() const {
+  return callbacks_;
+}
+
+MemchunkPool *Http2BackendIO::get_mcpool() { return &mcpool_; }
+
+MemchunkPool *Http2BackendIO::get_buffer_pool() { return &bufpool_; }
+
+std::mutex &Http2BackendIO::get_buffer_pool_mutex() { return bufpool_m_; }
+
+ev_tstamp Http2BackendIO::get_connect_timeout() const {
+  return connect_timeout_;
+}
+
+ev_tstamp Http2BackendIO::get_read_timeout() const { return read_timeout_; }
+
+ev_tstamp Http2BackendIO::get_write_timeout() const { return write_timeout_; }
+
+} // namespace shrpx
@@ -0,0 +1,419 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_HTTP2_BACKEND_IO_H
+#define SHRPX_HTTP2_BACKEND_IO_H
+
+#include "shrpx.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#ifndef NOTHREADS
+#  include <future>
+#endif // !NOTHREADS
+
+#include <openssl/ssl.h>
+
+#include <ev.h>
+
+#include <nghttp2/nghttp2.h>
+
+#include "shrpx_connection.h"
+#include "shrpx_tls.h"
+#include "network.h"
+#include "memchunk.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+class Worker;
+class Http2BackendIO;
+class Http2BackendIOSession;
+class Http2BackendIODownstreamConnection;
+struct DownstreamAddr;
+struct Http2BackendIOPeer;
+
+struct Http2BackendIOHeader {
+  std::string name;
+  std::string value;
+  bool no_index;
+};
+
+// Http2BackendIOBuffer is a body buffer which is handed over between
+// a worker and a backend I/O thread.  Its chunks come from the buffer
+// pool of Http2BackendIO, which any thread can use under its lock.
+// This lets a buffer filled by one thread be consumed and freed by
+// the other without copying it to a new allocation.
+class Http2BackendIOBuffer {
+public:
+  Http2BackendIOBuffer();
+  explicit Http2BackendIOBuffer(Http2BackendIO *io);
+  Http2BackendIOBuffer(const Http2BackendIOBuffer &) = delete;
+  Http2BackendIOBuffer(Http2BackendIOBuffer &&other) noexcept;
+  ~Http2BackendIOBuffer();
+  Http2BackendIOBuffer &operator=(const Http2BackendIOBuffer &) = delete;
+  Http2BackendIOBuffer &operator=(Http2BackendIOBuffer &&other) noexcept;
+
+  void append(const void *data, size_t len);
+  // Moves all chunks in |src| to the end of this buffer.  |src| must
+  // belong to the same Http2BackendIO.
+  void append(Http2BackendIOBuffer &src);
+  // Copies at most |len| bytes to |dest|, and removes them from this
+  // buffer.  This function returns the number of bytes copied.
+  size_t remove(void *dest, size_t len);
+  size_t rleft() const;
+  // Returns the first chunk.  The chunks are linked by
+  // SizedMemchunk::next.
+  const SizedMemchunk *head() const;
+  void reset();
+
+private:
+  Http2BackendIO *io_;
+  DefaultMemchunks buf_;
+};
+
+// Http2BackendIOStream is a request which a worker forwards to a
+// backend I/O thread.  It is shared by the worker and the backend I/O
+// thread, but each field except for |worker| is only touched by one
+// of them.
+struct Http2BackendIOStream
+    : public std::enable_shared_from_this<Http2BackendIOStream> {
+  Http2BackendIOStream(Worker *worker,
+                       Http2BackendIODownstreamConnection *dconn,
+                       Http2BackendIO *io);
+
+  // The worker which issued this request.  Never changes.
+  Worker *worker;
+  // The backend I/O thread which serves this request.  Never changes.
+  Http2BackendIO *io;
+
+  // The following field is only accessed by |worker|.  It is nullptr
+  // after the worker loses interest in this stream.
+  Http2BackendIODownstreamConnection *dconn;
+
+  // The following fields are only accessed by the backend I/O
+  // thread.
+  Http2BackendIOSession *session;
+  // Request header fields which wait for the connection to be
+  // established.
+  std::vector<Http2BackendIOHeader> headers;
+  std::vector<Http2BackendIOHeader> trailers;
+  // Request body which is not sent yet.
+  Http2BackendIOBuffer reqbuf;
+  // Response header fields and DATA payload received so far, and not
+  // handed to the worker yet.
+  std::vector<Http2BackendIOHeader> resp_headers;
+  Http2BackendIOBuffer resp_data;
+  // The number of DATA payload bytes which the worker has not
+  // consumed yet.
+  size_t unconsumed;
+  int32_t stream_id;
+  // true if request body is expected.
+  bool expect_body;
+  // true if the whole request body has been received from the
+  // worker.
+  bool req_eof;
+  // true if the worker has detached from this stream.  No more event
+  // is sent to the worker.
+  bool detached;
+  // true if the stream has been closed, or the session has gone.
+  bool closed;
+};
+
+enum class Http2BackendIOCommandType {
+  // Submit a new request.
+  SUBMIT,
+  // Append request body.
+  DATA,
+  // Consume response body, and send WINDOW_UPDATE.
+  CONSUME,
+  // Reset the stream.
+  RESET,
+  // Drop the reference to a peer.
+  RELEASE_PEER,
+  // Keep idle sessions to a peer.
+  KEEP_IDLE,
+};
+
+// Http2BackendIOCommand is sent from a worker to a backend I/O
+// thread.
+struct Http2BackendIOCommand {
+  Http2BackendIOCommandType type;
+  std::shared_ptr<Http2BackendIOStream> stream;
+  // SUBMIT: the backend address to connect.  RELEASE_PEER,
+  // KEEP_IDLE: the peer to release, or to keep sessions to.
+  Http2BackendIOPeer *peer;
+  // SUBMIT: request header fields.  DATA: request trailer fields if
+  // |eof| is true.
+  std::vector<Http2BackendIOHeader> headers;
+  // DATA: request body.
+  Http2BackendIOBuffer data;
+  // CONSUME: the number of bytes consumed.  KEEP_IDLE: the number
+  // of sessions which accept new streams to keep.
+  size_t len;
+  // RESET: the error code of RST_STREAM.
+  uint32_t error_code;
+  // SUBMIT: true if the request has no body.  DATA: true if this is
+  // the end of request body.
+  bool eof;
+  // RESET: true if the worker no longer receives events for this
+  // stream.
+  bool detach;
+};
+
+enum class Http2BackendIOEventType {
+  // Response header fields, including non-final response and
+  // trailer fields.
+  HEADERS,
+  // DATA payload of a single DATA frame.
+  DATA,
+  // The request body has been handed to the backend session.
+  UPLOAD_SENT,
+  // The stream has been closed.
+  CLOSE,
+};
+
+// Http2BackendIOEvent is sent from a backend I/O thread to a worker.
+struct Http2BackendIOEvent {
+  Http2BackendIOEventType type;
+  std::shared_ptr<Http2BackendIOStream> stream;
+  // HEADERS: header fields.
+  std::vector<Http2BackendIOHeader> headers;
+  // DATA: payload.
+  Http2BackendIOBuffer data;
+  // UPLOAD_SENT: the number of bytes sent.
+  size_t len;
+  // CLOSE: the error code.
+  uint32_t error_code;
+  // HEADERS: the category of HEADERS frame.
+  nghttp2_headers_category cat;
+  // HEADERS, DATA: true if END_STREAM flag is set.
+  bool end_stream;
+  // CLOSE: true if the stream is closed because the session has gone
+  // rather than by RST_STREAM or END_STREAM.
+  bool session_failure;
+  // CLOSE: true if the session failed before it was established.
+  bool connect_failed;
+  // CLOSE: true if the request was submitted to the backend.
+  bool submitted;
+};
+
+// Http2BackendIOPeer is a backend address which a backend I/O thread
+// connects to.  The fields other than |refcnt|, |tls_session_cache|
+// and |sessions| never change after creation.
+struct Http2BackendIOPeer {
+  // The key in Http2BackendIO::peers_.
+  std::string key;
+  Address addr;
+  std::string host;
+  std::string sni;
+  uint16_t port;
+  bool tls;
+  // The number of DownstreamAddr which refer to this peer.  It is
+  // guarded by Http2BackendIO::peers_m_.  The peer is deleted when it
+  // drops to 0 and |sessions| becomes empty.
+  size_t refcnt;
+  // The following fields are only accessed by the backend I/O
+  // thread.
+  tls::TLSSessionCache tls_session_cache;
+  std::vector<std::unique_ptr<Http2BackendIOSession>> sessions;
+};
+
+// Http2BackendIOSession is a HTTP/2 connection to a backend which a
+// backend I/O thread runs.  Streams from all workers are multiplexed
+// onto it.
+class Http2BackendIOSession {
+public:
+  Http2BackendIOSession(Http2BackendIO *io, Http2BackendIOPeer *peer);
+  ~Http2BackendIOSession();
+
+  int initiate_connection();
+
+  // Adds |stream| to this session.  It is submitted when the
+  // connection is established.
+  void add_stream(const std::shared_ptr<Http2BackendIOStream> &stream);
+  // Removes |stream| which is not submitted yet.
+  void remove_pending_stream(Http2BackendIOStream *stream);
+  // Returns true if this session can take one more stream.
+  bool can_add_stream() const;
+
+  int resume_data(Http2BackendIOStream *stream);
+  void consume(Http2BackendIOStream *stream, size_t len);
+  void submit_rst_stream(Http2BackendIOStream *stream, uint32_t error_code);
+  // Sends PING if this session has no stream, and it is about to be
+  // timed out.
+  void keep_alive_idle();
+
+  // Low level I/O operation callback; they are called from do_read()
+  // or do_write().
+  int noop();
+  int connected();
+  int tls_handshake();
+  int read_tls();
+  int write_tls();
+  int read_clear();
+  int write_clear();
+
+  int do_read();
+  int do_write();
+
+  // These functions are used to feed / extract data to
+  // nghttp2_session object.
+  int on_read(const uint8_t *data, size_t len);
+  int on_write();
+
+  void signal_write();
+
+  // Closes all streams, and tells the workers about it.
+  void on_failure();
+  // Returns true if this session has no stream and no further I/O.
+  bool finished() const;
+
+  void start_settings_timer();
+  void stop_settings_timer();
+
+  void on_stream_close(Http2BackendIOStream *stream, uint32_t error_code);
+  void set_draining();
+
+  Http2BackendIO *get_backend_io() const;
+  Http2BackendIOPeer *get_peer() const;
+
+private:
+  int connection_made();
+  int submit_request(const std::shared_ptr<Http2BackendIOStream> &stream);
+  void close_stream(Http2BackendIOStream *stream, uint32_t error_code,
+                    bool session_failure);
+
+  Connection conn_;
+  DefaultMemchunks wb_;
+  ev_timer settings_timer_;
+  int (Http2BackendIOSession::*read_)();
+  int (Http2BackendIOSession::*write_)();
+  Http2BackendIO *io_;
+  Http2BackendIOPeer *peer_;
+  nghttp2_session *session_;
+  // Streams which wait for the connection to be established.
+  std::vector<std::shared_ptr<Http2BackendIOStream>> pending_;
+  std::unordered_map<int32_t, std::shared_ptr<Http2BackendIOStream>>
+      streams_;
+  bool connected_;
+  // true if GOAWAY was received, or the session is failing.  No new
+  // stream is added.
+  bool draining_;
+};
+
+// Http2BackendIO is a backend I/O thread.  It runs its own event
+// loop, and backend HTTP/2 sessions on behalf of workers.  Workers
+// send Http2BackendIOCommand with send(), and this object sends back
+// Http2BackendIOEvent to Worker::send_http2_backend_io_events().
+class Http2BackendIO {
+public:
+  Http2BackendIO(SSL_CTX *ssl_ctx);
+  ~Http2BackendIO();
+  void run_async();
+  // Stops the event loop, and waits for the thread to finish.
+  void stop();
+  // Sends |cmd| to this object.  This function can be called from
+  // any thread.
+  void send(Http2BackendIOCommand cmd);
+  void process_commands();
+  // Returns Http2BackendIOPeer for |addr|, and takes a reference to
+  // it.  This function can be called from any thread.
+  Http2BackendIOPeer *get_peer(const DownstreamAddr *addr);
+  // Drops the reference to |peer| taken by get_peer().  The peer is
+  // deleted by the backend I/O thread after its sessions are gone.
+  // This function can be called from any thread.
+  void release_peer(Http2BackendIOPeer *peer);
+  // Returns the number of peers.
+  size_t get_num_peers();
+  // Makes sure that there are |n| sessions to |peer| which accept
+  // new streams, and keeps the idle ones alive.  This function can
+  // be called from any thread.
+  void keep_idle_sessions(Http2BackendIOPeer *peer, size_t n);
+
+  // Queues |ev| which is sent to the worker which owns the stream.
+  void post_event(Http2BackendIOEvent ev);
+  // Sends all queued events to workers.
+  void flush_events();
+
+  // Deletes |session| which has finished or failed.
+  void remove_session(Http2BackendIOSession *session);
+
+  // Frees the unused buffers in the pools which have not been used
+  // since the last call of this function.  This function is called
+  // periodically in the backend I/O thread.
+  void trim_mcpool();
+
+  struct ev_loop *get_loop() const;
+  SSL_CTX *get_ssl_ctx() const;
+  nghttp2_session_callbacks *get_callbacks() const;
+  MemchunkPool *get_mcpool();
+  // Returns the pool of Http2BackendIOBuffer, and the mutex to lock
+  // while it is used.
+  MemchunkPool *get_buffer_pool();
+  std::mutex &get_buffer_pool_mutex();
+
+  ev_tstamp get_connect_timeout() const;
+  ev_tstamp get_read_timeout() const;
+  ev_tstamp get_write_timeout() const;
+
+private:
+  void handle_submit(Http2BackendIOCommand &cmd);
+  void handle_release_peer(Http2BackendIOPeer *peer);
+  void handle_keep_idle(Http2BackendIOPeer *peer, size_t n);
+  // Deletes |peer| if nothing refers to it.  peers_m_ must be locked.
+  void maybe_remove_peer(Http2BackendIOPeer *peer);
+
+  // The buffer pool must outlive the commands, events and streams
+  // which hold Http2BackendIOBuffer.
+  std::mutex bufpool_m_;
+  MemchunkPool bufpool_;
+#ifndef NOTHREADS
+  std::future<void> fut_;
+#endif // !NOTHREADS
+  std::mutex m_;
+  std::vector<Http2BackendIOCommand> q_;
+  std::mutex peers_m_;
+  std::unordered_map<std::string, std::unique_ptr<Http2BackendIOPeer>> peers_;
+  std::unordered_map<Worker *, std::vector<Http2BackendIOEvent>> outbox_;
+  MemchunkPool mcpool_;
+  ev_async w_;
+  ev_prepare prep_;
+  ev_timer mcpool_trim_timer_;
+  struct ev_loop *loop_;
+  SSL_CTX *ssl_ctx_;
+  nghttp2_session_callbacks *callbacks_;
+  ev_tstamp connect_timeout_;
+  ev_tstamp read_timeout_;
+  ev_tstamp write_timeout_;
+  bool stop_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_HTTP2_BACKEND_IO_H
@@ -0,0 +1,703 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_http2_backend_io_downstream_connection.h"
+
+#include <sstream>
+
+#include "shrpx_client_handler.h"
+#include "shrpx_upstream.h"
+#include "shrpx_downstream.h"
+#include "shrpx_log.h"
+#include "shrpx_config.h"
+#include "shrpx_error.h"
+#include "shrpx_http2_backend_io.h"
+#include "shrpx_http2_downstream_connection.h"
+#include "shrpx_connect_blocker.h"
+#include "shrpx_worker.h"
+#include "http2.h"
+#include "util.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+namespace {
+void copy_headers(std::vector<Http2BackendIOHeader> &dest,
+                  const nghttp2_nv *nva, size_t nvlen) {
+  dest.reserve(nvlen);
+
+  for (size_t i = 0; i < nvlen; ++i) {
+    auto &nv = nva[i];
+    dest.push_back({std::string{nv.name, nv.name + nv.namelen},
+                    std::string{nv.value, nv.value + nv.valuelen},
+                    (nv.flags & NGHTTP2_NV_FLAG_NO_INDEX) != 0});
+  }
+}
+} // namespace
+
+namespace {
+Http2BackendIOBuffer remove_all(Http2BackendIO *io, DefaultMemchunks *src) {
+  Http2BackendIOBuffer data(io);
+
+  for (auto m = src->head; m; m = m->next) {
+    data.append(m->pos, m->len());
+  }
+
+  src->reset();
+
+  return data;
+}
+} // namespace
+
+Http2BackendIODownstreamConnection::Http2BackendIODownstreamConnection(
+    const std::shared_ptr<DownstreamAddrGroup> &group, DownstreamAddr *addr,
+    Http2BackendIO *io, Worker *worker)
+    : group_(group),
+      addr_(addr),
+      io_(io),
+      worker_(worker),
+      stream_(std::make_shared<Http2BackendIOStream>(worker, this, io)),
+      upload_pending_(0),
+      submitted_(false),
+      closed_(false),
+      body_sent_(false),
+      response_received_(false) {}
+
+Http2BackendIODownstreamConnection::~Http2BackendIODownstreamConnection() {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Deleting";
+  }
+
+  if (downstream_) {
+    downstream_->disable_downstream_rtimer();
+    downstream_->disable_downstream_wtimer();
+
+    if (submitted_ && !closed_) {
+      uint32_t error_code;
+      if (downstream_->get_response_state() == DownstreamState::MSG_COMPLETE) {
+        error_code = NGHTTP2_NO_ERROR;
+      } else {
+        error_code = NGHTTP2_INTERNAL_ERROR;
+      }
+
+      send_reset(error_code, true);
+    }
+  } else if (submitted_ && !closed_) {
+    send_reset(NGHTTP2_CANCEL, true);
+  }
+
+  stream_->dconn = nullptr;
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Deleted";
+  }
+}
+
+int Http2BackendIODownstreamConnection::attach_downstream(
+    Downstream *downstream) {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Attaching to DOWNSTREAM:" << downstream;
+  }
+
+  downstream_ = downstream;
+  downstream_->reset_downstream_rtimer();
+
+  auto &req = downstream_->request();
+
+  // HTTP/2 disables HTTP Upgrade.
+  if (req.method != HTTP_CONNECT && req.connect_proto == ConnectProto::NONE) {
+    req.upgrade_request = false;
+  }
+
+  return 0;
+}
+
+void Http2BackendIODownstreamConnection::detach_downstream(
+    Downstream *downstream) {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Detaching from DOWNSTREAM:" << downstream;
+  }
+
+  if (submitted_ && !closed_) {
+    send_reset(NGHTTP2_INTERNAL_ERROR, true);
+    closed_ = true;
+  }
+
+  auto &resp = downstream->response();
+  resp.unconsumed_body_length = 0;
+
+  downstream->disable_downstream_rtimer();
+  downstream->disable_downstream_wtimer();
+  downstream_ = nullptr;
+}
+
+void Http2BackendIODownstreamConnection::send_reset(uint32_t error_code,
+                                                    bool detach) {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Reset backend stream with error_code="
+                      << error_code;
+  }
+
+  Http2BackendIOCommand cmd{};
+  cmd.type = Http2BackendIOCommandType::RESET;
+  cmd.stream = stream_;
+  cmd.error_code = error_code;
+  cmd.detach = detach;
+
+  io_->send(std::move(cmd));
+}
+
+void Http2BackendIODownstreamConnection::send_data(Http2BackendIOBuffer data,
+                                                   bool eof) {
+  Http2BackendIOCommand cmd{};
+  cmd.type = Http2BackendIOCommandType::DATA;
+  cmd.stream = stream_;
+  cmd.eof = eof;
+
+  if (eof) {
+    const auto &trailers = downstream_->request().fs.trailers();
+    if (!trailers.empty()) {
+      std::vector<nghttp2_nv> nva;
+      nva.reserve(trailers.size());
+      http2::copy_headers_to_nva_nocopy(nva, trailers, http2::HDOP_STRIP_ALL);
+      copy_headers(cmd.headers, nva.data(), nva.size());
+    }
+  }
+
+  if (data.rleft()) {
+    body_sent_ = true;
+    upload_pending_ += data.rleft();
+    downstream_->ensure_downstream_wtimer();
+  }
+
+  cmd.data = std::move(data);
+
+  io_->send(std::move(cmd));
+}
+
+int Http2BackendIODownstreamConnection::push_request_headers() {
+  if (!downstream_) {
+    return 0;
+  }
+
+  if (submitted_) {
+    return 0;
+  }
+
+  auto &connect_blocker = addr_->connect_blocker;
+
+  if (connect_blocker->blocked()) {
+    if (LOG_ENABLED(INFO)) {
+      DCLOG(INFO, this) << "Backend server " << addr_->host << ":"
+                        << addr_->port << " was not available temporarily";
+    }
+
+    return SHRPX_ERR_NETWORK;
+  }
+
+  const auto &req = downstream_->request();
+
+  auto nva = std::vector<nghttp2_nv>();
+
+  build_http2_request_headers(nva, downstream_, addr_);
+
+  auto transfer_encoding = req.fs.header(http2::HD_TRANSFER_ENCODING);
+
+  // Add body as long as transfer-encoding is given even if
+  // req.fs.content_length == 0 to forward trailer fields.
+  auto expect_body =
+      transfer_encoding || req.fs.content_length > 0 || req.http2_expect_body;
+
+  Http2BackendIOCommand cmd{};
+  cmd.type = Http2BackendIOCommandType::SUBMIT;
+  cmd.stream = stream_;
+  cmd.peer = addr_->http2_backend_io_peer;
+  cmd.eof = !expect_body;
+
+  copy_headers(cmd.headers, nva.data(), nva.size());
+
+  io_->send(std::move(cmd));
+
+  submitted_ = true;
+
+  downstream_->set_request_header_sent(true);
+
+  if (expect_body) {
+    auto src = downstream_->get_blocked_request_buf();
+    auto eof = downstream_->get_blocked_request_data_eof();
+
+    if (src->rleft() || eof) {
+      send_data(remove_all(io_, src), eof);
+    }
+
+    downstream_->reset_downstream_wtimer();
+  }
+
+  return 0;
+}
+
+int Http2BackendIODownstreamConnection::push_upload_data_chunk(
+    const uint8_t *data, size_t datalen) {
+  if (!downstream_->get_request_header_sent()) {
+    auto output = downstream_->get_blocked_request_buf();
+    auto &req = downstream_->request();
+    output->append(data, datalen);
+    req.unconsumed_body_length += datalen;
+    return 0;
+  }
+
+  if (closed_) {
+    return 0;
+  }
+
+  Http2BackendIOBuffer buf(io_);
+  buf.append(data, datalen);
+
+  send_data(std::move(buf), false);
+
+  return 0;
+}
+
+int Http2BackendIODownstreamConnection::end_upload_data() {
+  if (!downstream_->get_request_header_sent()) {
+    downstream_->set_blocked_request_data_eof(true);
+    return 0;
+  }
+
+  if (closed_) {
+    return 0;
+  }
+
+  send_data(Http2BackendIOBuffer{}, true);
+
+  return 0;
+}
+
+int Http2BackendIODownstreamConnection::resume_read(IOCtrlReason reason,
+                                                    size_t consumed) {
+  if (!downstream_ || !submitted_ || closed_ || consumed == 0) {
+    return 0;
+  }
+
+  Http2BackendIOCommand cmd{};
+  cmd.type = Http2BackendIOCommandType::CONSUME;
+  cmd.stream = stream_;
+  cmd.len = consumed;
+
+  io_->send(std::move(cmd));
+
+  auto &resp = downstream_->response();
+
+  resp.unconsumed_body_length -= consumed;
+
+  return 0;
+}
+
+int Http2BackendIODownstreamConnection::on_read() { return 0; }
+
+int Http2BackendIODownstreamConnection::on_write() { return 0; }
+
+int Http2BackendIODownstreamConnection::on_timeout() {
+  if (!downstream_ || !submitted_ || closed_) {
+    return 0;
+  }
+
+  switch (downstream_->get_response_state()) {
+  case DownstreamState::MSG_RESET:
+  case DownstreamState::MSG_BAD_HEADER:
+  case DownstreamState::MSG_COMPLETE:
+    return 0;
+  default:
+    send_reset(NGHTTP2_NO_ERROR, false);
+    return 0;
+  }
+}
+
+const std::shared_ptr<DownstreamAddrGroup> &
+Http2BackendIODownstreamConnection::get_downstream_addr_group() const {
+  return group_;
+}
+
+DownstreamAddr *Http2BackendIODownstreamConnection::get_addr() const {
+  return addr_;
+}
+
+namespace {
+void call_downstream_readcb(Downstream *downstream) {
+  auto upstream = downstream->get_upstream();
+  if (!upstream) {
+    return;
+  }
+  if (upstream->downstream_read(downstream->get_downstream_connection()) != 0) {
+    delete upstream->get_client_handler();
+  }
+}
+} // namespace
+
+void Http2BackendIODownstreamConnection::on_http2_backend_io_event(
+    Http2BackendIOEvent &ev) {
+  if (!downstream_) {
+    return;
+  }
+
+  switch (ev.type) {
+  case Http2BackendIOEventType::HEADERS:
+    on_headers(ev);
+    return;
+  case Http2BackendIOEventType::DATA:
+    on_data(ev);
+    return;
+  case Http2BackendIOEventType::UPLOAD_SENT:
+    on_upload_sent(ev);
+    return;
+  case Http2BackendIOEventType::CLOSE:
+    on_close(ev);
+    return;
+  }
+}
+
+void Http2BackendIODownstreamConnection::on_headers(Http2BackendIOEvent &ev) {
+  int rv;
+
+  auto downstream = downstream_;
+  auto upstream = downstream->get_upstream();
+  auto handler = upstream->get_client_handler();
+  const auto &req = downstream->request();
+  auto &resp = downstream->response();
+  auto &balloc = downstream->get_block_allocator();
+
+  auto config = get_config();
+  auto &httpconf = config->http;
+  auto &loggingconf = config->logging;
+
+  if (!response_received_) {
+    response_received_ = true;
+
+    addr_->connect_blocker->on_success();
+  }
+
+  auto trailer = ev.cat == NGHTTP2_HCAT_HEADERS &&
+                 !downstream->get_expect_final_response();
+
+  for (auto &hd : ev.headers) {
+    if (resp.fs.buffer_size() + hd.name.size() + hd.value.size() >
+            httpconf.response_header_field_buffer ||
+        resp.fs.num_fields() >= httpconf.max_response_header_fields) {
+      if (LOG_ENABLED(INFO)) {
+        DLOG(INFO, downstream)
+            << "Too large or many header field size="
+            << resp.fs.buffer_size() + hd.name.size() + hd.value.size()
+            << ", num=" << resp.fs.num_fields() + 1;
+      }
+
+      if (trailer) {
+        // We don't care trailer part exceeds header size limit; just
+        // discard it.
+        break;
+      }
+
+      send_reset(NGHTTP2_INTERNAL_ERROR, false);
+      downstream->set_response_state(DownstreamState::MSG_RESET);
+      call_downstream_readcb(downstream);
+
+      return;
+    }
+
+    auto name = make_string_ref(balloc, StringRef{hd.name});
+    auto value = make_string_ref(balloc, StringRef{hd.value});
+    auto token = http2::lookup_token(name);
+
+    if (trailer) {
+      // just store header fields for trailer part
+      resp.fs.add_trailer_token(name, value, hd.no_index, token);
+      continue;
+    }
+
+    resp.fs.add_header_token(name, value, hd.no_index, token);
+  }
+
+  if (ev.cat == NGHTTP2_HCAT_RESPONSE ||
+      (ev.cat == NGHTTP2_HCAT_HEADERS &&
+       downstream->get_expect_final_response())) {
+    auto &nva = resp.fs.headers();
+
+    downstream->set_expect_final_response(false);
+
+    auto status = resp.fs.header(http2::HD__STATUS);
+    // libnghttp2 guarantees this exists and can be parsed
+    assert(status);
+    auto status_code = http2::parse_http_status_code(status->value);
+
+    resp.http_status = status_code;
+    resp.http_major = 2;
+    resp.http_minor = 0;
+
+    downstream->set_downstream_addr_group(group_);
+    downstream->set_addr(addr_);
+    downstream->observe_backend_latency();
+
+    if (LOG_ENABLED(INFO)) {
+      std::stringstream ss;
+      for (auto &nv : nva) {
+        ss << TTY_HTTP_HD << nv.name << TTY_RST << ": " << nv.value << "\n";
+      }
+      DCLOG(INFO, this) << "HTTP response headers\n" << ss.str();
+    }
+
+    if (downstream->get_non_final_response()) {
+      if (LOG_ENABLED(INFO)) {
+        DCLOG(INFO, this) << "This is non-final response.";
+      }
+
+      downstream->set_expect_final_response(true);
+      rv = upstream->on_downstream_header_complete(downstream);
+
+      // Now Dowstream's response headers are erased.
+
+      if (rv != 0) {
+        send_reset(NGHTTP2_PROTOCOL_ERROR, false);
+        downstream->set_response_state(DownstreamState::MSG_RESET);
+      }
+
+      call_downstream_readcb(downstream);
+
+      return;
+    }
+
+    downstream->set_response_state(DownstreamState::HEADER_COMPLETE);
+
+    auto content_length = resp.fs.header(http2::HD_CONTENT_LENGTH);
+    if (content_length) {
+      // libnghttp2 guarantees this can be parsed
+      resp.fs.content_length = util::parse_uint(content_length->value);
+    }
+
+    if (resp.fs.content_length == -1 && downstream->expect_response_body()) {
+      // Here we have response body but Content-Length is not known in
+      // advance.
+      if (req.http_major <= 0 || (req.http_major == 1 && req.http_minor == 0)) {
+        // We simply close connection for pre-HTTP/1.1 in this case.
+        resp.connection_close = true;
+      } else {
+        // Otherwise, use chunked encoding to keep upstream connection
+        // open.  In HTTP2, we are supposed not to receive
+        // transfer-encoding.
+        resp.fs.add_header_token(StringRef::from_lit("transfer-encoding"),
+                                 StringRef::from_lit("chunked"), false,
+                                 http2::HD_TRANSFER_ENCODING);
+        downstream->set_chunked_response(true);
+      }
+    }
+
+    if (ev.end_stream) {
+      resp.headers_only = true;
+    }
+
+    if (loggingconf.access.write_early && downstream->accesslog_ready()) {
+      handler->write_accesslog(downstream);
+      downstream->set_accesslog_written(true);
+    }
+
+    downstream->on_backend_response_header();
+
+    rv = upstream->on_downstream_header_complete(downstream);
+    if (rv != 0) {
+      // Handling early return (in other words, response was hijacked
+      // by mruby scripting).
+      if (downstream->get_response_state() == DownstreamState::MSG_COMPLETE) {
+        send_reset(NGHTTP2_CANCEL, false);
+      } else {
+        send_reset(NGHTTP2_INTERNAL_ERROR, false);
+        downstream->set_response_state(DownstreamState::MSG_RESET);
+      }
+    }
+  }
+
+  if (ev.end_stream) {
+    downstream->disable_downstream_rtimer();
+
+    if (downstream->get_response_state() == DownstreamState::HEADER_COMPLETE) {
+      downstream->set_response_state(DownstreamState::MSG_COMPLETE);
+      downstream->on_backend_response_complete();
+
+      rv = upstream->on_downstream_body_complete(downstream);
+
+      if (rv != 0) {
+        downstream->set_response_state(DownstreamState::MSG_RESET);
+      }
+    }
+  } else {
+    downstream->reset_downstream_rtimer();
+  }
+
+  // This may delete downstream
+  call_downstream_readcb(downstream);
+}
+
+void Http2BackendIODownstreamConnection::on_data(Http2BackendIOEvent &ev) {
+  int rv;
+
+  auto downstream = downstream_;
+  auto upstream = downstream->get_upstream();
+  auto len = ev.data.rleft();
+
+  if (len) {
+    if (!downstream->expect_response_body() ||
+        // We don't want DATA after non-final response, which is
+        // illegal in HTTP.
+        downstream->get_non_final_response()) {
+      send_reset(NGHTTP2_PROTOCOL_ERROR, false);
+      downstream->set_response_state(DownstreamState::MSG_RESET);
+      call_downstream_readcb(downstream);
+
+      return;
+    }
+
+    downstream->reset_downstream_rtimer();
+
+    auto &resp = downstream->response();
+
+    resp.recv_body_length += len;
+    resp.unconsumed_body_length += len;
+
+    for (auto m = ev.data.head(); m; m = m->next) {
+      downstream->on_backend_response_body(m->pos, m->len());
+
+      rv = upstream->on_downstream_body(downstream, m->pos, m->len(), false);
+      if (rv != 0) {
+        send_reset(NGHTTP2_INTERNAL_ERROR, false);
+        downstream->set_response_state(DownstreamState::MSG_RESET);
+        call_downstream_readcb(downstream);
+
+        return;
+      }
+    }
+  }
+
+  rv = upstream->on_downstream_body(downstream, nullptr, 0, true);
+  if (rv != 0) {
+    send_reset(NGHTTP2_INTERNAL_ERROR, false);
+    downstream->set_response_state(DownstreamState::MSG_RESET);
+  } else if (ev.end_stream) {
+    downstream->disable_downstream_rtimer();
+
+    if (downstream->get_response_state() == DownstreamState::HEADER_COMPLETE) {
+      downstream->set_response_state(DownstreamState::MSG_COMPLETE);
+      downstream->on_backend_response_complete();
+
+      rv = upstream->on_downstream_body_complete(downstream);
+
+      if (rv != 0) {
+        downstream->set_response_state(DownstreamState::MSG_RESET);
+      }
+    }
+  }
+
+  call_downstream_readcb(downstream);
+}
+
+void Http2BackendIODownstreamConnection::on_upload_sent(
+    Http2BackendIOEvent &ev) {
+  auto downstream = downstream_;
+
+  upload_pending_ -= std::min(upload_pending_, ev.len);
+
+  if (upload_pending_ == 0) {
+    downstream->disable_downstream_wtimer();
+  } else {
+    downstream->reset_downstream_wtimer();
+  }
+
+  // This is important because it will handle flow control stuff.
+  if (downstream->get_upstream()->resume_read(SHRPX_NO_BUFFER, downstream,
+                                              ev.len) != 0) {
+    delete downstream->get_upstream()->get_client_handler();
+  }
+}
+
+void Http2BackendIODownstreamConnection::on_close(Http2BackendIOEvent &ev) {
+  auto downstream = downstream_;
+  auto upstream = downstream->get_upstream();
+
+  closed_ = true;
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Backend stream is closed with error code "
+                      << ev.error_code;
+  }
+
+  auto &resp = downstream->response();
+  resp.unconsumed_body_length = 0;
+
+  if (ev.session_failure && !ev.submitted && !body_sent_) {
+    // The request was never sent to the backend.  It is safe to retry
+    // it with the other connection.
+    if (ev.connect_failed) {
+      downstream_failure(addr_, &addr_->addr);
+    }
+
+    downstream->set_request_header_sent(false);
+
+    if (upstream->on_downstream_reset(downstream, false) != 0) {
+      delete upstream->get_client_handler();
+    }
+
+    // this object was deleted
+    return;
+  }
+
+  if (ev.connect_failed) {
+    downstream_failure(addr_, &addr_->addr);
+  }
+
+  if (downstream->get_upgraded() &&
+      downstream->get_response_state() == DownstreamState::HEADER_COMPLETE) {
+    // For tunneled connection, we have to submit RST_STREAM to
+    // upstream *after* whole response body is sent. We just set
+    // MSG_COMPLETE here. Upstream will take care of that.
+    upstream->on_downstream_body_complete(downstream);
+    downstream->set_response_state(DownstreamState::MSG_COMPLETE);
+  } else if (ev.error_code == NGHTTP2_NO_ERROR) {
+    switch (downstream->get_response_state()) {
+    case DownstreamState::MSG_COMPLETE:
+    case DownstreamState::MSG_BAD_HEADER:
+      break;
+    default:
+      downstream->set_response_state(DownstreamState::MSG_RESET);
+    }
+  } else if (downstream->get_response_state() !=
+             DownstreamState::MSG_BAD_HEADER) {
+    downstream->set_response_state(DownstreamState::MSG_RESET);
+  }
+
+  if (downstream->get_response_state() == DownstreamState::MSG_RESET &&
+      downstream->get_response_rst_stream_error_code() == NGHTTP2_NO_ERROR) {
+    downstream->set_response_rst_stream_error_code(ev.error_code);
+  }
+
+  call_downstream_readcb(downstream);
+}
+
+} // namespace shrpx
@@ -0,0 +1,108 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_HTTP2_BACKEND_IO_DOWNSTREAM_CONNECTION_H
+#define SHRPX_HTTP2_BACKEND_IO_DOWNSTREAM_CONNECTION_H
+
+#include "shrpx.h"
+
+#include <memory>
+
+#include "shrpx_downstream_connection.h"
+
+namespace shrpx {
+
+class Worker;
+class Http2BackendIO;
+class Http2BackendIOBuffer;
+struct Http2BackendIOStream;
+struct Http2BackendIOEvent;
+
+// Http2BackendIODownstreamConnection forwards a request to HTTP/2
+// backend through a backend I/O thread.  The backend connection is
+// shared by all workers which use the same backend I/O thread.
+class Http2BackendIODownstreamConnection : public DownstreamConnection {
+public:
+  Http2BackendIODownstreamConnection(
+      const std::shared_ptr<DownstreamAddrGroup> &group, DownstreamAddr *addr,
+      Http2BackendIO *io, Worker *worker);
+  virtual ~Http2BackendIODownstreamConnection();
+  virtual int attach_downstream(Downstream *downstream);
+  virtual void detach_downstream(Downstream *downstream);
+
+  virtual int push_request_headers();
+  virtual int push_upload_data_chunk(const uint8_t *data, size_t datalen);
+  virtual int end_upload_data();
+
+  virtual void pause_read(IOCtrlReason reason) {}
+  virtual int resume_read(IOCtrlReason reason, size_t consumed);
+  virtual void force_resume_read() {}
+
+  virtual int on_read();
+  virtual int on_write();
+  virtual int on_timeout();
+
+  virtual void on_upstream_change(Upstream *upstream) {}
+
+  // This object is not poolable because the stream cannot be reused.
+  virtual bool poolable() const { return false; }
+
+  virtual const std::shared_ptr<DownstreamAddrGroup> &
+  get_downstream_addr_group() const;
+  virtual DownstreamAddr *get_addr() const;
+
+  // Handles |ev| sent from the backend I/O thread.  This function
+  // may delete this object.
+  void on_http2_backend_io_event(Http2BackendIOEvent &ev);
+
+private:
+  void send_reset(uint32_t error_code, bool detach);
+  void send_data(Http2BackendIOBuffer data, bool eof);
+  void on_headers(Http2BackendIOEvent &ev);
+  void on_data(Http2BackendIOEvent &ev);
+  void on_upload_sent(Http2BackendIOEvent &ev);
+  void on_close(Http2BackendIOEvent &ev);
+
+  std::shared_ptr<DownstreamAddrGroup> group_;
+  DownstreamAddr *addr_;
+  Http2BackendIO *io_;
+  Worker *worker_;
+  std::shared_ptr<Http2BackendIOStream> stream_;
+  // The number of request body bytes which have not been sent to the
+  // backend yet.
+  size_t upload_pending_;
+  // true if SUBMIT command has been sent.
+  bool submitted_;
+  // true if the stream has been closed in the backend I/O thread.
+  bool closed_;
+  // true if any request body has been sent to the backend I/O
+  // thread.  The request cannot be retried after this.
+  bool body_sent_;
+  // true if the response header from backend has been received.
+  bool response_received_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_HTTP2_BACKEND_IO_DOWNSTREAM_CONNECTION_H
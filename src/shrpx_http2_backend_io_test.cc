@@ -0,0 +1,395 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_http2_backend_io_test.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <array>
+#include <cstring>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_http2_backend_io.h"
+#include "shrpx_config.h"
+#include "shrpx_worker.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+// Http2BackendIO reads the backend timeouts from the configuration.
+void ensure_downstream_config() {
+  auto &downstreamconf = mod_config()->conn.downstream;
+  if (!downstreamconf) {
+    downstreamconf = std::make_shared<DownstreamConfig>();
+  }
+}
+} // namespace
+
+namespace {
+void init_addr(DownstreamAddr &addr, uint16_t port) {
+  addr.addr.su.in.sin_family = AF_INET;
+  addr.addr.su.in.sin_port = htons(port);
+  addr.addr.su.in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.addr.len = sizeof(addr.addr.su.in);
+  addr.host = StringRef::from_lit("127.0.0.1");
+  addr.port = port;
+}
+} // namespace
+
+void test_shrpx_http2_backend_io_buffer(void) {
+  ensure_downstream_config();
+
+  Http2BackendIO io(nullptr);
+  auto pool = io.get_buffer_pool();
+
+  {
+    Http2BackendIOBuffer a(&io), b(&io);
+
+    a.append("hello", 5);
+    b.append(" world", 6);
+
+    a.append(b);
+
+    CU_ASSERT(11 == a.rleft());
+    CU_ASSERT(0 == b.rleft());
+    CU_ASSERT(nullptr == b.head());
+
+    // The chunks move along with the buffer.
+    auto c = std::move(a);
+
+    CU_ASSERT(0 == a.rleft());
+    CU_ASSERT(11 == c.rleft());
+    CU_ASSERT(pool->poolsize.load() > 0);
+
+    std::array<uint8_t, 16> buf;
+
+    CU_ASSERT(5 == c.remove(buf.data(), 5));
+    CU_ASSERT(0 == memcmp("hello", buf.data(), 5));
+    CU_ASSERT(6 == c.rleft());
+
+    size_t n = 0;
+    for (auto m = c.head(); m; m = m->next) {
+      n += m->len();
+    }
+
+    CU_ASSERT(6 == n);
+
+    // The moved-from buffer is still usable.
+    a.append("x", 1);
+
+    CU_ASSERT(1 == a.rleft());
+
+    Http2BackendIOBuffer d;
+
+    CU_ASSERT(0 == d.remove(buf.data(), buf.size()));
+
+    a.append(d);
+
+    CU_ASSERT(1 == a.rleft());
+
+    d = std::move(c);
+
+    CU_ASSERT(6 == d.rleft());
+  }
+
+  // All chunks are given back to the pool.
+  CU_ASSERT(pool->poolsize.load() == pool->freelistsize.load());
+}
+
+void test_shrpx_http2_backend_io_trim(void) {
+  ensure_downstream_config();
+
+  auto &bufpoolconf = mod_config()->buffer_pool;
+  auto saved_bufpoolconf = bufpoolconf;
+
+  bufpoolconf.high_watermark = 0;
+  bufpoolconf.low_watermark = 0;
+
+  {
+    Http2BackendIO io(nullptr);
+    auto pool = io.get_buffer_pool();
+
+    {
+      Http2BackendIOBuffer a(&io);
+      std::array<uint8_t, 4096> data{};
+
+      for (size_t i = 0; i < 16; ++i) {
+        a.append(data.data(), data.size());
+      }
+    }
+
+    auto poolsize = pool->poolsize.load();
+
+    CU_ASSERT(poolsize > 0);
+    CU_ASSERT(poolsize == pool->freelistsize.load());
+
+    // The first trimming only records the unused chunks.
+    io.trim_mcpool();
+
+    CU_ASSERT(poolsize == pool->poolsize.load());
+
+    // They are not used since then, and freed.
+    io.trim_mcpool();
+
+    CU_ASSERT(0 == pool->poolsize.load());
+    CU_ASSERT(0 == pool->freelistsize.load());
+    CU_ASSERT(poolsize == pool->trimmed.load());
+  }
+
+  bufpoolconf.high_watermark = 1;
+
+  {
+    Http2BackendIO io(nullptr);
+    auto pool = io.get_buffer_pool();
+
+    {
+      Http2BackendIOBuffer a(&io);
+
+      a.append("hello", 5);
+    }
+
+    // The chunk is freed as soon as it is released.
+    CU_ASSERT(0 == pool->poolsize.load());
+    CU_ASSERT(pool->trimmed.load() > 0);
+  }
+
+  bufpoolconf = saved_bufpoolconf;
+}
+
+void test_shrpx_http2_backend_io_commands(void) {
+  ensure_downstream_config();
+
+  Http2BackendIO io(nullptr);
+
+  auto stream = std::make_shared<Http2BackendIOStream>(nullptr, nullptr, &io);
+
+  CU_ASSERT(&io == stream->io);
+
+  Http2BackendIOBuffer data(&io);
+  data.append("foo", 3);
+
+  Http2BackendIOCommand cmd{};
+  cmd.type = Http2BackendIOCommandType::DATA;
+  cmd.stream = stream;
+  cmd.data = std::move(data);
+
+  io.send(std::move(cmd));
+
+  data = Http2BackendIOBuffer(&io);
+  data.append("bar", 3);
+
+  cmd = Http2BackendIOCommand{};
+  cmd.type = Http2BackendIOCommandType::DATA;
+  cmd.stream = stream;
+  cmd.data = std::move(data);
+  cmd.eof = true;
+
+  io.send(std::move(cmd));
+
+  io.process_commands();
+
+  CU_ASSERT(stream->req_eof);
+  CU_ASSERT(6 == stream->reqbuf.rleft());
+
+  std::array<uint8_t, 16> buf;
+  auto n = stream->reqbuf.remove(buf.data(), buf.size());
+
+  CU_ASSERT(6 == n);
+  CU_ASSERT(0 == memcmp("foobar", buf.data(), n));
+
+  cmd = Http2BackendIOCommand{};
+  cmd.type = Http2BackendIOCommandType::RESET;
+  cmd.stream = stream;
+  cmd.detach = true;
+
+  io.send(std::move(cmd));
+
+  io.process_commands();
+
+  CU_ASSERT(stream->detached);
+
+  // The request body sent after the stream is closed is discarded.
+  stream->closed = true;
+
+  data = Http2BackendIOBuffer(&io);
+  data.append("baz", 3);
+
+  cmd = Http2BackendIOCommand{};
+  cmd.type = Http2BackendIOCommandType::DATA;
+  cmd.stream = stream;
+  cmd.data = std::move(data);
+
+  io.send(std::move(cmd));
+
+  io.process_commands();
+
+  CU_ASSERT(0 == stream->reqbuf.rleft());
+}
+
+void test_shrpx_http2_backend_io_peer(void) {
+  ensure_downstream_config();
+
+  Http2BackendIO io(nullptr);
+
+  DownstreamAddr a{}, b{}, c{};
+
+  init_addr(a, 8080);
+  init_addr(b, 8080);
+  init_addr(c, 8080);
+  c.tls = true;
+
+  auto pa = io.get_peer(&a);
+  auto pb = io.get_peer(&b);
+  auto pc = io.get_peer(&c);
+
+  CU_ASSERT(pa == pb);
+  CU_ASSERT(pa != pc);
+  CU_ASSERT(2 == pa->refcnt);
+  CU_ASSERT(1 == pc->refcnt);
+  CU_ASSERT(2 == io.get_num_peers());
+
+  io.release_peer(pa);
+  io.process_commands();
+
+  CU_ASSERT(2 == io.get_num_peers());
+  CU_ASSERT(1 == pa->refcnt);
+
+  io.release_peer(pa);
+  io.release_peer(pc);
+  io.process_commands();
+
+  CU_ASSERT(0 == io.get_num_peers());
+
+  // A peer which still has a session is kept until the session is
+  // gone.
+  auto fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  CU_ASSERT_FATAL(fd != -1);
+
+  sockaddr_union su{};
+  su.in.sin_family = AF_INET;
+  su.in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(su.in);
+
+  auto listening = bind(fd, &su.sa, len) == 0 && listen(fd, 1) == 0 &&
+                   getsockname(fd, &su.sa, &len) == 0;
+  if (!listening) {
+    close(fd);
+  }
+
+  CU_ASSERT_FATAL(listening);
+
+  DownstreamAddr d{};
+  init_addr(d, ntohs(su.in.sin_port));
+
+  auto pd = io.get_peer(&d);
+
+  // No event is sent to the worker for a detached stream.
+  auto stream = std::make_shared<Http2BackendIOStream>(nullptr, nullptr, &io);
+  stream->detached = true;
+
+  Http2BackendIOCommand cmd{};
+  cmd.type = Http2BackendIOCommandType::SUBMIT;
+  cmd.stream = stream;
+  cmd.peer = pd;
+  cmd.eof = true;
+
+  io.send(std::move(cmd));
+  io.release_peer(pd);
+  io.process_commands();
+
+  CU_ASSERT(1 == io.get_num_peers());
+  CU_ASSERT(0 == pd->refcnt);
+  CU_ASSERT(1 == pd->sessions.size());
+
+  // The backend resets the connection.
+  close(fd);
+
+  auto loop = io.get_loop();
+
+  for (size_t i = 0; i < 1000 && io.get_num_peers(); ++i) {
+    ev_run(loop, EVRUN_NOWAIT);
+    usleep(1000);
+  }
+
+  CU_ASSERT(0 == io.get_num_peers());
+  CU_ASSERT(stream->closed);
+}
+
+void test_shrpx_http2_backend_io_keep_idle(void) {
+  ensure_downstream_config();
+
+  auto fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  CU_ASSERT_FATAL(fd != -1);
+
+  sockaddr_union su{};
+  su.in.sin_family = AF_INET;
+  su.in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(su.in);
+
+  auto listening = bind(fd, &su.sa, len) == 0 && listen(fd, 8) == 0 &&
+                   getsockname(fd, &su.sa, &len) == 0;
+  if (!listening) {
+    close(fd);
+  }
+
+  CU_ASSERT_FATAL(listening);
+
+  {
+    Http2BackendIO io(nullptr);
+
+    DownstreamAddr addr{};
+    init_addr(addr, ntohs(su.in.sin_port));
+
+    auto peer = io.get_peer(&addr);
+
+    io.keep_idle_sessions(peer, 2);
+    io.process_commands();
+
+    CU_ASSERT(2 == peer->sessions.size());
+
+    // Every worker asks the same thing.
+    io.keep_idle_sessions(peer, 2);
+    io.keep_idle_sessions(peer, 1);
+    io.process_commands();
+
+    CU_ASSERT(2 == peer->sessions.size());
+
+    io.keep_idle_sessions(peer, 3);
+    io.process_commands();
+
+    CU_ASSERT(3 == peer->sessions.size());
+  }
+
+  close(fd);
+}
+
+} // namespace shrpx
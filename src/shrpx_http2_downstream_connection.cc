@@ -226,30 +226,11 @@ ssize_t http2_data_read_callback(nghttp2_session *session, int32_t stream_id,
 }
 } // namespace
 
-int Http2DownstreamConnection::push_request_headers() {
-  int rv;
-  if (!downstream_) {
-    return 0;
-  }
-  if (!http2session_->can_push_request(downstream_)) {
-    // The HTTP2 session to the backend has not been established or
-    // connection is now being checked.  This function will be called
-    // again just after it is established.
-    downstream_->set_request_pending(true);
-    http2session_->start_checking_connection();
-    return 0;
-  }
-
-  downstream_->set_request_pending(false);
-
-  const auto &req = downstream_->request();
-
-  if (req.connect_proto != ConnectProto::NONE &&
-      !http2session_->get_allow_connect_proto()) {
-    return -1;
-  }
-
-  auto &balloc = downstream_->get_block_allocator();
+void build_http2_request_headers(std::vector<nghttp2_nv> &nva,
+                                 Downstream *downstream,
+                                 const DownstreamAddr *addr) {
+  const auto &req = downstream->request();
+  auto &balloc = downstream->get_block_allocator();
 
   auto config = get_config();
   auto &httpconf = config->http;
@@ -258,9 +239,7 @@ int Http2DownstreamConnection::push_request_headers() {
   auto no_host_rewrite = httpconf.no_host_rewrite || config->http2_proxy ||
                          req.regular_connect_method();
 
-  // http2session_ has already in CONNECTED state, so we can get
-  // addr_idx here.
-  const auto &downstream_hostport = http2session_->get_addr()->hostport;
+  const auto &downstream_hostport = addr->hostport;
 
   // For HTTP/1.0 request, there is no authority in request.  In that
   // case, we use backend server's host nonetheless.
@@ -270,11 +249,11 @@ int Http2DownstreamConnection::push_request_headers() {
     authority = req.authority;
   }
 
-  downstream_->set_request_downstream_host(authority);
+  downstream->set_request_downstream_host(authority);
 
   size_t num_cookies = 0;
   if (!http2conf.no_cookie_crumbling) {
-    num_cookies = downstream_->count_crumble_request_cookie();
+    num_cookies = downstream->count_crumble_request_cookie();
   }
 
   // 11 means:
@@ -289,7 +268,6 @@ int Http2DownstreamConnection::push_request_headers() {
   // 9. te (optional)
   // 10. forwarded (optional)
   // 11. early-data (optional)
-  auto nva = std::vector<nghttp2_nv>();
   nva.reserve(req.fs.headers().size() + 11 + num_cookies +
               httpconf.add_request_headers.size());
 
@@ -304,8 +282,6 @@ int Http2DownstreamConnection::push_request_headers() {
   if (!req.regular_connect_method()) {
     assert(!req.scheme.empty());
 
-    auto addr = http2session_->get_addr();
-    assert(addr);
     // We will handle more protocol scheme upgrade in the future.
     if (addr->tls && addr->upgrade_scheme && req.scheme == "http") {
       nva.push_back(http2::make_nv_ll(":scheme", "https"));
@@ -343,10 +319,10 @@ int Http2DownstreamConnection::push_request_headers() {
   http2::copy_headers_to_nva_nocopy(nva, req.fs.headers(), build_flags);
 
   if (!http2conf.no_cookie_crumbling) {
-    downstream_->crumble_request_cookie(nva);
+    downstream->crumble_request_cookie(nva);
   }
 
-  auto upstream = downstream_->get_upstream();
+  auto upstream = downstream->get_upstream();
   auto handler = upstream->get_client_handler();
 
 #if OPENSSL_1_1_1_API
@@ -392,12 +368,12 @@ int Http2DownstreamConnection::push_request_headers() {
 
   if (xffconf.add) {
     StringRef xff_value;
-    const auto &addr = upstream->get_client_handler()->get_ipaddr();
+    const auto &ipaddr = upstream->get_client_handler()->get_ipaddr();
     if (xff) {
       xff_value = concat_string_ref(balloc, xff->value,
-                                    StringRef::from_lit(", "), addr);
+                                    StringRef::from_lit(", "), ipaddr);
     } else {
-      xff_value = addr;
+      xff_value = ipaddr;
     }
     nva.push_back(http2::make_nv_ls_nocopy("x-forwarded-for", xff_value));
   } else if (xff) {
@@ -471,9 +447,37 @@ int Http2DownstreamConnection::push_request_headers() {
       ss << TTY_HTTP_HD << StringRef{nv.name, nv.namelen} << TTY_RST << ": "
          << StringRef{nv.value, nv.valuelen} << "\n";
     }
-    DCLOG(INFO, this) << "HTTP request headers\n" << ss.str();
+    DLOG(INFO, downstream) << "HTTP request headers\n" << ss.str();
+  }
+}
+
+int Http2DownstreamConnection::push_request_headers() {
+  int rv;
+  if (!downstream_) {
+    return 0;
+  }
+  if (!http2session_->can_push_request(downstream_)) {
+    // The HTTP2 session to the backend has not been established or
+    // connection is now being checked.  This function will be called
+    // again just after it is established.
+    downstream_->set_request_pending(true);
+    http2session_->start_checking_connection();
+    return 0;
   }
 
+  downstream_->set_request_pending(false);
+
+  const auto &req = downstream_->request();
+
+  if (req.connect_proto != ConnectProto::NONE &&
+      !http2session_->get_allow_connect_proto()) {
+    return -1;
+  }
+
+  auto nva = std::vector<nghttp2_nv>();
+
+  build_http2_request_headers(nva, downstream_, http2session_->get_addr());
+
   auto transfer_encoding = req.fs.header(http2::HD_TRANSFER_ENCODING);
 
   nghttp2_data_provider *data_prdptr = nullptr;
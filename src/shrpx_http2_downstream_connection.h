@@ -27,6 +27,8 @@
 
 #include "shrpx.h"
 
+#include <vector>
+
 #include <openssl/ssl.h>
 
 #include <nghttp2/nghttp2.h>
@@ -83,6 +85,13 @@ private:
   StreamData *sd_;
 };
 
+// Builds request header fields which are forwarded to HTTP/2 backend
+// |addr| for |downstream|, and appends them to |nva|.  The header
+// fields refer to the memory owned by |downstream|.
+void build_http2_request_headers(std::vector<nghttp2_nv> &nva,
+                                 Downstream *downstream,
+                                 const DownstreamAddr *addr);
+
 } // namespace shrpx
 
 #endif // SHRPX_HTTP2_DOWNSTREAM_CONNECTION_H
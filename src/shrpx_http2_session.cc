@@ -1107,6 +1107,7 @@ int on_response_headers(Http2Session *http2session, Downstream *downstream,
   downstream->set_downstream_addr_group(
       http2session->get_downstream_addr_group());
   downstream->set_addr(http2session->get_addr());
+  downstream->observe_backend_latency();
 
   if (LOG_ENABLED(INFO)) {
     std::stringstream ss;
@@ -1188,6 +1189,8 @@ int on_response_headers(Http2Session *http2session, Downstream *downstream,
     downstream->set_accesslog_written(true);
   }
 
+  downstream->on_backend_response_header();
+
   rv = upstream->on_downstream_header_complete(downstream);
   if (rv != 0) {
     // Handling early return (in other words, response was hijacked by
@@ -1234,6 +1237,7 @@ int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame,
           DownstreamState::HEADER_COMPLETE) {
 
         downstream->set_response_state(DownstreamState::MSG_COMPLETE);
+        downstream->on_backend_response_complete();
 
         rv = upstream->on_downstream_body_complete(downstream);
 
@@ -1277,6 +1281,7 @@ int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame,
       if (downstream->get_response_state() ==
           DownstreamState::HEADER_COMPLETE) {
         downstream->set_response_state(DownstreamState::MSG_COMPLETE);
+        downstream->on_backend_response_complete();
 
         auto upstream = downstream->get_upstream();
 
@@ -1434,6 +1439,8 @@ int on_data_chunk_recv_callback(nghttp2_session *session, uint8_t flags,
   resp.recv_body_length += len;
   resp.unconsumed_body_length += len;
 
+  downstream->on_backend_response_body(data, len);
+
   auto upstream = downstream->get_upstream();
   rv = upstream->on_downstream_body(downstream, data, len, false);
   if (rv != 0) {
@@ -1886,6 +1893,14 @@ void Http2Session::start_checking_connection() {
   signal_write();
 }
 
+void Http2Session::keep_alive_idle() {
+  if (!dconns_.empty()) {
+    return;
+  }
+
+  start_checking_connection();
+}
+
 void Http2Session::reset_connection_check_timer(ev_tstamp t) {
   connchk_timer_.repeat = t;
   ev_timer_again(conn_.loop, &connchk_timer_);
@@ -2316,6 +2331,25 @@ Http2Session::get_downstream_addr_group() const {
   return group_;
 }
 
+void Http2Session::rebind(const std::shared_ptr<DownstreamAddrGroup> &group,
+                          DownstreamAddr *addr) {
+  assert(freelist_zone_ == FreelistZone::NONE);
+
+  if (raddr_ == &addr_->addr) {
+    raddr_ = &addr->addr;
+  }
+
+  if (conn_.tls.client_session_cache == &addr_->tls_session_cache) {
+    conn_.tls.client_session_cache = &addr->tls_session_cache;
+  }
+
+  addr_->num_dconn -= dconns_.size();
+  addr->num_dconn += dconns_.size();
+
+  group_ = group;
+  addr_ = addr;
+}
+
 void Http2Session::add_to_extra_freelist() {
   if (freelist_zone_ != FreelistZone::NONE) {
     return;
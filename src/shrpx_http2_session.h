@@ -175,6 +175,10 @@ public:
   // Initiates the connection checking if downstream connection has
   // been established and connection checking is required.
   void start_checking_connection();
+  // Starts connection checking if this session has no stream and
+  // connection checking is required.  A PING round trip keeps an
+  // idle session from being timed out, and finds a dead one early.
+  void keep_alive_idle();
   // Resets connection check timer to timeout |t|.  After timeout, we
   // require connection checking.  If connection checking is already
   // enabled, this timeout is for PING ACK timeout.
@@ -195,6 +199,12 @@ public:
 
   const std::shared_ptr<DownstreamAddrGroup> &get_downstream_addr_group() const;
 
+  // Moves this session to |addr| in |group|, which has the same
+  // backend address as the current one.  This session must not be in
+  // any freelist.
+  void rebind(const std::shared_ptr<DownstreamAddrGroup> &group,
+              DownstreamAddr *addr);
+
   int handle_downstream_push_promise(Downstream *downstream,
                                      int32_t promised_stream_id);
   int handle_downstream_push_promise_complete(Downstream *downstream,
@@ -835,40 +835,51 @@ constexpr auto PADDING = std::array<uint8_t, 256>{};
 } // namespace
 
 namespace {
-int send_data_callback(nghttp2_session *session, nghttp2_frame *frame,
-                       const uint8_t *framehd, size_t length,
-                       nghttp2_data_source *source, void *user_data) {
-  auto downstream = static_cast<Downstream *>(source->ptr);
-  auto upstream = static_cast<Http2Upstream *>(downstream->get_upstream());
-  auto body = downstream->get_response_buf();
-
+int send_data_batch_callback(nghttp2_session *session,
+                             const nghttp2_send_data_entry *entries,
+                             size_t nentries, void *user_data) {
+  auto upstream = static_cast<Http2Upstream *>(user_data);
   auto wb = upstream->get_response_buf();
 
-  size_t padlen = 0;
+  for (size_t i = 0; i < nentries; ++i) {
+    auto &ent = entries[i];
+    auto downstream = static_cast<Downstream *>(ent.source.ptr);
+    auto body = downstream->get_response_buf();
+    auto length = ent.length;
 
-  wb->append(framehd, 9);
-  if (frame->data.padlen > 0) {
-    padlen = frame->data.padlen - 1;
-    wb->append(static_cast<uint8_t>(padlen));
-  }
+    size_t padlen = 0;
 
-  body->remove(*wb, length);
+    wb->append(ent.framehd, 9);
+    if (ent.frame.padlen > 0) {
+      padlen = ent.frame.padlen - 1;
+      wb->append(static_cast<uint8_t>(padlen));
+    }
 
-  wb->append(PADDING.data(), padlen);
+    body->remove(*wb, length);
 
-  if (body->rleft() == 0) {
-    downstream->disable_upstream_wtimer();
-  } else {
-    downstream->reset_upstream_wtimer();
-  }
+    wb->append(PADDING.data(), padlen);
 
-  if (length > 0 && downstream->resume_read(SHRPX_NO_BUFFER, length) != 0) {
-    return NGHTTP2_ERR_CALLBACK_FAILURE;
-  }
+    if (body->rleft() == 0) {
+      downstream->disable_upstream_wtimer();
+    } else {
+      downstream->reset_upstream_wtimer();
+    }
+
+    // Backend is credited with the bytes it sent, which differ from
+    // what we send if response body is compressed.
+    auto consumed = downstream->get_response_compressed()
+                        ? downstream->drain_compressed_response_body(length)
+                        : length;
 
-  // We have to add length here, so that we can log this amount of
-  // data transferred.
-  downstream->response_sent_body_length += length;
+    if (consumed > 0 &&
+        downstream->resume_read(SHRPX_NO_BUFFER, consumed) != 0) {
+      return NGHTTP2_ERR_CALLBACK_FAILURE;
+    }
+
+    // We have to add length here, so that we can log this amount of
+    // data transferred.
+    downstream->response_sent_body_length += length;
+  }
 
   auto max_buffer_size = upstream->get_max_buffer_size();
 
@@ -989,8 +1000,8 @@ nghttp2_session_callbacks *create_http2_upstream_callbacks() {
   nghttp2_session_callbacks_set_on_begin_headers_callback(
       callbacks, on_begin_headers_callback);
 
-  nghttp2_session_callbacks_set_send_data_callback(callbacks,
-                                                   send_data_callback);
+  nghttp2_session_callbacks_set_send_data_batch_callback(
+      callbacks, send_data_batch_callback);
 
   auto config = get_config();
 
@@ -1097,6 +1108,30 @@ Http2Upstream::Http2Upstream(ClientHandler *handler)
         << nghttp2_strerror(rv);
   }
 
+  // server and alt-svc header fields have the same value in most of
+  // the responses.  Let HPACK deflater encode them only once.
+  auto &httpconf = config->http;
+  std::array<nghttp2_nv, 2> precompiled;
+  size_t nprecompiled = 0;
+
+  if (!config->http2_proxy && !httpconf.no_server_rewrite) {
+    precompiled[nprecompiled++] =
+        http2::make_nv_ls_nocopy("server", httpconf.server_name);
+  }
+
+  if (!httpconf.http2_altsvc_header_value.empty()) {
+    precompiled[nprecompiled++] = http2::make_nv_ls_nocopy(
+        "alt-svc", httpconf.http2_altsvc_header_value);
+  }
+
+  rv = nghttp2_session_add_precompiled_headers(session_, precompiled.data(),
+                                               nprecompiled);
+  if (rv != 0) {
+    ULOG(ERROR, this)
+        << "nghttp2_session_add_precompiled_headers() returned error: "
+        << nghttp2_strerror(rv);
+  }
+
   // We wait for SETTINGS ACK at least 10 seconds.
   ev_timer_init(&settings_timer_, settings_timeout_cb,
                 http2conf.upstream.timeout.settings, 0.);
@@ -1767,6 +1802,8 @@ int Http2Upstream::on_downstream_header_complete(Downstream *downstream) {
     return 0;
   }
 
+  downstream->start_response_compression();
+
   auto striphd_flags = http2::HDOP_STRIP_ALL & ~http2::HDOP_STRIP_VIA;
   StringRef response_status;
 
@@ -1891,7 +1928,17 @@ int Http2Upstream::on_downstream_body(Downstream *downstream,
                                       const uint8_t *data, size_t len,
                                       bool flush) {
   auto body = downstream->get_response_buf();
-  body->append(data, len);
+
+  if (downstream->get_response_compressed()) {
+    auto nwrite = downstream->compress_response_body(*body, data, len, false);
+    if (nwrite < 0) {
+      return -1;
+    }
+
+    downstream->track_compressed_response_body(nwrite, len);
+  } else {
+    body->append(data, len);
+  }
 
   if (flush) {
     nghttp2_session_resume_data(session_, downstream->get_stream_id());
@@ -1917,6 +1964,16 @@ int Http2Upstream::on_downstream_body_complete(Downstream *downstream) {
     return 0;
   }
 
+  if (downstream->get_response_compressed()) {
+    auto nwrite = downstream->compress_response_body(
+        *downstream->get_response_buf(), nullptr, 0, true);
+    if (nwrite < 0) {
+      return -1;
+    }
+
+    downstream->track_compressed_response_body(nwrite, 0);
+  }
+
   nghttp2_session_resume_data(session_, downstream->get_stream_id());
   downstream->ensure_upstream_wtimer();
 
@@ -2315,6 +2372,10 @@ int Http2Upstream::response_riovec(struct iovec *iov, int iovcnt) const {
 
 void Http2Upstream::response_drain(size_t n) { wb_.drain(n); }
 
+void Http2Upstream::response_drain(size_t n, DefaultMemchunks &pinned) {
+  wb_.drain_pin(n, pinned);
+}
+
 bool Http2Upstream::response_empty() const { return wb_.rleft() == 0; }
 
 DefaultMemchunks *Http2Upstream::get_response_buf() { return &wb_; }
@@ -86,6 +86,7 @@ public:
   virtual int initiate_push(Downstream *downstream, const StringRef &uri);
   virtual int response_riovec(struct iovec *iov, int iovcnt) const;
   virtual void response_drain(size_t n);
+  virtual void response_drain(size_t n, DefaultMemchunks &pinned);
   virtual bool response_empty() const;
 
   virtual Downstream *on_downstream_push_promise(Downstream *downstream,
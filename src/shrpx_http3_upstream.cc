@@ -473,6 +473,13 @@ int handshake_completed(ngtcp2_conn *conn, void *user_data) {
 int Http3Upstream::handshake_completed() {
   handler_->set_alpn_from_conn();
 
+  auto worker_stat = handler_->get_worker()->get_worker_stat();
+
+  stat_add(worker_stat->tls_handshakes);
+  if (SSL_session_reused(handler_->get_ssl())) {
+    stat_add(worker_stat->tls_resumed_handshakes);
+  }
+
   auto alpn = handler_->get_alpn();
   if (alpn.empty()) {
     ULOG(ERROR, this) << "NO ALPN was negotiated";
@@ -1327,6 +1334,8 @@ int Http3Upstream::on_downstream_header_complete(Downstream *downstream) {
     return 0;
   }
 
+  downstream->start_response_compression();
+
   auto striphd_flags = http2::HDOP_STRIP_ALL & ~http2::HDOP_STRIP_VIA;
   StringRef response_status;
 
@@ -1432,7 +1441,17 @@ int Http3Upstream::on_downstream_body(Downstream *downstream,
                                       const uint8_t *data, size_t len,
                                       bool flush) {
   auto body = downstream->get_response_buf();
-  body->append(data, len);
+
+  if (downstream->get_response_compressed()) {
+    auto nwrite = downstream->compress_response_body(*body, data, len, false);
+    if (nwrite < 0) {
+      return -1;
+    }
+
+    downstream->track_compressed_response_body(nwrite, len);
+  } else {
+    body->append(data, len);
+  }
 
   if (flush) {
     nghttp3_conn_resume_stream(httpconn_, downstream->get_stream_id());
@@ -1456,6 +1475,16 @@ int Http3Upstream::on_downstream_body_complete(Downstream *downstream) {
     return 0;
   }
 
+  if (downstream->get_response_compressed()) {
+    auto nwrite = downstream->compress_response_body(
+        *downstream->get_response_buf(), nullptr, 0, true);
+    if (nwrite < 0) {
+      return -1;
+    }
+
+    downstream->track_compressed_response_body(nwrite, 0);
+  }
+
   if (!downstream->get_upgraded()) {
     const auto &trailers = resp.fs.trailers();
     if (!trailers.empty()) {
@@ -1732,6 +1761,8 @@ int Http3Upstream::response_riovec(struct iovec *iov, int iovcnt) const {
 
 void Http3Upstream::response_drain(size_t n) {}
 
+void Http3Upstream::response_drain(size_t n, DefaultMemchunks &pinned) {}
+
 bool Http3Upstream::response_empty() const { return false; }
 
 Downstream *
@@ -2035,7 +2066,14 @@ int Http3Upstream::http_acked_stream_data(Downstream *downstream,
 
   assert(datalen == drained);
 
-  if (downstream->resume_read(SHRPX_NO_BUFFER, datalen) != 0) {
+  // Backend is credited with the bytes it sent, which differ from
+  // what we send if response body is compressed.
+  auto consumed = downstream->get_response_compressed()
+                      ? downstream->drain_compressed_response_body(datalen)
+                      : datalen;
+
+  if (consumed > 0 &&
+      downstream->resume_read(SHRPX_NO_BUFFER, consumed) != 0) {
     return -1;
   }
 
@@ -38,6 +38,7 @@
 #include "shrpx_worker.h"
 #include "shrpx_http2_session.h"
 #include "shrpx_tls.h"
+#include "shrpx_splice_pipe.h"
 #include "shrpx_log.h"
 #include "http2.h"
 #include "util.h"
@@ -221,7 +222,9 @@ HttpDownstreamConnection::HttpDownstreamConnection(
       response_htp_{0},
       first_write_done_(false),
       reusable_(true),
-      request_header_written_(false) {}
+      request_header_written_(false),
+      idle_refresh_requested_(false),
+      splice_left_(0) {}
 
 HttpDownstreamConnection::~HttpDownstreamConnection() {
   if (LOG_ENABLED(INFO)) {
@@ -839,6 +842,10 @@ void idle_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
     return;
   }
 
+  if (dconn->refresh_idle()) {
+    return;
+  }
+
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, dconn) << "Idle connection timeout";
   }
@@ -848,29 +855,190 @@ void idle_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
 }
 } // namespace
 
+namespace {
+void prewarm_connect_timeoutcb(struct ev_loop *loop, ev_timer *w,
+                               int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+  auto addr = dconn->get_addr();
+  auto raddr = dconn->get_raddr();
+
+  DCLOG(WARN, dconn) << "Connect time out; addr="
+                     << util::to_numeric_addr(raddr);
+
+  downstream_failure(addr, raddr);
+
+  remove_from_pool(dconn);
+  // dconn was deleted
+}
+} // namespace
+
+namespace {
+void prewarm_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (w == &conn->rt && !conn->expired_rt()) {
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, dconn) << "Time out";
+  }
+
+  remove_from_pool(dconn);
+  // dconn was deleted
+}
+} // namespace
+
+namespace {
+void prewarm_connectcb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (dconn->prewarm_connected() != 0) {
+    remove_from_pool(dconn);
+    // dconn was deleted
+  }
+}
+} // namespace
+
+namespace {
+void prewarm_tls_handshakecb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (dconn->prewarm_tls_handshake() != 0) {
+    remove_from_pool(dconn);
+    // dconn was deleted
+  }
+}
+} // namespace
+
 void HttpDownstreamConnection::detach_downstream(Downstream *downstream) {
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, this) << "Detaching from DOWNSTREAM:" << downstream;
   }
   downstream_ = nullptr;
 
+  enter_idle();
+}
+
+void HttpDownstreamConnection::enter_idle() {
   ev_set_cb(&conn_.rev, idle_readcb);
   ioctrl_.force_resume_read();
 
   auto &downstreamconf = *worker_->get_downstream_config();
 
+  auto idle_read = downstreamconf.timeout.idle_read;
+  if (addr_->min_idle) {
+    // Leave time to replace this connection before it is timed out.
+    // See refresh_idle().
+    idle_read = idle_read * 3 / 4;
+  }
+
+  idle_refresh_requested_ = false;
+
   ev_set_cb(&conn_.rt, idle_timeoutcb);
-  if (conn_.read_timeout < downstreamconf.timeout.idle_read) {
-    conn_.read_timeout = downstreamconf.timeout.idle_read;
+  if (conn_.read_timeout < idle_read) {
+    conn_.read_timeout = idle_read;
     conn_.last_read = ev_now(conn_.loop);
   } else {
-    conn_.again_rt(downstreamconf.timeout.idle_read);
+    conn_.again_rt(idle_read);
   }
 
   conn_.wlimit.stopw();
   ev_timer_stop(conn_.loop, &conn_.wt);
 }
 
+bool HttpDownstreamConnection::refresh_idle() {
+  if (addr_->min_idle == 0 || idle_refresh_requested_ || group_->retired ||
+      worker_->get_graceful_shutdown()) {
+    return false;
+  }
+
+  idle_refresh_requested_ = true;
+
+  auto &downstreamconf = *worker_->get_downstream_config();
+
+  conn_.again_rt(downstreamconf.timeout.idle_read - conn_.read_timeout);
+
+  auto &dconn_pool = addr_->dconn_pool;
+
+  dconn_pool->retire_downstream_connection(this);
+
+  if (dconn_pool->size() + dconn_pool->num_prewarming_connections() <
+      addr_->min_idle) {
+    if (LOG_ENABLED(INFO)) {
+      DCLOG(INFO, this) << "Replace idle connection";
+    }
+
+    worker_->prewarm_http1_connection(group_, addr_);
+  }
+
+  return true;
+}
+
+int HttpDownstreamConnection::prewarm() {
+  assert(!addr_->dns);
+
+  auto rv = initiate_connection();
+  if (rv != 0) {
+    return rv;
+  }
+
+  ev_set_cb(&conn_.wev, prewarm_connectcb);
+  ev_set_cb(&conn_.wt, prewarm_connect_timeoutcb);
+
+  return 0;
+}
+
+int HttpDownstreamConnection::prewarm_connected() {
+  if (connected() != 0) {
+    return -1;
+  }
+
+  if (!conn_.tls.ssl) {
+    finish_prewarm();
+
+    return 0;
+  }
+
+  ev_set_cb(&conn_.wev, prewarm_tls_handshakecb);
+  ev_set_cb(&conn_.rev, prewarm_tls_handshakecb);
+  ev_set_cb(&conn_.rt, prewarm_timeoutcb);
+  ev_set_cb(&conn_.wt, prewarm_timeoutcb);
+
+  return prewarm_tls_handshake();
+}
+
+int HttpDownstreamConnection::prewarm_tls_handshake() {
+  if (tls_handshake() != 0) {
+    return -1;
+  }
+
+  if (!conn_.tls.initial_handshake_done) {
+    return 0;
+  }
+
+  finish_prewarm();
+
+  return 0;
+}
+
+void HttpDownstreamConnection::finish_prewarm() {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Prewarmed connection is ready";
+  }
+
+  ev_set_cb(&conn_.wev, writecb);
+  ev_set_cb(&conn_.wt, timeoutcb);
+
+  enter_idle();
+
+  addr_->dconn_pool->prewarming_done(this);
+}
+
 void HttpDownstreamConnection::pause_read(IOCtrlReason reason) {
   ioctrl_.pause_read(reason);
 }
@@ -935,6 +1103,7 @@ int htp_hdrs_completecb(llhttp_t *htp) {
 
   downstream->set_downstream_addr_group(dconn->get_downstream_addr_group());
   downstream->set_addr(dconn->get_addr());
+  downstream->observe_backend_latency();
 
   // Server MUST NOT send Transfer-Encoding with a status code 1xx or
   // 204.  Also server MUST NOT send Transfer-Encoding with a status
@@ -1011,6 +1180,8 @@ int htp_hdrs_completecb(llhttp_t *htp) {
     downstream->set_accesslog_written(true);
   }
 
+  downstream->on_backend_response_header();
+
   if (upstream->on_downstream_header_complete(downstream) != 0) {
     return -1;
   }
@@ -1136,6 +1307,9 @@ int htp_bodycb(llhttp_t *htp, const char *data, size_t len) {
 
   resp.recv_body_length += len;
 
+  downstream->on_backend_response_body(
+      reinterpret_cast<const uint8_t *>(data), len);
+
   return downstream->get_upstream()->on_downstream_body(
       downstream, reinterpret_cast<const uint8_t *>(data), len, true);
 }
@@ -1170,6 +1344,7 @@ int htp_msg_completecb(llhttp_t *htp) {
   // server. This callback is not called if the connection is
   // tunneled.
   downstream->pause_read(SHRPX_MSG_BLOCK);
+  downstream->on_backend_response_complete();
   return downstream->get_upstream()->on_downstream_body_complete(downstream);
 }
 } // namespace
@@ -1250,12 +1425,104 @@ int HttpDownstreamConnection::read_clear() {
       return rv;
     }
 
+    if (start_splice()) {
+      if (!ev_is_active(&conn_.rev)) {
+        return 0;
+      }
+
+      return read_splice();
+    }
+
     if (!ev_is_active(&conn_.rev)) {
       return 0;
     }
   }
 }
 
+bool HttpDownstreamConnection::start_splice() {
+  // Only fixed length response body is forwarded with splice(2).
+  // Chunked response body has chunk framing interleaved, which must
+  // be parsed.
+  if (downstream_->get_response_state() != DownstreamState::HEADER_COMPLETE ||
+      downstream_->get_response_pipe() ||
+      (response_htp_.flags & (F_CONTENT_LENGTH | F_CHUNKED)) !=
+          F_CONTENT_LENGTH ||
+      response_htp_.content_length == 0 || !conn_.splice_read_supported()) {
+    return false;
+  }
+
+  if (!downstream_->start_response_splice()) {
+    return false;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Forward " << response_htp_.content_length
+                      << " bytes of response body with splice";
+  }
+
+  splice_left_ = response_htp_.content_length;
+  on_read_ = &HttpDownstreamConnection::read_splice;
+
+  return true;
+}
+
+int HttpDownstreamConnection::read_splice() {
+  conn_.last_read = ev_now(conn_.loop);
+
+  auto pipe = downstream_->get_response_pipe();
+  auto &resp = downstream_->response();
+  auto handler = downstream_->get_upstream()->get_client_handler();
+
+  for (;;) {
+    auto nread = conn_.splice_read(*pipe, splice_left_);
+    if (nread == 0) {
+      // splice(2) returns EAGAIN if the pipe has no room even if
+      // socket has data.  Wait for frontend to drain the pipe.
+      if (pipe->len) {
+        downstream_->pause_read(SHRPX_NO_BUFFER);
+      }
+
+      return 0;
+    }
+
+    if (nread < 0) {
+      if (nread == SHRPX_ERR_EOF) {
+        if (LOG_ENABLED(INFO)) {
+          DCLOG(INFO, this) << "HTTP response ended prematurely";
+        }
+
+        return -1;
+      }
+
+      return nread;
+    }
+
+    splice_left_ -= nread;
+    resp.recv_body_length += nread;
+
+    handler->signal_write();
+
+    if (splice_left_ == 0) {
+      return finish_splice();
+    }
+  }
+}
+
+int HttpDownstreamConnection::finish_splice() {
+  on_read_ = &HttpDownstreamConnection::read_clear;
+
+  // llhttp has not seen the body forwarded with splice(2).  Start
+  // from scratch for the next response.
+  llhttp_init(&response_htp_, HTTP_RESPONSE, &htp_hooks);
+  response_htp_.data = downstream_;
+
+  if (htp_msg_completecb(&response_htp_) != 0) {
+    return -1;
+  }
+
+  return 0;
+}
+
 int HttpDownstreamConnection::write_clear() {
   conn_.last_read = ev_now(conn_.loop);
 
@@ -1343,6 +1610,11 @@ int HttpDownstreamConnection::tls_handshake() {
 
   // TODO Check negotiated ALPN
 
+  if (!downstream_) {
+    // This connection is being prewarmed.
+    return 0;
+  }
+
   return on_write();
 }
 
@@ -1580,6 +1852,20 @@ HttpDownstreamConnection::get_downstream_addr_group() const {
 
 DownstreamAddr *HttpDownstreamConnection::get_addr() const { return addr_; }
 
+void HttpDownstreamConnection::rebind(
+    const std::shared_ptr<DownstreamAddrGroup> &group, DownstreamAddr *addr) {
+  if (raddr_ == &addr_->addr) {
+    raddr_ = &addr->addr;
+  }
+
+  if (conn_.tls.client_session_cache == &addr_->tls_session_cache) {
+    conn_.tls.client_session_cache = &addr->tls_session_cache;
+  }
+
+  group_ = group;
+  addr_ = addr;
+}
+
 bool HttpDownstreamConnection::poolable() const {
   return !group_->retired && reusable_;
 }
@@ -69,14 +69,31 @@ public:
   virtual const std::shared_ptr<DownstreamAddrGroup> &
   get_downstream_addr_group() const;
   virtual DownstreamAddr *get_addr() const;
+  virtual void rebind(const std::shared_ptr<DownstreamAddrGroup> &group,
+                      DownstreamAddr *addr);
 
   int initiate_connection();
 
+  // Establishes a connection to the backend without Downstream.  The
+  // connection is handed over to addr->dconn_pool when it is ready.
+  // The caller must add this object to addr->dconn_pool with
+  // add_prewarming_connection() if this function returns 0.
+  int prewarm();
+  int prewarm_connected();
+  int prewarm_tls_handshake();
+  // Keeps this idle connection a while longer as a retired one, and
+  // starts establishing its replacement if addr->dconn_pool falls
+  // below min-idle.  This function returns true if this connection
+  // should not be closed yet.
+  bool refresh_idle();
+
   int write_first();
   int read_clear();
   int write_clear();
   int read_tls();
   int write_tls();
+  // Reads response body from backend into the pipe with splice(2).
+  int read_splice();
 
   int process_input(const uint8_t *data, size_t datalen);
   int tls_handshake();
@@ -93,6 +110,13 @@ public:
   int process_blocked_request_buf();
 
 private:
+  void enter_idle();
+  void finish_prewarm();
+  // Switches to read the rest of response body with splice(2) if the
+  // response is eligible.  Returns true if it is switched.
+  bool start_splice();
+  int finish_splice();
+
   Connection conn_;
   std::function<int(HttpDownstreamConnection &)> on_read_, on_write_,
       signal_write_;
@@ -117,6 +141,12 @@ private:
   bool reusable_;
   // true if request header is written to request buffer.
   bool request_header_written_;
+  // true if refresh_idle() has started the replacement of this idle
+  // connection.
+  bool idle_refresh_requested_;
+  // The number of bytes of response body left to read with
+  // splice(2).
+  uint64_t splice_left_;
 };
 
 } // namespace shrpx
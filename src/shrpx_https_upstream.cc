@@ -36,6 +36,7 @@
 #include "shrpx_error.h"
 #include "shrpx_log_config.h"
 #include "shrpx_worker.h"
+#include "shrpx_splice_pipe.h"
 #include "shrpx_http2_session.h"
 #include "shrpx_log.h"
 #ifdef HAVE_MRUBY
@@ -739,6 +740,11 @@ int HttpsUpstream::on_write() {
     return 0;
   }
 
+  auto pipe = downstream->get_response_pipe();
+  if (pipe && pipe->len > 0) {
+    return 0;
+  }
+
   // We need to postpone detachment until all data are sent so that
   // we can notify nghttp2 library all data consumed.
   if (downstream->get_response_state() == DownstreamState::MSG_COMPLETE) {
@@ -1168,6 +1174,8 @@ int HttpsUpstream::on_downstream_header_complete(Downstream *downstream) {
     return 0;
   }
 
+  downstream->start_response_compression();
+
   auto build_flags = (http2::HDOP_STRIP_ALL & ~http2::HDOP_STRIP_VIA) |
                      (!http2::legacy_http1(req.http_major, req.http_minor)
                           ? 0
@@ -1302,12 +1310,9 @@ int HttpsUpstream::on_downstream_header_complete(Downstream *downstream) {
   return 0;
 }
 
-int HttpsUpstream::on_downstream_body(Downstream *downstream,
-                                      const uint8_t *data, size_t len,
-                                      bool flush) {
-  if (len == 0) {
-    return 0;
-  }
+namespace {
+void write_response_body(Downstream *downstream, const uint8_t *data,
+                         size_t len) {
   auto output = downstream->get_response_buf();
   if (downstream->get_chunked_response()) {
     output->append(util::utox(len));
@@ -1320,6 +1325,46 @@ int HttpsUpstream::on_downstream_body(Downstream *downstream,
   if (downstream->get_chunked_response()) {
     output->append("\r\n");
   }
+}
+} // namespace
+
+namespace {
+// Compresses |data| of length |len|, and writes the output as
+// response body.  If |finish| is true, the end of compressed stream
+// is written.  Returns 0 if it succeeds, or -1.
+int write_compressed_response_body(Downstream *downstream,
+                                   MemchunkPool *mcpool, const uint8_t *data,
+                                   size_t len, bool finish) {
+  DefaultMemchunks buf(mcpool);
+
+  if (downstream->compress_response_body(buf, data, len, finish) < 0) {
+    return -1;
+  }
+
+  for (auto m = buf.head; m; m = m->next) {
+    if (m->len()) {
+      write_response_body(downstream, m->pos, m->len());
+    }
+  }
+
+  return 0;
+}
+} // namespace
+
+int HttpsUpstream::on_downstream_body(Downstream *downstream,
+                                      const uint8_t *data, size_t len,
+                                      bool flush) {
+  if (len == 0) {
+    return 0;
+  }
+
+  if (downstream->get_response_compressed()) {
+    return write_compressed_response_body(
+        downstream, handler_->get_mcpool(), data, len, false);
+  }
+
+  write_response_body(downstream, data, len);
+
   return 0;
 }
 
@@ -1327,6 +1372,12 @@ int HttpsUpstream::on_downstream_body_complete(Downstream *downstream) {
   const auto &req = downstream->request();
   auto &resp = downstream->response();
 
+  if (downstream->get_response_compressed() &&
+      write_compressed_response_body(downstream, handler_->get_mcpool(),
+                                     nullptr, 0, true) != 0) {
+    return -1;
+  }
+
   if (downstream->get_chunked_response()) {
     auto output = downstream->get_response_buf();
     const auto &trailers = resp.fs.trailers();
@@ -1516,6 +1567,16 @@ void HttpsUpstream::response_drain(size_t n) {
   buf->drain(n);
 }
 
+void HttpsUpstream::response_drain(size_t n, DefaultMemchunks &pinned) {
+  if (!downstream_) {
+    return;
+  }
+
+  auto buf = downstream_->get_response_buf();
+
+  buf->drain_pin(n, pinned);
+}
+
 bool HttpsUpstream::response_empty() const {
   if (!downstream_) {
     return true;
@@ -1523,7 +1584,38 @@ bool HttpsUpstream::response_empty() const {
 
   auto buf = downstream_->get_response_buf();
 
-  return buf->rleft() == 0;
+  if (buf->rleft()) {
+    return false;
+  }
+
+  auto pipe = downstream_->get_response_pipe();
+
+  return !pipe || pipe->len == 0;
+}
+
+bool HttpsUpstream::response_splice_enabled(
+    const Downstream *downstream) const {
+  return get_config()->http.splice && downstream == downstream_.get() &&
+         handler_->get_connection()->splice_write_supported();
+}
+
+SplicePipe *HttpsUpstream::response_pipe() const {
+  if (!downstream_) {
+    return nullptr;
+  }
+
+  auto pipe = downstream_->get_response_pipe();
+  if (!pipe || pipe->len == 0) {
+    return nullptr;
+  }
+
+  return pipe;
+}
+
+void HttpsUpstream::response_pipe_drain(size_t n) {
+  assert(downstream_);
+
+  downstream_->response_sent_body_length += n;
 }
 
 Downstream *
@@ -81,7 +81,11 @@ public:
   virtual int initiate_push(Downstream *downstream, const StringRef &uri);
   virtual int response_riovec(struct iovec *iov, int iovcnt) const;
   virtual void response_drain(size_t n);
+  virtual void response_drain(size_t n, DefaultMemchunks &pinned);
   virtual bool response_empty() const;
+  virtual bool response_splice_enabled(const Downstream *downstream) const;
+  virtual SplicePipe *response_pipe() const;
+  virtual void response_pipe_drain(size_t n);
 
   virtual Downstream *on_downstream_push_promise(Downstream *downstream,
                                                  int32_t promised_stream_id);
@@ -0,0 +1,1022 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_io_uring.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>
+#endif // HAVE_SYS_SOCKET_H
+#include <sys/mman.h>
+#ifdef HAVE_LINUX_IO_URING_H
+#  include <sys/syscall.h>
+#  include <sys/eventfd.h>
+#  include <linux/io_uring.h>
+#endif // HAVE_LINUX_IO_URING_H
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include "shrpx_connection.h"
+#include "shrpx_log.h"
+
+// Multishot receive, and provided buffer ring are available since
+// Linux 6.0.
+#if defined(HAVE_LINUX_IO_URING_H) && defined(IORING_RECV_MULTISHOT) &&     \
+    defined(__NR_io_uring_setup)
+#  define SHRPX_IO_URING 1
+#endif
+
+namespace shrpx {
+
+namespace {
+// The number of entries in the submission queue.  The completion
+// queue has twice as many.
+constexpr uint32_t IO_URING_ENTRIES = 4096;
+// The number of provided buffers for reads, and the size of each
+// buffer.  The buffers are given back to the kernel before the event
+// loop polls, so they are shared by all connections of the ring.
+constexpr uint16_t IO_URING_BUF_COUNT = 256;
+constexpr uint32_t IO_URING_BUF_SIZE = 16_k;
+// Buffer group ID of the provided buffers.
+constexpr uint16_t IO_URING_BGID = 0;
+// Multishot receive is canceled if this many bytes are received, but
+// not read by Connection.  It is requested again when the data is
+// read.
+constexpr size_t IO_URING_READ_BUFFER_LIMIT = 64_k;
+// The maximum number of bytes sent by one writev request.
+constexpr size_t IO_URING_WRITE_BUFFER_LIMIT = 64_k;
+} // namespace
+
+#ifdef SHRPX_IO_URING
+namespace {
+int io_uring_setup(uint32_t entries, io_uring_params *p) {
+  return syscall(__NR_io_uring_setup, entries, p);
+}
+} // namespace
+
+namespace {
+int io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+                   uint32_t flags) {
+  return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                 nullptr, 0);
+}
+} // namespace
+
+namespace {
+int io_uring_register(int fd, uint32_t opcode, const void *arg,
+                      uint32_t nr_args) {
+  return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+} // namespace
+#endif // SHRPX_IO_URING
+
+namespace {
+void eventfdcb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto ring = static_cast<IOUring *>(w->data);
+
+  uint64_t n;
+  while (read(w->fd, &n, sizeof(n)) == -1 && errno == EINTR)
+    ;
+
+  ring->handle_completions();
+}
+} // namespace
+
+namespace {
+void preparecb(struct ev_loop *loop, ev_prepare *w, int revents) {
+  auto ring = static_cast<IOUring *>(w->data);
+
+  ring->submit();
+}
+} // namespace
+
+IOUring::IOUring(struct ev_loop *loop)
+    : loop_(loop),
+      ring_(nullptr),
+      ring_size_(0),
+      sqes_(nullptr),
+      sqes_size_(0),
+      buf_ring_(nullptr),
+      buf_ring_size_(0),
+      bufs_(nullptr),
+      sq_head_(nullptr),
+      sq_tail_(nullptr),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cqes_(nullptr),
+      sq_mask_(0),
+      sq_entries_(0),
+      cq_mask_(0),
+      sqe_tail_(0),
+      buf_ring_tail_(0),
+      fd_(-1),
+      eventfd_(-1) {
+  ev_io_init(&eventfd_rev_, eventfdcb, 0, EV_READ);
+  eventfd_rev_.data = this;
+
+  ev_prepare_init(&prep_, preparecb);
+  prep_.data = this;
+}
+
+IOUring::~IOUring() {
+  if (ev_is_active(&eventfd_rev_)) {
+    // Balance ev_unref in init().
+    ev_ref(loop_);
+    ev_io_stop(loop_, &eventfd_rev_);
+  }
+  if (ev_is_active(&prep_)) {
+    ev_ref(loop_);
+    ev_prepare_stop(loop_, &prep_);
+  }
+
+  // Closing io_uring cancels all requests in flight.
+  if (fd_ != -1) {
+    close(fd_);
+  }
+  if (eventfd_ != -1) {
+    close(eventfd_);
+  }
+
+  while (!orphans_.empty()) {
+    auto sock = orphans_.head;
+    orphans_.remove(sock);
+    delete sock;
+  }
+
+  if (ring_) {
+    munmap(ring_, ring_size_);
+  }
+  if (sqes_) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (buf_ring_) {
+    munmap(buf_ring_, buf_ring_size_);
+  }
+  if (bufs_) {
+    munmap(bufs_, IO_URING_BUF_COUNT * IO_URING_BUF_SIZE);
+  }
+}
+
+#ifdef SHRPX_IO_URING
+int IOUring::init() {
+  io_uring_params params{};
+
+  fd_ = io_uring_setup(IO_URING_ENTRIES, &params);
+  if (fd_ == -1) {
+    auto error = errno;
+    LOG(WARN) << "io_uring_setup() failed: errno=" << error;
+    return -1;
+  }
+
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+    LOG(WARN) << "io_uring: single mmap is not supported";
+    return -1;
+  }
+
+  ring_size_ =
+      std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+               params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+
+  auto p = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (p == MAP_FAILED) {
+    auto error = errno;
+    LOG(WARN) << "io_uring: mmap() failed: errno=" << error;
+    return -1;
+  }
+
+  ring_ = static_cast<uint8_t *>(p);
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+  p = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (p == MAP_FAILED) {
+    auto error = errno;
+    LOG(WARN) << "io_uring: mmap() failed: errno=" << error;
+    return -1;
+  }
+
+  sqes_ = p;
+
+  sq_head_ = reinterpret_cast<uint32_t *>(ring_ + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32_t *>(ring_ + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<uint32_t *>(ring_ + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sqe_tail_ = *sq_tail_;
+
+  // Submission queue entries are used in order.
+  auto sq_array = reinterpret_cast<uint32_t *>(ring_ + params.sq_off.array);
+  for (uint32_t i = 0; i < sq_entries_; ++i) {
+    sq_array[i] = i;
+  }
+
+  cq_head_ = reinterpret_cast<uint32_t *>(ring_ + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t *>(ring_ + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<uint32_t *>(ring_ + params.cq_off.ring_mask);
+  cqes_ = ring_ + params.cq_off.cqes;
+
+  buf_ring_size_ = IO_URING_BUF_COUNT * sizeof(io_uring_buf);
+
+  p = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    buf_ring_size_ = 0;
+    auto error = errno;
+    LOG(WARN) << "io_uring: mmap() failed: errno=" << error;
+    return -1;
+  }
+
+  buf_ring_ = p;
+
+  p = mmap(nullptr, IO_URING_BUF_COUNT * IO_URING_BUF_SIZE,
+           PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    auto error = errno;
+    LOG(WARN) << "io_uring: mmap() failed: errno=" << error;
+    return -1;
+  }
+
+  bufs_ = static_cast<uint8_t *>(p);
+
+  io_uring_buf_reg reg{};
+  reg.ring_addr = reinterpret_cast<uintptr_t>(buf_ring_);
+  reg.ring_entries = IO_URING_BUF_COUNT;
+  reg.bgid = IO_URING_BGID;
+
+  if (io_uring_register(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+    auto error = errno;
+    LOG(WARN) << "io_uring: provided buffer ring is not supported: errno="
+              << error;
+    return -1;
+  }
+
+  for (uint16_t bid = 0; bid < IO_URING_BUF_COUNT; ++bid) {
+    recycle_buffer(static_cast<uint32_t>(bid) << IORING_CQE_BUFFER_SHIFT |
+                   IORING_CQE_F_BUFFER);
+  }
+
+  if (probe_recv_multishot() != 0) {
+    LOG(WARN) << "io_uring: multishot receive is not supported";
+    return -1;
+  }
+
+  eventfd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (eventfd_ == -1) {
+    auto error = errno;
+    LOG(WARN) << "eventfd() failed: errno=" << error;
+    return -1;
+  }
+
+  if (io_uring_register(fd_, IORING_REGISTER_EVENTFD, &eventfd_, 1) == -1) {
+    auto error = errno;
+    LOG(WARN) << "io_uring: could not register eventfd: errno=" << error;
+    return -1;
+  }
+
+  ev_io_set(&eventfd_rev_, eventfd_, EV_READ);
+  ev_io_start(loop_, &eventfd_rev_);
+  ev_prepare_start(loop_, &prep_);
+
+  // These watchers are always active.  They must not prevent the
+  // event loop from exiting on graceful shutdown.
+  ev_unref(loop_);
+  ev_unref(loop_);
+
+  return 0;
+}
+#else  // !SHRPX_IO_URING
+int IOUring::init() {
+  LOG(WARN) << "io_uring is not supported on this platform";
+  return -1;
+}
+#endif // !SHRPX_IO_URING
+
+#ifdef SHRPX_IO_URING
+int IOUring::probe_recv_multishot() {
+  // Older kernels accept the request, but reject the multishot flag
+  // on completion.  Receive 1 byte through socketpair to see whether
+  // the request stays armed.
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == -1) {
+    return -1;
+  }
+
+  auto fd_closer = defer([&sv] {
+    close(sv[0]);
+    close(sv[1]);
+  });
+
+  IOUringOp op{};
+
+  if (recv_multishot(sv[0], &op) != 0 || write(sv[1], "", 1) != 1) {
+    return -1;
+  }
+
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+
+  if (io_uring_enter(fd_, 1, 1, IORING_ENTER_GETEVENTS) != 1) {
+    return -1;
+  }
+
+  auto rv = -1;
+  auto head = *cq_head_;
+  auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+  for (; head != tail; ++head) {
+    auto cqe = &static_cast<io_uring_cqe *>(cqes_)[head & cq_mask_];
+    if (cqe->res == 1 && (cqe->flags & IORING_CQE_F_MORE)) {
+      rv = 0;
+    }
+    recycle_buffer(cqe->flags);
+  }
+
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+  if (rv != 0) {
+    return -1;
+  }
+
+  // Wait for the final completion so that |op| is no longer used.
+  if (cancel(&op) != 0) {
+    return -1;
+  }
+
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+
+  for (;;) {
+    if (io_uring_enter(fd_, sqe_tail_ - *sq_head_, 1,
+                       IORING_ENTER_GETEVENTS) == -1 &&
+        errno != EINTR) {
+      return -1;
+    }
+
+    head = *cq_head_;
+    tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+    auto done = false;
+
+    for (; head != tail; ++head) {
+      auto cqe = &static_cast<io_uring_cqe *>(cqes_)[head & cq_mask_];
+      recycle_buffer(cqe->flags);
+      if (cqe->user_data == reinterpret_cast<uintptr_t>(&op) &&
+          !(cqe->flags & IORING_CQE_F_MORE)) {
+        done = true;
+      }
+    }
+
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+    if (done) {
+      return 0;
+    }
+  }
+}
+
+void *IOUring::get_sqe() {
+  if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+    enter();
+
+    if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >=
+        sq_entries_) {
+      return nullptr;
+    }
+  }
+
+  auto sqe = &static_cast<io_uring_sqe *>(sqes_)[sqe_tail_ & sq_mask_];
+  ++sqe_tail_;
+
+  memset(sqe, 0, sizeof(*sqe));
+
+  return sqe;
+}
+
+int IOUring::accept_multishot(int fd, IOUringOp *op) {
+  auto sqe = static_cast<io_uring_sqe *>(get_sqe());
+  if (!sqe) {
+    return -1;
+  }
+
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = reinterpret_cast<uintptr_t>(op);
+
+  return 0;
+}
+
+int IOUring::recv_multishot(int fd, IOUringOp *op) {
+  auto sqe = static_cast<io_uring_sqe *>(get_sqe());
+  if (!sqe) {
+    return -1;
+  }
+
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = IO_URING_BGID;
+  sqe->user_data = reinterpret_cast<uintptr_t>(op);
+
+  return 0;
+}
+
+int IOUring::writev(int fd, const struct iovec *iov, int iovcnt,
+                    IOUringOp *op) {
+  auto sqe = static_cast<io_uring_sqe *>(get_sqe());
+  if (!sqe) {
+    return -1;
+  }
+
+  sqe->opcode = IORING_OP_WRITEV;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uintptr_t>(iov);
+  sqe->len = iovcnt;
+  sqe->user_data = reinterpret_cast<uintptr_t>(op);
+
+  return 0;
+}
+
+int IOUring::cancel(IOUringOp *op) {
+  auto sqe = static_cast<io_uring_sqe *>(get_sqe());
+  if (!sqe) {
+    return -1;
+  }
+
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = reinterpret_cast<uintptr_t>(op);
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+  // The completion of cancellation itself is ignored.
+  sqe->user_data = 0;
+
+  return 0;
+}
+
+const uint8_t *IOUring::get_buffer(uint32_t flags) const {
+  if (!(flags & IORING_CQE_F_BUFFER)) {
+    return nullptr;
+  }
+
+  return bufs_ + (flags >> IORING_CQE_BUFFER_SHIFT) * IO_URING_BUF_SIZE;
+}
+
+void IOUring::recycle_buffer(uint32_t flags) {
+  if (!(flags & IORING_CQE_F_BUFFER)) {
+    return;
+  }
+
+  auto bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+  // struct io_uring_buf_ring is not usable in C++ because its
+  // flexible array member is not placed at offset 0.  The ring is an
+  // array of struct io_uring_buf, and its tail overlays the resv
+  // field of the first entry.
+  auto ring = static_cast<io_uring_buf *>(buf_ring_);
+  auto buf = &ring[buf_ring_tail_ & (IO_URING_BUF_COUNT - 1)];
+
+  buf->addr = reinterpret_cast<uintptr_t>(bufs_ + bid * IO_URING_BUF_SIZE);
+  buf->len = IO_URING_BUF_SIZE;
+  buf->bid = bid;
+
+  __atomic_store_n(&ring[0].resv, ++buf_ring_tail_, __ATOMIC_RELEASE);
+}
+
+void IOUring::submit() {
+  if (!release_queue_.empty()) {
+    auto q = std::move(release_queue_);
+    release_queue_.clear();
+
+    for (auto sock : q) {
+      sock->release_buffers();
+    }
+  }
+
+  if (!write_queue_.empty()) {
+    auto q = std::move(write_queue_);
+    write_queue_.clear();
+
+    for (auto sock : q) {
+      sock->submit_write();
+    }
+  }
+
+  enter();
+}
+
+void IOUring::enter() {
+  for (;;) {
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+
+    auto to_submit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (to_submit == 0) {
+      return;
+    }
+
+    if (io_uring_enter(fd_, to_submit, 0, 0) != -1) {
+      return;
+    }
+
+    switch (errno) {
+    case EINTR:
+      continue;
+    case EAGAIN:
+    case EBUSY:
+      // The completion queue is full.  The rest is submitted after
+      // the completions are processed.
+      return;
+    default: {
+      auto error = errno;
+      LOG(ERROR) << "io_uring_enter() failed: errno=" << error;
+      return;
+    }
+    }
+  }
+}
+
+void IOUring::handle_completions() {
+  auto head = *cq_head_;
+
+  for (;;) {
+    auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      return;
+    }
+
+    auto cqe = &static_cast<io_uring_cqe *>(cqes_)[head & cq_mask_];
+    auto op = reinterpret_cast<IOUringOp *>(cqe->user_data);
+    auto res = cqe->res;
+    auto flags = cqe->flags;
+
+    // Release the entry before the callback which may submit new
+    // requests.
+    __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+
+    if (op) {
+      op->cb(op, res, flags);
+    } else {
+      recycle_buffer(flags);
+    }
+  }
+}
+
+bool IOUring::more(uint32_t flags) { return flags & IORING_CQE_F_MORE; }
+#else  // !SHRPX_IO_URING
+int IOUring::probe_recv_multishot() { return -1; }
+
+void *IOUring::get_sqe() { return nullptr; }
+
+int IOUring::accept_multishot(int fd, IOUringOp *op) { return -1; }
+
+int IOUring::recv_multishot(int fd, IOUringOp *op) { return -1; }
+
+int IOUring::writev(int fd, const struct iovec *iov, int iovcnt,
+                    IOUringOp *op) {
+  return -1;
+}
+
+int IOUring::cancel(IOUringOp *op) { return -1; }
+
+const uint8_t *IOUring::get_buffer(uint32_t flags) const { return nullptr; }
+
+void IOUring::recycle_buffer(uint32_t flags) {}
+
+void IOUring::submit() {}
+
+void IOUring::enter() {}
+
+void IOUring::handle_completions() {}
+
+bool IOUring::more(uint32_t flags) { return false; }
+#endif // !SHRPX_IO_URING
+
+void IOUring::queue_write(IOUringSocket *sock) { write_queue_.push_back(sock); }
+
+void IOUring::queue_release(IOUringSocket *sock) {
+  release_queue_.push_back(sock);
+}
+
+void IOUring::add_orphan(IOUringSocket *sock) { orphans_.append(sock); }
+
+void IOUring::remove_orphan(IOUringSocket *sock) { orphans_.remove(sock); }
+
+struct ev_loop *IOUring::get_loop() const { return loop_; }
+
+namespace {
+void recvcb(IOUringOp *op, int32_t res, uint32_t flags) {
+  auto sock = static_cast<IOUringSocket *>(op->data);
+
+  sock->on_recv(res, flags);
+}
+} // namespace
+
+namespace {
+void writecb(IOUringOp *op, int32_t res, uint32_t flags) {
+  auto sock = static_cast<IOUringSocket *>(op->data);
+
+  sock->on_write(res);
+}
+} // namespace
+
+namespace {
+void lingercb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto sock = static_cast<IOUringSocket *>(w->data);
+
+  sock->on_linger_timeout();
+}
+} // namespace
+
+IOUringSocket::IOUringSocket(IOUring *ring, Connection *conn,
+                             MemchunkPool *mcpool)
+    : dlprev(nullptr),
+      dlnext(nullptr),
+      rbuf_(mcpool),
+      pinned_(mcpool),
+      recv_op_{recvcb, this},
+      write_op_{writecb, this},
+      ring_(ring),
+      conn_(conn),
+      recvlen_(0),
+      wiovcnt_(0),
+      wlen_(0),
+      fd_(conn->fd),
+      recv_armed_(false),
+      recv_canceled_(false),
+      eof_(false),
+      read_error_(false),
+      release_queued_(false),
+      write_queued_(false),
+      write_submitted_(false),
+      write_inflight_(false),
+      write_error_(false) {
+  ev_timer_init(&linger_timer_, lingercb, 0., 0.);
+  linger_timer_.data = this;
+}
+
+IOUringSocket::~IOUringSocket() {
+  ev_timer_stop(ring_->get_loop(), &linger_timer_);
+
+  shutdown(fd_, SHUT_WR);
+  close(fd_);
+}
+
+void IOUringSocket::start() { arm_recv(); }
+
+void IOUringSocket::arm_recv() {
+  if (ring_->recv_multishot(fd_, &recv_op_) != 0) {
+    read_error_ = true;
+    return;
+  }
+
+  recv_armed_ = true;
+}
+
+void IOUringSocket::cancel_recv() {
+  if (!recv_armed_ || recv_canceled_) {
+    return;
+  }
+
+  if (ring_->cancel(&recv_op_) != 0) {
+    return;
+  }
+
+  recv_canceled_ = true;
+}
+
+ssize_t IOUringSocket::read(void *data, size_t len) {
+  if (rleft() == 0) {
+    if (read_error_) {
+      return SHRPX_ERR_NETWORK;
+    }
+    if (eof_) {
+      return SHRPX_ERR_EOF;
+    }
+    return 0;
+  }
+
+  // rbuf_ has the data received before recvbufs_.
+  auto nread = rbuf_.remove(data, len);
+  auto p = static_cast<uint8_t *>(data) + nread;
+
+  len -= nread;
+
+  while (len && !recvbufs_.empty()) {
+    auto &buf = recvbufs_.front();
+    auto n = std::min(len, buf.len);
+
+    p = std::copy_n(buf.pos, n, p);
+    buf.pos += n;
+    buf.len -= n;
+    recvlen_ -= n;
+    len -= n;
+    nread += n;
+
+    if (buf.len) {
+      break;
+    }
+
+    ring_->recycle_buffer(buf.flags);
+    recvbufs_.pop_front();
+  }
+
+  if (!recv_armed_ && !eof_ && !read_error_ &&
+      rleft() < IO_URING_READ_BUFFER_LIMIT) {
+    arm_recv();
+  }
+
+  // Connection reads one chunk per callback.  Keep it reading as
+  // level-triggered readiness does.
+  if (read_pending() && ev_is_active(&conn_->rev)) {
+    ev_feed_event(conn_->loop, &conn_->rev, EV_READ);
+  }
+
+  return nread;
+}
+
+size_t IOUringSocket::rleft() const { return rbuf_.rleft() + recvlen_; }
+
+bool IOUringSocket::read_pending() const {
+  return rleft() || eof_ || read_error_;
+}
+
+ssize_t IOUringSocket::writev(const struct iovec *iov, int iovcnt) {
+  if (write_error_) {
+    return SHRPX_ERR_NETWORK;
+  }
+
+  if (write_submitted_ || wlen_ >= IO_URING_WRITE_BUFFER_LIMIT ||
+      wiovcnt_ == wiov_.size()) {
+    // on_write() resumes writing.
+    if (!ev_is_active(&conn_->wt)) {
+      ev_timer_again(conn_->loop, &conn_->wt);
+    }
+    return 0;
+  }
+
+  size_t nwrite = 0;
+
+  for (int i = 0; i < iovcnt && wiovcnt_ < wiov_.size(); ++i) {
+    auto n = std::min(iov[i].iov_len, IO_URING_WRITE_BUFFER_LIMIT - wlen_);
+    if (n == 0) {
+      break;
+    }
+
+    wiov_[wiovcnt_++] = {iov[i].iov_base, n};
+    wlen_ += n;
+    nwrite += n;
+
+    if (n < iov[i].iov_len) {
+      break;
+    }
+  }
+
+  if (nwrite && !write_queued_) {
+    write_queued_ = true;
+    ring_->queue_write(this);
+  }
+
+  return nwrite;
+}
+
+void IOUringSocket::pin(DefaultMemchunks bufs) {
+  if (wiovcnt_ == 0 && !write_inflight_) {
+    return;
+  }
+
+  bufs.remove(pinned_);
+}
+
+bool IOUringSocket::write_pending() const {
+  return !write_error_ && wiovcnt_;
+}
+
+void IOUringSocket::reset_write() {
+  wiovcnt_ = 0;
+  wlen_ = 0;
+  write_submitted_ = false;
+  pinned_.reset();
+}
+
+void IOUringSocket::submit_write() {
+  write_queued_ = false;
+
+  if (write_inflight_ || write_error_ || wiovcnt_ == 0) {
+    maybe_delete();
+    return;
+  }
+
+  if (ring_->writev(fd_, wiov_.data(), wiovcnt_, &write_op_) != 0) {
+    write_error_ = true;
+    reset_write();
+
+    if (!conn_) {
+      maybe_delete();
+      return;
+    }
+
+    ev_feed_event(conn_->loop, &conn_->wev, EV_WRITE);
+
+    return;
+  }
+
+  write_submitted_ = true;
+  write_inflight_ = true;
+
+  if (conn_ && !ev_is_active(&conn_->wt)) {
+    ev_timer_again(conn_->loop, &conn_->wt);
+  }
+}
+
+void IOUringSocket::release_buffers() {
+  release_queued_ = false;
+
+  for (auto &buf : recvbufs_) {
+    if (conn_) {
+      rbuf_.append(buf.pos, buf.len);
+    }
+    ring_->recycle_buffer(buf.flags);
+  }
+
+  recvbufs_.clear();
+  recvlen_ = 0;
+
+  if (!conn_) {
+    maybe_delete();
+  }
+}
+
+void IOUringSocket::on_recv(int32_t res, uint32_t flags) {
+  if (res > 0 && conn_) {
+    // Connection reads the data from the buffer directly.
+    recvbufs_.push_back({ring_->get_buffer(flags), static_cast<size_t>(res),
+                         flags});
+    recvlen_ += res;
+
+    if (!release_queued_) {
+      release_queued_ = true;
+      ring_->queue_release(this);
+    }
+  } else {
+    ring_->recycle_buffer(flags);
+  }
+
+  if (!IOUring::more(flags)) {
+    recv_armed_ = false;
+    recv_canceled_ = false;
+
+    if (res == 0) {
+      eof_ = true;
+    } else if (res < 0 && res != -ENOBUFS && res != -ECANCELED) {
+      read_error_ = true;
+    }
+  }
+
+  if (!conn_) {
+    maybe_delete();
+    return;
+  }
+
+  if (rleft() >= IO_URING_READ_BUFFER_LIMIT) {
+    // Stop receiving until Connection reads the buffered data.
+    cancel_recv();
+  } else if (!recv_armed_ && !eof_ && !read_error_) {
+    // The request ends when the provided buffers run out.
+    arm_recv();
+  }
+
+  if (read_pending() && ev_is_active(&conn_->rev)) {
+    ev_feed_event(conn_->loop, &conn_->rev, EV_READ);
+  }
+}
+
+void IOUringSocket::on_write(int32_t res) {
+  write_inflight_ = false;
+
+  if (res <= 0 || write_error_) {
+    write_error_ = true;
+    reset_write();
+  } else {
+    wlen_ -= res;
+
+    if (wlen_ == 0) {
+      // The kernel no longer reads the pinned buffers.
+      reset_write();
+    } else {
+      // Send the rest.
+      auto n = static_cast<size_t>(res);
+      auto it = std::begin(wiov_);
+
+      for (; n >= it->iov_len; ++it) {
+        n -= it->iov_len;
+      }
+
+      it->iov_base = static_cast<uint8_t *>(it->iov_base) + n;
+      it->iov_len -= n;
+
+      wiovcnt_ = std::copy(it, std::begin(wiov_) + wiovcnt_,
+                           std::begin(wiov_)) -
+                 std::begin(wiov_);
+
+      if (!write_queued_) {
+        write_queued_ = true;
+        ring_->queue_write(this);
+      }
+    }
+  }
+
+  if (!conn_) {
+    maybe_delete();
+    return;
+  }
+
+  if (res > 0 && ev_is_active(&conn_->wt)) {
+    ev_timer_again(conn_->loop, &conn_->wt);
+  }
+
+  // Let Connection write more, or notice the error.  The event is fed
+  // even if the watcher is not active because Connection may wait
+  // for the buffered data to be sent before closing.
+  ev_feed_event(conn_->loop, &conn_->wev, EV_WRITE);
+}
+
+void IOUringSocket::detach() {
+  auto linger_timeout = conn_->wt.repeat;
+
+  conn_ = nullptr;
+
+  rbuf_.reset();
+
+  for (auto &buf : recvbufs_) {
+    ring_->recycle_buffer(buf.flags);
+  }
+
+  recvbufs_.clear();
+  recvlen_ = 0;
+
+  cancel_recv();
+
+  if (!recv_armed_ && !release_queued_ && !write_queued_ &&
+      !write_inflight_ && wiovcnt_ == 0) {
+    delete this;
+    return;
+  }
+
+  ring_->add_orphan(this);
+
+  // Give up sending data if the client does not read it.
+  ev_timer_set(&linger_timer_, linger_timeout, 0.);
+  ev_timer_start(ring_->get_loop(), &linger_timer_);
+}
+
+void IOUringSocket::on_linger_timeout() {
+  write_error_ = true;
+
+  if (write_inflight_) {
+    // The pinned buffers are released when the write completes.
+    ring_->cancel(&write_op_);
+  } else {
+    reset_write();
+  }
+
+  cancel_recv();
+
+  maybe_delete();
+}
+
+void IOUringSocket::maybe_delete() {
+  if (conn_ || recv_armed_ || release_queued_ || write_queued_ ||
+      write_inflight_ || wiovcnt_) {
+    return;
+  }
+
+  ring_->remove_orphan(this);
+
+  delete this;
+}
+
+} // namespace shrpx
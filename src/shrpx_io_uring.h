@@ -0,0 +1,261 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_IO_URING_H
+#define SHRPX_IO_URING_H
+
+#include "shrpx.h"
+
+#include <sys/uio.h>
+
+#include <array>
+#include <deque>
+#include <vector>
+
+#include <ev.h>
+
+#include "template.h"
+#include "memchunk.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+struct Connection;
+class IOUringSocket;
+
+// IOUringOp is passed to the kernel as the user data of a request.
+// |cb| is called for each completion of the request.  |res| is the
+// result of the operation, and |flags| is the flags of the
+// completion queue entry.
+struct IOUringOp {
+  void (*cb)(IOUringOp *op, int32_t res, uint32_t flags);
+  void *data;
+};
+
+// IOUring is an io_uring instance driven by libev event loop.
+// Requests are queued to the submission queue, and they are passed
+// to the kernel in one system call just before the event loop
+// polls.  The kernel notifies completions through eventfd.
+class IOUring {
+public:
+  IOUring(struct ev_loop *loop);
+  ~IOUring();
+
+  IOUring(const IOUring &) = delete;
+  IOUring &operator=(const IOUring &) = delete;
+
+  // Sets up io_uring, and the provided buffer ring for reads.  This
+  // function returns 0 if it succeeds, or -1 if the kernel does not
+  // support the features we need.
+  int init();
+
+  // Queues multishot accept on the listening socket |fd|.  Accepted
+  // sockets are non-blocking.
+  int accept_multishot(int fd, IOUringOp *op);
+  // Queues multishot receive on |fd|.  Data is received into the
+  // provided buffers.
+  int recv_multishot(int fd, IOUringOp *op);
+  // Queues writev on |fd|.  |iov| must be kept intact until the
+  // completion.
+  int writev(int fd, const struct iovec *iov, int iovcnt, IOUringOp *op);
+  // Queues the cancellation of all requests of |op|.
+  int cancel(IOUringOp *op);
+
+  // Returns the provided buffer indicated by completion |flags|.
+  // This function returns nullptr if the completion has no buffer.
+  const uint8_t *get_buffer(uint32_t flags) const;
+  // Gives the buffer indicated by completion |flags| back to the
+  // kernel.
+  void recycle_buffer(uint32_t flags);
+
+  // Asks |sock| to submit its queued data before the event loop
+  // polls.
+  void queue_write(IOUringSocket *sock);
+  // Asks |sock| to give its provided buffers back to the kernel
+  // before the event loop polls.
+  void queue_release(IOUringSocket *sock);
+  // Submits the queued requests to the kernel.
+  void submit();
+  // Processes the completion queue.
+  void handle_completions();
+
+  // Keeps |sock| which finishes writes after its connection is
+  // closed.  |sock| is deleted when this object is destroyed.
+  void add_orphan(IOUringSocket *sock);
+  void remove_orphan(IOUringSocket *sock);
+
+  struct ev_loop *get_loop() const;
+
+  // Returns true if |flags| of a completion tells that the multishot
+  // request will post more completions.
+  static bool more(uint32_t flags);
+
+private:
+  void *get_sqe();
+  // Passes the queued requests to the kernel.
+  void enter();
+  int probe_recv_multishot();
+
+  std::vector<IOUringSocket *> release_queue_;
+  std::vector<IOUringSocket *> write_queue_;
+  DList<IOUringSocket> orphans_;
+  ev_io eventfd_rev_;
+  ev_prepare prep_;
+  struct ev_loop *loop_;
+  // The mapped submission and completion queues.
+  uint8_t *ring_;
+  size_t ring_size_;
+  void *sqes_;
+  size_t sqes_size_;
+  // The provided buffer ring, and the buffers.
+  void *buf_ring_;
+  size_t buf_ring_size_;
+  uint8_t *bufs_;
+  uint32_t *sq_head_;
+  uint32_t *sq_tail_;
+  uint32_t *cq_head_;
+  uint32_t *cq_tail_;
+  void *cqes_;
+  uint32_t sq_mask_;
+  uint32_t sq_entries_;
+  uint32_t cq_mask_;
+  // The tail of the submission queue which is not published to the
+  // kernel yet.
+  uint32_t sqe_tail_;
+  uint16_t buf_ring_tail_;
+  int fd_;
+  int eventfd_;
+};
+
+// IOUringRecvBuffer is a provided buffer which holds received data
+// that Connection has not read yet.
+struct IOUringRecvBuffer {
+  const uint8_t *pos;
+  size_t len;
+  // The flags of the completion, which tell the buffer ID.
+  uint32_t flags;
+};
+
+// IOUringSocket reads and writes a cleartext socket with io_uring on
+// behalf of Connection.  read() copies received data straight out of
+// the provided buffers.  The data which Connection has not read
+// before the event loop polls is moved to the buffer owned by this
+// object so that the provided buffers go back to the kernel.
+// writev() queues the memory of the caller without copying, and it
+// is sent with one writev request per event loop iteration.  The
+// caller must keep the memory intact until the write completes by
+// passing it to pin().
+//
+// When Connection is closed, this object takes over the socket, and
+// deletes itself after the queued data is sent.
+class IOUringSocket {
+public:
+  IOUringSocket(IOUring *ring, Connection *conn, MemchunkPool *mcpool);
+  ~IOUringSocket();
+
+  IOUringSocket(const IOUringSocket &) = delete;
+  IOUringSocket &operator=(const IOUringSocket &) = delete;
+
+  // Starts receiving data.
+  void start();
+
+  // The return values of read and writev are the same as
+  // Connection::read_clear and Connection::writev_clear.
+  ssize_t read(void *data, size_t len);
+  ssize_t writev(const struct iovec *iov, int iovcnt);
+  // Keeps |bufs| until the data queued by writev() is sent.  The
+  // caller passes the buffers which it has drained after writev().
+  void pin(DefaultMemchunks bufs);
+
+  // Returns true if read() returns something other than 0.
+  bool read_pending() const;
+  // Returns true if there is data which is not sent yet.
+  bool write_pending() const;
+
+  // Detaches this object from Connection, and takes the ownership of
+  // the socket.
+  void detach();
+
+  void submit_write();
+  // Moves the data left in the provided buffers to rbuf_, and gives
+  // the buffers back to the kernel.
+  void release_buffers();
+  void on_recv(int32_t res, uint32_t flags);
+  void on_write(int32_t res);
+  void on_linger_timeout();
+
+  IOUringSocket *dlprev, *dlnext;
+
+private:
+  void arm_recv();
+  void cancel_recv();
+  // Returns the number of bytes received, but not read.
+  size_t rleft() const;
+  // Drops the data queued by writev().
+  void reset_write();
+  // Deletes this object if it is detached, and has no outstanding
+  // request.
+  void maybe_delete();
+
+  // The provided buffers received in this event loop iteration.
+  std::deque<IOUringRecvBuffer> recvbufs_;
+  // The data moved out of the provided buffers.
+  DefaultMemchunks rbuf_;
+  // The buffers which hold the data of wiov_.
+  DefaultMemchunks pinned_;
+  std::array<struct iovec, 8> wiov_;
+  IOUringOp recv_op_;
+  IOUringOp write_op_;
+  ev_timer linger_timer_;
+  IOUring *ring_;
+  Connection *conn_;
+  // The number of bytes in recvbufs_.
+  size_t recvlen_;
+  // The number of entries in wiov_ which are not sent yet.
+  size_t wiovcnt_;
+  // The number of bytes in wiov_ which are not sent yet.
+  size_t wlen_;
+  int fd_;
+  // true if multishot receive is in flight.
+  bool recv_armed_;
+  // true if the cancellation of multishot receive is requested.
+  bool recv_canceled_;
+  bool eof_;
+  bool read_error_;
+  // true if this object is in IOUring::release_queue_.
+  bool release_queued_;
+  // true if this object is in IOUring::write_queue_.
+  bool write_queued_;
+  // true if wiov_ has been submitted.  writev() does not add data to
+  // wiov_ until all of it is sent.
+  bool write_submitted_;
+  // true if writev is in flight.
+  bool write_inflight_;
+  bool write_error_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_IO_URING_H
@@ -0,0 +1,516 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_io_uring_test.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_io_uring.h"
+#include "shrpx_connection.h"
+#include "shrpx_accept_handler.h"
+#include "shrpx_config.h"
+#include "shrpx_worker.h"
+#include "shrpx_log.h"
+#include "util.h"
+
+namespace shrpx {
+
+namespace {
+// Returns IOUring driven by |loop|, or nullptr if io_uring is not
+// available.
+std::unique_ptr<IOUring> make_ring(struct ev_loop *loop) {
+  auto ring = std::make_unique<IOUring>(loop);
+  if (ring->init() != 0) {
+    return nullptr;
+  }
+
+  return ring;
+}
+} // namespace
+
+namespace {
+// Runs |loop| until |pred| returns true, or about 1 second passes.
+template <typename F> bool run_until(struct ev_loop *loop, F pred) {
+  for (size_t i = 0; i < 1000; ++i) {
+    ev_run(loop, EVRUN_NOWAIT);
+    if (pred()) {
+      return true;
+    }
+    usleep(1000);
+  }
+
+  return false;
+}
+} // namespace
+
+namespace {
+struct RecvState {
+  IOUring *ring;
+  // The completion flags of the buffers which are not recycled yet.
+  std::vector<uint32_t> bufs;
+  size_t nread;
+  int32_t res;
+  bool more;
+};
+} // namespace
+
+namespace {
+void recvcb(IOUringOp *op, int32_t res, uint32_t flags) {
+  auto st = static_cast<RecvState *>(op->data);
+
+  if (res > 0) {
+    CU_ASSERT('x' == *st->ring->get_buffer(flags));
+
+    st->bufs.push_back(flags);
+    st->nread += res;
+  } else {
+    st->ring->recycle_buffer(flags);
+  }
+
+  st->res = res;
+  st->more = IOUring::more(flags);
+}
+} // namespace
+
+void test_shrpx_io_uring_buffer_ring(void) {
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+
+  {
+    auto ring = make_ring(loop);
+    if (!ring) {
+      ev_loop_destroy(loop);
+      return;
+    }
+
+    int sv[2];
+
+    CU_ASSERT_FATAL(0 == socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0,
+                                    sv));
+
+    RecvState st{ring.get()};
+    IOUringOp op{recvcb, &st};
+
+    CU_ASSERT(0 == ring->recv_multishot(sv[0], &op));
+
+    st.more = true;
+
+    // Each byte is received into its own buffer.  The request ends
+    // when the buffers run out.
+    for (size_t i = 0; i < 1000 && st.more; ++i) {
+      CU_ASSERT(1 == write(sv[1], "x", 1));
+
+      auto nread = st.nread;
+
+      CU_ASSERT(run_until(
+          loop, [&st, nread] { return !st.more || st.nread > nread; }));
+    }
+
+    CU_ASSERT(!st.more);
+    CU_ASSERT(-ENOBUFS == st.res);
+    CU_ASSERT(st.bufs.size() > 0);
+    CU_ASSERT(st.bufs.size() == st.nread);
+
+    // The recycled buffers are used again.
+    for (auto flags : st.bufs) {
+      ring->recycle_buffer(flags);
+    }
+
+    auto nbufs = st.bufs.size();
+
+    st.bufs.clear();
+
+    CU_ASSERT(0 == ring->recv_multishot(sv[0], &op));
+    CU_ASSERT(run_until(loop, [&st] { return st.bufs.size() == 1; }));
+
+    st.more = true;
+
+    for (size_t i = 0; i < nbufs - 1; ++i) {
+      CU_ASSERT(1 == write(sv[1], "x", 1));
+
+      auto nread = st.nread;
+
+      CU_ASSERT(run_until(loop, [&st, nread] { return st.nread > nread; }));
+    }
+
+    CU_ASSERT(st.more);
+    CU_ASSERT(nbufs == st.bufs.size());
+
+    CU_ASSERT(0 == ring->cancel(&op));
+    CU_ASSERT(run_until(loop, [&st] { return !st.more; }));
+
+    for (auto flags : st.bufs) {
+      ring->recycle_buffer(flags);
+    }
+
+    close(sv[1]);
+    close(sv[0]);
+  }
+
+  ev_loop_destroy(loop);
+}
+
+namespace {
+struct SocketState {
+  DefaultMemchunks *wbuf;
+  std::string rdata;
+  ssize_t read_rv;
+  // If true, readcb stops reading after one read.
+  bool read_once;
+};
+} // namespace
+
+namespace {
+void readcb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto st = static_cast<SocketState *>(conn->data);
+
+  std::array<uint8_t, 4> buf;
+
+  auto nread = conn->read_clear(buf.data(), buf.size());
+  if (nread < 0) {
+    st->read_rv = nread;
+    conn->rlimit.stopw();
+    return;
+  }
+
+  st->rdata.append(buf.data(), buf.data() + nread);
+
+  if (st->read_once) {
+    conn->rlimit.stopw();
+  }
+}
+} // namespace
+
+namespace {
+// Writes the data in st->wbuf as ClientHandler does.
+void writecb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto st = static_cast<SocketState *>(conn->data);
+
+  std::array<iovec, 2> iov;
+
+  while (st->wbuf->rleft()) {
+    auto iovcnt = st->wbuf->riovec(iov.data(), iov.size());
+    auto nwrite = conn->writev_clear(iov.data(), iovcnt);
+    if (nwrite <= 0) {
+      return;
+    }
+
+    DefaultMemchunks pinned(st->wbuf->pool);
+
+    st->wbuf->drain_pin(nwrite, pinned);
+
+    conn->uring->pin(std::move(pinned));
+  }
+}
+} // namespace
+
+namespace {
+void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {}
+} // namespace
+
+namespace {
+// Makes |conn| read and write with io_uring as ClientHandler does.
+void attach_io_uring(Connection &conn, IOUring *ring, MemchunkPool *mcpool) {
+  conn.uring = new IOUringSocket(ring, &conn, mcpool);
+  ev_io_set(&conn.rev, conn.fd, 0);
+  ev_io_set(&conn.wev, conn.fd, 0);
+  conn.wlimit.set_feed_write(true);
+  conn.uring->start();
+}
+} // namespace
+
+void test_shrpx_io_uring_socket_read(void) {
+  MemchunkPool mcpool;
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+
+  {
+    auto ring = make_ring(loop);
+    if (!ring) {
+      ev_loop_destroy(loop);
+      return;
+    }
+
+    int sv[2];
+
+    CU_ASSERT_FATAL(0 == socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0,
+                                    sv));
+
+    SocketState st{};
+    st.read_once = true;
+
+    Connection conn(loop, sv[0], nullptr, &mcpool, 10., 10.,
+                    RateLimitConfig{}, RateLimitConfig{}, writecb, readcb,
+                    timeoutcb, &st, 0, 0., Proto::HTTP1);
+
+    attach_io_uring(conn, ring.get(), &mcpool);
+
+    conn.rlimit.startw();
+
+    CU_ASSERT(10 == write(sv[1], "0123456789", 10));
+    CU_ASSERT(run_until(loop, [&st] { return !st.rdata.empty(); }));
+    CU_ASSERT("0123" == st.rdata);
+    CU_ASSERT(conn.uring->read_pending());
+
+    // The unread data is moved out of the provided buffer.  It is
+    // still read before the data received later.
+    CU_ASSERT(3 == write(sv[1], "abc", 3));
+
+    ev_run(loop, EVRUN_NOWAIT);
+
+    st.read_once = false;
+    conn.rlimit.startw();
+
+    CU_ASSERT(run_until(loop, [&st] { return st.rdata.size() == 13; }));
+    CU_ASSERT("0123456789abc" == st.rdata);
+    CU_ASSERT(!conn.uring->read_pending());
+
+    shutdown(sv[1], SHUT_WR);
+
+    CU_ASSERT(run_until(loop, [&st] { return st.read_rv != 0; }));
+    CU_ASSERT(SHRPX_ERR_EOF == st.read_rv);
+
+    conn.disconnect();
+
+    // IOUringSocket closes the socket when it is deleted.
+    CU_ASSERT(run_until(loop, [&sv] {
+      std::array<uint8_t, 1> buf;
+      return read(sv[1], buf.data(), buf.size()) == 0;
+    }));
+
+    close(sv[1]);
+  }
+
+  ev_loop_destroy(loop);
+
+  CU_ASSERT(mcpool.poolsize.load() == mcpool.freelistsize.load());
+}
+
+void test_shrpx_io_uring_socket_write(void) {
+  MemchunkPool mcpool;
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+
+  {
+    auto ring = make_ring(loop);
+    if (!ring) {
+      ev_loop_destroy(loop);
+      return;
+    }
+
+    int sv[2];
+
+    CU_ASSERT_FATAL(0 == socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0,
+                                    sv));
+
+    DefaultMemchunks wbuf(&mcpool);
+    SocketState st{&wbuf};
+
+    Connection conn(loop, sv[0], nullptr, &mcpool, 10., 10.,
+                    RateLimitConfig{}, RateLimitConfig{}, writecb, readcb,
+                    timeoutcb, &st, 0, 0., Proto::HTTP1);
+
+    attach_io_uring(conn, ring.get(), &mcpool);
+
+    std::string data;
+    for (size_t i = 0; data.size() < 256_k; ++i) {
+      data += util::utos(i);
+    }
+
+    wbuf.append(data.data(), data.size());
+
+    // Data is queued without copying, and the drained buffers are
+    // pinned until it is sent.
+    writecb(loop, &conn.wev, EV_WRITE);
+
+    CU_ASSERT(wbuf.rleft() < data.size());
+    CU_ASSERT(conn.uring->write_pending());
+    CU_ASSERT(mcpool.freelistsize.load() == 0);
+
+    std::string rdata;
+
+    CU_ASSERT(run_until(loop, [&] {
+      std::array<uint8_t, 16_k> buf;
+      ssize_t nread;
+      while ((nread = read(sv[1], buf.data(), buf.size())) > 0) {
+        rdata.append(buf.data(), buf.data() + nread);
+      }
+      return rdata.size() == data.size() && !conn.uring->write_pending();
+    }));
+
+    CU_ASSERT(data == rdata);
+    CU_ASSERT(0 == wbuf.rleft());
+    CU_ASSERT(mcpool.poolsize.load() == mcpool.freelistsize.load());
+
+    conn.disconnect();
+
+    close(sv[1]);
+  }
+
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_io_uring_socket_linger(void) {
+  MemchunkPool mcpool;
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+
+  {
+    auto ring = make_ring(loop);
+    if (!ring) {
+      ev_loop_destroy(loop);
+      return;
+    }
+
+    int sv[2];
+
+    CU_ASSERT_FATAL(0 == socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0,
+                                    sv));
+
+    DefaultMemchunks wbuf(&mcpool);
+    SocketState st{&wbuf};
+
+    {
+      // The write timeout is also the time to linger after the
+      // connection is closed.
+      Connection conn(loop, sv[0], nullptr, &mcpool, 0.05, 10.,
+                      RateLimitConfig{}, RateLimitConfig{}, writecb, readcb,
+                      timeoutcb, &st, 0, 0., Proto::HTTP1);
+
+      attach_io_uring(conn, ring.get(), &mcpool);
+
+      std::array<uint8_t, 16_k> data{};
+
+      for (size_t i = 0; i < 64; ++i) {
+        wbuf.append(data.data(), data.size());
+      }
+
+      // The peer never reads, and the write stays in flight.
+      writecb(loop, &conn.wev, EV_WRITE);
+      ev_run(loop, EVRUN_NOWAIT);
+
+      CU_ASSERT(conn.uring->write_pending());
+
+      // Connection is closed, and IOUringSocket keeps the pinned
+      // buffers until it gives up the write.
+      wbuf.reset();
+    }
+
+    CU_ASSERT(mcpool.poolsize.load() > mcpool.freelistsize.load());
+
+    CU_ASSERT(run_until(loop, [&mcpool] {
+      return mcpool.poolsize.load() == mcpool.freelistsize.load();
+    }));
+
+    // The socket is closed after the write is canceled.
+    CU_ASSERT(run_until(loop, [&sv] {
+      std::array<uint8_t, 16_k> buf;
+      return read(sv[1], buf.data(), buf.size()) == 0;
+    }));
+
+    close(sv[1]);
+  }
+
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_io_uring_accept_cancel(void) {
+  auto lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+
+  CU_ASSERT_FATAL(lfd != -1);
+
+  sockaddr_union su{};
+  su.in.sin_family = AF_INET;
+  su.in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(su.in);
+
+  auto listening = bind(lfd, &su.sa, len) == 0 && listen(lfd, 8) == 0 &&
+                   getsockname(lfd, &su.sa, &len) == 0;
+  if (!listening) {
+    close(lfd);
+  }
+
+  CU_ASSERT_FATAL(listening);
+
+  auto &upstreamconf = mod_config()->conn.upstream;
+  auto io_engine = upstreamconf.io_engine;
+  upstreamconf.io_engine = IOEngine::IO_URING;
+
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+
+  {
+    auto worker = std::make_unique<Worker>(
+        loop, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        std::make_shared<DownstreamConfig>());
+
+    if (worker->get_io_uring()) {
+      UpstreamAddr faddr{};
+      faddr.fd = lfd;
+
+      auto handler = std::make_unique<AcceptHandler>(&faddr, worker.get());
+
+      // Multishot accept is submitted.
+      ev_run(loop, EVRUN_NOWAIT);
+
+      auto cfd = socket(AF_INET, SOCK_STREAM, 0);
+
+      CU_ASSERT_FATAL(cfd != -1);
+      CU_ASSERT(0 == connect(cfd, &su.sa, len));
+
+      // The connection accepted until the cancellation takes effect
+      // is closed without being handed to the worker.
+      handler->disable();
+
+      ev_run(loop, EVRUN_NOWAIT);
+
+      handler.reset();
+
+      CU_ASSERT(run_until(loop, [cfd] {
+        std::array<uint8_t, 1> buf;
+        return recv(cfd, buf.data(), buf.size(), MSG_DONTWAIT) != -1 ||
+               (errno != EAGAIN && errno != EWOULDBLOCK);
+      }));
+      CU_ASSERT(0 == worker->get_worker_stat()->num_connections);
+
+      close(cfd);
+    } else {
+      close(lfd);
+    }
+  }
+
+  ev_loop_destroy(loop);
+
+  upstreamconf.io_engine = io_engine;
+}
+
+} // namespace shrpx
@@ -48,6 +48,7 @@
 #include <iomanip>
 
 #include "shrpx_config.h"
+#include "shrpx_binlog.h"
 #include "shrpx_downstream.h"
 #include "shrpx_worker.h"
 #include "util.h"
@@ -153,6 +154,70 @@ Log::Log(int severity, const char *filename, int linenum)
       linenum_(linenum),
       full_(false) {}
 
+#ifndef NOTHREADS
+namespace {
+// The thread which writes log records if --log-async is given.
+std::unique_ptr<LogWriter> log_writer;
+} // namespace
+#endif // !NOTHREADS
+
+namespace {
+// Returns the ring buffer which the current thread appends log
+// records to, or nullptr if log is written synchronously.
+LogRing *get_log_ring(LogConfig *lgconf) {
+#ifndef NOTHREADS
+  if (!log_writer) {
+    return nullptr;
+  }
+
+  if (!lgconf->log_ring) {
+    lgconf->log_ring = log_writer->make_ring();
+  }
+
+  return lgconf->log_ring.get();
+#else  // NOTHREADS
+  return nullptr;
+#endif // NOTHREADS
+}
+} // namespace
+
+namespace {
+// Writes |data| of length |len| to |fd|.  If log writer is running,
+// |data| is handed over to it, and this function does not block.
+void write_log(LogConfig *lgconf, int fd, const char *data, size_t len) {
+  auto ring = get_log_ring(lgconf);
+  if (!ring) {
+    while (write(fd, data, len) == -1 && errno == EINTR)
+      ;
+
+    return;
+  }
+
+  ring->push(fd, reinterpret_cast<const uint8_t *>(data), len);
+
+#ifndef NOTHREADS
+  if (ring->backlogged()) {
+    log_writer->notify();
+  }
+#endif // !NOTHREADS
+}
+} // namespace
+
+namespace {
+// Blocks until log records appended by the current thread are
+// written.
+void flush_log(LogConfig *lgconf) {
+#ifndef NOTHREADS
+  auto ring = get_log_ring(lgconf);
+  if (!ring) {
+    return;
+  }
+
+  log_writer->flush(*ring);
+#endif // !NOTHREADS
+}
+} // namespace
+
 Log::~Log() {
   int rv;
   auto config = get_config();
@@ -203,8 +268,12 @@ Log::~Log() {
 
   auto nwrite = std::min(static_cast<size_t>(rv), sizeof(buf) - 1);
 
-  while (write(lgconf->errorlog_fd, buf, nwrite) == -1 && errno == EINTR)
-    ;
+  write_log(lgconf, lgconf->errorlog_fd, buf, nwrite);
+
+  if (severity_ == FATAL) {
+    // The process is likely to exit after this.
+    flush_log(lgconf);
+  }
 }
 
 Log &Log::operator<<(const std::string &s) {
@@ -573,186 +642,146 @@ StringRef construct_absolute_request_uri(BlockAllocator &balloc,
 }
 } // namespace
 
-void upstream_accesslog(const std::vector<LogFragment> &lfv,
-                        const LogSpec &lgsp) {
-  auto config = get_config();
-  auto lgconf = log_config();
-  auto &accessconf = get_config()->logging.access;
-
-  if (lgconf->accesslog_fd == -1 && !accessconf.syslog) {
-    return;
-  }
-
-  std::array<char, 4_k> buf;
-
+namespace {
+// Extracts the value of each variable in |lfv| from |lgsp|, and
+// passes it to |w|.  Text and binary access log share this function
+// so that both record the same values.  Writer must provide
+// put_literal, put_string, put_bytes, put_uint, put_time, put_absent,
+// put_version, and put_request.
+template <typename Writer>
+void extract_log_fields(Writer &w, const std::vector<LogFragment> &lfv,
+                        const LogSpec &lgsp, const StringRef &method,
+                        const StringRef &path,
+                        const StringRef &path_without_query) {
   auto downstream = lgsp.downstream;
 
   const auto &req = downstream->request();
   const auto &resp = downstream->response();
-  const auto &tstamp = req.tstamp;
   auto &balloc = downstream->get_block_allocator();
 
   auto downstream_addr = downstream->get_addr();
-  auto method = req.method == -1 ? StringRef::from_lit("<unknown>")
-                                 : http2::to_method_string(req.method);
-  auto path =
-      req.method == HTTP_CONNECT ? req.authority
-      : config->http2_proxy      ? construct_absolute_request_uri(balloc, req)
-      : req.path.empty() ? req.method == HTTP_OPTIONS ? StringRef::from_lit("*")
-                                                      : StringRef::from_lit("-")
-                         : req.path;
-  auto path_without_query =
-      req.method == HTTP_CONNECT
-          ? path
-          : StringRef{std::begin(path),
-                      std::find(std::begin(path), std::end(path), '?')};
-
-  auto p = std::begin(buf);
-  auto last = std::end(buf) - 2;
 
   for (auto &lf : lfv) {
     switch (lf.type) {
+    case LogFragmentType::NONE:
+      break;
     case LogFragmentType::LITERAL:
-      std::tie(p, last) = copy(lf.value, p, last);
+      w.put_literal(lf.value);
       break;
     case LogFragmentType::REMOTE_ADDR:
-      std::tie(p, last) = copy(lgsp.remote_addr, p, last);
+      w.put_string(lf.type, lgsp.remote_addr);
       break;
     case LogFragmentType::TIME_LOCAL:
-      std::tie(p, last) = copy(tstamp->time_local, p, last);
-      break;
     case LogFragmentType::TIME_ISO8601:
-      std::tie(p, last) = copy(tstamp->time_iso8601, p, last);
+      w.put_time(lf.type, *req.tstamp);
       break;
     case LogFragmentType::REQUEST:
-      std::tie(p, last) = copy(method, p, last);
-      std::tie(p, last) = copy(' ', p, last);
-      std::tie(p, last) = copy_escape(path, p, last);
-      std::tie(p, last) = copy_l(" HTTP/", p, last);
-      std::tie(p, last) = copy(req.http_major, p, last);
-      if (req.http_major < 2) {
-        std::tie(p, last) = copy('.', p, last);
-        std::tie(p, last) = copy(req.http_minor, p, last);
-      }
+      w.put_request(method, path, req.http_major, req.http_minor);
       break;
     case LogFragmentType::METHOD:
-      std::tie(p, last) = copy(method, p, last);
+      w.put_string(lf.type, method);
       break;
     case LogFragmentType::PATH:
-      std::tie(p, last) = copy_escape(path, p, last);
+      w.put_string(lf.type, path);
       break;
     case LogFragmentType::PATH_WITHOUT_QUERY:
-      std::tie(p, last) = copy_escape(path_without_query, p, last);
+      w.put_string(lf.type, path_without_query);
       break;
     case LogFragmentType::PROTOCOL_VERSION:
-      std::tie(p, last) = copy_l("HTTP/", p, last);
-      std::tie(p, last) = copy(req.http_major, p, last);
-      if (req.http_major < 2) {
-        std::tie(p, last) = copy('.', p, last);
-        std::tie(p, last) = copy(req.http_minor, p, last);
-      }
+      w.put_version(lf.type, req.http_major, req.http_minor);
       break;
     case LogFragmentType::STATUS:
-      std::tie(p, last) = copy(resp.http_status, p, last);
+      w.put_uint(lf.type, resp.http_status);
       break;
     case LogFragmentType::BODY_BYTES_SENT:
-      std::tie(p, last) = copy(downstream->response_sent_body_length, p, last);
+      w.put_uint(lf.type, downstream->response_sent_body_length);
       break;
     case LogFragmentType::HTTP: {
       auto hd = req.fs.header(lf.value);
-      if (hd) {
-        std::tie(p, last) = copy_escape((*hd).value, p, last);
+      if (!hd) {
+        w.put_absent(lf.type);
         break;
       }
-
-      std::tie(p, last) = copy('-', p, last);
-
+      w.put_string(lf.type, (*hd).value);
       break;
     }
     case LogFragmentType::AUTHORITY:
-      if (!req.authority.empty()) {
-        std::tie(p, last) = copy(req.authority, p, last);
+      if (req.authority.empty()) {
+        w.put_absent(lf.type);
         break;
       }
-
-      std::tie(p, last) = copy('-', p, last);
-
+      w.put_string(lf.type, req.authority);
       break;
     case LogFragmentType::REMOTE_PORT:
-      std::tie(p, last) = copy(lgsp.remote_port, p, last);
+      w.put_string(lf.type, lgsp.remote_port);
       break;
     case LogFragmentType::SERVER_PORT:
-      std::tie(p, last) = copy(lgsp.server_port, p, last);
+      w.put_uint(lf.type, lgsp.server_port);
       break;
-    case LogFragmentType::REQUEST_TIME: {
-      auto t = std::chrono::duration_cast<std::chrono::milliseconds>(
-                   lgsp.request_end_time - downstream->get_request_start_time())
-                   .count();
-      std::tie(p, last) = copy(t / 1000, p, last);
-      std::tie(p, last) = copy('.', p, last);
-      auto frac = t % 1000;
-      if (frac < 100) {
-        auto n = frac < 10 ? 2 : 1;
-        std::tie(p, last) = copy("000", n, p, last);
-      }
-      std::tie(p, last) = copy(frac, p, last);
+    case LogFragmentType::REQUEST_TIME:
+      w.put_uint(lf.type,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     lgsp.request_end_time -
+                     downstream->get_request_start_time())
+                     .count());
       break;
-    }
     case LogFragmentType::PID:
-      std::tie(p, last) = copy(lgsp.pid, p, last);
+      w.put_uint(lf.type, lgsp.pid);
       break;
     case LogFragmentType::ALPN:
-      std::tie(p, last) = copy_escape(lgsp.alpn, p, last);
+      w.put_string(lf.type, lgsp.alpn);
       break;
     case LogFragmentType::TLS_CIPHER:
       if (!lgsp.ssl) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
-      std::tie(p, last) = copy(SSL_get_cipher_name(lgsp.ssl), p, last);
+      w.put_string(lf.type, StringRef{SSL_get_cipher_name(lgsp.ssl)});
       break;
     case LogFragmentType::TLS_PROTOCOL:
       if (!lgsp.ssl) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
-      std::tie(p, last) =
-          copy(nghttp2::tls::get_tls_protocol(lgsp.ssl), p, last);
+      w.put_string(lf.type,
+                   StringRef{nghttp2::tls::get_tls_protocol(lgsp.ssl)});
       break;
     case LogFragmentType::TLS_SESSION_ID: {
       auto session = SSL_get_session(lgsp.ssl);
       if (!session) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
       unsigned int session_id_length = 0;
       auto session_id = SSL_SESSION_get_id(session, &session_id_length);
       if (session_id_length == 0) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
-      std::tie(p, last) = copy_hex_low(session_id, session_id_length, p, last);
+      w.put_bytes(lf.type, session_id, session_id_length);
       break;
     }
     case LogFragmentType::TLS_SESSION_REUSED:
       if (!lgsp.ssl) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
-      std::tie(p, last) =
-          copy(SSL_session_reused(lgsp.ssl) ? 'r' : '.', p, last);
+      w.put_uint(lf.type, SSL_session_reused(lgsp.ssl) ? 1 : 0);
       break;
     case LogFragmentType::TLS_SNI:
       if (lgsp.sni.empty()) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
-      std::tie(p, last) = copy_escape(lgsp.sni, p, last);
+      w.put_string(lf.type, lgsp.sni);
       break;
     case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA1:
-    case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA256: {
+    case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA256:
+    case LogFragmentType::TLS_CLIENT_ISSUER_NAME:
+    case LogFragmentType::TLS_CLIENT_SUBJECT_NAME:
+    case LogFragmentType::TLS_CLIENT_SERIAL: {
       if (!lgsp.ssl) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
 #if OPENSSL_3_0_0_API
@@ -761,99 +790,220 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
       auto x = SSL_get_peer_certificate(lgsp.ssl);
 #endif // !OPENSSL_3_0_0_API
       if (!x) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
-      std::array<uint8_t, 32> buf;
-      auto len = tls::get_x509_fingerprint(
-          buf.data(), buf.size(), x,
-          lf.type == LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA256
-              ? EVP_sha256()
-              : EVP_sha1());
-#if !OPENSSL_3_0_0_API
-      X509_free(x);
-#endif // !OPENSSL_3_0_0_API
-      if (len <= 0) {
-        std::tie(p, last) = copy('-', p, last);
+      std::array<uint8_t, 32> md;
+      ssize_t mdlen = 0;
+      StringRef name;
+      switch (lf.type) {
+      case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA1:
+      case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA256:
+        mdlen = tls::get_x509_fingerprint(
+            md.data(), md.size(), x,
+            lf.type == LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA256
+                ? EVP_sha256()
+                : EVP_sha1());
         break;
-      }
-      std::tie(p, last) = copy_hex_low(buf.data(), len, p, last);
-      break;
-    }
-    case LogFragmentType::TLS_CLIENT_ISSUER_NAME:
-    case LogFragmentType::TLS_CLIENT_SUBJECT_NAME: {
-      if (!lgsp.ssl) {
-        std::tie(p, last) = copy('-', p, last);
+      case LogFragmentType::TLS_CLIENT_ISSUER_NAME:
+        name = tls::get_x509_issuer_name(balloc, x);
         break;
-      }
-#if OPENSSL_3_0_0_API
-      auto x = SSL_get0_peer_certificate(lgsp.ssl);
-#else  // !OPENSSL_3_0_0_API
-      auto x = SSL_get_peer_certificate(lgsp.ssl);
-#endif // !OPENSSL_3_0_0_API
-      if (!x) {
-        std::tie(p, last) = copy('-', p, last);
+      case LogFragmentType::TLS_CLIENT_SUBJECT_NAME:
+        name = tls::get_x509_subject_name(balloc, x);
+        break;
+      default:
+        name = tls::get_x509_serial(balloc, x);
         break;
       }
-      auto name = lf.type == LogFragmentType::TLS_CLIENT_ISSUER_NAME
-                      ? tls::get_x509_issuer_name(balloc, x)
-                      : tls::get_x509_subject_name(balloc, x);
 #if !OPENSSL_3_0_0_API
       X509_free(x);
 #endif // !OPENSSL_3_0_0_API
-      if (name.empty()) {
-        std::tie(p, last) = copy('-', p, last);
+      if (mdlen > 0) {
+        w.put_bytes(lf.type, md.data(), mdlen);
         break;
       }
-      std::tie(p, last) = copy(name, p, last);
-      break;
-    }
-    case LogFragmentType::TLS_CLIENT_SERIAL: {
-      if (!lgsp.ssl) {
-        std::tie(p, last) = copy('-', p, last);
-        break;
-      }
-#if OPENSSL_3_0_0_API
-      auto x = SSL_get0_peer_certificate(lgsp.ssl);
-#else  // !OPENSSL_3_0_0_API
-      auto x = SSL_get_peer_certificate(lgsp.ssl);
-#endif // !OPENSSL_3_0_0_API
-      if (!x) {
-        std::tie(p, last) = copy('-', p, last);
-        break;
-      }
-      auto sn = tls::get_x509_serial(balloc, x);
-#if !OPENSSL_3_0_0_API
-      X509_free(x);
-#endif // !OPENSSL_3_0_0_API
-      if (sn.empty()) {
-        std::tie(p, last) = copy('-', p, last);
+      if (name.empty()) {
+        w.put_absent(lf.type);
         break;
       }
-      std::tie(p, last) = copy(sn, p, last);
+      w.put_string(lf.type, name);
       break;
     }
     case LogFragmentType::BACKEND_HOST:
       if (!downstream_addr) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
-      std::tie(p, last) = copy(downstream_addr->host, p, last);
+      w.put_string(lf.type, downstream_addr->host);
       break;
     case LogFragmentType::BACKEND_PORT:
       if (!downstream_addr) {
-        std::tie(p, last) = copy('-', p, last);
+        w.put_absent(lf.type);
         break;
       }
-      std::tie(p, last) = copy(downstream_addr->port, p, last);
+      w.put_uint(lf.type, downstream_addr->port);
       break;
-    case LogFragmentType::NONE:
+    default:
+      break;
+    }
+  }
+}
+} // namespace
+
+namespace {
+// TextLogWriter writes the values passed by extract_log_fields() in
+// text access log format.  The output is truncated if it does not
+// fit in the buffer.
+class TextLogWriter {
+public:
+  TextLogWriter(char *first, char *last) : p(first), last(last) {}
+
+  void put_literal(const StringRef &s) { std::tie(p, last) = copy(s, p, last); }
+
+  void put_string(LogFragmentType type, const StringRef &s) {
+    switch (type) {
+    case LogFragmentType::HTTP:
+    case LogFragmentType::PATH:
+    case LogFragmentType::PATH_WITHOUT_QUERY:
+    case LogFragmentType::ALPN:
+    case LogFragmentType::TLS_SNI:
+      std::tie(p, last) = copy_escape(s, p, last);
+      break;
+    default:
+      std::tie(p, last) = copy(s, p, last);
+      break;
+    }
+  }
+
+  void put_bytes(LogFragmentType type, const uint8_t *data, size_t len) {
+    std::tie(p, last) = copy_hex_low(data, len, p, last);
+  }
+
+  void put_uint(LogFragmentType type, uint64_t n) {
+    switch (type) {
+    case LogFragmentType::REQUEST_TIME: {
+      // n is in milliseconds.
+      std::tie(p, last) = copy(n / 1000, p, last);
+      std::tie(p, last) = copy('.', p, last);
+      auto frac = n % 1000;
+      if (frac < 100) {
+        auto nzero = frac < 10 ? 2 : 1;
+        std::tie(p, last) = copy("000", nzero, p, last);
+      }
+      std::tie(p, last) = copy(frac, p, last);
+      break;
+    }
+    case LogFragmentType::TLS_SESSION_REUSED:
+      std::tie(p, last) = copy(n ? 'r' : '.', p, last);
       break;
     default:
+      std::tie(p, last) = copy(n, p, last);
       break;
     }
   }
 
+  void put_time(LogFragmentType type, const Timestamp &ts) {
+    std::tie(p, last) =
+        copy(type == LogFragmentType::TIME_LOCAL ? ts.time_local
+                                                 : ts.time_iso8601,
+             p, last);
+  }
+
+  void put_absent(LogFragmentType type) {
+    std::tie(p, last) = copy('-', p, last);
+  }
+
+  void put_version(LogFragmentType type, int major, int minor) {
+    std::tie(p, last) = copy_l("HTTP/", p, last);
+    put_version_number(major, minor);
+  }
+
+  void put_request(const StringRef &method, const StringRef &path, int major,
+                   int minor) {
+    std::tie(p, last) = copy(method, p, last);
+    std::tie(p, last) = copy(' ', p, last);
+    std::tie(p, last) = copy_escape(path, p, last);
+    std::tie(p, last) = copy_l(" HTTP/", p, last);
+    put_version_number(major, minor);
+  }
+
+  char *p, *last;
+
+private:
+  void put_version_number(int major, int minor) {
+    std::tie(p, last) = copy(major, p, last);
+    if (major < 2) {
+      std::tie(p, last) = copy('.', p, last);
+      std::tie(p, last) = copy(minor, p, last);
+    }
+  }
+};
+} // namespace
+
+namespace {
+// Writes access log record for |lgsp| in binary format.  See
+// shrpx_binlog.h for the format.
+void upstream_binary_accesslog(const std::vector<LogFragment> &lfv,
+                               const LogSpec &lgsp, const StringRef &method,
+                               const StringRef &path,
+                               const StringRef &path_without_query) {
+  auto lgconf = log_config();
+
+  std::array<uint8_t, 4_k> buf;
+
+  BinaryLogEncoder enc(buf.data(), buf.size());
+
+  extract_log_fields(enc, lfv, lgsp, method, path, path_without_query);
+
+  auto nwrite = enc.finish();
+
+  write_log(lgconf, lgconf->accesslog_fd,
+            reinterpret_cast<const char *>(buf.data()), nwrite);
+}
+} // namespace
+
+void upstream_accesslog(const std::vector<LogFragment> &lfv,
+                        const LogSpec &lgsp) {
+  auto config = get_config();
+  auto lgconf = log_config();
+  auto &accessconf = get_config()->logging.access;
+
+  if (lgconf->accesslog_fd == -1 && !accessconf.syslog) {
+    return;
+  }
+
+  std::array<char, 4_k> buf;
+
+  auto downstream = lgsp.downstream;
+
+  const auto &req = downstream->request();
+  auto &balloc = downstream->get_block_allocator();
+
+  auto method = req.method == -1 ? StringRef::from_lit("<unknown>")
+                                 : http2::to_method_string(req.method);
+  auto path =
+      req.method == HTTP_CONNECT ? req.authority
+      : config->http2_proxy      ? construct_absolute_request_uri(balloc, req)
+      : req.path.empty() ? req.method == HTTP_OPTIONS ? StringRef::from_lit("*")
+                                                      : StringRef::from_lit("-")
+                         : req.path;
+  auto path_without_query =
+      req.method == HTTP_CONNECT
+          ? path
+          : StringRef{std::begin(path),
+                      std::find(std::begin(path), std::end(path), '?')};
+
+  if (accessconf.binary) {
+    upstream_binary_accesslog(lfv, lgsp, method, path, path_without_query);
+    return;
+  }
+
+  TextLogWriter w(buf.data(), buf.data() + buf.size() - 2);
+
+  extract_log_fields(w, lfv, lgsp, method, path, path_without_query);
+
+  auto p = w.p;
+
   *p = '\0';
 
   if (accessconf.syslog) {
@@ -865,10 +1015,27 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
   *p++ = '\n';
 
   auto nwrite = std::distance(std::begin(buf), p);
-  while (write(lgconf->accesslog_fd, buf.data(), nwrite) == -1 &&
-         errno == EINTR)
+
+  write_log(lgconf, lgconf->accesslog_fd, buf.data(), nwrite);
+}
+
+namespace {
+// Writes binary access log file header to |fd| unless |fd| is a
+// file which already has contents.
+void write_binary_accesslog_header(int fd) {
+  struct stat st;
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    return;
+  }
+
+  std::array<uint8_t, BINLOG_FILE_HEADER_LENGTH> buf;
+  auto len = binlog_write_file_header(buf.data());
+
+  while (write(fd, buf.data(), len) == -1 && errno == EINTR)
     ;
 }
+} // namespace
 
 int reopen_log_files(const LoggingConfig &loggingconf) {
   int res = 0;
@@ -885,6 +1052,8 @@ int reopen_log_files(const LoggingConfig &loggingconf) {
     if (new_accesslog_fd == -1) {
       LOG(ERROR) << "Failed to open accesslog file " << accessconf.file;
       res = -1;
+    } else if (accessconf.binary) {
+      write_binary_accesslog_header(new_accesslog_fd);
     }
   }
 
@@ -966,11 +1135,56 @@ void restore_original_fds() { dup2(STDERR_COPY, STDERR_FILENO); }
 
 void close_log_file(int &fd) {
   if (fd != STDERR_COPY && fd != STDOUT_COPY && fd != -1) {
-    close(fd);
+    auto lgconf = log_config();
+    auto ring = get_log_ring(lgconf);
+
+    // The log writer may still have records to |fd|.  Let it close
+    // |fd| after writing them.
+    if (!ring || ring->push_close(fd) != 0) {
+      flush_log(lgconf);
+      close(fd);
+    }
   }
   fd = -1;
 }
 
+void start_log_writer(size_t ring_size) {
+#ifndef NOTHREADS
+  log_writer = std::make_unique<LogWriter>(ring_size);
+  log_writer->start();
+#endif // !NOTHREADS
+}
+
+void stop_log_writer() {
+#ifndef NOTHREADS
+  if (!log_writer) {
+    return;
+  }
+
+  log_writer->stop();
+
+  auto stat = log_writer->get_stat();
+
+  log_writer.reset();
+  log_config()->log_ring.reset();
+
+  if (stat.dropped) {
+    LOG(WARN) << stat.dropped
+              << " log records were dropped because log buffer was full";
+  }
+#endif // !NOTHREADS
+}
+
+LogWriterStat get_log_writer_stat() {
+#ifndef NOTHREADS
+  if (log_writer) {
+    return log_writer->get_stat();
+  }
+#endif // !NOTHREADS
+
+  return {};
+}
+
 int open_log_file(const char *path) {
 
   if (strcmp(path, "/dev/stdout") == 0 ||
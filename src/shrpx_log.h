@@ -35,6 +35,7 @@
 
 #include "shrpx_config.h"
 #include "shrpx_log_config.h"
+#include "shrpx_log_writer.h"
 #include "tls.h"
 #include "template.h"
 #include "util.h"
@@ -298,6 +299,19 @@ void restore_original_fds();
 // stderr, or is -1, the descriptor is not closed (but still set to -1).
 void close_log_file(int &fd);
 
+// Starts the dedicated thread which writes access and error log.
+// After this call, each thread appends log records to its own ring
+// buffer of |ring_size| bytes instead of writing them by itself.
+void start_log_writer(size_t ring_size);
+
+// Writes all pending log records, and stops the thread started by
+// start_log_writer.
+void stop_log_writer();
+
+// Returns the statistics of the thread started by start_log_writer.
+// If it is not running, all counters are 0.
+LogWriterStat get_log_writer_stat();
+
 // Opens |path| with O_APPEND enabled.  If file does not exist, it is
 // created first.  This function returns file descriptor referring the
 // opened file if it succeeds, or -1.
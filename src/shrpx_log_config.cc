@@ -29,13 +29,15 @@
 #include <thread>
 #include <sstream>
 
+#include "shrpx_log_writer.h"
 #include "util.h"
 
 using namespace nghttp2;
 
 namespace shrpx {
 
-Timestamp::Timestamp(const std::chrono::system_clock::time_point &tp) {
+Timestamp::Timestamp(const std::chrono::system_clock::time_point &tp)
+    : tp(tp) {
   time_local = util::format_common_log(time_local_buf.data(), tp);
   time_iso8601 = util::format_iso8601(time_iso8601_buf.data(), tp);
   time_http = util::format_http_date(time_http_buf.data(), tp);
@@ -56,6 +58,13 @@ LogConfig::LogConfig()
                                sizeof(tid_hash));
 }
 
+LogConfig::~LogConfig() {
+  if (log_ring) {
+    // The records appended so far are still written.
+    log_ring->close();
+  }
+}
+
 #ifndef NOTHREADS
 #  ifdef HAVE_THREAD_LOCAL
 namespace {
@@ -40,6 +40,8 @@ namespace shrpx {
 struct Timestamp {
   Timestamp(const std::chrono::system_clock::time_point &tp);
 
+  // The time which this object represents.
+  std::chrono::system_clock::time_point tp;
   std::array<char, sizeof("03/Jul/2014:00:19:38 +0900")> time_local_buf;
   std::array<char, sizeof("2014-11-15T12:58:24.741+09:00")> time_iso8601_buf;
   std::array<char, sizeof("Mon, 10 Oct 2016 10:25:58 GMT")> time_http_buf;
@@ -48,6 +50,8 @@ struct Timestamp {
   StringRef time_http;
 };
 
+class LogRing;
+
 struct LogConfig {
   std::chrono::system_clock::time_point time_str_updated;
   std::shared_ptr<Timestamp> tstamp;
@@ -55,10 +59,14 @@ struct LogConfig {
   pid_t pid;
   int accesslog_fd;
   int errorlog_fd;
+  // The ring buffer which this thread appends log records to if
+  // asynchronous log writer is running.
+  std::shared_ptr<LogRing> log_ring;
   // true if errorlog_fd is referring to a terminal.
   bool errorlog_tty;
 
   LogConfig();
+  ~LogConfig();
   // Updates time stamp if difference between time_str_updated and now
   // is 1 or more milliseconds.
   void update_tstamp_millis(const std::chrono::system_clock::time_point &now);
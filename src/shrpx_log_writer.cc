@@ -0,0 +1,362 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_log_writer.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <sys/uio.h>
+
+#include <cerrno>
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include <chrono>
+
+namespace shrpx {
+
+namespace {
+enum {
+  LOG_RECORD_DATA,
+  LOG_RECORD_CLOSE,
+  // Padding to skip the end of ring, so that a record never wraps
+  // around.
+  LOG_RECORD_PAD,
+};
+} // namespace
+
+namespace {
+struct LogRecordHeader {
+  uint32_t type;
+  int32_t fd;
+  uint32_t len;
+  uint32_t reserved;
+};
+} // namespace
+
+namespace {
+constexpr size_t align_record(size_t n) {
+  return (n + sizeof(LogRecordHeader) - 1) & ~(sizeof(LogRecordHeader) - 1);
+}
+} // namespace
+
+namespace {
+size_t round_up_pow2(size_t n) {
+  size_t m = sizeof(LogRecordHeader) * 2;
+  for (; m < n; m <<= 1)
+    ;
+  return m;
+}
+} // namespace
+
+LogRing::LogRing(size_t capacity)
+    : written(0),
+      dropped(0),
+      buf_(std::make_unique<uint8_t[]>(round_up_pow2(capacity))),
+      mask_(round_up_pow2(capacity) - 1),
+      head_(0),
+      tail_(0),
+      closed_(false) {}
+
+namespace {
+int push_record(uint8_t *buf, size_t mask, std::atomic<size_t> &head_pos,
+                const std::atomic<size_t> &tail_pos, uint32_t type, int fd,
+                const uint8_t *data, size_t len) {
+  auto capacity = mask + 1;
+  auto need = align_record(sizeof(LogRecordHeader) + len);
+  auto head = head_pos.load(std::memory_order_relaxed);
+  auto tail = tail_pos.load(std::memory_order_acquire);
+  auto off = head & mask;
+  auto contiguous = capacity - off;
+  auto pad = contiguous < need ? contiguous : 0;
+
+  if (capacity - (head - tail) < need + pad) {
+    return -1;
+  }
+
+  if (pad) {
+    LogRecordHeader hd{LOG_RECORD_PAD, -1,
+                       static_cast<uint32_t>(pad - sizeof(LogRecordHeader))};
+    memcpy(buf + off, &hd, sizeof(hd));
+    head += pad;
+    off = 0;
+  }
+
+  LogRecordHeader hd{type, fd, static_cast<uint32_t>(len)};
+  memcpy(buf + off, &hd, sizeof(hd));
+  if (len) {
+    memcpy(buf + off + sizeof(hd), data, len);
+  }
+
+  head_pos.store(head + need, std::memory_order_release);
+
+  return 0;
+}
+} // namespace
+
+int LogRing::push(int fd, const uint8_t *data, size_t len) {
+  if (push_record(buf_.get(), mask_, head_, tail_, LOG_RECORD_DATA, fd, data,
+                  len) != 0) {
+    ++dropped;
+    return -1;
+  }
+
+  return 0;
+}
+
+int LogRing::push_close(int fd) {
+  return push_record(buf_.get(), mask_, head_, tail_, LOG_RECORD_CLOSE, fd,
+                     nullptr, 0);
+}
+
+namespace {
+void writev_all(int fd, struct iovec *iov, size_t iovcnt) {
+  while (iovcnt) {
+    ssize_t nwrite;
+    while ((nwrite = writev(fd, iov, iovcnt)) == -1 && errno == EINTR)
+      ;
+    if (nwrite == -1) {
+      return;
+    }
+
+    for (; iovcnt && static_cast<size_t>(nwrite) >= iov->iov_len;
+         ++iov, --iovcnt) {
+      nwrite -= iov->iov_len;
+    }
+
+    if (iovcnt) {
+      iov->iov_base = static_cast<uint8_t *>(iov->iov_base) + nwrite;
+      iov->iov_len -= nwrite;
+    }
+  }
+}
+} // namespace
+
+size_t LogRing::drain() {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  auto head = head_.load(std::memory_order_acquire);
+
+  std::array<struct iovec, 64> iov;
+  size_t iovcnt = 0;
+  int fd = -1;
+  size_t nbatch = 0;
+  size_t nproc = 0;
+
+  auto flush = [&]() {
+    if (iovcnt) {
+      writev_all(fd, iov.data(), iovcnt);
+      written += nbatch;
+      iovcnt = 0;
+      nbatch = 0;
+    }
+
+    // The space is reused by producer only after the data in it is
+    // written.
+    tail_.store(tail, std::memory_order_release);
+  };
+
+  while (tail != head) {
+    auto p = buf_.get() + (tail & mask_);
+    LogRecordHeader hd;
+    memcpy(&hd, p, sizeof(hd));
+
+    auto next = tail + align_record(sizeof(hd) + hd.len);
+
+    switch (hd.type) {
+    case LOG_RECORD_DATA:
+      if (iovcnt && (hd.fd != fd || iovcnt == iov.size())) {
+        flush();
+      }
+
+      fd = hd.fd;
+      iov[iovcnt++] = {p + sizeof(hd), hd.len};
+      ++nbatch;
+      ++nproc;
+
+      break;
+    case LOG_RECORD_CLOSE:
+      flush();
+
+      ::close(hd.fd);
+      ++nproc;
+
+      break;
+    }
+
+    tail = next;
+  }
+
+  flush();
+
+  return nproc;
+}
+
+bool LogRing::backlogged() const {
+  return get_head() - get_tail() > (mask_ + 1) / 2;
+}
+
+size_t LogRing::get_head() const {
+  return head_.load(std::memory_order_acquire);
+}
+
+size_t LogRing::get_tail() const {
+  return tail_.load(std::memory_order_acquire);
+}
+
+void LogRing::close() { closed_.store(true, std::memory_order_release); }
+
+bool LogRing::closed() const { return closed_.load(std::memory_order_acquire); }
+
+#ifndef NOTHREADS
+namespace {
+// The interval the writer thread wakes up at to write records if it
+// is not notified.  Records are batched in the meantime.
+constexpr auto WRITE_INTERVAL = std::chrono::milliseconds(10);
+} // namespace
+
+LogWriter::LogWriter(size_t ring_size)
+    : ring_size_(ring_size),
+      retired_written_(0),
+      retired_dropped_(0),
+      notified_(false),
+      running_(false) {}
+
+LogWriter::~LogWriter() { stop(); }
+
+void LogWriter::start() {
+  running_ = true;
+  thread_ = std::thread([this] { run(); });
+}
+
+void LogWriter::stop() {
+  {
+    std::lock_guard<std::mutex> g(mu_);
+    if (!running_) {
+      return;
+    }
+
+    running_ = false;
+    notified_ = true;
+  }
+
+  cond_.notify_one();
+
+  thread_.join();
+}
+
+std::shared_ptr<LogRing> LogWriter::make_ring() {
+  auto ring = std::make_shared<LogRing>(ring_size_);
+
+  std::lock_guard<std::mutex> g(mu_);
+  rings_.push_back(ring);
+
+  return ring;
+}
+
+void LogWriter::notify() {
+  {
+    std::lock_guard<std::mutex> g(mu_);
+    notified_ = true;
+  }
+
+  cond_.notify_one();
+}
+
+void LogWriter::flush(const LogRing &ring) {
+  auto head = ring.get_head();
+
+  std::unique_lock<std::mutex> lk(mu_);
+  if (!running_) {
+    return;
+  }
+
+  notified_ = true;
+  cond_.notify_one();
+
+  drained_cond_.wait(
+      lk, [this, &ring, head] { return ring.get_tail() == head || !running_; });
+}
+
+LogWriterStat LogWriter::get_stat() {
+  std::lock_guard<std::mutex> g(mu_);
+
+  LogWriterStat stat{retired_written_, retired_dropped_, 0};
+
+  for (auto &ring : rings_) {
+    stat.written += ring->written;
+    stat.dropped += ring->dropped;
+    stat.backlog += ring->get_head() - ring->get_tail();
+  }
+
+  return stat;
+}
+
+void LogWriter::run() {
+  std::vector<std::shared_ptr<LogRing>> rings;
+  std::unique_lock<std::mutex> lk(mu_);
+
+  for (;;) {
+    rings = rings_;
+    auto running = running_;
+    notified_ = false;
+
+    lk.unlock();
+
+    for (auto &ring : rings) {
+      ring->drain();
+    }
+
+    lk.lock();
+
+    // The owner thread of a closed ring has gone, and appends no more
+    // records.
+    rings_.erase(std::remove_if(std::begin(rings_), std::end(rings_),
+                                [this](const std::shared_ptr<LogRing> &ring) {
+                                  if (!ring->closed() ||
+                                      ring->get_head() != ring->get_tail()) {
+                                    return false;
+                                  }
+
+                                  retired_written_ += ring->written;
+                                  retired_dropped_ += ring->dropped;
+
+                                  return true;
+                                }),
+                 std::end(rings_));
+
+    drained_cond_.notify_all();
+
+    if (!running) {
+      return;
+    }
+
+    if (!notified_) {
+      cond_.wait_for(lk, WRITE_INTERVAL);
+    }
+  }
+}
+#endif // !NOTHREADS
+
+} // namespace shrpx
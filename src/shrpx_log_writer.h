@@ -0,0 +1,155 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_LOG_WRITER_H
+#define SHRPX_LOG_WRITER_H
+
+#include "shrpx.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#ifndef NOTHREADS
+#  include <thread>
+#  include <mutex>
+#  include <condition_variable>
+#endif // !NOTHREADS
+
+namespace shrpx {
+
+// LogRing is a single-producer single-consumer ring buffer of log
+// records.  The thread which owns it appends records without
+// locking, and LogWriter writes them out from its own thread.
+class LogRing {
+public:
+  // |capacity| is rounded up to the power of 2.
+  LogRing(size_t capacity);
+
+  LogRing(const LogRing &) = delete;
+  LogRing &operator=(const LogRing &) = delete;
+
+  // Appends a record which writes |data| of length |len| to |fd|.
+  // This function returns 0 if it succeeds, or -1 if there is no
+  // space left.  The dropped record is counted.
+  int push(int fd, const uint8_t *data, size_t len);
+  // Appends a request to close |fd| after all records appended
+  // before it are written.  This function returns 0 if it succeeds,
+  // or -1 if there is no space left.
+  int push_close(int fd);
+  // Writes out the records appended so far.  Only LogWriter calls
+  // this function.  This function returns the number of records
+  // processed.
+  size_t drain();
+
+  // Returns true if more than half of the capacity is used.
+  bool backlogged() const;
+
+  // Returns the position up to which records have been appended.
+  size_t get_head() const;
+  // Returns the position up to which records have been written.
+  size_t get_tail() const;
+
+  // Tells that the owner thread has gone, and this object is removed
+  // from LogWriter once it is drained.
+  void close();
+  bool closed() const;
+
+  // The number of records written, and the number of records dropped
+  // because the ring was full.
+  std::atomic<uint64_t> written;
+  std::atomic<uint64_t> dropped;
+
+private:
+  std::unique_ptr<uint8_t[]> buf_;
+  size_t mask_;
+  // head_ is only updated by producer, and tail_ is only updated by
+  // consumer.
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+  std::atomic<bool> closed_;
+};
+
+struct LogWriterStat {
+  // The number of records written.
+  uint64_t written;
+  // The number of records dropped because the ring of the thread was
+  // full.
+  uint64_t dropped;
+  // The number of bytes appended but not written yet.
+  uint64_t backlog;
+};
+
+#ifndef NOTHREADS
+// LogWriter owns a dedicated thread which writes log records
+// appended to LogRings by the other threads.  The records appended
+// to a ring are written in the order they were appended, and
+// consecutive records to the same file descriptor are written by a
+// single writev(2).
+class LogWriter {
+public:
+  // |ring_size| is the capacity of each LogRing.
+  LogWriter(size_t ring_size);
+  ~LogWriter();
+
+  LogWriter(const LogWriter &) = delete;
+  LogWriter &operator=(const LogWriter &) = delete;
+
+  // Starts the writer thread.
+  void start();
+  // Writes all records appended so far, and stops the writer thread.
+  void stop();
+
+  // Creates new LogRing, and starts writing the records appended to
+  // it.
+  std::shared_ptr<LogRing> make_ring();
+  // Wakes up the writer thread.
+  void notify();
+  // Blocks until all records appended to |ring| so far are written.
+  void flush(const LogRing &ring);
+
+  LogWriterStat get_stat();
+
+private:
+  void run();
+
+  size_t ring_size_;
+  std::thread thread_;
+  std::mutex mu_;
+  // Writer thread waits on cond_ for records.
+  std::condition_variable cond_;
+  // flush() waits on drained_cond_ for the writer thread to finish a
+  // pass.
+  std::condition_variable drained_cond_;
+  std::vector<std::shared_ptr<LogRing>> rings_;
+  // The statistics of the rings which have been removed.
+  uint64_t retired_written_;
+  uint64_t retired_dropped_;
+  bool notified_;
+  bool running_;
+};
+#endif // !NOTHREADS
+
+} // namespace shrpx
+
+#endif // SHRPX_LOG_WRITER_H
@@ -0,0 +1,158 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_log_writer_test.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <fcntl.h>
+
+#include <array>
+#include <string>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_log_writer.h"
+
+namespace shrpx {
+
+namespace {
+std::string read_all(int fd) {
+  std::string s;
+  std::array<char, 4096> buf;
+  ssize_t nread;
+
+  while ((nread = read(fd, buf.data(), buf.size())) > 0) {
+    s.append(buf.data(), nread);
+  }
+
+  return s;
+}
+} // namespace
+
+namespace {
+int push_str(LogRing &ring, int fd, const std::string &s) {
+  return ring.push(fd, reinterpret_cast<const uint8_t *>(s.c_str()), s.size());
+}
+} // namespace
+
+void test_shrpx_log_writer_ring(void) {
+  int pfd[2];
+
+  CU_ASSERT_FATAL(0 == pipe(pfd));
+  CU_ASSERT_FATAL(0 == fcntl(pfd[0], F_SETFL, O_NONBLOCK));
+
+  LogRing ring(256);
+
+  CU_ASSERT(0 == ring.drain());
+
+  // Records wrap around the end of buffer many times.
+  std::string expected;
+  for (size_t i = 0; i < 100; ++i) {
+    auto s = "record " + std::to_string(i) + "\n";
+
+    CU_ASSERT(0 == push_str(ring, pfd[1], s));
+    CU_ASSERT(1 == ring.drain());
+    CU_ASSERT(ring.get_head() == ring.get_tail());
+
+    expected += s;
+  }
+
+  CU_ASSERT(expected == read_all(pfd[0]));
+  CU_ASSERT(100 == ring.written);
+
+  // Records which do not fit are dropped.
+  auto s = std::string(100, 'a');
+
+  CU_ASSERT(0 == push_str(ring, pfd[1], s));
+  CU_ASSERT(0 == push_str(ring, pfd[1], s));
+  CU_ASSERT(-1 == push_str(ring, pfd[1], s));
+  CU_ASSERT(1 == ring.dropped);
+  CU_ASSERT(ring.backlogged());
+  CU_ASSERT(2 == ring.drain());
+  CU_ASSERT(!ring.backlogged());
+  CU_ASSERT(s + s == read_all(pfd[0]));
+
+  // The file descriptor is closed after the records before the
+  // request are written.
+  CU_ASSERT(0 == push_str(ring, pfd[1], "last\n"));
+  CU_ASSERT(0 == ring.push_close(pfd[1]));
+  CU_ASSERT(2 == ring.drain());
+  CU_ASSERT("last\n" == read_all(pfd[0]));
+
+  // EOF because the write end of pipe was closed.
+  std::array<char, 16> buf;
+  CU_ASSERT(0 == read(pfd[0], buf.data(), buf.size()));
+
+  close(pfd[0]);
+}
+
+void test_shrpx_log_writer(void) {
+#ifndef NOTHREADS
+  int pfd[2];
+
+  CU_ASSERT_FATAL(0 == pipe(pfd));
+  CU_ASSERT_FATAL(0 == fcntl(pfd[0], F_SETFL, O_NONBLOCK));
+
+  LogWriter writer(4096);
+  writer.start();
+
+  auto ring1 = writer.make_ring();
+  auto ring2 = writer.make_ring();
+
+  CU_ASSERT(0 == push_str(*ring1, pfd[1], "a\n"));
+  CU_ASSERT(0 == push_str(*ring2, pfd[1], "b\n"));
+  CU_ASSERT(0 == push_str(*ring1, pfd[1], "c\n"));
+
+  writer.flush(*ring1);
+  writer.flush(*ring2);
+
+  auto s = read_all(pfd[0]);
+
+  CU_ASSERT(6 == s.size());
+  // The records from a ring are written in order.
+  CU_ASSERT(s.find("a\n") < s.find("c\n"));
+  CU_ASSERT(std::string::npos != s.find("b\n"));
+
+  ring2->close();
+
+  CU_ASSERT(0 == push_str(*ring1, pfd[1], "d\n"));
+
+  writer.stop();
+
+  CU_ASSERT("d\n" == read_all(pfd[0]));
+
+  auto stat = writer.get_stat();
+
+  CU_ASSERT(4 == stat.written);
+  CU_ASSERT(0 == stat.dropped);
+  CU_ASSERT(0 == stat.backlog);
+
+  close(pfd[1]);
+  close(pfd[0]);
+#endif // !NOTHREADS
+}
+
+} // namespace shrpx
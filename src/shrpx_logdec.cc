@@ -0,0 +1,245 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif // HAVE_CONFIG_H
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif // HAVE_FCNTL_H
+#include <getopt.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "shrpx_binlog.h"
+#include "shrpx_config.h"
+#include "allocator.h"
+#include "template.h"
+
+namespace shrpx {
+
+namespace {
+struct LogDecConfig {
+  StringRef format;
+  bool json;
+} config;
+} // namespace
+
+namespace {
+// Decodes binary access log read from |fd| and writes it to stdout.
+// |name| is used in error messages.  This function returns 0 if it
+// succeeds, or -1.
+int decode(int fd, const char *name, const std::vector<LogFragment> &lfv) {
+  std::vector<uint8_t> buf;
+  std::vector<BinaryLogField> fields;
+  std::string out;
+  size_t pos = 0;
+  uint64_t nrecord = 0;
+  // true if the file header has been read.
+  bool header = false;
+
+  for (;;) {
+    // Move the incomplete record to the beginning of the buffer.
+    buf.erase(std::begin(buf), std::begin(buf) + pos);
+    pos = 0;
+
+    auto len = buf.size();
+    buf.resize(len + 64_k);
+
+    ssize_t nread;
+    while ((nread = read(fd, buf.data() + len, 64_k)) == -1 && errno == EINTR)
+      ;
+    if (nread == -1) {
+      auto error = errno;
+      std::cerr << name << ": read error: " << strerror(error) << std::endl;
+      return -1;
+    }
+
+    buf.resize(len + nread);
+
+    for (;;) {
+      // The file header appears at the beginning, and possibly
+      // between records if files are concatenated.
+      if (pos < buf.size() && (!header || buf[pos] == BINLOG_MAGIC[0])) {
+        auto n =
+            binlog_decode_file_header(buf.data() + pos, buf.size() - pos);
+        if (n == 0) {
+          break;
+        }
+        if (n == -1) {
+          std::cerr << name << ": not a binary access log" << std::endl;
+          return -1;
+        }
+        if (n == -2) {
+          std::cerr << name << ": unsupported binary access log version"
+                    << std::endl;
+          return -1;
+        }
+
+        pos += n;
+        header = true;
+
+        continue;
+      }
+
+      auto n = binlog_decode_record(fields, buf.data() + pos, buf.size() - pos);
+      if (n == 0) {
+        break;
+      }
+
+      ++nrecord;
+
+      out.clear();
+      if (n == -1 ||
+          (config.json ? binlog_format_json(out, lfv, fields)
+                       : binlog_format_text(out, lfv, fields)) != 0) {
+        std::cerr << name << ": record " << nrecord
+                  << " does not match the format" << std::endl;
+        return -1;
+      }
+
+      out += '\n';
+      std::cout << out;
+
+      pos += n;
+    }
+
+    if (nread == 0) {
+      break;
+    }
+  }
+
+  if (pos != buf.size()) {
+    std::cerr << name << ": the last record is truncated" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+} // namespace
+
+namespace {
+void print_help(std::ostream &out) {
+  out << R"(Usage: nghttpx-logdec [OPTIONS]... [FILE]...
+Decode nghttpx access log written with --accesslog-binary.
+
+Reads  binary  access log  from  FILEs,  or from  stdin if  FILE  is
+omitted, and writes it to stdout one record per line.
+
+Options:
+  --format=<FORMAT>
+              Specify  the format  used  to write  the  access log.  It
+              must be the same as --accesslog-format given to nghttpx.
+              Default: )"
+      << DEFAULT_ACCESSLOG_FORMAT << R"(
+  --json      Output  each  record  as a  JSON object  whose keys  are
+              variable names in --format.
+  -h, --help  Display this help and exit.)"
+      << std::endl;
+}
+} // namespace
+
+namespace {
+int main(int argc, char **argv) {
+  config.format = DEFAULT_ACCESSLOG_FORMAT;
+
+  for (;;) {
+    static int flag = 0;
+    constexpr static option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"format", required_argument, &flag, 1},
+        {"json", no_argument, &flag, 2},
+        {nullptr, 0, nullptr, 0}};
+
+    int option_index = 0;
+    auto c = getopt_long(argc, argv, "h", long_options, &option_index);
+    if (c == -1) {
+      break;
+    }
+    switch (c) {
+    case 'h':
+      print_help(std::cout);
+      exit(EXIT_SUCCESS);
+    case '?':
+      exit(EXIT_FAILURE);
+    case 0:
+      switch (flag) {
+      case 1:
+        // --format
+        config.format = StringRef{optarg};
+        break;
+      case 2:
+        // --json
+        config.json = true;
+        break;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  BlockAllocator balloc(1024, 1024);
+  auto lfv = parse_log_format(balloc, config.format);
+
+  if (optind == argc) {
+    return decode(STDIN_FILENO, "stdin", lfv) == 0 ? EXIT_SUCCESS
+                                                   : EXIT_FAILURE;
+  }
+
+  auto rv = EXIT_SUCCESS;
+
+  for (; optind < argc; ++optind) {
+    auto path = argv[optind];
+    auto fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      auto error = errno;
+      std::cerr << path << ": could not open file: " << strerror(error)
+                << std::endl;
+      rv = EXIT_FAILURE;
+      continue;
+    }
+
+    if (decode(fd, path, lfv) != 0) {
+      rv = EXIT_FAILURE;
+    }
+
+    close(fd);
+  }
+
+  return rv;
+}
+} // namespace
+
+} // namespace shrpx
+
+int main(int argc, char **argv) { return run_app(shrpx::main, argc, argv); }
@@ -0,0 +1,118 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_maglev.h"
+
+#include <array>
+#include <limits>
+
+#include "util.h"
+
+namespace shrpx {
+
+namespace {
+constexpr size_t MAGLEV_TABLE_SIZES[] = {
+    251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071,
+};
+} // namespace
+
+size_t maglev_table_size(size_t total_weight) {
+  for (auto n : MAGLEV_TABLE_SIZES) {
+    if (n >= total_weight * 100) {
+      return n;
+    }
+  }
+
+  return MAGLEV_TABLE_SIZES[array_size(MAGLEV_TABLE_SIZES) - 1];
+}
+
+namespace {
+uint32_t get_uint32(const uint8_t *p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+} // namespace
+
+int compute_maglev_table(std::vector<uint32_t> &table,
+                         const std::vector<MaglevBackend> &backends) {
+  table.clear();
+
+  if (backends.empty()) {
+    return 0;
+  }
+
+  size_t total_weight = 0;
+  for (auto &b : backends) {
+    total_weight += b.weight;
+  }
+
+  auto m = maglev_table_size(total_weight);
+
+  // The permutation of backend i is offset[i] + j * skip[i] (mod m)
+  // for j = 0, 1, ...  next[i] is j to try next.
+  std::vector<uint64_t> offset(backends.size());
+  std::vector<uint64_t> skip(backends.size());
+  std::vector<uint64_t> next(backends.size());
+
+  for (size_t i = 0; i < backends.size(); ++i) {
+    std::array<uint8_t, 32> buf;
+
+    if (util::sha256(buf.data(), backends[i].key) != 0) {
+      return -1;
+    }
+
+    offset[i] = get_uint32(buf.data()) % m;
+    skip[i] = get_uint32(buf.data() + 4) % (m - 1) + 1;
+  }
+
+  constexpr auto EMPTY = std::numeric_limits<uint32_t>::max();
+
+  table.assign(m, EMPTY);
+
+  size_t filled = 0;
+
+  for (;;) {
+    for (size_t i = 0; i < backends.size(); ++i) {
+      for (size_t k = 0; k < backends[i].weight; ++k) {
+        size_t c;
+        for (;;) {
+          c = (offset[i] + next[i] * skip[i]) % m;
+          ++next[i];
+          if (table[c] == EMPTY) {
+            break;
+          }
+        }
+
+        table[c] = i;
+
+        if (++filled == m) {
+          return 0;
+        }
+      }
+    }
+  }
+}
+
+} // namespace shrpx
@@ -0,0 +1,61 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_MAGLEV_H
+#define SHRPX_MAGLEV_H
+
+#include "shrpx.h"
+
+#include <vector>
+
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+struct MaglevBackend {
+  // The key which identifies a backend, such as its address.
+  StringRef key;
+  // The weight of a backend.  It gets the entries of a lookup table
+  // in proportion to this value.  It must be at least 1.
+  uint32_t weight;
+};
+
+// Returns the size of Maglev lookup table for the sum of weights
+// |total_weight|.  It is a prime number at least 100 times as large
+// as |total_weight| unless it hits the upper bound.
+size_t maglev_table_size(size_t total_weight);
+
+// Populates Maglev lookup table |table| for |backends| as described
+// in "Maglev: A Fast and Reliable Software Network Load Balancer"
+// (NSDI 2016).  Each entry is an index into |backends|.  Adding or
+// removing a backend only moves a small portion of entries.  This
+// function returns 0 if it succeeds, or -1.
+int compute_maglev_table(std::vector<uint32_t> &table,
+                         const std::vector<MaglevBackend> &backends);
+
+} // namespace shrpx
+
+#endif // SHRPX_MAGLEV_H
@@ -0,0 +1,104 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_maglev_test.h"
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_maglev.h"
+
+namespace shrpx {
+
+void test_shrpx_maglev_table_size(void) {
+  CU_ASSERT(251 == maglev_table_size(1));
+  CU_ASSERT(509 == maglev_table_size(3));
+  CU_ASSERT(65521 == maglev_table_size(655));
+  CU_ASSERT(131071 == maglev_table_size(656));
+  CU_ASSERT(131071 == maglev_table_size(100000));
+}
+
+namespace {
+std::vector<size_t> count_entries(const std::vector<uint32_t> &table,
+                                  size_t n) {
+  std::vector<size_t> res(n);
+  for (auto idx : table) {
+    ++res[idx];
+  }
+  return res;
+}
+} // namespace
+
+void test_shrpx_maglev_compute_table(void) {
+  std::vector<uint32_t> table;
+
+  CU_ASSERT(0 == compute_maglev_table(table, {}));
+  CU_ASSERT(table.empty());
+
+  std::vector<MaglevBackend> backends{
+      {StringRef::from_lit("127.0.0.1:8080"), 1},
+      {StringRef::from_lit("127.0.0.1:8081"), 1},
+      {StringRef::from_lit("127.0.0.1:8082"), 1},
+      {StringRef::from_lit("127.0.0.1:8083"), 1},
+  };
+
+  CU_ASSERT(0 == compute_maglev_table(table, backends));
+  CU_ASSERT(509 == table.size());
+
+  // Each backend gets the same number of entries, give or take 1.
+  for (auto n : count_entries(table, backends.size())) {
+    CU_ASSERT(127 == n || 128 == n);
+  }
+
+  // Removing the last backend only moves its entries, and a few
+  // others.
+  auto removed = backends;
+  removed.pop_back();
+
+  std::vector<uint32_t> removed_table;
+
+  CU_ASSERT(0 == compute_maglev_table(removed_table, removed));
+  CU_ASSERT(509 == removed_table.size());
+
+  size_t moved = 0;
+  for (size_t i = 0; i < table.size(); ++i) {
+    if (table[i] != 3 && table[i] != removed_table[i]) {
+      ++moved;
+    }
+  }
+
+  CU_ASSERT(moved < table.size() / 10);
+
+  // Weight
+  backends[0].weight = 3;
+
+  CU_ASSERT(0 == compute_maglev_table(table, backends));
+  CU_ASSERT(1021 == table.size());
+
+  auto counts = count_entries(table, backends.size());
+
+  CU_ASSERT(counts[0] >= 3 * counts[1] - 3);
+  CU_ASSERT(counts[0] <= 3 * counts[1] + 3);
+}
+
+} // namespace shrpx
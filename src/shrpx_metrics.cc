@@ -0,0 +1,493 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_metrics.h"
+
+#include <algorithm>
+
+#include "shrpx_config.h"
+#include "shrpx_log.h"
+#include "shrpx_worker.h"
+#include "util.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+void LatencyHistogram::observe(uint64_t us) {
+  auto idx =
+      std::lower_bound(std::begin(LATENCY_BUCKETS), std::end(LATENCY_BUCKETS),
+                       us) -
+      std::begin(LATENCY_BUCKETS);
+
+  stat_add(buckets[idx]);
+  stat_add(sum, us);
+}
+
+BackendStatSet::BackendStatSet(std::shared_ptr<DownstreamConfig> downstreamconf)
+    : downstreamconf(std::move(downstreamconf)),
+      groups(this->downstreamconf->addr_groups.size()) {}
+
+namespace {
+template <typename T> uint64_t get(const std::atomic<T> &c) {
+  return c.load(std::memory_order_relaxed);
+}
+} // namespace
+
+namespace {
+template <typename T>
+void copy_counter(std::atomic<T> &dst, const std::atomic<T> &src) {
+  dst.store(src.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+} // namespace
+
+void copy_backend_stat(BackendStat &dst, const BackendStat &src) {
+  for (size_t i = 0; i < dst.responses.size(); ++i) {
+    copy_counter(dst.responses[i], src.responses[i]);
+  }
+  for (size_t i = 0; i < dst.latency.buckets.size(); ++i) {
+    copy_counter(dst.latency.buckets[i], src.latency.buckets[i]);
+  }
+  copy_counter(dst.latency.sum, src.latency.sum);
+  copy_counter(dst.connect_failures, src.connect_failures);
+}
+
+void add_worker_metrics(Metrics &m, const WorkerStat &stat,
+                        const MemchunkPool &mcpool,
+                        const BackendStatSet *stat_set) {
+  ++m.workers;
+  m.connections += get(stat.num_connections);
+  m.connections_total += get(stat.connections_total);
+  m.streams += get(stat.num_streams);
+  m.requests_total += get(stat.requests_total);
+  for (size_t i = 0; i < m.responses.size(); ++i) {
+    m.responses[i] += get(stat.responses[i]);
+  }
+  m.request_body_bytes += get(stat.request_body_bytes);
+  m.response_body_bytes += get(stat.response_body_bytes);
+  m.tls_handshakes += get(stat.tls_handshakes);
+  m.tls_resumed_handshakes += get(stat.tls_resumed_handshakes);
+  m.response_cache_hits += get(stat.response_cache_hits);
+  m.response_cache_misses += get(stat.response_cache_misses);
+  m.collapsed_requests += get(stat.collapsed_requests);
+  m.compressed_responses += get(stat.compressed_responses);
+  m.compression_in_bytes += get(stat.compression_in_bytes);
+  m.compression_out_bytes += get(stat.compression_out_bytes);
+  m.zerocopy_sends += get(stat.zerocopy_sends);
+  m.zerocopy_copied += get(stat.zerocopy_copied);
+  m.mcpool_bytes += get(mcpool.poolsize);
+  m.mcpool_free_bytes += get(mcpool.freelistsize);
+  m.mcpool_trimmed_bytes += get(mcpool.trimmed);
+
+  MemchunkPoolMetrics wm{};
+  wm.bytes = get(mcpool.poolsize);
+  wm.free_bytes = get(mcpool.freelistsize);
+
+  for (size_t i = 0; i < m.mcpool_chunks.size(); ++i) {
+    auto chunks = get(mcpool.chunks[i]);
+    auto free_chunks = get(mcpool.free_chunks[i]);
+    m.mcpool_chunks[i] += chunks;
+    m.mcpool_free_chunks[i] += free_chunks;
+    wm.chunks += chunks;
+    wm.free_chunks += free_chunks;
+  }
+
+  m.worker_mcpools.push_back(wm);
+
+  if (!stat_set) {
+    return;
+  }
+
+  auto &addr_groups = stat_set->downstreamconf->addr_groups;
+
+  for (size_t i = 0; i < stat_set->groups.size(); ++i) {
+    auto &src = stat_set->groups[i];
+    auto &pattern = addr_groups[i].pattern;
+    auto &dst = m.backends[std::string{std::begin(pattern), std::end(pattern)}];
+
+    for (size_t j = 0; j < dst.responses.size(); ++j) {
+      dst.responses[j] += get(src.responses[j]);
+    }
+    for (size_t j = 0; j < dst.latency_buckets.size(); ++j) {
+      dst.latency_buckets[j] += get(src.latency.buckets[j]);
+    }
+    dst.latency_sum += get(src.latency.sum);
+    dst.connect_failures += get(src.connect_failures);
+    dst.blocked_addrs += get(src.blocked_addrs);
+  }
+}
+
+namespace {
+void write_header(std::string &out, const StringRef &name,
+                  const StringRef &help, const StringRef &type) {
+  out += "# HELP ";
+  out.append(std::begin(name), std::end(name));
+  out += ' ';
+  out.append(std::begin(help), std::end(help));
+  out += "\n# TYPE ";
+  out.append(std::begin(name), std::end(name));
+  out += ' ';
+  out.append(std::begin(type), std::end(type));
+  out += '\n';
+}
+} // namespace
+
+namespace {
+// Writes a metric which has no label.
+void write_metric(std::string &out, const StringRef &name,
+                  const StringRef &help, const StringRef &type,
+                  uint64_t value) {
+  write_header(out, name, help, type);
+  out.append(std::begin(name), std::end(name));
+  out += ' ';
+  out += util::utos(value);
+  out += '\n';
+}
+} // namespace
+
+namespace {
+// Writes a gauge which has a value per size class of MemchunkPool.
+void write_size_class_metric(
+    std::string &out, const StringRef &name, const StringRef &help,
+    const std::array<uint64_t, MEMCHUNK_SIZE_CLASSES.size()> &values) {
+  write_header(out, name, help, StringRef::from_lit("gauge"));
+  for (size_t i = 0; i < values.size(); ++i) {
+    out.append(std::begin(name), std::end(name));
+    out += "{size=\"";
+    out += util::utos(MEMCHUNK_SIZE_CLASSES[i]);
+    out += "\"} ";
+    out += util::utos(values[i]);
+    out += '\n';
+  }
+}
+} // namespace
+
+namespace {
+constexpr StringRef MCPOOL_STATES[] = {
+    StringRef::from_lit("allocated"),
+    StringRef::from_lit("pooled"),
+    StringRef::from_lit("in_use"),
+};
+} // namespace
+
+namespace {
+// Writes a gauge which has a value per worker and state of its
+// MemchunkPool.  |total| and |free| are the members of
+// MemchunkPoolMetrics for allocated and pooled values.
+void write_worker_mcpool_metric(std::string &out, const StringRef &name,
+                                const StringRef &help,
+                                const std::vector<MemchunkPoolMetrics> &v,
+                                uint64_t MemchunkPoolMetrics::*total,
+                                uint64_t MemchunkPoolMetrics::*free) {
+  write_header(out, name, help, StringRef::from_lit("gauge"));
+  for (size_t i = 0; i < v.size(); ++i) {
+    auto allocated = v[i].*total;
+    auto pooled = v[i].*free;
+    // The counters are read without synchronization, and pooled may
+    // be slightly larger than allocated.
+    auto in_use = allocated > pooled ? allocated - pooled : 0;
+    uint64_t values[] = {allocated, pooled, in_use};
+
+    for (size_t j = 0; j < array_size(values); ++j) {
+      out.append(std::begin(name), std::end(name));
+      out += "{worker=\"";
+      out += util::utos(i);
+      out += "\",state=\"";
+      out.append(std::begin(MCPOOL_STATES[j]), std::end(MCPOOL_STATES[j]));
+      out += "\"} ";
+      out += util::utos(values[j]);
+      out += '\n';
+    }
+  }
+}
+} // namespace
+
+namespace {
+// Appends |s| as label value, escaping backslash, double quote and
+// line feed.
+void append_label_value(std::string &out, const std::string &s) {
+  out += '"';
+  for (auto c : s) {
+    switch (c) {
+    case '\\':
+      out += "\\\\";
+      break;
+    case '"':
+      out += "\\\"";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    default:
+      out += c;
+    }
+  }
+  out += '"';
+}
+} // namespace
+
+namespace {
+// Appends |us| microseconds in seconds.
+void append_seconds(std::string &out, uint64_t us) {
+  out += util::utos(us / 1000000);
+
+  auto frac = us % 1000000;
+  if (frac == 0) {
+    return;
+  }
+
+  std::array<char, 6> buf;
+  for (auto i = buf.size(); i > 0; --i) {
+    buf[i - 1] = '0' + frac % 10;
+    frac /= 10;
+  }
+
+  auto last = std::end(buf);
+  for (; *(last - 1) == '0'; --last)
+    ;
+
+  out += '.';
+  out.append(std::begin(buf), last);
+}
+} // namespace
+
+namespace {
+constexpr StringRef STATUS_CLASSES[] = {
+    StringRef::from_lit("1xx"), StringRef::from_lit("2xx"),
+    StringRef::from_lit("3xx"), StringRef::from_lit("4xx"),
+    StringRef::from_lit("5xx"),
+};
+} // namespace
+
+void format_metrics(std::string &out, const Metrics &m) {
+  write_metric(out, StringRef::from_lit("nghttpx_workers"),
+               StringRef::from_lit("The number of worker threads."),
+               StringRef::from_lit("gauge"), m.workers);
+  write_metric(out, StringRef::from_lit("nghttpx_client_connections"),
+               StringRef::from_lit("The number of open client connections."),
+               StringRef::from_lit("gauge"), m.connections);
+  write_metric(out, StringRef::from_lit("nghttpx_client_connections_total"),
+               StringRef::from_lit("The number of accepted client "
+                                   "connections."),
+               StringRef::from_lit("counter"), m.connections_total);
+  write_metric(out, StringRef::from_lit("nghttpx_streams"),
+               StringRef::from_lit("The number of requests in flight."),
+               StringRef::from_lit("gauge"), m.streams);
+  write_metric(out, StringRef::from_lit("nghttpx_requests_total"),
+               StringRef::from_lit("The number of requests received."),
+               StringRef::from_lit("counter"), m.requests_total);
+
+  write_header(out, StringRef::from_lit("nghttpx_responses_total"),
+               StringRef::from_lit("The number of responses by status "
+                                   "class."),
+               StringRef::from_lit("counter"));
+  for (size_t i = 0; i < m.responses.size(); ++i) {
+    out += "nghttpx_responses_total{code=\"";
+    out.append(std::begin(STATUS_CLASSES[i]), std::end(STATUS_CLASSES[i]));
+    out += "\"} ";
+    out += util::utos(m.responses[i]);
+    out += '\n';
+  }
+
+  write_metric(out, StringRef::from_lit("nghttpx_request_body_bytes_total"),
+               StringRef::from_lit("The number of request body bytes "
+                                   "received from clients."),
+               StringRef::from_lit("counter"), m.request_body_bytes);
+  write_metric(out, StringRef::from_lit("nghttpx_response_body_bytes_total"),
+               StringRef::from_lit("The number of response body bytes "
+                                   "sent to clients."),
+               StringRef::from_lit("counter"), m.response_body_bytes);
+  write_metric(out, StringRef::from_lit("nghttpx_tls_handshakes_total"),
+               StringRef::from_lit("The number of completed TLS handshakes "
+                                   "with clients."),
+               StringRef::from_lit("counter"), m.tls_handshakes);
+  write_metric(out,
+               StringRef::from_lit("nghttpx_tls_resumed_handshakes_total"),
+               StringRef::from_lit("The number of TLS handshakes with "
+                                   "clients which resumed a session."),
+               StringRef::from_lit("counter"), m.tls_resumed_handshakes);
+  write_metric(out, StringRef::from_lit("nghttpx_response_cache_hits_total"),
+               StringRef::from_lit("The number of responses served from "
+                                   "response cache."),
+               StringRef::from_lit("counter"), m.response_cache_hits);
+  write_metric(out,
+               StringRef::from_lit("nghttpx_response_cache_misses_total"),
+               StringRef::from_lit("The number of cacheable requests not "
+                                   "found in response cache."),
+               StringRef::from_lit("counter"), m.response_cache_misses);
+  write_metric(out, StringRef::from_lit("nghttpx_collapsed_requests_total"),
+               StringRef::from_lit("The number of requests collapsed into "
+                                   "an identical request in flight."),
+               StringRef::from_lit("counter"), m.collapsed_requests);
+  write_metric(out, StringRef::from_lit("nghttpx_compressed_responses_total"),
+               StringRef::from_lit("The number of responses compressed by "
+                                   "nghttpx."),
+               StringRef::from_lit("counter"), m.compressed_responses);
+  write_metric(out,
+               StringRef::from_lit("nghttpx_compression_in_bytes_total"),
+               StringRef::from_lit("The number of response bytes before "
+                                   "compression."),
+               StringRef::from_lit("counter"), m.compression_in_bytes);
+  write_metric(out,
+               StringRef::from_lit("nghttpx_compression_out_bytes_total"),
+               StringRef::from_lit("The number of response bytes after "
+                                   "compression."),
+               StringRef::from_lit("counter"), m.compression_out_bytes);
+  write_metric(out, StringRef::from_lit("nghttpx_zerocopy_sends_total"),
+               StringRef::from_lit("The number of sends to clients with "
+                                   "MSG_ZEROCOPY."),
+               StringRef::from_lit("counter"), m.zerocopy_sends);
+  write_metric(out, StringRef::from_lit("nghttpx_zerocopy_copied_total"),
+               StringRef::from_lit("The number of sends with MSG_ZEROCOPY "
+                                   "which fell back to copying data."),
+               StringRef::from_lit("counter"), m.zerocopy_copied);
+  write_metric(out, StringRef::from_lit("nghttpx_memchunk_pool_bytes"),
+               StringRef::from_lit("The number of bytes allocated by buffer "
+                                   "pools."),
+               StringRef::from_lit("gauge"), m.mcpool_bytes);
+  write_metric(out, StringRef::from_lit("nghttpx_memchunk_pool_free_bytes"),
+               StringRef::from_lit("The number of bytes in buffer pools "
+                                   "which are not in use."),
+               StringRef::from_lit("gauge"), m.mcpool_free_bytes);
+  write_size_class_metric(
+      out, StringRef::from_lit("nghttpx_memchunk_pool_chunks"),
+      StringRef::from_lit("The number of buffers allocated by buffer pools "
+                          "by size in bytes."),
+      m.mcpool_chunks);
+  write_size_class_metric(
+      out, StringRef::from_lit("nghttpx_memchunk_pool_free_chunks"),
+      StringRef::from_lit("The number of buffers in buffer pools which are "
+                          "not in use by size in bytes."),
+      m.mcpool_free_chunks);
+  write_metric(out,
+               StringRef::from_lit("nghttpx_memchunk_pool_trimmed_bytes_total"),
+               StringRef::from_lit("The number of bytes of unused buffers "
+                                   "freed by buffer pool watermarks."),
+               StringRef::from_lit("counter"), m.mcpool_trimmed_bytes);
+  write_worker_mcpool_metric(
+      out, StringRef::from_lit("nghttpx_worker_memchunk_pool_bytes"),
+      StringRef::from_lit("The number of bytes of buffer pool by worker and "
+                          "state."),
+      m.worker_mcpools, &MemchunkPoolMetrics::bytes,
+      &MemchunkPoolMetrics::free_bytes);
+  write_worker_mcpool_metric(
+      out, StringRef::from_lit("nghttpx_worker_memchunk_pool_chunks"),
+      StringRef::from_lit("The number of buffers of buffer pool by worker "
+                          "and state."),
+      m.worker_mcpools, &MemchunkPoolMetrics::chunks,
+      &MemchunkPoolMetrics::free_chunks);
+  write_metric(out,
+               StringRef::from_lit("nghttpx_log_records_written_total"),
+               StringRef::from_lit("The number of log records written by "
+                                   "the log writer thread."),
+               StringRef::from_lit("counter"), m.log_written);
+  write_metric(out,
+               StringRef::from_lit("nghttpx_log_records_dropped_total"),
+               StringRef::from_lit("The number of log records dropped "
+                                   "because log buffer was full."),
+               StringRef::from_lit("counter"), m.log_dropped);
+
+  if (m.backends.empty()) {
+    return;
+  }
+
+  write_header(out, StringRef::from_lit("nghttpx_backend_responses_total"),
+               StringRef::from_lit("The number of responses by backend "
+                                   "group and status class."),
+               StringRef::from_lit("counter"));
+  for (auto &kv : m.backends) {
+    for (size_t i = 0; i < kv.second.responses.size(); ++i) {
+      out += "nghttpx_backend_responses_total{backend=";
+      append_label_value(out, kv.first);
+      out += ",code=\"";
+      out.append(std::begin(STATUS_CLASSES[i]), std::end(STATUS_CLASSES[i]));
+      out += "\"} ";
+      out += util::utos(kv.second.responses[i]);
+      out += '\n';
+    }
+  }
+
+  write_header(
+      out, StringRef::from_lit("nghttpx_backend_request_duration_seconds"),
+      StringRef::from_lit("The time from the start of request to the end "
+                          "of response by backend group."),
+      StringRef::from_lit("histogram"));
+  for (auto &kv : m.backends) {
+    auto &b = kv.second;
+    uint64_t count = 0;
+    for (size_t i = 0; i < b.latency_buckets.size(); ++i) {
+      count += b.latency_buckets[i];
+      out += "nghttpx_backend_request_duration_seconds_bucket{backend=";
+      append_label_value(out, kv.first);
+      out += ",le=\"";
+      if (i < LATENCY_BUCKETS.size()) {
+        append_seconds(out, LATENCY_BUCKETS[i]);
+      } else {
+        out += "+Inf";
+      }
+      out += "\"} ";
+      out += util::utos(count);
+      out += '\n';
+    }
+    out += "nghttpx_backend_request_duration_seconds_sum{backend=";
+    append_label_value(out, kv.first);
+    out += "} ";
+    append_seconds(out, b.latency_sum);
+    out += '\n';
+    out += "nghttpx_backend_request_duration_seconds_count{backend=";
+    append_label_value(out, kv.first);
+    out += "} ";
+    out += util::utos(count);
+    out += '\n';
+  }
+
+  write_header(out,
+               StringRef::from_lit("nghttpx_backend_connect_failures_total"),
+               StringRef::from_lit("The number of failed attempts to "
+                                   "connect to backend by backend group."),
+               StringRef::from_lit("counter"));
+  for (auto &kv : m.backends) {
+    out += "nghttpx_backend_connect_failures_total{backend=";
+    append_label_value(out, kv.first);
+    out += "} ";
+    out += util::utos(kv.second.connect_failures);
+    out += '\n';
+  }
+
+  write_header(out, StringRef::from_lit("nghttpx_backend_blocked_addresses"),
+               StringRef::from_lit("The number of backend addresses which "
+                                   "are blocked after connection failures "
+                                   "or considered offline, summed over "
+                                   "workers."),
+               StringRef::from_lit("gauge"));
+  for (auto &kv : m.backends) {
+    out += "nghttpx_backend_blocked_addresses{backend=";
+    append_label_value(out, kv.first);
+    out += "} ";
+    out += util::utos(kv.second.blocked_addrs);
+    out += '\n';
+  }
+}
+
+} // namespace shrpx
@@ -0,0 +1,183 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_METRICS_H
+#define SHRPX_METRICS_H
+
+#include "shrpx.h"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "memchunk.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+struct DownstreamConfig;
+struct WorkerStat;
+
+// Adds |n| to the counter |c|.  A counter is updated only by the
+// thread which owns it, and the other threads just read it.  Thus
+// this does not need atomic read-modify-write.
+template <typename T, typename U = T>
+void stat_add(std::atomic<T> &c, U n = 1) {
+  c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Subtracts |n| from the counter |c|.  The same rule as stat_add
+// applies.
+template <typename T, typename U = T>
+void stat_sub(std::atomic<T> &c, U n = 1) {
+  c.store(c.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+}
+
+// The upper bounds of latency histogram buckets in microseconds.
+constexpr std::array<uint64_t, 11> LATENCY_BUCKETS{
+    5000,   10000,   25000,   50000,   100000,  250000,
+    500000, 1000000, 2500000, 5000000, 10000000,
+};
+
+struct LatencyHistogram {
+  // Adds a sample |us| in microseconds.
+  void observe(uint64_t us);
+
+  // The number of samples which fall in each bucket.  It is not
+  // cumulative.  The last one is for the samples greater than the
+  // largest bound.
+  std::array<std::atomic<uint64_t>, LATENCY_BUCKETS.size() + 1> buckets;
+  // The sum of samples in microseconds.
+  std::atomic<uint64_t> sum;
+};
+
+// Statistics of a backend group, which is a pattern in --backend, in
+// a worker.
+struct BackendStat {
+  // The number of responses by status class, from 1xx to 5xx.
+  std::array<std::atomic<uint64_t>, 5> responses;
+  // The time from the start of request to the end of response.
+  LatencyHistogram latency;
+  // The number of failed attempts to connect to backend.  If patterns
+  // share the same set of backend addresses, they are counted in the
+  // first pattern.
+  std::atomic<uint64_t> connect_failures;
+  // The number of backend addresses which are currently blocked by
+  // ConnectBlocker.  Counted in the same way as connect_failures.
+  std::atomic<size_t> blocked_addrs;
+};
+
+// Copies the cumulative counters of |src| to |dst|.  blocked_addrs
+// is not copied because it is counted again for the new group.
+void copy_backend_stat(BackendStat &dst, const BackendStat &src);
+
+// BackendStatSet holds BackendStat of all backend groups in a worker.
+// It is replaced when backend configuration is replaced.
+struct BackendStatSet {
+  BackendStatSet(std::shared_ptr<DownstreamConfig> downstreamconf);
+
+  // The configuration which backend groups are created from.  The
+  // name of groups[i] is downstreamconf->addr_groups[i].pattern.
+  std::shared_ptr<DownstreamConfig> downstreamconf;
+  std::vector<BackendStat> groups;
+};
+
+struct BackendMetrics {
+  std::array<uint64_t, 5> responses;
+  std::array<uint64_t, LATENCY_BUCKETS.size() + 1> latency_buckets;
+  uint64_t latency_sum;
+  uint64_t connect_failures;
+  uint64_t blocked_addrs;
+};
+
+// The usage of MemchunkPool of a worker.
+struct MemchunkPoolMetrics {
+  // The number of bytes allocated, and the number of bytes of them
+  // which are not in use.
+  uint64_t bytes;
+  uint64_t free_bytes;
+  // The number of chunks allocated, and the number of them which are
+  // not in use.
+  uint64_t chunks;
+  uint64_t free_chunks;
+};
+
+// Metrics is the sum of statistics of all workers.
+struct Metrics {
+  size_t workers;
+  uint64_t connections;
+  uint64_t connections_total;
+  uint64_t streams;
+  uint64_t requests_total;
+  std::array<uint64_t, 5> responses;
+  uint64_t request_body_bytes;
+  uint64_t response_body_bytes;
+  uint64_t tls_handshakes;
+  uint64_t tls_resumed_handshakes;
+  uint64_t response_cache_hits;
+  uint64_t response_cache_misses;
+  uint64_t collapsed_requests;
+  uint64_t compressed_responses;
+  uint64_t compression_in_bytes;
+  uint64_t compression_out_bytes;
+  uint64_t zerocopy_sends;
+  uint64_t zerocopy_copied;
+  // The number of bytes allocated by MemchunkPool, and the number of
+  // bytes of them which are not in use.
+  uint64_t mcpool_bytes;
+  uint64_t mcpool_free_bytes;
+  // The number of chunks allocated by MemchunkPool, and the number
+  // of them which are not in use, per size class.
+  std::array<uint64_t, MEMCHUNK_SIZE_CLASSES.size()> mcpool_chunks;
+  std::array<uint64_t, MEMCHUNK_SIZE_CLASSES.size()> mcpool_free_chunks;
+  // The number of bytes of unused chunks freed by MemchunkPool
+  // watermarks.
+  uint64_t mcpool_trimmed_bytes;
+  // MemchunkPool usage per worker in the order of add_worker_metrics
+  // calls.
+  std::vector<MemchunkPoolMetrics> worker_mcpools;
+  uint64_t log_written;
+  uint64_t log_dropped;
+  // Keyed by pattern.
+  std::map<std::string, BackendMetrics> backends;
+};
+
+// Adds statistics of a worker to |m|.  |stat| is its WorkerStat,
+// |mcpool| is its MemchunkPool, and |stat_set| is its BackendStatSet
+// which may be nullptr.  This function can be called from any
+// thread.
+void add_worker_metrics(Metrics &m, const WorkerStat &stat,
+                        const MemchunkPool &mcpool,
+                        const BackendStatSet *stat_set);
+
+// Appends |m| to |out| in Prometheus text exposition format.
+void format_metrics(std::string &out, const Metrics &m);
+
+} // namespace shrpx
+
+#endif // SHRPX_METRICS_H
@@ -0,0 +1,167 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_metrics_test.h"
+
+#include <string>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_metrics.h"
+#include "shrpx_log.h"
+#include "shrpx_config.h"
+#include "shrpx_worker.h"
+
+namespace shrpx {
+
+namespace {
+uint64_t get(const std::atomic<uint64_t> &c) {
+  return c.load(std::memory_order_relaxed);
+}
+} // namespace
+
+void test_shrpx_metrics_latency_histogram(void) {
+  LatencyHistogram h{};
+
+  h.observe(0);
+  h.observe(5000);
+  h.observe(5001);
+  h.observe(10000000);
+  h.observe(10000001);
+
+  CU_ASSERT(2 == get(h.buckets[0]));
+  CU_ASSERT(1 == get(h.buckets[1]));
+  CU_ASSERT(1 == get(h.buckets[LATENCY_BUCKETS.size() - 1]));
+  CU_ASSERT(1 == get(h.buckets[LATENCY_BUCKETS.size()]));
+  CU_ASSERT(20010002 == get(h.sum));
+}
+
+void test_shrpx_metrics_copy_backend_stat(void) {
+  BackendStat src{}, dst{};
+
+  stat_add(src.responses[1], 3);
+  src.latency.observe(7000);
+  stat_add(src.connect_failures, 2);
+  stat_add(src.blocked_addrs);
+
+  copy_backend_stat(dst, src);
+
+  CU_ASSERT(3 == get(dst.responses[1]));
+  CU_ASSERT(1 == get(dst.latency.buckets[1]));
+  CU_ASSERT(7000 == get(dst.latency.sum));
+  CU_ASSERT(2 == get(dst.connect_failures));
+  // blocked_addrs is counted again by the new group.
+  CU_ASSERT(0 == get(dst.blocked_addrs));
+}
+
+void test_shrpx_metrics_format(void) {
+  auto downstreamconf = std::make_shared<DownstreamConfig>();
+  downstreamconf->addr_groups.emplace_back(StringRef::from_lit("/"));
+  downstreamconf->addr_groups.emplace_back(
+      StringRef::from_lit("example.com/\"a\""));
+
+  BackendStatSet stat_set(downstreamconf);
+
+  CU_ASSERT(2 == stat_set.groups.size());
+
+  auto &b = stat_set.groups[0];
+  stat_add(b.responses[1], 3);
+  stat_add(b.connect_failures);
+  stat_add(b.blocked_addrs);
+  b.latency.observe(2000);
+  b.latency.observe(1500000);
+
+  WorkerStat stat{};
+  stat_add(stat.num_connections, 2);
+  stat_add(stat.connections_total, 5);
+  stat_add(stat.requests_total, 3);
+  stat_add(stat.responses[1], 2);
+  stat_add(stat.responses[4]);
+
+  MemchunkPool mcpool;
+  mcpool.recycle(mcpool.get(1_k));
+  mcpool.get(4_k);
+
+  Metrics m{};
+
+  // Two workers share the same counters here, so every value is
+  // doubled.
+  add_worker_metrics(m, stat, mcpool, &stat_set);
+  add_worker_metrics(m, stat, mcpool, nullptr);
+
+  CU_ASSERT(2 == m.workers);
+  CU_ASSERT(4 == m.connections);
+  CU_ASSERT(10 == m.connections_total);
+  CU_ASSERT(4 == m.responses[1]);
+  CU_ASSERT(2 == m.responses[4]);
+  CU_ASSERT(10240 == m.mcpool_bytes);
+  CU_ASSERT(2048 == m.mcpool_free_bytes);
+  CU_ASSERT(2 == m.mcpool_chunks[1]);
+  CU_ASSERT(0 == m.mcpool_free_chunks[1]);
+  CU_ASSERT(2 == m.worker_mcpools.size());
+  CU_ASSERT(2 == m.worker_mcpools[1].chunks);
+  CU_ASSERT(2 == m.backends.size());
+  CU_ASSERT(3 == m.backends["/"].responses[1]);
+
+  std::string out;
+  format_metrics(out, m);
+
+  CU_ASSERT(std::string::npos !=
+            out.find("# TYPE nghttpx_workers gauge\nnghttpx_workers 2\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_responses_total{code=\"5xx\"} 2\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_memchunk_pool_free_chunks{size=\"1024\"} 2\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_worker_memchunk_pool_bytes{worker=\"1\","
+                     "state=\"in_use\"} 4096\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_worker_memchunk_pool_chunks{worker=\"0\","
+                     "state=\"pooled\"} 1\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_backend_responses_total{backend=\"/\","
+                     "code=\"2xx\"} 3\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_backend_request_duration_seconds_bucket{"
+                     "backend=\"/\",le=\"0.005\"} 1\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_backend_request_duration_seconds_bucket{"
+                     "backend=\"/\",le=\"2.5\"} 2\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_backend_request_duration_seconds_bucket{"
+                     "backend=\"/\",le=\"+Inf\"} 2\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_backend_request_duration_seconds_sum{"
+                     "backend=\"/\"} 1.502\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_backend_request_duration_seconds_count{"
+                     "backend=\"/\"} 2\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_backend_connect_failures_total{"
+                     "backend=\"example.com/\\\"a\\\"\"} 0\n"));
+  CU_ASSERT(std::string::npos !=
+            out.find("nghttpx_backend_blocked_addresses{backend=\"/\"} 1\n"));
+}
+
+} // namespace shrpx
@@ -27,6 +27,7 @@
 #include <limits>
 
 #include "shrpx_connection.h"
+#include "shrpx_io_uring.h"
 #include "shrpx_log.h"
 
 namespace shrpx {
@@ -46,7 +47,8 @@ RateLimit::RateLimit(struct ev_loop *loop, ev_io *w, size_t rate, size_t burst,
       rate_(rate),
       burst_(burst),
       avail_(burst),
-      startw_req_(false) {
+      startw_req_(false),
+      feed_write_(false) {
   ev_timer_init(&t_, regencb, 0., 1.);
   t_.data = this;
   if (rate_ > 0) {
@@ -87,6 +89,7 @@ void RateLimit::regen() {
   if (w_->fd >= 0 && avail_ > 0 && startw_req_) {
     ev_io_start(loop_, w_);
     handle_tls_pending_read();
+    handle_feed_write();
   }
 }
 
@@ -98,6 +101,7 @@ void RateLimit::startw() {
   if (rate_ == 0 || avail_ > 0) {
     ev_io_start(loop_, w_);
     handle_tls_pending_read();
+    handle_feed_write();
     return;
   }
 }
@@ -108,6 +112,13 @@ void RateLimit::stopw() {
 }
 
 void RateLimit::handle_tls_pending_read() {
+  if (conn_ && conn_->uring) {
+    if (conn_->uring->read_pending()) {
+      ev_feed_event(loop_, w_, EV_READ);
+    }
+    return;
+  }
+
   if (!conn_ || !conn_->tls.ssl ||
       (SSL_pending(conn_->tls.ssl) == 0 && conn_->tls.rbuf.rleft() == 0 &&
        (!conn_->tls.initial_handshake_done ||
@@ -120,4 +131,12 @@ void RateLimit::handle_tls_pending_read() {
   ev_feed_event(loop_, w_, EV_READ);
 }
 
+void RateLimit::set_feed_write(bool f) { feed_write_ = f; }
+
+void RateLimit::handle_feed_write() {
+  if (feed_write_) {
+    ev_feed_event(loop_, w_, EV_WRITE);
+  }
+}
+
 } // namespace shrpx
@@ -49,10 +49,17 @@ public:
   void stopw();
   // Feeds event if conn_->tls object has unread bytes.  This is
   // required since it is buffered in conn_->tls object, io event is
-  // not generated unless new incoming data is received.
+  // not generated unless new incoming data is received.  The same
+  // applies to the data received by conn_->uring.
   void handle_tls_pending_read();
+  // If |f| is true, EV_WRITE event is fed whenever the watcher is
+  // started.  This is used when the watcher does not poll file
+  // descriptor because writes are done by io_uring.
+  void set_feed_write(bool f);
 
 private:
+  void handle_feed_write();
+
   ev_timer t_;
   ev_io *w_;
   struct ev_loop *loop_;
@@ -61,6 +68,7 @@ private:
   size_t burst_;
   size_t avail_;
   bool startw_req_;
+  bool feed_write_;
 };
 
 } // namespace shrpx
@@ -0,0 +1,480 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_response_cache.h"
+
+#include <cassert>
+#include <algorithm>
+
+#include "shrpx_downstream.h"
+#include "shrpx_log.h"
+#include "http2.h"
+#include "util.h"
+
+namespace shrpx {
+
+ResponseCacheEntry::ResponseCacheEntry(MemchunkPool *mcpool)
+    : body(mcpool),
+      dlnext(nullptr),
+      dlprev(nullptr),
+      date(0.),
+      expiry(0.),
+      size(0),
+      max_body_length(0),
+      http_status(0) {}
+
+namespace {
+struct CacheControl {
+  CacheControl()
+      : max_age(-1),
+        s_maxage(-1),
+        no_store(false),
+        no_cache(false),
+        priv(false) {}
+
+  // The value of max-age directive, or -1 if it is absent.
+  int64_t max_age;
+  // The value of s-maxage directive, or -1 if it is absent.
+  int64_t s_maxage;
+  bool no_store;
+  bool no_cache;
+  bool priv;
+};
+} // namespace
+
+namespace {
+StringRef trim_ows(const StringRef &s) {
+  auto first = std::begin(s);
+  auto last = std::end(s);
+
+  for (; first != last && (*first == ' ' || *first == '\t'); ++first)
+    ;
+  for (; first != last && (*(last - 1) == ' ' || *(last - 1) == '\t'); --last)
+    ;
+
+  return StringRef{first, last};
+}
+} // namespace
+
+namespace {
+// Parses the value of directive which takes delta-seconds.  Returns
+// -1 if the value is malformed.
+int64_t parse_delta_seconds(const StringRef &s) {
+  if (s.size() >= 2 && s[0] == '"' && s[s.size() - 1] == '"') {
+    return util::parse_uint(StringRef{std::begin(s) + 1, std::end(s) - 1});
+  }
+  return util::parse_uint(s);
+}
+} // namespace
+
+namespace {
+// Parses cache-control header field |value|, and merges the
+// directives into |cc|.  Unknown directives are ignored.
+void parse_cache_control(CacheControl &cc, const StringRef &value) {
+  auto first = std::begin(value);
+  auto last = std::end(value);
+
+  for (;;) {
+    auto end = std::find(first, last, ',');
+    auto d = trim_ows(StringRef{first, end});
+
+    if (util::strieq_l("no-store", d)) {
+      cc.no_store = true;
+    } else if (util::istarts_with_l(d, "no-cache")) {
+      // no-cache may have field names which we do not support.
+      cc.no_cache = true;
+    } else if (util::istarts_with_l(d, "private")) {
+      cc.priv = true;
+    } else if (util::istarts_with_l(d, "max-age=")) {
+      auto n =
+          parse_delta_seconds(StringRef{std::begin(d) + str_size("max-age="),
+                                        std::end(d)});
+      // A malformed value makes the response stale.
+      cc.max_age = n == -1 ? 0 : n;
+    } else if (util::istarts_with_l(d, "s-maxage=")) {
+      auto n =
+          parse_delta_seconds(StringRef{std::begin(d) + str_size("s-maxage="),
+                                        std::end(d)});
+      cc.s_maxage = n == -1 ? 0 : n;
+    }
+
+    if (end == last) {
+      return;
+    }
+
+    first = end + 1;
+  }
+}
+} // namespace
+
+bool response_cache_request_cacheable(const Request &req) {
+  if (req.method != HTTP_GET || req.upgrade_request ||
+      req.connect_proto != ConnectProto::NONE) {
+    return false;
+  }
+
+  CacheControl cc;
+
+  for (auto &kv : req.fs.headers()) {
+    if (kv.token == http2::HD_CACHE_CONTROL) {
+      parse_cache_control(cc, kv.value);
+      continue;
+    }
+
+    if (util::streq_l("authorization", kv.name)) {
+      return false;
+    }
+  }
+
+  return !cc.no_store;
+}
+
+ev_tstamp response_cache_freshness_lifetime(const Response &resp,
+                                            ev_tstamp now) {
+  CacheControl cc;
+  StringRef expires, date;
+
+  for (auto &kv : resp.fs.headers()) {
+    switch (kv.token) {
+    case http2::HD_CACHE_CONTROL:
+      parse_cache_control(cc, kv.value);
+      continue;
+    case http2::HD_DATE:
+      date = kv.value;
+      continue;
+    }
+
+    if (util::streq_l("expires", kv.name)) {
+      expires = kv.value;
+    } else if (util::streq_l("set-cookie", kv.name)) {
+      // Never share a response which sets cookie.
+      return -1;
+    }
+  }
+
+  if (cc.no_store || cc.no_cache || cc.priv) {
+    return -1;
+  }
+
+  if (cc.s_maxage != -1) {
+    return cc.s_maxage;
+  }
+
+  if (cc.max_age != -1) {
+    return cc.max_age;
+  }
+
+  if (expires.empty()) {
+    return -1;
+  }
+
+  auto t = util::parse_http_date(expires);
+  if (t == 0) {
+    return -1;
+  }
+
+  auto base = now;
+
+  if (!date.empty()) {
+    auto d = util::parse_http_date(date);
+    if (d != 0) {
+      base = d;
+    }
+  }
+
+  return static_cast<ev_tstamp>(t) - base;
+}
+
+namespace {
+// Returns true if response with status code |status| may be stored.
+bool cacheable_status(unsigned int status) {
+  switch (status) {
+  case 200:
+  case 203:
+  case 204:
+  case 300:
+  case 301:
+  case 308:
+  case 404:
+  case 410:
+    return true;
+  default:
+    return false;
+  }
+}
+} // namespace
+
+namespace {
+// Returns true if response header field |name| is not stored.
+bool skip_response_header(const HeaderRef &kv) {
+  if (kv.name.empty() || kv.name[0] == ':') {
+    return true;
+  }
+
+  switch (kv.token) {
+  case http2::HD_CONNECTION:
+  case http2::HD_CONTENT_LENGTH:
+  case http2::HD_KEEP_ALIVE:
+  case http2::HD_PROXY_CONNECTION:
+  case http2::HD_TE:
+  case http2::HD_TRAILER:
+  case http2::HD_TRANSFER_ENCODING:
+  case http2::HD_UPGRADE:
+    return true;
+  }
+
+  return util::streq_l("age", kv.name);
+}
+} // namespace
+
+bool response_cache_vary_match(const ResponseCacheEntry &ent,
+                               const Request &req) {
+  for (auto &kv : ent.vary) {
+    auto h = req.fs.header(StringRef{kv.first});
+    auto value = h ? h->value : StringRef{};
+    if (value != StringRef{kv.second}) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+ResponseCache::ResponseCache(MemchunkPool *mcpool, size_t max_size,
+                             size_t max_entry_size)
+    : mcpool_(mcpool),
+      size_(0),
+      max_size_(max_size),
+      max_entry_size_(max_entry_size) {}
+
+ResponseCache::~ResponseCache() {}
+
+std::shared_ptr<const ResponseCacheEntry>
+ResponseCache::lookup(const StringRef &key, const Request &req,
+                      ev_tstamp now) {
+  auto it = entries_.find(std::string{std::begin(key), std::end(key)});
+  if (it == std::end(entries_)) {
+    return nullptr;
+  }
+
+  CacheControl cc;
+
+  for (auto &kv : req.fs.headers()) {
+    if (kv.token == http2::HD_CACHE_CONTROL) {
+      parse_cache_control(cc, kv.value);
+    } else if (util::streq_l("pragma", kv.name) &&
+               util::strieq_l("no-cache", kv.value)) {
+      cc.no_cache = true;
+    }
+  }
+
+  // Client requires validation with the origin server.
+  if (cc.no_cache || cc.max_age == 0) {
+    return nullptr;
+  }
+
+  for (auto &ent : (*it).second) {
+    if (!response_cache_vary_match(*ent, req)) {
+      continue;
+    }
+
+    if (ent->expiry <= now) {
+      remove(ent.get());
+      return nullptr;
+    }
+
+    if (cc.max_age != -1 && now - ent->date > cc.max_age) {
+      return nullptr;
+    }
+
+    lru_.remove(ent.get());
+    lru_.append(ent.get());
+
+    return ent;
+  }
+
+  return nullptr;
+}
+
+std::unique_ptr<ResponseCacheEntry>
+ResponseCache::create_entry(const StringRef &key, const Request &req,
+                            const Response &resp, ev_tstamp now) {
+  if (resp.fs.content_length > static_cast<int64_t>(max_entry_size_)) {
+    return nullptr;
+  }
+
+  auto ent = response_cache_make_entry(mcpool_, key, req, resp, now);
+  if (!ent) {
+    return nullptr;
+  }
+
+  ent->max_body_length = max_entry_size_;
+
+  return ent;
+}
+
+void ResponseCache::store(std::unique_ptr<ResponseCacheEntry> ent) {
+  auto size = sizeof(*ent) + ent->key.size();
+  for (auto &kv : ent->headers) {
+    size += kv.first.size() + kv.second.size();
+  }
+  for (auto &kv : ent->vary) {
+    size += kv.first.size() + kv.second.size();
+  }
+  for (auto m = ent->body.head; m; m = m->next) {
+    size += m->size;
+  }
+
+  if (size > max_size_) {
+    return;
+  }
+
+  ent->size = size;
+
+  auto &variants = entries_[ent->key];
+
+  for (auto it = std::begin(variants); it != std::end(variants); ++it) {
+    if ((*it)->vary == ent->vary) {
+      lru_.remove((*it).get());
+      size_ -= (*it)->size;
+      variants.erase(it);
+      break;
+    }
+  }
+
+  size_ += ent->size;
+  lru_.append(ent.get());
+  variants.push_back(std::move(ent));
+
+  while (size_ > max_size_) {
+    if (LOG_ENABLED(INFO)) {
+      LOG(INFO) << "Response cache: evict " << lru_.head->key;
+    }
+
+    remove(lru_.head);
+  }
+}
+
+void ResponseCache::remove(ResponseCacheEntry *ent) {
+  lru_.remove(ent);
+  size_ -= ent->size;
+
+  auto it = entries_.find(ent->key);
+
+  assert(it != std::end(entries_));
+
+  auto &variants = (*it).second;
+
+  variants.erase(std::find_if(
+      std::begin(variants), std::end(variants),
+      [ent](const std::shared_ptr<ResponseCacheEntry> &p) {
+        return p.get() == ent;
+      }));
+
+  if (variants.empty()) {
+    entries_.erase(it);
+  }
+}
+
+size_t ResponseCache::get_size() const { return size_; }
+
+size_t ResponseCache::get_num_entries() const { return lru_.size(); }
+
+std::unique_ptr<ResponseCacheEntry>
+response_cache_make_entry(MemchunkPool *mcpool, const StringRef &key,
+                          const Request &req, const Response &resp,
+                          ev_tstamp now) {
+  if (!cacheable_status(resp.http_status)) {
+    return nullptr;
+  }
+
+  auto lifetime = response_cache_freshness_lifetime(resp, now);
+  if (lifetime <= 0) {
+    return nullptr;
+  }
+
+  auto ent = std::make_unique<ResponseCacheEntry>(mcpool);
+
+  int64_t age = 0;
+
+  for (auto &kv : resp.fs.headers()) {
+    if (util::streq_l("vary", kv.name)) {
+      auto first = std::begin(kv.value);
+      auto last = std::end(kv.value);
+
+      for (;;) {
+        auto end = std::find(first, last, ',');
+        auto name = trim_ows(StringRef{first, end});
+
+        if (util::streq_l("*", name)) {
+          return nullptr;
+        }
+
+        if (!name.empty()) {
+          std::string lname{std::begin(name), std::end(name)};
+          util::inp_strlower(lname);
+
+          auto h = req.fs.header(StringRef{lname});
+          auto value = h ? h->value : StringRef{};
+
+          ent->vary.emplace_back(std::move(lname),
+                                 std::string{std::begin(value),
+                                             std::end(value)});
+        }
+
+        if (end == last) {
+          break;
+        }
+
+        first = end + 1;
+      }
+    } else if (util::streq_l("age", kv.name)) {
+      auto n = util::parse_uint(kv.value);
+      if (n != -1) {
+        age = n;
+      }
+    }
+
+    if (skip_response_header(kv)) {
+      continue;
+    }
+
+    ent->headers.emplace_back(
+        std::string{std::begin(kv.name), std::end(kv.name)},
+        std::string{std::begin(kv.value), std::end(kv.value)});
+  }
+
+  if (age >= lifetime) {
+    return nullptr;
+  }
+
+  ent->key = std::string{std::begin(key), std::end(key)};
+  ent->date = now - age;
+  ent->expiry = ent->date + lifetime;
+  ent->http_status = resp.http_status;
+
+  return ent;
+}
+
+} // namespace shrpx
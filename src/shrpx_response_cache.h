@@ -0,0 +1,155 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_RESPONSE_CACHE_H
+#define SHRPX_RESPONSE_CACHE_H
+
+#include "shrpx.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include <ev.h>
+
+#include "memchunk.h"
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+struct Request;
+struct Response;
+class Downstream;
+
+// A response stored in ResponseCache.
+struct ResponseCacheEntry {
+  ResponseCacheEntry(MemchunkPool *mcpool);
+
+  // The primary cache key; scheme, authority, and path of the
+  // request.
+  std::string key;
+  // Response header fields.  Connection-specific header fields,
+  // content-length, and age are not stored.
+  std::vector<std::pair<std::string, std::string>> headers;
+  // Request header fields nominated by vary response header field,
+  // and their values in the request which fetched this response.
+  // Names are lowercased.  An absent header field has an empty value.
+  std::vector<std::pair<std::string, std::string>> vary;
+  // Response body
+  DefaultMemchunks body;
+  ResponseCacheEntry *dlnext, *dlprev;
+  // The time when this response was stored, minus the age the
+  // response had already accumulated at that time.
+  ev_tstamp date;
+  // The time when this response becomes stale.
+  ev_tstamp expiry;
+  // The amount of memory this entry consumes, which is counted
+  // towards ResponseCache capacity.
+  size_t size;
+  // The maximum length of body this entry can hold.
+  size_t max_body_length;
+  unsigned int http_status;
+};
+
+// ResponseCache stores cacheable responses and serves subsequent
+// identical requests without forwarding them to a backend.  Each
+// worker owns its own ResponseCache, so that no locking is required.
+// When the memory consumed by entries exceeds the capacity, the least
+// recently used entries are evicted.
+class ResponseCache {
+public:
+  // |max_size| is the capacity in bytes, and |max_entry_size| is the
+  // maximum size of a single response body.
+  ResponseCache(MemchunkPool *mcpool, size_t max_size, size_t max_entry_size);
+  ~ResponseCache();
+
+  // Returns a fresh entry keyed by |key| that the request |req| can
+  // be served from at time |now|, or nullptr.  The returned entry
+  // becomes the most recently used one.  It stays valid even if it is
+  // evicted later.
+  std::shared_ptr<const ResponseCacheEntry>
+  lookup(const StringRef &key, const Request &req, ev_tstamp now);
+  // Returns a new entry that is going to store the response |resp| to
+  // the request |req|, or nullptr if the response is not storable.
+  // The response body must be appended to the body of the returned
+  // entry, and then it must be passed to store().
+  std::unique_ptr<ResponseCacheEntry> create_entry(const StringRef &key,
+                                                   const Request &req,
+                                                   const Response &resp,
+                                                   ev_tstamp now);
+  // Stores |ent|, replacing the existing entry for the same request,
+  // and evicts entries if the capacity is exceeded.
+  void store(std::unique_ptr<ResponseCacheEntry> ent);
+
+  // Returns the amount of memory consumed by entries.
+  size_t get_size() const;
+  // Returns the number of entries.
+  size_t get_num_entries() const;
+
+private:
+  void remove(ResponseCacheEntry *ent);
+
+  // Maps primary key to the variants of the response.
+  std::unordered_map<std::string,
+                     std::vector<std::shared_ptr<ResponseCacheEntry>>>
+      entries_;
+  // Entries in the order of use.  The head is the least recently
+  // used one.
+  DList<ResponseCacheEntry> lru_;
+  MemchunkPool *mcpool_;
+  size_t size_;
+  size_t max_size_;
+  size_t max_entry_size_;
+};
+
+// Returns true if a response to |req| may be served from, or stored
+// in ResponseCache.
+bool response_cache_request_cacheable(const Request &req);
+
+// Returns the freshness lifetime of |resp| in seconds at time |now|,
+// or negative value if |resp| is not storable.  The freshness
+// lifetime is derived from s-maxage or max-age directive of
+// cache-control, or expires header field.
+ev_tstamp response_cache_freshness_lifetime(const Response &resp,
+                                            ev_tstamp now);
+
+// Returns a new entry which describes the response |resp| to the
+// request |req| at time |now|, or nullptr if |resp| is not storable.
+// The body of the returned entry is empty.
+std::unique_ptr<ResponseCacheEntry>
+response_cache_make_entry(MemchunkPool *mcpool, const StringRef &key,
+                          const Request &req, const Response &resp,
+                          ev_tstamp now);
+
+// Returns true if the request header fields nominated by vary
+// response header field of |ent| have the same values in |req|.
+bool response_cache_vary_match(const ResponseCacheEntry &ent,
+                               const Request &req);
+
+} // namespace shrpx
+
+#endif // SHRPX_RESPONSE_CACHE_H
@@ -0,0 +1,236 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_response_cache_test.h"
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_response_cache.h"
+#include "shrpx_downstream.h"
+
+namespace shrpx {
+
+namespace {
+void add_header(FieldStore &fs, const StringRef &name, const StringRef &value) {
+  fs.add_header_token(name, value, false, http2::lookup_token(name));
+}
+} // namespace
+
+void test_shrpx_response_cache_freshness_lifetime(void) {
+  // Sun, 06 Nov 1994 08:49:37 GMT
+  constexpr ev_tstamp now = 784111777.;
+
+  {
+    BlockAllocator balloc(4096, 4096);
+    Response resp(balloc);
+
+    CU_ASSERT(response_cache_freshness_lifetime(resp, now) < 0);
+  }
+  {
+    BlockAllocator balloc(4096, 4096);
+    Response resp(balloc);
+    add_header(resp.fs, StringRef::from_lit("cache-control"),
+               StringRef::from_lit("public, max-age=60"));
+
+    CU_ASSERT(60. == response_cache_freshness_lifetime(resp, now));
+  }
+  {
+    // s-maxage takes precedence over max-age.
+    BlockAllocator balloc(4096, 4096);
+    Response resp(balloc);
+    add_header(resp.fs, StringRef::from_lit("cache-control"),
+               StringRef::from_lit("max-age=60"));
+    add_header(resp.fs, StringRef::from_lit("cache-control"),
+               StringRef::from_lit("s-maxage=\"120\""));
+
+    CU_ASSERT(120. == response_cache_freshness_lifetime(resp, now));
+  }
+  {
+    BlockAllocator balloc(4096, 4096);
+    Response resp(balloc);
+    add_header(resp.fs, StringRef::from_lit("cache-control"),
+               StringRef::from_lit("max-age=60, private"));
+
+    CU_ASSERT(response_cache_freshness_lifetime(resp, now) < 0);
+  }
+  {
+    BlockAllocator balloc(4096, 4096);
+    Response resp(balloc);
+    add_header(resp.fs, StringRef::from_lit("cache-control"),
+               StringRef::from_lit("No-Store,max-age=60"));
+
+    CU_ASSERT(response_cache_freshness_lifetime(resp, now) < 0);
+  }
+  {
+    BlockAllocator balloc(4096, 4096);
+    Response resp(balloc);
+    add_header(resp.fs, StringRef::from_lit("cache-control"),
+               StringRef::from_lit("max-age=60"));
+    add_header(resp.fs, StringRef::from_lit("set-cookie"),
+               StringRef::from_lit("a=b"));
+
+    CU_ASSERT(response_cache_freshness_lifetime(resp, now) < 0);
+  }
+  {
+    BlockAllocator balloc(4096, 4096);
+    Response resp(balloc);
+    add_header(resp.fs, StringRef::from_lit("date"),
+               StringRef::from_lit("Sun, 06 Nov 1994 08:49:37 GMT"));
+    add_header(resp.fs, StringRef::from_lit("expires"),
+               StringRef::from_lit("Sun, 06 Nov 1994 08:59:37 GMT"));
+
+    CU_ASSERT(600. == response_cache_freshness_lifetime(resp, now + 5));
+  }
+  {
+    // Without date, expires is relative to the current time.
+    BlockAllocator balloc(4096, 4096);
+    Response resp(balloc);
+    add_header(resp.fs, StringRef::from_lit("expires"),
+               StringRef::from_lit("Sun, 06 Nov 1994 08:59:37 GMT"));
+
+    CU_ASSERT(595. == response_cache_freshness_lifetime(resp, now + 5));
+  }
+  {
+    // Malformed expires means already expired.
+    BlockAllocator balloc(4096, 4096);
+    Response resp(balloc);
+    add_header(resp.fs, StringRef::from_lit("expires"),
+               StringRef::from_lit("0"));
+
+    CU_ASSERT(response_cache_freshness_lifetime(resp, now) < 0);
+  }
+}
+
+namespace {
+std::unique_ptr<ResponseCacheEntry>
+create_entry(ResponseCache &cache, const StringRef &key, const Request &req,
+             const StringRef &vary, ev_tstamp now) {
+  BlockAllocator balloc(4096, 4096);
+  Response resp(balloc);
+  resp.http_status = 200;
+  add_header(resp.fs, StringRef::from_lit("cache-control"),
+             StringRef::from_lit("max-age=10"));
+  add_header(resp.fs, StringRef::from_lit("content-type"),
+             StringRef::from_lit("text/plain"));
+  add_header(resp.fs, StringRef::from_lit("connection"),
+             StringRef::from_lit("close"));
+  if (!vary.empty()) {
+    add_header(resp.fs, StringRef::from_lit("vary"), vary);
+  }
+
+  auto ent = cache.create_entry(key, req, resp, now);
+  if (ent) {
+    ent->body.append("hello");
+  }
+
+  return ent;
+}
+} // namespace
+
+void test_shrpx_response_cache_lookup(void) {
+  MemchunkPool mcpool;
+  // Each entry consumes at least one 1KiB chunk for its small body.
+  ResponseCache cache(&mcpool, 3 * 1_k, 1_k);
+  BlockAllocator balloc(4096, 4096);
+  Request req(balloc);
+  req.method = HTTP_GET;
+
+  auto a = StringRef::from_lit("https://example.com/a");
+  auto b = StringRef::from_lit("https://example.com/b");
+
+  CU_ASSERT(response_cache_request_cacheable(req));
+  CU_ASSERT(nullptr == cache.lookup(a, req, 100.));
+
+  auto ent = create_entry(cache, a, req, StringRef{}, 100.);
+
+  CU_ASSERT(nullptr != ent);
+  // Connection-specific header field is not stored.
+  CU_ASSERT(2 == ent->headers.size());
+
+  cache.store(std::move(ent));
+
+  CU_ASSERT(1 == cache.get_num_entries());
+
+  auto hit = cache.lookup(a, req, 105.);
+
+  CU_ASSERT(nullptr != hit);
+  CU_ASSERT(200 == hit->http_status);
+  CU_ASSERT(5 == hit->body.rleft());
+  CU_ASSERT(nullptr == cache.lookup(b, req, 105.));
+
+  // Client requires revalidation.
+  {
+    BlockAllocator balloc(4096, 4096);
+    Request req2(balloc);
+    req2.method = HTTP_GET;
+    add_header(req2.fs, StringRef::from_lit("cache-control"),
+               StringRef::from_lit("no-cache"));
+
+    CU_ASSERT(nullptr == cache.lookup(a, req2, 105.));
+  }
+
+  // Stale entry is removed.
+  CU_ASSERT(nullptr == cache.lookup(a, req, 110.));
+  CU_ASSERT(0 == cache.get_num_entries());
+  CU_ASSERT(0 == cache.get_size());
+
+  // Vary
+  {
+    BlockAllocator balloc(4096, 4096);
+    Request gzreq(balloc);
+    gzreq.method = HTTP_GET;
+    add_header(gzreq.fs, StringRef::from_lit("accept-encoding"),
+               StringRef::from_lit("gzip"));
+
+    cache.store(create_entry(cache, a, gzreq,
+                             StringRef::from_lit("Accept-Encoding"), 100.));
+
+    CU_ASSERT(nullptr != cache.lookup(a, gzreq, 101.));
+    CU_ASSERT(nullptr == cache.lookup(a, req, 101.));
+
+    cache.store(create_entry(cache, a, req,
+                             StringRef::from_lit("Accept-Encoding"), 100.));
+
+    CU_ASSERT(2 == cache.get_num_entries());
+    CU_ASSERT(nullptr != cache.lookup(a, req, 101.));
+    CU_ASSERT(nullptr == create_entry(cache, a, req, StringRef::from_lit("*"),
+                                      100.));
+  }
+
+  // The least recently used entry is evicted.
+  cache.lookup(a, req, 101.);
+  cache.store(create_entry(cache, b, req, StringRef{}, 100.));
+
+  CU_ASSERT(2 == cache.get_num_entries());
+  CU_ASSERT(nullptr != cache.lookup(a, req, 101.));
+  CU_ASSERT(nullptr != cache.lookup(b, req, 101.));
+
+  // Request with authorization header field is not cacheable.
+  add_header(req.fs, StringRef::from_lit("authorization"),
+             StringRef::from_lit("Basic Zm9vOmJhcg=="));
+
+  CU_ASSERT(!response_cache_request_cacheable(req));
+}
+
+} // namespace shrpx
@@ -72,6 +72,8 @@ void Router::add_node(RNode *node, const char *pattern, size_t patlen,
 }
 
 size_t Router::add_route(const StringRef &pattern, size_t idx, bool wildcard) {
+  nodes_.clear();
+
   ssize_t index = -1, wildcard_index = -1;
   if (wildcard) {
     wildcard_index = idx;
@@ -94,7 +96,7 @@ size_t Router::add_route(const StringRef &pattern, size_t idx, bool wildcard) {
 
     auto slen = pattern.size() - i;
     auto s = pattern.c_str() + i;
-    auto n = std::min(node->len, slen);
+    auto n = std::min(static_cast<size_t>(node->len), slen);
     size_t j;
     for (j = 0; j < n && node->s[j] == s[j]; ++j)
       ;
@@ -158,9 +160,96 @@ size_t Router::add_route(const StringRef &pattern, size_t idx, bool wildcard) {
   }
 }
 
-namespace {
-const RNode *match_complete(size_t *offset, const RNode *node,
-                            const char *first, const char *last) {
+void Router::compile() {
+  nodes_.clear();
+  first_bytes_.clear();
+  labels_.clear();
+  dispatch_.clear();
+
+  // Nodes are laid out in breadth-first order.  queue[i] is the tree
+  // node which nodes_[i] is compiled from.
+  std::vector<const RNode *> queue{&root_};
+
+  nodes_.emplace_back();
+  first_bytes_.push_back('\0');
+
+  for (size_t i = 0; i < queue.size(); ++i) {
+    auto src = queue[i];
+
+    assert(src->index < std::numeric_limits<int32_t>::max());
+    assert(src->wildcard_index < std::numeric_limits<int32_t>::max());
+    assert(src->next.size() <= 256);
+
+    auto &node = nodes_[i];
+
+    node.index = src->index;
+    node.wildcard_index = src->wildcard_index;
+    node.len = src->len;
+    node.first_child = nodes_.size();
+    node.num_children = src->next.size();
+
+    if (src->len <= RFLAT_INLINE_LABEL_LEN) {
+      std::copy_n(src->s, src->len, node.label.s);
+    } else {
+      node.label.offset = labels_.size();
+      labels_.insert(std::end(labels_), src->s, src->s + src->len);
+    }
+
+    if (src->next.size() > RFLAT_DISPATCH_THRESHOLD) {
+      node.dispatch = dispatch_.size();
+      dispatch_.resize(dispatch_.size() + 256);
+
+      for (size_t j = 0; j < src->next.size(); ++j) {
+        dispatch_[node.dispatch + static_cast<uint8_t>(src->next[j]->s[0])] =
+            j + 1;
+      }
+    } else {
+      node.dispatch = RFLAT_NO_DISPATCH;
+    }
+
+    // |node| is invalidated after this point.
+    for (auto &nd : src->next) {
+      queue.push_back(nd.get());
+      nodes_.emplace_back();
+      first_bytes_.push_back(nd->s[0]);
+    }
+  }
+}
+
+bool Router::compiled() const { return !nodes_.empty(); }
+
+const char *Router::label(const RFlatNode *node) const {
+  if (node->len <= RFLAT_INLINE_LABEL_LEN) {
+    return node->label.s;
+  }
+
+  return labels_.data() + node->label.offset;
+}
+
+const RFlatNode *Router::find_child(const RFlatNode *node, char c) const {
+  if (node->dispatch != RFLAT_NO_DISPATCH) {
+    auto pos = dispatch_[node->dispatch + static_cast<uint8_t>(c)];
+    if (pos == 0) {
+      return nullptr;
+    }
+
+    return &nodes_[node->first_child + pos - 1];
+  }
+
+  auto first = first_bytes_.data() + node->first_child;
+  auto last = first + node->num_children;
+  auto it = std::find(first, last, c);
+  if (it == last) {
+    return nullptr;
+  }
+
+  return &nodes_[node->first_child + (it - first)];
+}
+
+const RFlatNode *Router::match_complete(size_t *offset,
+                                        const RFlatNode *node,
+                                        const char *first,
+                                        const char *last) const {
   *offset = 0;
 
   if (first == last) {
@@ -170,15 +259,15 @@ const RNode *match_complete(size_t *offset, const RNode *node,
   auto p = first;
 
   for (;;) {
-    auto next_node = find_next_node(node, *p);
+    auto next_node = find_child(node, *p);
     if (next_node == nullptr) {
       return nullptr;
     }
 
     node = next_node;
 
-    auto n = std::min(node->len, static_cast<size_t>(last - p));
-    if (memcmp(node->s, p, n) != 0) {
+    auto n = std::min<size_t>(node->len, last - p);
+    if (memcmp(label(node), p, n) != 0) {
       return nullptr;
     }
     p += n;
@@ -188,11 +277,11 @@ const RNode *match_complete(size_t *offset, const RNode *node,
     }
   }
 }
-} // namespace
 
-namespace {
-const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
-                           size_t offset, const char *first, const char *last) {
+const RFlatNode *Router::match_partial(bool *pattern_is_wildcard,
+                                       const RFlatNode *node, size_t offset,
+                                       const char *first,
+                                       const char *last) const {
   *pattern_is_wildcard = false;
 
   if (first == last) {
@@ -204,11 +293,11 @@ const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
 
   auto p = first;
 
-  const RNode *found_node = nullptr;
+  const RFlatNode *found_node = nullptr;
 
   if (offset > 0) {
-    auto n = std::min(node->len - offset, static_cast<size_t>(last - first));
-    if (memcmp(node->s + offset, first, n) != 0) {
+    auto n = std::min<size_t>(node->len - offset, last - first);
+    if (memcmp(label(node) + offset, first, n) != 0) {
       return nullptr;
     }
 
@@ -221,7 +310,7 @@ const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
         }
 
         // The last '/' handling, see below.
-        node = find_next_node(node, '/');
+        node = find_child(node, '/');
         if (node != nullptr && node->index != -1 && node->len == 1) {
           return node;
         }
@@ -231,7 +320,7 @@ const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
 
       // The last '/' handling, see below.
       if (node->index != -1 && offset + n + 1 == node->len &&
-          node->s[node->len - 1] == '/') {
+          label(node)[node->len - 1] == '/') {
         return node;
       }
 
@@ -241,7 +330,7 @@ const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
     if (node->wildcard_index != -1) {
       found_node = node;
       *pattern_is_wildcard = true;
-    } else if (node->index != -1 && node->s[node->len - 1] == '/') {
+    } else if (node->index != -1 && label(node)[node->len - 1] == '/') {
       found_node = node;
       *pattern_is_wildcard = false;
     }
@@ -250,15 +339,15 @@ const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
   }
 
   for (;;) {
-    auto next_node = find_next_node(node, *p);
+    auto next_node = find_child(node, *p);
     if (next_node == nullptr) {
       return found_node;
     }
 
     node = next_node;
 
-    auto n = std::min(node->len, static_cast<size_t>(last - p));
-    if (memcmp(node->s, p, n) != 0) {
+    auto n = std::min<size_t>(node->len, last - p);
+    if (memcmp(label(node), p, n) != 0) {
       return found_node;
     }
 
@@ -273,7 +362,7 @@ const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
         }
 
         // The last '/' handling, see below.
-        node = find_next_node(node, '/');
+        node = find_child(node, '/');
         if (node != nullptr && node->index != -1 && node->len == 1) {
           *pattern_is_wildcard = false;
           return node;
@@ -288,7 +377,7 @@ const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
       // request to the directory without trailing slash.  That is if
       // pattern is "/foo/" and path is "/foo", we consider they
       // match.
-      if (node->index != -1 && n + 1 == node->len && node->s[n] == '/') {
+      if (node->index != -1 && n + 1 == node->len && label(node)[n] == '/') {
         *pattern_is_wildcard = false;
         return node;
       }
@@ -299,7 +388,7 @@ const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
     if (node->wildcard_index != -1) {
       found_node = node;
       *pattern_is_wildcard = true;
-    } else if (node->index != -1 && node->s[node->len - 1] == '/') {
+    } else if (node->index != -1 && label(node)[node->len - 1] == '/') {
       // This is the case when pattern which ends with "/" is included
       // in query.
       found_node = node;
@@ -309,13 +398,15 @@ const RNode *match_partial(bool *pattern_is_wildcard, const RNode *node,
     assert(node->len == n);
   }
 }
-} // namespace
 
 ssize_t Router::match(const StringRef &host, const StringRef &path) const {
-  const RNode *node;
+  assert(compiled());
+
+  const RFlatNode *node;
   size_t offset;
 
-  node = match_complete(&offset, &root_, std::begin(host), std::end(host));
+  node = match_complete(&offset, nodes_.data(), std::begin(host),
+                        std::end(host));
   if (node == nullptr) {
     return -1;
   }
@@ -323,7 +414,7 @@ ssize_t Router::match(const StringRef &host, const StringRef &path) const {
   bool pattern_is_wildcard;
   node = match_partial(&pattern_is_wildcard, node, offset, std::begin(path),
                        std::end(path));
-  if (node == nullptr || node == &root_) {
+  if (node == nullptr || node == nodes_.data()) {
     return -1;
   }
 
@@ -331,10 +422,12 @@ ssize_t Router::match(const StringRef &host, const StringRef &path) const {
 }
 
 ssize_t Router::match(const StringRef &s) const {
-  const RNode *node;
+  assert(compiled());
+
+  const RFlatNode *node;
   size_t offset;
 
-  node = match_complete(&offset, &root_, std::begin(s), std::end(s));
+  node = match_complete(&offset, nodes_.data(), std::begin(s), std::end(s));
   if (node == nullptr) {
     return -1;
   }
@@ -346,9 +439,9 @@ ssize_t Router::match(const StringRef &s) const {
   return node->index;
 }
 
-namespace {
-const RNode *match_prefix(size_t *nread, const RNode *node, const char *first,
-                          const char *last) {
+const RFlatNode *Router::match_prefix(size_t *nread, const RFlatNode *node,
+                                      const char *first,
+                                      const char *last) const {
   if (first == last) {
     return nullptr;
   }
@@ -356,15 +449,15 @@ const RNode *match_prefix(size_t *nread, const RNode *node, const char *first,
   auto p = first;
 
   for (;;) {
-    auto next_node = find_next_node(node, *p);
+    auto next_node = find_child(node, *p);
     if (next_node == nullptr) {
       return nullptr;
     }
 
     node = next_node;
 
-    auto n = std::min(node->len, static_cast<size_t>(last - p));
-    if (memcmp(node->s, p, n) != 0) {
+    auto n = std::min<size_t>(node->len, last - p);
+    if (memcmp(label(node), p, n) != 0) {
       return nullptr;
     }
 
@@ -386,16 +479,16 @@ const RNode *match_prefix(size_t *nread, const RNode *node, const char *first,
     return nullptr;
   }
 }
-} // namespace
 
-ssize_t Router::match_prefix(size_t *nread, const RNode **last_node,
+ssize_t Router::match_prefix(size_t *nread, const RFlatNode **last_node,
                              const StringRef &s) const {
+  assert(compiled());
+
   if (*last_node == nullptr) {
-    *last_node = &root_;
+    *last_node = nodes_.data();
   }
 
-  auto node =
-      ::shrpx::match_prefix(nread, *last_node, std::begin(s), std::end(s));
+  auto node = match_prefix(nread, *last_node, std::begin(s), std::end(s));
   if (node == nullptr) {
     return -1;
   }
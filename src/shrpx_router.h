@@ -29,6 +29,7 @@
 
 #include <vector>
 #include <memory>
+#include <limits>
 
 #include "allocator.h"
 
@@ -60,6 +61,41 @@ struct RNode {
   ssize_t wildcard_index;
 };
 
+// The length of edge label which is stored inline in RFlatNode.
+constexpr size_t RFLAT_INLINE_LABEL_LEN = 10;
+// A node which has more children than this value gets a 256 entries
+// first byte dispatch table.  Otherwise, its children are found by
+// scanning their first bytes linearly.
+constexpr size_t RFLAT_DISPATCH_THRESHOLD = 8;
+// RFlatNode.dispatch value which indicates that the node has no
+// dispatch table.
+constexpr uint32_t RFLAT_NO_DISPATCH = std::numeric_limits<uint32_t>::max();
+
+// RFlatNode is a node of the compiled Router.  All nodes are stored
+// in a single array in breadth-first order, so that the children of
+// a node occupy a contiguous range of the array.
+struct RFlatNode {
+  // Index of pattern if match ends in this node, or -1.
+  int32_t index;
+  // Index of wildcard pattern, or -1.  See RNode.wildcard_index.
+  int32_t wildcard_index;
+  // Position of the first child in the node array.
+  uint32_t first_child;
+  // Offset of the first byte dispatch table of this node in the
+  // dispatch array, or RFLAT_NO_DISPATCH.
+  uint32_t dispatch;
+  // Length of the edge label.
+  uint32_t len;
+  // The number of children.
+  uint16_t num_children;
+  union {
+    // Edge label if len <= RFLAT_INLINE_LABEL_LEN.
+    char s[RFLAT_INLINE_LABEL_LEN];
+    // Offset of the edge label in the label array otherwise.
+    uint32_t offset;
+  } label;
+};
+
 class Router {
 public:
   Router();
@@ -77,6 +113,15 @@ public:
   // with match(const StringRef&, const StringRef&).
   size_t add_route(const StringRef &pattern, size_t index,
                    bool wildcard = false);
+  // Compiles the Patricia tree built by add_route into the flat
+  // representation which the match functions use.  This function
+  // must be called after the last add_route call, and before any
+  // match function is called.  Calling add_route invalidates the
+  // compiled form.
+  void compile();
+  // Returns true if the router has been compiled since the last
+  // add_route call.
+  bool compiled() const;
   // Returns the matched index of pattern.  -1 if there is no match.
   ssize_t match(const StringRef &host, const StringRef &path) const;
   // Returns the matched index of pattern |s|.  -1 if there is no
@@ -90,7 +135,7 @@ public:
   // |*last_node| has the last matched node.  One can continue to
   // match the longer pattern using the returned |*last_node| to the
   // another invocation of this function until it returns -1.
-  ssize_t match_prefix(size_t *nread, const RNode **last_node,
+  ssize_t match_prefix(size_t *nread, const RFlatNode **last_node,
                        const StringRef &s) const;
 
   void add_node(RNode *node, const char *pattern, size_t patlen, ssize_t index,
@@ -99,10 +144,35 @@ public:
   void dump() const;
 
 private:
+  // Returns the child of |node| whose edge label starts with |c|, or
+  // nullptr.
+  const RFlatNode *find_child(const RFlatNode *node, char c) const;
+  // Returns the edge label of |node|.
+  const char *label(const RFlatNode *node) const;
+  const RFlatNode *match_complete(size_t *offset, const RFlatNode *node,
+                                  const char *first, const char *last) const;
+  const RFlatNode *match_partial(bool *pattern_is_wildcard,
+                                 const RFlatNode *node, size_t offset,
+                                 const char *first, const char *last) const;
+  const RFlatNode *match_prefix(size_t *nread, const RFlatNode *node,
+                                const char *first, const char *last) const;
+
   BlockAllocator balloc_;
   // The root node of Patricia tree.  This is special node and its s
   // field is nulptr, and len field is 0.
   RNode root_;
+  // The compiled nodes.  The first element is the root.  Empty if
+  // the router has not been compiled.
+  std::vector<RFlatNode> nodes_;
+  // The first byte of the edge label of each node in nodes_, so that
+  // children can be scanned without touching the nodes themselves.
+  std::vector<char> first_bytes_;
+  // Edge labels which are too long to be stored inline.
+  std::vector<char> labels_;
+  // First byte dispatch tables.  Each table has 256 entries, and an
+  // entry is the position of the child relative to first_child plus
+  // 1, or 0 if there is no such child.
+  std::vector<uint16_t> dispatch_;
 };
 
 } // namespace shrpx
@@ -0,0 +1,207 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "shrpx_router.h"
+#include "util.h"
+#include "template.h"
+
+namespace shrpx {
+
+namespace {
+struct RouterBenchConfig {
+  size_t hosts;
+  size_t paths;
+  size_t rounds;
+} config;
+} // namespace
+
+namespace {
+// Matches every host and path |config.rounds| times, and prints the
+// number of matches per second.  This function returns 0 if all
+// matches select the expected pattern, or -1.
+int bench(const Router &router, const std::vector<std::string> &hosts,
+          const std::vector<std::string> &paths) {
+  size_t nmatch = 0, nok = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t r = 0; r < config.rounds; ++r) {
+    for (size_t i = 0; i < hosts.size(); ++i) {
+      for (size_t j = 0; j < paths.size(); ++j) {
+        auto idx = router.match(StringRef{hosts[i]}, StringRef{paths[j]});
+        ++nmatch;
+        if (idx == static_cast<ssize_t>(i * paths.size() + j)) {
+          ++nok;
+        }
+      }
+    }
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+      std::chrono::steady_clock::now() - start);
+
+  auto rate = nmatch / std::max(elapsed.count(), 1e-9);
+
+  std::cout << "router: " << nmatch << " matches in " << elapsed.count()
+            << "s, " << static_cast<uint64_t>(rate) << " matches/s"
+            << std::endl;
+
+  if (nmatch != nok) {
+    std::cerr << "router: " << nmatch - nok
+              << " matches selected wrong pattern" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+} // namespace
+
+namespace {
+void print_help(std::ostream &out) {
+  out << R"(Usage: nghttpx-router-bench [OPTIONS]...
+Benchmark the pattern matching of nghttpx router.
+
+Adds <HOSTS> * <PATHS> patterns of the form
+"svc<I>.example.com/api/v<J>/" to the router, and matches each of them
+with "/api/v<J>/resource" path.
+
+Options:
+  --hosts=<N>
+              The number of hosts.
+              Default: )"
+      << config.hosts << R"(
+  --paths=<N>
+              The number of paths per host.
+              Default: )"
+      << config.paths << R"(
+  --rounds=<N>
+              The number of times to match all patterns.
+              Default: )"
+      << config.rounds << R"(
+  -h, --help  Display this help and exit.)"
+      << std::endl;
+}
+} // namespace
+
+namespace {
+int main(int argc, char **argv) {
+  config.hosts = 1000;
+  config.paths = 10;
+  config.rounds = 20;
+
+  for (;;) {
+    static int flag = 0;
+    constexpr static option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"hosts", required_argument, &flag, 1},
+        {"paths", required_argument, &flag, 2},
+        {"rounds", required_argument, &flag, 3},
+        {nullptr, 0, nullptr, 0}};
+
+    int option_index = 0;
+    auto c = getopt_long(argc, argv, "h", long_options, &option_index);
+    if (c == -1) {
+      break;
+    }
+    switch (c) {
+    case 'h':
+      print_help(std::cout);
+      exit(EXIT_SUCCESS);
+    case '?':
+      exit(EXIT_FAILURE);
+    case 0: {
+      auto n = util::parse_uint(optarg);
+      if (n <= 0) {
+        std::cerr << long_options[option_index].name
+                  << ": positive integer is required" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      switch (flag) {
+      case 1:
+        // --hosts
+        config.hosts = n;
+        break;
+      case 2:
+        // --paths
+        config.paths = n;
+        break;
+      case 3:
+        // --rounds
+        config.rounds = n;
+        break;
+      }
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  std::vector<std::string> hosts, paths;
+
+  for (size_t i = 0; i < config.hosts; ++i) {
+    hosts.push_back("svc" + util::utos(i) + ".example.com");
+  }
+
+  for (size_t j = 0; j < config.paths; ++j) {
+    paths.push_back("/api/v" + util::utos(j) + "/resource");
+  }
+
+  std::vector<std::string> patterns;
+
+  for (size_t i = 0; i < config.hosts; ++i) {
+    for (size_t j = 0; j < config.paths; ++j) {
+      patterns.push_back(hosts[i] + "/api/v" + util::utos(j) + "/");
+    }
+  }
+
+  Router router;
+
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    router.add_route(StringRef{patterns[i]}, i);
+  }
+
+  router.compile();
+
+  std::cout << "router: " << patterns.size() << " patterns" << std::endl;
+
+  return bench(router, hosts, paths) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+} // namespace
+
+} // namespace shrpx
+
+int main(int argc, char **argv) { return run_app(shrpx::main, argc, argv); }
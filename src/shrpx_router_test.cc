@@ -27,6 +27,7 @@
 #include <CUnit/CUnit.h>
 
 #include "shrpx_router.h"
+#include "util.h"
 
 namespace shrpx {
 
@@ -56,6 +57,8 @@ void test_shrpx_router_match(void) {
     router.add_route(p.pattern, p.idx);
   }
 
+  router.compile();
+
   ssize_t idx;
 
   idx = router.match(StringRef::from_lit("nghttp2.org"),
@@ -115,6 +118,8 @@ void test_shrpx_router_match_wildcard(void) {
     router.add_route(p.pattern, p.idx, p.wildcard);
   }
 
+  router.compile();
+
   CU_ASSERT(0 == router.match(StringRef::from_lit("nghttp2.org"),
                               StringRef::from_lit("/")));
 
@@ -157,8 +162,10 @@ void test_shrpx_router_match_prefix(void) {
     router.add_route(p.pattern, p.idx);
   }
 
+  router.compile();
+
   ssize_t idx;
-  const RNode *node;
+  const RFlatNode *node;
   size_t nread;
 
   node = nullptr;
@@ -181,4 +188,97 @@ void test_shrpx_router_match_prefix(void) {
   CU_ASSERT(6 == nread);
 }
 
+void test_shrpx_router_compile(void) {
+  Router router;
+
+  CU_ASSERT(!router.compiled());
+
+  // More children than RFLAT_DISPATCH_THRESHOLD under the root, so
+  // that it gets a dispatch table.  Each host is longer than
+  // RFLAT_INLINE_LABEL_LEN.
+  std::vector<std::string> hosts;
+  for (char c = 'a'; c <= 'z'; ++c) {
+    hosts.push_back(std::string(1, c) + ".long-label.example.com/");
+  }
+
+  for (size_t i = 0; i < hosts.size(); ++i) {
+    router.add_route(StringRef{hosts[i]}, i);
+  }
+
+  router.compile();
+
+  CU_ASSERT(router.compiled());
+
+  for (size_t i = 0; i < hosts.size(); ++i) {
+    auto host = StringRef{hosts[i].c_str(), hosts[i].size() - 1};
+    CU_ASSERT((ssize_t)i ==
+              router.match(host, StringRef::from_lit("/index.html")));
+  }
+
+  CU_ASSERT(-1 == router.match(StringRef::from_lit("0.long-label.example.com"),
+                               StringRef::from_lit("/")));
+  CU_ASSERT(-1 == router.match(StringRef::from_lit("a.long-label.example.co"),
+                               StringRef::from_lit("/")));
+
+  // add_route invalidates the compiled form.
+  router.add_route(StringRef::from_lit("a.long-label.example.com/alpha/"),
+                   hosts.size());
+
+  CU_ASSERT(!router.compiled());
+
+  router.compile();
+
+  CU_ASSERT((ssize_t)hosts.size() ==
+            router.match(StringRef::from_lit("a.long-label.example.com"),
+                         StringRef::from_lit("/alpha/bravo")));
+  CU_ASSERT(0 == router.match(StringRef::from_lit("a.long-label.example.com"),
+                              StringRef::from_lit("/bravo")));
+}
+
+// nghttpx-router-bench measures the throughput with the same patterns.
+void test_shrpx_router_match_many_routes(void) {
+  constexpr size_t num_hosts = 1000;
+  constexpr size_t num_paths = 10;
+
+  std::vector<std::string> hosts, patterns;
+
+  for (size_t i = 0; i < num_hosts; ++i) {
+    hosts.push_back("svc" + util::utos(i) + ".example.com");
+  }
+
+  for (size_t i = 0; i < num_hosts; ++i) {
+    for (size_t j = 0; j < num_paths; ++j) {
+      patterns.push_back(hosts[i] + "/api/v" + util::utos(j) + "/");
+    }
+  }
+
+  Router router;
+
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    router.add_route(StringRef{patterns[i]}, i);
+  }
+
+  router.compile();
+
+  std::vector<std::string> paths;
+  for (size_t j = 0; j < num_paths; ++j) {
+    paths.push_back("/api/v" + util::utos(j) + "/resource");
+  }
+
+  size_t nok = 0;
+
+  for (size_t i = 0; i < num_hosts; ++i) {
+    for (size_t j = 0; j < num_paths; ++j) {
+      auto idx = router.match(StringRef{hosts[i]}, StringRef{paths[j]});
+      if (idx == static_cast<ssize_t>(i * num_paths + j)) {
+        ++nok;
+      }
+    }
+  }
+
+  CU_ASSERT(patterns.size() == nok);
+  CU_ASSERT(-1 == router.match(StringRef::from_lit("svc1000.example.com"),
+                               StringRef::from_lit("/api/v0/resource")));
+}
+
 } // namespace shrpx
@@ -34,6 +34,8 @@ namespace shrpx {
 void test_shrpx_router_match(void);
 void test_shrpx_router_match_wildcard(void);
 void test_shrpx_router_match_prefix(void);
+void test_shrpx_router_compile(void);
+void test_shrpx_router_match_many_routes(void);
 
 } // namespace shrpx
 
@@ -0,0 +1,103 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_splice_pipe.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <fcntl.h>
+
+#include <cerrno>
+#include <array>
+
+#include "shrpx_log.h"
+#include "template.h"
+
+namespace shrpx {
+
+namespace {
+// The maximum number of idle pipes a pool keeps.  Each pipe takes 2
+// file descriptors.
+constexpr size_t MAX_POOLED_SPLICE_PIPES = 64;
+} // namespace
+
+namespace {
+// The pipe buffer size we ask kernel for.  The larger buffer lets
+// backend read go further ahead of a slow client.
+constexpr size_t SPLICE_PIPE_SIZE = 256_k;
+} // namespace
+
+SplicePipe::SplicePipe(int rfd, int wfd, size_t capacity)
+    : rfd(rfd), wfd(wfd), len(0), capacity(capacity) {}
+
+SplicePipe::~SplicePipe() {
+  close(rfd);
+  close(wfd);
+}
+
+std::unique_ptr<SplicePipe> SplicePipePool::get() {
+  if (!pool_.empty()) {
+    auto pipe = std::move(pool_.back());
+    pool_.pop_back();
+    return pipe;
+  }
+
+#if defined(HAVE_SPLICE) && defined(F_SETPIPE_SZ)
+  std::array<int, 2> pfd;
+
+  if (pipe2(pfd.data(), O_NONBLOCK | O_CLOEXEC) != 0) {
+    auto error = errno;
+    LOG(WARN) << "pipe2() failed; errno=" << error;
+    return nullptr;
+  }
+
+  // The kernel may not give us the size we ask for.  Use the actual
+  // size then.
+  fcntl(pfd[1], F_SETPIPE_SZ, SPLICE_PIPE_SIZE);
+
+  auto capacity = fcntl(pfd[1], F_GETPIPE_SZ);
+  if (capacity <= 0) {
+    close(pfd[0]);
+    close(pfd[1]);
+    return nullptr;
+  }
+
+  return std::make_unique<SplicePipe>(pfd[0], pfd[1], capacity);
+#else  // !(defined(HAVE_SPLICE) && defined(F_SETPIPE_SZ))
+  return nullptr;
+#endif // !(defined(HAVE_SPLICE) && defined(F_SETPIPE_SZ))
+}
+
+void SplicePipePool::release(std::unique_ptr<SplicePipe> pipe) {
+  if (pipe->len || pool_.size() >= MAX_POOLED_SPLICE_PIPES) {
+    return;
+  }
+
+  pool_.push_back(std::move(pipe));
+}
+
+size_t SplicePipePool::size() const { return pool_.size(); }
+
+} // namespace shrpx
@@ -0,0 +1,72 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_SPLICE_PIPE_H
+#define SHRPX_SPLICE_PIPE_H
+
+#include "shrpx.h"
+
+#include <memory>
+#include <vector>
+
+namespace shrpx {
+
+// SplicePipe is a pipe which moves data between 2 sockets with
+// splice(2) without copying it to user space.
+struct SplicePipe {
+  SplicePipe(int rfd, int wfd, size_t capacity);
+  ~SplicePipe();
+
+  SplicePipe(const SplicePipe &) = delete;
+  SplicePipe &operator=(const SplicePipe &) = delete;
+
+  // Read end of the pipe
+  int rfd;
+  // Write end of the pipe
+  int wfd;
+  // The number of bytes in the pipe
+  size_t len;
+  // The number of bytes the pipe can hold
+  size_t capacity;
+};
+
+// SplicePipePool keeps idle SplicePipes for a worker.
+class SplicePipePool {
+public:
+  // Returns empty SplicePipe, or nullptr if splice(2) is not
+  // available or a pipe cannot be created.
+  std::unique_ptr<SplicePipe> get();
+  // Returns |pipe| to this pool.  If it still has data, or the pool
+  // is full, it is closed.
+  void release(std::unique_ptr<SplicePipe> pipe);
+
+  size_t size() const;
+
+private:
+  std::vector<std::unique_ptr<SplicePipe>> pool_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_SPLICE_PIPE_H
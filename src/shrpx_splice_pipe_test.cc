@@ -0,0 +1,70 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_splice_pipe_test.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_splice_pipe.h"
+
+namespace shrpx {
+
+void test_shrpx_splice_pipe_pool(void) {
+  SplicePipePool pool;
+
+  auto pipe = pool.get();
+  if (!pipe) {
+    // splice(2) is not available on this platform.
+    return;
+  }
+
+  CU_ASSERT(0 == pipe->len);
+  CU_ASSERT(pipe->capacity > 0);
+
+  auto p = pipe.get();
+
+  pool.release(std::move(pipe));
+
+  CU_ASSERT(1 == pool.size());
+
+  // Empty pipe is reused.
+  pipe = pool.get();
+
+  CU_ASSERT(p == pipe.get());
+  CU_ASSERT(0 == pool.size());
+
+  // Pipe which still has data is not returned to the pool.
+  CU_ASSERT(1 == write(pipe->wfd, "a", 1));
+  pipe->len = 1;
+
+  pool.release(std::move(pipe));
+
+  CU_ASSERT(0 == pool.size());
+}
+
+} // namespace shrpx
@@ -1997,12 +1997,11 @@ ssize_t CertLookupTree::add_cert(const StringRef &hostname, size_t idx) {
 
     WildcardPattern *wpat;
 
-    if (wildcard_patterns_.size() !=
-        rev_wildcard_router_.add_route(rev_suffix, wildcard_patterns_.size())) {
-      auto wcidx = rev_wildcard_router_.match(rev_suffix);
-
-      assert(wcidx != -1);
-
+    auto wcidx =
+        rev_wildcard_router_.add_route(rev_suffix, wildcard_patterns_.size());
+    if (wcidx != wildcard_patterns_.size()) {
+      // add_route returns the existing index for the duplicated
+      // suffix.
       wpat = &wildcard_patterns_[wcidx];
     } else {
       wildcard_patterns_.emplace_back();
@@ -2028,6 +2027,11 @@ ssize_t CertLookupTree::add_cert(const StringRef &hostname, size_t idx) {
   return router_.add_route(hostname, idx);
 }
 
+void CertLookupTree::compile() {
+  router_.compile();
+  rev_wildcard_router_.compile();
+}
+
 ssize_t CertLookupTree::lookup(const StringRef &hostname) {
   std::array<uint8_t, NI_MAXHOST> buf;
 
@@ -2048,7 +2052,7 @@ ssize_t CertLookupTree::lookup(const StringRef &hostname) {
 
   ssize_t best_idx = -1;
   size_t best_prefixlen = 0;
-  const RNode *last_node = nullptr;
+  const RFlatNode *last_node = nullptr;
 
   auto rev_host = StringRef{
       std::begin(buf), std::reverse_copy(std::begin(hostname),
@@ -2231,9 +2235,13 @@ bool upstream_tls_enabled(const ConnectionConfig &connconf) {
   }
 #endif // ENABLE_HTTP3
 
+  auto has_tls = [](const UpstreamAddr &faddr) { return faddr.tls; };
+
   const auto &faddrs = connconf.listener.addrs;
-  return std::any_of(std::begin(faddrs), std::end(faddrs),
-                     [](const UpstreamAddr &faddr) { return faddr.tls; });
+  const auto &reuseport_faddrs = connconf.reuseport_listener.addrs;
+  return std::any_of(std::begin(faddrs), std::end(faddrs), has_tls) ||
+         std::any_of(std::begin(reuseport_faddrs), std::end(reuseport_faddrs),
+                     has_tls);
 }
 
 X509 *load_certificate(const char *filename) {
@@ -2307,6 +2315,8 @@ setup_server_ssl_context(std::vector<SSL_CTX *> &all_ssl_ctx,
     }
   }
 
+  cert_tree->compile();
+
   return ssl_ctx;
 }
 
@@ -2363,6 +2373,8 @@ SSL_CTX *setup_quic_server_ssl_context(
     }
   }
 
+  cert_tree->compile();
+
   return ssl_ctx;
 }
 #endif // ENABLE_HTTP3
@@ -164,6 +164,10 @@ public:
   // hostname has already been added to the tree.
   ssize_t add_cert(const StringRef &hostname, size_t index);
 
+  // Compiles the lookup tree.  This function must be called after
+  // the last add_cert call, and before lookup is called.
+  void compile();
+
   // Looks up index using the given |hostname|.  The exact match takes
   // precedence over wildcard match.  For wildcard match, longest
   // match (sum of matched suffix and prefix length in bytes) is
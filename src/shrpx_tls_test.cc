@@ -56,6 +56,8 @@ void test_shrpx_tls_create_lookup_tree(void) {
     tree->add_cert(hostnames[idx], idx);
   }
 
+  tree->compile();
+
   tree->dump();
 
   CU_ASSERT(0 == tree->lookup(hostnames[0]));
@@ -89,6 +91,8 @@ void test_shrpx_tls_create_lookup_tree(void) {
   for (size_t idx = 0; idx < num; ++idx) {
     tree->add_cert(names[idx], idx);
   }
+
+  tree->compile();
   for (size_t i = 0; i < num; ++i) {
     CU_ASSERT((ssize_t)i == tree->lookup(names[i]));
   }
@@ -154,6 +158,8 @@ void test_shrpx_tls_cert_lookup_tree_add_ssl_ctx(void) {
 
   CU_ASSERT(0 == rv);
 
+  tree.compile();
+
   CU_ASSERT(-1 == tree.lookup(StringRef::from_lit("not-used.nghttp2.org")));
   CU_ASSERT(0 == tree.lookup(StringRef::from_lit("test.nghttp2.org")));
   CU_ASSERT(1 == tree.lookup(StringRef::from_lit("w.test.nghttp2.org")));
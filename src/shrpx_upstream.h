@@ -36,6 +36,7 @@ namespace shrpx {
 class ClientHandler;
 class Downstream;
 class DownstreamConnection;
+struct SplicePipe;
 
 class Upstream {
 public:
@@ -82,7 +83,23 @@ public:
   // the number of iovs filled.
   virtual int response_riovec(struct iovec *iov, int iovcnt) const = 0;
   virtual void response_drain(size_t n) = 0;
+  // Drains |n| bytes like response_drain(size_t), but the buffers
+  // which are completely drained are moved to |pinned| instead of
+  // being recycled.
+  virtual void response_drain(size_t n, DefaultMemchunks &pinned) = 0;
   virtual bool response_empty() const = 0;
+  // Returns true if response body of |downstream| can be written to
+  // upstream connection with splice(2).
+  virtual bool response_splice_enabled(const Downstream *downstream) const {
+    return false;
+  }
+  // Returns the pipe which holds response body to write after the
+  // data returned by response_riovec(), or nullptr if there is no
+  // such data.
+  virtual SplicePipe *response_pipe() const { return nullptr; }
+  // Called when |n| bytes of response body are written from the pipe
+  // returned by response_pipe().
+  virtual void response_pipe_drain(size_t n) {}
 
   // Called when PUSH_PROMISE was started in downstream.  The
   // associated downstream is given as |downstream|.  The promised
@@ -27,9 +27,21 @@
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif // HAVE_UNISTD_H
+#ifdef HAVE_NETDB_H
+#  include <netdb.h>
+#endif // HAVE_NETDB_H
+#include <netinet/tcp.h>
+#ifdef HAVE_SCHED_SETAFFINITY
+#  include <sched.h>
+#endif // HAVE_SCHED_SETAFFINITY
+#ifdef HAVE_MALLOC_TRIM
+#  include <malloc.h>
+#endif // HAVE_MALLOC_TRIM
 
 #include <cstdio>
 #include <memory>
+#include <set>
+#include <algorithm>
 
 #include <openssl/rand.h>
 
@@ -42,6 +54,9 @@
 #include "shrpx_log.h"
 #include "shrpx_client_handler.h"
 #include "shrpx_http2_session.h"
+#include "shrpx_http_downstream_connection.h"
+#include "shrpx_http2_backend_io_downstream_connection.h"
+#include "shrpx_downstream_connection.h"
 #include "shrpx_log_config.h"
 #include "shrpx_memcached_dispatcher.h"
 #ifdef HAVE_MRUBY
@@ -51,6 +66,11 @@
 #  include "shrpx_quic_listener.h"
 #endif // ENABLE_HTTP3
 #include "shrpx_connection_handler.h"
+#include "shrpx_accept_handler.h"
+#include "shrpx_response_cache.h"
+#include "shrpx_compressor.h"
+#include "shrpx_splice_pipe.h"
+#include "shrpx_io_uring.h"
 #include "util.h"
 #include "template.h"
 #include "xsi_strerror.h"
@@ -64,6 +84,21 @@ void eventcb(struct ev_loop *loop, ev_async *w, int revents) {
 }
 } // namespace
 
+namespace {
+void backend_io_eventcb(struct ev_loop *loop, ev_async *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+  worker->process_http2_backend_io_events();
+}
+} // namespace
+
+namespace {
+void zerocopy_linger_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+
+  worker->release_lingering_zerocopy_buffers();
+}
+} // namespace
+
 namespace {
 void mcpool_clear_cb(struct ev_loop *loop, ev_timer *w, int revents) {
   auto worker = static_cast<Worker *>(w->data);
@@ -84,6 +119,37 @@ void proc_wev_cb(struct ev_loop *loop, ev_timer *w, int revents) {
 }
 } // namespace
 
+namespace {
+// The interval to measure event loop lag
+constexpr auto LOOP_LAG_INTERVAL = 100_ms;
+} // namespace
+
+namespace {
+void loop_lag_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+  worker->update_loop_lag();
+}
+} // namespace
+
+namespace {
+void mcpool_trim_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+  worker->trim_mcpool();
+}
+} // namespace
+
+namespace {
+// The maximum interval to maintain idle backend connections
+constexpr auto IDLE_BACKEND_INTERVAL = 1_s;
+} // namespace
+
+namespace {
+void idle_backend_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+  worker->maintain_idle_backend_connections();
+}
+} // namespace
+
 DownstreamAddrGroup::DownstreamAddrGroup() : retired{false} {}
 
 DownstreamAddrGroup::~DownstreamAddrGroup() {}
@@ -93,9 +159,11 @@ DownstreamAddrGroup::~DownstreamAddrGroup() {}
 using DownstreamKey = std::tuple<
     std::vector<
         std::tuple<StringRef, StringRef, StringRef, size_t, size_t, Proto,
-                   uint32_t, uint32_t, uint32_t, bool, bool, bool, bool>>,
+                   uint32_t, uint32_t, uint32_t, bool, bool, bool, bool,
+                   size_t, bool>>,
     bool, SessionAffinity, StringRef, StringRef, SessionAffinityCookieSecure,
-    SessionAffinityCookieStickiness, int64_t, int64_t, StringRef, bool>;
+    SessionAffinityCookieStickiness, int64_t, int64_t, StringRef, bool,
+    bool, bool, LoadBalancing, StringRef, SessionAffinityHash, uint32_t>;
 
 namespace {
 DownstreamKey
@@ -120,6 +188,8 @@ create_downstream_key(const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
     std::get<10>(*p) = a.tls;
     std::get<11>(*p) = a.dns;
     std::get<12>(*p) = a.upgrade_scheme;
+    std::get<13>(*p) = a.min_idle;
+    std::get<14>(*p) = a.prewarm;
     ++p;
   }
   std::sort(std::begin(addrs), std::end(addrs));
@@ -137,6 +207,12 @@ create_downstream_key(const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
   std::get<8>(dkey) = timeout.write;
   std::get<9>(dkey) = mruby_file;
   std::get<10>(dkey) = shared_addr->dnf;
+  std::get<11>(dkey) = shared_addr->cache;
+  std::get<12>(dkey) = shared_addr->collapse;
+  std::get<13>(dkey) = shared_addr->balance;
+  std::get<14>(dkey) = affinity.key_name;
+  std::get<15>(dkey) = affinity.hash;
+  std::get<16>(dkey) = affinity.bounded_load;
 
   return dkey;
 }
@@ -159,12 +235,16 @@ Worker::Worker(struct ev_loop *loop, SSL_CTX *sv_ssl_ctx, SSL_CTX *cl_ssl_ctx,
 #if defined(ENABLE_HTTP3) && defined(HAVE_LIBBPF)
       index_{index},
 #endif // ENABLE_HTTP3 && HAVE_LIBBPF
+      num_queued_events_{0},
+      loop_lag_{0},
       randgen_(util::make_mt19937()),
+      cpu_(-1),
       worker_stat_{},
       dns_tracker_(loop),
 #ifdef ENABLE_HTTP3
       quic_upstream_addrs_{get_config()->conn.quic_listener.addrs},
 #endif // ENABLE_HTTP3
+      reuseport_upstream_addrs_{get_config()->conn.reuseport_listener.addrs},
       loop_(loop),
       sv_ssl_ctx_(sv_ssl_ctx),
       cl_ssl_ctx_(cl_ssl_ctx),
@@ -187,12 +267,53 @@ Worker::Worker(struct ev_loop *loop, SSL_CTX *sv_ssl_ctx, SSL_CTX *cl_ssl_ctx,
   w_.data = this;
   ev_async_start(loop_, &w_);
 
+  ev_async_init(&backend_io_w_, backend_io_eventcb);
+  backend_io_w_.data = this;
+  ev_async_start(loop_, &backend_io_w_);
+
+  if (get_config()->conn.upstream.io_engine == IOEngine::IO_URING) {
+    io_uring_ = std::make_unique<IOUring>(loop_);
+    if (io_uring_->init() != 0) {
+      LOG(WARN) << "io_uring is not available; fall back to libev";
+      io_uring_.reset();
+    }
+  }
+
+  auto &bufpoolconf = get_config()->buffer_pool;
+
+  mcpool_.high_watermark = bufpoolconf.high_watermark;
+  mcpool_.low_watermark = bufpoolconf.low_watermark;
+
   ev_timer_init(&mcpool_clear_timer_, mcpool_clear_cb, 0., 0.);
   mcpool_clear_timer_.data = this;
 
+  ev_timer_init(&mcpool_trim_timer_, mcpool_trim_cb, MCPOOL_TRIM_INTERVAL,
+                MCPOOL_TRIM_INTERVAL);
+  mcpool_trim_timer_.data = this;
+  ev_timer_start(loop_, &mcpool_trim_timer_);
+
   ev_timer_init(&proc_wev_timer_, proc_wev_cb, 0., 0.);
   proc_wev_timer_.data = this;
 
+  ev_timer_init(&loop_lag_timer_, loop_lag_cb, LOOP_LAG_INTERVAL, 0.);
+  loop_lag_timer_.data = this;
+
+  ev_timer_init(&idle_backend_timer_, idle_backend_cb, 0., 0.);
+  idle_backend_timer_.data = this;
+
+  ev_timer_init(&zerocopy_linger_timer_, zerocopy_linger_cb, 0., 0.);
+  zerocopy_linger_timer_.data = this;
+
+  auto least_loaded = get_config()->conn.listener.worker_dispatch ==
+                      WorkerDispatch::LEAST_LOADED;
+
+  worker_stat_.count_streams = least_loaded || get_config()->api.enabled;
+
+  if (least_loaded) {
+    loop_lag_expiry_ = ev_now(loop_) + LOOP_LAG_INTERVAL;
+    ev_timer_start(loop_, &loop_lag_timer_);
+  }
+
   auto &session_cacheconf = get_config()->tls.session_cache;
 
   if (!session_cacheconf.memcached.host.empty()) {
@@ -239,15 +360,95 @@ void ensure_enqueue_addr(
 }
 } // namespace
 
+bool same_backend_addr(const DownstreamAddr &a, const DownstreamAddr &b) {
+  return a.host == b.host && a.port == b.port && a.host_unix == b.host_unix &&
+         a.proto == b.proto && a.tls == b.tls && a.sni == b.sni &&
+         a.dns == b.dns && a.upgrade_scheme == b.upgrade_scheme &&
+         a.addr.len == b.addr.len &&
+         memcmp(&a.addr.su, &b.addr.su, a.addr.len) == 0;
+}
+
+namespace {
+// Returns true if |a| and |b| have the same list of backend
+// addresses in the same order.
+bool same_backend_addrs(const SharedDownstreamAddr &a,
+                        const SharedDownstreamAddr &b) {
+  if (a.addrs.size() != b.addrs.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.addrs.size(); ++i) {
+    auto &x = a.addrs[i];
+    auto &y = b.addrs[i];
+
+    if (!same_backend_addr(x, y) || x.weight != y.weight ||
+        x.group != y.group || x.group_weight != y.group_weight ||
+        x.fall != y.fall || x.rise != y.rise ||
+        x.min_idle != y.min_idle || x.prewarm != y.prewarm ||
+        x.affinity_hash != y.affinity_hash) {
+      return false;
+    }
+  }
+
+  return true;
+}
+} // namespace
+
+namespace {
+// Hands over the state of |src|, which belongs to a retired backend
+// group, to |dst| in |group|.  |src| and |dst| must have the same
+// backend address.  Idle HTTP/1 connections, HTTP/2 sessions which
+// still accept new streams, and the peer in backend I/O thread are
+// moved to |dst|.
+void inherit_backend_addr(const std::shared_ptr<DownstreamAddrGroup> &group,
+                          DownstreamAddr &dst, DownstreamAddr &src) {
+  dst.tls_session_cache = std::move(src.tls_session_cache);
+  dst.http2_backend_io = std::exchange(src.http2_backend_io, nullptr);
+  dst.http2_backend_io_peer = std::exchange(src.http2_backend_io_peer, nullptr);
+  dst.load.ewma = src.load.ewma;
+  dst.load.last_update = src.load.last_update;
+  dst.keep_idle = dst.keep_idle || src.keep_idle;
+
+  dst.connect_blocker->inherit(*src.connect_blocker);
+  if (dst.connect_blocker->in_offline() && dst.rise) {
+    dst.live_check->schedule();
+  }
+
+  for (;;) {
+    auto dconn = src.dconn_pool->pop_downstream_connection();
+    if (!dconn) {
+      break;
+    }
+
+    dconn->rebind(group, &dst);
+    dst.dconn_pool->add_downstream_connection(std::move(dconn));
+  }
+
+  while (src.http2_extra_freelist.head) {
+    auto session = src.http2_extra_freelist.head;
+    session->remove_from_freelist();
+    session->rebind(group, &dst);
+    session->add_to_extra_freelist();
+  }
+}
+} // namespace
+
 void Worker::replace_downstream_config(
     std::shared_ptr<DownstreamConfig> downstreamconf) {
-  for (auto &g : downstream_addr_groups_) {
-    g->retired = true;
-
+  // A backend group which has exactly the same configuration in the
+  // new configuration is carried over as it is, keeping all of its
+  // connections.  The other groups are retired, but the state of
+  // their addresses is handed over to the identical addresses in the
+  // new groups.
+  auto old_groups = std::move(downstream_addr_groups_);
+
+  std::map<DownstreamKey, std::shared_ptr<SharedDownstreamAddr>>
+      old_shared_addrs;
+  for (auto &g : old_groups) {
     auto &shared_addr = g->shared_addr;
-    for (auto &addr : shared_addr->addrs) {
-      addr.dconn_pool->remove_all();
-    }
+    old_shared_addrs.emplace(
+        create_downstream_key(shared_addr, shared_addr->mruby_file),
+        shared_addr);
   }
 
   downstreamconf_ = downstreamconf;
@@ -259,14 +460,19 @@ void Worker::replace_downstream_config(
   downstream_addr_groups_ =
       std::vector<std::shared_ptr<DownstreamAddrGroup>>(groups.size());
 
+  auto stat_set = std::make_shared<BackendStatSet>(downstreamconf);
+
   std::map<DownstreamKey, size_t> addr_groups_indexer;
+  // The indices of groups which got newly created SharedDownstreamAddr.
+  std::vector<size_t> fresh_groups;
+  // SharedDownstreamAddr carried over from the old configuration.
+  std::set<const SharedDownstreamAddr *> reused_shared_addrs;
 #ifdef HAVE_MRUBY
   // TODO It is a bit less efficient because
   // mruby::create_mruby_context returns std::unique_ptr and we cannot
   // use std::make_shared.
   std::map<StringRef, std::shared_ptr<mruby::MRubyContext>> shared_mruby_ctxs;
 #endif // HAVE_MRUBY
-
   for (size_t i = 0; i < groups.size(); ++i) {
     auto &src = groups[i];
     auto &dst = downstream_addr_groups_[i];
@@ -274,6 +480,7 @@ void Worker::replace_downstream_config(
     dst = std::make_shared<DownstreamAddrGroup>();
     dst->pattern =
         ImmutableString{std::begin(src.pattern), std::end(src.pattern)};
+    dst->stat = std::shared_ptr<BackendStat>(stat_set, &stat_set->groups[i]);
 
     auto shared_addr = std::make_shared<SharedDownstreamAddr>();
 
@@ -289,12 +496,24 @@ void Worker::replace_downstream_config(
       shared_addr->affinity.cookie.secure = src.affinity.cookie.secure;
       shared_addr->affinity.cookie.stickiness = src.affinity.cookie.stickiness;
     }
+    if (!src.affinity.key_name.empty()) {
+      shared_addr->affinity.key_name =
+          make_string_ref(shared_addr->balloc, src.affinity.key_name);
+    }
+    shared_addr->affinity.hash = src.affinity.hash;
+    shared_addr->affinity.bounded_load = src.affinity.bounded_load;
     shared_addr->affinity_hash = src.affinity_hash;
     shared_addr->affinity_hash_map = src.affinity_hash_map;
+    shared_addr->affinity_maglev = src.affinity_maglev;
     shared_addr->redirect_if_not_tls = src.redirect_if_not_tls;
     shared_addr->dnf = src.dnf;
+    shared_addr->cache = src.cache;
+    shared_addr->collapse = src.collapse;
+    shared_addr->balance = src.balance;
     shared_addr->timeout.read = src.timeout.read;
     shared_addr->timeout.write = src.timeout.write;
+    shared_addr->mruby_file =
+        make_string_ref(shared_addr->balloc, src.mruby_file);
 
     for (size_t j = 0; j < src.addrs.size(); ++j) {
       auto &src_addr = src.addrs[j];
@@ -315,8 +534,16 @@ void Worker::replace_downstream_config(
       dst_addr.sni = make_string_ref(shared_addr->balloc, src_addr.sni);
       dst_addr.fall = src_addr.fall;
       dst_addr.rise = src_addr.rise;
+      dst_addr.min_idle = src_addr.min_idle;
+      dst_addr.prewarm = src_addr.prewarm;
+      dst_addr.keep_idle = src_addr.prewarm;
       dst_addr.dns = src_addr.dns;
       dst_addr.upgrade_scheme = src_addr.upgrade_scheme;
+
+      shared_addr->affinity_total_weight +=
+          shared_addr->affinity.hash == SessionAffinityHash::MAGLEV
+              ? src_addr.weight
+              : 1;
     }
 
 #ifdef HAVE_MRUBY
@@ -336,86 +563,259 @@ void Worker::replace_downstream_config(
     auto dkey = create_downstream_key(shared_addr, src.mruby_file);
     auto it = addr_groups_indexer.find(dkey);
 
-    if (it == std::end(addr_groups_indexer)) {
-      auto shared_addr_ptr = shared_addr.get();
+    if (it != std::end(addr_groups_indexer)) {
+      auto &g = *(std::begin(downstream_addr_groups_) + (*it).second);
+      if (LOG_ENABLED(INFO)) {
+        LOG(INFO) << dst->pattern << " shares the same backend group with "
+                  << g->pattern;
+      }
+      dst->shared_addr = g->shared_addr;
+
+      continue;
+    }
 
-      for (auto &addr : shared_addr->addrs) {
-        addr.connect_blocker = std::make_unique<ConnectBlocker>(
-            randgen_, loop_, nullptr, [shared_addr_ptr, &addr]() {
-              if (!addr.queued) {
-                if (!addr.wg) {
-                  return;
-                }
-                ensure_enqueue_addr(shared_addr_ptr->pq, addr.wg, &addr);
-              }
-            });
+    // mruby script might have been changed even if the path is the
+    // same.  Always load it again.
+    auto old_it = old_shared_addrs.find(dkey);
+    if (old_it != std::end(old_shared_addrs) && src.mruby_file.empty() &&
+        same_backend_addrs(*(*old_it).second, *shared_addr)) {
+      if (LOG_ENABLED(INFO)) {
+        LOG(INFO) << dst->pattern
+                  << " keeps the backend group of the previous configuration";
+      }
+
+      dst->shared_addr = std::move((*old_it).second);
+      old_shared_addrs.erase(old_it);
 
-        addr.live_check = std::make_unique<LiveCheck>(loop_, cl_ssl_ctx_, this,
-                                                      &addr, randgen_);
+      auto &old_shared_addr = dst->shared_addr;
+
+      reused_shared_addrs.insert(old_shared_addr.get());
+
+      old_shared_addr->stat = dst->stat;
+
+      auto stat = dst->stat.get();
+
+      for (auto &addr : old_shared_addr->addrs) {
+        addr.stat = stat;
+        if (addr.connect_blocker->blocked()) {
+          stat_add(stat->blocked_addrs);
+        }
       }
 
-      size_t seq = 0;
+      // dkey refers to the strings owned by shared_addr which is
+      // going to be destroyed.
+      addr_groups_indexer.emplace(
+          create_downstream_key(old_shared_addr, old_shared_addr->mruby_file),
+          i);
+
+      continue;
+    }
+
+    auto shared_addr_ptr = shared_addr.get();
+
+    shared_addr->stat = dst->stat;
+
+    auto stat = dst->stat.get();
+
+    for (auto &addr : shared_addr->addrs) {
+      addr.stat = stat;
+      // addr.stat is replaced when this group is carried over to
+      // the new configuration.
+      addr.connect_blocker = std::make_unique<ConnectBlocker>(
+          randgen_, loop_, [&addr]() { stat_add(addr.stat->blocked_addrs); },
+          [shared_addr_ptr, &addr]() {
+            auto stat = addr.stat;
+            if (stat->blocked_addrs.load(std::memory_order_relaxed)) {
+              stat_sub(stat->blocked_addrs);
+            }
+
+            if (!addr.queued) {
+              if (!addr.wg) {
+                return;
+              }
+              ensure_enqueue_addr(shared_addr_ptr->pq, addr.wg, &addr);
+            }
+          });
+
+      addr.live_check = std::make_unique<LiveCheck>(loop_, cl_ssl_ctx_, this,
+                                                    &addr, randgen_);
+    }
+
+    size_t seq = 0;
+    for (auto &addr : shared_addr->addrs) {
+      addr.dconn_pool = std::make_unique<DownstreamConnectionPool>();
+      addr.seq = seq++;
+    }
+
+    util::shuffle(std::begin(shared_addr->addrs),
+                  std::end(shared_addr->addrs), randgen_,
+                  [](auto i, auto j) { std::swap((*i).seq, (*j).seq); });
+
+    if (shared_addr->affinity.type == SessionAffinity::NONE) {
+      std::map<StringRef, WeightGroup *> wgs;
+      size_t num_wgs = 0;
       for (auto &addr : shared_addr->addrs) {
-        addr.dconn_pool = std::make_unique<DownstreamConnectionPool>();
-        addr.seq = seq++;
+        if (wgs.find(addr.group) == std::end(wgs)) {
+          ++num_wgs;
+          wgs.emplace(addr.group, nullptr);
+        }
       }
 
-      util::shuffle(std::begin(shared_addr->addrs),
-                    std::end(shared_addr->addrs), randgen_,
-                    [](auto i, auto j) { std::swap((*i).seq, (*j).seq); });
-
-      if (shared_addr->affinity.type == SessionAffinity::NONE) {
-        std::map<StringRef, WeightGroup *> wgs;
-        size_t num_wgs = 0;
-        for (auto &addr : shared_addr->addrs) {
-          if (wgs.find(addr.group) == std::end(wgs)) {
-            ++num_wgs;
-            wgs.emplace(addr.group, nullptr);
-          }
+      shared_addr->wgs = std::vector<WeightGroup>(num_wgs);
+
+      for (auto &addr : shared_addr->addrs) {
+        auto &wg = wgs[addr.group];
+        if (wg == nullptr) {
+          wg = &shared_addr->wgs[--num_wgs];
+          wg->seq = num_wgs;
         }
 
-        shared_addr->wgs = std::vector<WeightGroup>(num_wgs);
+        wg->weight = addr.group_weight;
+        wg->pq.push(DownstreamAddrEntry{&addr, addr.seq, addr.cycle});
+        wg->addrs.push_back(&addr);
+        addr.queued = true;
+        addr.wg = wg;
+      }
+
+      assert(num_wgs == 0);
 
-        for (auto &addr : shared_addr->addrs) {
-          auto &wg = wgs[addr.group];
-          if (wg == nullptr) {
-            wg = &shared_addr->wgs[--num_wgs];
-            wg->seq = num_wgs;
-          }
+      for (auto &kv : wgs) {
+        shared_addr->pq.push(
+            WeightGroupEntry{kv.second, kv.second->seq, kv.second->cycle});
+        kv.second->queued = true;
+      }
+    }
 
-          wg->weight = addr.group_weight;
-          wg->pq.push(DownstreamAddrEntry{&addr, addr.seq, addr.cycle});
-          addr.queued = true;
-          addr.wg = wg;
-        }
+    dst->shared_addr = shared_addr;
+
+    addr_groups_indexer.emplace(std::move(dkey), i);
 
-        assert(num_wgs == 0);
+    fresh_groups.push_back(i);
+  }
+
+  // Addresses in the groups which are going to be retired.
+  std::multimap<std::pair<StringRef, uint16_t>, DownstreamAddr *> old_addrs;
+  for (auto &kv : old_shared_addrs) {
+    for (auto &addr : kv.second->addrs) {
+      old_addrs.emplace(std::make_pair(addr.host, addr.port), &addr);
+    }
+  }
 
-        for (auto &kv : wgs) {
-          shared_addr->pq.push(
-              WeightGroupEntry{kv.second, kv.second->seq, kv.second->cycle});
-          kv.second->queued = true;
+  for (auto i : fresh_groups) {
+    auto &g = downstream_addr_groups_[i];
+
+    for (auto &addr : g->shared_addr->addrs) {
+      auto range = old_addrs.equal_range(std::make_pair(addr.host, addr.port));
+      for (auto it = range.first; it != range.second; ++it) {
+        if (!same_backend_addr(*(*it).second, addr)) {
+          continue;
+        }
+
+        if (LOG_ENABLED(INFO)) {
+          LOG(INFO) << "Backend " << addr.host << ":" << addr.port
+                    << " in " << g->pattern
+                    << " inherits the state of the previous configuration";
         }
+
+        inherit_backend_addr(g, addr, *(*it).second);
+        old_addrs.erase(it);
+
+        break;
       }
+    }
+  }
 
-      dst->shared_addr = shared_addr;
+  // Counters of the patterns whose backend group is carried over
+  // continue from the previous configuration.
+  std::map<StringRef, const BackendStat *> old_stats;
+  for (auto &g : old_groups) {
+    old_stats.emplace(StringRef{g->pattern}, g->stat.get());
+  }
 
-      addr_groups_indexer.emplace(std::move(dkey), i);
-    } else {
-      auto &g = *(std::begin(downstream_addr_groups_) + (*it).second);
-      if (LOG_ENABLED(INFO)) {
-        LOG(INFO) << dst->pattern << " shares the same backend group with "
-                  << g->pattern;
+  for (auto &g : downstream_addr_groups_) {
+    if (!reused_shared_addrs.count(g->shared_addr.get())) {
+      continue;
+    }
+
+    auto it = old_stats.find(StringRef{g->pattern});
+    if (it == std::end(old_stats)) {
+      continue;
+    }
+
+    copy_backend_stat(*g->stat, *(*it).second);
+  }
+
+  for (auto &g : old_groups) {
+    auto &shared_addr = g->shared_addr;
+
+    if (reused_shared_addrs.count(shared_addr.get())) {
+      // Connections made through this group are still usable.
+      g->stat = shared_addr->stat;
+
+      continue;
+    }
+
+    g->retired = true;
+
+    for (auto &addr : shared_addr->addrs) {
+      addr.dconn_pool->remove_all();
+
+      // The backend I/O thread deletes the peer when no worker refers
+      // to it.
+      if (addr.http2_backend_io_peer) {
+        addr.http2_backend_io->release_peer(addr.http2_backend_io_peer);
+        addr.http2_backend_io_peer = nullptr;
+        addr.http2_backend_io = nullptr;
       }
-      dst->shared_addr = g->shared_addr;
     }
   }
+
+#ifdef HAVE_ATOMIC_STD_SHARED_PTR
+  // This is single writer
+  std::atomic_store_explicit(&backend_stat_set_, std::move(stat_set),
+                             std::memory_order_release);
+#else  // !HAVE_ATOMIC_STD_SHARED_PTR
+  std::lock_guard<std::mutex> g(backend_stat_set_m_);
+  backend_stat_set_ = std::move(stat_set);
+#endif // !HAVE_ATOMIC_STD_SHARED_PTR
+
+  ev_timer_stop(loop_, &idle_backend_timer_);
+
+  auto keep_idle = std::any_of(
+      std::begin(downstream_addr_groups_), std::end(downstream_addr_groups_),
+      [](const std::shared_ptr<DownstreamAddrGroup> &g) {
+        auto &addrs = g->shared_addr->addrs;
+        return std::any_of(std::begin(addrs), std::end(addrs),
+                           [](const DownstreamAddr &addr) {
+                             return addr.min_idle != 0;
+                           });
+      });
+
+  if (!keep_idle) {
+    return;
+  }
+
+  // Check well before the idle connections are timed out.  The
+  // first check happens immediately to prewarm connections.
+  auto interval =
+      std::min(downstreamconf_->timeout.idle_read / 2, IDLE_BACKEND_INTERVAL);
+  if (interval <= 0.) {
+    interval = IDLE_BACKEND_INTERVAL;
+  }
+
+  ev_timer_set(&idle_backend_timer_, 0., interval);
+  ev_timer_start(loop_, &idle_backend_timer_);
 }
 
 Worker::~Worker() {
   ev_async_stop(loop_, &w_);
+  ev_async_stop(loop_, &backend_io_w_);
   ev_timer_stop(loop_, &mcpool_clear_timer_);
+  ev_timer_stop(loop_, &mcpool_trim_timer_);
   ev_timer_stop(loop_, &proc_wev_timer_);
+  ev_timer_stop(loop_, &loop_lag_timer_);
+  ev_timer_stop(loop_, &idle_backend_timer_);
+  ev_timer_stop(loop_, &zerocopy_linger_timer_);
 }
 
 void Worker::schedule_clear_mcpool() {
@@ -425,6 +825,19 @@ void Worker::schedule_clear_mcpool() {
   ev_timer_start(loop_, &mcpool_clear_timer_);
 }
 
+void Worker::trim_mcpool() {
+  auto nfreed = mcpool_.trim();
+  if (nfreed == 0) {
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    WLOG(INFO, this) << "Trimmed " << nfreed << " bytes of unused buffers";
+  }
+
+  request_malloc_trim();
+}
+
 void Worker::wait() {
 #ifndef NOTHREADS
   fut_.get();
@@ -435,6 +848,10 @@ void Worker::run_async() {
 #ifndef NOTHREADS
   fut_ = std::async(std::launch::async, [this] {
     (void)reopen_log_files(get_config()->logging);
+    // Pin this thread before running event loop so that memory
+    // allocated by this worker is taken from the NUMA node local to
+    // the CPU.
+    (void)pin_cpu();
     ev_run(loop_);
     delete_log_config();
   });
@@ -446,11 +863,146 @@ void Worker::send(WorkerEvent event) {
     std::lock_guard<std::mutex> g(m_);
 
     q_.emplace_back(std::move(event));
+    num_queued_events_.store(q_.size(), std::memory_order_relaxed);
   }
 
   ev_async_send(loop_, &w_);
 }
 
+void Worker::send_http2_backend_io_events(
+    std::vector<Http2BackendIOEvent> events) {
+  {
+    std::lock_guard<std::mutex> g(backend_io_m_);
+
+    if (backend_io_q_.empty()) {
+      backend_io_q_ = std::move(events);
+    } else {
+      std::move(std::begin(events), std::end(events),
+                std::back_inserter(backend_io_q_));
+    }
+  }
+
+  ev_async_send(loop_, &backend_io_w_);
+}
+
+void Worker::process_http2_backend_io_events() {
+  std::vector<Http2BackendIOEvent> q;
+  {
+    std::lock_guard<std::mutex> g(backend_io_m_);
+    q.swap(backend_io_q_);
+  }
+
+  for (auto &ev : q) {
+    auto dconn = ev.stream->dconn;
+    if (!dconn) {
+      continue;
+    }
+
+    // This may delete dconn.
+    dconn->on_http2_backend_io_event(ev);
+  }
+}
+
+void Worker::maintain_idle_backend_connections() {
+  if (graceful_shutdown_ || connect_blocker_->blocked()) {
+    return;
+  }
+
+  // HTTP/2 backends are served by backend I/O threads if they are
+  // enabled.  See ClientHandler::get_downstream_connection().
+  auto http2_backend_io = conn_handler_ &&
+                          !conn_handler_->get_http2_backend_ios().empty() &&
+                          get_config()->downstream_http_proxy.host.empty();
+
+  for (auto &group : downstream_addr_groups_) {
+    for (auto &addr : group->shared_addr->addrs) {
+      if (addr.min_idle == 0 || !addr.keep_idle) {
+        continue;
+      }
+
+      if (addr.proto == Proto::HTTP1) {
+        for (auto n = addr.dconn_pool->size() +
+                      addr.dconn_pool->num_prewarming_connections();
+             n < addr.min_idle && !addr.connect_blocker->blocked(); ++n) {
+          prewarm_http1_connection(group, &addr);
+        }
+
+        continue;
+      }
+
+      if (http2_backend_io) {
+        // The sessions in the backend I/O thread are shared by all
+        // workers.
+        if (!addr.connect_blocker->blocked()) {
+          auto io = get_http2_backend_io(&addr);
+          io->keep_idle_sessions(addr.http2_backend_io_peer, addr.min_idle);
+        }
+
+        continue;
+      }
+
+      size_t n = 0;
+      for (auto session = addr.http2_extra_freelist.head;
+           session && n < addr.min_idle; session = session->dlnext, ++n) {
+        session->keep_alive_idle();
+      }
+
+      for (; n < addr.min_idle && !addr.connect_blocker->blocked(); ++n) {
+        auto session = new Http2Session(loop_, cl_ssl_ctx_, this, group, &addr);
+
+        if (LOG_ENABLED(INFO)) {
+          WLOG(INFO, this) << "Prewarm Http2Session " << session
+                           << " to " << addr.hostport;
+        }
+
+        session->add_to_extra_freelist();
+        session->signal_write();
+      }
+    }
+  }
+}
+
+void Worker::prewarm_http1_connection(
+    const std::shared_ptr<DownstreamAddrGroup> &group, DownstreamAddr *addr) {
+  auto dconn =
+      std::make_unique<HttpDownstreamConnection>(group, addr, loop_, this);
+
+  if (LOG_ENABLED(INFO)) {
+    WLOG(INFO, this) << "Prewarm HTTP/1 connection " << dconn.get() << " to "
+                     << addr->hostport;
+  }
+
+  if (dconn->prewarm() != 0) {
+    return;
+  }
+
+  addr->dconn_pool->add_prewarming_connection(std::move(dconn));
+}
+
+Http2BackendIO *Worker::get_http2_backend_io(DownstreamAddr *addr) {
+  if (addr->http2_backend_io) {
+    return addr->http2_backend_io;
+  }
+
+  if (!conn_handler_) {
+    return nullptr;
+  }
+
+  auto &ios = conn_handler_->get_http2_backend_ios();
+  if (ios.empty()) {
+    return nullptr;
+  }
+
+  // The same backend address is always served by the same backend
+  // I/O thread so that its connections are shared by all workers.
+  auto io = ios[util::hash32(addr->hostport) % ios.size()].get();
+
+  addr->http2_backend_io = io;
+  addr->http2_backend_io_peer = io->get_peer(addr);
+
+  return io;
+}
+
 void Worker::process_events() {
   WorkerEvent wev;
   {
@@ -468,47 +1020,23 @@ void Worker::process_events() {
 
     wev = std::move(q_.front());
     q_.pop_front();
+    num_queued_events_.store(q_.size(), std::memory_order_relaxed);
   }
 
   ev_timer_start(loop_, &proc_wev_timer_);
 
   auto config = get_config();
 
-  auto worker_connections = config->conn.upstream.worker_connections;
-
-  switch (wev.type) {
-  case WorkerEventType::NEW_CONNECTION: {
-    if (LOG_ENABLED(INFO)) {
-      WLOG(INFO, this) << "WorkerEvent: client_fd=" << wev.client_fd
-                       << ", addrlen=" << wev.client_addrlen;
-    }
-
-    if (worker_stat_.num_connections >= worker_connections) {
-
-      if (LOG_ENABLED(INFO)) {
-        WLOG(INFO, this) << "Too many connections >= " << worker_connections;
-      }
-
-      close(wev.client_fd);
-
-      break;
-    }
-
-    auto client_handler =
-        tls::accept_connection(this, wev.client_fd, &wev.client_addr.sa,
-                               wev.client_addrlen, wev.faddr);
-    if (!client_handler) {
-      if (LOG_ENABLED(INFO)) {
-        WLOG(ERROR, this) << "ClientHandler creation failed";
-      }
-      close(wev.client_fd);
-      break;
-    }
-
+  switch (wev.type) {
+  case WorkerEventType::NEW_CONNECTION: {
     if (LOG_ENABLED(INFO)) {
-      WLOG(INFO, this) << "CLIENT_HANDLER:" << client_handler << " created ";
+      WLOG(INFO, this) << "WorkerEvent: client_fd=" << wev.client_fd
+                       << ", addrlen=" << wev.client_addrlen;
     }
 
+    handle_connection(wev.client_fd, &wev.client_addr.sa, wev.client_addrlen,
+                      wev.faddr);
+
     break;
   }
   case WorkerEventType::REOPEN_LOG:
@@ -523,6 +1051,10 @@ void Worker::process_events() {
 
     graceful_shutdown_ = true;
 
+    shutdown_reuseport_acceptor();
+
+    ev_timer_stop(loop_, &idle_backend_timer_);
+
     if (worker_stat_.num_connections == 0 &&
         worker_stat_.num_close_waits == 0) {
       ev_break(loop_);
@@ -571,6 +1103,37 @@ void Worker::process_events() {
   }
 }
 
+int Worker::handle_connection(int fd, sockaddr *addr, int addrlen,
+                              const UpstreamAddr *faddr) {
+  auto worker_connections = get_config()->conn.upstream.worker_connections;
+
+  if (worker_stat_.num_connections >= worker_connections) {
+
+    if (LOG_ENABLED(INFO)) {
+      WLOG(INFO, this) << "Too many connections >= " << worker_connections;
+    }
+
+    close(fd);
+
+    return -1;
+  }
+
+  auto client_handler = tls::accept_connection(this, fd, addr, addrlen, faddr);
+  if (!client_handler) {
+    if (LOG_ENABLED(INFO)) {
+      WLOG(ERROR, this) << "ClientHandler creation failed";
+    }
+    close(fd);
+    return -1;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    WLOG(INFO, this) << "CLIENT_HANDLER:" << client_handler << " created ";
+  }
+
+  return 0;
+}
+
 tls::CertLookupTree *Worker::get_cert_lookup_tree() const { return cert_tree_; }
 
 #ifdef ENABLE_HTTP3
@@ -601,6 +1164,51 @@ void Worker::set_ticket_keys(std::shared_ptr<TicketKeys> ticket_keys) {
 
 WorkerStat *Worker::get_worker_stat() { return &worker_stat_; }
 
+std::shared_ptr<BackendStatSet> Worker::get_backend_stat_set() {
+#ifdef HAVE_ATOMIC_STD_SHARED_PTR
+  return std::atomic_load_explicit(&backend_stat_set_,
+                                   std::memory_order_acquire);
+#else  // !HAVE_ATOMIC_STD_SHARED_PTR
+  std::lock_guard<std::mutex> g(backend_stat_set_m_);
+  return backend_stat_set_;
+#endif // !HAVE_ATOMIC_STD_SHARED_PTR
+}
+
+uint64_t Worker::get_load() const {
+  return compute_worker_load(
+      worker_stat_.num_connections.load(std::memory_order_relaxed),
+      worker_stat_.num_streams.load(std::memory_order_relaxed),
+      num_queued_events_.load(std::memory_order_relaxed),
+      loop_lag_.load(std::memory_order_relaxed));
+}
+
+void Worker::update_loop_lag() {
+  // ev_time() is used instead of ev_now() because callbacks which
+  // precede this one in the same iteration count as lag.
+  auto lag = std::max(ev_time() - loop_lag_expiry_, 0.);
+  // Cap the sample at 1 second so that it does not overflow.
+  auto sample = static_cast<uint32_t>(std::min(lag, 1_s) * 1000000);
+
+  // Exponentially weighted moving average with alpha = 1/4
+  auto avg = loop_lag_.load(std::memory_order_relaxed);
+  loop_lag_.store(avg - avg / 4 + sample / 4, std::memory_order_relaxed);
+
+  loop_lag_expiry_ = ev_now(loop_) + LOOP_LAG_INTERVAL;
+  ev_timer_set(&loop_lag_timer_, LOOP_LAG_INTERVAL, 0.);
+  ev_timer_start(loop_, &loop_lag_timer_);
+}
+
+uint64_t compute_worker_load(size_t num_connections, size_t num_streams,
+                             size_t num_queued_events, uint32_t loop_lag) {
+  // Queued events are mostly new connections which are not picked up
+  // yet.  A loop lagging behind by every 1ms scales up the load by
+  // the factor of 1, so that a stalled worker is avoided even if it
+  // has few connections.
+  return (static_cast<uint64_t>(num_connections) + num_streams +
+          num_queued_events) *
+         (1 + loop_lag / 1000);
+}
+
 struct ev_loop *Worker::get_loop() const {
   return loop_;
 }
@@ -619,6 +1227,81 @@ bool Worker::get_graceful_shutdown() const { return graceful_shutdown_; }
 
 MemchunkPool *Worker::get_mcpool() { return &mcpool_; }
 
+ResponseCache *Worker::get_response_cache() {
+  if (response_cache_) {
+    return response_cache_.get();
+  }
+
+  auto config = get_config();
+  auto &cacheconf = config->http.response_cache;
+
+  // Each worker gets an equal share of the capacity.
+  auto max_size = cacheconf.max_size / config->num_worker;
+  if (max_size == 0) {
+    return nullptr;
+  }
+
+  response_cache_ = std::make_unique<ResponseCache>(
+      &mcpool_, max_size, cacheconf.max_entry_size);
+
+  return response_cache_.get();
+}
+
+CompressorPool *Worker::get_compressor_pool() {
+  if (!compressor_pool_) {
+    compressor_pool_ = std::make_unique<CompressorPool>(&worker_stat_);
+  }
+
+  return compressor_pool_.get();
+}
+
+SplicePipePool *Worker::get_splice_pipe_pool() {
+  if (!splice_pipe_pool_) {
+    splice_pipe_pool_ = std::make_unique<SplicePipePool>();
+  }
+
+  return splice_pipe_pool_.get();
+}
+
+IOUring *Worker::get_io_uring() { return io_uring_.get(); }
+
+void Worker::linger_zerocopy_buffers(DefaultMemchunks bufs) {
+  if (!bufs.head) {
+    return;
+  }
+
+  auto &upstreamconf = get_config()->conn.upstream;
+
+  zerocopy_lingering_.emplace_back(
+      ev_now(loop_) + upstreamconf.timeout.write, std::move(bufs));
+
+  if (!ev_is_active(&zerocopy_linger_timer_)) {
+    ev_timer_set(&zerocopy_linger_timer_, upstreamconf.timeout.write, 0.);
+    ev_timer_start(loop_, &zerocopy_linger_timer_);
+  }
+}
+
+void Worker::release_lingering_zerocopy_buffers() {
+  auto now = ev_now(loop_);
+
+  while (!zerocopy_lingering_.empty() &&
+         zerocopy_lingering_.front().first <= now) {
+    zerocopy_lingering_.pop_front();
+  }
+
+  if (zerocopy_lingering_.empty()) {
+    if (worker_stat_.num_connections == 0) {
+      schedule_clear_mcpool();
+    }
+
+    return;
+  }
+
+  ev_timer_set(&zerocopy_linger_timer_,
+               zerocopy_lingering_.front().first - now, 0.);
+  ev_timer_start(loop_, &zerocopy_linger_timer_);
+}
+
 MemcachedDispatcher *Worker::get_session_cache_memcached_dispatcher() {
   return session_cache_memcached_dispatcher_.get();
 }
@@ -665,6 +1348,65 @@ QUICConnectionHandler *Worker::get_quic_connection_handler() {
 
 DNSTracker *Worker::get_dns_tracker() { return &dns_tracker_; }
 
+int Worker::setup_reuseport_server_socket() {
+  for (auto &addr : reuseport_upstream_addrs_) {
+    assert(!addr.host_unix);
+    if (create_tcp_server_socket(addr, true, cpu_) != 0) {
+      return -1;
+    }
+
+    reuseport_acceptors_.emplace_back(
+        std::make_unique<AcceptHandler>(&addr, this));
+  }
+
+  return 0;
+}
+
+void Worker::set_cpu(int cpu) { cpu_ = cpu; }
+
+int Worker::pin_cpu() {
+  if (cpu_ == -1) {
+    return 0;
+  }
+
+#ifdef HAVE_SCHED_SETAFFINITY
+  std::array<char, STRERROR_BUFSIZE> errbuf;
+
+  if (cpu_ >= CPU_SETSIZE) {
+    WLOG(ERROR, this) << "CPU " << cpu_ << " is out of range";
+    return -1;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu_, &set);
+
+  // pid 0 means the calling thread.
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    auto error = errno;
+    WLOG(ERROR, this) << "Could not pin worker to CPU " << cpu_ << ": "
+                      << xsi_strerror(error, errbuf.data(), errbuf.size());
+    return -1;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    WLOG(INFO, this) << "Pinned to CPU " << cpu_;
+  }
+#endif // HAVE_SCHED_SETAFFINITY
+
+  return 0;
+}
+
+void Worker::shutdown_reuseport_acceptor() {
+  // Like ConnectionHandler::accept_pending_connection(), pick up a
+  // pending connection before closing listening sockets.
+  for (auto &a : reuseport_acceptors_) {
+    a->accept_connection();
+  }
+
+  reuseport_acceptors_.clear();
+}
+
 #ifdef ENABLE_HTTP3
 #  ifdef HAVE_LIBBPF
 bool Worker::should_attach_bpf() const {
@@ -1179,7 +1921,7 @@ size_t match_downstream_addr_group_host(
     auto rev_host = StringRef{rev_host_src.base, ep};
 
     ssize_t best_group = -1;
-    const RNode *last_node = nullptr;
+    const RFlatNode *last_node = nullptr;
 
     for (;;) {
       size_t nread = 0;
@@ -1290,6 +2032,10 @@ void downstream_failure(DownstreamAddr *addr, const Address *raddr) {
     return;
   }
 
+  if (addr->stat) {
+    stat_add(addr->stat->connect_failures);
+  }
+
   connect_blocker->on_failure();
 
   if (addr->fall == 0) {
@@ -1317,6 +2063,26 @@ void downstream_failure(DownstreamAddr *addr, const Address *raddr) {
   }
 }
 
+namespace {
+std::atomic_bool malloc_trim_requested;
+} // namespace
+
+void request_malloc_trim() {
+  malloc_trim_requested.store(true, std::memory_order_relaxed);
+}
+
+void malloc_trim_if_requested() {
+  if (!malloc_trim_requested.exchange(false, std::memory_order_relaxed)) {
+    return;
+  }
+
+#ifdef HAVE_MALLOC_TRIM
+  // The chunks are small enough to be allocated from heap, and
+  // free() does not return them to the operating system by itself.
+  malloc_trim(0);
+#endif // HAVE_MALLOC_TRIM
+}
+
 #ifdef ENABLE_HTTP3
 int create_cid_prefix(uint8_t *cid_prefix, const uint8_t *server_id) {
   auto p = std::copy_n(server_id, SHRPX_QUIC_SERVER_IDLEN, cid_prefix);
@@ -1329,4 +2095,196 @@ int create_cid_prefix(uint8_t *cid_prefix, const uint8_t *server_id) {
 }
 #endif // ENABLE_HTTP3
 
+int create_tcp_server_socket(
+    UpstreamAddr &faddr, bool reuseport, int cpu,
+    const std::function<int(const char *host, uint16_t port)>
+        &find_inherited) {
+  std::array<char, STRERROR_BUFSIZE> errbuf;
+  int fd = -1;
+  int rv;
+
+  auto &listenerconf = get_config()->conn.listener;
+
+  auto service = util::utos(faddr.port);
+  addrinfo hints{};
+  hints.ai_family = faddr.family;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+#ifdef AI_ADDRCONFIG
+  hints.ai_flags |= AI_ADDRCONFIG;
+#endif // AI_ADDRCONFIG
+
+  auto node =
+      faddr.host == StringRef::from_lit("*") ? nullptr : faddr.host.c_str();
+
+  addrinfo *res, *rp;
+  rv = getaddrinfo(node, service.c_str(), &hints, &res);
+#ifdef AI_ADDRCONFIG
+  if (rv != 0) {
+    // Retry without AI_ADDRCONFIG
+    hints.ai_flags &= ~AI_ADDRCONFIG;
+    rv = getaddrinfo(node, service.c_str(), &hints, &res);
+  }
+#endif // AI_ADDRCONFIG
+  if (rv != 0) {
+    LOG(FATAL) << "Unable to get IPv" << (faddr.family == AF_INET ? "4" : "6")
+               << " address for " << faddr.host << ", port " << faddr.port
+               << ": " << gai_strerror(rv);
+    return -1;
+  }
+
+  auto res_d = defer(freeaddrinfo, res);
+
+  std::array<char, NI_MAXHOST> host;
+
+  for (rp = res; rp; rp = rp->ai_next) {
+    rv = getnameinfo(rp->ai_addr, rp->ai_addrlen, host.data(), host.size(),
+                     nullptr, 0, NI_NUMERICHOST);
+    if (rv != 0) {
+      LOG(WARN) << "getnameinfo() failed: " << gai_strerror(rv);
+      continue;
+    }
+
+    if (find_inherited) {
+      fd = find_inherited(host.data(), faddr.port);
+      if (fd != -1) {
+        break;
+      }
+    }
+
+    // The listening sockets created by the main process are passed
+    // to the new process on reload, so they must survive exec.
+#ifdef SOCK_NONBLOCK
+    int flags = SOCK_NONBLOCK;
+    if (reuseport) {
+      flags |= SOCK_CLOEXEC;
+    }
+    fd = socket(rp->ai_family, rp->ai_socktype | flags, rp->ai_protocol);
+    if (fd == -1) {
+      auto error = errno;
+      LOG(WARN) << "socket() syscall failed: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+      continue;
+    }
+#else  // !SOCK_NONBLOCK
+    fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+    if (fd == -1) {
+      auto error = errno;
+      LOG(WARN) << "socket() syscall failed: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+      continue;
+    }
+    util::make_socket_nonblocking(fd);
+    if (reuseport) {
+      util::make_socket_closeonexec(fd);
+    }
+#endif // !SOCK_NONBLOCK
+
+    int val = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val,
+                   static_cast<socklen_t>(sizeof(val))) == -1) {
+      auto error = errno;
+      LOG(WARN) << "Failed to set SO_REUSEADDR option to listener socket: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+      close(fd);
+      continue;
+    }
+
+#ifdef SO_REUSEPORT
+    if (reuseport &&
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &val,
+                   static_cast<socklen_t>(sizeof(val))) == -1) {
+      auto error = errno;
+      LOG(WARN) << "Failed to set SO_REUSEPORT option to listener socket: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+      close(fd);
+      continue;
+    }
+#endif // SO_REUSEPORT
+
+#ifdef SO_INCOMING_CPU
+    // Ask the kernel to prefer this socket for the connections
+    // processed on the CPU this worker is pinned to.
+    if (reuseport && cpu != -1 &&
+        setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu,
+                   static_cast<socklen_t>(sizeof(cpu))) == -1) {
+      auto error = errno;
+      LOG(WARN) << "Failed to set SO_INCOMING_CPU option to listener socket: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+    }
+#endif // SO_INCOMING_CPU
+
+#ifdef IPV6_V6ONLY
+    if (faddr.family == AF_INET6) {
+      if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &val,
+                     static_cast<socklen_t>(sizeof(val))) == -1) {
+        auto error = errno;
+        LOG(WARN) << "Failed to set IPV6_V6ONLY option to listener socket: "
+                  << xsi_strerror(error, errbuf.data(), errbuf.size());
+        close(fd);
+        continue;
+      }
+    }
+#endif // IPV6_V6ONLY
+
+#ifdef TCP_DEFER_ACCEPT
+    val = 3;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &val,
+                   static_cast<socklen_t>(sizeof(val))) == -1) {
+      auto error = errno;
+      LOG(WARN) << "Failed to set TCP_DEFER_ACCEPT option to listener socket: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+    }
+#endif // TCP_DEFER_ACCEPT
+
+    // When we are executing new binary, and the old binary did not
+    // bind privileged port (< 1024) for some reason, binding to those
+    // ports will fail with permission denied error.
+    if (bind(fd, rp->ai_addr, rp->ai_addrlen) == -1) {
+      auto error = errno;
+      LOG(WARN) << "bind() syscall failed: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+      close(fd);
+      continue;
+    }
+
+    if (listenerconf.fastopen > 0) {
+      val = listenerconf.fastopen;
+      if (setsockopt(fd, SOL_TCP, TCP_FASTOPEN, &val,
+                     static_cast<socklen_t>(sizeof(val))) == -1) {
+        auto error = errno;
+        LOG(WARN) << "Failed to set TCP_FASTOPEN option to listener socket: "
+                  << xsi_strerror(error, errbuf.data(), errbuf.size());
+      }
+    }
+
+    if (listen(fd, listenerconf.backlog) == -1) {
+      auto error = errno;
+      LOG(WARN) << "listen() syscall failed: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+      close(fd);
+      continue;
+    }
+
+    break;
+  }
+
+  if (!rp) {
+    LOG(FATAL) << "Listening " << (faddr.family == AF_INET ? "IPv4" : "IPv6")
+               << " socket failed";
+
+    return -1;
+  }
+
+  faddr.fd = fd;
+  faddr.hostport = util::make_http_hostport(mod_config()->balloc,
+                                            StringRef{host.data()}, faddr.port);
+
+  LOG(NOTICE) << "Listening on " << faddr.hostport
+              << (faddr.tls ? ", tls" : "")
+              << (reuseport ? ", reuseport" : "");
+
+  return 0;
+}
+
 } // namespace shrpx
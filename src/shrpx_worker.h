@@ -28,12 +28,14 @@
 #include "shrpx.h"
 
 #include <mutex>
+#include <atomic>
 #include <vector>
 #include <random>
 #include <unordered_map>
 #include <deque>
 #include <thread>
 #include <queue>
+#include <functional>
 #ifndef NOTHREADS
 #  include <future>
 #endif // NOTHREADS
@@ -49,6 +51,9 @@
 #include "shrpx_tls.h"
 #include "shrpx_live_check.h"
 #include "shrpx_connect_blocker.h"
+#include "shrpx_http2_backend_io.h"
+#include "shrpx_metrics.h"
+#include "shrpx_backend_load.h"
 #include "shrpx_dns_tracker.h"
 #ifdef ENABLE_HTTP3
 #  include "shrpx_quic_connection_handler.h"
@@ -65,6 +70,12 @@ class ConnectBlocker;
 class MemcachedDispatcher;
 struct UpstreamAddr;
 class ConnectionHandler;
+class AcceptHandler;
+class ResponseCache;
+class CompressorPool;
+class SplicePipePool;
+class IOUring;
+class CollapsedRequest;
 #ifdef ENABLE_HTTP3
 class QUICListener;
 #endif // ENABLE_HTTP3
@@ -99,11 +110,20 @@ struct DownstreamAddr {
 
   std::unique_ptr<ConnectBlocker> connect_blocker;
   std::unique_ptr<LiveCheck> live_check;
+  // Statistics which connection failures of this address are counted
+  // in.  It is owned by SharedDownstreamAddr.
+  BackendStat *stat;
   // Connection pool for this particular address if session affinity
   // is enabled
   std::unique_ptr<DownstreamConnectionPool> dconn_pool;
+  // Latency and outstanding requests for p2c load balancing.
+  BackendLoad load;
   size_t fall;
   size_t rise;
+  // The number of idle HTTP/1 connections, or HTTP/2 sessions which
+  // still accept new streams, to keep to this address.  0 if
+  // disabled.
+  size_t min_idle;
   // Client side TLS session cache
   tls::TLSSessionCache tls_session_cache;
   // List of Http2Session which is not fully utilized (i.e., the
@@ -136,6 +156,11 @@ struct DownstreamAddr {
   // affinity hash for this address.  It is assigned when strict
   // stickiness is enabled.
   uint32_t affinity_hash;
+  // Backend I/O thread which serves this address, and the peer in
+  // it.  They are looked up on first use.  nullptr if not looked up
+  // yet.
+  Http2BackendIO *http2_backend_io;
+  Http2BackendIOPeer *http2_backend_io_peer;
   // true if TLS is used in this backend
   bool tls;
   // true if dynamic DNS is enabled
@@ -146,6 +171,13 @@ struct DownstreamAddr {
   bool upgrade_scheme;
   // true if this address is queued.
   bool queued;
+  // true if idle connections are established before the first
+  // request is forwarded to this address.
+  bool prewarm;
+  // true if idle connections to this address are kept.  It is
+  // initialized to |prewarm|, and becomes true when a request is
+  // forwarded to this address.
+  bool keep_idle;
 };
 
 constexpr uint32_t MAX_DOWNSTREAM_ADDR_WEIGHT = 256;
@@ -171,6 +203,9 @@ struct WeightGroup {
   std::priority_queue<DownstreamAddrEntry, std::vector<DownstreamAddrEntry>,
                       DownstreamAddrEntryGreater>
       pq;
+  // All addresses which belong to this group.  Used by p2c load
+  // balancing.
+  std::vector<DownstreamAddr *> addrs;
   size_t seq;
   uint32_t weight;
   uint32_t cycle;
@@ -199,9 +234,14 @@ struct WeightGroupEntryGreater {
 struct SharedDownstreamAddr {
   SharedDownstreamAddr()
       : balloc(1024, 1024),
+        affinity_total_weight{0},
+        outstanding{0},
         affinity{SessionAffinity::NONE},
         redirect_if_not_tls{false},
         dnf{false},
+        cache{false},
+        collapse{false},
+        balance{LoadBalancing::WEIGHTED},
         timeout{} {}
 
   SharedDownstreamAddr(const SharedDownstreamAddr &) = delete;
@@ -221,9 +261,23 @@ struct SharedDownstreamAddr {
   // Maps affinity hash of each DownstreamAddr to its index in addrs.
   // It is only assigned when strict stickiness is enabled.
   std::unordered_map<uint32_t, size_t> affinity_hash_map;
+  // Maglev lookup table.  Only used if affinity.hash ==
+  // SessionAffinityHash::MAGLEV.
+  std::vector<uint32_t> affinity_maglev;
+  // The sum of weights which bounded load of session affinity
+  // divides outstanding requests by.  It is the sum of weights of
+  // addrs if Maglev is used, or the number of addrs otherwise.
+  uint32_t affinity_total_weight;
+  // The number of outstanding requests counted in BackendLoad of
+  // addrs.
+  size_t outstanding;
 #ifdef HAVE_MRUBY
   std::shared_ptr<mruby::MRubyContext> mruby_ctx;
 #endif // HAVE_MRUBY
+  // The path to mruby script file which this group is configured
+  // with.  It is used to compare the configuration when backend
+  // configuration is replaced.
+  StringRef mruby_file;
   // Configuration for session affinity
   AffinityConfig affinity;
   // Session affinity
@@ -232,11 +286,23 @@ struct SharedDownstreamAddr {
   bool redirect_if_not_tls;
   // true if a request should not be forwarded to a backend.
   bool dnf;
+  // true if responses from this group are stored in response cache.
+  bool cache;
+  // true if identical concurrent requests to this group are collapsed
+  // into a single backend request.
+  bool collapse;
+  // Load balancing algorithm used if session affinity is disabled.
+  LoadBalancing balance;
   // Timeouts for backend connection.
   struct {
     ev_tstamp read;
     ev_tstamp write;
   } timeout;
+  // Requests in flight which identical requests can be collapsed
+  // into, keyed by their cache keys.
+  std::unordered_map<StringRef, CollapsedRequest *> collapsed_requests;
+  // Statistics of the first backend group which uses this object.
+  std::shared_ptr<BackendStat> stat;
 };
 
 struct DownstreamAddrGroup {
@@ -250,15 +316,60 @@ struct DownstreamAddrGroup {
 
   ImmutableString pattern;
   std::shared_ptr<SharedDownstreamAddr> shared_addr;
+  // Statistics of this group.  It points to an element of
+  // BackendStatSet.
+  std::shared_ptr<BackendStat> stat;
   // true if this group is no longer used for new request.  If this is
   // true, the connection made using one of address in shared_addr
   // must not be pooled.
   bool retired;
 };
 
+// The fields which are read by the main thread to dispatch
+// connections are atomic.
 struct WorkerStat {
-  size_t num_connections;
+  std::atomic<size_t> num_connections;
   size_t num_close_waits;
+  // The number of requests in flight across all client connections.
+  // It is only maintained if |count_streams| is true.
+  std::atomic<size_t> num_streams;
+  // true if num_streams is needed, that is least-loaded worker
+  // dispatch or metrics API is enabled.
+  bool count_streams;
+  // The number of requests served from, and not found in response
+  // cache.
+  std::atomic<uint64_t> response_cache_hits;
+  std::atomic<uint64_t> response_cache_misses;
+  // The number of requests which were collapsed into an identical
+  // request in flight.
+  std::atomic<uint64_t> collapsed_requests;
+  // The number of responses compressed by nghttpx, the time spent
+  // in compressing them in nanoseconds, and the number of bytes
+  // before and after compression.
+  std::atomic<uint64_t> compressed_responses;
+  std::atomic<uint64_t> compression_time;
+  std::atomic<uint64_t> compression_in_bytes;
+  std::atomic<uint64_t> compression_out_bytes;
+  // The following fields are only read by the metrics API.
+  // The number of accepted client connections.
+  std::atomic<uint64_t> connections_total;
+  // The number of requests received.
+  std::atomic<uint64_t> requests_total;
+  // The number of responses by status class, from 1xx to 5xx.
+  std::array<std::atomic<uint64_t>, 5> responses;
+  // The number of request body bytes received, and response body
+  // bytes sent.
+  std::atomic<uint64_t> request_body_bytes;
+  std::atomic<uint64_t> response_body_bytes;
+  // The number of TLS handshakes completed with clients, and the
+  // number of them which resumed a session.
+  std::atomic<uint64_t> tls_handshakes;
+  std::atomic<uint64_t> tls_resumed_handshakes;
+  // The number of sends with MSG_ZEROCOPY, and the number of sends
+  // which fell back to copying data because the kernel copied it, or
+  // could not pin memory.
+  std::atomic<uint64_t> zerocopy_sends;
+  std::atomic<uint64_t> zerocopy_copied;
 };
 
 #ifdef ENABLE_HTTP3
@@ -325,6 +436,11 @@ public:
   void wait();
   void process_events();
   void send(WorkerEvent event);
+  // Creates ClientHandler for the accepted connection |fd| on this
+  // worker.  This function returns 0 if it succeeds, or -1.  |fd| is
+  // closed on failure.
+  int handle_connection(int fd, sockaddr *addr, int addrlen,
+                        const UpstreamAddr *faddr);
 
   tls::CertLookupTree *get_cert_lookup_tree() const;
 #ifdef ENABLE_HTTP3
@@ -337,6 +453,14 @@ public:
   void set_ticket_keys(std::shared_ptr<TicketKeys> ticket_keys);
 
   WorkerStat *get_worker_stat();
+  // Returns statistics of backend groups.  This function can be
+  // called from any thread.
+  std::shared_ptr<BackendStatSet> get_backend_stat_set();
+  // Returns the load score of this worker which is used to dispatch a
+  // new connection.  This function can be called from any thread.
+  uint64_t get_load() const;
+  // Measures the event loop lag, and updates the average.
+  void update_loop_lag();
   struct ev_loop *get_loop() const;
   SSL_CTX *get_sv_ssl_ctx() const;
   SSL_CTX *get_cl_ssl_ctx() const;
@@ -349,6 +473,23 @@ public:
 
   MemchunkPool *get_mcpool();
   void schedule_clear_mcpool();
+  // Frees the unused buffers in mcpool_ above its low watermark.
+  void trim_mcpool();
+
+  // Returns response cache of this worker.  It is created on first
+  // use.  This function returns nullptr if response cache is
+  // disabled.
+  ResponseCache *get_response_cache();
+  CompressorPool *get_compressor_pool();
+  SplicePipePool *get_splice_pipe_pool();
+  // Returns io_uring of this worker.  This function returns nullptr
+  // if frontend I/O is done with libev.
+  IOUring *get_io_uring();
+  // Keeps |bufs| which the kernel may still send from with
+  // MSG_ZEROCOPY after the client connection is closed.  They are
+  // recycled after frontend write timeout.
+  void linger_zerocopy_buffers(DefaultMemchunks bufs);
+  void release_lingering_zerocopy_buffers();
 
   MemcachedDispatcher *get_session_cache_memcached_dispatcher();
 
@@ -393,8 +534,42 @@ public:
   const UpstreamAddr *find_quic_upstream_addr(const Address &local_addr);
 #endif // ENABLE_HTTP3
 
+  // Creates listening sockets with SO_REUSEPORT for each frontend
+  // given with "reuseport" parameter, and starts accepting
+  // connections on them in this worker's event loop.
+  int setup_reuseport_server_socket();
+
+  // Accepts pending connection, and closes listening sockets created
+  // by setup_reuseport_server_socket().
+  void shutdown_reuseport_acceptor();
+
+  // Sets CPU which this worker runs on.  This function must be called
+  // before setup_reuseport_server_socket() and run_async().
+  void set_cpu(int cpu);
+  // Pins the calling thread to the CPU given by set_cpu().  This
+  // function does nothing if no CPU is set.  It returns 0 if it
+  // succeeds, or -1.
+  int pin_cpu();
+
   DNSTracker *get_dns_tracker();
 
+  // Returns backend I/O thread which serves |addr|.  This function
+  // returns nullptr if backend I/O threads are not enabled.
+  Http2BackendIO *get_http2_backend_io(DownstreamAddr *addr);
+  // Sends |events| from a backend I/O thread to this worker.  This
+  // function can be called from any thread.
+  void send_http2_backend_io_events(std::vector<Http2BackendIOEvent> events);
+  void process_http2_backend_io_events();
+
+  // Tops up idle connections to the backend addresses which have
+  // min-idle parameter, and keeps idle HTTP/2 sessions alive.
+  void maintain_idle_backend_connections();
+  // Starts establishing an idle HTTP/1 connection to |addr| in
+  // |group|.  The connection is added to addr->dconn_pool once it is
+  // ready.
+  void prewarm_http1_connection(
+      const std::shared_ptr<DownstreamAddrGroup> &group, DownstreamAddr *addr);
+
 private:
 #ifndef NOTHREADS
   std::future<void> fut_;
@@ -405,12 +580,46 @@ private:
 #endif // ENABLE_HTTP3 && HAVE_LIBBPF
   std::mutex m_;
   std::deque<WorkerEvent> q_;
+  // The number of WorkerEvent in q_.  This is read without locking m_.
+  std::atomic<size_t> num_queued_events_;
+  // Smoothed event loop lag in microseconds.
+  std::atomic<uint32_t> loop_lag_;
   std::mt19937 randgen_;
   ev_async w_;
+  // Events sent from backend I/O threads.  They are guarded by
+  // backend_io_m_, and notified by backend_io_w_.
+  std::mutex backend_io_m_;
+  std::vector<Http2BackendIOEvent> backend_io_q_;
+  ev_async backend_io_w_;
   ev_timer mcpool_clear_timer_;
+  ev_timer mcpool_trim_timer_;
   ev_timer proc_wev_timer_;
+  // Timer to measure event loop lag.  It is only started if worker
+  // dispatch needs the load of workers.
+  ev_timer loop_lag_timer_;
+  // The time when loop_lag_timer_ is expected to fire.
+  ev_tstamp loop_lag_expiry_;
+  // Timer to call maintain_idle_backend_connections() periodically.
+  // It is only started if any backend address has min-idle
+  // parameter.
+  ev_timer idle_backend_timer_;
+  // Timer to call release_lingering_zerocopy_buffers().
+  ev_timer zerocopy_linger_timer_;
+  // CPU which this worker is pinned to.  -1 if it is not pinned.
+  int cpu_;
   MemchunkPool mcpool_;
+  // response_cache_ holds Memchunks taken from mcpool_, and must be
+  // destroyed before mcpool_.
+  std::unique_ptr<ResponseCache> response_cache_;
   WorkerStat worker_stat_;
+  std::unique_ptr<CompressorPool> compressor_pool_;
+  std::unique_ptr<SplicePipePool> splice_pipe_pool_;
+  // Buffers passed to linger_zerocopy_buffers() and the time when
+  // they are recycled.  They must be destroyed before mcpool_.
+  std::deque<std::pair<ev_tstamp, DefaultMemchunks>> zerocopy_lingering_;
+  // The sockets owned by io_uring_ hold Memchunks taken from mcpool_.
+  // It must be destroyed before mcpool_.
+  std::unique_ptr<IOUring> io_uring_;
   DNSTracker dns_tracker_;
 
 #ifdef ENABLE_HTTP3
@@ -419,6 +628,9 @@ private:
   std::vector<std::unique_ptr<QUICListener>> quic_listeners_;
 #endif // ENABLE_HTTP3
 
+  std::vector<UpstreamAddr> reuseport_upstream_addrs_;
+  std::vector<std::unique_ptr<AcceptHandler>> reuseport_acceptors_;
+
   std::shared_ptr<DownstreamConfig> downstreamconf_;
   std::unique_ptr<MemcachedDispatcher> session_cache_memcached_dispatcher_;
 #ifdef HAVE_MRUBY
@@ -441,8 +653,12 @@ private:
 
 #ifndef HAVE_ATOMIC_STD_SHARED_PTR
   std::mutex ticket_keys_m_;
+  std::mutex backend_stat_set_m_;
 #endif // !HAVE_ATOMIC_STD_SHARED_PTR
   std::shared_ptr<TicketKeys> ticket_keys_;
+  // Replaced with downstream_addr_groups_, and read by other
+  // threads.
+  std::shared_ptr<BackendStatSet> backend_stat_set_;
   std::vector<std::shared_ptr<DownstreamAddrGroup>> downstream_addr_groups_;
   // Worker level blocker for downstream connection.  For example,
   // this is used when file descriptor is exhausted.
@@ -463,11 +679,47 @@ size_t match_downstream_addr_group(
     const std::vector<std::shared_ptr<DownstreamAddrGroup>> &groups,
     size_t catch_all, BlockAllocator &balloc);
 
+// Returns true if a connection made to backend address |a| can be
+// used for |b|.
+bool same_backend_addr(const DownstreamAddr &a, const DownstreamAddr &b);
+
+// Returns the load score of a worker from |num_connections|, the
+// number of client connections, |num_streams|, the number of
+// requests in flight, |num_queued_events|, the number of WorkerEvent
+// not processed yet, and |loop_lag|, the event loop lag in
+// microseconds.  Larger value means the worker is busier.
+uint64_t compute_worker_load(size_t num_connections, size_t num_streams,
+                             size_t num_queued_events, uint32_t loop_lag);
+
 // Calls this function if connecting to backend failed.  |raddr| is
 // the actual address used to connect to backend, and it could be
 // nullptr.  This function may schedule live check.
 void downstream_failure(DownstreamAddr *addr, const Address *raddr);
 
+// Records that unused buffers have been freed so that the memory is
+// returned to the operating system by the next
+// malloc_trim_if_requested().  This function can be called from any
+// thread.
+void request_malloc_trim();
+
+// Calls malloc_trim(0) if request_malloc_trim() has been called since
+// the last call of this function.  malloc_trim(0) walks all malloc
+// arenas, so ConnectionHandler calls this function periodically
+// rather than every thread calls malloc_trim(0) by itself.
+void malloc_trim_if_requested();
+
+// Creates TCP listening socket for |faddr|, and assigns its fd and
+// hostport to |faddr|.  If |reuseport| is true, the socket is
+// created with SO_REUSEPORT and close-on-exec, and if |cpu| is not
+// -1, SO_INCOMING_CPU is set to it.  If |find_inherited| is given, it
+// is called with numeric host and port of each resolved address, and
+// the socket it returns, unless -1, is used instead of creating new
+// one.  This function returns 0 if it succeeds, or -1.
+int create_tcp_server_socket(
+    UpstreamAddr &faddr, bool reuseport, int cpu,
+    const std::function<int(const char *host, uint16_t port)>
+        &find_inherited = nullptr);
+
 #ifdef ENABLE_HTTP3
 // Creates unpredictable SHRPX_QUIC_CID_PREFIXLEN bytes sequence which
 // is used as a prefix of QUIC Connection ID.  This function returns
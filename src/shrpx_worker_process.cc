@@ -444,6 +444,12 @@ int worker_process_event_loop(WorkerProcessConfig *wpconf) {
   ev_child_start(loop, &nb_childev);
 #endif // HAVE_NEVERBLEED
 
+  // Start log writer after neverbleed daemon is forked, because the
+  // thread does not survive fork.
+  if (config->logging.async.enabled) {
+    start_log_writer(config->logging.async.buffer_size);
+  }
+
   auto conn_handler = std::make_unique<ConnectionHandler>(loop, gen);
 
 #ifdef HAVE_NEVERBLEED
@@ -668,6 +674,8 @@ int worker_process_event_loop(WorkerProcessConfig *wpconf) {
 
   ares_library_cleanup();
 
+  stop_log_writer();
+
   return 0;
 }
 
@@ -27,6 +27,7 @@
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif // HAVE_UNISTD_H
+#include <netinet/in.h>
 
 #include <cstdlib>
 
@@ -34,6 +35,8 @@
 
 #include "shrpx_worker.h"
 #include "shrpx_connect_blocker.h"
+#include "shrpx_downstream_connection_pool.h"
+#include "shrpx_http_downstream_connection.h"
 #include "shrpx_log.h"
 
 namespace shrpx {
@@ -62,6 +65,9 @@ void test_shrpx_worker_match_downstream_addr_group(void) {
     router.add_route(StringRef{g->pattern}, i);
   }
 
+  router.compile();
+  wcrouter.compile();
+
   CU_ASSERT(0 == match_downstream_addr_group(
                      routerconf, StringRef::from_lit("nghttp2.org"),
                      StringRef::from_lit("/"), groups, 255, balloc));
@@ -214,6 +220,11 @@ void test_shrpx_worker_match_downstream_addr_group(void) {
   wcrouter.add_route(StringRef::from_lit("lacol."), 2);
   wp.back().router.add_route(StringRef::from_lit("/"), 13);
 
+  wcrouter.compile();
+  for (auto &wc : wp) {
+    wc.router.compile();
+  }
+
   CU_ASSERT(11 == match_downstream_addr_group(
                       routerconf, StringRef::from_lit("git.nghttp2.org"),
                       StringRef::from_lit("/echo"), groups, 255, balloc));
@@ -244,4 +255,269 @@ void test_shrpx_worker_match_downstream_addr_group(void) {
                       StringRef{}, groups, 255, balloc));
 }
 
+void test_shrpx_worker_compute_worker_load(void) {
+  CU_ASSERT(0 == compute_worker_load(0, 0, 0, 0));
+  CU_ASSERT(0 == compute_worker_load(0, 0, 0, 5000));
+  CU_ASSERT(7 == compute_worker_load(2, 3, 2, 0));
+  // Lag below 1ms does not count.
+  CU_ASSERT(7 == compute_worker_load(2, 3, 2, 999));
+  CU_ASSERT(14 == compute_worker_load(2, 3, 2, 1000));
+  // A stalled worker with few connections is busier than a
+  // responsive worker with many.
+  CU_ASSERT(compute_worker_load(100, 100, 0, 0) <
+            compute_worker_load(10, 0, 0, 50000));
+}
+
+namespace {
+DownstreamAddrConfig make_addr_config(uint16_t port) {
+  DownstreamAddrConfig addr{};
+
+  addr.addr.su.in.sin_family = AF_INET;
+  addr.addr.su.in.sin_port = htons(port);
+  addr.addr.su.in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.addr.len = sizeof(addr.addr.su.in);
+  addr.host = StringRef::from_lit("127.0.0.1");
+  addr.port = port;
+  addr.proto = Proto::HTTP1;
+  addr.weight = 1;
+  addr.group_weight = 1;
+
+  return addr;
+}
+} // namespace
+
+namespace {
+// Creates DownstreamConfig which has a group for each element of
+// |groups|.  The first element of a pair is a pattern, and the
+// second is the list of ports of its backend addresses.
+std::shared_ptr<DownstreamConfig> make_downstream_config(
+    const std::vector<std::pair<StringRef, std::vector<uint16_t>>> &groups) {
+  auto downstreamconf = std::make_shared<DownstreamConfig>();
+
+  for (auto &g : groups) {
+    downstreamconf->addr_groups.emplace_back(g.first);
+    for (auto port : g.second) {
+      downstreamconf->addr_groups.back().addrs.push_back(
+          make_addr_config(port));
+    }
+  }
+
+  return downstreamconf;
+}
+} // namespace
+
+void test_shrpx_worker_same_backend_addr(void) {
+  DownstreamAddr a{}, b{};
+
+  auto ac = make_addr_config(8080);
+
+  a.addr = b.addr = ac.addr;
+  a.host = b.host = ac.host;
+  a.port = b.port = ac.port;
+  a.proto = b.proto = Proto::HTTP1;
+
+  CU_ASSERT(same_backend_addr(a, b));
+
+  // Weight does not matter.
+  b.weight = 100;
+
+  CU_ASSERT(same_backend_addr(a, b));
+
+  b.proto = Proto::HTTP2;
+
+  CU_ASSERT(!same_backend_addr(a, b));
+
+  b.proto = Proto::HTTP1;
+  b.tls = true;
+
+  CU_ASSERT(!same_backend_addr(a, b));
+
+  b.tls = false;
+  b.port = 8081;
+
+  CU_ASSERT(!same_backend_addr(a, b));
+
+  b.port = 8080;
+  b.addr.su.in.sin_addr.s_addr = htonl(0x7f000002);
+
+  CU_ASSERT(!same_backend_addr(a, b));
+}
+
+void test_shrpx_worker_replace_downstream_config(void) {
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+
+  {
+    auto worker = std::make_unique<Worker>(
+        loop, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        make_downstream_config({{StringRef::from_lit("/"), {8080, 8081}},
+                                {StringRef::from_lit("/alpha/"), {8082}}}));
+
+    auto &groups = worker->get_downstream_addr_groups();
+
+    CU_ASSERT(2 == groups.size());
+
+    auto g = groups[0];
+    auto shared_addr = g->shared_addr;
+    auto &addr = shared_addr->addrs[0];
+
+    addr.dconn_pool->add_downstream_connection(
+        std::make_unique<HttpDownstreamConnection>(g, &addr, loop,
+                                                   worker.get()));
+
+    stat_add(g->stat->responses[1]);
+
+    // Same configuration keeps the backend groups as they are.
+    worker->replace_downstream_config(
+        make_downstream_config({{StringRef::from_lit("/"), {8080, 8081}},
+                                {StringRef::from_lit("/alpha/"), {8082}}}));
+
+    CU_ASSERT(2 == groups.size());
+    CU_ASSERT(shared_addr == groups[0]->shared_addr);
+    CU_ASSERT(!g->retired);
+    CU_ASSERT(1 == addr.dconn_pool->size());
+    CU_ASSERT(1 == groups[0]->stat->responses[1].load());
+
+    auto old_g = groups[0];
+    auto old_shared_addr = old_g->shared_addr;
+
+    // 8081 is removed.  The idle connection to 8080 is moved to the
+    // new group.
+    worker->replace_downstream_config(
+        make_downstream_config({{StringRef::from_lit("/"), {8080}},
+                                {StringRef::from_lit("/alpha/"), {8082}}}));
+
+    CU_ASSERT(2 == groups.size());
+
+    g = groups[0];
+
+    CU_ASSERT(old_shared_addr != g->shared_addr);
+    CU_ASSERT(old_g->retired);
+    CU_ASSERT(0 == old_shared_addr->addrs[0].dconn_pool->size());
+    CU_ASSERT(1 == g->shared_addr->addrs.size());
+
+    auto &new_addr = g->shared_addr->addrs[0];
+
+    CU_ASSERT(1 == new_addr.dconn_pool->size());
+
+    auto dconn = new_addr.dconn_pool->pop_downstream_connection();
+
+    CU_ASSERT(&new_addr == dconn->get_addr());
+    CU_ASSERT(g == dconn->get_downstream_addr_group());
+
+    new_addr.dconn_pool->add_downstream_connection(std::move(dconn));
+
+    old_g = g;
+    old_shared_addr = g->shared_addr;
+
+    // The port is changed.  Nothing is inherited and the idle
+    // connection is dropped.
+    worker->replace_downstream_config(
+        make_downstream_config({{StringRef::from_lit("/"), {8090}},
+                                {StringRef::from_lit("/alpha/"), {8082}}}));
+
+    g = groups[0];
+
+    CU_ASSERT(old_g->retired);
+    CU_ASSERT(0 == old_shared_addr->addrs[0].dconn_pool->size());
+    CU_ASSERT(0 == g->shared_addr->addrs[0].dconn_pool->size());
+
+    auto alpha_g = groups[1];
+    auto &alpha_addr = alpha_g->shared_addr->addrs[0];
+
+    alpha_addr.dconn_pool->add_downstream_connection(
+        std::make_unique<HttpDownstreamConnection>(alpha_g, &alpha_addr, loop,
+                                                   worker.get()));
+
+    // /alpha/ is removed.  Its group is retired and its connection
+    // is dropped.
+    worker->replace_downstream_config(
+        make_downstream_config({{StringRef::from_lit("/"), {8090}}}));
+
+    CU_ASSERT(1 == groups.size());
+    CU_ASSERT(!groups[0]->retired);
+    CU_ASSERT(alpha_g->retired);
+    CU_ASSERT(0 == alpha_addr.dconn_pool->size());
+  }
+
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_worker_maintain_idle_backend_connections(void) {
+  // The backend which never accepts connections.  The kernel
+  // completes handshake for us.
+  auto fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  CU_ASSERT_FATAL(fd != -1);
+
+  sockaddr_union su{};
+  su.in.sin_family = AF_INET;
+  su.in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(su.in);
+
+  auto listening = bind(fd, &su.sa, len) == 0 && listen(fd, 8) == 0 &&
+                   getsockname(fd, &su.sa, &len) == 0;
+  if (!listening) {
+    close(fd);
+  }
+
+  CU_ASSERT_FATAL(listening);
+
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+
+  {
+    auto downstreamconf = make_downstream_config(
+        {{StringRef::from_lit("/"), {ntohs(su.in.sin_port)}}});
+    auto &addrconf = downstreamconf->addr_groups[0].addrs[0];
+    addrconf.min_idle = 2;
+    addrconf.prewarm = true;
+
+    auto worker =
+        std::make_unique<Worker>(loop, nullptr, nullptr, nullptr, nullptr,
+                                 nullptr, nullptr, downstreamconf);
+
+    auto &g = worker->get_downstream_addr_groups()[0];
+    auto &addr = g->shared_addr->addrs[0];
+    auto &dconn_pool = addr.dconn_pool;
+
+    CU_ASSERT(addr.keep_idle);
+
+    worker->maintain_idle_backend_connections();
+
+    CU_ASSERT(0 == dconn_pool->size());
+    CU_ASSERT(2 == dconn_pool->num_prewarming_connections());
+
+    for (size_t i = 0; i < 1000 && dconn_pool->size() < 2; ++i) {
+      ev_run(loop, EVRUN_NOWAIT);
+      usleep(1000);
+    }
+
+    CU_ASSERT(2 == dconn_pool->size());
+    CU_ASSERT(0 == dconn_pool->num_prewarming_connections());
+
+    // There are enough idle connections.
+    worker->maintain_idle_backend_connections();
+
+    CU_ASSERT(2 == dconn_pool->size());
+    CU_ASSERT(0 == dconn_pool->num_prewarming_connections());
+
+    // An idle connection which is about to be timed out is retired,
+    // and replaced with new one.
+    auto dconn = dconn_pool->pop_downstream_connection();
+    auto p = static_cast<HttpDownstreamConnection *>(dconn.get());
+    dconn_pool->add_downstream_connection(std::move(dconn));
+
+    CU_ASSERT(p->refresh_idle());
+    CU_ASSERT(1 == dconn_pool->size());
+    CU_ASSERT(1 == dconn_pool->num_prewarming_connections());
+
+    // The replacement is started only once.
+    CU_ASSERT(!p->refresh_idle());
+    CU_ASSERT(1 == dconn_pool->num_prewarming_connections());
+  }
+
+  ev_loop_destroy(loop);
+
+  close(fd);
+}
+
 } // namespace shrpx
@@ -32,6 +32,10 @@
 namespace shrpx {
 
 void test_shrpx_worker_match_downstream_addr_group(void);
+void test_shrpx_worker_compute_worker_load(void);
+void test_shrpx_worker_same_backend_addr(void);
+void test_shrpx_worker_replace_downstream_config(void);
+void test_shrpx_worker_maintain_idle_backend_connections(void);
 
 } // namespace shrpx
 
@@ -0,0 +1,190 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_zerocopy.h"
+
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>
+#endif // HAVE_SYS_SOCKET_H
+#ifdef HAVE_NETINET_IN_H
+#  include <netinet/in.h>
+#endif // HAVE_NETINET_IN_H
+#ifdef HAVE_LINUX_ERRQUEUE_H
+#  include <time.h>
+#  include <linux/errqueue.h>
+#endif // HAVE_LINUX_ERRQUEUE_H
+
+#include <cerrno>
+#include <array>
+
+#include "shrpx_worker.h"
+#include "shrpx_metrics.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+// The interval to poll the error queue while some sends are pending
+constexpr auto COMPLETION_POLL_INTERVAL = 10_ms;
+} // namespace
+
+namespace {
+void completioncb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto tracker = static_cast<ZerocopyTracker *>(w->data);
+
+  tracker->read_completions();
+}
+} // namespace
+
+ZerocopyTracker::ZerocopyTracker(Worker *worker, int fd, size_t threshold)
+    : worker_(worker),
+      fd_(fd),
+      threshold_(threshold),
+      seq_(0),
+      completed_(0),
+      disabled_(false) {
+  ev_timer_init(&pollev_, completioncb, 0., COMPLETION_POLL_INTERVAL);
+  pollev_.data = this;
+}
+
+ZerocopyTracker::~ZerocopyTracker() {
+  ev_timer_stop(worker_->get_loop(), &pollev_);
+
+  if (pending()) {
+    read_completions();
+  }
+
+  if (pinned_.empty()) {
+    return;
+  }
+
+  // The kernel may still send data from these buffers after the
+  // socket is closed.
+  DefaultMemchunks bufs(worker_->get_mcpool());
+
+  for (auto &p : pinned_) {
+    p.second.remove(bufs);
+  }
+
+  worker_->linger_zerocopy_buffers(std::move(bufs));
+}
+
+bool ZerocopyTracker::eligible(size_t len) const {
+  return !disabled_ && len >= threshold_;
+}
+
+void ZerocopyTracker::on_send() {
+  ++seq_;
+
+  stat_add(worker_->get_worker_stat()->zerocopy_sends);
+
+  if (!ev_is_active(&pollev_)) {
+    ev_timer_again(worker_->get_loop(), &pollev_);
+  }
+}
+
+void ZerocopyTracker::on_copy_fallback() {
+  stat_add(worker_->get_worker_stat()->zerocopy_copied);
+}
+
+bool ZerocopyTracker::pending() const { return completed_ != seq_; }
+
+void ZerocopyTracker::pin(DefaultMemchunks bufs) {
+  if (!bufs.head) {
+    return;
+  }
+
+  if (!pinned_.empty() && pinned_.back().first == seq_) {
+    bufs.remove(pinned_.back().second);
+    return;
+  }
+
+  pinned_.emplace_back(seq_, std::move(bufs));
+}
+
+void ZerocopyTracker::read_completions() {
+#ifdef HAVE_LINUX_ERRQUEUE_H
+  auto worker_stat = worker_->get_worker_stat();
+
+  for (;;) {
+    std::array<uint8_t, CMSG_SPACE(sizeof(sock_extended_err) +
+                                   sizeof(sockaddr_in6))>
+        cmsgbuf;
+    msghdr msg{};
+    msg.msg_control = cmsgbuf.data();
+    msg.msg_controllen = cmsgbuf.size();
+
+    ssize_t nread;
+    while ((nread = recvmsg(fd_, &msg, MSG_ERRQUEUE)) == -1 && errno == EINTR)
+      ;
+    if (nread == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && LOG_ENABLED(INFO)) {
+        LOG(INFO) << "recvmsg(MSG_ERRQUEUE) failed: errno=" << errno;
+      }
+      break;
+    }
+
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 &&
+            cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+
+      auto serr = reinterpret_cast<sock_extended_err *>(CMSG_DATA(cmsg));
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+
+      // Sends from ee_info to ee_data, inclusive, have completed.
+      uint32_t n = serr->ee_data - serr->ee_info + 1;
+
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        stat_add(worker_stat->zerocopy_copied, n);
+        disabled_ = true;
+      }
+
+      if (static_cast<int32_t>(serr->ee_data + 1 - completed_) > 0) {
+        completed_ = serr->ee_data + 1;
+      }
+    }
+  }
+
+  release();
+#endif // HAVE_LINUX_ERRQUEUE_H
+}
+
+void ZerocopyTracker::release() {
+  while (!pinned_.empty() &&
+         static_cast<int32_t>(completed_ - pinned_.front().first) >= 0) {
+    pinned_.pop_front();
+  }
+
+  if (!pending()) {
+    ev_timer_stop(worker_->get_loop(), &pollev_);
+  }
+}
+
+} // namespace shrpx
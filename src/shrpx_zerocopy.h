@@ -0,0 +1,102 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_ZEROCOPY_H
+#define SHRPX_ZEROCOPY_H
+
+#include "shrpx.h"
+
+#include <deque>
+#include <utility>
+
+#include <ev.h>
+
+#include "memchunk.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+class Worker;
+
+// ZerocopyTracker follows the sends with MSG_ZEROCOPY on a client
+// connection.  The memory of a send must be kept intact until the
+// kernel notifies its completion on the error queue of the socket.
+// The buffers drained while sends are in flight are pinned here, and
+// recycled when the completions arrive.
+class ZerocopyTracker {
+public:
+  ZerocopyTracker(Worker *worker, int fd, size_t threshold);
+  ~ZerocopyTracker();
+
+  ZerocopyTracker(const ZerocopyTracker &) = delete;
+  ZerocopyTracker &operator=(const ZerocopyTracker &) = delete;
+
+  // Returns true if |len| bytes of data should be sent with
+  // MSG_ZEROCOPY.
+  bool eligible(size_t len) const;
+  // Call this function after a send with MSG_ZEROCOPY succeeded.
+  void on_send();
+  // Call this function if data was copied because the kernel could
+  // not pin memory.
+  void on_copy_fallback();
+  // Returns true if the completion of some sends has not been
+  // notified yet.  While this function returns true, the drained
+  // buffers must be passed to pin() instead of being recycled.
+  bool pending() const;
+  // Keeps |bufs| until all sends made so far complete.
+  void pin(DefaultMemchunks bufs);
+  // Reads completion notifications from the error queue, and
+  // recycles the buffers which are no longer used by the kernel.
+  // Call this function after the buffers drained by a send are
+  // pinned.  It is also called periodically while some sends are
+  // pending.
+  void read_completions();
+
+private:
+  void release();
+
+  // Pinned buffers tagged with seq_ at the time they were pinned.
+  std::deque<std::pair<uint32_t, DefaultMemchunks>> pinned_;
+  // The completion makes the socket readable, but so does the
+  // request data which ClientHandler may not read for now.  Poll the
+  // error queue with this timer instead of watching the socket.
+  ev_timer pollev_;
+  Worker *worker_;
+  int fd_;
+  // The minimum number of bytes to send with MSG_ZEROCOPY.
+  size_t threshold_;
+  // The number of sends with MSG_ZEROCOPY.  The kernel numbers them
+  // from 0 in the same order.
+  uint32_t seq_;
+  // All sends numbered less than this have completed.
+  uint32_t completed_;
+  // true if the kernel copied data instead of pinning it.  In that
+  // case MSG_ZEROCOPY only adds overhead, and is no longer used.
+  bool disabled_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_ZEROCOPY_H
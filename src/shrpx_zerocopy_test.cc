@@ -0,0 +1,241 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 nghttp2 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_zerocopy_test.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <array>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_zerocopy.h"
+#include "shrpx_config.h"
+#include "shrpx_worker.h"
+#include "shrpx_log.h"
+#include "util.h"
+
+namespace shrpx {
+
+namespace {
+// Makes a connected pair of loopback TCP sockets, and enables
+// SO_ZEROCOPY on fds[0].  Returns -1 if MSG_ZEROCOPY is not
+// available.
+int make_zerocopy_pair(std::array<int, 2> &fds) {
+#if defined(SO_ZEROCOPY) && defined(HAVE_LINUX_ERRQUEUE_H)
+  auto lfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (lfd == -1) {
+    return -1;
+  }
+
+  sockaddr_union su{};
+  su.in.sin_family = AF_INET;
+  su.in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(su.in);
+
+  fds[0] = fds[1] = -1;
+
+  if (bind(lfd, &su.sa, len) == 0 && listen(lfd, 1) == 0 &&
+      getsockname(lfd, &su.sa, &len) == 0) {
+    fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+    if (fds[0] != -1 && connect(fds[0], &su.sa, len) == 0) {
+      fds[1] = accept(lfd, nullptr, nullptr);
+    }
+  }
+
+  close(lfd);
+
+  int val = 1;
+  if (fds[1] == -1 ||
+      setsockopt(fds[0], SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) == -1) {
+    if (fds[0] != -1) {
+      close(fds[0]);
+    }
+    if (fds[1] != -1) {
+      close(fds[1]);
+    }
+    return -1;
+  }
+
+  return 0;
+#else  // !defined(SO_ZEROCOPY) || !defined(HAVE_LINUX_ERRQUEUE_H)
+  return -1;
+#endif // !defined(SO_ZEROCOPY) || !defined(HAVE_LINUX_ERRQUEUE_H)
+}
+} // namespace
+
+namespace {
+// Sends at most |len| bytes in |bufs| with MSG_ZEROCOPY, and returns
+// the chunks which are completely sent.
+DefaultMemchunks send_zerocopy(int fd, DefaultMemchunks &bufs, size_t len,
+                               ZerocopyTracker &tracker) {
+  DefaultMemchunks pinned(bufs.pool);
+
+#ifdef MSG_ZEROCOPY
+  std::array<iovec, 4> iov;
+  msghdr msg{};
+  msg.msg_iov = iov.data();
+  msg.msg_iovlen =
+      limit_iovec(iov.data(), bufs.riovec(iov.data(), iov.size()), len);
+
+  auto nwrite = sendmsg(fd, &msg, MSG_ZEROCOPY);
+
+  CU_ASSERT(static_cast<ssize_t>(std::min(len, bufs.rleft())) == nwrite);
+
+  if (nwrite > 0) {
+    tracker.on_send();
+    bufs.drain_pin(nwrite, pinned);
+  }
+#endif // MSG_ZEROCOPY
+
+  return pinned;
+}
+} // namespace
+
+namespace {
+// Reads |n| bytes from |fd|.
+void read_all(int fd, size_t n) {
+  std::array<uint8_t, 4096> buf;
+
+  while (n) {
+    auto nread = read(fd, buf.data(), std::min(n, buf.size()));
+    if (nread <= 0) {
+      break;
+    }
+    n -= nread;
+  }
+
+  CU_ASSERT(0 == n);
+}
+} // namespace
+
+void test_shrpx_zerocopy_tracker(void) {
+  std::array<int, 2> fds;
+  if (make_zerocopy_pair(fds) != 0) {
+    // MSG_ZEROCOPY is not available on this platform.
+    return;
+  }
+
+  auto &upstreamconf = mod_config()->conn.upstream;
+  auto write_timeout = upstreamconf.timeout.write;
+  // Release the buffers lingering after the tracker is destroyed
+  // immediately.
+  upstreamconf.timeout.write = 0.;
+
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+
+  {
+    auto worker = std::make_unique<Worker>(
+        loop, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        std::make_shared<DownstreamConfig>());
+    auto mcpool = worker->get_mcpool();
+    auto worker_stat = worker->get_worker_stat();
+    std::array<uint8_t, 8192> data{};
+
+    {
+      ZerocopyTracker tracker(worker.get(), fds[0], 4096);
+
+      CU_ASSERT(!tracker.eligible(4095));
+      CU_ASSERT(tracker.eligible(4096));
+      CU_ASSERT(!tracker.pending());
+
+      // Request data which is not read does not interfere with the
+      // completions.
+      CU_ASSERT(3 == write(fds[1], "GET", 3));
+
+      DefaultMemchunks bufs(mcpool);
+      bufs.append(data.data(), data.size());
+
+      auto freelistsize = mcpool->freelistsize.load();
+
+      tracker.pin(send_zerocopy(fds[0], bufs, data.size(), tracker));
+
+      CU_ASSERT(0 == bufs.rleft());
+      CU_ASSERT(1 == worker_stat->zerocopy_sends);
+      CU_ASSERT(tracker.pending());
+      // The chunk stays pinned until the send completes.
+      CU_ASSERT(freelistsize == mcpool->freelistsize.load());
+
+      read_all(fds[1], data.size());
+
+      for (size_t i = 0; i < 100 && tracker.pending(); ++i) {
+        ev_run(loop, EVRUN_NOWAIT);
+        if (tracker.pending()) {
+          usleep(10000);
+        }
+      }
+
+      CU_ASSERT(!tracker.pending());
+      CU_ASSERT(freelistsize < mcpool->freelistsize.load());
+      // The kernel copies data sent over loopback.  Once it does,
+      // MSG_ZEROCOPY is no longer used.
+      CU_ASSERT((0 == worker_stat->zerocopy_copied) ==
+                tracker.eligible(4096));
+
+      // The head chunk is partially sent.  It is still in bufs.
+      bufs.append(data.data(), data.size());
+
+      freelistsize = mcpool->freelistsize.load();
+
+      tracker.pin(send_zerocopy(fds[0], bufs, 100, tracker));
+
+      CU_ASSERT(data.size() - 100 == bufs.rleft());
+      CU_ASSERT(tracker.pending());
+
+      // Connection is closed before the send completes.  Pin the rest
+      // of the buffer as ClientHandler does.
+      DefaultMemchunks pinned(mcpool);
+      iovec iov;
+
+      while (bufs.riovec(&iov, 1)) {
+        bufs.drain_pin(iov.iov_len, pinned);
+      }
+
+      tracker.pin(std::move(pinned));
+
+      CU_ASSERT(nullptr == bufs.head);
+      CU_ASSERT(freelistsize == mcpool->freelistsize.load());
+    }
+
+    // The buffers which the tracker still held are handed to the
+    // worker, and recycled after the write timeout.
+    worker->release_lingering_zerocopy_buffers();
+
+    CU_ASSERT(mcpool->poolsize.load() == mcpool->freelistsize.load());
+  }
+
+  ev_loop_destroy(loop);
+
+  upstreamconf.timeout.write = write_timeout;
+
+  close(fds[1]);
+  close(fds[0]);
+}
+
+} // namespace shrpx
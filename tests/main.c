@@ -118,6 +118,8 @@ int main(int argc, char *argv[]) {
       !CU_add_test(pSuite, "session_recv_priority_update",
                    test_nghttp2_session_recv_priority_update) ||
       !CU_add_test(pSuite, "session_continue", test_nghttp2_session_continue) ||
+      !CU_add_test(pSuite, "session_mem_recv_events",
+                   test_nghttp2_session_mem_recv_events) ||
       !CU_add_test(pSuite, "session_add_frame",
                    test_nghttp2_session_add_frame) ||
       !CU_add_test(pSuite, "session_on_request_headers_received",
@@ -308,6 +310,8 @@ int main(int argc, char *argv[]) {
                    test_nghttp2_session_reset_pending_headers) ||
       !CU_add_test(pSuite, "session_send_data_callback",
                    test_nghttp2_session_send_data_callback) ||
+      !CU_add_test(pSuite, "session_send_data_batch_callback",
+                   test_nghttp2_session_send_data_batch_callback) ||
       !CU_add_test(pSuite, "session_on_begin_headers_temporal_failure",
                    test_nghttp2_session_on_begin_headers_temporal_failure) ||
       !CU_add_test(pSuite, "session_defer_then_close",
@@ -394,6 +398,10 @@ int main(int argc, char *argv[]) {
       !CU_add_test(pSuite, "hd_deflate", test_nghttp2_hd_deflate) ||
       !CU_add_test(pSuite, "hd_deflate_same_indexed_repr",
                    test_nghttp2_hd_deflate_same_indexed_repr) ||
+      !CU_add_test(pSuite, "hd_deflate_precompiled",
+                   test_nghttp2_hd_deflate_precompiled) ||
+      !CU_add_test(pSuite, "hd_inflate_rcbuf_pool",
+                   test_nghttp2_hd_inflate_rcbuf_pool) ||
       !CU_add_test(pSuite, "hd_inflate_indexed",
                    test_nghttp2_hd_inflate_indexed) ||
       !CU_add_test(pSuite, "hd_inflate_indname_noinc",
@@ -188,6 +188,324 @@ void test_nghttp2_hd_deflate_same_indexed_repr(void) {
   nghttp2_hd_deflate_free(&deflater);
 }
 
+static void check_deflate_precompiled(nghttp2_hd_deflater *deflater,
+                                      nghttp2_hd_deflater *ref_deflater,
+                                      nghttp2_hd_inflater *inflater,
+                                      const nghttp2_nv *nva, size_t nvlen,
+                                      nghttp2_mem *mem) {
+  nghttp2_bufs bufs, ref_bufs;
+  nva_out out;
+  ssize_t blocklen;
+  uint8_t *buf, *ref_buf;
+
+  frame_pack_bufs_init(&bufs);
+  frame_pack_bufs_init(&ref_bufs);
+  nva_out_init(&out);
+
+  CU_ASSERT(0 == nghttp2_hd_deflate_hd_bufs(deflater, &bufs, nva, nvlen));
+  CU_ASSERT(0 ==
+            nghttp2_hd_deflate_hd_bufs(ref_deflater, &ref_bufs, nva, nvlen));
+
+  blocklen = (ssize_t)nghttp2_bufs_len(&bufs);
+
+  CU_ASSERT((size_t)blocklen == nghttp2_bufs_len(&ref_bufs));
+
+  nghttp2_bufs_remove(&bufs, &buf);
+  nghttp2_bufs_remove(&ref_bufs, &ref_buf);
+
+  CU_ASSERT(0 == memcmp(ref_buf, buf, (size_t)blocklen));
+
+  nghttp2_bufs_reset(&bufs);
+  nghttp2_bufs_add(&bufs, buf, (size_t)blocklen);
+
+  CU_ASSERT(blocklen == inflate_hd(inflater, &out, &bufs, 0, mem));
+  CU_ASSERT(nvlen == out.nvlen);
+  assert_nv_equal((nghttp2_nv *)nva, out.nva, nvlen, mem);
+
+  nva_out_reset(&out, mem);
+  mem->free(buf, NULL);
+  mem->free(ref_buf, NULL);
+  nghttp2_bufs_free(&ref_bufs);
+  nghttp2_bufs_free(&bufs);
+}
+
+void test_nghttp2_hd_deflate_precompiled(void) {
+  nghttp2_hd_deflater deflater, ref_deflater;
+  nghttp2_hd_inflater inflater;
+  nghttp2_nv precompiled[] = {
+      MAKE_NV(":status", "200"),
+      MAKE_NV("server", "nghttpx"),
+      MAKE_NV("alt-svc", "h3=\":443\"; ma=3600"),
+      MAKE_NV("x-precompiled", "yes"),
+      MAKE_NV("etag", "\"constant\""),
+      MAKE_NV("x-secret", "password"),
+      MAKE_NV("x-precompiled", "maybe"),
+  };
+  nghttp2_nv nva[] = {
+      MAKE_NV(":status", "200"),
+      MAKE_NV("server", "nghttpx"),
+      MAKE_NV("content-type", "text/html"),
+      MAKE_NV("alt-svc", "h3=\":443\"; ma=3600"),
+      MAKE_NV("x-precompiled", "yes"),
+      MAKE_NV("etag", "\"constant\""),
+      MAKE_NV("x-secret", "password"),
+      MAKE_NV("x-precompiled", "no"),
+  };
+  nghttp2_nv noidx_nva[] = {
+      MAKE_NV(":status", "200"),
+      MAKE_NV("server", "nghttpx"),
+      MAKE_NV("etag", "\"constant\""),
+      MAKE_NV("x-precompiled", "maybe"),
+  };
+  nghttp2_hd_precompiled *pc;
+  nghttp2_nv too_many[NGHTTP2_HD_MAX_PRECOMPILED];
+  nghttp2_mem *mem;
+  size_t i;
+
+  mem = nghttp2_mem_default();
+
+  /* Indexing mode is chosen on each use */
+  nva[6].flags = NGHTTP2_NV_FLAG_NO_INDEX;
+
+  CU_ASSERT(0 == nghttp2_hd_deflate_init(&deflater, mem));
+  CU_ASSERT(0 == nghttp2_hd_deflate_init(&ref_deflater, mem));
+  CU_ASSERT(0 == nghttp2_hd_inflate_init(&inflater, mem));
+
+  CU_ASSERT(0 == nghttp2_hd_deflate_add_precompiled(&deflater, precompiled,
+                                                    ARRLEN(precompiled)));
+  CU_ASSERT(ARRLEN(precompiled) == deflater.precompiledlen);
+
+  pc = &deflater.precompiled[0];
+
+  /* Only literal representations are cached.  The name :status is
+     referred to by its first index 8. */
+  CU_ASSERT(0x48 == pc->encoded[NGHTTP2_HD_WITH_INDEXING][0]);
+  CU_ASSERT(0x08 == pc->encoded[NGHTTP2_HD_WITHOUT_INDEXING][0]);
+  CU_ASSERT(0x18 == pc->encoded[NGHTTP2_HD_NEVER_INDEXING][0]);
+
+  pc = &deflater.precompiled[1];
+
+  CU_ASSERT(0x40 == (pc->encoded[NGHTTP2_HD_WITH_INDEXING][0] & 0xc0));
+  CU_ASSERT(0x00 == (pc->encoded[NGHTTP2_HD_WITHOUT_INDEXING][0] & 0xf0));
+  CU_ASSERT(0x10 == (pc->encoded[NGHTTP2_HD_NEVER_INDEXING][0] & 0xf0));
+
+  /* The first header block inserts the entries into dynamic table. */
+  check_deflate_precompiled(&deflater, &ref_deflater, &inflater, nva,
+                            ARRLEN(nva), mem);
+
+  CU_ASSERT(ref_deflater.ctx.hd_table.len == deflater.ctx.hd_table.len);
+
+  /* The second header block refers to the entries by index. */
+  check_deflate_precompiled(&deflater, &ref_deflater, &inflater, nva,
+                            ARRLEN(nva), mem);
+
+  /* Evict all entries.  Precompiled header fields must be inserted
+     again. */
+  CU_ASSERT(0 == nghttp2_hd_deflate_change_table_size(&deflater, 0));
+  CU_ASSERT(0 == nghttp2_hd_deflate_change_table_size(&ref_deflater, 0));
+  CU_ASSERT(0 == nghttp2_hd_inflate_change_table_size(&inflater, 0));
+
+  check_deflate_precompiled(&deflater, &ref_deflater, &inflater, nva,
+                            ARRLEN(nva), mem);
+
+  CU_ASSERT(0 == deflater.ctx.hd_table.len);
+
+  CU_ASSERT(0 == nghttp2_hd_deflate_change_table_size(&deflater, 4096));
+  CU_ASSERT(0 == nghttp2_hd_deflate_change_table_size(&ref_deflater, 4096));
+  CU_ASSERT(0 == nghttp2_hd_inflate_change_table_size(&inflater, 4096));
+
+  for (i = 0; i < 3; ++i) {
+    check_deflate_precompiled(&deflater, &ref_deflater, &inflater, nva,
+                              ARRLEN(nva), mem);
+  }
+
+  /* The same header fields with NGHTTP2_NV_FLAG_NO_INDEX are emitted
+     as never indexed literal even if they are in dynamic table.
+     "x-precompiled: maybe" is not in dynamic table, but its name is,
+     so it is referred to by index as the ordinary path does. */
+  for (i = 0; i < ARRLEN(noidx_nva); ++i) {
+    noidx_nva[i].flags = NGHTTP2_NV_FLAG_NO_INDEX;
+  }
+
+  check_deflate_precompiled(&deflater, &ref_deflater, &inflater, noidx_nva,
+                            ARRLEN(noidx_nva), mem);
+
+  /* Then back to indexed representation */
+  check_deflate_precompiled(&deflater, &ref_deflater, &inflater, nva,
+                            ARRLEN(nva), mem);
+
+  /* Inserted with its name referred to by dynamic table index */
+  for (i = 0; i < ARRLEN(noidx_nva); ++i) {
+    noidx_nva[i].flags = NGHTTP2_NV_FLAG_NONE;
+  }
+
+  for (i = 0; i < 2; ++i) {
+    check_deflate_precompiled(&deflater, &ref_deflater, &inflater, noidx_nva,
+                              ARRLEN(noidx_nva), mem);
+  }
+
+  /* Exceeding the limit */
+  for (i = 0; i < ARRLEN(too_many); ++i) {
+    too_many[i] = precompiled[1];
+  }
+
+  CU_ASSERT(NGHTTP2_ERR_INVALID_ARGUMENT ==
+            nghttp2_hd_deflate_add_precompiled(&deflater, too_many,
+                                               ARRLEN(too_many)));
+  CU_ASSERT(ARRLEN(precompiled) == deflater.precompiledlen);
+
+  nghttp2_hd_inflate_free(&inflater);
+  nghttp2_hd_deflate_free(&ref_deflater);
+  nghttp2_hd_deflate_free(&deflater);
+}
+
+void test_nghttp2_hd_inflate_rcbuf_pool(void) {
+  nghttp2_hd_deflater deflater;
+  nghttp2_hd_inflater inflater;
+  uint8_t large[NGHTTP2_RCBUF_POOL_BUFLEN * 2];
+  nghttp2_nv nva[] = {MAKE_NV("x-small", "alpha"), MAKE_NV("x-large", "")};
+  nghttp2_hd_nv hd_nva[ARRLEN(nva)];
+  nghttp2_hd_nv nv_out;
+  nghttp2_rcbuf_pool *pool;
+  nghttp2_rcbuf *small_name;
+  nghttp2_bufs bufs;
+  nghttp2_buf *buf;
+  int inflate_flags;
+  ssize_t rv;
+  size_t i, nvlen;
+  nghttp2_mem *mem;
+
+  mem = nghttp2_mem_default();
+  frame_pack_bufs_init(&bufs);
+
+  memset(large, 'a', sizeof(large));
+  nva[1].value = large;
+  nva[1].valuelen = sizeof(large);
+
+  /* Make sure that inflater does not keep the header fields in
+     dynamic table. */
+  for (i = 0; i < ARRLEN(nva); ++i) {
+    nva[i].flags = NGHTTP2_NV_FLAG_NO_INDEX;
+  }
+
+  CU_ASSERT(0 == nghttp2_hd_deflate_init(&deflater, mem));
+  CU_ASSERT(0 == nghttp2_hd_inflate_init(&inflater, mem));
+
+  pool = inflater.ctx.rcbuf_pool;
+
+  CU_ASSERT(0 == nghttp2_hd_deflate_hd_bufs(&deflater, &bufs, nva,
+                                            ARRLEN(nva)));
+
+  buf = &bufs.head->buf;
+  nvlen = 0;
+
+  for (;;) {
+    inflate_flags = 0;
+    rv = nghttp2_hd_inflate_hd_nv(&inflater, &nv_out, &inflate_flags,
+                                  buf->pos, nghttp2_buf_len(buf), 1);
+
+    CU_ASSERT(rv >= 0);
+
+    buf->pos += rv;
+
+    if (inflate_flags & NGHTTP2_HD_INFLATE_EMIT) {
+      nghttp2_rcbuf_incref_internal(nv_out.name);
+      nghttp2_rcbuf_incref_internal(nv_out.value);
+      hd_nva[nvlen++] = nv_out;
+    }
+
+    if (inflate_flags & NGHTTP2_HD_INFLATE_FINAL) {
+      break;
+    }
+  }
+
+  nghttp2_hd_inflate_end_headers(&inflater);
+
+  CU_ASSERT(ARRLEN(nva) == nvlen);
+  CU_ASSERT(pool == hd_nva[0].name->pool);
+  CU_ASSERT(pool == hd_nva[0].value->pool);
+  CU_ASSERT(pool == hd_nva[1].name->pool);
+  CU_ASSERT(NULL == hd_nva[1].value->pool);
+  /* 3 rcbufs are outstanding, plus inflater itself. */
+  CU_ASSERT(4 == pool->ref);
+  CU_ASSERT(0 == pool->len);
+
+  /* Releasing the last reference returns rcbuf to the pool. */
+  small_name = hd_nva[0].name;
+  nghttp2_rcbuf_decref(small_name);
+
+  CU_ASSERT(3 == pool->ref);
+  CU_ASSERT(1 == pool->len);
+
+  /* The next allocation reuses it. */
+  nghttp2_bufs_reset(&bufs);
+
+  CU_ASSERT(0 == nghttp2_hd_deflate_hd_bufs(&deflater, &bufs, nva, 1));
+
+  buf = &bufs.head->buf;
+
+  for (;;) {
+    inflate_flags = 0;
+    rv = nghttp2_hd_inflate_hd_nv(&inflater, &nv_out, &inflate_flags,
+                                  buf->pos, nghttp2_buf_len(buf), 1);
+
+    CU_ASSERT(rv >= 0);
+
+    buf->pos += rv;
+
+    if (inflate_flags & NGHTTP2_HD_INFLATE_EMIT) {
+      CU_ASSERT(small_name == nv_out.name);
+      CU_ASSERT(nv_out.name->len == sizeof("x-small") - 1);
+      CU_ASSERT(0 == memcmp("x-small", nv_out.name->base, nv_out.name->len));
+    }
+
+    if (inflate_flags & NGHTTP2_HD_INFLATE_FINAL) {
+      break;
+    }
+  }
+
+  nghttp2_hd_inflate_end_headers(&inflater);
+
+  /* Both name and value were released by
+     nghttp2_hd_inflate_end_headers(). */
+  CU_ASSERT(2 == pool->len);
+  CU_ASSERT(3 == pool->ref);
+
+  /* Lowering the limit frees the objects exceeding it. */
+  nghttp2_rcbuf_pool_set_max_free(pool, 1);
+
+  CU_ASSERT(1 == pool->len);
+  CU_ASSERT(3 == pool->ref);
+
+  nghttp2_rcbuf_pool_set_max_free(pool, NGHTTP2_RCBUF_POOL_MAX_FREE);
+
+  /* Retained rcbufs outlive inflater. */
+  nghttp2_hd_inflate_free(&inflater);
+
+  CU_ASSERT(pool->closed);
+  CU_ASSERT(2 == pool->ref);
+  CU_ASSERT(0 == memcmp("alpha", hd_nva[0].value->base,
+                        hd_nva[0].value->len));
+
+  /* Application retains rcbuf with nghttp2_rcbuf_incref().  It is
+     detached from the pool. */
+  nghttp2_rcbuf_incref(hd_nva[0].value);
+
+  CU_ASSERT(NULL == hd_nva[0].value->pool);
+  CU_ASSERT(1 == pool->ref);
+
+  nghttp2_rcbuf_decref(hd_nva[0].value);
+
+  for (i = 0; i < nvlen; ++i) {
+    nghttp2_rcbuf_decref(hd_nva[i].value);
+  }
+  /* This frees pool as well. */
+  nghttp2_rcbuf_decref(hd_nva[1].name);
+
+  nghttp2_bufs_free(&bufs);
+  nghttp2_hd_deflate_free(&deflater);
+}
+
 void test_nghttp2_hd_inflate_indexed(void) {
   nghttp2_hd_inflater inflater;
   nghttp2_bufs bufs;
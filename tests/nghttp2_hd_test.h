@@ -31,6 +31,8 @@
 
 void test_nghttp2_hd_deflate(void);
 void test_nghttp2_hd_deflate_same_indexed_repr(void);
+void test_nghttp2_hd_deflate_precompiled(void);
+void test_nghttp2_hd_inflate_rcbuf_pool(void);
 void test_nghttp2_hd_inflate_indexed(void);
 void test_nghttp2_hd_inflate_indname_noinc(void);
 void test_nghttp2_hd_inflate_indname_inc(void);
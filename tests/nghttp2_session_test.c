@@ -79,6 +79,9 @@ typedef struct {
   int begin_frame_cb_called;
   nghttp2_buf scratchbuf;
   size_t data_source_read_cb_paused;
+  int send_data_batch_cb_called;
+  size_t send_data_batch_entries;
+  int send_data_batch_pause;
 } my_user_data;
 
 static const nghttp2_nv reqnv[] = {
@@ -444,6 +447,62 @@ static int send_data_callback(nghttp2_session *session, nghttp2_frame *frame,
   return 0;
 }
 
+static ssize_t per_stream_no_copy_data_source_read_callback(
+    nghttp2_session *session, int32_t stream_id, uint8_t *buf, size_t len,
+    uint32_t *data_flags, nghttp2_data_source *source, void *user_data) {
+  size_t *remaining = source->ptr;
+  size_t wlen;
+  (void)session;
+  (void)stream_id;
+  (void)buf;
+  (void)user_data;
+
+  wlen = nghttp2_min(len, *remaining);
+
+  *remaining -= wlen;
+
+  *data_flags |= NGHTTP2_DATA_FLAG_NO_COPY;
+
+  if (*remaining == 0) {
+    *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+  }
+
+  return (ssize_t)wlen;
+}
+
+static int send_data_batch_callback(nghttp2_session *session,
+                                    const nghttp2_send_data_entry *entries,
+                                    size_t nentries, void *user_data) {
+  my_user_data *ud = (my_user_data *)user_data;
+  accumulator *acc = ud->acc;
+  const nghttp2_send_data_entry *entry;
+  size_t i;
+
+  ++ud->send_data_batch_cb_called;
+  ud->send_data_batch_entries += nentries;
+
+  for (i = 0; i < nentries; ++i) {
+    entry = &entries[i];
+
+    /* Stream must not be closed until its last DATA frame is
+       written. */
+    CU_ASSERT(NULL !=
+              nghttp2_session_get_stream(session, entry->frame.hd.stream_id));
+    CU_ASSERT(entry->source.ptr == nghttp2_session_get_stream_user_data(
+                                       session, entry->frame.hd.stream_id));
+
+    memcpy(acc->buf + acc->length, entry->framehd, NGHTTP2_FRAME_HDLEN);
+    acc->length += NGHTTP2_FRAME_HDLEN + entry->length;
+  }
+
+  if (ud->send_data_batch_pause) {
+    ud->send_data_batch_pause = 0;
+    return NGHTTP2_ERR_PAUSE;
+  }
+
+  return 0;
+}
+
 static ssize_t block_count_send_callback(nghttp2_session *session,
                                          const uint8_t *data, size_t len,
                                          int flags, void *user_data) {
@@ -3161,6 +3220,285 @@ void test_nghttp2_session_continue(void) {
   nghttp2_session_del(session);
 }
 
+void test_nghttp2_session_mem_recv_events(void) {
+  nghttp2_session *session;
+  nghttp2_session_callbacks callbacks;
+  my_user_data ud;
+  nghttp2_bufs bufs;
+  nghttp2_buf *buf;
+  nghttp2_hd_deflater deflater;
+  nghttp2_mem *mem;
+  nghttp2_event events[16];
+  nghttp2_event *tmpevents;
+  size_t nevents;
+  nghttp2_stream *stream;
+  nghttp2_frame_hd hd;
+  nghttp2_goaway goaway;
+  nghttp2_rcbuf *name, *value;
+  int32_t i;
+  uint8_t data[NGHTTP2_FRAME_HDLEN + 100];
+  ssize_t rv;
+  const nghttp2_nv nv[] = {
+      MAKE_NV(":method", "GET"), MAKE_NV(":path", "/"),
+      MAKE_NV(":scheme", "https"), MAKE_NV(":authority", "localhost"),
+      MAKE_NV("alpha", "1"),     MAKE_NV("bravo", "2"),
+      MAKE_NV("charlie", "3"),   MAKE_NV("delta", "4"),
+  };
+
+  mem = nghttp2_mem_default();
+  frame_pack_bufs_init(&bufs);
+
+  memset(&callbacks, 0, sizeof(nghttp2_session_callbacks));
+  callbacks.send_callback = null_send_callback;
+  callbacks.on_frame_recv_callback = on_frame_recv_callback;
+  callbacks.on_header_callback = on_header_callback;
+
+  /* Request HEADERS fits in events */
+  nghttp2_session_server_new(&session, &callbacks, &ud);
+  nghttp2_hd_deflate_init(&deflater, mem);
+
+  rv = pack_headers(&bufs, &deflater, 1,
+                    NGHTTP2_FLAG_END_HEADERS | NGHTTP2_FLAG_END_STREAM, reqnv,
+                    ARRLEN(reqnv), mem);
+
+  CU_ASSERT(0 == rv);
+
+  buf = &bufs.head->buf;
+
+  ud.frame_recv_cb_called = 0;
+  ud.header_cb_called = 0;
+  nevents = ARRLEN(events);
+
+  rv = nghttp2_session_mem_recv_events(session, buf->pos, nghttp2_buf_len(buf),
+                                       events, &nevents);
+
+  CU_ASSERT((ssize_t)nghttp2_buf_len(buf) == rv);
+  CU_ASSERT(0 == ud.frame_recv_cb_called);
+  CU_ASSERT(0 == ud.header_cb_called);
+  CU_ASSERT(7 == nevents);
+  CU_ASSERT(NGHTTP2_EVENT_BEGIN_FRAME == events[0].type);
+  CU_ASSERT(NGHTTP2_HEADERS == events[0].data.hd.type);
+  CU_ASSERT(NGHTTP2_EVENT_BEGIN_HEADERS == events[1].type);
+  CU_ASSERT(NGHTTP2_HCAT_REQUEST == events[1].data.frame.headers.cat);
+  CU_ASSERT(NGHTTP2_EVENT_HEADER == events[2].type);
+  CU_ASSERT(1 == events[2].stream_id);
+  CU_ASSERT(NGHTTP2_HEADERS == events[2].data.header.frame_type);
+  CU_ASSERT(NGHTTP2_HCAT_REQUEST == events[2].data.header.cat);
+  CU_ASSERT(nghttp2_rcbuf_is_static(events[2].data.header.name));
+  CU_ASSERT(strmemeq(":method", events[2].data.header.name->base,
+                     events[2].data.header.name->len));
+  CU_ASSERT(strmemeq(":authority", events[5].data.header.name->base,
+                     events[5].data.header.name->len));
+  CU_ASSERT(strmemeq("localhost", events[5].data.header.value->base,
+                     events[5].data.header.value->len));
+  CU_ASSERT(NGHTTP2_EVENT_FRAME_RECV == events[6].type);
+  CU_ASSERT(NGHTTP2_HEADERS == events[6].data.frame.hd.type);
+  CU_ASSERT(1 == events[6].stream_id);
+
+  /* Callbacks are used by nghttp2_session_mem_recv() as usual */
+  nghttp2_bufs_reset(&bufs);
+  rv = pack_headers(&bufs, &deflater, 3,
+                    NGHTTP2_FLAG_END_HEADERS | NGHTTP2_FLAG_END_STREAM, reqnv,
+                    ARRLEN(reqnv), mem);
+
+  CU_ASSERT(0 == rv);
+
+  buf = &bufs.head->buf;
+
+  rv = nghttp2_session_mem_recv(session, buf->pos, nghttp2_buf_len(buf));
+
+  CU_ASSERT((ssize_t)nghttp2_buf_len(buf) == rv);
+  CU_ASSERT(1 == ud.frame_recv_cb_called);
+  CU_ASSERT(4 == ud.header_cb_called);
+
+  nghttp2_hd_deflate_free(&deflater);
+  nghttp2_session_del(session);
+
+  /* Header block is split when events get full */
+  nghttp2_session_server_new(&session, &callbacks, &ud);
+  nghttp2_hd_deflate_init(&deflater, mem);
+
+  nghttp2_bufs_reset(&bufs);
+  rv = pack_headers(&bufs, &deflater, 1,
+                    NGHTTP2_FLAG_END_HEADERS | NGHTTP2_FLAG_END_STREAM, nv,
+                    ARRLEN(nv), mem);
+
+  CU_ASSERT(0 == rv);
+
+  buf = &bufs.head->buf;
+
+  nevents = NGHTTP2_MIN_RECV_EVENTS;
+
+  rv = nghttp2_session_mem_recv_events(session, buf->pos, nghttp2_buf_len(buf),
+                                       events, &nevents);
+
+  CU_ASSERT(rv > 0);
+  CU_ASSERT((ssize_t)nghttp2_buf_len(buf) > rv);
+  CU_ASSERT(6 == nevents);
+  CU_ASSERT(NGHTTP2_EVENT_HEADER == events[5].type);
+
+  buf->pos += rv;
+  nevents = NGHTTP2_MIN_RECV_EVENTS;
+
+  rv = nghttp2_session_mem_recv_events(session, buf->pos, nghttp2_buf_len(buf),
+                                       events, &nevents);
+
+  CU_ASSERT((ssize_t)nghttp2_buf_len(buf) == rv);
+  CU_ASSERT(5 == nevents);
+  CU_ASSERT(NGHTTP2_EVENT_HEADER == events[0].type);
+  CU_ASSERT(strmemeq("delta", events[3].data.header.name->base,
+                     events[3].data.header.name->len));
+  CU_ASSERT(NGHTTP2_EVENT_FRAME_RECV == events[4].type);
+  CU_ASSERT(4 == ud.header_cb_called);
+
+  /* Too small events */
+  nevents = NGHTTP2_MIN_RECV_EVENTS - 1;
+
+  rv = nghttp2_session_mem_recv_events(session, NULL, 0, events, &nevents);
+
+  CU_ASSERT(NGHTTP2_ERR_INVALID_ARGUMENT == rv);
+
+  nghttp2_hd_deflate_free(&deflater);
+  nghttp2_session_del(session);
+
+  /* DATA closes stream */
+  nghttp2_session_client_new(&session, &callbacks, &ud);
+
+  stream = open_sent_stream(session, 1);
+  nghttp2_stream_shutdown(stream, NGHTTP2_SHUT_WR);
+  nghttp2_session_set_stream_user_data(session, 1, &ud);
+
+  nghttp2_frame_hd_init(&hd, 100, NGHTTP2_DATA, NGHTTP2_FLAG_END_STREAM, 1);
+  memset(data, 0, sizeof(data));
+  nghttp2_frame_pack_frame_hd(data, &hd);
+
+  ud.frame_recv_cb_called = 0;
+  nevents = ARRLEN(events);
+
+  rv = nghttp2_session_mem_recv_events(session, data, sizeof(data), events,
+                                       &nevents);
+
+  CU_ASSERT((ssize_t)sizeof(data) == rv);
+  CU_ASSERT(0 == ud.frame_recv_cb_called);
+  CU_ASSERT(4 == nevents);
+  CU_ASSERT(NGHTTP2_EVENT_BEGIN_FRAME == events[0].type);
+  CU_ASSERT(NGHTTP2_EVENT_DATA_CHUNK_RECV == events[1].type);
+  CU_ASSERT(data + NGHTTP2_FRAME_HDLEN == events[1].data.data_chunk.data);
+  CU_ASSERT(100 == events[1].data.data_chunk.len);
+  CU_ASSERT(NGHTTP2_FLAG_END_STREAM == events[1].data.data_chunk.flags);
+  CU_ASSERT(NGHTTP2_EVENT_FRAME_RECV == events[2].type);
+  CU_ASSERT(NGHTTP2_DATA == events[2].data.frame.hd.type);
+  CU_ASSERT(NGHTTP2_EVENT_STREAM_CLOSE == events[3].type);
+  CU_ASSERT(1 == events[3].stream_id);
+  CU_ASSERT(NGHTTP2_NO_ERROR == events[3].data.stream_close.error_code);
+  CU_ASSERT(&ud == events[3].data.stream_close.stream_user_data);
+  CU_ASSERT(NULL == nghttp2_session_get_stream(session, 1));
+
+  nghttp2_session_del(session);
+
+  /* Events array is not accessed after the call returns */
+  nghttp2_session_server_new(&session, &callbacks, &ud);
+  nghttp2_hd_deflate_init(&deflater, mem);
+
+  nghttp2_bufs_reset(&bufs);
+  rv = pack_headers(&bufs, &deflater, 1,
+                    NGHTTP2_FLAG_END_HEADERS | NGHTTP2_FLAG_END_STREAM, nv,
+                    ARRLEN(nv), mem);
+
+  CU_ASSERT(0 == rv);
+
+  buf = &bufs.head->buf;
+
+  tmpevents = malloc(sizeof(nghttp2_event) * ARRLEN(events));
+  nevents = ARRLEN(events);
+
+  rv = nghttp2_session_mem_recv_events(session, buf->pos, nghttp2_buf_len(buf),
+                                       tmpevents, &nevents);
+
+  CU_ASSERT((ssize_t)nghttp2_buf_len(buf) == rv);
+  CU_ASSERT(11 == nevents);
+  CU_ASSERT(NGHTTP2_EVENT_HEADER == tmpevents[9].type);
+
+  name = tmpevents[9].data.header.name;
+  value = tmpevents[9].data.header.value;
+
+  free(tmpevents);
+
+  /* The references are still held by session */
+  CU_ASSERT(strmemeq("delta", name->base, name->len));
+  CU_ASSERT(strmemeq("4", value->base, value->len));
+
+  nevents = ARRLEN(events);
+
+  rv = nghttp2_session_mem_recv_events(session, NULL, 0, events, &nevents);
+
+  CU_ASSERT(0 == rv);
+  CU_ASSERT(0 == nevents);
+
+  nghttp2_hd_deflate_free(&deflater);
+  nghttp2_session_del(session);
+
+  /* GOAWAY closes more streams than events can hold */
+  callbacks.on_stream_close_callback = on_stream_close_callback;
+
+  nghttp2_session_client_new(&session, &callbacks, &ud);
+
+  for (i = 1; i <= 19; i += 2) {
+    open_sent_stream(session, i);
+  }
+
+  nghttp2_bufs_reset(&bufs);
+  nghttp2_frame_goaway_init(&goaway, 0, NGHTTP2_NO_ERROR, NULL, 0);
+  rv = nghttp2_frame_pack_goaway(&bufs, &goaway);
+
+  CU_ASSERT(0 == rv);
+
+  nghttp2_frame_goaway_free(&goaway, mem);
+
+  buf = &bufs.head->buf;
+
+  ud.stream_close_cb_called = 0;
+  nevents = NGHTTP2_MIN_RECV_EVENTS;
+
+  rv = nghttp2_session_mem_recv_events(session, buf->pos, nghttp2_buf_len(buf),
+                                       events, &nevents);
+
+  CU_ASSERT((ssize_t)nghttp2_buf_len(buf) == rv);
+  CU_ASSERT(0 == ud.stream_close_cb_called);
+  CU_ASSERT(NGHTTP2_MIN_RECV_EVENTS == nevents);
+  CU_ASSERT(NGHTTP2_EVENT_BEGIN_FRAME == events[0].type);
+  CU_ASSERT(NGHTTP2_EVENT_FRAME_RECV == events[1].type);
+  CU_ASSERT(NGHTTP2_GOAWAY == events[1].data.frame.hd.type);
+
+  for (i = 2; i < NGHTTP2_MIN_RECV_EVENTS; ++i) {
+    CU_ASSERT(NGHTTP2_EVENT_STREAM_CLOSE == events[i].type);
+  }
+
+  /* The rest of events are delivered without any input */
+  nevents = NGHTTP2_MIN_RECV_EVENTS;
+
+  rv = nghttp2_session_mem_recv_events(session, NULL, 0, events, &nevents);
+
+  CU_ASSERT(0 == rv);
+  CU_ASSERT(0 == ud.stream_close_cb_called);
+  CU_ASSERT(4 == nevents);
+
+  for (i = 0; i < 4; ++i) {
+    CU_ASSERT(NGHTTP2_EVENT_STREAM_CLOSE == events[i].type);
+  }
+
+  nevents = NGHTTP2_MIN_RECV_EVENTS;
+
+  rv = nghttp2_session_mem_recv_events(session, NULL, 0, events, &nevents);
+
+  CU_ASSERT(0 == rv);
+  CU_ASSERT(0 == nevents);
+
+  nghttp2_session_del(session);
+
+  nghttp2_bufs_free(&bufs);
+}
+
 void test_nghttp2_session_add_frame(void) {
   nghttp2_session *session;
   nghttp2_session_callbacks callbacks;
@@ -8001,6 +8339,18 @@ void test_nghttp2_session_set_option(void) {
   nghttp2_session_del(session);
   nghttp2_option_del(option);
 
+  /* Test for nghttp2_option_set_max_rcbuf_freelist */
+  nghttp2_option_new(&option);
+  nghttp2_option_set_max_rcbuf_freelist(option, 16);
+
+  nghttp2_session_client_new2(&session, &callbacks, NULL, option);
+
+  CU_ASSERT(16 == session->hd_deflater.ctx.rcbuf_pool->max_free);
+  CU_ASSERT(16 == session->hd_inflater.ctx.rcbuf_pool->max_free);
+
+  nghttp2_session_del(session);
+  nghttp2_option_del(option);
+
   /* Test for nghttp2_option_set_max_reserved_remote_streams */
   nghttp2_option_new(&option);
   nghttp2_option_set_max_reserved_remote_streams(option, 99);
@@ -10448,6 +10798,101 @@ void test_nghttp2_session_send_data_callback(void) {
   nghttp2_session_del(session);
 }
 
+void test_nghttp2_session_send_data_batch_callback(void) {
+  nghttp2_session *session;
+  nghttp2_session_callbacks callbacks;
+  nghttp2_data_provider data_prd;
+  my_user_data ud;
+  accumulator acc;
+  nghttp2_frame_hd hd;
+  size_t remaining[2];
+  size_t i, off, nframes;
+  int32_t stream_id;
+
+  memset(&callbacks, 0, sizeof(nghttp2_session_callbacks));
+  callbacks.send_callback = accumulator_send_callback;
+  callbacks.send_data_batch_callback = send_data_batch_callback;
+
+  data_prd.read_callback = per_stream_no_copy_data_source_read_callback;
+
+  /* DATA frames of 2 streams are passed to the callback in
+     batches. */
+  acc.length = 0;
+  memset(&ud, 0, sizeof(ud));
+  ud.acc = &acc;
+
+  nghttp2_session_client_new(&session, &callbacks, &ud);
+
+  for (i = 0; i < 2; ++i) {
+    stream_id = (int32_t)(i * 2 + 1);
+    remaining[i] = NGHTTP2_DATA_PAYLOADLEN + 100;
+
+    open_sent_stream(session, stream_id);
+    nghttp2_session_set_stream_user_data(session, stream_id, &remaining[i]);
+
+    data_prd.source.ptr = &remaining[i];
+    CU_ASSERT(0 == nghttp2_submit_data(session, NGHTTP2_FLAG_END_STREAM,
+                                       stream_id, &data_prd));
+  }
+
+  CU_ASSERT(0 == nghttp2_session_send(session));
+  /* The first DATA frames of both streams go in a batch.  Each last
+     DATA frame is flushed immediately because it has END_STREAM. */
+  CU_ASSERT(4 == ud.send_data_batch_entries);
+  CU_ASSERT(3 == ud.send_data_batch_cb_called);
+  CU_ASSERT((NGHTTP2_FRAME_HDLEN * 2 + NGHTTP2_DATA_PAYLOADLEN + 100) * 2 ==
+            acc.length);
+
+  for (off = 0, nframes = 0; off < acc.length;
+       off += NGHTTP2_FRAME_HDLEN + hd.length, ++nframes) {
+    nghttp2_frame_unpack_frame_hd(&hd, acc.buf + off);
+
+    CU_ASSERT(NGHTTP2_DATA == hd.type);
+  }
+
+  CU_ASSERT(4 == nframes);
+  CU_ASSERT(nghttp2_session_get_stream(session, 1)->shut_flags &
+            NGHTTP2_SHUT_WR);
+  CU_ASSERT(nghttp2_session_get_stream(session, 3)->shut_flags &
+            NGHTTP2_SHUT_WR);
+
+  nghttp2_session_del(session);
+
+  /* NGHTTP2_ERR_PAUSE makes nghttp2_session_send() return after the
+     batch. */
+  acc.length = 0;
+  memset(&ud, 0, sizeof(ud));
+  ud.acc = &acc;
+  ud.send_data_batch_pause = 1;
+
+  nghttp2_session_client_new(&session, &callbacks, &ud);
+
+  for (i = 0; i < 2; ++i) {
+    stream_id = (int32_t)(i * 2 + 1);
+    remaining[i] = 100;
+
+    open_sent_stream(session, stream_id);
+    nghttp2_session_set_stream_user_data(session, stream_id, &remaining[i]);
+
+    data_prd.source.ptr = &remaining[i];
+    CU_ASSERT(0 == nghttp2_submit_data(session, NGHTTP2_FLAG_END_STREAM,
+                                       stream_id, &data_prd));
+  }
+
+  CU_ASSERT(0 == nghttp2_session_send(session));
+  CU_ASSERT(1 == ud.send_data_batch_cb_called);
+  CU_ASSERT(1 == ud.send_data_batch_entries);
+  CU_ASSERT(nghttp2_session_want_write(session));
+
+  CU_ASSERT(0 == nghttp2_session_send(session));
+  CU_ASSERT(2 == ud.send_data_batch_cb_called);
+  CU_ASSERT(2 == ud.send_data_batch_entries);
+  CU_ASSERT((NGHTTP2_FRAME_HDLEN + 100) * 2 == acc.length);
+  CU_ASSERT(!nghttp2_session_want_write(session));
+
+  nghttp2_session_del(session);
+}
+
 void test_nghttp2_session_on_begin_headers_temporal_failure(void) {
   nghttp2_session *session;
   nghttp2_session_callbacks callbacks;
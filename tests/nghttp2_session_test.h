@@ -52,6 +52,7 @@ void test_nghttp2_session_recv_altsvc(void);
 void test_nghttp2_session_recv_origin(void);
 void test_nghttp2_session_recv_priority_update(void);
 void test_nghttp2_session_continue(void);
+void test_nghttp2_session_mem_recv_events(void);
 void test_nghttp2_session_add_frame(void);
 void test_nghttp2_session_on_request_headers_received(void);
 void test_nghttp2_session_on_response_headers_received(void);
@@ -150,6 +151,7 @@ void test_nghttp2_session_open_idle_stream(void);
 void test_nghttp2_session_cancel_reserved_remote(void);
 void test_nghttp2_session_reset_pending_headers(void);
 void test_nghttp2_session_send_data_callback(void);
+void test_nghttp2_session_send_data_batch_callback(void);
 void test_nghttp2_session_on_begin_headers_temporal_failure(void);
 void test_nghttp2_session_defer_then_close(void);
 void test_nghttp2_session_detach_item_from_closed_stream(void);